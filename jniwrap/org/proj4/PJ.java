@@ -269,6 +269,31 @@ public class PJ {
     public native void transform(PJ target, int dimension, double[] coordinates, int offset, int numPts)
             throws PJException;
 
+    /**
+     * Transforms in-place the coordinates in the given array, returning a bitmap of the
+     * points that could not be transformed instead of throwing an exception for them.
+     * The whole array crosses the JNI boundary in a single call, so this method should
+     * be preferred over repeated {@link #transform(PJ, int, double[], int, int)} calls
+     * when processing large batches of coordinates. The array layout and units are the
+     * same as for {@code transform}. Points that failed have their ordinates set to
+     * {@link Double#POSITIVE_INFINITY} and their bit set in the returned bitmap, which
+     * holds {@code ceil(numPts/64)} values packed in {@link java.util.BitSet} order
+     * (bit <var>i</var> is bit {@code i%64} of word {@code i/64}).
+     *
+     * @param  target The target CRS.
+     * @param  dimension The dimension of each coordinate value. Must be in the [2-{@value #DIMENSION_MAX}] range.
+     * @param  coordinates The coordinates to transform, as a sequence of
+     *         (<var>x</var>,<var>y</var>,&lt;<var>z</var>&gt;,&hellip;) tuples.
+     * @param  offset Offset of the first coordinate in the given array.
+     * @param  numPts Number of points to transform.
+     * @return A bitmap with one bit per point, set for the points that failed.
+     * @throws NullPointerException If the {@code target} or {@code coordinates} argument is null.
+     * @throws IndexOutOfBoundsException if the {@code offset} or {@code numPts} arguments are invalid.
+     * @throws PJException If the operation failed as a whole (provided by Proj4).
+     */
+    public native long[] transformBatch(PJ target, int dimension, double[] coordinates, int offset, int numPts)
+            throws PJException;
+
     /**
      * Returns a description of the last error that occurred, or {@code null} if none.
      *
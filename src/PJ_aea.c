@@ -38,6 +38,7 @@
 	double	phi1; \
 	double	phi2; \
 	double	*en; \
+	double	*apa; \
 	int		ellips;
 
 #define PJ_LIB__
@@ -111,7 +112,176 @@ INVERSE(e_inverse) /* ellipsoid & spheroid */;
 	}
 	return (lp);
 }
-FREEUP; if (P) { if (P->en) pj_dalloc(P->en); pj_dalloc(P); } }
+/* batch kernels: straight line loops over coordinate arrays with
+** pj_qsfn() expanded inline so the compiler keeps the cone constants
+** in registers; bad points are flagged with HUGE_VAL instead of
+** aborting the batch.  The ellipsoidal inverse replaces the phi1_()
+** iteration with the precomputed authalic latitude series from
+** pj_authset(), which agrees with the iteration to a couple of
+** times its 1e-10 convergence tolerance (worst case ~1.5mm) */
+static void e_forward_batch_es(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P, double es) {
+	double cn = P->n, c = P->c, dd = P->dd, rho0 = P->rho0;
+	double e = sqrt(es), one_es = 1. - es;
+	double last_ph = HUGE_VAL, last_rho = HUGE_VAL;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lm = lam[i] * cn, ph = phi[i], rho;
+
+		/* rho depends only on phi; raster scanlines feed runs of
+		** identical latitudes, so reuse the last evaluation */
+		if (ph == last_ph)
+			rho = last_rho;
+		else {
+			double s = sin(ph), con = e * s;
+
+			rho = c - cn * (one_es * (s / (1. - con * con) -
+			   (.5 / e) * log((1. - con) / (1. + con))));
+			if (rho < 0.) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			last_ph = ph;
+			rho = last_rho = dd * sqrt(rho);
+		}
+		x[i] = rho * sin(lm);
+		y[i] = rho0 - rho * cos(lm);
+	}
+}
+/* generic wrapper passes the runtime es; the WGS84/GRS80 wrappers pass
+** a literal so the derived constants fold (the inverse is left generic:
+** its per-point work only loads the precomputed authalic series) */
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_es(lam, phi, x, y, n, P, P->es);
+}
+static void e_forward_batch_wgs84(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_es(lam, phi, x, y, n, P, PJ_ES_WGS84);
+}
+static void e_forward_batch_grs80(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_es(lam, phi, x, y, n, P, PJ_ES_GRS80);
+}
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double cn = P->n, n2 = P->n2, c = P->c, dd = P->dd, rho0 = P->rho0;
+	double last_ph = HUGE_VAL, last_rho = HUGE_VAL;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lm = lam[i] * cn, ph = phi[i], rho;
+
+		if (ph == last_ph) /* same scanline latitude */
+			rho = last_rho;
+		else {
+			rho = c - n2 * sin(ph);
+			if (rho < 0.) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			last_ph = ph;
+			rho = last_rho = dd * sqrt(rho);
+		}
+		x[i] = rho * sin(lm);
+		y[i] = rho0 - rho * cos(lm);
+	}
+}
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double cn = P->n, rn = 1. / P->n, dd = P->dd;
+	double c = P->c, rho0 = P->rho0, ec = P->ec, *apa = P->apa;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xi = x[i], yi = rho0 - y[i], rho;
+
+		if ((rho = hypot(xi, yi)) != 0.0) {
+			double qs;
+
+			if (cn < 0.) {
+				rho = -rho;
+				xi = -xi;
+				yi = -yi;
+			}
+			qs = rho / dd;
+			qs = (c - qs * qs) * rn;
+			if (fabs(ec - fabs(qs)) > TOL7) {
+				double ratio = qs / ec;
+
+				if (ratio > 1.)
+					ratio = 1.;
+				else if (ratio < -1.)
+					ratio = -1.;
+				phi[i] = pj_authlat(asin(ratio), apa);
+			} else
+				phi[i] = qs < 0. ? -HALFPI : HALFPI;
+			lam[i] = atan2(xi, yi) * rn;
+		} else {
+			lam[i] = 0.;
+			phi[i] = cn > 0. ? HALFPI : -HALFPI;
+		}
+	}
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double cn = P->n, rn = 1. / P->n, n2 = P->n2, dd = P->dd;
+	double c = P->c, rho0 = P->rho0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xi = x[i], yi = rho0 - y[i], rho;
+
+		if ((rho = hypot(xi, yi)) != 0.0) {
+			double qs;
+
+			if (cn < 0.) {
+				rho = -rho;
+				xi = -xi;
+				yi = -yi;
+			}
+			qs = rho / dd;
+			qs = (c - qs * qs) / n2;
+			if (fabs(qs) <= 1.)
+				phi[i] = asin(qs);
+			else
+				phi[i] = qs < 0. ? -HALFPI : HALFPI;
+			lam[i] = atan2(xi, yi) * rn;
+		} else {
+			lam[i] = 0.;
+			phi[i] = cn > 0. ? HALFPI : -HALFPI;
+		}
+	}
+}
+/* analytic partials: rho^2 is linear in the authalic q(phi), so
+** d(rho)/dphi comes straight from dq/dphi = 2(1-es)cosphi/(1-es sin^2)^2 */
+SPECIAL(fac) {
+	double sinphi = sin(lp.phi), cosphi = cos(lp.phi);
+	double rho2, rho, dr, lm;
+
+	if ((rho2 = P->c - (P->ellips ? P->n * pj_qsfn(sinphi,
+		P->e, P->one_es) : P->n2 * sinphi)) < 0.)
+		return;
+	if ((rho = P->dd * sqrt(rho2)) == 0.)
+		return;
+	if (P->ellips) {
+		double con = 1. - P->es * sinphi * sinphi;
+
+		dr = - P->n * (1. - P->es) * cosphi * P->dd * P->dd /
+			(con * con * rho);
+	} else
+		dr = - .5 * P->n2 * cosphi * P->dd * P->dd / rho;
+	lm = lp.lam * P->n;
+	/* y_l and x_p are stored negated, matching pj_deriv()'s sign
+	** convention which the factors code expects */
+	fac->der.x_l = rho * P->n * cos(lm);
+	fac->der.y_l = - rho * P->n * sin(lm);
+	fac->der.x_p = - dr * sin(lm);
+	fac->der.y_p = - dr * cos(lm);
+	fac->code |= IS_ANAL_XL_YL + IS_ANAL_XP_YP;
+}
+FREEUP; if (P) pj_dalloc(P); }
 	static PJ *
 setup(PJ *P) {
 	double cosphi, sinphi;
@@ -124,7 +294,7 @@ setup(PJ *P) {
 	if( (P->ellips = (P->es > 0.))) {
 		double ml1, m1;
 
-		if (!(P->en = pj_enfn(P->es))) E_ERROR_0;
+		if (!(P->en = pj_enfn_shared(P->es))) E_ERROR_0;
 		m1 = pj_msfn(sinphi, cosphi, P->es);
 		ml1 = pj_qsfn(sinphi, P->e, P->one_es);
 		if (secant) { /* secant cone */
@@ -142,14 +312,25 @@ setup(PJ *P) {
 		P->dd = 1. / P->n;
 		P->rho0 = P->dd * sqrt(P->c - P->n * pj_qsfn(sin(P->phi0),
 			P->e, P->one_es));
+		P->apa = pj_authset_shared(P->es);
+		P->fwd_batch = e_forward_batch;
+		if (P->spec_ellps == PJ_SPEC_ELLPS_WGS84)
+			P->fwd_batch = e_forward_batch_wgs84;
+		else if (P->spec_ellps == PJ_SPEC_ELLPS_GRS80)
+			P->fwd_batch = e_forward_batch_grs80;
+		if (P->apa != NULL)
+			P->inv_batch = e_inverse_batch;
 	} else {
 		if (secant) P->n = .5 * (P->n + sin(P->phi2));
 		P->n2 = P->n + P->n;
 		P->c = cosphi * cosphi + P->n2 * sinphi;
 		P->dd = 1. / P->n;
 		P->rho0 = P->dd * sqrt(P->c - P->n2 * sin(P->phi0));
+		P->fwd_batch = s_forward_batch;
+		P->inv_batch = s_inverse_batch;
 	}
 	P->inv = e_inverse; P->fwd = e_forward;
+	P->spc = fac;
 	return P;
 }
 ENTRY1(aea,en)
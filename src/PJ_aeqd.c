@@ -213,12 +213,234 @@ INVERSE(s_inverse); /* spherical */
 	}
 	return (lp);
 }
+/* batch kernels: the oblique/equatorial ellipsoidal cases go through
+** the array entry points in geodesic.c - geod_inverse_batch() forward,
+** geod_direct_from() inverse - so the state of the fixed projection
+** center is computed once per chunk instead of once per point; the
+** polar and spherical cases are straight loops with the center trig
+** hoisted and the rectifying radius memoized per scanline */
+#define CHUNK 256
+
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	long j;
+
+	if (P->mode == N_POLE || P->mode == S_POLE) {
+		double Mp = P->Mp;
+		double *en = P->en;
+		double last_ph = HUGE_VAL, last_rho = 0.;
+
+		for (j = 0; j < n; ++j) {
+			double lm = lam[j], ph = phi[j], coslam = cos(lm), rho;
+
+			if (P->mode == N_POLE)
+				coslam = - coslam;
+			if (ph == last_ph)
+				rho = last_rho;
+			else {
+				last_ph = ph;
+				rho = last_rho =
+					fabs(Mp - pj_mlfn(ph, sin(ph), cos(ph), en));
+			}
+			x[j] = rho * sin(lm);
+			y[j] = rho * coslam;
+		}
+		return;
+	}
+	{
+		double lat2[CHUNK], lon2[CHUNK], s12[CHUNK], azi1[CHUNK];
+		double lat1[CHUNK], lon1[CHUNK];
+		double phi0 = P->phi0, lam0 = P->lam0, a = P->a;
+		long base;
+		int i, m;
+
+		for (i = 0; i < CHUNK; ++i) {
+			lat1[i] = phi0 * RHO;
+			lon1[i] = lam0 * RHO;
+		}
+		for (base = 0; base < n; base += m) {
+			m = n - base > CHUNK ? CHUNK : (int)(n - base);
+			for (i = 0; i < m; ++i) {
+				lat2[i] = phi[base + i] * RHO;
+				lon2[i] = (lam[base + i] + lam0) * RHO;
+			}
+			geod_inverse_batch(&P->g, m, lat1, lon1, lat2, lon2,
+				s12, azi1, 0, 0);
+			for (i = 0; i < m; ++i) {
+				double az;
+
+				if (fabs(lam[base + i]) < EPS10 &&
+					fabs(phi[base + i] - phi0) < EPS10) {
+					x[base + i] = y[base + i] = 0.;
+					continue;
+				}
+				az = azi1[i] / RHO;
+				x[base + i] = s12[i] * sin(az) / a;
+				y[base + i] = s12[i] * cos(az) / a;
+			}
+		}
+	}
+}
+/* worst case work per point is fixed: geod_direct() is a closed
+** series, and the polar pj_inv_mlfn_batch() series needs no iteration
+** for the terrestrial ellipsoids (es <= .007) and at most 10 Newton
+** rounds otherwise, flagged with HUGE_VAL when exhausted */
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double azi1[CHUNK], s12[CHUNK], lat2[CHUNK], lon2[CHUNK];
+	double phi0 = P->phi0, lam0 = P->lam0, a = P->a;
+	double lat1 = phi0 * RHO, lon1 = lam0 * RHO;
+	long base;
+	int i, m;
+
+	if (P->mode == N_POLE || P->mode == S_POLE) {
+		double Mp = P->Mp, es = P->es;
+		double *en = P->en;
+		long j;
+
+		for (j = 0; j < n; ++j) {
+			double xi = x[j], yi = y[j];
+			double c = hypot(xi, yi), ph;
+
+			if (c < EPS10) {
+				phi[j] = phi0;
+				lam[j] = 0.;
+				continue;
+			}
+			ph = pj_inv_mlfn_batch(P->mode == N_POLE ?
+				Mp - c : Mp + c, es, en);
+			if (ph == HUGE_VAL) {
+				lam[j] = phi[j] = HUGE_VAL;
+				continue;
+			}
+			phi[j] = ph;
+			lam[j] = atan2(xi, P->mode == N_POLE ? -yi : yi);
+		}
+		return;
+	}
+	for (base = 0; base < n; base += m) {
+		m = n - base > CHUNK ? CHUNK : (int)(n - base);
+		for (i = 0; i < m; ++i) {
+			double x2 = x[base + i] * a, y2 = y[base + i] * a;
+
+			azi1[i] = atan2(x2, y2) * RHO;
+			s12[i] = sqrt(x2 * x2 + y2 * y2);
+		}
+		geod_direct_from(&P->g, lat1, lon1, m, azi1, s12,
+			lat2, lon2, 0);
+		for (i = 0; i < m; ++i) {
+			if (hypot(x[base + i], y[base + i]) < EPS10) {
+				phi[base + i] = phi0;
+				lam[base + i] = 0.;
+				continue;
+			}
+			phi[base + i] = lat2[i] / RHO;
+			lam[base + i] = lon2[i] / RHO - lam0;
+		}
+	}
+}
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double sinph0 = P->sinph0, cosph0 = P->cosph0;
+	long j;
+
+	for (j = 0; j < n; ++j) {
+		double lm = lam[j], ph = phi[j];
+		double sinphi = sin(ph), cosphi = cos(ph), coslam = cos(lm);
+		double xv, yv;
+
+		switch (P->mode) {
+		case EQUIT:
+			yv = cosphi * coslam;
+			goto oblcon;
+		case OBLIQ:
+			yv = sinph0 * sinphi + cosph0 * cosphi * coslam;
+oblcon:
+			if (fabs(fabs(yv) - 1.) < TOL) {
+				if (yv < 0.) {
+					x[j] = y[j] = HUGE_VAL;
+					continue;
+				}
+				xv = yv = 0.;
+			} else {
+				yv = acos(yv);
+				yv /= sin(yv);
+				xv = yv * cosphi * sin(lm);
+				yv *= (P->mode == EQUIT) ? sinphi :
+					cosph0 * sinphi - sinph0 * cosphi * coslam;
+			}
+			break;
+		case N_POLE:
+			ph = -ph;
+			coslam = -coslam;
+			/* falls through */
+		case S_POLE:
+			if (fabs(ph - HALFPI) < EPS10) {
+				x[j] = y[j] = HUGE_VAL;
+				continue;
+			}
+			xv = (yv = (HALFPI + ph)) * sin(lm);
+			yv *= coslam;
+			break;
+		default:
+			xv = yv = HUGE_VAL;
+			break;
+		}
+		x[j] = xv;
+		y[j] = yv;
+	}
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double sinph0 = P->sinph0, cosph0 = P->cosph0, phi0 = P->phi0;
+	long j;
+
+	for (j = 0; j < n; ++j) {
+		double xi = x[j], yi = y[j], c_rh, ph, lm;
+
+		if ((c_rh = hypot(xi, yi)) > PI) {
+			if (c_rh - EPS10 > PI) {
+				lam[j] = phi[j] = HUGE_VAL;
+				continue;
+			}
+			c_rh = PI;
+		} else if (c_rh < EPS10) {
+			phi[j] = phi0;
+			lam[j] = 0.;
+			continue;
+		}
+		if (P->mode == OBLIQ || P->mode == EQUIT) {
+			double sinc = sin(c_rh), cosc = cos(c_rh), v;
+
+			if (P->mode == EQUIT) {
+				v = yi * sinc / c_rh;
+				xi *= sinc;
+				yi = cosc * c_rh;
+			} else {
+				v = cosc * sinph0 + yi * sinc * cosph0 / c_rh;
+			}
+			/* aasin() without the ctx: clamp at |v| >= 1 */
+			ph = fabs(v) >= 1. ?
+				(v < 0. ? -HALFPI : HALFPI) : asin(v);
+			if (P->mode == OBLIQ) {
+				yi = (cosc - sinph0 * sin(ph)) * c_rh;
+				xi *= sinc * cosph0;
+			}
+			lm = yi == 0. ? 0. : atan2(xi, yi);
+		} else if (P->mode == N_POLE) {
+			ph = HALFPI - c_rh;
+			lm = atan2(xi, -yi);
+		} else {
+			ph = c_rh - HALFPI;
+			lm = atan2(xi, yi);
+		}
+		phi[j] = ph;
+		lam[j] = lm;
+	}
+}
 FREEUP;
-    if (P) {
-		if (P->en)
-			pj_dalloc(P->en);
+    if (P)
 		pj_dalloc(P);
-	}
 }
 ENTRY1(aeqd, en)
 	geod_init(&P->g, P->a, P->es / (1 + sqrt(P->one_es)));
@@ -238,8 +460,10 @@ ENTRY1(aeqd, en)
 	}
 	if (! P->es) {
 		P->inv = s_inverse; P->fwd = s_forward;
+		P->fwd_batch = s_forward_batch;
+		P->inv_batch = s_inverse_batch;
 	} else {
-		if (!(P->en = pj_enfn(P->es))) E_ERROR_0;
+		if (!(P->en = pj_enfn_shared(P->es))) E_ERROR_0;
 		if (pj_param(P->ctx, P->params, "bguam").i) {
 			P->M1 = pj_mlfn(P->phi0, P->sinph0, P->cosph0, P->en);
 			P->inv = e_guam_inv; P->fwd = e_guam_fwd;
@@ -260,6 +484,8 @@ ENTRY1(aeqd, en)
 				break;
 			}
 			P->inv = e_inverse; P->fwd = e_forward;
+			P->fwd_batch = e_forward_batch;
+			P->inv_batch = e_inverse_batch;
 		}
 	}
 ENDENTRY(P)
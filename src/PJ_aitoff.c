@@ -82,7 +82,9 @@ FORWARD(s_forward); /* spheroid */
 *
 ************************************************************************************/
 
-INVERSE(s_inverse); /* sphere */  
+	static LP /* 2D Newton solve shared by the scalar and batch inverse */
+aitoff_newton(XY xy, PJ *P) {
+	LP lp;
         int iter, MAXITER = 10, round = 0, MAXROUND = 20;
 	double EPSILON = 1e-12, D, C, f1, f2, f1p, f1l, f2p, f2l, dp, dl, sl, sp, cp, cl, x, y;
 
@@ -141,11 +143,59 @@ INVERSE(s_inverse); /* sphere */
 	return (lp);
 }
 
+INVERSE(s_inverse); /* sphere */
+	return aitoff_newton(xy, P);
+}
+
+	static void /* forward of a contiguous array, in place safe */
+s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	int mode = P->mode;
+	double cosphi1 = P->cosphi1;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lp_lam = lam[i], lp_phi = phi[i], c, d, xx, yy;
+
+		if ((d = acos(cos(lp_phi) * cos(c = 0.5 * lp_lam)))) {
+			/* basic Aitoff */
+			xx = 2. * d * cos(lp_phi) * sin(c) * (yy = 1. / sin(d));
+			yy *= d * sin(lp_phi);
+		} else
+			xx = yy = 0.;
+		if (mode) { /* Winkel Tripel */
+			xx = (xx + lp_lam * cosphi1) * 0.5;
+			yy = (yy + lp_phi) * 0.5;
+		}
+		x[i] = xx;
+		y[i] = yy;
+	}
+}
+
+	static void /* Newton inverse of a contiguous array */
+s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		XY xy;
+		LP lp;
+
+		xy.x = x[i];
+		xy.y = y[i];
+		lp = aitoff_newton(xy, P);
+		lam[i] = lp.lam;
+		phi[i] = lp.phi;
+	}
+}
+
 FREEUP; if (P) pj_dalloc(P); }
 	static PJ *
 setup(PJ *P) {
 	P->inv = s_inverse;
 	P->fwd = s_forward;
+	P->fwd_batch = s_forward_batch;
+	P->inv_batch = s_inverse_batch;
 	P->es = 0.;
 	return P;
 }
@@ -55,12 +55,102 @@ INVERSE(e_inverse); /* ellipsoid */
 	else I_ERROR;
 	return (lp);
 }
+/* Batch variants: scalar math with the setup constants and en[]
+** access hoisted, the ellipsoid inverse running the store-free
+** pj_inv_mlfn_batch(), and failures flagged with HUGE_VAL.  In
+** place safe. */
+	static void
+e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double es = P->es, am1 = P->am1, m1 = P->m1;
+	double en0 = P->en[0], en1 = P->en[1], en2 = P->en[2],
+		en3 = P->en[3], en4 = P->en[4];
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lp_lam = lam[i], lp_phi = phi[i];
+		double sp = sin(lp_phi), c = cos(lp_phi);
+		double ss = sp * sp;
+		double rh = am1 + m1 - (en0 * lp_phi - c * sp * (en1
+			+ ss * (en2 + ss * (en3 + ss * en4))));
+		double E = c * lp_lam / (rh * sqrt(1. - es * ss));
+
+		x[i] = rh * sin(E);
+		y[i] = am1 - rh * cos(E);
+	}
+}
+	static void
+s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double cphi1 = P->cphi1, phi1 = P->phi1;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double rh = cphi1 + phi1 - phi[i];
+
+		if (fabs(rh) > EPS10) {
+			double E = lam[i] * cos(phi[i]) / rh;
+
+			x[i] = rh * sin(E);
+			y[i] = cphi1 - rh * cos(E);
+		} else
+			x[i] = y[i] = 0.;
+	}
+}
+	static void
+e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double es = P->es, am1 = P->am1, m1 = P->m1;
+	double *en = P->en;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xy_x = x[i], xy_y = am1 - y[i];
+		double rh = hypot(xy_x, xy_y);
+		double ph = pj_inv_mlfn_batch(am1 + m1 - rh, es, en);
+		double s;
+
+		if (ph == HUGE_VAL) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		if ((s = fabs(ph)) < HALFPI) {
+			s = sin(ph);
+			lam[i] = rh * atan2(xy_x, xy_y) *
+				sqrt(1. - es * s * s) / cos(ph);
+			phi[i] = ph;
+		} else if (fabs(s - HALFPI) <= EPS10) {
+			lam[i] = 0.;
+			phi[i] = ph;
+		} else
+			lam[i] = phi[i] = HUGE_VAL;
+	}
+}
+	static void
+s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double cphi1 = P->cphi1, phi1 = P->phi1;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xy_x = x[i], xy_y = cphi1 - y[i];
+		double rh = hypot(xy_x, xy_y);
+		double ph = cphi1 + phi1 - rh;
+
+		if (fabs(ph) > HALFPI) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		phi[i] = ph;
+		if (fabs(fabs(ph) - HALFPI) <= EPS10)
+			lam[i] = 0.;
+		else
+			lam[i] = rh * atan2(xy_x, xy_y) / cos(ph);
+	}
+}
 FREEUP;
-	if (P) {
-		if (P->en)
-			pj_dalloc(P->en);
+	if (P)
 		pj_dalloc(P);
-	}
 }
 ENTRY1(bonne, en)
 	double c;
@@ -68,12 +158,14 @@ ENTRY1(bonne, en)
 	P->phi1 = pj_param(P->ctx, P->params, "rlat_1").f;
 	if (fabs(P->phi1) < EPS10) E_ERROR(-23);
 	if (P->es) {
-		P->en = pj_enfn(P->es);
+		P->en = pj_enfn_shared(P->es);
 		P->m1 = pj_mlfn(P->phi1, P->am1 = sin(P->phi1),
 			c = cos(P->phi1), P->en);
 		P->am1 = c / (sqrt(1. - P->es * P->am1 * P->am1) * P->am1);
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->inv_batch = e_inverse_batch;
+		P->fwd_batch = e_forward_batch;
 	} else {
 		if (fabs(P->phi1) + EPS10 >= HALFPI)
 			P->cphi1 = 0.;
@@ -81,5 +173,7 @@ ENTRY1(bonne, en)
 			P->cphi1 = 1. / tan(P->phi1);
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+		P->inv_batch = s_inverse_batch;
+		P->fwd_batch = s_forward_batch;
 	}
 ENDENTRY(P)
@@ -48,7 +48,7 @@ FORWARD(e_forward); /* ellipsoid */
     l1 = (xy.y - oy) * tan(ROTATION_ANGLE);
     l2 = -xy.x - l1 + PT_O_LAMBDA;
     ry = l2 * cos(ROTATION_ANGLE) * sin(ROTATION_ANGLE) + xy.y;
-    ry = pj_phi2(P->ctx, exp(-ry), P->e); /*inverse Mercator*/
+    ry = pj_phi2_(exp(-ry), P); /*inverse Mercator*/
     xy.x = PT_O_LINE - RAD_TO_DEG * 
         (ry - PT_O_PHI) * DEG_TO_LINE / cos(ROTATION_ANGLE); 
     xy.y = PT_O_STATION + RAD_TO_DEG * 
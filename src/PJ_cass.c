@@ -59,21 +59,108 @@ INVERSE(s_inverse); /* spheroid */
 	lp.lam = atan2(tan(xy.x), cos(P->dd));
 	return (lp);
 }
+/* Batch variants: scalar math with the en[] coefficients and es reads
+** hoisted to locals, pj_mlfn/pj_inv_mlfn inlined (the scalar entries
+** also stomp P-> scratch fields, which the batch loops avoid), and
+** failures flagged with HUGE_VAL.  In place safe. */
+	static void
+e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double es = P->es, m0 = P->m0;
+	double en0 = P->en[0], en1 = P->en[1], en2 = P->en[2],
+		en3 = P->en[3], en4 = P->en[4];
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lp_lam = lam[i], lp_phi = phi[i];
+		double sp = sin(lp_phi), cp = cos(lp_phi);
+		double ss = sp * sp;
+		double ml = en0 * lp_phi - cp * sp * (en1 + ss * (en2
+			+ ss * (en3 + ss * en4)));
+		double nu = 1. / sqrt(1. - es * ss);
+		double tn = tan(lp_phi), t = tn * tn;
+		double a1 = lp_lam * cp;
+		double c = cp * (es * cp / (1 - es));
+		double a2 = a1 * a1;
+
+		x[i] = nu * a1 * (1. - a2 * t *
+			(C1 - (8. - t + 8. * c) * a2 * C2));
+		y[i] = ml - (m0 - nu * tn * a2 *
+			(.5 + (5. - t + 6. * c) * a2 * C3));
+	}
+}
+	static void
+s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double phi0 = P->phi0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lp_lam = lam[i], lp_phi = phi[i];
+
+		x[i] = asin(cos(lp_phi) * sin(lp_lam));
+		y[i] = atan2(tan(lp_phi), cos(lp_lam)) - phi0;
+	}
+}
+	static void
+e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double es = P->es, m0 = P->m0, one_es = 1. - P->es;
+	double *en = P->en;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xy_x = x[i], xy_y = y[i];
+		double ph1 = pj_inv_mlfn_batch(m0 + xy_y, es, en);
+		double tn, t, sn, r, nu, dd, d2;
+
+		if (ph1 == HUGE_VAL) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		tn = tan(ph1); t = tn * tn;
+		sn = sin(ph1);
+		r = 1. / (1. - es * sn * sn);
+		nu = sqrt(r);
+		r *= one_es * nu;
+		dd = xy_x / nu;
+		d2 = dd * dd;
+		phi[i] = ph1 - (nu * tn / r) * d2 *
+			(.5 - (1. + 3. * t) * d2 * C3);
+		lam[i] = dd * (1. + t * d2 *
+			(-C4 + (1. + 3. * t) * d2 * C5)) / cos(ph1);
+	}
+}
+	static void
+s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double phi0 = P->phi0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double dd = y[i] + phi0;
+		double xy_x = x[i];
+
+		phi[i] = asin(sin(dd) * cos(xy_x));
+		lam[i] = atan2(tan(xy_x), cos(dd));
+	}
+}
 FREEUP;
-	if (P) {
-		if (P->en)
-			pj_dalloc(P->en);
+	if (P)
 		pj_dalloc(P);
-	}
 }
 ENTRY1(cass, en)
 	if (P->es) {
-		if (!(P->en = pj_enfn(P->es))) E_ERROR_0;
+		if (!(P->en = pj_enfn_shared(P->es))) E_ERROR_0;
 		P->m0 = pj_mlfn(P->phi0, sin(P->phi0), cos(P->phi0), P->en);
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->inv_batch = e_inverse_batch;
+		P->fwd_batch = e_forward_batch;
 	} else {
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+		P->inv_batch = s_inverse_batch;
+		P->fwd_batch = s_forward_batch;
 	}
 ENDENTRY(P)
@@ -32,12 +32,67 @@ INVERSE(s_inverse); /* spheroid */
 	} else I_ERROR;
 	return (lp);
 }
+/* ellipsoidal batch kernels: pj_qsfn() inlined in the forward with the
+** constants hoisted, and the inverse runs the authalic series as one
+** fused pj_authlat_batch() pass over the latitudes */
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double k0 = P->k0, e = P->e, one_es = P->one_es;
+	double half_re = .5 / P->e;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double sinphi = sin(phi[i]);
+		double con = e * sinphi;
+
+		x[i] = k0 * lam[i];
+		y[i] = .5 * (one_es * (sinphi / (1. - con * con) -
+			half_re * log((1. - con) / (1. + con)))) / k0;
+	}
+}
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double k0 = P->k0, qp = P->qp;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		phi[i] = asin(2. * y[i] * k0 / qp);
+		lam[i] = x[i] / k0;
+	}
+	pj_authlat_batch(n, phi, P->apa, phi);
+}
+/* batch kernels for the spherical case: straight array loops of
+** sin/asin and a scale, which the compiler can vectorize; out of range
+** ordinates are flagged with HUGE_VAL instead of aborting the batch */
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double k0 = P->k0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		x[i] = k0 * lam[i];
+		y[i] = sin(phi[i]) / k0;
+	}
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double k0 = P->k0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double yi = y[i] * k0, t = fabs(yi);
+
+		if (t - EPS <= 1.) {
+			phi[i] = t >= 1. ? (yi < 0. ? -HALFPI : HALFPI)
+				: asin(yi);
+			lam[i] = x[i] / k0;
+		} else
+			lam[i] = phi[i] = HUGE_VAL;
+	}
+}
 FREEUP;
-	if (P) {
-		if (P->apa)
-			pj_dalloc(P->apa);
+	if (P)
 		pj_dalloc(P);
-	}
 }
 ENTRY1(cea, apa)
 	double t;
@@ -49,12 +104,16 @@ ENTRY1(cea, apa)
 		t = sin(t);
 		P->k0 /= sqrt(1. - P->es * t * t);
 		P->e = sqrt(P->es);
-		if (!(P->apa = pj_authset(P->es))) E_ERROR_0;
+		if (!(P->apa = pj_authset_shared(P->es))) E_ERROR_0;
 		P->qp = pj_qsfn(1., P->e, P->one_es);
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->fwd_batch = e_forward_batch;
+		P->inv_batch = e_inverse_batch;
 	} else {
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+		P->fwd_batch = s_forward_batch;
+		P->inv_batch = s_inverse_batch;
 	}
 ENDENTRY(P)
@@ -80,6 +80,141 @@ FORWARD(s_forward); /* spheroid */
 	}
 	return xy;
 }
+/* batch kernel.  The per point chain is restructured so intermediate
+** values carry across the three control point solves: sin/cos of the
+** point taken once feed all three delta longitudes through addition
+** formulas, the distances come from the haversine form (valid at all
+** distances, so the scalar path's branch disappears), the azimuth is
+** only ever consumed as the sign of adjlon(Az - base azimuth), which
+** equals the sign of sin(Az - base azimuth) and falls out of the
+** atan2 operands and the setup azimuth sin/cos without taking the
+** angle at all, and the law of cosines angle is consumed as its own
+** cos (the acos argument) and sin (one sqrt), folded through the
+** beta rotations by addition formulas.  That turns 3 atan2, 3 acos
+** and 8 trig calls per point into straight multiplies and square
+** roots; out of domain law of cosines arguments flag the lane with
+** HUGE_VAL, matching the errno the scalar path raises.  Everything
+** is branch light straight line code, so the compiler can vectorize
+** across points */
+#define ONE_TOL 1.00000000000001
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double c_phi[3], c_lam[3], c_cos[3], c_sin[3], c_cl[3], c_sl[3],
+		c_vr[3], c_vr2[3], c_cAz[3], c_sAz[3], c_px[3], c_py[3];
+	double cb1 = cos(P->beta_1), sb1 = sin(P->beta_1);
+	double cb2 = cos(P->beta_2), sb2 = sin(P->beta_2);
+	double p_x = P->p.x, p_y = P->p.y;
+	long k;
+	int i, j;
+
+	for (i = 0; i < 3; ++i) {
+		c_phi[i] = P->c[i].phi;
+		c_lam[i] = P->c[i].lam;
+		c_cos[i] = P->c[i].cosphi;
+		c_sin[i] = P->c[i].sinphi;
+		c_cl[i] = cos(P->c[i].lam);
+		c_sl[i] = sin(P->c[i].lam);
+		c_vr[i] = P->c[i].v.r;
+		c_vr2[i] = P->c[i].v.r * P->c[i].v.r;
+		c_cAz[i] = cos(P->c[i].v.Az);
+		c_sAz[i] = sin(P->c[i].v.Az);
+		c_px[i] = P->c[i].p.x;
+		c_py[i] = P->c[i].p.y;
+	}
+	for (k = 0; k < n; ++k) {
+		double sinphi, cosphi, sinlam, coslam, xv, yv;
+		double vr[3], r2[3];
+		int neg[3], bad = 0, hit = -1;
+
+		sinphi = sin(phi[k]);
+		cosphi = cos(phi[k]);
+		sinlam = sin(lam[k]);
+		coslam = cos(lam[k]);
+		for (i = 0; i < 3; ++i) { /* dist/azimiths from control */
+			double cdl = coslam * c_cl[i] + sinlam * c_sl[i];
+			double sdl = sinlam * c_cl[i] - coslam * c_sl[i];
+			double cdp = cosphi * c_cos[i] + sinphi * c_sin[i];
+			double h, r, ay, ax;
+
+			h = .5 * ((1. - cdp) +
+				c_cos[i] * cosphi * (1. - cdl));
+			if (h < 1e-12) { /* within metres of the control
+				** point the subtractions above bottom out
+				** at rounding noise; redo with the half
+				** angle form the scalar path uses, which
+				** is exact at the control point itself and
+				** lets it snap to its tabulated image */
+				double dp = sin(.5 * (phi[k] - c_phi[i]));
+				double dl = sin(.5 * (lam[k] - c_lam[i]));
+
+				h = dp * dp + c_cos[i] * cosphi * dl * dl;
+			}
+			r = 2. * aasin_quiet(sqrt(h));
+			if (r == HUGE_VAL) {
+				bad = 1;
+				break;
+			}
+			if (r <= TOL) { /* current point at control point */
+				hit = i;
+				break;
+			}
+			ay = cosphi * sdl;
+			ax = c_cos[i] * sinphi - c_sin[i] * cosphi * cdl;
+			neg[i] = ay * c_cAz[i] - ax * c_sAz[i] < 0.;
+			vr[i] = r;
+			r2[i] = r * r;
+		}
+		if (bad) {
+			x[k] = y[k] = HUGE_VAL;
+			continue;
+		}
+		if (hit >= 0) {
+			x[k] = c_px[hit];
+			y[k] = c_py[hit];
+			continue;
+		}
+		xv = p_x; /* point mean of intersepts */
+		yv = p_y;
+		for (i = 0; i < 3; ++i) {
+			double ca, sa, cr, sr;
+
+			j = i == 2 ? 0 : i + 1;
+			ca = .5 * (c_vr2[i] + r2[i] - r2[j]) /
+				(c_vr[i] * vr[i]);
+			if (fabs(ca) >= 1.) {
+				if (fabs(ca) > ONE_TOL) {
+					bad = 1;
+					break;
+				}
+				ca = ca < 0. ? -1. : 1.;
+				sa = 0.;
+			} else
+				sa = sqrt(1. - ca * ca);
+			if (neg[i]) /* a = -a */
+				sa = -sa;
+			if (! i) { /* coord comp unique to each arc */
+				xv += vr[i] * ca;
+				yv -= vr[i] * sa;
+			} else if (i == 1) { /* a = beta_1 - a */
+				cr = cb1 * ca + sb1 * sa;
+				sr = sb1 * ca - cb1 * sa;
+				xv -= vr[i] * cr;
+				yv -= vr[i] * sr;
+			} else { /* a = beta_2 - a */
+				cr = cb2 * ca + sb2 * sa;
+				sr = sb2 * ca - cb2 * sa;
+				xv += vr[i] * cr;
+				yv += vr[i] * sr;
+			}
+		}
+		if (bad) {
+			x[k] = y[k] = HUGE_VAL;
+			continue;
+		}
+		x[k] = xv * THIRD; /* mean of arc intercepts */
+		y[k] = yv * THIRD;
+	}
+}
 FREEUP; if (P) pj_dalloc(P); }
 ENTRY0(chamb)
 	int i, j;
@@ -109,4 +244,5 @@ ENTRY0(chamb)
 	P->c[0].p.x = - (P->c[1].p.x = 0.5 * P->c[0].v.r);
 	P->p.x = P->c[2].p.x = P->c[0].p.x + P->c[2].v.r * cos(P->beta_0);
 	P->es = 0.; P->fwd = s_forward;
+	P->fwd_batch = s_forward_batch;
 ENDENTRY(P)
@@ -0,0 +1,92 @@
+/* evaluate a precompiled Chebyshev/power series surrogate of a projection;
+** the surrogate file is fitted with mk_cheby() (e.g. proj -T ...,@file)
+** and covers a fixed region, trading generality for per-point cost far
+** below the trig-based kernels.  fname= names the forward (lam/phi ->
+** x/y meters) fit, ifname= the inverse fit; at least one is required
+** and both are resolved against the usual library search path. */
+#define PROJ_PARMS__ \
+	struct Tseries *fT; \
+	struct Tseries *iT; \
+	projUV flow, fupp; \
+	projUV ilow, iupp;
+#define PJ_LIB__
+#include <projects.h>
+#include <string.h>
+PROJ_HEAD(cheby, "Chebyshev series surrogate")
+	"\n\tMisc\n\tfname= and/or ifname=";
+FORWARD(s_forward); /* series evaluation */
+	projUV in, out;
+
+	in.u = lp.lam;
+	in.v = lp.phi;
+	/* the power basis carries no argument scaling to range check
+	** against, so check the fitted domain here for both bases */
+	if (in.u < P->flow.u || in.u > P->fupp.u ||
+		in.v < P->flow.v || in.v > P->fupp.v) F_ERROR;
+	out = biveval(in, P->fT);
+	if (out.u == HUGE_VAL) {
+		pj_ctx_set_errno(P->ctx, -36);
+		xy.x = xy.y = HUGE_VAL;
+		return (xy);
+	}
+	xy.x = out.u;
+	xy.y = out.v;
+	return (xy);
+}
+INVERSE(s_inverse); /* series evaluation */
+	projUV in, out;
+
+	in.u = xy.x;
+	in.v = xy.y;
+	if (in.u < P->ilow.u || in.u > P->iupp.u ||
+		in.v < P->ilow.v || in.v > P->iupp.v) I_ERROR;
+	out = biveval(in, P->iT);
+	if (out.u == HUGE_VAL) {
+		pj_ctx_set_errno(P->ctx, -36);
+		lp.lam = lp.phi = HUGE_VAL;
+		return (lp);
+	}
+	lp.lam = out.u;
+	lp.phi = out.v;
+	return (lp);
+}
+FREEUP;
+	if (P) {
+		if (P->fT)
+			pj_cheby_free(P->fT);
+		if (P->iT)
+			pj_cheby_free(P->iT);
+		pj_dalloc(P);
+	}
+}
+ENTRY0(cheby)
+	char *name;
+	int inv;
+	double lam0;
+	projUV resid;
+
+	P->fT = P->iT = 0;
+	if ((name = pj_param(P->ctx, P->params, "sfname").s) != NULL) {
+		if (!(P->fT = pj_cheby_load(P->ctx, name, &inv, &lam0,
+			&P->flow, &P->fupp, &resid)))
+			E_ERROR(-38);
+		if (inv) E_ERROR(-38); /* fitted the wrong direction */
+		P->fwd = s_forward;
+	}
+	if ((name = pj_param(P->ctx, P->params, "sifname").s) != NULL) {
+		if (!(P->iT = pj_cheby_load(P->ctx, name, &inv, &lam0,
+			&P->ilow, &P->iupp, &resid)))
+			E_ERROR(-38);
+		if (!inv) E_ERROR(-38);
+		P->inv = s_inverse;
+	}
+	if (!P->fT && !P->iT) E_ERROR(-38);
+	/* the fitted function is the full pj_fwd()/pj_inv() pipeline of
+	** the source projection - absolute longitude in, meters out - so
+	** neutralize the wrapper's own offsets and scaling */
+	P->lam0 = 0.;
+	P->x0 = P->y0 = 0.;
+	P->a = P->ra = 1.;
+	P->es = 0.;
+	P->over = 1;
+ENDENTRY(P)
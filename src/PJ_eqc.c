@@ -14,10 +14,52 @@ INVERSE(s_inverse); /* spheroid */
 	lp.phi = xy.y + P->phi0;
 	return (lp);
 }
+/* batch kernels: pure scale-and-shift, written as plain array loops so
+** the compiler can vectorize them */
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double rc = P->rc, phi0 = P->phi0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		x[i] = rc * lam[i];
+		y[i] = phi[i] - phi0;
+	}
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double rc = P->rc, phi0 = P->phi0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		lam[i] = x[i] / rc;
+		phi[i] = y[i] + phi0;
+	}
+}
+#ifdef PROJ_SPECULATIVE_DISPATCH
+	XY /* exported entries for the speculative dispatch in
+	** pj_fwd.c/pj_inv.c; registered below in place of the statics so
+	** the dispatch can compare and call them by name */
+pj_eqc_fwd_hot(LP lp, PJ *P) { return s_forward(lp, P); }
+	LP
+pj_eqc_inv_hot(XY xy, PJ *P) { return s_inverse(xy, P); }
+#endif
 FREEUP; if (P) pj_dalloc(P); }
 ENTRY0(eqc)
 	if ((P->rc = cos(pj_param(P->ctx, P->params, "rlat_ts").f)) <= 0.) E_ERROR(-24);
 	P->inv = s_inverse;
 	P->fwd = s_forward;
+#ifdef PROJ_SPECULATIVE_DISPATCH
+	P->inv = pj_eqc_inv_hot;
+	P->fwd = pj_eqc_fwd_hot;
+#endif
+	P->fwd_batch = s_forward_batch;
+	P->inv_batch = s_inverse_batch;
+	/* pure scale-and-shift: lets the batch layer fuse its scaffold
+	** passes around the kernel into one */
+	P->kernel_affine = 1;
+	P->aff_xs = P->rc;
+	P->aff_ys = 1.;
+	P->aff_yo = -P->phi0;
 	P->es = 0.;
 ENDENTRY(P)
@@ -46,7 +46,78 @@ SPECIAL(fac) {
 	fac->k = P->n * (P->c - (P->ellips ? pj_mlfn(lp.phi, sinphi,
 		cosphi, P->en) : lp.phi)) / pj_msfn(sinphi, cosphi, P->es);
 }
-FREEUP; if (P) { if (P->en) pj_dalloc(P->en); pj_dalloc(P); } }
+/* Batch variants: the P->rho scratch store of the scalar entries is
+** avoided, the ellipsoid/sphere decision is hoisted out of the loop,
+** and the ellipsoidal inverse goes through pj_inv_mlfn_batch(), whose
+** rectifying-latitude series needs no iteration at all for the
+** terrestrial ellipsoids (es <= .007) and at most 10 Newton rounds
+** otherwise, so per-point cost is constant.  Non-convergence is
+** flagged with HUGE_VAL.  In place safe. */
+	static void
+e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long npts, PJ *P) {
+	double nc = P->n, c = P->c, rho0 = P->rho0;
+	long i;
+
+	if (P->ellips) {
+		double en0 = P->en[0], en1 = P->en[1], en2 = P->en[2],
+			en3 = P->en[3], en4 = P->en[4];
+
+		for (i = 0; i < npts; ++i) {
+			double lp_phi = phi[i];
+			double sp = sin(lp_phi), cp = cos(lp_phi);
+			double ss = sp * sp;
+			double rho = c - (en0 * lp_phi - cp * sp * (en1
+				+ ss * (en2 + ss * (en3 + ss * en4))));
+			double lm = lam[i] * nc;
+
+			x[i] = rho * sin(lm);
+			y[i] = rho0 - rho * cos(lm);
+		}
+	} else
+		for (i = 0; i < npts; ++i) {
+			double rho = c - phi[i];
+			double lm = lam[i] * nc;
+
+			x[i] = rho * sin(lm);
+			y[i] = rho0 - rho * cos(lm);
+		}
+}
+	static void
+e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long npts, PJ *P) {
+	double nc = P->n, c = P->c, rho0 = P->rho0, es = P->es;
+	double *en = P->en;
+	int ellips = P->ellips;
+	long i;
+
+	for (i = 0; i < npts; ++i) {
+		double xy_x = x[i], xy_y = rho0 - y[i];
+		double rho = hypot(xy_x, xy_y);
+
+		if (rho != 0.0) {
+			double ph;
+
+			if (nc < 0.) {
+				rho = -rho;
+				xy_x = -xy_x;
+				xy_y = -xy_y;
+			}
+			ph = c - rho;
+			if (ellips &&
+			    (ph = pj_inv_mlfn_batch(ph, es, en)) == HUGE_VAL) {
+				lam[i] = phi[i] = HUGE_VAL;
+				continue;
+			}
+			phi[i] = ph;
+			lam[i] = atan2(xy_x, xy_y) / nc;
+		} else {
+			lam[i] = 0.;
+			phi[i] = nc > 0. ? HALFPI : - HALFPI;
+		}
+	}
+}
+FREEUP; if (P) pj_dalloc(P); }
 ENTRY1(eqdc, en)
 	double cosphi, sinphi;
 	int secant;
@@ -54,7 +125,7 @@ ENTRY1(eqdc, en)
 	P->phi1 = pj_param(P->ctx, P->params, "rlat_1").f;
 	P->phi2 = pj_param(P->ctx, P->params, "rlat_2").f;
 	if (fabs(P->phi1 + P->phi2) < EPS10) E_ERROR(-21);
-	if (!(P->en = pj_enfn(P->es)))
+	if (!(P->en = pj_enfn_shared(P->es)))
 		E_ERROR_0;
 	P->n = sinphi = sin(P->phi1);
 	cosphi = cos(P->phi1);
@@ -81,5 +152,7 @@ ENTRY1(eqdc, en)
 	}
 	P->inv = e_inverse;
 	P->fwd = e_forward;
+	P->inv_batch = e_inverse_batch;
+	P->fwd_batch = e_forward_batch;
 	P->spc = fac;
 ENDENTRY(P)
@@ -37,6 +37,10 @@ LIBPROJ_ID[] = "$Id$";
 	double  radius_g; \
 	double  radius_g_1; \
 	double  C; \
+	double  dom_lam; \
+	double  dom_phi; \
+	double  dom_x; \
+	double  dom_y; \
         char *  sweep_axis; \
         int     flip_axis;
 #define PJ_LIB__
@@ -157,7 +161,160 @@ INVERSE(e_inverse); /* ellipsoid */
 	lp.phi = atan (P->radius_p_inv2 * tan (lp.phi));
 	return (lp);
 }
-FREEUP; if (P) free(P); }
+/* Batch variants of the four kernels above: per point math identical,
+** with the view geometry constants hoisted out of the loops, failed
+** points flagged with HUGE_VAL and no ctx stores, so full disk imagery
+** streams through without per point error bookkeeping.  In place safe. */
+	static void
+s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double radius_g = P->radius_g, radius_g_1 = P->radius_g_1;
+	int flip_axis = P->flip_axis;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lp_lam = lam[i], lp_phi = phi[i];
+		double Vx, Vy, Vz, tmp;
+
+		tmp = cos(lp_phi);
+		Vx = cos(lp_lam) * tmp;
+		Vy = sin(lp_lam) * tmp;
+		Vz = sin(lp_phi);
+		if (((radius_g - Vx) * Vx - Vy * Vy - Vz * Vz) < 0.) {
+			x[i] = y[i] = HUGE_VAL;
+			continue;
+		}
+		tmp = radius_g - Vx;
+		if (flip_axis) {
+			x[i] = radius_g_1 * atan(Vy / hypot(Vz, tmp));
+			y[i] = radius_g_1 * atan(Vz / tmp);
+		} else {
+			x[i] = radius_g_1 * atan(Vy / tmp);
+			y[i] = radius_g_1 * atan(Vz / hypot(Vy, tmp));
+		}
+	}
+}
+	static void
+e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double radius_g = P->radius_g, radius_g_1 = P->radius_g_1;
+	double radius_p = P->radius_p, radius_p2 = P->radius_p2;
+	double radius_p_inv2 = P->radius_p_inv2;
+	int flip_axis = P->flip_axis;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lp_lam = lam[i], lp_phi = phi[i];
+		double r, Vx, Vy, Vz, tmp;
+
+		lp_phi = atan(radius_p2 * tan(lp_phi));
+		r = radius_p / hypot(radius_p * cos(lp_phi), sin(lp_phi));
+		Vx = r * cos(lp_lam) * cos(lp_phi);
+		Vy = r * sin(lp_lam) * cos(lp_phi);
+		Vz = r * sin(lp_phi);
+		if (((radius_g - Vx) * Vx - Vy * Vy
+				- Vz * Vz * radius_p_inv2) < 0.) {
+			x[i] = y[i] = HUGE_VAL;
+			continue;
+		}
+		tmp = radius_g - Vx;
+		if (flip_axis) {
+			x[i] = radius_g_1 * atan(Vy / hypot(Vz, tmp));
+			y[i] = radius_g_1 * atan(Vz / tmp);
+		} else {
+			x[i] = radius_g_1 * atan(Vy / tmp);
+			y[i] = radius_g_1 * atan(Vz / hypot(Vy, tmp));
+		}
+	}
+}
+	static void
+s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double radius_g = P->radius_g, C = P->C;
+	int flip_axis = P->flip_axis;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xy_x = x[i], xy_y = y[i];
+		double Vx, Vy, Vz, a, b, det, k;
+
+		Vx = -1.0;
+		if (flip_axis) {
+			Vz = tan(xy_y / (radius_g - 1.0));
+			Vy = tan(xy_x / (radius_g - 1.0)) * sqrt(1.0 + Vz * Vz);
+		} else {
+			Vy = tan(xy_x / (radius_g - 1.0));
+			Vz = tan(xy_y / (radius_g - 1.0)) * sqrt(1.0 + Vy * Vy);
+		}
+		a = Vy * Vy + Vz * Vz + Vx * Vx;
+		b = 2 * radius_g * Vx;
+		if ((det = (b * b) - 4 * a * C) < 0.) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		k = (-b - sqrt(det)) / (2 * a);
+		Vx = radius_g + k * Vx;
+		Vy *= k;
+		Vz *= k;
+		lam[i] = atan2(Vy, Vx);
+		phi[i] = atan(Vz * cos(lam[i]) / Vx);
+	}
+}
+	static void
+e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double radius_g = P->radius_g, radius_g_1 = P->radius_g_1;
+	double radius_p = P->radius_p, radius_p_inv2 = P->radius_p_inv2;
+	double C = P->C;
+	int flip_axis = P->flip_axis;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xy_x = x[i], xy_y = y[i];
+		double Vx, Vy, Vz, a, b, det, k;
+
+		Vx = -1.0;
+		if (flip_axis) {
+			Vz = tan(xy_y / radius_g_1);
+			Vy = tan(xy_x / radius_g_1) * hypot(1.0, Vz);
+		} else {
+			Vy = tan(xy_x / radius_g_1);
+			Vz = tan(xy_y / radius_g_1) * hypot(1.0, Vy);
+		}
+		a = Vz / radius_p;
+		a = Vy * Vy + a * a + Vx * Vx;
+		b = 2 * radius_g * Vx;
+		if ((det = (b * b) - 4 * a * C) < 0.) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		k = (-b - sqrt(det)) / (2. * a);
+		Vx = radius_g + k * Vx;
+		Vy *= k;
+		Vz *= k;
+		lam[i] = atan2(Vy, Vx);
+		phi[i] = atan(Vz * cos(lam[i]) / Vx);
+		phi[i] = atan(radius_p_inv2 * tan(phi[i]));
+	}
+}
+/* Conservative analytic bounds on the visible region for the batch
+** layer's pre-classification: a lat/lon (or scan angle) box enclosing
+** the earth disk, precomputed at setup.  Points outside it are off
+** earth for certain and get rejected for two compares; the box corners
+** that survive are still caught by the exact in-kernel tests.  The
+** derivation uses Vx >= r^2/radius_g (forward visibility with the
+** coordinate magnitudes bounded by r) and a <= radius_g^2/C (inverse
+** discriminant), both slackened to per axis limits.  Phrased so NaN
+** compares false and flows through to the kernels untouched. */
+	static int
+fwd_domain(LP lp, PJ *P) {
+	return !(fabs(lp.lam) > P->dom_lam || fabs(lp.phi) > P->dom_phi);
+}
+	static int
+inv_domain(XY xy, PJ *P) {
+	return !(fabs(xy.x) > P->dom_x || fabs(xy.y) > P->dom_y);
+}
+FREEUP; if (P) pj_dalloc(P); }
 ENTRY0(geos)
 	if ((P->h = pj_param(P->ctx, P->params, "dh").f) <= 0.) E_ERROR(-30);
 	if (P->phi0) E_ERROR(-46);
@@ -184,9 +341,19 @@ ENTRY0(geos)
 		P->radius_p_inv2 = P->rone_es;
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->inv_batch = e_inverse_batch;
+		P->fwd_batch = e_forward_batch;
 	} else {
 		P->radius_p = P->radius_p2 = P->radius_p_inv2 = 1.0;
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+		P->inv_batch = s_inverse_batch;
+		P->fwd_batch = s_forward_batch;
 	}
+	P->dom_lam = acos(P->radius_p / P->radius_g);
+	P->dom_phi = atan(tan(P->dom_lam) * P->radius_p_inv2);
+	P->dom_x = P->radius_g_1 * atan(sqrt(1.0 / P->C));
+	P->dom_y = P->radius_g_1 * atan(P->radius_p * sqrt(1.0 / P->C));
+	P->fwd_domain = fwd_domain;
+	P->inv_domain = inv_domain;
 ENDENTRY(P)
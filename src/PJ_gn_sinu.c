@@ -58,20 +58,146 @@ INVERSE(s_inverse); /* sphere */
 	lp.lam = xy.x / (P->C_x * (P->m + cos(xy.y)));
 	return (lp);
 }
-FREEUP; if (P) { if (P->en) pj_dalloc(P->en); pj_dalloc(P); } }
+/* batch kernels: straight line loops with the parameters hoisted to
+** locals, and the per latitude work (meridional distance, the Newton
+** loop of the general case) cached across runs of identical input -
+** raster scanlines feed constant phi rows forward and constant y rows
+** inverse, so most iterations reduce to a multiply.  Bad points are
+** flagged with HUGE_VAL instead of going through the ctx */
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double es = P->es, *en = P->en;
+	double last_ph = HUGE_VAL, last_y = 0., last_cf = 0.;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double ph = phi[i];
+
+		if (ph != last_ph) {
+			double s = sin(ph), c = cos(ph);
+
+			last_y = pj_mlfn(ph, s, c, en);
+			last_cf = c / sqrt(1. - es * s * s);
+			last_ph = ph;
+		}
+		x[i] = lam[i] * last_cf;
+		y[i] = last_y;
+	}
+}
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double es = P->es, *en = P->en;
+	double last_y = HUGE_VAL, last_ph = 0., last_rf = 0.;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double yi = y[i];
+
+		if (yi != last_y) {
+			double ph = pj_inv_mlfn_batch(yi, es, en), s;
+
+			last_y = yi;
+			if (ph == HUGE_VAL)
+				last_ph = HUGE_VAL;
+			else if ((s = fabs(ph)) < HALFPI) {
+				s = sin(ph);
+				last_ph = ph;
+				last_rf = sqrt(1. - es * s * s) / cos(ph);
+			} else if ((s - EPS10) < HALFPI) {
+				last_ph = ph;
+				last_rf = 0.;	/* lam = 0 at the pole */
+			} else
+				last_ph = HUGE_VAL;
+		}
+		if (last_ph == HUGE_VAL) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		phi[i] = last_ph;
+		lam[i] = x[i] * last_rf;
+	}
+}
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double m = P->m, nn = P->n, C_x = P->C_x, C_y = P->C_y;
+	double last_in = HUGE_VAL, last_ph = 0., last_k = 0.;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double ph = phi[i];
+
+		if (ph != last_in) {
+			last_in = ph;
+			if (!m)
+				ph = nn != 1. ? aasin_quiet(nn * sin(ph)) : ph;
+			else {
+				double k = nn * sin(ph), V;
+				int it;
+
+				for (it = MAX_ITER; it; --it) {
+					ph -= V = (m * ph + sin(ph) - k) /
+						(m + cos(ph));
+					if (fabs(V) < LOOP_TOL)
+						break;
+				}
+				if (!it)
+					ph = HUGE_VAL;
+			}
+			last_ph = ph;
+			if (ph != HUGE_VAL)
+				last_k = C_x * (m + cos(ph));
+		}
+		if (last_ph == HUGE_VAL) {
+			x[i] = y[i] = HUGE_VAL;
+			continue;
+		}
+		x[i] = last_k * lam[i];
+		y[i] = C_y * last_ph;
+	}
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double m = P->m, nn = P->n, C_x = P->C_x, C_y = P->C_y;
+	double last_y = HUGE_VAL, last_ph = 0., last_rk = 0.;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double yi = y[i];
+
+		if (yi != last_y) {
+			double t = yi / C_y;
+
+			last_y = yi;
+			last_ph = m ? aasin_quiet((m * t + sin(t)) / nn) :
+				( nn != 1. ? aasin_quiet(sin(t) / nn) : t );
+			last_rk = 1. / (C_x * (m + cos(t)));
+		}
+		if (last_ph == HUGE_VAL) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		phi[i] = last_ph;
+		lam[i] = x[i] * last_rk;
+	}
+}
+FREEUP; if (P) pj_dalloc(P); }
 	static void /* for spheres, only */
 setup(PJ *P) {
 	P->es = 0;
 	P->C_x = (P->C_y = sqrt((P->m + 1.) / P->n))/(P->m + 1.);
 	P->inv = s_inverse;
 	P->fwd = s_forward;
+	P->fwd_batch = s_forward_batch;
+	P->inv_batch = s_inverse_batch;
 }
 ENTRY1(sinu, en)
-	if (!(P->en = pj_enfn(P->es)))
+	if (!(P->en = pj_enfn_shared(P->es)))
 		E_ERROR_0;
 	if (P->es) {
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->fwd_batch = e_forward_batch;
+		P->inv_batch = e_inverse_batch;
 	} else {
 		P->n = 1.;
 		P->m = 0.;
@@ -26,6 +26,94 @@ INVERSE(s_inverse); /* spheroid */
 	}
 	return (lp);
 }
+/* batch kernels: consecutive points on the same side of the
+** sinusoidal/Mollweide seam are handed to the sub projection batch
+** kernels in one call (global rasters cross the seam twice per
+** scanline at most), with the Mollweide y correction applied over the
+** run.  The subs carry no lam0/x0/y0, so only the inverse Mollweide
+** side needs its corrected northings staged through a buffer */
+#define CHUNK 256
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	long i = 0;
+
+	while (i < n) {
+		int zs = fabs(phi[i]) <= PHI_LIM;
+		PJ *Q = zs ? P->sinu : P->moll;
+		long j = i + 1, k;
+
+		while (j < n && (fabs(phi[j]) <= PHI_LIM) == zs)
+			++j;
+		if (Q->fwd_batch)
+			Q->fwd_batch(lam + i, phi + i, x + i, y + i, j - i, Q);
+		else
+			for (k = i; k < j; ++k) {
+				LP lpk; XY xyk;
+
+				lpk.lam = lam[k];
+				lpk.phi = phi[k];
+				xyk = Q->fwd(lpk, Q);
+				x[k] = xyk.x;
+				y[k] = xyk.y;
+			}
+		if (!zs)
+			for (k = i; k < j; ++k)
+				y[k] -= phi[k] >= 0.0 ? Y_COR : -Y_COR;
+		i = j;
+	}
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	long i = 0;
+
+	while (i < n) {
+		int zs = fabs(y[i]) <= PHI_LIM;
+		long j = i + 1, m, k;
+
+		while (j < n && (j - i < CHUNK || zs)
+		       && (fabs(y[j]) <= PHI_LIM) == zs)
+			++j;
+		m = j - i;
+		if (zs) {
+			PJ *Q = P->sinu;
+
+			if (Q->inv_batch)
+				Q->inv_batch(x + i, y + i, lam + i, phi + i,
+					m, Q);
+			else
+				for (k = i; k < j; ++k) {
+					XY xyk; LP lpk;
+
+					xyk.x = x[k];
+					xyk.y = y[k];
+					lpk = Q->inv(xyk, Q);
+					lam[k] = lpk.lam;
+					phi[k] = lpk.phi;
+				}
+		} else {
+			PJ *Q = P->moll;
+			double ty[CHUNK];
+
+			for (k = 0; k < m; ++k)
+				ty[k] = y[i+k] +
+					(y[i+k] >= 0.0 ? Y_COR : -Y_COR);
+			if (Q->inv_batch)
+				Q->inv_batch(x + i, ty, lam + i, phi + i,
+					m, Q);
+			else
+				for (k = 0; k < m; ++k) {
+					XY xyk; LP lpk;
+
+					xyk.x = x[i+k];
+					xyk.y = ty[k];
+					lpk = Q->inv(xyk, Q);
+					lam[i+k] = lpk.lam;
+					phi[i+k] = lpk.phi;
+				}
+		}
+		i = j;
+	}
+}
 FREEUP;
 	if (P) {
 		if (P->sinu)
@@ -46,4 +134,6 @@ ENTRY2(goode, sinu, moll)
 		E_ERROR_0;
 	P->fwd = s_forward;
 	P->inv = s_inverse;
+	P->fwd_batch = s_forward_batch;
+	P->inv_batch = s_inverse_batch;
 ENDENTRY(P)
@@ -34,7 +34,9 @@
     int north_square; \
     int south_square; \
     double qp; \
-    double *apa;
+    double *apa; \
+    double caps_fwd[8][6]; \
+    double caps_inv[8][6];
 # define PJ_LIB__    
 # include	<projects.h>
 PROJ_HEAD(healpix, "HEALPix") "\n\tSph., Ellps.";
@@ -57,9 +59,6 @@ typedef struct {
     double x, y;  /* Coordinates of the pole point (point of most extreme latitude on the polar caps). */
     enum Region {north, south, equatorial} region;
 } CapMap;
-typedef struct {
-    double x, y;
-} Point;
 double rot[7][2][2] = ROT;
 
 /**
@@ -93,97 +92,48 @@ static int get_rotate_index(int index) {
     }
     return 0;
 }
-/**
- * Return 1 if point (testx, testy) lies in the interior of the polygon 
- * determined by the vertices in vert, and return 0 otherwise.
- * See http://paulbourke.net/geometry/polygonmesh/ for more details.
- * @param nvert the number of vertices in the polygon.
- * @param vert the (x, y)-coordinates of the polygon's vertices
- **/
-static int pnpoly(int nvert, double vert[][2], double testx, double testy) {
-    int i, c = 0;
-    int counter = 0;
-    double xinters;
-    Point p1, p2;
-    /* Check for boundrary cases */
-    for (i = 0; i < nvert; i++) {
-        if (testx == vert[i][0] && testy == vert[i][1]) {
-            return 1;
-        }
-    }
-    p1.x = vert[0][0];
-    p1.y = vert[0][1];
-    for (i = 1; i < nvert; i++) {
-        p2.x = vert[i % nvert][0];
-        p2.y = vert[i % nvert][1];
-        if (testy > MIN(p1.y, p2.y)) {
-            if (testy <= MAX(p1.y, p2.y)) {
-                if (testx <= MAX(p1.x, p2.x)) {
-                    if (p1.y != p2.y) {
-                        xinters = (testy-p1.y)*(p2.x-p1.x)/(p2.y-p1.y)+p1.x;
-                        if (p1.x == p2.x || testx <= xinters) {
-                            counter++;
-                        }
-                    }
-                }
-            }
-        }
-        p1 = p2;
-    }
-    if (counter % 2 == 0) {
-        return 0;
-    } else {
-        return 1;
-    }
-    return c;
-}
 /**
  * Return 1 if (x, y) lies in (the interior or boundary of) the image of the
- * HEALPix projection (in case proj=0) or in the image the rHEALPix projection 
+ * HEALPix projection (in case proj=0) or in the image the rHEALPix projection
  * (in case proj=1), and return 0 otherwise.
- * @param north_square the position of the north polar square (rHEALPix only)       
- * @param south_square the position of the south polar square (rHEALPix only)  
+ * The facet layout is fixed, so the test is a constant-time region
+ * decision (band, polar triangle or polar square) with the same EPS fuzz
+ * on the boundaries as the point-in-polygon walk it replaces.
+ * @param north_square the position of the north polar square (rHEALPix only)
+ * @param south_square the position of the south polar square (rHEALPix only)
  **/
 int in_image(double x, double y, int proj, int north_square, int south_square) {
     if (proj == 0) {
-    	double healpixVertsJit[][2] = {
-    	    {-1.0*PI- EPS, PI/4.0},
-    	    {-3.0*PI/4.0, PI/2.0 + EPS},
-    	    {-1.0*PI/2.0, PI/4.0 + EPS},
-    	    {-1.0*PI/4.0, PI/2.0 + EPS},
-    	    {0.0, PI/4.0 + EPS},
-    	    {PI/4.0, PI/2.0 + EPS},
-    	    {PI/2.0, PI/4.0 + EPS},
-    	    {3.0*PI/4.0, PI/2.0 + EPS},
-    	    {PI+ EPS, PI/4.0},
-    	    {PI+ EPS, -1.0*PI/4.0},
-    	    {3.0*PI/4.0, -1.0*PI/2.0 - EPS},
-    	    {PI/2.0, -1.0*PI/4.0 - EPS},
-    	    {PI/4.0, -1.0*PI/2.0 - EPS},
-    	    {0.0, -1.0*PI/4.0 - EPS},
-    	    {-1.0*PI/4.0, -1.0*PI/2.0 - EPS},
-    	    {-1.0*PI/2.0, -1.0*PI/4.0 - EPS},
-    	    {-3.0*PI/4.0, -1.0*PI/2.0 - EPS},
-    	    {-1.0*PI - EPS, -1.0*PI/4.0}
-    	};
-    	return pnpoly((int)sizeof(healpixVertsJit)/
-    	              sizeof(healpixVertsJit[0]), healpixVertsJit, x, y);
+        double cn, xc;
+        if (fabs(x) > PI + EPS || fabs(y) > PI/2.0 + EPS) {
+            return 0;
+        }
+        /* equatorial band */
+        if (fabs(y) <= PI/4.0 + EPS) {
+            return 1;
+        }
+        /* polar triangle of the cap x lies under */
+        cn = floor(2.0*x/PI + 2.0);
+        if (cn >= 4) {
+            cn = 3;
+        }
+        xc = -3.0*PI/4.0 + (PI/2.0)*cn;
+        return fabs(x - xc) <= PI/2.0 - fabs(y) + EPS;
     } else {
-    	double rhealpixVertsJit[][2] = {
-    	    {-1.0*PI - EPS, PI/4.0 + EPS},
-    	    {-1.0*PI + north_square*PI/2.0- EPS, PI/4.0 + EPS},
-    	    {-1.0*PI + north_square*PI/2.0- EPS, 3*PI/4.0 + EPS},
-    	    {-1.0*PI + (north_square + 1.0)*PI/2.0 + EPS, 3*PI/4.0 + EPS},
-    	    {-1.0*PI + (north_square + 1.0)*PI/2.0 + EPS, PI/4.0 + EPS},
-    	    {PI + EPS, PI/4.0 + EPS},
-    	    {PI + EPS, -1.0*PI/4.0 - EPS},
-    	    {-1.0*PI + (south_square + 1.0)*PI/2.0 + EPS, -1.0*PI/4.0 - EPS},
-    	    {-1.0*PI + (south_square + 1.0)*PI/2.0 + EPS, -3.0*PI/4.0 - EPS},
-    	    {-1.0*PI + south_square*PI/2.0 - EPS, -3.0*PI/4.0 - EPS},
-    	    {-1.0*PI + south_square*PI/2.0 - EPS, -1.0*PI/4.0 - EPS},
-    	    {-1.0*PI - EPS, -1.0*PI/4.0 - EPS}};
-    	return pnpoly((int)sizeof(rhealpixVertsJit)/
-    	              sizeof(rhealpixVertsJit[0]), rhealpixVertsJit, x, y);
+        if (fabs(x) > PI + EPS || fabs(y) > 3.0*PI/4.0 + EPS) {
+            return 0;
+        }
+        /* equatorial band */
+        if (fabs(y) <= PI/4.0 + EPS) {
+            return 1;
+        }
+        /* polar square in position north_square or south_square */
+        if (y > 0) {
+            return x >= -1.0*PI + north_square*PI/2.0 - EPS &&
+                   x <= -1.0*PI + (north_square + 1.0)*PI/2.0 + EPS;
+        }
+        return x >= -1.0*PI + south_square*PI/2.0 - EPS &&
+               x <= -1.0*PI + (south_square + 1.0)*PI/2.0 + EPS;
     }
 }
 /**
@@ -261,26 +211,6 @@ LP healpix_sphere_inverse(XY xy) {
     }
     return (lp);
 }
-/**
- * Return the vector sum a + b, where a and b are 2-dimensional vectors.
- * @param ret holds a + b.
- **/
-static void vector_add(double a[2], double b[2], double *ret) {
-    int i;
-    for(i = 0; i < 2; i++) {
-	    ret[i] = a[i] + b[i];
-    }
-}
-/**
- * Return the vector difference a - b, where a and b are 2-dimensional vectors.
- * @param ret holds a - b.
- **/
-static void vector_sub(double a[2], double b[2], double*ret) {
-    int i;
-    for(i = 0; i < 2; i++) { 
-	    ret[i] = a[i] - b[i];
-    }
-}
 /**
  * Return the 2 x 1 matrix product a*b, where a is a 2 x 2 matrix and 
  * b is a 2 x 1 matrix.
@@ -386,84 +316,73 @@ static CapMap get_cap(double x, double y, int north_square, int south_square,
     }
 }
 /**
- * Rearrange point (x, y) in the HEALPix projection by 
+ * Precompute the per-cap affine transforms applied by combine_caps().
+ * Each cap reassembly is a rotation by a multiple of pi/2 about a fixed
+ * point followed by a translation onto the polar square; both fold into
+ * a single r*v + t form, computed here once since the facet layout is
+ * fixed by north_square/south_square at setup time.
+ **/
+static void setup_caps(PJ *P) {
+    int inverse, region, cn;
+    for (inverse = 0; inverse < 2; inverse++) {
+        for (region = 0; region < 2; region++) {
+            int pole = region == 0 ? P->north_square : P->south_square;
+            double cy = region == 0 ? PI/2.0 : -1.0*PI/2.0;
+            for (cn = 0; cn < 4; cn++) {
+                double *m = (inverse ? P->caps_inv : P->caps_fwd)
+                            [4*region + cn];
+                double c[2], a[2], rc[2];
+                double (*tmpRot)[2];
+                c[1] = a[1] = cy;
+                if (inverse == 0) {
+                    /* rotate the cap about its tip, then translate it
+                       to the polar square */
+                    c[0] = -3.0*PI/4.0 + cn*PI/2.0;
+                    a[0] = -3.0*PI/4.0 + pole*PI/2.0;
+                    tmpRot = rot[get_rotate_index(region == 0 ?
+                        cn - pole : -1*(cn - pole))];
+                } else {
+                    /* unrotate about the polar square tip, then
+                       translate the cap back into place */
+                    c[0] = -3.0*PI/4.0 + pole*PI/2.0;
+                    a[0] = -3.0*PI/4.0 + cn*PI/2.0;
+                    tmpRot = rot[get_rotate_index(region == 0 ?
+                        -1*(cn - pole) : cn - pole)];
+                }
+                dot_product(tmpRot, c, rc);
+                m[0] = tmpRot[0][0];
+                m[1] = tmpRot[0][1];
+                m[2] = tmpRot[1][0];
+                m[3] = tmpRot[1][1];
+                m[4] = a[0] - rc[0];
+                m[5] = a[1] - rc[1];
+            }
+        }
+    }
+}
+/**
+ * Rearrange point (x, y) in the HEALPix projection by
  * combining the polar caps into two polar squares.
- * Put the north polar square in position north_square and 
+ * Put the north polar square in position north_square and
  * the south polar square in position south_square.
  * If inverse=1, then uncombine the polar caps.
- * @param north_square integer between 0 and 3.
- * @param south_square integer between 0 and 3.
+ * The rotation and translation for each cap come from the affine table
+ * built by setup_caps(), so only the cap decision is left per point.
  **/
-static XY combine_caps(double x, double y, int north_square, int south_square,
-                       int inverse) {
+static XY combine_caps(double x, double y, PJ *P, int inverse) {
     XY xy;
-    double v[2];
-    double a[2];
-    double vector[2];
-    double v_min_c[2];
-    double ret_dot[2];
-    CapMap capmap = get_cap(x, y, north_square, south_square, inverse);
+    const double *m;
+    CapMap capmap = get_cap(x, y, P->north_square, P->south_square, inverse);
     if (capmap.region == equatorial) {
 	    xy.x = capmap.x;
 	    xy.y = capmap.y;
 	    return xy;
     }
-    v[0] = x;
-    v[1] = y;
-    if (inverse == 0) {
-        /* Rotate (x, y) about its polar cap tip and then translate it to  
-           north_square or south_square. */
-    	int pole = 0;
-    	double (*tmpRot)[2];
-    	double c[2] = {capmap.x, capmap.y};
-    	if (capmap.region == north) {
-    	    pole = north_square;
-    	    a[0] =  (-3.0*PI/4.0 + pole*PI/2);
-    	    a[1] =  (PI/2.0 + pole*0);
-    	    tmpRot = rot[get_rotate_index(capmap.cn - pole)];
-    	    vector_sub(v, c, v_min_c);	
-    	    dot_product(tmpRot, v_min_c, ret_dot);
-    	    vector_add(ret_dot, a, vector);
-    	} else {
-    	    pole = south_square;
-    	    a[0] =  (-3.0*PI/4.0 + pole*PI/2);
-    	    a[1] =  (PI/-2.0 + pole*0);
-    	    tmpRot = rot[get_rotate_index(-1*(capmap.cn - pole))];
-    	    vector_sub(v, c, v_min_c);	
-    	    dot_product(tmpRot, v_min_c, ret_dot);
-    	    vector_add(ret_dot, a, vector);
-    	}
-    	xy.x = vector[0];
-    	xy.y = vector[1];
-    	return xy;
-    } else {
-        /* Inverse function.
-         Unrotate (x, y) and then translate it back. */
-    	int pole = 0;
-    	double (*tmpRot)[2];
-    	double c[2] = {capmap.x, capmap.y};
-    	/* disassemble */
-    	if (capmap.region == north) {
-    	    pole = north_square;
-    	    a[0] =  (-3.0*PI/4.0 + capmap.cn*PI/2);
-    	    a[1] =  (PI/2.0 + capmap.cn*0);
-    	    tmpRot = rot[get_rotate_index(-1*(capmap.cn - pole))];
-    	    vector_sub(v, c, v_min_c);	
-    	    dot_product(tmpRot, v_min_c, ret_dot);
-    	    vector_add(ret_dot, a, vector);
-    	} else {
-    	    pole = south_square;
-    	    a[0] =  (-3.0*PI/4.0 + capmap.cn*PI/2);
-    	    a[1] =  (PI/-2.0 + capmap.cn*0);
-    	    tmpRot = rot[get_rotate_index(capmap.cn - pole)];
-    	    vector_sub(v, c, v_min_c);	
-    	    dot_product(tmpRot, v_min_c, ret_dot);
-    	    vector_add(ret_dot, a, vector);
-    	}
-    	xy.x = vector[0];
-    	xy.y = vector[1];
-    	return xy;
-    }
+    m = (inverse ? P->caps_inv : P->caps_fwd)
+        [(capmap.region == north ? 0 : 4) + capmap.cn];
+    xy.x = m[0]*x + m[1]*y + m[4];
+    xy.y = m[2]*x + m[3]*y + m[5];
+    return xy;
 }
 FORWARD(s_healpix_forward); /* sphere  */
     (void) xy;
@@ -498,12 +417,12 @@ INVERSE(e_healpix_inverse); /* ellipsoid */
 }
 FORWARD(s_rhealpix_forward); /* sphere */
     xy = healpix_sphere(lp);
-    return combine_caps(xy.x, xy.y, P->north_square, P->south_square, 0);
+    return combine_caps(xy.x, xy.y, P, 0);
 }
 FORWARD(e_rhealpix_forward); /* ellipsoid */
     lp.phi = auth_lat(P, lp.phi, 0);
     xy = healpix_sphere(lp);
-    return combine_caps(xy.x, xy.y, P->north_square, P->south_square, 0);
+    return combine_caps(xy.x, xy.y, P, 0);
 }
 INVERSE(s_rhealpix_inverse); /* sphere */
     /* Check whether (x, y) lies in the rHEALPix image. */
@@ -513,7 +432,7 @@ INVERSE(s_rhealpix_inverse); /* sphere */
 	    pj_ctx_set_errno(P->ctx, -15);
 	    return lp;
     }
-    xy = combine_caps(xy.x, xy.y, P->north_square, P->south_square, 1);
+    xy = combine_caps(xy.x, xy.y, P, 1);
     return healpix_sphere_inverse(xy);
 }
 INVERSE(e_rhealpix_inverse); /* ellipsoid */
@@ -524,21 +443,113 @@ INVERSE(e_rhealpix_inverse); /* ellipsoid */
 	    pj_ctx_set_errno(P->ctx, -15);
 	    return lp;
     }
-    xy = combine_caps(xy.x, xy.y, P->north_square, P->south_square, 1);
+    xy = combine_caps(xy.x, xy.y, P, 1);
     lp = healpix_sphere_inverse(xy);
     lp.phi = auth_lat(P, lp.phi, 1);
     return lp;
 }
+/* batch kernels: the facet decisions above are all constant time now,
+** so the loops just hoist the ellipsoid handling and skip the per-point
+** entry overhead; points outside the image are flagged with HUGE_VAL.
+** One kernel per direction covers sphere and ellipsoid -- the hoisted
+** flag makes the branch perfectly predicted. */
+static void healpix_fwd_batch(const double *lam, const double *phi,
+    double *x, double *y, long n, PJ *P) {
+    int ell = P->es != 0.;
+    double e = P->e, one_es = P->one_es, qp = P->qp;
+    long i;
+    for (i = 0; i < n; ++i) {
+        LP lp;
+        XY xy;
+        lp.lam = lam[i];
+        lp.phi = phi[i];
+        if (ell) {
+            double ratio = pj_qsfn(sin(lp.phi), e, one_es)/qp;
+            if (fabs(ratio) > 1) {
+                ratio = pj_sign(ratio);
+            }
+            lp.phi = asin(ratio);
+        }
+        xy = healpix_sphere(lp);
+        x[i] = xy.x;
+        y[i] = xy.y;
+    }
+}
+static void healpix_inv_batch(const double *x, const double *y,
+    double *lam, double *phi, long n, PJ *P) {
+    int ell = P->es != 0.;
+    long i;
+    for (i = 0; i < n; ++i) {
+        XY xy;
+        LP lp;
+        xy.x = x[i];
+        xy.y = y[i];
+        if (in_image(xy.x, xy.y, 0, 0, 0) == 0) {
+            lam[i] = phi[i] = HUGE_VAL;
+            continue;
+        }
+        lp = healpix_sphere_inverse(xy);
+        lam[i] = lp.lam;
+        phi[i] = lp.phi;
+    }
+    /* authalic to geodetic as one fused array pass (see pj_auth.c);
+    ** the HUGE_VAL lanes flagged above ride through untouched */
+    if (ell)
+        pj_authlat_batch(n, phi, P->apa, phi);
+}
+static void rhealpix_fwd_batch(const double *lam, const double *phi,
+    double *x, double *y, long n, PJ *P) {
+    int ell = P->es != 0.;
+    double e = P->e, one_es = P->one_es, qp = P->qp;
+    long i;
+    for (i = 0; i < n; ++i) {
+        LP lp;
+        XY xy;
+        lp.lam = lam[i];
+        lp.phi = phi[i];
+        if (ell) {
+            double ratio = pj_qsfn(sin(lp.phi), e, one_es)/qp;
+            if (fabs(ratio) > 1) {
+                ratio = pj_sign(ratio);
+            }
+            lp.phi = asin(ratio);
+        }
+        xy = healpix_sphere(lp);
+        xy = combine_caps(xy.x, xy.y, P, 0);
+        x[i] = xy.x;
+        y[i] = xy.y;
+    }
+}
+static void rhealpix_inv_batch(const double *x, const double *y,
+    double *lam, double *phi, long n, PJ *P) {
+    int ell = P->es != 0.;
+    long i;
+    for (i = 0; i < n; ++i) {
+        XY xy;
+        LP lp;
+        xy.x = x[i];
+        xy.y = y[i];
+        if (in_image(xy.x, xy.y, 1, P->north_square, P->south_square) == 0) {
+            lam[i] = phi[i] = HUGE_VAL;
+            continue;
+        }
+        xy = combine_caps(xy.x, xy.y, P, 1);
+        lp = healpix_sphere_inverse(xy);
+        lam[i] = lp.lam;
+        phi[i] = lp.phi;
+    }
+    /* authalic to geodetic as one fused array pass (see pj_auth.c);
+    ** the HUGE_VAL lanes flagged above ride through untouched */
+    if (ell)
+        pj_authlat_batch(n, phi, P->apa, phi);
+}
 FREEUP;
-	if (P) {
-		if (P->apa)
-			pj_dalloc(P->apa);
+	if (P)
 		pj_dalloc(P);
-	}
 }
 ENTRY1(healpix, apa)
     if (P->es) {
-        P->apa = pj_authset(P->es); /* For auth_lat(). */
+        P->apa = pj_authset_shared(P->es); /* For auth_lat(). */
         P->qp = pj_qsfn(1.0, P->e, P->one_es); /* For auth_lat(). */
     	P->a = P->a*sqrt(0.5*P->qp); /* Set P->a to authalic radius. */
         P->ra = 1.0/P->a;
@@ -548,6 +559,8 @@ ENTRY1(healpix, apa)
     	P->fwd = s_healpix_forward;
     	P->inv = s_healpix_inverse; 
     }
+    P->fwd_batch = healpix_fwd_batch;
+    P->inv_batch = healpix_inv_batch;
 ENDENTRY(P)
 ENTRY1(rhealpix, apa)
     P->north_square = pj_param(P->ctx, P->params,"inorth_square").i;
@@ -560,7 +573,7 @@ ENTRY1(rhealpix, apa)
 	    E_ERROR(-47);
     }
     if (P->es) {
-        P->apa = pj_authset(P->es); /* For auth_lat(). */
+        P->apa = pj_authset_shared(P->es); /* For auth_lat(). */
         P->qp = pj_qsfn(1.0, P->e, P->one_es); /* For auth_lat(). */
 	    P->a = P->a*sqrt(0.5*P->qp); /* Set P->a to authalic radius. */
         P->ra = 1.0/P->a;
@@ -570,4 +583,7 @@ ENTRY1(rhealpix, apa)
 	    P->fwd = s_rhealpix_forward;
 	    P->inv = s_rhealpix_inverse; 
     }
+    setup_caps(P);
+    P->fwd_batch = rhealpix_fwd_batch;
+    P->inv_batch = rhealpix_inv_batch;
 ENDENTRY(P)
@@ -24,26 +24,33 @@ static const double d180 = 180 * DEG_TO_RAD;
 
 static const double EPSLN = 1.e-10; // allow a little 'slack' on zone edge positions
 
-FORWARD(s_forward); /* spheroid */
+/* which lobe is this lat/long in?  1..12, see the diagram in the entry */
+static int igh_fwd_zone(double lam, double phi)
+{
         int z;
-        if (lp.phi >=  d4044118) {          // 1|2
-          z = (lp.lam <= -d40 ? 1: 2);
+        if (phi >=  d4044118) {             // 1|2
+          z = (lam <= -d40 ? 1: 2);
         }
-        else if (lp.phi >=  0) {            // 3|4
-          z = (lp.lam <= -d40 ? 3: 4);
+        else if (phi >=  0) {               // 3|4
+          z = (lam <= -d40 ? 3: 4);
         }
-        else if (lp.phi >= -d4044118) {     // 5|6|7|8
-               if (lp.lam <= -d100) z =  5; // 5
-          else if (lp.lam <=  -d20) z =  6; // 6
-          else if (lp.lam <=   d80) z =  7; // 7
+        else if (phi >= -d4044118) {        // 5|6|7|8
+               if (lam <= -d100) z =  5;    // 5
+          else if (lam <=  -d20) z =  6;    // 6
+          else if (lam <=   d80) z =  7;    // 7
           else z = 8;                       // 8
         }
         else {                              // 9|10|11|12
-               if (lp.lam <= -d100) z =  9; // 9
-          else if (lp.lam <=  -d20) z = 10; // 10
-          else if (lp.lam <=   d80) z = 11; // 11
+               if (lam <= -d100) z =  9;    // 9
+          else if (lam <=  -d20) z = 10;    // 10
+          else if (lam <=   d80) z = 11;    // 11
           else z = 12;                      // 12
         }
+        return z;
+}
+
+FORWARD(s_forward); /* spheroid */
+        int z = igh_fwd_zone(lp.lam, lp.phi);
 
         lp.lam -= P->pj[z-1]->lam0;
         xy = P->pj[z-1]->fwd(lp, P->pj[z-1]);
@@ -52,38 +59,36 @@ FORWARD(s_forward); /* spheroid */
 
         return (xy);
 }
-INVERSE(s_inverse); /* spheroid */
-        const double y90 = P->dy0 + sqrt(2); // lt=90 corresponds to y=y0+sqrt(2)
-
-        int z = 0;
-        if (xy.y > y90+EPSLN || xy.y < -y90+EPSLN) // 0
+/* which lobe does this projected position fall in?  0 when off the map */
+static int igh_inv_zone(double x, double y, double y90)
+{
+        int z;
+        if (y > y90+EPSLN || y < -y90+EPSLN) // 0
           z = 0;
-        else if (xy.y >=  d4044118)       // 1|2
-          z = (xy.x <= -d40? 1: 2);
-        else if (xy.y >=  0)              // 3|4
-          z = (xy.x <= -d40? 3: 4);
-        else if (xy.y >= -d4044118) {     // 5|6|7|8
-               if (xy.x <= -d100) z =  5; // 5
-          else if (xy.x <=  -d20) z =  6; // 6
-          else if (xy.x <=   d80) z =  7; // 7
+        else if (y >=  d4044118)          // 1|2
+          z = (x <= -d40? 1: 2);
+        else if (y >=  0)                 // 3|4
+          z = (x <= -d40? 3: 4);
+        else if (y >= -d4044118) {        // 5|6|7|8
+               if (x <= -d100) z =  5;    // 5
+          else if (x <=  -d20) z =  6;    // 6
+          else if (x <=   d80) z =  7;    // 7
           else z = 8;                     // 8
         }
         else {                            // 9|10|11|12
-               if (xy.x <= -d100) z =  9; // 9
-          else if (xy.x <=  -d20) z = 10; // 10
-          else if (xy.x <=   d80) z = 11; // 11
+               if (x <= -d100) z =  9;    // 9
+          else if (x <=  -d20) z = 10;    // 10
+          else if (x <=   d80) z = 11;    // 11
           else z = 12;                    // 12
         }
+        return z;
+}
 
-        if (z)
-        {
+/* does the unprojected position really belong to zone z? */
+static int igh_ok(int z, LP lp)
+{
           int ok = 0;
 
-          xy.x -= P->pj[z-1]->x0;
-          xy.y -= P->pj[z-1]->y0;
-          lp = P->pj[z-1]->inv(xy, P->pj[z-1]);
-          lp.lam += P->pj[z-1]->lam0;
-
           switch (z) {
             case  1: ok = (lp.lam >= -d180-EPSLN && lp.lam <=  -d40+EPSLN) ||
                          ((lp.lam >=  -d40-EPSLN && lp.lam <=  -d10+EPSLN) &&
@@ -105,13 +110,126 @@ INVERSE(s_inverse); /* spheroid */
             case 12: ok = (lp.lam >=   d80-EPSLN && lp.lam <=  d180+EPSLN); break;
           }
 
-          z = (!ok? 0: z); // projectable?
+          return ok;
+}
+
+INVERSE(s_inverse); /* spheroid */
+        const double y90 = P->dy0 + sqrt(2); // lt=90 corresponds to y=y0+sqrt(2)
+
+        int z = igh_inv_zone(xy.x, xy.y, y90);
+
+        if (z)
+        {
+          xy.x -= P->pj[z-1]->x0;
+          xy.y -= P->pj[z-1]->y0;
+          lp = P->pj[z-1]->inv(xy, P->pj[z-1]);
+          lp.lam += P->pj[z-1]->lam0;
+
+          z = (!igh_ok(z, lp)? 0: z); // projectable?
         }
      // if (!z) pj_errno = -15; // invalid x or y
         if (!z) lp.lam = HUGE_VAL;
         if (!z) lp.phi = HUGE_VAL;
         return (lp);
 }
+
+/* batch kernels: points are grouped into runs of consecutive inputs
+** falling in the same lobe (global rasters cross lobe boundaries only
+** a few times per scanline), so the sub-projection is dispatched once
+** per run instead of once per point, and Mollweide lobes go through
+** the table driven moll batch kernel.  Runs are staged through a small
+** stack buffer to apply the per lobe lam0/x0/y0 offsets */
+#define CHUNK 256
+static void s_forward_batch(const double *lam, const double *phi,
+        double *x, double *y, long n, PJ *P) {
+        long i = 0;
+
+        while (i < n) {
+                int z = igh_fwd_zone(lam[i], phi[i]);
+                PJ *Q = P->pj[z-1];
+                double tl[CHUNK];
+                long j = i + 1, m, k;
+
+                while (j < n && j - i < CHUNK
+                       && igh_fwd_zone(lam[j], phi[j]) == z)
+                        j++;
+                m = j - i;
+                for (k = 0; k < m; k++)
+                        tl[k] = lam[i+k] - Q->lam0;
+                if (Q->fwd_batch)
+                        Q->fwd_batch(tl, phi + i, x + i, y + i, m, Q);
+                else
+                        for (k = 0; k < m; k++) {
+                                LP lpk; XY xyk;
+
+                                lpk.lam = tl[k];
+                                lpk.phi = phi[i+k];
+                                xyk = Q->fwd(lpk, Q);
+                                x[i+k] = xyk.x;
+                                y[i+k] = xyk.y;
+                        }
+                for (k = 0; k < m; k++) {
+                        x[i+k] += Q->x0;
+                        y[i+k] += Q->y0;
+                }
+                i = j;
+        }
+}
+static void s_inverse_batch(const double *x, const double *y,
+        double *lam, double *phi, long n, PJ *P) {
+        const double y90 = P->dy0 + sqrt(2);
+        long i = 0;
+
+        while (i < n) {
+                int z = igh_inv_zone(x[i], y[i], y90);
+                double tx[CHUNK], ty[CHUNK];
+                long j = i + 1, m, k;
+                PJ *Q;
+
+                while (j < n && j - i < CHUNK
+                       && igh_inv_zone(x[j], y[j], y90) == z)
+                        j++;
+                m = j - i;
+                if (z == 0) { // off the map
+                        for (k = 0; k < m; k++)
+                                lam[i+k] = phi[i+k] = HUGE_VAL;
+                        i = j;
+                        continue;
+                }
+                Q = P->pj[z-1];
+                for (k = 0; k < m; k++) {
+                        tx[k] = x[i+k] - Q->x0;
+                        ty[k] = y[i+k] - Q->y0;
+                }
+                if (Q->inv_batch)
+                        Q->inv_batch(tx, ty, lam + i, phi + i, m, Q);
+                else
+                        for (k = 0; k < m; k++) {
+                                XY xyk; LP lpk;
+
+                                xyk.x = tx[k];
+                                xyk.y = ty[k];
+                                lpk = Q->inv(xyk, Q);
+                                lam[i+k] = lpk.lam;
+                                phi[i+k] = lpk.phi;
+                        }
+                for (k = 0; k < m; k++) {
+                        LP lpk;
+
+                        if (lam[i+k] == HUGE_VAL) {
+                                phi[i+k] = HUGE_VAL;
+                                continue;
+                        }
+                        lpk.lam = lam[i+k] + Q->lam0;
+                        lpk.phi = phi[i+k];
+                        if (igh_ok(z, lpk))
+                                lam[i+k] = lpk.lam;
+                        else
+                                lam[i+k] = phi[i+k] = HUGE_VAL;
+                }
+                i = j;
+        }
+}
 FREEUP;
         if (P) {
                 int i;
@@ -183,6 +301,8 @@ ENTRY0(igh)
 
         P->inv = s_inverse;
         P->fwd = s_forward;
+        P->inv_batch = s_inverse_batch;
+        P->fwd_batch = s_forward_batch;
         P->es = 0.;
 ENDENTRY(P)
 
@@ -126,6 +126,11 @@ struct isea_dgg {
 	int	triangle; /* triangle of last transformed point */
 	int	quad; /* quad of last transformed point */
 	unsigned long serial;
+	/* precomputed by isea_precompute() */
+	double	center_xyz[21][3]; /* unit vectors of the triangle centers */
+	double	az_adj[21]; /* azimuth adjustment per triangle */
+	double	g_rad, G_rad, theta_rad; /* snyder constants, radians */
+	double	cot_theta, tan_g;
 };
 
 struct isea_pt {
@@ -301,186 +306,208 @@ isea_triangle_xy(int triangle)
 	return c;
 }
 
-/* snyder eq 14 */
-static double
-sph_azimuth(double f_lon, double f_lat, double t_lon, double t_lat)
-{
-	double          az;
-
-	az = atan2(cos(t_lat) * sin(t_lon - f_lon),
-		   cos(f_lat) * sin(t_lat)
-		   - sin(f_lat) * cos(t_lat) * cos(t_lon - f_lon)
-		);
-	return az;
-}
-
-/* coord needs to be in radians */
+/*
+ * Fill in the per-face constants: unit vectors of the triangle centers
+ * (for the direct face lookup), the azimuth adjustment of each face's
+ * reference vertex (which used to cost four trig calls per point), and
+ * the snyder constants converted to radians once.
+ */
 ISEA_STATIC
-int
-isea_snyder_forward(struct isea_geo * ll, struct isea_pt * out)
+void
+isea_precompute(struct isea_dgg * dg)
 {
+	struct snyder_constants c;
 	int             i;
 
-	/*
-	 * spherical distance from center of polygon face to any of its
-	 * vertexes on the globe
-	 */
-	double          g;
+	c = constants[SNYDER_POLY_ICOSAHEDRON];
+	dg->theta_rad = c.theta * DEG2RAD;
+	dg->g_rad = c.g * DEG2RAD;
+	dg->G_rad = c.G * DEG2RAD;
+	dg->cot_theta = 1.0 / tan(dg->theta_rad);
+	dg->tan_g = tan(dg->g_rad);
 
-	/*
-	 * spherical angle between radius vector to center and adjacent edge
-	 * of spherical polygon on the globe
-	 */
-	double          G;
+	for (i = 1; i <= 20; i++) {
+		struct isea_geo center = icostriangles[i];
 
-	/*
-	 * plane angle between radius vector to center and adjacent edge of
-	 * plane polygon
-	 */
-	double          theta;
+		dg->center_xyz[i][0] = cos(center.lat) * cos(center.lon);
+		dg->center_xyz[i][1] = cos(center.lat) * sin(center.lon);
+		dg->center_xyz[i][2] = sin(center.lat);
+		dg->az_adj[i] = az_adjustment(i);
+	}
+}
 
+/*
+ * Project ll onto triangle i, or return 0 if ll does not lie on that
+ * triangle (within the acceptance fuzz).  This is one iteration of the
+ * face scan the forward used to run, with the per-face constants taken
+ * from isea_precompute().
+ */
+ISEA_STATIC
+int
+isea_snyder_tri(struct isea_dgg * dg, int i, struct isea_geo * ll,
+		struct isea_pt * out)
+{
 	/* additional variables from snyder */
 	double          q, Rprime, H, Ag, Azprime, Az, dprime, f, rho,
-	                x, y;
-
-	/* variables used to store intermediate results */
-	double          cot_theta, tan_g, az_offset;
+	                x, y, z;
 
 	/* how many multiples of 60 degrees we adjust the azimuth */
 	int             Az_adjust_multiples;
 
-	struct snyder_constants c;
+	struct isea_geo center;
 
-	/*
-	 * TODO by locality of reference, start by trying the same triangle
-	 * as last time
-	 */
+	center = icostriangles[i];
 
-	/* TODO put these constants in as radians to begin with */
-	c = constants[SNYDER_POLY_ICOSAHEDRON];
-	theta = c.theta * DEG2RAD;
-	g = c.g * DEG2RAD;
-	G = c.G * DEG2RAD;
+	/* step 1 */
+	z = acos(sin(center.lat) * sin(ll->lat)
+		 + cos(center.lat) * cos(ll->lat) * cos(ll->lon - center.lon));
 
-	for (i = 1; i <= 20; i++) {
-		double          z;
-		struct isea_geo center;
+	/* not on this triangle */
+	if (z > dg->g_rad + 0.000005) { /* TODO DBL_EPSILON */
+		return 0;
+	}
+	Az = atan2(cos(ll->lat) * sin(ll->lon - center.lon),
+		   cos(center.lat) * sin(ll->lat)
+	- sin(center.lat) * cos(ll->lat) * cos(ll->lon - center.lon)
+		);
 
-		center = icostriangles[i];
+	/* step 2 */
 
-		/* step 1 */
-#if 0
-		z = sph_distance(center.lon, center.lat, ll->lon, ll->lat);
-#else
-		z = acos(sin(center.lat) * sin(ll->lat)
-			 + cos(center.lat) * cos(ll->lat) * cos(ll->lon - center.lon));
-#endif
+	Az -= dg->az_adj[i];
 
-		/* not on this triangle */
-		if (z > g + 0.000005) { /* TODO DBL_EPSILON */
-			continue;
-		}
-		Az = sph_azimuth(ll->lon, ll->lat, center.lon, center.lat);
+	/* TODO I don't know why we do this.  It's not in snyder */
+	/* maybe because we should have picked a better vertex */
+	if (Az < 0.0) {
+		Az += 2.0 * M_PI;
+	}
+	/*
+	 * adjust Az for the point to fall within the range of 0 to
+	 * 2(90 - theta) or 60 degrees for the hexagon, by
+	 * and therefore 120 degrees for the triangle
+	 * of the icosahedron
+	 * subtracting or adding multiples of 60 degrees to Az and
+	 * recording the amount of adjustment
+	 */
 
-		Az = atan2(cos(ll->lat) * sin(ll->lon - center.lon),
-			   cos(center.lat) * sin(ll->lat)
-		- sin(center.lat) * cos(ll->lat) * cos(ll->lon - center.lon)
-			);
+	Az_adjust_multiples = 0;
+	while (Az < 0.0) {
+		Az += DEG120;
+		Az_adjust_multiples--;
+	}
+	while (Az > DEG120 + DBL_EPSILON) {
+		Az -= DEG120;
+		Az_adjust_multiples++;
+	}
 
-		/* step 2 */
+	/* step 3 */
 
-		/* This calculates "some" vertex coordinate */
-		az_offset = az_adjustment(i);
+	/* Calculate q from eq 9. */
+	q = atan2(dg->tan_g, cos(Az) + sin(Az) * dg->cot_theta);
 
-		Az -= az_offset;
+	/* not in this triangle */
+	if (z > q + 0.000005) {
+		return 0;
+	}
+	/* step 4 */
 
-		/* TODO I don't know why we do this.  It's not in snyder */
-		/* maybe because we should have picked a better vertex */
-		if (Az < 0.0) {
-			Az += 2.0 * M_PI;
-		}
-		/*
-		 * adjust Az for the point to fall within the range of 0 to
-		 * 2(90 - theta) or 60 degrees for the hexagon, by
-		 * and therefore 120 degrees for the triangle
-		 * of the icosahedron
-		 * subtracting or adding multiples of 60 degrees to Az and
-		 * recording the amount of adjustment
-		 */
-
-		Az_adjust_multiples = 0;
-		while (Az < 0.0) {
-			Az += DEG120;
-			Az_adjust_multiples--;
-		}
-		while (Az > DEG120 + DBL_EPSILON) {
-			Az -= DEG120;
-			Az_adjust_multiples++;
-		}
+	/* Apply equations 5-8 and 10-12 in order */
 
-		/* step 3 */
-		cot_theta = 1.0 / tan(theta);
-		tan_g = tan(g);	/* TODO this is a constant */
+	/* eq 5 */
+	/* Rprime = 0.9449322893 * R; */
+	/* R' in the paper is for the truncated */
+	Rprime = 0.91038328153090290025;
 
-		/* Calculate q from eq 9. */
-		/* TODO cot_theta is cot(30) */
-		q = atan2(tan_g, cos(Az) + sin(Az) * cot_theta);
+	/* eq 6 */
+	H = acos(sin(Az) * sin(dg->G_rad) * cos(dg->g_rad)
+		 - cos(Az) * cos(dg->G_rad));
 
-		/* not in this triangle */
-		if (z > q + 0.000005) {
-			continue;
-		}
-		/* step 4 */
+	/* eq 7 */
+	/* Ag = (Az + G + H - DEG180) * M_PI * R * R / DEG180; */
+	Ag = Az + dg->G_rad + H - DEG180;
 
-		/* Apply equations 5-8 and 10-12 in order */
+	/* eq 8 */
+	Azprime = atan2(2.0 * Ag,
+		Rprime * Rprime * dg->tan_g * dg->tan_g
+		- 2.0 * Ag * dg->cot_theta);
 
-		/* eq 5 */
-		/* Rprime = 0.9449322893 * R; */
-		/* R' in the paper is for the truncated */
-		Rprime = 0.91038328153090290025;
+	/* eq 10 */
+	dprime = Rprime * dg->tan_g
+		/ (cos(Azprime) + sin(Azprime) * dg->cot_theta);
 
-		/* eq 6 */
-		H = acos(sin(Az) * sin(G) * cos(g) - cos(Az) * cos(G));
+	/* eq 11 */
+	f = dprime / (2.0 * Rprime * sin(q / 2.0));
 
-		/* eq 7 */
-		/* Ag = (Az + G + H - DEG180) * M_PI * R * R / DEG180; */
-		Ag = Az + G + H - DEG180;
+	/* eq 12 */
+	rho = 2.0 * Rprime * f * sin(z / 2.0);
 
-		/* eq 8 */
-		Azprime = atan2(2.0 * Ag, Rprime * Rprime * tan_g * tan_g - 2.0 * Ag * cot_theta);
+	/*
+	 * add back the same 60 degree multiple adjustment from step
+	 * 2 to Azprime
+	 */
 
-		/* eq 10 */
-		/* cot(theta) = 1.73205080756887729355 */
-		dprime = Rprime * tan_g / (cos(Azprime) + sin(Azprime) * cot_theta);
+	Azprime += DEG120 * Az_adjust_multiples;
 
-		/* eq 11 */
-		f = dprime / (2.0 * Rprime * sin(q / 2.0));
+	/* calculate rectangular coordinates */
 
-		/* eq 12 */
-		rho = 2.0 * Rprime * f * sin(z / 2.0);
+	x = rho * sin(Azprime);
+	y = rho * cos(Azprime);
 
-		/*
-		 * add back the same 60 degree multiple adjustment from step
-		 * 2 to Azprime
-		 */
+	/*
+	 * TODO
+	 * translate coordinates to the origin for the particular
+	 * hexagon on the flattened polyhedral map plot
+	 */
 
-		Azprime += DEG120 * Az_adjust_multiples;
+	out->x = x;
+	out->y = y;
 
-		/* calculate rectangular coordinates */
+	return 1;
+}
 
-		x = rho * sin(Azprime);
-		y = rho * cos(Azprime);
+/* coord needs to be in radians */
+ISEA_STATIC
+int
+isea_snyder_forward(struct isea_dgg * dg, struct isea_geo * ll,
+		struct isea_pt * out)
+{
+	int             i, tri;
+	double          xv, yv, zv, d, best;
 
-		/*
-		 * TODO
-		 * translate coordinates to the origin for the particular
-		 * hexagon on the flattened polyhedral map plot
-		 */
+	/*
+	 * Direct face lookup: for a regular icosahedron the spherical
+	 * faces are the Voronoi cells of the face center directions, so
+	 * the containing triangle is the one whose center is angularly
+	 * nearest -- the largest dot product against the precomputed
+	 * center unit vectors.  This replaces the scan over all twenty
+	 * faces with spherical distances per candidate.
+	 */
+	xv = cos(ll->lat) * cos(ll->lon);
+	yv = cos(ll->lat) * sin(ll->lon);
+	zv = sin(ll->lat);
+	tri = 1;
+	best = dg->center_xyz[1][0] * xv + dg->center_xyz[1][1] * yv
+		+ dg->center_xyz[1][2] * zv;
+	for (i = 2; i <= 20; i++) {
+		d = dg->center_xyz[i][0] * xv + dg->center_xyz[i][1] * yv
+			+ dg->center_xyz[i][2] * zv;
+		if (d > best) {
+			best = d;
+			tri = i;
+		}
+	}
 
-		out->x = x;
-		out->y = y;
+	if (isea_snyder_tri(dg, tri, ll, out)) {
+		return tri;
+	}
 
-		return i;
+	/*
+	 * Within the acceptance fuzz of an edge the nearest face can
+	 * decline the point; fall back to the full scan.
+	 */
+	for (i = 1; i <= 20; i++) {
+		if (isea_snyder_tri(dg, i, ll, out)) {
+			return i;
+		}
 	}
 
 	/*
@@ -649,7 +676,7 @@ isea_transform(struct isea_dgg * g, struct isea_geo * in,
 
 	i = isea_ctran(&pole, in, g->o_az);
 
-	tri = isea_snyder_forward(&i, out);
+	tri = isea_snyder_forward(g, &i, out);
 	out->x *= g->radius;
 	out->y *= g->radius;
 	g->triangle = tri;
@@ -1043,12 +1070,40 @@ FORWARD(s_forward);
 	in.lat = lp.phi;
 
 	out = isea_forward(&P->dgg, &in);
-	
+
 	xy.x = out.x;
 	xy.y = out.y;
 
 	return xy;
 }
+/* batch kernel for plane output, the raster/binning case: goes through
+** the same direct face lookup but skips the per-point dgg bookkeeping
+** (triangle/quad/serial), so it leaves the shared PJ untouched */
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	struct isea_dgg *g = &P->dgg;
+	double o_lat = g->o_lat, o_lon = g->o_lon, o_az = g->o_az;
+	double radius = g->radius;
+	long j;
+
+	for (j = 0; j < n; ++j) {
+		struct isea_geo in, np, pole;
+		struct isea_pt out;
+		int tri;
+
+		in.lon = lam[j];
+		in.lat = phi[j];
+		pole.lat = o_lat;
+		pole.lon = o_lon;
+		np = isea_ctran(&pole, &in, o_az);
+		tri = isea_snyder_forward(g, &np, &out);
+		out.x *= radius;
+		out.y *= radius;
+		isea_tri_plane(tri, &out, radius);
+		x[j] = out.x;
+		y[j] = out.y;
+	}
+}
 FREEUP; if (P) pj_dalloc(P); }
 
 ENTRY0(isea)
@@ -1056,6 +1111,7 @@ ENTRY0(isea)
 
         P->fwd = s_forward;
         isea_grid_init(&P->dgg);
+        isea_precompute(&P->dgg);
 
         P->dgg.output = ISEA_PLANE;
 /*		P->dgg.radius = P->a; / * otherwise defaults to 1 */
@@ -1127,4 +1183,10 @@ ENTRY0(isea)
 		P->dgg.aperture = 3;
 	}
 
+	/* the other output modes need per-point dgg state (quad/serial),
+	 * so they stay on the scalar path */
+	if (P->dgg.output == ISEA_PLANE) {
+		P->fwd_batch = s_forward_batch;
+	}
+
 ENDENTRY(P)
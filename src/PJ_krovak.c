@@ -30,207 +30,204 @@
  *****************************************************************************/
 
 #define PROJ_PARMS__ \
-	double	C_x;
+	double	C_x; \
+	double	alfa; \
+	double	ralfa; \
+	double	ale; \
+	double	k; \
+	double	kr; \
+	double	n; \
+	double	rn; \
+	double	ro0; \
+	double	tans0; \
+	double	tk0; \
+	double	sinad; \
+	double	cosad; \
+	double	sig; \
+	double	c2; \
+	double	c4; \
+	double	c6; \
+	double	c8;
 #define PJ_LIB__
 
 #include <projects.h>
 #include <string.h>
 #include <stdio.h>
 
-PJ_CVSID("$Id$");	
+PJ_CVSID("$Id$");
 
 PROJ_HEAD(krovak, "Krovak") "\n\tPCyl., Ellps.";
 
+#define S45	0.785398163397448    /* 45 deg */
+#define S90	1.570796326794896
+#define UQ	1.04216856380474     /* DU(2, 59, 42, 42.69689) */
+#define S0	1.37008346281555     /* Latitude of pseudo standard parallel 78deg 30'00" N */
+
 /**
    NOTES: According to EPSG the full Krovak projection method should have
           the following parameters.  Within PROJ.4 the azimuth, and pseudo
-          standard parallel are hardcoded in the algorithm and can't be 
+          standard parallel are hardcoded in the algorithm and can't be
           altered from outside.  The others all have defaults to match the
           common usage with Krovak projection.
 
   lat_0 = latitude of centre of the projection
-         
+
   lon_0 = longitude of centre of the projection
-  
+
   ** = azimuth (true) of the centre line passing through the centre of the projection
 
   ** = latitude of pseudo standard parallel
-   
+
   k  = scale factor on the pseudo standard parallel
-  
+
   x_0 = False Easting of the centre of the projection at the apex of the cone
-  
+
   y_0 = False Northing of the centre of the projection at the apex of the cone
 
  **/
 
+/************************************************************************/
+/*                            krovak_phi()                              */
+/*                                                                      */
+/*      Latitude from the Krovak conformal sphere latitude u.  The      */
+/*      tan(u/2+45d)^(1/alfa)/k^(1/alfa) term is the half-angle         */
+/*      tangent of the conformal latitude, so instead of the fixed      */
+/*      point iteration the original code ran per point we apply the    */
+/*      standard inverse conformal latitude series, good to ~1e-13      */
+/*      radians for the Bessel eccentricity.                            */
+/************************************************************************/
 
+static double krovak_phi( double u, PJ *P )
 
-FORWARD(e_forward); /* ellipsoid */
-/* calculate xy from lat/lon */
-
-/* Constants, identical to inverse transform function */
-	double s45, s90, e2, e, alfa, uq, u0, g, k, k1, n0, ro0, ad, a, s0, n;
-	double gfi, u, fi0, deltav, s, d, eps, ro;
-
-
-	s45 = 0.785398163397448;    /* 45� */
-	s90 = 2 * s45;
-	fi0 = P->phi0;    /* Latitude of projection centre 49� 30' */
-
-   /* Ellipsoid is used as Parameter in for.c and inv.c, therefore a must 
-      be set to 1 here.
-      Ellipsoid Bessel 1841 a = 6377397.155m 1/f = 299.1528128,
-      e2=0.006674372230614;
-   */
-	a =  1; /* 6377397.155; */
-	/* e2 = P->es;*/       /* 0.006674372230614; */
-	e2 = 0.006674372230614;
-	e = sqrt(e2);
-
-	alfa = sqrt(1. + (e2 * pow(cos(fi0), 4)) / (1. - e2));
-
-	uq = 1.04216856380474;      /* DU(2, 59, 42, 42.69689) */
-	u0 = asin(sin(fi0) / alfa);
-	g = pow(   (1. + e * sin(fi0)) / (1. - e * sin(fi0)) , alfa * e / 2.  );
-
-	k = tan( u0 / 2. + s45) / pow  (tan(fi0 / 2. + s45) , alfa) * g;
+{
+	double chi = 2. * (atan(P->kr * pow(tan(u / 2. + S45), P->ralfa)) - S45);
 
-	k1 = P->k0;
-	n0 = a * sqrt(1. - e2) / (1. - e2 * pow(sin(fi0), 2));
-	s0 = 1.37008346281555;       /* Latitude of pseudo standard parallel 78� 30'00" N */
-	n = sin(s0);
-	ro0 = k1 * n0 / tan(s0);
-	ad = s90 - uq;
+	return chi + P->c2 * sin(2. * chi) + P->c4 * sin(4. * chi)
+		+ P->c6 * sin(6. * chi) + P->c8 * sin(8. * chi);
+}
 
-/* Transformation */
+FORWARD(e_forward); /* ellipsoid */
+/* calculate xy from lat/lon */
+	double gfi, u, deltav, s, d, eps, ro;
 
-	gfi =pow ( ((1. + e * sin(lp.phi)) /
-               (1. - e * sin(lp.phi))) , (alfa * e / 2.));
+	gfi = pow( ((1. + P->e * sin(lp.phi)) /
+               (1. - P->e * sin(lp.phi))) , P->ale);
 
-	u= 2. * (atan(k * pow( tan(lp.phi / 2. + s45), alfa) / gfi)-s45);
+	u = 2. * (atan(P->k * pow( tan(lp.phi / 2. + S45), P->alfa) / gfi)-S45);
 
-	deltav = - lp.lam * alfa;
+	deltav = - lp.lam * P->alfa;
 
-	s = asin(cos(ad) * sin(u) + sin(ad) * cos(u) * cos(deltav));
+	s = asin(P->cosad * sin(u) + P->sinad * cos(u) * cos(deltav));
 	d = asin(cos(u) * sin(deltav) / cos(s));
-	eps = n * d;
-	ro = ro0 * pow(tan(s0 / 2. + s45) , n) / pow(tan(s / 2. + s45) , n)   ;
+	eps = P->n * d;
+	ro = P->ro0 * P->tk0 / pow(tan(s / 2. + S45) , P->n);
 
    /* x and y are reverted! */
-	xy.y = ro * cos(eps) / a;
-	xy.x = ro * sin(eps) / a;
-
-        if( !pj_param(P->ctx, P->params, "tczech").i )
-	  {
-	    xy.y *= -1.0;
-	    xy.x *= -1.0;
-	  }
+	xy.y = P->sig * (ro * cos(eps));
+	xy.x = P->sig * (ro * sin(eps));
 
 	return (xy);
 }
 
-
-
 INVERSE(e_inverse); /* ellipsoid */
 	/* calculate lat/lon from xy */
+	double u, deltav, s, d, eps, ro, xi, yi;
 
-/* Constants, identisch wie in der Umkehrfunktion */
-	double s45, s90, fi0, e2, e, alfa, uq, u0, g, k, k1, n0, ro0, ad, a, s0, n;
-	double u, deltav, s, d, eps, ro, fi1, xy0;
-	int ok;
-
-	s45 = 0.785398163397448;    /* 45� */
-	s90 = 2 * s45;
-	fi0 = P->phi0;    /* Latitude of projection centre 49� 30' */
-
-
-   /* Ellipsoid is used as Parameter in for.c and inv.c, therefore a must 
-      be set to 1 here.
-      Ellipsoid Bessel 1841 a = 6377397.155m 1/f = 299.1528128,
-      e2=0.006674372230614;
-   */
-	a = 1; /* 6377397.155; */
-	/* e2 = P->es; */      /* 0.006674372230614; */
-	e2 = 0.006674372230614;
-	e = sqrt(e2);
-
-	alfa = sqrt(1. + (e2 * pow(cos(fi0), 4)) / (1. - e2));
-	uq = 1.04216856380474;      /* DU(2, 59, 42, 42.69689) */
-	u0 = asin(sin(fi0) / alfa);
-	g = pow(   (1. + e * sin(fi0)) / (1. - e * sin(fi0)) , alfa * e / 2.  );
-
-	k = tan( u0 / 2. + s45) / pow  (tan(fi0 / 2. + s45) , alfa) * g;
-
-	k1 = P->k0;
-	n0 = a * sqrt(1. - e2) / (1. - e2 * pow(sin(fi0), 2));
-	s0 = 1.37008346281555;       /* Latitude of pseudo standard parallel 78� 30'00" N */
-	n = sin(s0);
-	ro0 = k1 * n0 / tan(s0);
-	ad = s90 - uq;
-
-
-/* Transformation */
-   /* revert y, x*/
-	xy0=xy.x;
-	xy.x=xy.y;
-	xy.y=xy0;
-
-        if( !pj_param(P->ctx, P->params, "tczech").i )
-	  {
-	    xy.x *= -1.0;
-	    xy.y *= -1.0;
-	  }
-
-	ro = sqrt(xy.x * xy.x + xy.y * xy.y);
-	eps = atan2(xy.y, xy.x);
-	d = eps / sin(s0);
-	s = 2. * (atan(  pow(ro0 / ro, 1. / n) * tan(s0 / 2. + s45)) - s45);
-
-	u = asin(cos(ad) * sin(s) - sin(ad) * cos(s) * cos(d));
-	deltav = asin(cos(s) * sin(d) / cos(u));
-
-	lp.lam = P->lam0 - deltav / alfa;
+   /* revert y, x and apply the axis orientation */
+	xi = P->sig * xy.y;
+	yi = P->sig * xy.x;
 
-/* ITERATION FOR lp.phi */
-   fi1 = u;
+	ro = sqrt(xi * xi + yi * yi);
+	eps = atan2(yi, xi);
+	d = eps / P->n;
+	s = 2. * (atan(pow(P->ro0 / ro, P->rn) * P->tans0) - S45);
 
-   ok = 0;
-   do
-   {
-   	lp.phi = 2. * ( atan( pow( k, -1. / alfa)  *
-                            pow( tan(u / 2. + s45) , 1. / alfa)  *
-                            pow( (1. + e * sin(fi1)) / (1. - e * sin(fi1)) , e / 2.)
-                           )  - s45);
-
-      if (fabs(fi1 - lp.phi) < 0.000000000000001) ok=1;
-      fi1 = lp.phi;
+	u = asin(P->cosad * sin(s) - P->sinad * cos(s) * cos(d));
+	deltav = asin(cos(s) * sin(d) / cos(u));
 
-   }
-   while (ok==0);
+	lp.lam = P->lam0 - deltav / P->alfa;
+	lp.phi = krovak_phi(u, P);
+	lp.lam -= P->lam0;
 
-   lp.lam -= P->lam0;
+	return (lp);
+}
 
-   return (lp);
+/* batch kernels: the per point code is the scalar body with the setup
+** constants already in registers; u depends only on phi, so raster
+** scanlines feeding runs of identical latitudes reuse sin(u)/cos(u) */
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long np, PJ *P) {
+	double e = P->e, ale = P->ale, alfa = P->alfa, k = P->k;
+	double sinad = P->sinad, cosad = P->cosad, n = P->n;
+	double ro0tk0 = P->ro0 * P->tk0, sig = P->sig;
+	double last_ph = HUGE_VAL, sinu = 0., cosu = 0.;
+	long i;
+
+	for (i = 0; i < np; ++i) {
+		double ph = phi[i], deltav = - lam[i] * alfa;
+		double s, d, eps, ro;
+
+		if (ph != last_ph) { /* same scanline latitude? */
+			double gfi, u;
+
+			gfi = pow((1. + e * sin(ph)) / (1. - e * sin(ph)), ale);
+			u = 2. * (atan(k * pow(tan(ph / 2. + S45), alfa) / gfi)
+				- S45);
+			sinu = sin(u);
+			cosu = cos(u);
+			last_ph = ph;
+		}
+		s = asin(cosad * sinu + sinad * cosu * cos(deltav));
+		d = asin(cosu * sin(deltav) / cos(s));
+		eps = n * d;
+		ro = ro0tk0 / pow(tan(s / 2. + S45), n);
+		y[i] = sig * (ro * cos(eps));
+		x[i] = sig * (ro * sin(eps));
+	}
+}
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long np, PJ *P) {
+	double alfa = P->alfa, ralfa = P->ralfa, kr = P->kr;
+	double n = P->n, rn = P->rn, ro0 = P->ro0, tans0 = P->tans0;
+	double sinad = P->sinad, cosad = P->cosad, sig = P->sig;
+	double lam0 = P->lam0;
+	double c2 = P->c2, c4 = P->c4, c6 = P->c6, c8 = P->c8;
+	long i;
+
+	for (i = 0; i < np; ++i) {
+		double xi = sig * y[i], yi = sig * x[i];
+		double u, deltav, s, d, eps, ro, chi;
+
+		ro = sqrt(xi * xi + yi * yi);
+		eps = atan2(yi, xi);
+		d = eps / n;
+		s = 2. * (atan(pow(ro0 / ro, rn) * tans0) - S45);
+		u = asin(cosad * sin(s) - sinad * cos(s) * cos(d));
+		deltav = asin(cos(s) * sin(d) / cos(u));
+		chi = 2. * (atan(kr * pow(tan(u / 2. + S45), ralfa)) - S45);
+		phi[i] = chi + c2 * sin(2. * chi) + c4 * sin(4. * chi)
+			+ c6 * sin(6. * chi) + c8 * sin(8. * chi);
+		lam[i] = (lam0 - deltav / alfa) - lam0;
+	}
 }
 
 FREEUP; if (P) pj_dalloc(P); }
 
 ENTRY0(krovak)
-	double ts;
+	double ts, u0, g, n0, ad, e, es;
 	/* read some Parameters,
 	 * here Latitude Truescale */
 
 	ts = pj_param(P->ctx, P->params, "rlat_ts").f;
 	P->C_x = ts;
-	
+
 	/* we want Bessel as fixed ellipsoid */
 	P->a = 6377397.155;
 	P->e = sqrt(P->es = 0.006674372230614);
 
         /* if latitude of projection center is not set, use 49d30'N */
 	if (!pj_param(P->ctx, P->params, "tlat_0").i)
-            P->phi0 = 0.863937979737193; 
+            P->phi0 = 0.863937979737193;
 
         /* if center long is not set use 42d30'E of Ferro - 17d40' for Ferro */
         /* that will correspond to using longitudes relative to greenwich    */
@@ -242,9 +239,40 @@ ENTRY0(krovak)
 	if (!pj_param(P->ctx, P->params, "tk").i)
             P->k0 = 0.9999;
 
+	/* constants of the projection, identical for forward and inverse,
+	** hoisted out of the per point code.  The ellipsoid is used as a
+	** parameter, therefore a is taken as 1 here. */
+	e = P->e;
+	es = P->es;
+	P->alfa = sqrt(1. + (es * pow(cos(P->phi0), 4)) / (1. - es));
+	P->ralfa = 1. / P->alfa;
+	P->ale = P->alfa * e / 2.;
+	u0 = asin(sin(P->phi0) / P->alfa);
+	g = pow( (1. + e * sin(P->phi0)) / (1. - e * sin(P->phi0)),
+		P->alfa * e / 2. );
+	P->k = tan( u0 / 2. + S45) / pow(tan(P->phi0 / 2. + S45), P->alfa) * g;
+	P->kr = pow(P->k, -1. / P->alfa);
+	n0 = sqrt(1. - es) / (1. - es * pow(sin(P->phi0), 2));
+	P->n = sin(S0);
+	P->rn = 1. / P->n;
+	P->tans0 = tan(S0 / 2. + S45);
+	P->tk0 = pow(P->tans0, P->n);
+	P->ro0 = P->k0 * n0 / tan(S0);
+	ad = S90 - UQ;
+	P->sinad = sin(ad);
+	P->cosad = cos(ad);
+	P->sig = pj_param(P->ctx, P->params, "tczech").i ? 1. : -1.;
+
+	/* inverse conformal latitude series coefficients */
+	P->c2 = es * (1./2. + es * (5./24. + es * (1./12. + es * 13./360.)));
+	P->c4 = es * es * (7./48. + es * (29./240. + es * 811./11520.));
+	P->c6 = es * es * es * (7./120. + es * 81./1120.);
+	P->c8 = es * es * es * es * (4279./161280.);
+
 	/* always the same */
-        P->inv = e_inverse; 
+        P->inv = e_inverse;
 	P->fwd = e_forward;
+	P->inv_batch = e_inverse_batch;
+	P->fwd_batch = e_forward_batch;
 
 ENDENTRY(P)
-
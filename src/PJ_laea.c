@@ -176,12 +176,243 @@ INVERSE(s_inverse); /* spheroid */
 		0. : atan2(xy.x, xy.y);
 	return (lp);
 }
+/* batch kernels for the spherical case: the mode switch and center trig
+** are hoisted out of the loops, leaving per-point bodies of plain
+** sin/cos/sqrt that the compiler can vectorize; failing points are
+** flagged with HUGE_VAL instead of aborting the batch */
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	long i;
+
+	if (P->mode == EQUIT || P->mode == OBLIQ) {
+		double sb1 = sinph0, cb1 = cosph0;
+		int equit = P->mode == EQUIT;
+
+		for (i = 0; i < n; ++i) {
+			double sinphi = sin(phi[i]), cosphi = cos(phi[i]);
+			double coslam = cos(lam[i]), b;
+
+			b = equit ? 1. + cosphi * coslam :
+				1. + sb1 * sinphi + cb1 * cosphi * coslam;
+			if (b <= EPS10) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			b = sqrt(2. / b);
+			x[i] = b * cosphi * sin(lam[i]);
+			y[i] = b * (equit ? sinphi :
+				cb1 * sinphi - sb1 * cosphi * coslam);
+		}
+	} else {
+		double phi0 = P->phi0;
+		int south = P->mode == S_POLE;
+
+		for (i = 0; i < n; ++i) {
+			double coslam = cos(lam[i]), b;
+
+			if (fabs(phi[i] + phi0) < EPS10) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			b = FORTPI - phi[i] * .5;
+			b = 2. * (south ? cos(b) : sin(b));
+			x[i] = b * sin(lam[i]);
+			y[i] = b * (south ? coslam : -coslam);
+		}
+	}
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double sb1 = sinph0, cb1 = cosph0, phi0 = P->phi0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xi = x[i], yi = y[i], rh, ph;
+
+		rh = hypot(xi, yi);
+		if ((ph = rh * .5) > 1.) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		ph = 2. * asin(ph);
+		switch (P->mode) {
+		case EQUIT: {
+			double sinz = sin(ph), cosz = cos(ph);
+
+			ph = fabs(rh) <= EPS10 ? 0.
+				: aasin_quiet(yi * sinz / rh);
+			xi *= sinz;
+			yi = cosz * rh;
+			break;
+		}
+		case OBLIQ: {
+			double sinz = sin(ph), cosz = cos(ph);
+
+			ph = fabs(rh) <= EPS10 ? phi0 :
+				aasin_quiet(cosz * sb1 + yi * sinz * cb1 / rh);
+			xi *= sinz * cb1;
+			yi = (cosz - sin(ph) * sb1) * rh;
+			break;
+		}
+		case N_POLE:
+			yi = -yi;
+			ph = HALFPI - ph;
+			break;
+		case S_POLE:
+			ph -= HALFPI;
+			break;
+		}
+		phi[i] = ph;
+		lam[i] = (yi == 0. && (P->mode == EQUIT || P->mode == OBLIQ))
+			? 0. : atan2(xi, yi);
+	}
+}
+/* ellipsoidal batch kernels: one loop per mode pair with the setup
+** constants in locals, pj_qsfn() inlined in the forward and the
+** pj_authlat() series inlined in the inverse so each body is straight
+** line math over the arrays */
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double e = P->e, one_es = P->one_es, qp = P->qp;
+	long i;
+
+	if (P->mode == OBLIQ || P->mode == EQUIT) {
+		double sb1 = P->sinb1, cb1 = P->cosb1;
+		double xmf = P->xmf, ymf = P->ymf;
+		int equit = P->mode == EQUIT;
+
+		for (i = 0; i < n; ++i) {
+			double coslam = cos(lam[i]), sinlam = sin(lam[i]);
+			double sinphi = sin(phi[i]);
+			double con = e * sinphi, q, sinb, cosb, b;
+
+			q = one_es * (sinphi / (1. - con * con) -
+				(.5 / e) * log((1. - con) / (1. + con)));
+			sinb = q / qp;
+			cosb = sqrt(1. - sinb * sinb);
+			b = equit ? 1. + cosb * coslam :
+				1. + sb1 * sinb + cb1 * cosb * coslam;
+			if (fabs(b) < EPS10) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			b = sqrt(2. / b);
+			x[i] = xmf * b * cosb * sinlam;
+			y[i] = ymf * b * (equit ? sinb :
+				cb1 * sinb - sb1 * cosb * coslam);
+		}
+	} else {
+		int south = P->mode == S_POLE;
+
+		for (i = 0; i < n; ++i) {
+			double coslam = cos(lam[i]), sinlam = sin(lam[i]);
+			double sinphi = sin(phi[i]);
+			double con = e * sinphi, q, b;
+
+			b = south ? phi[i] - HALFPI : HALFPI + phi[i];
+			if (fabs(b) < EPS10) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			q = one_es * (sinphi / (1. - con * con) -
+				(.5 / e) * log((1. - con) / (1. + con)));
+			q = south ? qp + q : qp - q;
+			if (q >= 0.) {
+				b = sqrt(q);
+				x[i] = b * sinlam;
+				y[i] = coslam * (south ? b : -b);
+			} else
+				x[i] = y[i] = 0.;
+		}
+	}
+}
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double a0 = P->apa[0], a1 = P->apa[1], a2 = P->apa[2];
+	double qp = P->qp, phi0 = P->phi0;
+	long i;
+
+	if (P->mode == OBLIQ || P->mode == EQUIT) {
+		double dd = P->dd, rq = P->rq;
+		double sb1 = P->sinb1, cb1 = P->cosb1;
+		int obliq = P->mode == OBLIQ;
+
+		for (i = 0; i < n; ++i) {
+			double xi = x[i] / dd, yi = y[i] * dd;
+			double rho = hypot(xi, yi);
+			double sCe, cCe, ab, beta, t;
+
+			if (rho < EPS10) {
+				lam[i] = 0.;
+				phi[i] = phi0;
+				continue;
+			}
+			sCe = 2. * aasin_quiet(.5 * rho / rq);
+			if (sCe == HUGE_VAL) {
+				lam[i] = phi[i] = HUGE_VAL;
+				continue;
+			}
+			cCe = cos(sCe);
+			sCe = sin(sCe);
+			xi *= sCe;
+			if (obliq) {
+				ab = cCe * sb1 + yi * sCe * cb1 / rho;
+				yi = rho * cb1 * cCe - yi * sb1 * sCe;
+			} else {
+				ab = yi * sCe / rho;
+				yi = rho * cCe;
+			}
+			lam[i] = atan2(xi, yi);
+			beta = aasin_quiet(ab);
+			t = beta + beta;
+			{	/* series multiples by identity from one
+				** sin/cos pair, as in pj_authlat_batch() */
+				double s2 = sin(t), c2 = cos(t);
+				double s4 = 2. * s2 * c2;
+				double c4 = 1. - 2. * s2 * s2;
+
+				phi[i] = beta + a0 * s2 + a1 * s4
+					+ a2 * (s2 * c4 + c2 * s4);
+			}
+		}
+	} else {
+		int south = P->mode == S_POLE;
+
+		for (i = 0; i < n; ++i) {
+			double xi = x[i], yi = south ? y[i] : -y[i];
+			double q = xi * xi + yi * yi;
+			double ab, beta, t;
+
+			if (q == 0.) {
+				lam[i] = 0.;
+				phi[i] = phi0;
+				continue;
+			}
+			ab = 1. - q / qp;
+			if (south)
+				ab = -ab;
+			beta = aasin_quiet(ab);
+			if (beta == HUGE_VAL) {
+				lam[i] = phi[i] = HUGE_VAL;
+				continue;
+			}
+			lam[i] = atan2(xi, yi);
+			t = beta + beta;
+			{	/* series multiples by identity from one
+				** sin/cos pair, as in pj_authlat_batch() */
+				double s2 = sin(t), c2 = cos(t);
+				double s4 = 2. * s2 * c2;
+				double c4 = 1. - 2. * s2 * s2;
+
+				phi[i] = beta + a0 * s2 + a1 * s4
+					+ a2 * (s2 * c4 + c2 * s4);
+			}
+		}
+	}
+}
 FREEUP;
-    if (P) {
-		if (P->apa)
-			pj_dalloc(P->apa);
+    if (P)
 		pj_dalloc(P);
-	}
 }
 ENTRY1(laea,apa)
 	double t;
@@ -198,7 +429,7 @@ ENTRY1(laea,apa)
 		P->e = sqrt(P->es);
 		P->qp = pj_qsfn(1., P->e, P->one_es);
 		P->mmf = .5 / (1. - P->es);
-		P->apa = pj_authset(P->es);
+		P->apa = pj_authset_shared(P->es);
 		switch (P->mode) {
 		case N_POLE:
 		case S_POLE:
@@ -222,6 +453,12 @@ ENTRY1(laea,apa)
 		}
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		/* the kernels inline pj_qsfn()'s series form, which it only
+		** uses for e >= 1e-7; stay scalar below that */
+		if (P->e >= 1.e-7) {
+			P->fwd_batch = e_forward_batch;
+			P->inv_batch = e_inverse_batch;
+		}
 	} else {
 		if (P->mode == OBLIQ) {
 			sinph0 = sin(P->phi0);
@@ -229,5 +466,7 @@ ENTRY1(laea,apa)
 		}
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+		P->fwd_batch = s_forward_batch;
+		P->inv_batch = s_inverse_batch;
 	}
 ENDENTRY(P)
@@ -34,7 +34,7 @@ INVERSE(e_inverse); /* ellipsoid & spheroid */
 			xy.y = -xy.y;
 		}
 		if (P->ellips) {
-			if ((lp.phi = pj_phi2(P->ctx, pow(rho / P->c, 1./P->n), P->e))
+			if ((lp.phi = pj_phi2_(pow(rho / P->c, 1./P->n), P))
 				== HUGE_VAL)
 				I_ERROR;
 		} else
@@ -46,14 +46,193 @@ INVERSE(e_inverse); /* ellipsoid & spheroid */
 	}
 	return (lp);
 }
+/* batch kernels: straight line loops over coordinate arrays so the
+** compiler can keep the cone constants in registers and vectorize; bad
+** points are flagged with HUGE_VAL instead of aborting the batch.  The
+** ellipsoidal forward folds pow(pj_tsfn(..), n) into exp/log form,
+** which agrees with the scalar path to within a couple ulp */
+static void e_forward_batch_es(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P, double es) {
+	double k0 = P->k0, cn = P->n, c = P->c, rho0 = P->rho0;
+	double e = sqrt(es), he = .5 * e;
+	double last_ph = HUGE_VAL, last_rho = HUGE_VAL;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double ph = phi[i], lm = lam[i] * cn, rho, esin;
+
+		/* rho depends only on phi; raster scanlines feed runs of
+		** identical latitudes, so reuse the last evaluation */
+		if (ph == last_ph)
+			rho = last_rho;
+		else if (fabs(fabs(ph) - HALFPI) < EPS10) {
+			if ((ph * cn) <= 0.) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			last_ph = ph;
+			rho = last_rho = 0.;
+		} else {
+			esin = e * sin(ph);
+			last_ph = ph;
+			rho = last_rho =
+			   c * exp(cn * (log(tan(.5 * (HALFPI - ph))) -
+			   he * log((1. - esin) / (1. + esin))));
+		}
+		x[i] = k0 * (rho * sin(lm));
+		y[i] = k0 * (rho0 - rho * cos(lm));
+	}
+}
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_es(lam, phi, x, y, n, P, P->es);
+}
+static void e_forward_batch_wgs84(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_es(lam, phi, x, y, n, P, PJ_ES_WGS84);
+}
+static void e_forward_batch_grs80(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_es(lam, phi, x, y, n, P, PJ_ES_GRS80);
+}
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double k0 = P->k0, cn = P->n, c = P->c, rho0 = P->rho0;
+	double last_ph = HUGE_VAL, last_rho = HUGE_VAL;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double ph = phi[i], lm = lam[i] * cn, rho;
+
+		if (ph == last_ph) /* same scanline latitude */
+			rho = last_rho;
+		else if (fabs(fabs(ph) - HALFPI) < EPS10) {
+			if ((ph * cn) <= 0.) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			last_ph = ph;
+			rho = last_rho = 0.;
+		} else {
+			last_ph = ph;
+			rho = last_rho = c * pow(tan(FORTPI + .5 * ph), -cn);
+		}
+		x[i] = k0 * (rho * sin(lm));
+		y[i] = k0 * (rho0 - rho * cos(lm));
+	}
+}
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double rk0 = 1. / P->k0, cn = P->n, rn = 1. / P->n;
+	double c = P->c, rho0 = P->rho0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xi = x[i] * rk0, yi = rho0 - y[i] * rk0, rho, ph;
+
+		if ((rho = hypot(xi, yi)) != 0.0) {
+			if (cn < 0.) {
+				rho = -rho;
+				xi = -xi;
+				yi = -yi;
+			}
+			ph = pj_phi2_batch(pow(rho / c, rn), P);
+			if (ph == HUGE_VAL) {
+				lam[i] = phi[i] = HUGE_VAL;
+				continue;
+			}
+			phi[i] = ph;
+			lam[i] = atan2(xi, yi) * rn;
+		} else {
+			lam[i] = 0.;
+			phi[i] = cn > 0. ? HALFPI : -HALFPI;
+		}
+	}
+}
+/* specialized inverse: es small enough for the conformal latitude
+** series, computed here from the literal so it can fold */
+static void e_inverse_batch_es(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P, double es) {
+	double rk0 = 1. / P->k0, cn = P->n, rn = 1. / P->n;
+	double c = P->c, rho0 = P->rho0;
+	double apa[4];
+	long i;
+
+	pj_phi2_pre(es, apa);
+	for (i = 0; i < n; ++i) {
+		double xi = x[i] * rk0, yi = rho0 - y[i] * rk0, rho;
+
+		if ((rho = hypot(xi, yi)) != 0.0) {
+			if (cn < 0.) {
+				rho = -rho;
+				xi = -xi;
+				yi = -yi;
+			}
+			phi[i] = pj_phi2_apa(pow(rho / c, rn), apa);
+			lam[i] = atan2(xi, yi) * rn;
+		} else {
+			lam[i] = 0.;
+			phi[i] = cn > 0. ? HALFPI : -HALFPI;
+		}
+	}
+}
+static void e_inverse_batch_wgs84(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	e_inverse_batch_es(x, y, lam, phi, n, P, PJ_ES_WGS84);
+}
+static void e_inverse_batch_grs80(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	e_inverse_batch_es(x, y, lam, phi, n, P, PJ_ES_GRS80);
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double rk0 = 1. / P->k0, cn = P->n, rn = 1. / P->n;
+	double c = P->c, rho0 = P->rho0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xi = x[i] * rk0, yi = rho0 - y[i] * rk0, rho;
+
+		if ((rho = hypot(xi, yi)) != 0.0) {
+			if (cn < 0.) {
+				rho = -rho;
+				xi = -xi;
+				yi = -yi;
+			}
+			phi[i] = 2. * atan(pow(c / rho, rn)) - HALFPI;
+			lam[i] = atan2(xi, yi) * rn;
+		} else {
+			lam[i] = 0.;
+			phi[i] = cn > 0. ? HALFPI : -HALFPI;
+		}
+	}
+}
 SPECIAL(fac) {
         double rho;
 	if (fabs(fabs(lp.phi) - HALFPI) < EPS10) {
 		if ((lp.phi * P->n) <= 0.) return;
 		rho = 0.;
-	} else
-		rho = P->c * (P->ellips ? pow(pj_tsfn(lp.phi, sin(lp.phi),
+	} else {
+		double sinphi = sin(lp.phi), cosphi = cos(lp.phi);
+		double lm, dr, psip;
+
+		rho = P->c * (P->ellips ? pow(pj_tsfn(lp.phi, sinphi,
 			P->e), P->n) : pow(tan(FORTPI + .5 * lp.phi), -P->n));
+		/* analytic Jacobian: rho falls off exponentially in the
+		** isometric latitude, d(rho)/dphi = -n rho d(psi)/dphi */
+		psip = P->ellips ?
+			(1. - P->es) / (cosphi * (1. - P->es * sinphi * sinphi)) :
+			1. / cosphi;
+		dr = - P->n * rho * psip;
+		lm = lp.lam * P->n;
+		/* note pj_deriv()'s sign convention: y_l and x_p hold the
+		** negated partials, and the factors code expects that */
+		fac->der.x_l = P->k0 * rho * P->n * cos(lm);
+		fac->der.y_l = - P->k0 * rho * P->n * sin(lm);
+		fac->der.x_p = - P->k0 * dr * sin(lm);
+		fac->der.y_p = - P->k0 * dr * cos(lm);
+		fac->code |= IS_ANAL_XL_YL + IS_ANAL_XP_YP;
+	}
 	fac->code |= IS_ANAL_HK + IS_ANAL_CONV;
 	fac->k = fac->h = P->k0 * P->n * rho /
 		pj_msfn(sin(lp.phi), cos(lp.phi), P->es);
@@ -101,5 +280,19 @@ ENTRY0(lcc)
 	}
 	P->inv = e_inverse;
 	P->fwd = e_forward;
+	if (P->ellips) {
+		P->inv_batch = e_inverse_batch;
+		P->fwd_batch = e_forward_batch;
+		if (P->spec_ellps == PJ_SPEC_ELLPS_WGS84) {
+			P->fwd_batch = e_forward_batch_wgs84;
+			P->inv_batch = e_inverse_batch_wgs84;
+		} else if (P->spec_ellps == PJ_SPEC_ELLPS_GRS80) {
+			P->fwd_batch = e_forward_batch_grs80;
+			P->inv_batch = e_inverse_batch_grs80;
+		}
+	} else {
+		P->inv_batch = s_inverse_batch;
+		P->fwd_batch = s_forward_batch;
+	}
 	P->spc = fac;
 ENDENTRY(P)
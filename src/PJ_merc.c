@@ -15,7 +15,7 @@ FORWARD(s_forward); /* spheroid */
 	return (xy);
 }
 INVERSE(e_inverse); /* ellipsoid */
-	if ((lp.phi = pj_phi2(P->ctx, exp(- xy.y / P->k0), P->e)) == HUGE_VAL) I_ERROR;
+	if ((lp.phi = pj_phi2_(exp(- xy.y / P->k0), P)) == HUGE_VAL) I_ERROR;
 	lp.lam = xy.x / P->k0;
 	return (lp);
 }
@@ -24,6 +24,178 @@ INVERSE(s_inverse); /* spheroid */
 	lp.lam = xy.x / P->k0;
 	return (lp);
 }
+/* batch kernels: straight line loops over coordinate arrays so the
+** compiler can keep the constants in registers and vectorize; bad
+** points are flagged with HUGE_VAL instead of aborting the batch.
+** The ellipsoidal bodies take the eccentricity as an argument: the
+** generic wrappers pass P->es while the WGS84/GRS80 wrappers pass a
+** literal, letting the compiler fold the derived constants */
+static void e_forward_batch_es(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P, double es) {
+	double k0 = P->k0, e = sqrt(es), he = .5 * e;
+	double last_ph = HUGE_VAL, last_y = HUGE_VAL;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double ph = phi[i], lm = lam[i], esin;
+
+		/* raster scanlines feed runs of identical latitudes; y
+		** depends only on phi, so reuse the last evaluation */
+		if (ph == last_ph) {
+			x[i] = k0 * lm;
+			y[i] = last_y;
+			continue;
+		}
+		if (fabs(fabs(ph) - HALFPI) <= EPS10) {
+			x[i] = y[i] = HUGE_VAL;
+			continue;
+		}
+		esin = e * sin(ph);
+		x[i] = k0 * lm;
+		y[i] = - k0 * (log(tan(.5 * (HALFPI - ph))) -
+		   he * log((1. - esin) / (1. + esin)));
+		last_ph = ph;
+		last_y = y[i];
+	}
+}
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_es(lam, phi, x, y, n, P, P->es);
+}
+static void e_forward_batch_wgs84(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_es(lam, phi, x, y, n, P, PJ_ES_WGS84);
+}
+static void e_forward_batch_grs80(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_es(lam, phi, x, y, n, P, PJ_ES_GRS80);
+}
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double k0 = P->k0;
+	double last_ph = HUGE_VAL, last_y = HUGE_VAL;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double ph = phi[i], lm = lam[i];
+
+		if (ph == last_ph) { /* same scanline latitude */
+			x[i] = k0 * lm;
+			y[i] = last_y;
+			continue;
+		}
+		if (fabs(fabs(ph) - HALFPI) <= EPS10) {
+			x[i] = y[i] = HUGE_VAL;
+			continue;
+		}
+		x[i] = k0 * lm;
+		y[i] = k0 * log(tan(FORTPI + .5 * ph));
+		last_ph = ph;
+		last_y = y[i];
+	}
+}
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double rk0 = 1. / P->k0;
+	long i;
+
+	double last_y = HUGE_VAL, last_ph = HUGE_VAL;
+
+	for (i = 0; i < n; ++i) {
+		double xi = x[i], yi = y[i], ph;
+
+		/* projected scanlines feed runs of identical northings */
+		if (yi == last_y) {
+			phi[i] = last_ph;
+			lam[i] = xi * rk0;
+			continue;
+		}
+		ph = pj_phi2_batch(exp(- yi * rk0), P);
+		if (ph == HUGE_VAL) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		phi[i] = ph;
+		lam[i] = xi * rk0;
+		last_y = yi;
+		last_ph = ph;
+	}
+}
+/* specialized inverse: es small enough for the conformal latitude
+** series, computed here from the literal so it can fold */
+static void e_inverse_batch_es(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P, double es) {
+	double rk0 = 1. / P->k0;
+	double apa[4];
+	double last_y = HUGE_VAL, last_ph = HUGE_VAL;
+	long i;
+
+	pj_phi2_pre(es, apa);
+	for (i = 0; i < n; ++i) {
+		double xi = x[i], yi = y[i];
+
+		if (yi == last_y) { /* same scanline northing */
+			phi[i] = last_ph;
+			lam[i] = xi * rk0;
+			continue;
+		}
+		last_y = yi;
+		phi[i] = last_ph = pj_phi2_apa(exp(- yi * rk0), apa);
+		lam[i] = xi * rk0;
+	}
+}
+static void e_inverse_batch_wgs84(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	e_inverse_batch_es(x, y, lam, phi, n, P, PJ_ES_WGS84);
+}
+static void e_inverse_batch_grs80(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	e_inverse_batch_es(x, y, lam, phi, n, P, PJ_ES_GRS80);
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double rk0 = 1. / P->k0;
+	long i;
+
+	double last_y = HUGE_VAL, last_ph = HUGE_VAL;
+
+	for (i = 0; i < n; ++i) {
+		double xi = x[i], yi = y[i];
+
+		if (yi == last_y) { /* same scanline northing */
+			phi[i] = last_ph;
+			lam[i] = xi * rk0;
+			continue;
+		}
+		last_y = yi;
+		phi[i] = last_ph = HALFPI - 2. * atan(exp(- yi * rk0));
+		lam[i] = xi * rk0;
+	}
+}
+#ifdef PROJ_SPECULATIVE_DISPATCH
+	XY /* exported spherical entries for the speculative dispatch in
+	** pj_fwd.c/pj_inv.c; registered below in place of the statics so
+	** the dispatch can compare and call them by name */
+pj_merc_sfwd_hot(LP lp, PJ *P) { return s_forward(lp, P); }
+	LP
+pj_merc_sinv_hot(XY xy, PJ *P) { return s_inverse(xy, P); }
+#endif
+/* analytic partials: x is linear in lam and y depends only on phi, so
+** the Jacobian is diagonal with the isometric latitude derivative */
+SPECIAL(fac) {
+	double sinphi = sin(lp.phi), cosphi = cos(lp.phi), psip;
+
+	if (fabs(fabs(lp.phi) - HALFPI) <= EPS10)
+		return;
+	psip = P->es ?
+		(1. - P->es) / (cosphi * (1. - P->es * sinphi * sinphi)) :
+		1. / cosphi;
+	fac->code |= IS_ANAL_XL_YL + IS_ANAL_XP_YP;
+	fac->der.x_l = P->k0;
+	fac->der.y_l = 0.;
+	fac->der.x_p = 0.;
+	fac->der.y_p = P->k0 * psip;
+}
 FREEUP; if (P) pj_dalloc(P); }
 ENTRY0(merc)
 	double phits=0.0;
@@ -38,10 +210,26 @@ ENTRY0(merc)
 			P->k0 = pj_msfn(sin(phits), cos(phits), P->es);
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->inv_batch = e_inverse_batch;
+		P->fwd_batch = e_forward_batch;
+		if (P->spec_ellps == PJ_SPEC_ELLPS_WGS84) {
+			P->fwd_batch = e_forward_batch_wgs84;
+			P->inv_batch = e_inverse_batch_wgs84;
+		} else if (P->spec_ellps == PJ_SPEC_ELLPS_GRS80) {
+			P->fwd_batch = e_forward_batch_grs80;
+			P->inv_batch = e_inverse_batch_grs80;
+		}
 	} else { /* sphere */
 		if (is_phits)
 			P->k0 = cos(phits);
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+#ifdef PROJ_SPECULATIVE_DISPATCH
+		P->inv = pj_merc_sinv_hot;
+		P->fwd = pj_merc_sfwd_hot;
+#endif
+		P->inv_batch = s_inverse_batch;
+		P->fwd_batch = s_forward_batch;
 	}
+	P->spc = fac;
 ENDENTRY(P)
@@ -79,6 +79,94 @@ INVERSE(e_inverse); /* ellipsoid */
 		lp.lam = lp.phi = HUGE_VAL;
 	return lp;
 }
+/* Batch variants: the oblique-stereographic stage runs fused with the
+** setup constants in locals, the map polynomial goes through the SoA
+** pj_zpoly1_batch() lanes, and the inverse Newton is seeded from the
+** one-term reversion w/C1 (every entry's series is near-linear), so
+** the usual iteration count drops to one or two.  Failures are
+** flagged with HUGE_VAL.  In place safe. */
+	static void
+e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double e = P->e, schio = P->schio, cchio = P->cchio;
+	long j;
+
+	for (j = 0; j < n; ++j) {
+		double lp_lam = lam[j], lp_phi = phi[j];
+		double sinlon, coslon, esphi, chi, schi, cchi, s;
+
+		sinlon = sin(lp_lam);
+		coslon = cos(lp_lam);
+		esphi = e * sin(lp_phi);
+		chi = 2. * atan(tan((HALFPI + lp_phi) * .5) *
+			pow((1. - esphi) / (1. + esphi), e * .5)) - HALFPI;
+		schi = sin(chi);
+		cchi = cos(chi);
+		s = 2. / (1. + schio * schi + cchio * cchi * coslon);
+		x[j] = s * cchi * sinlon;
+		y[j] = s * (cchio * schi - schio * cchi * coslon);
+	}
+	pj_zpoly1_batch(x, y, x, y, n, P->zcoeff, P->n);
+}
+	static void
+e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double e = P->e, schio = P->schio, cchio = P->cchio;
+	double inv_c1 = 1. / P->zcoeff[0].r;
+	long j;
+
+	for (j = 0; j < n; ++j) {
+		double xy_x = x[j], xy_y = y[j];
+		COMPLEX p, fxy, fpxy, dp;
+		double den, rh, z, sinz, cosz, chi, ph, dphi, esphi;
+		int nn;
+
+		p.r = xy_x * inv_c1;
+		p.i = xy_y * inv_c1;
+		for (nn = 20; nn ;--nn) {
+			fxy = pj_zpolyd1(p, P->zcoeff, P->n, &fpxy);
+			fxy.r -= xy_x;
+			fxy.i -= xy_y;
+			den = fpxy.r * fpxy.r + fpxy.i * fpxy.i;
+			dp.r = -(fxy.r * fpxy.r + fxy.i * fpxy.i) / den;
+			dp.i = -(fxy.i * fpxy.r - fxy.r * fpxy.i) / den;
+			p.r += dp.r;
+			p.i += dp.i;
+			if ((fabs(dp.r) + fabs(dp.i)) <= EPSLN)
+				break;
+		}
+		ph = 0.;
+		sinz = cosz = rh = 0.;
+		if (nn) {
+			rh = hypot(p.r, p.i);
+			z = 2. * atan(.5 * rh);
+			sinz = sin(z);
+			cosz = cos(z);
+			if (fabs(rh) <= EPSLN) {
+				lam[j] = P->lam0;
+				phi[j] = P->phi0;
+				continue;
+			}
+			chi = aasin_quiet(cosz * schio + p.i * sinz * cchio / rh);
+			ph = chi;
+			for (nn = 20; nn ;--nn) {
+				esphi = e * sin(ph);
+				dphi = 2. * atan(tan((HALFPI + chi) * .5) *
+					pow((1. + esphi) / (1. - esphi), e * .5))
+					- HALFPI - ph;
+				ph += dphi;
+				if (fabs(dphi) <= EPSLN)
+					break;
+			}
+		}
+		if (nn) {
+			phi[j] = ph;
+			lam[j] = atan2(p.r * sinz, rh * cchio * cosz
+				- p.i * schio * sinz);
+		} else
+			lam[j] = phi[j] = HUGE_VAL;
+	}
+}
 FREEUP; if (P) pj_dalloc(P); }
 	static PJ *
 setup(PJ *P) { /* general initialization */
@@ -93,6 +181,7 @@ setup(PJ *P) { /* general initialization */
 	P->schio = sin(chio);
 	P->cchio = cos(chio);
 	P->inv = e_inverse; P->fwd = e_forward;
+	P->inv_batch = e_inverse_batch; P->fwd_batch = e_forward_batch;
 	return P;
 }
 ENTRY0(mil_os)
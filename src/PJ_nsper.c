@@ -112,6 +112,130 @@ INVERSE(s_inverse); /* spheroid */
 	}
 	return (lp);
 }
+/* Batch variants, math identical to the scalar kernels with the view
+** constants hoisted, failed points flagged with HUGE_VAL and no ctx
+** stores.  In place safe. */
+	static void
+s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double sinph0 = P->sinph0, cosph0 = P->cosph0;
+	double p = P->p, rp = P->rp, pn1 = P->pn1;
+	double cg = P->cg, sg = P->sg, cw = P->cw, sw = P->sw, h = P->h;
+	int mode = P->mode, tilt = P->tilt;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lp_lam = lam[i], lp_phi = phi[i];
+		double coslam, cosphi, sinphi, xx, yy;
+
+		sinphi = sin(lp_phi);
+		cosphi = cos(lp_phi);
+		coslam = cos(lp_lam);
+		switch (mode) {
+		case OBLIQ:
+			yy = sinph0 * sinphi + cosph0 * cosphi * coslam;
+			break;
+		case EQUIT:
+			yy = cosphi * coslam;
+			break;
+		case S_POLE:
+			yy = - sinphi;
+			break;
+		default: /* N_POLE */
+			yy = sinphi;
+			break;
+		}
+		if (yy < rp) {
+			x[i] = y[i] = HUGE_VAL;
+			continue;
+		}
+		yy = pn1 / (p - yy);
+		xx = yy * cosphi * sin(lp_lam);
+		switch (mode) {
+		case OBLIQ:
+			yy *= (cosph0 * sinphi - sinph0 * cosphi * coslam);
+			break;
+		case EQUIT:
+			yy *= sinphi;
+			break;
+		case N_POLE:
+			coslam = - coslam;
+			/* falls through */
+		case S_POLE:
+			yy *= cosphi * coslam;
+			break;
+		}
+		if (tilt) {
+			double yt, ba;
+
+			yt = yy * cg + xx * sg;
+			ba = 1. / (yt * sw * h + cw);
+			xx = (xx * cg - yy * sg) * cw * ba;
+			yy = yt * ba;
+		}
+		x[i] = xx;
+		y[i] = yy;
+	}
+}
+	static void
+s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double sinph0 = P->sinph0, cosph0 = P->cosph0, phi0 = P->phi0;
+	double p = P->p, pn1 = P->pn1, pfact = P->pfact;
+	double cg = P->cg, sg = P->sg, cw = P->cw, sw = P->sw;
+	int mode = P->mode, tilt = P->tilt;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xx = x[i], yy = y[i];
+		double rh, cosz, sinz, lp_lam, lp_phi;
+
+		if (tilt) {
+			double bm, bq, yt;
+
+			yt = 1./(pn1 - yy * sw);
+			bm = pn1 * xx * yt;
+			bq = pn1 * yy * cw * yt;
+			xx = bm * cg + bq * sg;
+			yy = bq * cg - bm * sg;
+		}
+		rh = hypot(xx, yy);
+		if ((sinz = 1. - rh * rh * pfact) < 0.) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		sinz = (p - sqrt(sinz)) / (pn1 / rh + rh / pn1);
+		cosz = sqrt(1. - sinz * sinz);
+		if (fabs(rh) <= EPS10) {
+			lp_lam = 0.;
+			lp_phi = phi0;
+		} else {
+			switch (mode) {
+			case OBLIQ:
+				lp_phi = asin(cosz * sinph0
+					+ yy * sinz * cosph0 / rh);
+				yy = (cosz - sinph0 * sin(lp_phi)) * rh;
+				xx *= sinz * cosph0;
+				break;
+			case EQUIT:
+				lp_phi = asin(yy * sinz / rh);
+				yy = cosz * rh;
+				xx *= sinz;
+				break;
+			case N_POLE:
+				lp_phi = asin(cosz);
+				yy = -yy;
+				break;
+			default: /* S_POLE */
+				lp_phi = - asin(cosz);
+				break;
+			}
+			lp_lam = atan2(xx, yy);
+		}
+		lam[i] = lp_lam;
+		phi[i] = lp_phi;
+	}
+}
 FREEUP; if (P) pj_dalloc(P); }
 	static PJ *
 setup(PJ *P) {
@@ -132,6 +256,8 @@ setup(PJ *P) {
 	P->pfact = (P->p + 1.) * P->h;
 	P->inv = s_inverse;
 	P->fwd = s_forward;
+	P->inv_batch = s_inverse_batch;
+	P->fwd_batch = s_forward_batch;
 	P->es = 0.;
 	return P;
 }
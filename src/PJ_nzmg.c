@@ -95,6 +95,75 @@ INVERSE(e_inverse); /* ellipsoid */
 		lp.lam = lp.phi = HUGE_VAL;
 	return lp;
 }
+/* Batch variants: the psi/phi series and the complex map polynomial
+** run with everything in locals, the polynomial through the SoA
+** pj_zpoly1_batch() lanes, and the inverse Newton is seeded from the
+** two-term reversion of the series (p = w/C1 - C2 w^2 / C1^3) rather
+** than the raw coordinates, which drops the usual iteration count
+** from five or six to one or two.  Non-convergence is flagged with
+** HUGE_VAL.  In place safe. */
+	static void
+e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double phi0 = P->phi0;
+	long j;
+
+	for (j = 0; j < n; ++j) {
+		double lp_lam = lam[j];
+		double ph = (phi[j] - phi0) * RAD_TO_SEC5;
+		double *C;
+		double pr;
+		int i;
+
+		for (pr = *(C = tpsi + (i = Ntpsi)); i ; --i)
+			pr = *--C + ph * pr;
+		y[j] = pr * ph;
+		x[j] = lp_lam;
+	}
+	/* z.r in y, z.i in x; poly real part is northing, imag easting */
+	pj_zpoly1_batch(y, x, y, x, n, bf, Nbf);
+}
+	static void
+e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double phi0 = P->phi0;
+	double inv_c1 = 1. / bf[0].r;
+	double c2r = bf[1].r, c2i = bf[1].i;
+	long j;
+
+	for (j = 0; j < n; ++j) {
+		double xy_x = x[j], xy_y = y[j];
+		COMPLEX p, f, fp, dp;
+		double den, *C, ph, ur, ui, t;
+		int nn, i;
+
+		/* reversion seed: u = w/C1, p = u - C2 u^2 / C1 */
+		ur = xy_y * inv_c1;
+		ui = xy_x * inv_c1;
+		t = ur * ur - ui * ui;
+		ui = 2. * ur * ui;
+		ur = t;
+		p.r = xy_y * inv_c1 - (c2r * ur - c2i * ui) * inv_c1;
+		p.i = xy_x * inv_c1 - (c2r * ui + c2i * ur) * inv_c1;
+		for (nn = 20; nn ;--nn) {
+			f = pj_zpolyd1(p, bf, Nbf, &fp);
+			f.r -= xy_y;
+			f.i -= xy_x;
+			den = fp.r * fp.r + fp.i * fp.i;
+			p.r += dp.r = -(f.r * fp.r + f.i * fp.i) / den;
+			p.i += dp.i = -(f.i * fp.r - f.r * fp.i) / den;
+			if ((fabs(dp.r) + fabs(dp.i)) <= EPSLN)
+				break;
+		}
+		if (nn) {
+			lam[j] = p.i;
+			for (ph = *(C = tphi + (i = Ntphi)); i ; --i)
+				ph = *--C + p.r * ph;
+			phi[j] = phi0 + p.r * ph * SEC5_TO_RAD;
+		} else
+			lam[j] = phi[j] = HUGE_VAL;
+	}
+}
 FREEUP; if (P) pj_dalloc(P); }
 ENTRY0(nzmg)
 	/* force to International major axis */
@@ -104,4 +173,5 @@ ENTRY0(nzmg)
 	P->x0 = 2510000.;
 	P->y0 = 6023150.;
 	P->inv = e_inverse; P->fwd = e_forward;
+	P->inv_batch = e_inverse_batch; P->fwd_batch = e_forward_batch;
 ENDENTRY(P)
@@ -61,6 +61,123 @@ INVERSE(t_inverse); /* spheroid */
 	}
 	return (lp);
 }
+/* batch kernels: the rotation runs over the whole arrays in one pass
+** sharing the sin/cos of each point, and the linked projection is
+** dispatched once per batch - through its own batch kernel when it
+** has one, else a tight scalar loop - instead of indirectly per
+** point.  Rotation failures are flagged with HUGE_VAL lanes by
+** aasin_quiet() per the batch error convention */
+static void link_forward_batch(double *x, double *y, long n, PJ *P) {
+	struct PJconsts *link = P->link;
+	long i;
+
+	if (link->fwd_batch) {
+		(*link->fwd_batch)(x, y, x, y, n, link);
+		return;
+	}
+	for (i = 0; i < n; ++i) {
+		LP lp;
+		XY xy;
+
+		if (x[i] == HUGE_VAL)
+			continue;
+		lp.lam = x[i];
+		lp.phi = y[i];
+		xy = (*link->fwd)(lp, link);
+		x[i] = xy.x;
+		y[i] = xy.y;
+	}
+}
+static void link_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	struct PJconsts *link = P->link;
+	long i;
+
+	if (link->inv_batch) {
+		(*link->inv_batch)(x, y, lam, phi, n, link);
+		return;
+	}
+	for (i = 0; i < n; ++i) {
+		XY xy;
+		LP lp;
+
+		xy.x = x[i];
+		xy.y = y[i];
+		lp = (*link->inv)(xy, link);
+		lam[i] = lp.lam;
+		phi[i] = lp.phi;
+	}
+}
+static void o_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double sphip = P->sphip, cphip = P->cphip, lamp = P->lamp;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double sinlam = sin(lam[i]);
+		double coslam = cos(lam[i]);
+		double sinphi = sin(phi[i]);
+		double cosphi = cos(phi[i]);
+
+		x[i] = adjlon(aatan2(cosphi * sinlam, sphip * cosphi * coslam +
+			cphip * sinphi) + lamp);
+		y[i] = aasin_quiet(sphip * sinphi - cphip * cosphi * coslam);
+	}
+	link_forward_batch(x, y, n, P);
+}
+static void t_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double lamp = P->lamp;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double sinlam = sin(lam[i]);
+		double coslam = cos(lam[i]);
+		double sinphi = sin(phi[i]);
+		double cosphi = cos(phi[i]);
+
+		x[i] = adjlon(aatan2(cosphi * sinlam, sinphi) + lamp);
+		y[i] = aasin_quiet(- cosphi * coslam);
+	}
+	link_forward_batch(x, y, n, P);
+}
+static void o_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double sphip = P->sphip, cphip = P->cphip, lamp = P->lamp;
+	long i;
+
+	link_inverse_batch(x, y, lam, phi, n, P);
+	for (i = 0; i < n; ++i) {
+		double t, coslam, sinphi, cosphi;
+
+		if (lam[i] == HUGE_VAL)
+			continue;
+		t = lam[i] - lamp;
+		coslam = cos(t);
+		sinphi = sin(phi[i]);
+		cosphi = cos(phi[i]);
+		phi[i] = aasin_quiet(sphip * sinphi + cphip * cosphi * coslam);
+		lam[i] = aatan2(cosphi * sin(t), sphip * cosphi * coslam -
+			cphip * sinphi);
+	}
+}
+static void t_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double lamp = P->lamp;
+	long i;
+
+	link_inverse_batch(x, y, lam, phi, n, P);
+	for (i = 0; i < n; ++i) {
+		double t, cosphi;
+
+		if (lam[i] == HUGE_VAL)
+			continue;
+		t = lam[i] - lamp;
+		cosphi = cos(phi[i]);
+		lam[i] = aatan2(cosphi * sin(t), - sin(phi[i]));
+		phi[i] = aasin_quiet(cosphi * cos(t));
+	}
+}
 FREEUP;
 	if (P) {
 		if (P->link)
@@ -138,8 +255,12 @@ ENTRY1(ob_tran, link)
 		P->sphip = sin(phip);
 		P->fwd = o_forward;
 		P->inv = P->link->inv ? o_inverse : 0;
+		P->fwd_batch = o_forward_batch;
+		P->inv_batch = P->link->inv ? o_inverse_batch : 0;
 	} else { /* transverse */
 		P->fwd = t_forward;
 		P->inv = P->link->inv ? t_inverse : 0;
+		P->fwd_batch = t_forward_batch;
+		P->inv_batch = P->link->inv ? t_inverse_batch : 0;
 	}
 ENDENTRY(P)
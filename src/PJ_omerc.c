@@ -27,6 +27,7 @@
 	int no_rot;
 #define PJ_LIB__
 #include <projects.h>
+#include "pj_vmath.h"
 
 PROJ_HEAD(omerc, "Oblique Mercator")
 	"\n\tCyl, Sph&Ell no_rot\n\t"
@@ -87,13 +88,145 @@ INVERSE(e_inverse); /* ellipsoid */
 		lp.phi = Up < 0. ? -HALFPI : HALFPI;
 	} else {
 		lp.phi = P->E / sqrt((1. + Up) / (1. - Up));
-		if ((lp.phi = pj_phi2(P->ctx, pow(lp.phi, 1. / P->B), P->e)) == HUGE_VAL)
+		if ((lp.phi = pj_phi2_(pow(lp.phi, 1. / P->B), P)) == HUGE_VAL)
 			I_ERROR;
 		lp.lam = - P->rB * atan2((Sp * P->cosgam -
 			Vp * P->singam), cos(P->BrA * u));
 	}
 	return (lp);
 }
+#define VCHUNK 256
+/* batch kernels: the rotation decision is specialized at setup into two
+** registered variants, so the rotated and no_rot paths each run without
+** a per-point branch.  The sin/cos pairs of the skew coordinate go
+** through pj_vsincos over a staging chunk, where a vector libm can
+** serve them.  The forward folds E / pow(pj_tsfn(..), B) into exp/log
+** form, which agrees with the scalar path to within a couple ulp; bad
+** points are flagged with HUGE_VAL instead of aborting the batch */
+static void e_forward_batch_common(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P, int no_rot) {
+	double A = P->A, B = P->B, E = P->E, ArB = P->ArB;
+	double singam = P->singam, cosgam = P->cosgam;
+	double sinrot = P->sinrot, cosrot = P->cosrot, u_0 = P->u_0;
+	double e = P->e, he = .5 * P->e;
+	long done = 0;
+
+	while (done < n) {
+		double blam[VCHUNK], vs[VCHUNK], vc[VCHUNK];
+		long m = n - done, i;
+
+		if (m > VCHUNK)
+			m = VCHUNK;
+		for (i = 0; i < m; ++i)
+			blam[i] = B * lam[done + i];
+		pj_vsincos(m, blam, vs, vc);
+		for (i = 0; i < m; ++i) {
+			double ph = phi[done + i], u, v;
+
+			if (fabs(fabs(ph) - HALFPI) > EPS) {
+				double esin = e * sin(ph);
+				double Q = E * exp(-B *
+				   (log(tan(.5 * (HALFPI - ph))) -
+				    he * log((1. - esin) / (1. + esin))));
+				double temp = 1. / Q;
+				double S = .5 * (Q - temp);
+				double T = .5 * (Q + temp);
+				double U = (S * singam - vs[i] * cosgam) / T;
+
+				if (fabs(fabs(U) - 1.0) < EPS) {
+					x[done + i] = y[done + i] = HUGE_VAL;
+					continue;
+				}
+				v = 0.5 * ArB * log((1. - U)/(1. + U));
+				if (fabs(vc[i]) < TOL)
+					u = A * lam[done + i];
+				else
+					u = ArB * atan2(S * cosgam +
+						vs[i] * singam, vc[i]);
+			} else {
+				v = ph > 0 ? P->v_pole_n : P->v_pole_s;
+				u = ArB * ph;
+			}
+			if (no_rot) {
+				x[done + i] = u;
+				y[done + i] = v;
+			} else {
+				u -= u_0;
+				x[done + i] = v * cosrot + u * sinrot;
+				y[done + i] = u * cosrot - v * sinrot;
+			}
+		}
+		done += m;
+	}
+}
+static void e_forward_batch_norot(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_common(lam, phi, x, y, n, P, 1);
+}
+static void e_forward_batch_rot(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	e_forward_batch_common(lam, phi, x, y, n, P, 0);
+}
+static void e_inverse_batch_common(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P, int no_rot) {
+	double E = P->E, BrA = P->BrA, rB = P->rB;
+	double singam = P->singam, cosgam = P->cosgam;
+	double sinrot = P->sinrot, cosrot = P->cosrot, u_0 = P->u_0;
+	long done = 0;
+
+	while (done < n) {
+		double bu[VCHUNK], vv[VCHUNK], vs[VCHUNK], vc[VCHUNK];
+		long m = n - done, i;
+
+		if (m > VCHUNK)
+			m = VCHUNK;
+		for (i = 0; i < m; ++i) {
+			double xi = x[done + i], yi = y[done + i];
+
+			if (no_rot) {
+				vv[i] = yi;
+				bu[i] = BrA * xi;
+			} else {
+				vv[i] = xi * cosrot - yi * sinrot;
+				bu[i] = BrA * (yi * cosrot + xi * sinrot
+					+ u_0);
+			}
+		}
+		pj_vsincos(m, bu, vs, vc);
+		for (i = 0; i < m; ++i) {
+			double Qp = exp(- BrA * vv[i]);
+			double Sp = .5 * (Qp - 1. / Qp);
+			double Tp = .5 * (Qp + 1. / Qp);
+			double Up = (vs[i] * cosgam + Sp * singam) / Tp;
+
+			if (fabs(fabs(Up) - 1.) < EPS) {
+				lam[done + i] = 0.;
+				phi[done + i] = Up < 0. ? -HALFPI : HALFPI;
+			} else {
+				double ph = E / sqrt((1. + Up) / (1. - Up));
+
+				ph = pj_phi2_batch(pow(ph, rB), P);
+				if (ph == HUGE_VAL) {
+					lam[done + i] = phi[done + i]
+						= HUGE_VAL;
+					continue;
+				}
+				phi[done + i] = ph;
+				lam[done + i] = - rB * atan2(Sp * cosgam -
+					vs[i] * singam, vc[i]);
+			}
+		}
+		done += m;
+	}
+}
+static void e_inverse_batch_norot(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	e_inverse_batch_common(x, y, lam, phi, n, P, 1);
+}
+static void e_inverse_batch_rot(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	e_inverse_batch_common(x, y, lam, phi, n, P, 0);
+}
 FREEUP; if (P) pj_dalloc(P); }
 ENTRY0(omerc)
 	double con, com, cosph0, D, F, H, L, sinph0, p, J, gamma=0,
@@ -200,4 +333,11 @@ ENTRY0(omerc)
 	P->v_pole_s = P->ArB * log(tan(FORTPI + F));
 	P->inv = e_inverse;
 	P->fwd = e_forward;
+	if (P->no_rot) {
+		P->fwd_batch = e_forward_batch_norot;
+		P->inv_batch = e_inverse_batch_norot;
+	} else {
+		P->fwd_batch = e_forward_batch_rot;
+		P->inv_batch = e_inverse_batch_rot;
+	}
 ENDENTRY(P)
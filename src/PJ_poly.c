@@ -84,16 +84,168 @@ INVERSE(s_inverse); /* spheroid */
 	}
 	return (lp);
 }
-FREEUP; if (P) { if (P->en) pj_dalloc(P->en); pj_dalloc(P); } }
+/* Batch variants: the forward loops hoist ml0 and the en[]
+** coefficients and inline pj_msfn/pj_mlfn; the inverse Newton loops
+** keep the scalar update formulas but seed from the inverse
+** rectifying-latitude series (en[5..8]) instead of phi = y, which
+** lands within the series truncation error of the answer and cuts
+** the rounds to one or two.  Non-convergence and the polar failure
+** cases are flagged with HUGE_VAL.  In place safe. */
+	static void
+e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double es = P->es, ml0 = P->ml0;
+	double en0 = P->en[0], en1 = P->en[1], en2 = P->en[2],
+		en3 = P->en[3], en4 = P->en[4];
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lp_lam = lam[i], lp_phi = phi[i];
+
+		if (fabs(lp_phi) <= TOL) {
+			x[i] = lp_lam;
+			y[i] = -ml0;
+		} else {
+			double sp = sin(lp_phi), cp = cos(lp_phi);
+			double ss = sp * sp;
+			double ms = fabs(cp) > TOL
+				? (cp / sqrt(1. - es * ss)) / sp : 0.;
+			double E = lp_lam * sp;
+			double ml = en0 * lp_phi - cp * sp * (en1
+				+ ss * (en2 + ss * (en3 + ss * en4)));
+
+			x[i] = ms * sin(E);
+			y[i] = (ml - ml0) + ms * (1. - cos(E));
+		}
+	}
+}
+	static void
+s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double ml0 = P->ml0, phi0 = P->phi0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lp_lam = lam[i], lp_phi = phi[i];
+
+		if (fabs(lp_phi) <= TOL) {
+			x[i] = lp_lam;
+			y[i] = ml0;
+		} else {
+			double cot = 1. / tan(lp_phi);
+			double E = lp_lam * sin(lp_phi);
+
+			x[i] = sin(E) * cot;
+			y[i] = lp_phi - phi0 + cot * (1. - cos(E));
+		}
+	}
+}
+	static void
+e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double es = P->es, ml0 = P->ml0, one_es = P->one_es;
+	double *en = P->en;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xy_x = x[i], xy_y = y[i] + ml0;
+
+		if (fabs(xy_y) <= TOL) {
+			lam[i] = xy_x;
+			phi[i] = 0.;
+		} else {
+			double r, c, sp, cp, s2ph, ml, mlb, mlp, dPhi;
+			double ph, mu;
+			int it;
+
+			r = xy_y * xy_y + xy_x * xy_x;
+			/* seed: geodetic latitude of rectifying latitude
+			** y/en[0] - exact for x = 0, where the equation
+			** reduces to pj_mlfn(phi) = y */
+			mu = xy_y / en[0];
+			ph = mu + en[5] * sin(mu + mu) + en[6] * sin(4. * mu)
+				+ en[7] * sin(6. * mu) + en[8] * sin(8. * mu);
+			for (it = I_ITER; it ; --it) {
+				sp = sin(ph);
+				s2ph = sp * (cp = cos(ph));
+				if (fabs(cp) < ITOL)
+					break;
+				c = sp * (mlp = sqrt(1. - es * sp * sp)) / cp;
+				ml = en[0] * ph - cp * sp * (en[1]
+					+ sp * sp * (en[2] + sp * sp * (en[3]
+					+ sp * sp * en[4])));
+				mlb = ml * ml + r;
+				mlp = one_es / (mlp * mlp * mlp);
+				ph += ( dPhi =
+					( ml + ml + c * mlb - 2. * xy_y * (c * ml + 1.) ) / (
+					es * s2ph * (mlb - 2. * xy_y * ml) / c +
+					2.* (xy_y - ml) * (c * mlp - 1. / s2ph) - mlp - mlp ));
+				if (fabs(dPhi) <= ITOL)
+					break;
+			}
+			/* the Newton solve can walk a far off-domain seed
+			** onto a reflected root past the pole; such lanes
+			** fail like the other divergence modes instead of
+			** leaking an out of range latitude */
+			if (!it || fabs(ph) > HALFPI || fabs(cos(ph)) < ITOL) {
+				lam[i] = phi[i] = HUGE_VAL;
+				continue;
+			}
+			c = sin(ph);
+			lam[i] = asin(xy_x * tan(ph) *
+				sqrt(1. - es * c * c)) / sin(ph);
+			phi[i] = ph;
+		}
+	}
+}
+	static void
+s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double phi0 = P->phi0;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xy_x = x[i], xy_y = phi0 + y[i];
+
+		if (fabs(xy_y) <= TOL) {
+			lam[i] = xy_x;
+			phi[i] = 0.;
+		} else {
+			double B, dphi, tp, ph;
+			int it;
+
+			ph = xy_y;
+			B = xy_x * xy_x + xy_y * xy_y;
+			it = N_ITER;
+			do {
+				tp = tan(ph);
+				ph -= (dphi = (xy_y * (ph * tp + 1.) - ph -
+					.5 * ( ph * ph + B) * tp) /
+					((ph - xy_y) / tp - 1.));
+			} while (fabs(dphi) > CONV && --it);
+			if (!it) {
+				lam[i] = phi[i] = HUGE_VAL;
+				continue;
+			}
+			lam[i] = asin(xy_x * tan(ph)) / sin(ph);
+			phi[i] = ph;
+		}
+	}
+}
+FREEUP; if (P) pj_dalloc(P); }
 ENTRY1(poly, en)
 	if (P->es) {
-		if (!(P->en = pj_enfn(P->es))) E_ERROR_0;
+		if (!(P->en = pj_enfn_shared(P->es))) E_ERROR_0;
 		P->ml0 = pj_mlfn(P->phi0, sin(P->phi0), cos(P->phi0), P->en);
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->inv_batch = e_inverse_batch;
+		P->fwd_batch = e_forward_batch;
 	} else {
 		P->ml0 = -P->phi0;
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+		P->inv_batch = s_inverse_batch;
+		P->fwd_batch = s_forward_batch;
 	}
 ENDENTRY(P)
@@ -59,6 +59,18 @@ static const struct COEFS Y[] = {
     {0.9761, 0.00616527, -0.000256, -4.2106e-06},
     {1, 0.00328947, -0.000319159, -4.2106e-06}
 };
+/*
+** Precomputed inverse lookup: YIDX[floor(64 * y)] is the largest node
+** whose Y[].c0 does not exceed the bottom of that 1/64 bin.  The bins
+** are narrower than the smallest node spacing (0.0239), so at most one
+** forward step corrects the guess -- no search loop in the inverse.
+*/
+static const char YIDX[64] = {
+	0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+	4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7,
+	8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11,
+	12, 12, 12, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 16, 16, 17,
+};
 #define FXC	0.8487
 #define FYC	1.3523
 #define C1	11.45915590261646417544
@@ -93,11 +105,8 @@ INVERSE(s_inverse); /* spheroid */
 		}
 	} else { /* general problem */
 		/* in Y space, reduce to table interval */
-		for (i = floor(lp.phi * NODES);;) {
-			if (Y[i].c0 > lp.phi) --i;
-			else if (Y[i+1].c0 <= lp.phi) ++i;
-			else break;
-		}
+		i = YIDX[(int)(lp.phi * 64.)];
+		if (Y[i+1].c0 <= lp.phi) ++i;
 		T = Y[i];
 		/* first guess, linear interp */
 		t = 5. * (lp.phi - T.c0)/(Y[i+1].c0 - T.c0);
@@ -114,5 +123,86 @@ INVERSE(s_inverse); /* spheroid */
 	}
 	return (lp);
 }
+/* batch kernels: the coefficient tables stay hot in L1 across the
+** whole array, x is linear in lam at fixed phi, and raster scanlines
+** (runs of one latitude) reduce to a single multiply per point */
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double last_ph = HUGE_VAL, last_xc = 0., last_yc = 0.;
+	long j;
+
+	(void) P;
+	for (j = 0; j < n; ++j) {
+		double ph = phi[j];
+
+		if (ph != last_ph) {
+			int i;
+			double dphi;
+
+			i = floor((dphi = fabs(ph)) * C1);
+			if (i >= NODES) i = NODES - 1;
+			dphi = RAD_TO_DEG * (dphi - RC1 * i);
+			last_ph = ph;
+			last_xc = V(X[i], dphi) * FXC;
+			last_yc = V(Y[i], dphi) * FYC;
+			if (ph < 0.) last_yc = -last_yc;
+		}
+		x[j] = last_xc * lam[j];
+		y[j] = last_yc;
+	}
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double last_y = HUGE_VAL, last_ph = 0., last_rxc = 0.;
+	long j;
+
+	(void) P;
+	for (j = 0; j < n; ++j) {
+		double yj = y[j];
+
+		if (yj != last_y) { /* same scanline ordinate */
+			double yf = fabs(yj / FYC);
+
+			last_y = yj;
+			if (yf >= 1.) { /* simple pathologic cases */
+				if (yf > ONEEPS)
+					last_ph = HUGE_VAL;
+				else {
+					last_ph = yj < 0. ? -HALFPI : HALFPI;
+					last_rxc = 1. / (FXC * X[NODES].c0);
+				}
+			} else { /* general problem */
+				int i;
+				double t, t1;
+				struct COEFS T;
+
+				i = YIDX[(int)(yf * 64.)];
+				if (Y[i+1].c0 <= yf) ++i;
+				T = Y[i];
+				/* first guess, linear interp */
+				t = 5. * (yf - T.c0)/(Y[i+1].c0 - T.c0);
+				/* make into root */
+				T.c0 -= yf;
+				for (;;) { /* Newton-Raphson reduction */
+					t -= t1 = V(T,t) / DV(T,t);
+					if (fabs(t1) < EPS)
+						break;
+				}
+				last_ph = (5 * i + t) * DEG_TO_RAD;
+				if (yj < 0.) last_ph = -last_ph;
+				last_rxc = 1. / (FXC * V(X[i], t));
+			}
+		}
+		if (last_ph == HUGE_VAL) {
+			lam[j] = phi[j] = HUGE_VAL;
+			continue;
+		}
+		phi[j] = last_ph;
+		lam[j] = x[j] * last_rxc;
+	}
+}
 FREEUP; if (P) pj_dalloc(P); }
-ENTRY0(robin) P->es = 0.; P->inv = s_inverse; P->fwd = s_forward; ENDENTRY(P)
+ENTRY0(robin)
+	P->es = 0.; P->inv = s_inverse; P->fwd = s_forward;
+	P->fwd_batch = s_forward_batch; P->inv_batch = s_inverse_batch;
+ENDENTRY(P)
@@ -165,6 +165,264 @@ INVERSE(s_inverse); /* spheroid */
 	}
 	return (lp);
 }
+/* batch kernels: the mode dispatch and per-ellipsoid constants are
+** hoisted out of the point loop, and the ellipsoidal inverse replaces
+** the NITER fixed point with pj_phi2_batch(), which evaluates the
+** inverse conformal latitude series where the eccentricity permits and
+** flags failures with HUGE_VAL rather than touching the ctx */
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double e = P->e, akm1 = P->akm1, sinX1 = P->sinX1, cosX1 = P->cosX1;
+	int mode = P->mode;
+	double last_ph = HUGE_VAL, last_sinX = 0., last_cosX = 0., last_r = 0.;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lm = lam[i], ph = phi[i];
+		double coslam = cos(lm), sinlam = sin(lm);
+
+		if (mode == OBLIQ || mode == EQUIT) {
+			double sinX, cosX, A;
+
+			if (ph == last_ph) { /* same scanline latitude */
+				sinX = last_sinX;
+				cosX = last_cosX;
+			} else {
+				double X = 2. * atan(ssfn_(ph, sin(ph), e)) - HALFPI;
+
+				last_ph = ph;
+				sinX = last_sinX = sin(X);
+				cosX = last_cosX = cos(X);
+			}
+			if (mode == OBLIQ) {
+				A = akm1 / (cosX1 * (1. + sinX1 * sinX +
+				   cosX1 * cosX * coslam));
+				y[i] = A * (cosX1 * sinX - sinX1 * cosX * coslam);
+			} else {
+				A = 2. * akm1 / (1. + cosX * coslam);
+				y[i] = A * sinX;
+			}
+			x[i] = A * cosX * sinlam;
+		} else {
+			double r;
+
+			if (mode == S_POLE) {
+				ph = -ph;
+				coslam = -coslam;
+			}
+			if (ph == last_ph)
+				r = last_r;
+			else {
+				last_ph = ph;
+				r = last_r = akm1 * pj_tsfn(ph, sin(ph), e);
+			}
+			x[i] = r * sinlam;
+			y[i] = -r * coslam;
+		}
+	}
+}
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double akm1 = P->akm1, sinX1 = P->sinX1, cosX1 = P->cosX1;
+	int mode = P->mode;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double lm = lam[i], ph = phi[i];
+		double sinphi = sin(ph), cosphi = cos(ph);
+		double coslam = cos(lm), sinlam = sin(lm);
+
+		if (mode == OBLIQ || mode == EQUIT) {
+			double yv = mode == EQUIT ? 1. + cosphi * coslam :
+			   1. + sinX1 * sinphi + cosX1 * cosphi * coslam;
+
+			if (yv <= EPS10) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			yv = akm1 / yv;
+			x[i] = yv * cosphi * sinlam;
+			y[i] = yv * (mode == EQUIT ? sinphi :
+			   cosX1 * sinphi - sinX1 * cosphi * coslam);
+		} else {
+			double yv;
+
+			if (mode == N_POLE) {
+				coslam = -coslam;
+				ph = -ph;
+			}
+			if (fabs(ph - HALFPI) < TOL) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			yv = akm1 * tan(FORTPI + .5 * ph);
+			x[i] = sinlam * yv;
+			y[i] = coslam * yv;
+		}
+	}
+}
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double akm1 = P->akm1, sinX1 = P->sinX1, cosX1 = P->cosX1;
+	int mode = P->mode;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xi = x[i], yi = y[i], rho = hypot(xi, yi);
+		double ph;
+
+		if (mode == OBLIQ || mode == EQUIT) {
+			double tp = 2. * atan2(rho * cosX1, akm1);
+			double cosphi = cos(tp), sinphi = sin(tp), phi_l;
+
+			if (rho == 0.0)
+				phi_l = asin(cosphi * sinX1);
+			else
+				phi_l = asin(cosphi * sinX1 +
+				   (yi * sinphi * cosX1 / rho));
+			xi *= sinphi;
+			yi = rho * cosX1 * cosphi - yi * sinX1 * sinphi;
+			ph = pj_phi2_batch(tan(.5 * (HALFPI - phi_l)), P);
+		} else {
+			if (mode == N_POLE)
+				yi = -yi;
+			ph = pj_phi2_batch(rho / akm1, P);
+			if (mode == S_POLE && ph != HUGE_VAL)
+				ph = -ph;
+		}
+		if (ph == HUGE_VAL) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		phi[i] = ph;
+		lam[i] = (xi == 0. && yi == 0.) ? 0. : atan2(xi, yi);
+	}
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double akm1 = P->akm1, sinX1 = P->sinX1, cosX1 = P->cosX1;
+	double phi0 = P->phi0;
+	int mode = P->mode;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xi = x[i], yi = y[i];
+		double rh = hypot(xi, yi);
+		double c = 2. * atan(rh / akm1);
+		double sinc = sin(c), cosc = cos(c);
+		double lm = 0., ph;
+
+		if (mode == EQUIT) {
+			ph = fabs(rh) <= EPS10 ? 0. : asin(yi * sinc / rh);
+			if (cosc != 0. || xi != 0.)
+				lm = atan2(xi * sinc, cosc * rh);
+		} else if (mode == OBLIQ) {
+			double cc;
+
+			ph = fabs(rh) <= EPS10 ? phi0 :
+			   asin(cosc * sinX1 + yi * sinc * cosX1 / rh);
+			if ((cc = cosc - sinX1 * sin(ph)) != 0. || xi != 0.)
+				lm = atan2(xi * sinc * cosX1, cc * rh);
+		} else {
+			if (mode == N_POLE)
+				yi = -yi;
+			ph = fabs(rh) <= EPS10 ? phi0 :
+			   asin(mode == S_POLE ? -cosc : cosc);
+			lm = (xi == 0. && yi == 0.) ? 0. : atan2(xi, yi);
+		}
+		lam[i] = lm;
+		phi[i] = ph;
+	}
+}
+/* analytic partials: stereographic is conformal, so once the lam pair
+** is in hand the phi pair follows from the Cauchy-Riemann relations
+** through the isometric latitude, d/dphi = (-y_l, x_l) dpsi/dphi */
+SPECIAL(fac) {
+	double coslam = cos(lp.lam), sinlam = sin(lp.lam);
+	double sinphi = sin(lp.phi), cosphi = cos(lp.phi);
+	double xl, yl, psip, A, D, dA, rho;
+
+	if (P->es) {
+		double sinX, cosX, X;
+
+		switch (P->mode) {
+		case OBLIQ:
+			sinX = sin(X = 2. * atan(ssfn_(lp.phi, sinphi, P->e))
+				- HALFPI);
+			cosX = cos(X);
+			D = 1. + P->sinX1 * sinX + P->cosX1 * cosX * coslam;
+			A = P->akm1 / (P->cosX1 * D);
+			dA = A * P->cosX1 * cosX * sinlam / D;
+			xl = dA * cosX * sinlam + A * cosX * coslam;
+			yl = dA * (P->cosX1 * sinX - P->sinX1 * cosX * coslam)
+				+ A * P->sinX1 * cosX * sinlam;
+			break;
+		case EQUIT:
+			sinX = sin(X = 2. * atan(ssfn_(lp.phi, sinphi, P->e))
+				- HALFPI);
+			cosX = cos(X);
+			D = 1. + cosX * coslam;
+			A = 2. * P->akm1 / D;
+			dA = A * cosX * sinlam / D;
+			xl = dA * cosX * sinlam + A * cosX * coslam;
+			yl = dA * sinX;
+			break;
+		case N_POLE:
+			rho = P->akm1 * pj_tsfn(lp.phi, sinphi, P->e);
+			xl = rho * coslam;
+			yl = rho * sinlam;
+			break;
+		default: /* S_POLE */
+			rho = P->akm1 * pj_tsfn(-lp.phi, -sinphi, P->e);
+			xl = rho * coslam;
+			yl = - rho * sinlam;
+			break;
+		}
+		psip = (1. - P->es) /
+			(cosphi * (1. - P->es * sinphi * sinphi));
+	} else {
+		switch (P->mode) {
+		case OBLIQ:
+		case EQUIT:
+			{
+			double sb = P->mode == OBLIQ ? sinph0 : 0.;
+			double cb = P->mode == OBLIQ ? cosph0 : 1.;
+
+			D = 1. + sb * sinphi + cb * cosphi * coslam;
+			if (D <= EPS10)
+				return;
+			A = P->akm1 / D;
+			dA = A * cb * cosphi * sinlam / D;
+			xl = dA * cosphi * sinlam + A * cosphi * coslam;
+			yl = dA * (cb * sinphi - sb * cosphi * coslam)
+				+ A * sb * cosphi * sinlam;
+			}
+			break;
+		case N_POLE:
+			if (fabs(lp.phi + HALFPI) < TOL)
+				return;
+			rho = P->akm1 * tan(FORTPI - .5 * lp.phi);
+			xl = rho * coslam;
+			yl = rho * sinlam;
+			break;
+		default: /* S_POLE */
+			if (fabs(lp.phi - HALFPI) < TOL)
+				return;
+			rho = P->akm1 * tan(FORTPI + .5 * lp.phi);
+			xl = rho * coslam;
+			yl = - rho * sinlam;
+			break;
+		}
+		psip = 1. / cosphi;
+	}
+	/* y_l and x_p are stored negated, matching pj_deriv()'s sign
+	** convention which the factors code expects */
+	fac->der.x_l = xl;
+	fac->der.y_l = - yl;
+	fac->der.x_p = yl * psip;
+	fac->der.y_p = xl * psip;
+	fac->code |= IS_ANAL_XL_YL + IS_ANAL_XP_YP;
+}
 FREEUP; if (P) pj_dalloc(P); }
 	static PJ *
 setup(PJ *P) { /* general initialization */
@@ -203,6 +461,8 @@ setup(PJ *P) { /* general initialization */
 		}
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->fwd_batch = e_forward_batch;
+		P->inv_batch = e_inverse_batch;
 	} else {
 		switch (P->mode) {
 		case OBLIQ:
@@ -220,7 +480,10 @@ setup(PJ *P) { /* general initialization */
 		}
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+		P->fwd_batch = s_forward_batch;
+		P->inv_batch = s_inverse_batch;
 	}
+	P->spc = fac;
 	return P;
 }
 ENTRY0(stere)
@@ -69,7 +69,61 @@ INVERSE(e_inverse); /* ellipsoid */
 	}
 	return(pj_inv_gauss(P->ctx, lp, P->en));
 }
-FREEUP; if (P) { if (P->en) free(P->en); free(P); } }
+/* batch kernels: the Gauss sphere constants are hoisted into locals
+** and the inverse goes through pj_inv_gauss_batch(), whose closed form
+** replaces the pj_gauss.c fixed point whenever the eccentricity admits
+** the series, flagging failures with HUGE_VAL instead of the ctx */
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long n, PJ *P) {
+	double k0 = P->k0, R2 = P->R2, sinc0 = P->sinc0, cosc0 = P->cosc0;
+	const void *en = P->en;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		LP lp;
+		double sinc, cosc, cosl, k;
+
+		lp.lam = lam[i];
+		lp.phi = phi[i];
+		lp = pj_gauss(P->ctx, lp, en);
+		sinc = sin(lp.phi);
+		cosc = cos(lp.phi);
+		cosl = cos(lp.lam);
+		k = k0 * R2 / (1. + sinc0 * sinc + cosc0 * cosc * cosl);
+		x[i] = k * cosc * sin(lp.lam);
+		y[i] = k * (cosc0 * sinc - sinc0 * cosc * cosl);
+	}
+}
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long n, PJ *P) {
+	double k0 = P->k0, R2 = P->R2, sinc0 = P->sinc0, cosc0 = P->cosc0;
+	double phic0 = P->phic0;
+	const void *en = P->en;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double xi = x[i] / k0, yi = y[i] / k0, rho;
+		LP lp;
+
+		if ((rho = hypot(xi, yi))) {
+			double c = 2. * atan2(rho, R2);
+			double sinc = sin(c), cosc = cos(c);
+
+			lp.phi = asin(cosc * sinc0 + yi * sinc * cosc0 / rho);
+			lp.lam = atan2(xi * sinc, rho * cosc0 * cosc -
+				yi * sinc0 * sinc);
+		} else {
+			lp.phi = phic0;
+			lp.lam = 0.;
+		}
+		lp = pj_inv_gauss_batch(lp, en);
+		if (lp.phi == HUGE_VAL)
+			lp.lam = HUGE_VAL;
+		lam[i] = lp.lam;
+		phi[i] = lp.phi;
+	}
+}
+FREEUP; if (P) { if (P->en) pj_dalloc(P->en); pj_dalloc(P); } }
 ENTRYA(sterea)
 
         P->en=0; 
@@ -82,4 +136,6 @@ ENTRYX
 	P->R2 = 2. * R;
 	P->inv = e_inverse;
 	P->fwd = e_forward;
+	P->fwd_batch = e_forward_batch;
+	P->inv_batch = e_inverse_batch;
 ENDENTRY(P)
@@ -127,28 +127,237 @@ INVERSE(s_inverse); /* sphere */
 	lp.lam = (g || h) ? atan2(g, h) : 0.;
 	return (lp);
 }
+/* batch kernels: the scalar bodies with the esp/ml0/en reads hoisted to
+** locals and pj_mlfn/pj_inv_mlfn inlined, so the al/t polynomial chains
+** keep their Horner ordering (each step a multiply-add, ready for FMA
+** contraction) with the coefficients in registers.  Out of range and
+** degenerate points are flagged with HUGE_VAL instead of aborting */
+static void e_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long np, PJ *P) {
+	double k0 = P->k0, es = P->es, esp = P->esp, ml0 = P->ml0;
+	double en0 = P->en[0], en1 = P->en[1], en2 = P->en[2];
+	double en3 = P->en[3], en4 = P->en[4];
+	long i;
+
+	for (i = 0; i < np; ++i) {
+		double lm = lam[i], ph = phi[i];
+		double al, als, n, cosphi, sinphi, t, ss, ml;
+
+		if (lm < -HALFPI || lm > HALFPI) {
+			x[i] = y[i] = HUGE_VAL;
+			continue;
+		}
+		sinphi = sin(ph); cosphi = cos(ph);
+		t = fabs(cosphi) > 1e-10 ? sinphi/cosphi : 0.;
+		t *= t;
+		al = cosphi * lm;
+		als = al * al;
+		al /= sqrt(1. - es * sinphi * sinphi);
+		n = esp * cosphi * cosphi;
+		ss = sinphi * sinphi;
+		ml = en0 * ph - cosphi * sinphi * (en1 + ss*(en2
+			+ ss*(en3 + ss*en4)));
+		x[i] = k0 * al * (FC1 +
+			FC3 * als * (1. - t + n +
+			FC5 * als * (5. + t * (t - 18.) + n * (14. - 58. * t)
+			+ FC7 * als * (61. + t * ( t * (179. - t) - 479. ) )
+			)));
+		y[i] = k0 * (ml - ml0 +
+			sinphi * al * lm * FC2 * ( 1. +
+			FC4 * als * (5. - t + n * (9. + 4. * n) +
+			FC6 * als * (61. + t * (t - 58.) + n * (270. - 330 * t)
+			+ FC8 * als * (1385. + t * ( t * (543. - t) - 3111.) )
+			))));
+	}
+}
+static void s_forward_batch(const double *lam, const double *phi,
+	double *x, double *y, long np, PJ *P) {
+	double ks0 = aks0, ks5 = aks5, phi0 = P->phi0;
+	long i;
+
+	for (i = 0; i < np; ++i) {
+		double lm = lam[i], ph = phi[i];
+		double b, cosphi, yy;
+
+		if (lm < -HALFPI || lm > HALFPI) {
+			x[i] = y[i] = HUGE_VAL;
+			continue;
+		}
+		b = (cosphi = cos(ph)) * sin(lm);
+		if (fabs(fabs(b) - 1.) <= EPS10) {
+			x[i] = y[i] = HUGE_VAL;
+			continue;
+		}
+		x[i] = ks5 * log((1. + b) / (1. - b));
+		yy = cosphi * cos(lm) / sqrt(1. - b * b);
+		if ((b = fabs(yy)) >= 1.) {
+			if ((b - 1.) > EPS10) {
+				x[i] = y[i] = HUGE_VAL;
+				continue;
+			}
+			yy = 0.;
+		} else
+			yy = acos(yy);
+		if (ph < 0.) yy = -yy;
+		y[i] = ks0 * (yy - phi0);
+	}
+}
+static void e_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long np, PJ *P) {
+	double rk0 = 1. / P->k0, es = P->es, esp = P->esp, ml0 = P->ml0;
+	double roe = 1. / (1. - P->es);
+	double *en = P->en;
+	long i;
+
+	for (i = 0; i < np; ++i) {
+		double ph, n, con, cosphi, d, ds, sinphi, t;
+
+		ph = pj_inv_mlfn_batch(ml0 + y[i] * rk0, es, en);
+		if (ph == HUGE_VAL) {
+			lam[i] = phi[i] = HUGE_VAL;
+			continue;
+		}
+		if (fabs(ph) >= HALFPI) {
+			phi[i] = y[i] < 0. ? -HALFPI : HALFPI;
+			lam[i] = 0.;
+			continue;
+		}
+		sinphi = sin(ph);
+		cosphi = cos(ph);
+		t = fabs(cosphi) > 1e-10 ? sinphi/cosphi : 0.;
+		n = esp * cosphi * cosphi;
+		d = x[i] * sqrt(con = 1. - es * sinphi * sinphi) * rk0;
+		con *= t;
+		t *= t;
+		ds = d * d;
+		phi[i] = ph - (con * ds * roe) * FC2 * (1. -
+			ds * FC4 * (5. + t * (3. - 9. *  n) + n * (1. - 4 * n) -
+			ds * FC6 * (61. + t * (90. - 252. * n +
+				45. * t) + 46. * n
+		   - ds * FC8 * (1385. + t * (3633. + t * (4095. + 1574. * t)) )
+			)));
+		lam[i] = d*(FC1 -
+			ds*FC3*( 1. + 2.*t + n -
+			ds*FC5*(5. + t*(28. + 24.*t + 8.*n) + 6.*n
+		   - ds * FC7 * (61. + t * (662. + t * (1320. + 720. * t)) )
+		))) / cosphi;
+	}
+}
+static void s_inverse_batch(const double *x, const double *y,
+	double *lam, double *phi, long np, PJ *P) {
+	double rks0 = 1. / aks0, phi0 = P->phi0;
+	long i;
+
+	for (i = 0; i < np; ++i) {
+		double h, g, yi = y[i];
+
+		/* yi must be latched before the phi store: the batch
+		** entries run kernels in place, so phi aliases y */
+		h = exp(x[i] * rks0);
+		g = .5 * (h - 1. / h);
+		h = cos(phi0 + yi * rks0);
+		phi[i] = asin(sqrt((1. - h * h) / (1. + g * g)));
+		if (yi < 0.) phi[i] = -phi[i];
+		lam[i] = (g || h) ? atan2(g, h) : 0.;
+	}
+}
+/* analytic partials of the Gauss-Krueger series: the lam pair is a
+** plain polynomial derivative in al^2, the phi pair differentiates the
+** series coefficients as well so the result matches the truncated
+** forward (the truncation is not exactly conformal, so the
+** Cauchy-Riemann shortcut would drift at wide lam).  The sphere case
+** is exactly conformal and does use Cauchy-Riemann.  y_l and x_p are
+** stored negated, matching pj_deriv()'s sign convention which the
+** factors code expects */
+SPECIAL(fac) {
+	double sinphi = sin(lp.phi), cosphi = cos(lp.phi);
+
+	if (lp.lam < -HALFPI || lp.lam > HALFPI)
+		return;
+	if (P->es) {
+		double tn, t, tp, al, als, alsp, n, np, nu, nu3;
+		double a1, a2, a3, b1, b2, b3, Px, dPx, Qy, dQy, Pxp, Qyp;
+
+		tn = fabs(cosphi) > 1e-10 ? sinphi/cosphi : 0.;
+		t = tn * tn;
+		tp = 2. * tn * (1. + t);
+		al = cosphi * lp.lam;
+		als = al * al;
+		alsp = -2. * tn * als;
+		nu = sqrt(1. - P->es * sinphi * sinphi);
+		nu3 = nu * nu * nu;
+		n = P->esp * cosphi * cosphi;
+		np = -2. * P->esp * sinphi * cosphi;
+		a1 = 1. - t + n;
+		a2 = 5. + t * (t - 18.) + n * (14. - 58. * t);
+		a3 = 61. + t * ( t * (179. - t) - 479. );
+		Px = FC1 + FC3 * als * (a1 + FC5 * als * (a2 + FC7 * als * a3));
+		dPx = FC3 * (a1 + FC5 * als * (2. * a2 + 3. * FC7 * als * a3));
+		fac->der.x_l = P->k0 * (cosphi / nu) * (Px + 2. * als * dPx);
+		b1 = 5. - t + n * (9. + 4. * n);
+		b2 = 61. + t * (t - 58.) + n * (270. - 330. * t);
+		b3 = 1385. + t * ( t * (543. - t) - 3111.);
+		Qy = 1. + FC4 * als * (b1 + FC6 * als * (b2 + FC8 * als * b3));
+		dQy = FC4 * (b1 + FC6 * als * (2. * b2 + 3. * FC8 * als * b3));
+		fac->der.y_l = - P->k0 * sinphi * FC2 *
+			(2. * cosphi * lp.lam / nu) * (Qy + als * dQy);
+		/* phi derivatives of the polynomials themselves */
+		Pxp = alsp * dPx + FC3 * als * ((np - tp) +
+			FC5 * als * (tp * (2. * t - 18.) + np * (14. - 58. * t)
+			   - 58. * n * tp
+			+ FC7 * als * tp * (t * (358. - 3. * t) - 479.)));
+		Qyp = alsp * dQy + FC4 * als * ((np * (9. + 8. * n) - tp) +
+			FC6 * als * (tp * (2. * t - 58.) + np * (270. - 330. * t)
+			   - 330. * n * tp
+			+ FC8 * als * tp * (t * (1086. - 3. * t) - 3111.)));
+		fac->der.x_p = - P->k0 * (al * Pxp / nu -
+			lp.lam * sinphi * P->one_es * Px / nu3);
+		fac->der.y_p = P->k0 * (P->one_es / nu3 +
+			FC2 * lp.lam * lp.lam * (
+			(cosphi * cosphi - sinphi * sinphi +
+			   P->es * sinphi * sinphi * sinphi * sinphi) / nu3 * Qy
+			+ sinphi * cosphi / nu * Qyp));
+	} else {
+		double b = cosphi * sin(lp.lam), tphi, den, xl, yl, psip;
+
+		if (fabs(fabs(b) - 1.) <= EPS10)
+			return;
+		xl = 2. * aks5 * cosphi * cos(lp.lam) / (1. - b * b);
+		tphi = fabs(cosphi) > 1e-10 ? sinphi/cosphi : 0.;
+		den = tphi * tphi + cos(lp.lam) * cos(lp.lam);
+		yl = aks0 * tphi * sin(lp.lam) / den;
+		psip = 1. / cosphi;
+		fac->der.x_l = xl;
+		fac->der.y_l = - yl;
+		fac->der.x_p = yl * psip;
+		fac->der.y_p = xl * psip;
+	}
+	fac->code |= IS_ANAL_XL_YL + IS_ANAL_XP_YP;
+}
 FREEUP;
-	if (P) {
-		if (P->en)
-			pj_dalloc(P->en);
+	if (P)
 		pj_dalloc(P);
-	}
 }
 	static PJ *
 setup(PJ *P) { /* general initialization */
 	if (P->es) {
-		if (!(P->en = pj_enfn(P->es)))
+		if (!(P->en = pj_enfn_shared(P->es)))
 			E_ERROR_0;
 		P->ml0 = pj_mlfn(P->phi0, sin(P->phi0), cos(P->phi0), P->en);
 		P->esp = P->es / (1. - P->es);
 		P->inv = e_inverse;
 		P->fwd = e_forward;
+		P->inv_batch = e_inverse_batch;
+		P->fwd_batch = e_forward_batch;
 	} else {
 		aks0 = P->k0;
 		aks5 = .5 * aks0;
 		P->inv = s_inverse;
 		P->fwd = s_forward;
+		P->inv_batch = s_inverse_batch;
+		P->fwd_batch = s_forward_batch;
 	}
+	P->spc = fac;
 	return P;
 }
 ENTRY1(tmerc, en)
@@ -26,6 +26,42 @@ aacos(projCtx ctx, double v) {
 		return (v < 0. ? PI : 0.);
 	}
 	return acos(v);
+}
+/* quiet variants for the batch kernels: the argument is clamped to
+** [-1,1] branch-free (the ternaries compile to min/max), and instead
+** of the pj_ctx_set_errno() store - a shared write that serializes
+** concurrent batches and defeats auto-vectorization - an argument
+** beyond ONE_TOL comes back as HUGE_VAL, the in-band flag the batch
+** error convention already uses.  NaN passes through. */
+	double
+aasin_quiet(double v) {
+	double t = v > 1. ? 1. : v;
+
+	t = t < -1. ? -1. : t;
+	return fabs(v) > ONE_TOL ? HUGE_VAL : asin(t);
+}
+	double
+aacos_quiet(double v) {
+	double t = v > 1. ? 1. : v;
+
+	t = t < -1. ? -1. : t;
+	return fabs(v) > ONE_TOL ? HUGE_VAL : acos(t);
+}
+/* whole-array forms of the above for kernels that reduce an angle
+** column in one sweep; in place safe */
+	void
+aasin_batch(const double *v, double *out, long n) {
+	long i;
+
+	for (i = 0; i < n; ++i)
+		out[i] = aasin_quiet(v[i]);
+}
+	void
+aacos_batch(const double *v, double *out, long n) {
+	long i;
+
+	for (i = 0; i < n; ++i)
+		out[i] = aacos_quiet(v[i]);
 }
 	double
 asqrt(double v) { return ((v <= 0) ? 0. : sqrt(v)); }
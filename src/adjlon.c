@@ -13,3 +13,49 @@ double adjlon (double lon) {
     lon -= ONEPI;  /* adjust back to -pi..pi rad */
     return( lon );
 }
+
+/* reduce an array of longitudes to range center +/- PI; values already
+** in range pass through bit unchanged, HUGE_VAL error markers are left
+** alone.  One floor() replaces the data dependent revolution loop, so
+** points far out of range cost the same as points one wrap away.
+** The pass through window is exactly +/- PI, matching the rewrap
+** loop of the lon_wrap handling this stands in for. */
+void adjlon_batch (double *lon, long point_count, int point_offset,
+                   double center) {
+    long i;
+
+    if (point_offset == 0)
+        point_offset = 1;
+
+    for (i = 0; i < point_count; i++) {
+        double d = lon[point_offset*i] - center;
+
+        if ((d >= -ONEPI && d <= ONEPI) || lon[point_offset*i] == HUGE_VAL)
+            continue;
+
+        /* subtract the revolutions in one product so that exact
+        ** multiples of 2pi come back as exactly zero, matching the
+        ** iterative loop this replaces */
+        d -= TWOPI * floor((d + ONEPI) / TWOPI);
+        lon[point_offset*i] = center + d;
+    }
+}
+
+/* batch companion of adjlon() for the del longitude normalization of
+** the forward path.  Unlike adjlon_batch() above this keeps adjlon()'s
+** slightly widened SPI pass through window, so a longitude a few ulps
+** beyond pi (dmstor("-180") for instance) stays on the same side of
+** the seam as the scalar path instead of flipping to the far edge. */
+void adjlon_batch_del (double *lon, long point_count) {
+    long i;
+
+    for (i = 0; i < point_count; i++) {
+        double d = lon[i];
+
+        if ((d >= -SPI && d <= SPI) || d == HUGE_VAL)
+            continue;
+
+        d -= TWOPI * floor((d + ONEPI) / TWOPI);
+        lon[i] = d;
+    }
+}
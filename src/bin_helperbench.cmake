@@ -0,0 +1,7 @@
+set(HELPERBENCH_SRC helperbench.c)
+
+source_group("Source Files\\Bin" FILES ${HELPERBENCH_SRC})
+
+#Executable
+add_executable(helperbench ${HELPERBENCH_SRC})
+target_link_libraries(helperbench ${PROJ_LIBRARIES})
@@ -0,0 +1,7 @@
+set(PROJBENCH_SRC projbench.c)
+
+source_group("Source Files\\Bin" FILES ${PROJBENCH_SRC})
+
+#Executable
+add_executable(projbench ${PROJBENCH_SRC})
+target_link_libraries(projbench ${PROJ_LIBRARIES})
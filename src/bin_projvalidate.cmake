@@ -0,0 +1,7 @@
+set(PROJVALIDATE_SRC projvalidate.c)
+
+source_group("Source Files\\Bin" FILES ${PROJVALIDATE_SRC})
+
+#Executable
+add_executable(projvalidate ${PROJVALIDATE_SRC})
+target_link_libraries(projvalidate ${PROJ_LIBRARIES})
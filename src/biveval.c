@@ -85,3 +85,40 @@ biveval(projUV in, Tseries *T) {
     }
 }
 
+void /* quiet batch entry point for the plan surrogate path: Clenshaw
+** over arrays, with out of range and HUGE_VAL flagged inputs coming
+** out HUGE_VAL without touching pj_errno */
+biveval_batch(Tseries *T, long n, const double *x, const double *y,
+              double *ox, double *oy) {
+    long i;
+
+    for (i = 0; i < n; ++i) {
+        projUV in, out;
+
+        if (x[i] == HUGE_VAL) {
+            ox[i] = oy[i] = HUGE_VAL;
+            continue;
+        }
+        in.u = x[i];
+        in.v = y[i];
+        if (T->power)
+            out = bpseval(in, T);
+        else {
+            projUV w, w2;
+
+            w.u = (in.u + in.u - T->a.u) * T->b.u;
+            w.v = (in.v + in.v - T->a.v) * T->b.v;
+            if (fabs(w.u) > NEAR_ONE || fabs(w.v) > NEAR_ONE)
+                out.u = out.v = HUGE_VAL;
+            else {
+                w2.u = w.u + w.u;
+                w2.v = w.v + w.v;
+                out.u = ceval(T->cu, T->mu, w, w2);
+                out.v = ceval(T->cv, T->mv, w, w2);
+            }
+        }
+        ox[i] = out.u;
+        oy[i] = out.v;
+    }
+}
+
@@ -36,21 +36,32 @@
 #include <math.h>
 #include "emess.h"
 
+#if defined(MSDOS) || defined(OS2) || defined(WIN32) || defined(__WIN32__)
+#  include <fcntl.h>
+#  include <io.h>
+#  define SET_BINARY_MODE(file) setmode(fileno(file), O_BINARY)
+#else
+#  define SET_BINARY_MODE(file) do {} while (0)
+#endif
+
 #define MAX_LINE 1000
 #define MAX_PARGS 100
+#define BIN_CHUNK 65536
 
 static projPJ   fromProj, toProj;
 
 static int
 reversein = 0,	/* != 0 reverse input arguments */
 reverseout = 0,	/* != 0 reverse output arguments */
+bin_io = 0,	/* != 0 binary input and output */
+njobs = 0,	/* > 1 batches input through threaded pj_transform() */
 echoin = 0,	/* echo input data to output line */
 tag = '#';	/* beginning of line tag character */
 	static char
 *oform = (char *)0,	/* output format for x-y or decimal degrees */
 *oterr = "*\t*",	/* output line for unprojectable input */
 *usage =
-"%s\nusage: %s [ -eEfIlrstvwW [args] ] [ +opts[=arg] ]\n"
+"%s\nusage: %s [ -beEfIjlrstvwW [args] ] [ +opts[=arg] ]\n"
 "                   [+to [+opts[=arg] [ files ]\n";
 
 static struct FACTORS facs;
@@ -58,15 +69,97 @@ static double (*informat)(const char *,
                           char **); /* input data deformatter function */
 
 
+/************************************************************************/
+/*                            process_bin()                             */
+/*                                                                      */
+/*      Binary file processing function: packed native (x,y,z)          */
+/*      double triples in, the same out, transformed a block at a       */
+/*      time.  Angular values are in radians, as in the binary mode     */
+/*      of proj.                                                        */
+/************************************************************************/
+static void process_bin(FILE *fid)
+
+{
+    static double *buf = NULL;
+    long n, i;
+
+    if( buf == NULL
+        && (buf = (double *) pj_malloc(sizeof(double)*3*BIN_CHUNK)) == NULL )
+        emess(2,"binary buffer allocation failed");
+
+    while( (n = (long) fread(buf, 3*sizeof(double), BIN_CHUNK, fid)) > 0 )
+    {
+        if( pj_transform( fromProj, toProj, n, 3,
+                          buf, buf+1, buf+2 ) != 0 )
+        {
+            emess(-3,"pj_transform(): %s", pj_strerrno(pj_errno));
+            for( i = 0; i < 3*n; i++ )
+                buf[i] = HUGE_VAL;
+        }
+        if( fwrite(buf, 3*sizeof(double), n, stdout) != (size_t) n )
+            emess(2,"binary output write failure");
+    }
+}
+
+/************************************************************************/
+/*                            output_point()                            */
+/*                                                                      */
+/*      Format one transformed point, with the trailing remainder of    */
+/*      the input line appended.                                        */
+/************************************************************************/
+static void output_point(projUV data, double z, const char *s)
+
+{
+    char pline[40];
+
+    if (data.u == HUGE_VAL) /* error output */
+        fputs(oterr, stdout);
+
+    else if (pj_is_latlong(toProj) && !oform) {	/*ascii DMS output */
+        if (reverseout) {
+            fputs(rtodms_fast(pline, data.v, 'N', 'S'), stdout);
+            putchar('\t');
+            fputs(rtodms_fast(pline, data.u, 'E', 'W'), stdout);
+        } else {
+            fputs(rtodms_fast(pline, data.u, 'E', 'W'), stdout);
+            putchar('\t');
+            fputs(rtodms_fast(pline, data.v, 'N', 'S'), stdout);
+        }
+
+    } else {	/* x-y or decimal degree ascii output */
+        if ( pj_is_latlong(toProj) ) {
+            data.v *= RAD_TO_DEG;
+            data.u *= RAD_TO_DEG;
+        }
+        if (reverseout) {
+            printf(oform,data.v); putchar('\t');
+            printf(oform,data.u);
+        } else {
+            printf(oform,data.u); putchar('\t');
+            printf(oform,data.v);
+        }
+    }
+
+    putchar(' ');
+    if( oform != NULL )
+        printf( oform, z );
+    else
+        printf( "%.3f", z );
+    if( s )
+        printf( "%s", s );
+    else
+        printf( "\n" );
+}
+
 /************************************************************************/
 /*                              process()                               */
 /*                                                                      */
 /*      File processing function.                                       */
 /************************************************************************/
-static void process(FILE *fid) 
+static void process(FILE *fid)
 
 {
-    char line[MAX_LINE+3], *s, pline[40];
+    char line[MAX_LINE+3], *s;
     projUV data;
 
     for (;;) {
@@ -111,7 +204,7 @@ static void process(FILE *fid)
         }
 
         if (data.u != HUGE_VAL) {
-            if( pj_transform( fromProj, toProj, 1, 0, 
+            if( pj_transform( fromProj, toProj, 1, 0,
                               &(data.u), &(data.v), &z ) != 0 )
             {
                 data.u = HUGE_VAL;
@@ -120,43 +213,150 @@ static void process(FILE *fid)
             }
         }
 
-        if (data.u == HUGE_VAL) /* error output */
-            fputs(oterr, stdout);
+        output_point(data, z, s);
+    }
+}
+
+/************************************************************************/
+/*                          process_batched()                           */
+/*                                                                      */
+/*      -j N processing: lines are parsed into a batch, the whole       */
+/*      batch goes through one pj_transform() call (which spreads it    */
+/*      over ctx->transform_threads worker threads), and the results    */
+/*      are printed in input order.  Tag lines are kept in sequence     */
+/*      as passthrough records.                                         */
+/************************************************************************/
+
+#define JOB_BATCH 16384
 
-        else if (pj_is_latlong(toProj) && !oform) {	/*ascii DMS output */
-            if (reverseout) {
-                fputs(rtodms(pline, data.v, 'N', 'S'), stdout);
-                putchar('\t');
-                fputs(rtodms(pline, data.u, 'E', 'W'), stdout);
+static char *batch_strdup(const char *s)
+
+{
+    char *p = (char *) pj_malloc(strlen(s) + 1);
+
+    if (p == NULL)
+        emess(2,"batch line allocation failed");
+    return strcpy(p, s);
+}
+
+static void process_batched(FILE *fid)
+
+{
+    static double *bu = NULL, *bv = NULL, *bz = NULL, *rz = NULL;
+    static char **rest = NULL, **echo = NULL;
+    static long *di = NULL;     /* per record: compact index or -1 */
+    char line[MAX_LINE+3], *s;
+    long n, nd, i;
+
+    if( bu == NULL )
+    {
+        bu = (double *) pj_malloc(sizeof(double)*4*JOB_BATCH);
+        rest = (char **) pj_malloc(sizeof(char *)*2*JOB_BATCH);
+        di = (long *) pj_malloc(sizeof(long)*JOB_BATCH);
+        if( bu == NULL || rest == NULL || di == NULL )
+            emess(2,"batch buffer allocation failed");
+        bv = bu + JOB_BATCH;
+        bz = bv + JOB_BATCH;
+        rz = bz + JOB_BATCH;
+        echo = rest + JOB_BATCH;
+    }
+
+    for (;;) {
+        n = nd = 0;
+        while( n < JOB_BATCH && (s = fgets(line, MAX_LINE, fid)) != NULL )
+        {
+            double u, v;
+
+            ++emess_dat.File_line;
+            if (!strchr(s, '\n')) { /* overlong line */
+                int c;
+                (void)strcat(s, "\n");
+                /* gobble up to newline */
+                while ((c = fgetc(fid)) != EOF && c != '\n') ;
+            }
+            echo[n] = NULL;
+            if (*s == tag) {
+                di[n] = -2;     /* passthrough line */
+                rest[n++] = batch_strdup(line);
+                continue;
+            }
+
+            if (reversein) {
+                v = (*informat)(s, &s);
+                u = (*informat)(s, &s);
             } else {
-                fputs(rtodms(pline, data.u, 'E', 'W'), stdout);
-                putchar('\t');
-                fputs(rtodms(pline, data.v, 'N', 'S'), stdout);
+                u = (*informat)(s, &s);
+                v = (*informat)(s, &s);
             }
 
-        } else {	/* x-y or decimal degree ascii output */
-            if ( pj_is_latlong(toProj) ) {
-                data.v *= RAD_TO_DEG;
-                data.u *= RAD_TO_DEG;
+            rz[n] = strtod( s, &s );
+
+            if (v == HUGE_VAL)
+                u = HUGE_VAL;
+
+            if (!*s && (s > line)) --s; /* assumed we gobbled \n */
+
+            if (echoin) {
+                int t;
+                t = *s;
+                *s = '\0';
+                echo[n] = batch_strdup(line);
+                *s = t;
             }
-            if (reverseout) {
-                printf(oform,data.v); putchar('\t');
-                printf(oform,data.u);
-            } else {
-                printf(oform,data.u); putchar('\t');
-                printf(oform,data.v);
+
+            if (u == HUGE_VAL)  /* unparsable, never transformed */
+                di[n] = -1;
+            else
+            {
+                di[n] = nd;
+                bu[nd] = u;
+                bv[nd] = v;
+                bz[nd] = rz[n];
+                ++nd;
             }
+            rest[n++] = batch_strdup(s);
         }
+        if (n == 0)
+            break;
 
-        putchar(' ');
-        if( oform != NULL )
-            printf( oform, z );
-        else
-            printf( "%.3f", z );
-        if( s )
-            printf( "%s", s );
-        else
-            printf( "\n" );
+        if( nd > 0
+            && pj_transform( fromProj, toProj, nd, 1, bu, bv, bz ) != 0 )
+        {
+            emess(-3,"pj_transform(): %s", pj_strerrno(pj_errno));
+            for( i = 0; i < nd; i++ )
+                bu[i] = bv[i] = HUGE_VAL;
+        }
+
+        for( i = 0; i < n; i++ )
+        {
+            if( di[i] == -2 )
+                fputs(rest[i], stdout);
+            else
+            {
+                projUV data;
+                double z;
+
+                if (echo[i]) {
+                    fputs(echo[i], stdout);
+                    putchar('\t');
+                }
+                if( di[i] < 0 )
+                {
+                    data.u = data.v = HUGE_VAL;
+                    z = rz[i];
+                }
+                else
+                {
+                    data.u = bu[di[i]];
+                    data.v = bv[di[i]];
+                    z = bz[di[i]];
+                }
+                output_point(data, z, rest[i]);
+            }
+            pj_dalloc(rest[i]);
+            if (echo[i])
+                pj_dalloc(echo[i]);
+        }
     }
 }
 
@@ -192,6 +392,13 @@ int main(int argc, char **argv)
               case 'I': /* alt. method to spec inverse */
                 inverse = 1;
                 continue;
+              case 'b': /* binary I/O: packed double triples */
+                bin_io = 1;
+                continue;
+              case 'j': /* batched processing over N threads */
+                if (--argc <= 0) goto noargument;
+                njobs = atoi(*++argv);
+                continue;
               case 'E': /* echo ascii input to ascii output */
                 echoin = 1;
                 continue;
@@ -403,27 +610,40 @@ int main(int argc, char **argv)
     if( !fromProj->is_latlong )
         informat = strtod;
     else {
-        informat = dmstor;
+        informat = dmstor_fast;
     }
 
     if( !toProj->is_latlong && !oform )
         oform = "%.2f";
 
+    if (bin_io)
+        SET_BINARY_MODE(stdout);
+
+    if (njobs > 1) /* batches are split over njobs worker threads */
+        pj_ctx_set_transform_threads( pj_get_default_ctx(), njobs );
+
     /* process input file list */
     for ( ; eargc-- ; ++eargv) {
         if (**eargv == '-') {
             fid = stdin;
             emess_dat.File_name = "<stdin>";
+            if (bin_io)
+                SET_BINARY_MODE(stdin);
 
         } else {
-            if ((fid = fopen(*eargv, "rt")) == NULL) {
+            if ((fid = fopen(*eargv, bin_io ? "rb" : "rt")) == NULL) {
                 emess(-2, *eargv, "input file");
                 continue;
             }
             emess_dat.File_name = *eargv;
         }
         emess_dat.File_line = 0;
-        process(fid);
+        if (bin_io)
+            process_bin(fid);
+        else if (njobs > 1)
+            process_batched(fid);
+        else
+            process(fid);
         fclose(fid);
         emess_dat.File_name = 0;
     }
@@ -81,8 +81,110 @@ dmstor_ctx(projCtx ctx, const char *is, char **rs) {
 	return v;
 }
 
+/*
+** Fast variant for the bulk text paths in proj/cs2cs: scans the input
+** in place instead of copying it to a work buffer, and converts the
+** common all-digit degree/minute fields directly instead of through
+** strtod().  Fields containing a fraction or exponent still go to
+** strtod() so parsed values are bit-identical with dmstor(); a field
+** terminated by 'd' is copied out first, which keeps the VC++ strtod()
+** workaround below without patching the caller's buffer.
+*/
+	double
+dmstor_fast(const char *is, char **rs) {
+	return dmstor_fast_ctx( pj_get_default_ctx(), is, rs );
+}
+
+	double
+dmstor_fast_ctx(projCtx ctx, const char *is, char **rs) {
+	const char *s, *t, *p;
+	int sign, n, nl;
+	double v, tv;
+
+	if (rs)
+		*rs = (char *)is;
+	s = is;
+	while (*s == ' ' || (*s >= '\t' && *s <= '\r')) ++s;
+	sign = *s;
+	if (sign == '+' || sign == '-') ++s;
+	else sign = '+';
+	for (v = 0., nl = 0 ; nl < 3 ; nl = n + 1 ) {
+		if (!(*s >= '0' && *s <= '9') && *s != '.') break;
+		for (t = s; *t >= '0' && *t <= '9'; ++t) ;
+		if (*t != '.' && *t != 'e' && *t != 'E' && t - s < 16) {
+			/* plain integer field - exact without strtod() */
+			tv = 0.;
+			while (s < t)
+				tv = tv * 10. + (*s++ - '0');
+		} else {
+			char *e, work[MAX_WORK];
+
+			for (; *t >= '0' && *t <= '9'; ++t) ;
+			if (*t == '.')
+				for (++t; *t >= '0' && *t <= '9'; ++t) ;
+			if ((*t == 'e' || *t == 'E')
+				&& (t[1] == '+' || t[1] == '-'
+					|| (t[1] >= '0' && t[1] <= '9')))
+				for (t += 2; *t >= '0' && *t <= '9'; ++t) ;
+			if (*t == 'd' || *t == 'D') {
+				/* bounded copy so strtod() cannot misread the
+				** unit as a Fortran style exponent */
+				if (t - s >= MAX_WORK) {
+					pj_ctx_set_errno( ctx, -16 );
+					return HUGE_VAL;
+				}
+				memcpy(work, s, t - s);
+				work[t - s] = '\0';
+				tv = strtod(work, &e);
+				s = t;
+			} else {
+				tv = strtod((char *)s, &e);
+				s = e;
+			}
+			if (tv == HUGE_VAL)
+				return tv;
+		}
+		switch (*s) {
+		case 'D': case 'd':
+			n = 0; break;
+		case '\'':
+			n = 1; break;
+		case '"':
+			n = 2; break;
+		case 'r': case 'R':
+			if (nl) {
+				pj_ctx_set_errno( ctx, -16 );
+				return HUGE_VAL;
+			}
+			++s;
+			v = tv;
+			goto skip;
+		default:
+			v += tv * vm[nl];
+		skip:	n = 4;
+			continue;
+		}
+		if (n < nl) {
+			pj_ctx_set_errno( ctx, -16 );
+			return HUGE_VAL;
+		}
+		v += tv * vm[n];
+		++s;
+	}
+		/* postfix sign */
+	if (*s && (p = strchr(sym, *s))) {
+		sign = (p - sym) >= 4 ? '-' : '+';
+		++s;
+	}
+	if (sign == '-')
+		v = -v;
+	if (rs) /* return point of next char after valid string */
+		*rs = (char *)s;
+	return v;
+}
+
 static double
-proj_strtod(char *nptr, char **endptr) 
+proj_strtod(char *nptr, char **endptr)
 
 {
     char c, *cp = nptr;
@@ -17,27 +17,38 @@
 #include <proj_api.h>
 #define EMESS_ROUTINE
 #include "emess.h"
+
+/* generous, as with pj_log(): messages carry file names and
+** projection definitions supplied by the user */
+#define EMESS_BUF_SIZE 10000
 	void
 emess(int code, char *fmt, ...) {
+	/* the whole message is formatted into one buffer and written
+	** with a single fputs, so messages from threads interleaving
+	** emess calls with processing come out whole instead of mixed
+	** line fragments.  No shared state is written here; the
+	** emess_dat fields are only read. */
+	char buf[EMESS_BUF_SIZE];
+	char *p = buf;
 	va_list args;
 
 	va_start(args, fmt);
 	/* prefix program name, if given */
 	if (fmt != NULL)
-		(void)fprintf(stderr,"%s\n<%s>: ",pj_get_release(),
+		p += sprintf(p,"%s\n<%s>: ",pj_get_release(),
                               emess_dat.Prog_name);
 	/* print file name and line, if given */
 	if (emess_dat.File_name != NULL && *emess_dat.File_name) {
-		(void)fprintf(stderr,"while processing file: %s", emess_dat.File_name);
+		p += sprintf(p,"while processing file: %s", emess_dat.File_name);
 		if (emess_dat.File_line > 0)
-			(void)fprintf(stderr,", line %d\n", emess_dat.File_line);
+			p += sprintf(p,", line %d\n", emess_dat.File_line);
 		else
-			(void)fputc('\n', stderr);
+			*p++ = '\n';
 	} else
-		putc('\n', stderr);
+		*p++ = '\n';
 	/* if |code|==2, print errno code data */
 	if (code == 2 || code == -2)
-		(void)fprintf(stderr, "Sys errno: %d: %s\n",
+		p += sprintf(p, "Sys errno: %d: %s\n",
 			errno,
 #ifdef HAVE_STRERROR
 			strerror(errno));
@@ -45,13 +56,14 @@ emess(int code, char *fmt, ...) {
 			"<system mess. texts unavail.>");
 #endif
 	/* post remainder of call data */
-	(void)vfprintf(stderr,fmt,args);
+	p += vsprintf(p,fmt,args);
 	va_end(args);
+	if (code > 0)
+		(void)strcpy(p, "\nprogram abnormally terminated\n");
+	else
+		(void)strcpy(p, "\n");
+	(void)fputs(buf, stderr);
 	/* die if code positive */
-	if (code > 0) {
-		(void)fputs("\nprogram abnormally terminated\n", stderr);
+	if (code > 0)
 		exit(code);
-	}
-	else
-		putc('\n', stderr);
 }
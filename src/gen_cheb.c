@@ -11,7 +11,7 @@
 	void
 gen_cheb(int inverse, projUV (*proj)(projUV), char *s, PJ *P, int iargc, char **iargv) {
 	int NU = 15, NV = 15, i, res = -1, errin = 0, pwr;
-	char *arg, fmt[15];
+	char *arg, *dumpfile = 0, fmt[15];
 	projUV low, upp, resid;
 	Tseries *F;
 	extern void p_series(Tseries *, FILE *, char *);
@@ -27,24 +27,36 @@ gen_cheb(int inverse, projUV (*proj)(projUV), char *s, PJ *P, int iargc, char **
 	if (*s == ',') if (*++s != ',') res = strtol(s, &s, 10);
 	if (*s == ',') if (*++s != ',') NU = strtol(s, &s, 10);
 	if (*s == ',') if (*++s != ',') NV = strtol(s, &s, 10);
-	pwr = s && *s && !strcmp(s, ",P");
-	(void)printf("#proj_%s\n#    run-line:\n",
-		pwr ? "Power" : "Chebyshev");
-	if (iargc > 0) { /* proj execution audit trail */
-		int n = 0, L;
+	pwr = 0;
+	while (s && *s == ',') { /* trailing options */
+		if (*++s == 'P' && !s[1]) {
+			pwr = 1;
+			++s;
+		} else if (*s == '@') { /* write binary surrogate file */
+			dumpfile = s + 1;
+			s += strlen(s);
+		} else
+			emess(16,"invalid -T trailing option: %s", s);
+	}
+	if (!dumpfile) {
+		(void)printf("#proj_%s\n#    run-line:\n",
+			pwr ? "Power" : "Chebyshev");
+		if (iargc > 0) { /* proj execution audit trail */
+			int n = 0, L;
 
-		for( i = 0 ; iargc ; --iargc) {
-			arg = *iargv++;
-			if (*arg != '+') {
-				if (!n) { putchar('#'); ++n; }
-				(void)printf(" %s%n",arg, &L);
-				if ((n += L) > 50) { putchar('\n'); n = 0; }
+			for( i = 0 ; iargc ; --iargc) {
+				arg = *iargv++;
+				if (*arg != '+') {
+					if (!n) { putchar('#'); ++n; }
+					(void)printf(" %s%n",arg, &L);
+					if ((n += L) > 50) { putchar('\n'); n = 0; }
+				}
 			}
+			if (n) putchar('\n');
 		}
-		if (n) putchar('\n');
+		(void)printf("# projection parameters\n");
+		pj_pr_list(P);
 	}
-	(void)printf("# projection parameters\n");
-	pj_pr_list(P);
 	if (low.u == upp.u || low.v >= upp.v)
 		emess(16,"approx. argument range error");
 	if (low.u > upp.u)
@@ -55,6 +67,20 @@ gen_cheb(int inverse, projUV (*proj)(projUV), char *s, PJ *P, int iargc, char **
 		NU, NV, pwr)))
 		emess(16,"generation of approx failed\nreason: %s\n",
 			pj_strerrno(errno));
+	if (dumpfile) { /* binary surrogate for +proj=cheby */
+		FILE *fid;
+
+		if (!(fid = fopen(dumpfile, "wb")))
+			emess(16,"cannot create surrogate file %s", dumpfile);
+		if (pj_cheby_save(fid, F, inverse, P->lam0, low, upp, resid))
+			emess(16,"write of surrogate file %s failed", dumpfile);
+		(void)fclose(fid);
+		(void)fprintf(stderr,
+			"%s surrogate written to %s, |u,v| sums %g %g\n",
+			pwr ? "Power" : "Chebyshev", dumpfile,
+			resid.u, resid.v);
+		return;
+	}
 	(void)printf("%c,%.12g,%.12g,%.12g,%.12g,%.12g\n",inverse?'I':'F',
 		P->lam0*RAD_TO_DEG,
 		low.u*(inverse?1.:RAD_TO_DEG),upp.u*(inverse?1.:RAD_TO_DEG),
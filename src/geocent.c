@@ -202,9 +202,73 @@ long pj_Convert_Geodetic_To_Geocentric (GeocentricInfo *gi,
   return (Error_Code);
 } /* END OF Convert_Geodetic_To_Geocentric */
 
+long pj_Convert_Geodetic_To_Geocentric_Batch (GeocentricInfo *gi,
+                                              long point_count,
+                                              int point_offset,
+                                              double *x,
+                                              double *y,
+                                              double *z)
+{ /* BEGIN Convert_Geodetic_To_Geocentric_Batch */
+/*
+ * The function Convert_Geodetic_To_Geocentric_Batch converts an array of
+ * geodetic coordinates to geocentric coordinates in place, using the
+ * strided array convention of pj_transform(): x carries longitudes on
+ * input and X on output, y latitudes and Y, z heights and Z, all in
+ * radians / meters.  Points already marked HUGE_VAL are skipped; points
+ * with an out of range latitude are marked HUGE_VAL and reflected in the
+ * returned error code, but processing continues.  The ellipsoid constants
+ * are hoisted out of the loop and the body kept free of function calls
+ * (other than libm) so the compiler can unroll or vectorize it.
+ *
+ *    gi           : Ellipsoid parameters                          (input)
+ *    point_count  : Number of points in the arrays                (input)
+ *    point_offset : Stride between successive array values        (input)
+ *    x, y, z      : Coordinate arrays, converted in place  (input/output)
+ */
+  long Error_Code = GEOCENT_NO_ERROR;
+  double a = gi->Geocent_a;
+  double e2 = gi->Geocent_e2;
+  long i;
+
+  for (i = 0; i < point_count; i++)
+  { /* per point, same arithmetic as Convert_Geodetic_To_Geocentric */
+    long io = i * point_offset;
+    double Latitude = y[io];
+    double Longitude = x[io];
+    double Height = z[io];
+    double Sin_Lat;       /*  sin(Latitude)  */
+    double Cos_Lat;       /*  cos(Latitude)  */
+    double Rn;            /*  Earth radius at location  */
+
+    if (x[io] == HUGE_VAL)
+      continue;
+
+    if( Latitude < -PI_OVER_2 && Latitude > -1.001 * PI_OVER_2 )
+        Latitude = -PI_OVER_2;
+    else if( Latitude > PI_OVER_2 && Latitude < 1.001 * PI_OVER_2 )
+        Latitude = PI_OVER_2;
+    else if ((Latitude < -PI_OVER_2) || (Latitude > PI_OVER_2))
+    { /* Latitude out of range */
+      Error_Code |= GEOCENT_LAT_ERROR;
+      x[io] = y[io] = HUGE_VAL;
+      continue;
+    }
+
+    if (Longitude > PI)
+      Longitude -= (2*PI);
+    Sin_Lat = sin(Latitude);
+    Cos_Lat = cos(Latitude);
+    Rn = a / (sqrt(1.0e0 - e2 * Sin_Lat * Sin_Lat));
+    x[io] = (Rn + Height) * Cos_Lat * cos(Longitude);
+    y[io] = (Rn + Height) * Cos_Lat * sin(Longitude);
+    z[io] = ((Rn * (1 - e2)) + Height) * Sin_Lat;
+  }
+  return (Error_Code);
+} /* END OF Convert_Geodetic_To_Geocentric_Batch */
+
 /*
  * The function Convert_Geocentric_To_Geodetic converts geocentric
- * coordinates (X, Y, Z) to geodetic coordinates (latitude, longitude, 
+ * coordinates (X, Y, Z) to geodetic coordinates (latitude, longitude,
  * and height), according to the current ellipsoid parameters.
  *
  *    X         : Geocentric X coordinate, in meters.         (input)
@@ -217,14 +281,14 @@ long pj_Convert_Geodetic_To_Geocentric (GeocentricInfo *gi,
 
 #define USE_ITERATIVE_METHOD
 
-void pj_Convert_Geocentric_To_Geodetic (GeocentricInfo *gi,
-                                        double X,
-                                        double Y, 
-                                        double Z,
-                                        double *Latitude,
-                                        double *Longitude,
-                                        double *Height)
-{ /* BEGIN Convert_Geocentric_To_Geodetic */
+static void pj_Geocentric_To_Geodetic_Iterative (GeocentricInfo *gi,
+                                                 double X,
+                                                 double Y,
+                                                 double Z,
+                                                 double *Latitude,
+                                                 double *Longitude,
+                                                 double *Height)
+{ /* BEGIN Geocentric_To_Geodetic_Iterative */
 #if !defined(USE_ITERATIVE_METHOD)
 /*
  * The method used here is derived from 'An Improved Algorithm for
@@ -432,4 +496,132 @@ void pj_Convert_Geocentric_To_Geodetic (GeocentricInfo *gi,
 
     return;
 #endif /* defined(USE_ITERATIVE_METHOD) */
+} /* END OF Geocentric_To_Geodetic_Iterative */
+
+void pj_Convert_Geocentric_To_Geodetic (GeocentricInfo *gi,
+                                        double X,
+                                        double Y,
+                                        double Z,
+                                        double *Latitude,
+                                        double *Longitude,
+                                        double *Height)
+{ /* BEGIN Convert_Geocentric_To_Geodetic */
+/*
+ * Closed form of H. Vermeille ("Direct transformation from geocentric
+ * coordinates to geodetic coordinates", Journal of Geodesy 76, 2002):
+ * a fixed operation count per point, no data dependent loop, accurate
+ * to roundoff everywhere the cube root argument stays positive.  Points
+ * deep inside the ellipsoid, where it degenerates, fall back to the
+ * iterative method above; for coordinates anywhere near the surface
+ * that path is never taken.
+ */
+    double a2 = gi->Geocent_a2;
+    double e2 = gi->Geocent_e2;
+    double e4 = e2 * e2;
+    double p;        /* (X^2+Y^2) / a^2 */
+    double q;        /* (1-e^2) Z^2 / a^2 */
+    double r;        /* (p + q - e^4) / 6 */
+    double s, t, u, v, w, k;   /* intermediates, notation as in Vermeille */
+    double D;        /* distance from the polar axis to the foot point */
+    double dist;     /* sqrt(D^2 + Z^2) */
+
+    p = (X * X + Y * Y) / a2;
+    q = (1.0 - e2) * Z * Z / a2;
+    r = (p + q - e4) / 6.0;
+
+    if (r <= 0.0)
+    { /* deep interior - closed form degenerates, iterate instead */
+        pj_Geocentric_To_Geodetic_Iterative (gi, X, Y, Z,
+                                             Latitude, Longitude, Height);
+        return;
+    }
+
+    s = e4 * p * q / (4.0 * r * r * r);
+    t = pow(1.0 + s + sqrt(s * (2.0 + s)), 1.0 / 3.0);
+    u = r * (1.0 + t + 1.0 / t);
+    v = sqrt(u * u + e4 * q);
+    w = e2 * (u + v - q) / (2.0 * v);
+    k = sqrt(u + v + w * w) - w;
+    D = k * sqrt(X * X + Y * Y) / (k + e2);
+    dist = sqrt(D * D + Z * Z);
+
+    *Latitude = 2.0 * atan2(Z, D + dist);
+    *Longitude = atan2(Y, X);
+    *Height = (k + e2 - 1.0) * dist / k;
 } /* END OF Convert_Geocentric_To_Geodetic */
+
+
+void pj_Convert_Geocentric_To_Geodetic_Batch (GeocentricInfo *gi,
+                                              long point_count,
+                                              int point_offset,
+                                              double *x,
+                                              double *y,
+                                              double *z)
+{ /* BEGIN Convert_Geocentric_To_Geodetic_Batch */
+/*
+ * The function Convert_Geocentric_To_Geodetic_Batch converts an array of
+ * geocentric coordinates to geodetic coordinates in place, using the
+ * strided array convention of pj_transform(): x carries X on input and
+ * longitudes on output, y Y and latitudes, z Z and heights.  Points
+ * already marked HUGE_VAL are skipped.
+ *
+ * The loop body is the same Vermeille closed form as the scalar
+ * conversion above, with the ellipsoid constants hoisted so the
+ * compiler is free to unroll or vectorize.  Points deep inside the
+ * ellipsoid, where the closed form degenerates (cube root argument no
+ * longer positive), fall back to the iterative method; for coordinates
+ * anywhere near the surface that path is never taken.  Both methods
+ * are exact to roundoff, so mixing them is safe.
+ *
+ *    gi           : Ellipsoid parameters                          (input)
+ *    point_count  : Number of points in the arrays                (input)
+ *    point_offset : Stride between successive array values        (input)
+ *    x, y, z      : Coordinate arrays, converted in place  (input/output)
+ */
+  double a2 = gi->Geocent_a2;
+  double e2 = gi->Geocent_e2;
+  double e4 = e2 * e2;
+  long i;
+
+  for (i = 0; i < point_count; i++)
+  {
+    long io = i * point_offset;
+    double X, Y, Z;
+    double p;        /* (X^2+Y^2) / a^2 */
+    double q;        /* (1-e^2) Z^2 / a^2 */
+    double r;        /* (p + q - e^4) / 6 */
+    double s, t, u, v, w, k;   /* intermediates, notation as in Vermeille */
+    double D;        /* distance from the polar axis to the foot point */
+    double dist;     /* sqrt(D^2 + Z^2) */
+
+    if (x[io] == HUGE_VAL)
+      continue;
+
+    X = x[io];
+    Y = y[io];
+    Z = z[io];
+
+    p = (X * X + Y * Y) / a2;
+    q = (1.0 - e2) * Z * Z / a2;
+    r = (p + q - e4) / 6.0;
+
+    if (r <= 0.0)
+    { /* deep interior - closed form degenerates, iterate instead */
+      pj_Geocentric_To_Geodetic_Iterative (gi, X, Y, Z, y+io, x+io, z+io);
+      continue;
+    }
+
+    s = e4 * p * q / (4.0 * r * r * r);
+    t = pow(1.0 + s + sqrt(s * (2.0 + s)), 1.0 / 3.0);
+    u = r * (1.0 + t + 1.0 / t);
+    v = sqrt(u * u + e4 * q);
+    w = e2 * (u + v - q) / (2.0 * v);
+    k = sqrt(u + v + w * w) - w;
+    D = k * sqrt(X * X + Y * Y) / (k + e2);
+    dist = sqrt(D * D + Z * Z);
+
+    y[io] = 2.0 * atan2(Z, D + dist);           /* Latitude */
+    x[io] = atan2(Y, X);                        /* Longitude */
+    z[io] = (k + e2 - 1.0) * dist / k;          /* Height */
+  }
+} /* END OF Convert_Geocentric_To_Geodetic_Batch */
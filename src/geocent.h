@@ -153,14 +153,14 @@ long pj_Convert_Geodetic_To_Geocentric ( GeocentricInfo *gi,
 
 void pj_Convert_Geocentric_To_Geodetic (GeocentricInfo *gi,
                                         double X,
-                                        double Y, 
+                                        double Y,
                                         double Z,
                                         double *Latitude,
                                         double *Longitude,
                                         double *Height);
 /*
  * The function Convert_Geocentric_To_Geodetic converts geocentric
- * coordinates (X, Y, Z) to geodetic coordinates (latitude, longitude, 
+ * coordinates (X, Y, Z) to geodetic coordinates (latitude, longitude,
  * and height), according to the current ellipsoid parameters.
  *
  *    X         : Geocentric X coordinate, in meters.         (input)
@@ -172,6 +172,44 @@ void pj_Convert_Geocentric_To_Geodetic (GeocentricInfo *gi,
  */
 
 
+long pj_Convert_Geodetic_To_Geocentric_Batch (GeocentricInfo *gi,
+                                              long point_count,
+                                              int point_offset,
+                                              double *x,
+                                              double *y,
+                                              double *z);
+/*
+ * The function Convert_Geodetic_To_Geocentric_Batch converts an array
+ * of geodetic coordinates (x = longitude, y = latitude, z = height) to
+ * geocentric coordinates (X, Y, Z) in place, skipping points marked
+ * HUGE_VAL and marking points with an invalid latitude HUGE_VAL.
+ *
+ *    gi           : Ellipsoid parameters                          (input)
+ *    point_count  : Number of points in the arrays                (input)
+ *    point_offset : Stride between successive array values        (input)
+ *    x, y, z      : Coordinate arrays, converted in place  (input/output)
+ */
+
+
+void pj_Convert_Geocentric_To_Geodetic_Batch (GeocentricInfo *gi,
+                                              long point_count,
+                                              int point_offset,
+                                              double *x,
+                                              double *y,
+                                              double *z);
+/*
+ * The function Convert_Geocentric_To_Geodetic_Batch converts an array
+ * of geocentric coordinates (X, Y, Z) to geodetic coordinates (x =
+ * longitude, y = latitude, z = height) in place, skipping points marked
+ * HUGE_VAL, using a closed form conversion instead of the iterative one.
+ *
+ *    gi           : Ellipsoid parameters                          (input)
+ *    point_count  : Number of points in the arrays                (input)
+ *    point_offset : Stride between successive array values        (input)
+ *    x, y, z      : Coordinate arrays, converted in place  (input/output)
+ */
+
+
 #ifdef __cplusplus
 }
 #endif
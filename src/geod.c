@@ -6,6 +6,13 @@
 # include <stdio.h>
 # include <string.h>
 
+#if !defined(_WIN32) && !defined(WIN32)
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
 # define MAXLINE 200
 # define MAX_PARGS 50
 # define TAB putchar('\t')
@@ -13,13 +20,14 @@
 fullout = 0,	/* output full set of geodesic values */
 tag = '#',	/* beginning of line tag character */
 pos_azi = 0,	/* output azimuths as positive values */
+njobs = 0,	/* > 1 processes mmap'ed file input in parallel line ranges */
 inverse = 0;	/* != 0 then inverse geodesic */
 	static char
 *oform = (char *)0,	/* output format for decimal degrees */
 *osform = "%.3f",	/* output format for S */
 pline[50],		/* work string */
 *usage =
-"%s\nusage: %s [ -afFIptTwW [args] ] [ +opts[=arg] ] [ files ]\n";
+"%s\nusage: %s [ -afFIjptTwW [args] ] [ +opts[=arg] ] [ files ]\n";
 	static void
 printLL(double p, double l) {
 	if (oform) {
@@ -42,18 +50,252 @@ do_arc(void) {
 		printLL(phi2, lam2); putchar('\n');
 	}
 }
+# define GEOD_CHUNK 1024
 	static void	/* generate intermediate geodesic coordinates */
 do_geod(void) {
-	double phil, laml, del_S;
+	double phil, laml, del_S, degree = PI / 180.;
+	double s[GEOD_CHUNK], lat2[GEOD_CHUNK], lon2[GEOD_CHUNK];
+	int i, done, count;
 
 	phil = phi2;
 	laml = lam2;
 	printLL(phi1, lam1); putchar('\n');
-	for ( geod_S = del_S = geod_S / n_S; --n_S; geod_S += del_S) {
-		geod_for();
-		printLL(phi2, lam2); putchar('\n');
+	/* the line through phi1/lam1 with azimuth al12 is solved once;
+	** the samples are then evaluated a chunk at a time */
+	del_S = geod_S / n_S;
+	for (done = 1; done < n_S; done += count) {
+		count = n_S - done < GEOD_CHUNK ? n_S - done : GEOD_CHUNK;
+		for (i = 0; i < count; ++i)
+			s[i] = del_S * (done + i);
+		geod_sample_line(&GlobalGeodesic, phi1 / degree, lam1 / degree,
+			al12 / degree, count, s, lat2, lon2, (double *)0);
+		for (i = 0; i < count; ++i) {
+			printLL(lat2[i] * degree, lon2[i] * degree);
+			putchar('\n');
+		}
 	}
 	printLL(phil, laml); putchar('\n');
+}
+	struct range {	/* one slice of mmap'ed input lines and its output */
+	const char *beg, *end;	/* [beg,end), end on a line boundary */
+	char *out;
+	size_t out_len, out_cap;
+};
+	static void	/* append len bytes to a range's output buffer */
+range_append(struct range *r, const char *s, size_t len) {
+	if (r->out_len + len > r->out_cap) {
+		size_t cap = r->out_cap ? r->out_cap * 2 : 4096;
+		char *nb;
+
+		while (cap < r->out_len + len)
+			cap *= 2;
+		if (!(nb = (char *)pj_malloc(cap)))
+			emess(2,"range output allocation failed");
+		if (r->out) {
+			memcpy(nb, r->out, r->out_len);
+			pj_dalloc(r->out);
+		}
+		r->out = nb;
+		r->out_cap = cap;
+	}
+	memcpy(r->out + r->out_len, s, len);
+	r->out_len += len;
+}
+	static void	/* printLL() into a range's output buffer */
+range_LL(struct range *r, double p, double l) {
+	char wbuf[50], obuf[64], *t;
+
+	if (oform) {
+		(void)sprintf(obuf, oform, p * RAD_TO_DEG);
+		range_append(r, obuf, strlen(obuf));
+		range_append(r, "\t", 1);
+		(void)sprintf(obuf, oform, l * RAD_TO_DEG);
+		range_append(r, obuf, strlen(obuf));
+	} else {
+		t = rtodms_fast(wbuf, p, 'N', 'S');
+		range_append(r, t, strlen(t));
+		range_append(r, "\t", 1);
+		t = rtodms_fast(wbuf, l, 'E', 'W');
+		range_append(r, t, strlen(t));
+	}
+}
+	static void	/* parse, solve and format one line range; runs on
+	** the worker pool, so everything goes through the reentrant
+	** geod_*_array() interface and the range's output buffer - the
+	** GEODESIC globals stay untouched */
+process_range(void *arg) {
+	struct range *r = (struct range *)arg;
+	const char *p = r->beg;
+	char line[MAXLINE+3], wbuf[50], obuf[64], *s, *t;
+	double b_phi1, b_lam1, b_phi2, b_lam2, b_al12, b_al21, b_S;
+
+	while (p < r->end) {
+		const char *nl = memchr(p, '\n', r->end - p);
+		size_t len = nl ? (size_t)(nl - p) + 1 : (size_t)(r->end - p);
+
+		/* mirror the fgets() path: overlong lines are truncated
+		** and the remainder dropped, the final line gets its
+		** missing newline */
+		if (len > MAXLINE - 1) {
+			memcpy(line, p, MAXLINE - 1);
+			line[MAXLINE - 1] = '\n';
+			line[MAXLINE] = '\0';
+		} else {
+			memcpy(line, p, len);
+			if (!len || line[len - 1] != '\n')
+				line[len++] = '\n';
+			line[len] = '\0';
+		}
+		p = nl ? nl + 1 : r->end;
+		if (*line == tag) {
+			range_append(r, line, strlen(line));
+			continue;
+		}
+		s = line;
+		b_phi1 = dmstor(s, &s);
+		b_lam1 = dmstor(s, &s);
+		if (inverse) {
+			b_phi2 = dmstor(s, &s);
+			b_lam2 = dmstor(s, &s);
+			geod_inv_array(&GlobalGeodesic, 1,
+				&b_phi1, &b_lam1, &b_phi2, &b_lam2,
+				&b_al12, &b_al21, &b_S);
+		} else {
+			b_al12 = dmstor(s, &s);
+			b_S = strtod(s, &s) * to_meter;
+			geod_for_array(&GlobalGeodesic, 1,
+				&b_phi1, &b_lam1, &b_al12, &b_S,
+				&b_phi2, &b_lam2, &b_al21);
+		}
+		if (!*s && (s > line)) --s; /* assumed we gobbled \n */
+		if (pos_azi) {
+			if (b_al12 < 0.) b_al12 += TWOPI;
+			if (b_al21 < 0.) b_al21 += TWOPI;
+		}
+		if (fullout) {
+			range_LL(r, b_phi1, b_lam1); range_append(r, "\t", 1);
+			range_LL(r, b_phi2, b_lam2); range_append(r, "\t", 1);
+			if (oform) {
+				(void)sprintf(obuf, oform, b_al12 * RAD_TO_DEG);
+				range_append(r, obuf, strlen(obuf));
+				range_append(r, "\t", 1);
+				(void)sprintf(obuf, oform, b_al21 * RAD_TO_DEG);
+				range_append(r, obuf, strlen(obuf));
+				range_append(r, "\t", 1);
+				(void)sprintf(obuf, osform, b_S * fr_meter);
+				range_append(r, obuf, strlen(obuf));
+			} else {
+				t = rtodms_fast(wbuf, b_al12, 0, 0);
+				range_append(r, t, strlen(t));
+				range_append(r, "\t", 1);
+				t = rtodms_fast(wbuf, b_al21, 0, 0);
+				range_append(r, t, strlen(t));
+				range_append(r, "\t", 1);
+				(void)sprintf(obuf, osform, b_S * fr_meter);
+				range_append(r, obuf, strlen(obuf));
+			}
+		} else if (inverse) {
+			if (oform) {
+				(void)sprintf(obuf, oform, b_al12 * RAD_TO_DEG);
+				range_append(r, obuf, strlen(obuf));
+				range_append(r, "\t", 1);
+				(void)sprintf(obuf, oform, b_al21 * RAD_TO_DEG);
+				range_append(r, obuf, strlen(obuf));
+				range_append(r, "\t", 1);
+				(void)sprintf(obuf, osform, b_S * fr_meter);
+				range_append(r, obuf, strlen(obuf));
+			} else {
+				t = rtodms_fast(wbuf, b_al12, 0, 0);
+				range_append(r, t, strlen(t));
+				range_append(r, "\t", 1);
+				t = rtodms_fast(wbuf, b_al21, 0, 0);
+				range_append(r, t, strlen(t));
+				range_append(r, "\t", 1);
+				(void)sprintf(obuf, osform, b_S * fr_meter);
+				range_append(r, obuf, strlen(obuf));
+			}
+		} else {
+			range_LL(r, b_phi2, b_lam2); range_append(r, "\t", 1);
+			if (oform) {
+				(void)sprintf(obuf, oform, b_al21 * RAD_TO_DEG);
+				range_append(r, obuf, strlen(obuf));
+			} else {
+				t = rtodms_fast(wbuf, b_al21, 0, 0);
+				range_append(r, t, strlen(t));
+			}
+		}
+		range_append(r, s, strlen(s));
+	}
+}
+#define RANGE_MIN_BYTES 65536
+	static int	/* mmap a plain file input and process its line
+	** ranges on the worker pool, writing results in input order;
+	** returns 0 when the input cannot be mapped and the caller must
+	** fall back to the line-at-a-time path */
+process_mmapped(FILE *fid) {
+#if defined(_WIN32) || defined(WIN32)
+	(void)fid;
+	return 0;
+#else
+	struct stat sb;
+	const char *base, *p, *file_end;
+	struct range *ranges;
+	void **args;
+	long target;
+	int nr, k;
+
+	if (fstat(fileno(fid), &sb) != 0 || !S_ISREG(sb.st_mode)
+		|| sb.st_size <= 0)
+		return 0;
+	base = (const char *)mmap(NULL, (size_t)sb.st_size, PROT_READ,
+		MAP_PRIVATE, fileno(fid), 0);
+	if (base == (const char *)MAP_FAILED)
+		return 0;
+	file_end = base + sb.st_size;
+
+	/* tiny inputs are not worth the fan out */
+	nr = njobs;
+	while (nr > 1 && sb.st_size / nr < RANGE_MIN_BYTES)
+		--nr;
+
+	if (!(ranges = (struct range *)pj_malloc(sizeof(struct range) * nr
+			+ sizeof(void *) * nr))) {
+		(void)munmap((void *)base, (size_t)sb.st_size);
+		return 0;
+	}
+	args = (void **)(ranges + nr);
+
+	target = (long)(sb.st_size / nr);
+	p = base;
+	for (k = 0; k < nr; ++k) {
+		const char *q;
+
+		ranges[k].beg = p;
+		if (k == nr - 1 || p + target >= file_end)
+			q = file_end;
+		else {
+			q = memchr(p + target, '\n', file_end - (p + target));
+			q = q ? q + 1 : file_end;
+		}
+		ranges[k].end = q;
+		ranges[k].out = NULL;
+		ranges[k].out_len = ranges[k].out_cap = 0;
+		args[k] = ranges + k;
+		p = q;
+	}
+
+	pj_tpool_run(process_range, args, nr);
+
+	for (k = 0; k < nr; ++k) {
+		if (ranges[k].out_len)
+			(void)fwrite(ranges[k].out, 1, ranges[k].out_len, stdout);
+		if (ranges[k].out)
+			pj_dalloc(ranges[k].out);
+	}
+	pj_dalloc(ranges);
+	(void)munmap((void *)base, (size_t)sb.st_size);
+	return 1;
+#endif
 }
 	void static	/* file processing function */
 process(FILE *fid) {
@@ -152,6 +394,12 @@ int main(int argc, char **argv) {
 			case 'I': /* alt. inverse spec. */
 				inverse = 1;
 				continue;
+			case 'j': /* parallel processing of mmap'ed file input */
+				if (--argc <= 0)
+					emess(1,"missing argument for -j");
+				njobs = atoi(*++argv);
+				if (njobs < 0) njobs = 0;
+				continue;
 			case 't': /* set col. one char */
 				if (arg[1]) tag = *++arg;
 				else emess(1,"missing -t col. 1 tag");
@@ -228,7 +476,10 @@ noargument:		   emess(1,"missing argument for -%c",*arg);
 				emess_dat.File_name = *eargv;
 			}
 			emess_dat.File_line = 0;
-			process(fid);
+			if (njobs > 1 && process_mmapped(fid))
+				; /* mmap'ed parallel path handled the whole file */
+			else
+				process(fid);
 			(void)fclose(fid);
 			emess_dat.File_name = (char *)0;
 		}
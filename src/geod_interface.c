@@ -32,3 +32,44 @@ void geod_inv(void) {
   azi2 += azi2 >= 0 ? -180 : 180; /* Compute back azimuth */
   al12 = azi1 * degree; al21 = azi2 * degree; geod_S = s12;
 }
+
+/* Reentrant array interface.  The historic entry points above funnel
+   through the file scope GEODESIC/GlobalGeodesic globals, which caps
+   the tools at one thread; new callers (and the geod -j path) use
+   these instead.  Angles are radians and distances meters with the
+   same back azimuth convention, matching the globals they deprecate.
+   Any output array may be NULL. */
+
+void geod_inv_array(const struct geod_geodesic *g, int n,
+                    const double *aphi1, const double *alam1,
+                    const double *aphi2, const double *alam2,
+                    double *aal12, double *aal21, double *as) {
+  double degree = PI / 180, azi1, azi2, s12;
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    geod_inverse(g, aphi1[i] / degree, alam1[i] / degree,
+                 aphi2[i] / degree, alam2[i] / degree, &s12, &azi1, &azi2);
+    azi2 += azi2 >= 0 ? -180 : 180; /* Compute back azimuth */
+    if (aal12) aal12[i] = azi1 * degree;
+    if (aal21) aal21[i] = azi2 * degree;
+    if (as) as[i] = s12;
+  }
+}
+
+void geod_for_array(const struct geod_geodesic *g, int n,
+                    const double *aphi1, const double *alam1,
+                    const double *aal12, const double *as,
+                    double *aphi2, double *alam2, double *aal21) {
+  double degree = PI / 180, lat2, lon2, azi2;
+  int i;
+
+  for (i = 0; i < n; ++i) {
+    geod_direct(g, aphi1[i] / degree, alam1[i] / degree,
+                aal12[i] / degree, as[i], &lat2, &lon2, &azi2);
+    azi2 += azi2 >= 0 ? -180 : 180; /* Compute back azimuth */
+    if (aphi2) aphi2[i] = lat2 * degree;
+    if (alam2) alam2[i] = lon2 * degree;
+    if (aal21) aal21[i] = azi2 * degree;
+  }
+}
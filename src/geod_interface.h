@@ -13,6 +13,11 @@ extern "C" {
 #  define GEOD_EXTERN
 #endif
 
+/* The file scope globals below (and the entry points working through
+   them) are retained for the historic single threaded tools but are
+   deprecated: they cannot be used from more than one thread.  New
+   code should use the reentrant geod_inv_array()/geod_for_array()
+   interface at the bottom of this header. */
 GEOD_EXTERN struct geodesic {
   double A, FLAT, LAM1, PHI1, ALPHA12, LAM2, PHI2, ALPHA21, DIST;
 } GEODESIC;
@@ -38,6 +43,21 @@ void geod_pre(void);
 void geod_for(void);
 void geod_inv(void);
 
+/* Reentrant array interface (radians / meters, same back azimuth
+   convention as the globals).  Inverse: point pairs in, forward and
+   back azimuths and distance out.  Forward: origin, azimuth and
+   distance in, end point and back azimuth out.  Any output array may
+   be NULL.  Parameter names are omitted: the macros above would
+   capture them. */
+void geod_inv_array(const struct geod_geodesic *, int,
+                    const double *, const double *,
+                    const double *, const double *,
+                    double *, double *, double *);
+void geod_for_array(const struct geod_geodesic *, int,
+                    const double *, const double *,
+                    const double *, const double *,
+                    double *, double *, double *);
+
 #ifdef __cplusplus
 }
 #endif
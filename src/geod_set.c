@@ -20,6 +20,7 @@ geod_set(int argc, char **argv) {
 			curr = curr->next = pj_mkparam(argv[i]);
 		else
 			start = curr = pj_mkparam(argv[i]);
+	pj_param_index(start);
 	/* set elliptical parameters */
 	if (pj_ell_set(pj_get_default_ctx(),start, &geod_a, &es)) emess(1,"ellipse setup failure");
 	/* set units */
@@ -59,8 +60,5 @@ geod_set(int argc, char **argv) {
 			emess(1,"no interval divisor selected");
 	}
 	/* free up linked list */
-	for ( ; start; start = curr) {
-		curr = start->next;
-		pj_dalloc(start);
-	}
+	pj_free_paralist(start);
 }
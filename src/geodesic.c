@@ -237,8 +237,45 @@ static void accadd(real s[], real y);
 static real accsum(const real s[], real y);
 static void accneg(real s[]);
 
+/* WGS84 shows up in effectively all PROJ datum traffic, and geod_init()
+ * is run once per projection object, so its series setup (A3coeff,
+ * C3coeff, C4coeff plus the authalic radius) is worth skipping for that
+ * one ellipsoid.  The table below holds the exact doubles the general
+ * code computes for a = 6378137, f = 1/298.257223563; geod_init()
+ * copies it whenever those parameters are requested, so the resulting
+ * object is bit-identical to one initialized the long way. */
+static const struct geod_geodesic wgs84_geodesic = {
+  6378137, 0.0033528106647474805, 0.99664718933525254,
+  0.0066943799901413165, 0.0067394967422764341,
+  0.0016792203863837047, 6356752.3142451793, 40589732499314.758,
+  3.6424611488788524e-08,
+  { -0.0234375,
+    -0.046927475637074494,
+    -0.062815030058766069,
+    -0.25020884513038322,
+    -0.49916038980680816,
+    1 },
+  { 0.0234375, 0.039088737818537243, 0.046953669396531957,
+    0.12499964752736174, 0.24958019490340408, 0.01953125,
+    0.023450618909268622, 0.046822392185686165, 0.062342661206936094,
+    0.013671875, 0.023393770302437927, 0.025963026642854565,
+    0.013671875, 0.013625958817559821, 0.0082031250000000003 },
+  { 0.0064602064602064602, 0.0035037627212872787, 0.034742279454780166,
+    -0.019217322232448649, -0.19923321555984239, 0.66621908946426034,
+    0.000111000111000111, 0.0034266206029710021, -0.0095107653725977348,
+    -0.018934136912355921, 0.022137023951093598, 0.00074592074592074592,
+    -0.004142006291321442, -0.0050422517630900497, 0.0075849821777460788,
+    -0.0021565735851450138, -0.0019626133706706918, 0.0036104265913438913,
+    -0.00094720094720094716, 0.0020416649913317735, 0.0012916376552740189 }
+};
+
 void geod_init(struct geod_geodesic* g, real a, real f) {
   if (!init) Init();
+  if (a == wgs84_geodesic.a &&
+      (f == wgs84_geodesic.f || (f > 1 && 1/f == wgs84_geodesic.f))) {
+    *g = wgs84_geodesic;
+    return;
+  }
   g->a = a;
   g->f = f <= 1 ? f : 1/f;
   g->f1 = 1 - g->f;
@@ -267,10 +304,15 @@ void geod_init(struct geod_geodesic* g, real a, real f) {
   C4coeff(g);
 }
 
-void geod_lineinit(struct geod_geodesicline* l,
-                   const struct geod_geodesic* g,
-                   real lat1, real lon1, real azi1, unsigned caps) {
-  real alp1, cbet1, sbet1, phi, eps;
+/* Shared body of geod_lineinit(): the caller supplies the reduced
+ * latitude of point 1 (sbet1, cbet1, already normalized), which lets
+ * fixed-origin callers hoist that work out of their loops. */
+static void geod_lineinit_int(struct geod_geodesicline* l,
+                              const struct geod_geodesic* g,
+                              real lat1, real lon1,
+                              real sbet1, real cbet1,
+                              real azi1, unsigned caps) {
+  real alp1, eps;
   l->a = g->a;
   l->f = g->f;
   l->b = g->b;
@@ -291,11 +333,6 @@ void geod_lineinit(struct geod_geodesicline* l,
    * problems directly than to skirt them. */
   l->salp1 =      l->azi1  == -180 ? 0 : sin(alp1);
   l->calp1 = fabs(l->azi1) ==   90 ? 0 : cos(alp1);
-  phi = lat1 * degree;
-  /* Ensure cbet1 = +epsilon at poles */
-  sbet1 = l->f1 * sin(phi);
-  cbet1 = fabs(lat1) == 90 ? tiny : cos(phi);
-  norm2(&sbet1, &cbet1);
   l->dn1 = sqrt(1 + g->ep2 * sq(sbet1));
 
   /* Evaluate alp0 from sin(alp1) * cos(bet1) = sin(alp0), */
@@ -356,6 +393,18 @@ void geod_lineinit(struct geod_geodesicline* l,
   }
 }
 
+void geod_lineinit(struct geod_geodesicline* l,
+                   const struct geod_geodesic* g,
+                   real lat1, real lon1, real azi1, unsigned caps) {
+  real phi, sbet1, cbet1;
+  phi = lat1 * degree;
+  /* Ensure cbet1 = +epsilon at poles */
+  sbet1 = g->f1 * sin(phi);
+  cbet1 = fabs(lat1) == 90 ? tiny : cos(phi);
+  norm2(&sbet1, &cbet1);
+  geod_lineinit_int(l, g, lat1, lon1, sbet1, cbet1, azi1, caps);
+}
+
 real geod_genposition(const struct geod_geodesicline* l,
                       unsigned flags, real s12_a12,
                       real* plat2, real* plon2, real* pazi2,
@@ -595,14 +644,45 @@ void geod_direct(const struct geod_geodesic* g,
                  0, 0, 0, 0, 0);
 }
 
-real geod_geninverse(const struct geod_geodesic* g,
-                     real lat1, real lon1, real lat2, real lon2,
+/* The ingredients of the inverse problem that depend on a single endpoint:
+ * the normalized coordinates, the reduced latitude trig, and the
+ * dn = sqrt(1 + ep2 * sin(bet)^2) factor.  Matrix solvers compute these
+ * once per point instead of once per pair; see geod_inverse_matrix(). */
+struct geod_invpoint {
+  real lat, lon;                /* AngRound/AngNormalize already applied */
+  real sbet, cbet, dn;
+};
+
+static void invpoint_init(const struct geod_geodesic* g,
+                          struct geod_invpoint* p, real lat, real lon) {
+  real phi;
+  p->lon = AngNormalize(lon);
+  /* If really close to the equator, treat as on equator. */
+  lat = AngRound(lat);
+  p->lat = lat;
+  phi = lat * degree;
+  /* Ensure cbet = +epsilon at poles */
+  p->sbet = g->f1 * sin(phi);
+  p->cbet = fabs(lat) == 90 ? tiny : cos(phi);
+  norm2(&p->sbet, &p->cbet);
+  p->dn = sqrt(1 + g->ep2 * sq(p->sbet));
+}
+
+/* The workhorse for the inverse problem, taking both endpoints in the
+ * precomputed invpoint_init() form.  errtol > 0 loosens the Newton
+ * convergence test on the longitude mismatch (radians) so callers who can
+ * live with reduced accuracy save the final iteration; errtol = 0 gives
+ * the standard full-precision behavior. */
+static real geod_geninverse_pre(const struct geod_geodesic* g,
+                     const struct geod_invpoint* p1,
+                     const struct geod_invpoint* p2,
                      real* ps12, real* pazi1, real* pazi2,
-                     real* pm12, real* pM12, real* pM21, real* pS12) {
+                     real* pm12, real* pM12, real* pM21, real* pS12,
+                     real errtol) {
   real s12 = 0, azi1 = 0, azi2 = 0, m12 = 0, M12 = 0, M21 = 0, S12 = 0;
-  real lon12;
+  real lat1, lat2, lon12;
   int latsign, lonsign, swapp;
-  real phi, sbet1, cbet1, sbet2, cbet2, s12x = 0, m12x = 0;
+  real sbet1, cbet1, sbet2, cbet2, s12x = 0, m12x = 0;
   real dn1, dn2, lam12, slam12, clam12;
   real a12 = 0, sig12, calp1 = 0, salp1 = 0, calp2 = 0, salp2 = 0;
   /* index zero elements of these arrays are unused */
@@ -621,20 +701,21 @@ real geod_geninverse(const struct geod_geodesic* g,
   /* Compute longitude difference (AngDiff does this carefully).  Result is
    * in [-180, 180] but -180 is only for west-going geodesics.  180 is for
    * east-going and meridional geodesics. */
-  lon12 = AngDiff(AngNormalize(lon1), AngNormalize(lon2));
+  lon12 = AngDiff(p1->lon, p2->lon);
   /* If very close to being on the same half-meridian, then make it so. */
   lon12 = AngRound(lon12);
   /* Make longitude difference positive. */
   lonsign = lon12 >= 0 ? 1 : -1;
   lon12 *= lonsign;
-  /* If really close to the equator, treat as on equator. */
-  lat1 = AngRound(lat1);
-  lat2 = AngRound(lat2);
+  lat1 = p1->lat;
+  lat2 = p2->lat;
   /* Swap points so that point with higher (abs) latitude is point 1 */
   swapp = fabs(lat1) >= fabs(lat2) ? 1 : -1;
   if (swapp < 0) {
+    const struct geod_invpoint* tp = p1;
     lonsign *= -1;
     swapx(&lat1, &lat2);
+    p1 = p2; p2 = tp;
   }
   /* Make lat1 <= 0 */
   latsign = lat1 < 0 ? 1 : -1;
@@ -652,17 +733,10 @@ real geod_geninverse(const struct geod_geodesic* g,
    * check, e.g., on verifying quadrants in atan2.  In addition, this
    * enforces some symmetries in the results returned. */
 
-  phi = lat1 * degree;
-  /* Ensure cbet1 = +epsilon at poles */
-  sbet1 = g->f1 * sin(phi);
-  cbet1 = lat1 == -90 ? tiny : cos(phi);
-  norm2(&sbet1, &cbet1);
-
-  phi = lat2 * degree;
-  /* Ensure cbet2 = +epsilon at poles */
-  sbet2 = g->f1 * sin(phi);
-  cbet2 = fabs(lat2) == 90 ? tiny : cos(phi);
-  norm2(&sbet2, &cbet2);
+  /* The reduced latitude trig is odd (sbet) / even (cbet, dn) in lat, so
+   * the precomputed values reach canonical form with just a sign flip. */
+  sbet1 = latsign * p1->sbet; cbet1 = p1->cbet; dn1 = p1->dn;
+  sbet2 = latsign * p2->sbet; cbet2 = p2->cbet; dn2 = p2->dn;
 
   /* If cbet1 < -sbet1, then cbet2 - cbet1 is a sensitive measure of the
    * |bet1| - |bet2|.  Alternatively (cbet1 >= -sbet1), abs(sbet2) + sbet1 is
@@ -680,9 +754,6 @@ real geod_geninverse(const struct geod_geodesic* g,
       cbet2 = cbet1;
   }
 
-  dn1 = sqrt(1 + g->ep2 * sq(sbet1));
-  dn2 = sqrt(1 + g->ep2 * sq(sbet2));
-
   lam12 = lon12 * degree;
   slam12 = lon12 == 180 ? 0 : sin(lam12);
   clam12 = cos(lam12);      /* lon12 == 90 isn't interesting */
@@ -775,6 +846,8 @@ real geod_geninverse(const struct geod_geodesic* g,
        * estimate of alp1 lies outside (0,pi); in this case, the new starting
        * guess is taken to be (alp1a + alp1b) / 2. */
       real ssig1 = 0, csig1 = 0, ssig2 = 0, csig2 = 0, eps = 0;
+      /* 2 * tol0 is approximately 1 ulp for a number in [0, pi]. */
+      real vtol = errtol > 0 ? errtol : 2 * tol0;
       unsigned numit = 0;
       /* Bracketing range */
       real salp1a = tiny, calp1a = 1, salp1b = tiny, calp1b = -1;
@@ -787,9 +860,8 @@ real geod_geninverse(const struct geod_geodesic* g,
                         &salp2, &calp2, &sig12, &ssig1, &csig1, &ssig2, &csig2,
                         &eps, &omg12, numit < maxit1, &dv, C1a, C2a, C3a)
                - lam12);
-        /* 2 * tol0 is approximately 1 ulp for a number in [0, pi]. */
         /* Reversed test to allow escape with NaNs */
-        if (tripb || !(fabs(v) >= (tripn ? 8 : 2) * tol0)) break;
+        if (tripb || !(fabs(v) >= (tripn ? 8 * tol0 : vtol))) break;
         /* Update bracketing values */
         if (v > 0 && (numit > maxit1 || calp1/salp1 > calp1b/salp1b))
           { salp1b = salp1; calp1b = calp1; }
@@ -941,12 +1013,252 @@ real geod_geninverse(const struct geod_geodesic* g,
   return a12;
 }
 
+static real geod_geninverse_int(const struct geod_geodesic* g,
+                     real lat1, real lon1, real lat2, real lon2,
+                     real* ps12, real* pazi1, real* pazi2,
+                     real* pm12, real* pM12, real* pM21, real* pS12,
+                     real errtol) {
+  struct geod_invpoint p1, p2;
+  invpoint_init(g, &p1, lat1, lon1);
+  invpoint_init(g, &p2, lat2, lon2);
+  return geod_geninverse_pre(g, &p1, &p2, ps12, pazi1, pazi2,
+                             pm12, pM12, pM21, pS12, errtol);
+}
+
+real geod_geninverse(const struct geod_geodesic* g,
+                     real lat1, real lon1, real lat2, real lon2,
+                     real* ps12, real* pazi1, real* pazi2,
+                     real* pm12, real* pM12, real* pM21, real* pS12) {
+  return geod_geninverse_int(g, lat1, lon1, lat2, lon2, ps12, pazi1, pazi2,
+                             pm12, pM12, pM21, pS12, 0);
+}
+
 void geod_inverse(const struct geod_geodesic* g,
                   real lat1, real lon1, real lat2, real lon2,
                   real* ps12, real* pazi1, real* pazi2) {
   geod_geninverse(g, lat1, lon1, lat2, lon2, ps12, pazi1, pazi2, 0, 0, 0, 0);
 }
 
+/* Coarse convergence target for GEOD_BATCH_COARSE: a longitude mismatch of
+ * 1.5e-10 rad corresponds to about 1 mm on the Earth's equator, which
+ * typically saves the final Newton iteration of the inverse solution. */
+#define COARSE_TOL 1.5e-10
+
+void geod_direct_batch(const struct geod_geodesic* g, int n,
+                       const double lat1[], const double lon1[],
+                       const double azi1[], const double s12[],
+                       double plat2[], double plon2[], double pazi2[],
+                       unsigned flags) {
+  int i;
+  (void) flags;                 /* the direct solution is non-iterative */
+  for (i = 0; i < n; ++i)
+    geod_direct(g, lat1[i], lon1[i], azi1[i], s12[i],
+                plat2 ? plat2 + i : 0,
+                plon2 ? plon2 + i : 0,
+                pazi2 ? pazi2 + i : 0);
+}
+
+void geod_sample_line(const struct geod_geodesic* g,
+                      double lat1, double lon1, double azi1, int n,
+                      const double s12[],
+                      double plat2[], double plon2[], double pazi2[]) {
+  struct geod_geodesicline l;
+  int i;
+  geod_lineinit(&l, g, lat1, lon1, azi1,
+                GEOD_LATITUDE | GEOD_LONGITUDE | GEOD_AZIMUTH |
+                GEOD_DISTANCE_IN);
+  for (i = 0; i < n; ++i)
+    geod_position(&l, s12[i],
+                  plat2 ? plat2 + i : 0,
+                  plon2 ? plon2 + i : 0,
+                  pazi2 ? pazi2 + i : 0);
+}
+
+void geod_direct_from(const struct geod_geodesic* g,
+                      double lat1, double lon1, int n,
+                      const double azi1[], const double s12[],
+                      double plat2[], double plon2[], double pazi2[]) {
+  real phi, sbet1, cbet1;
+  unsigned caps = GEOD_DISTANCE_IN |
+    (plat2 ? GEOD_LATITUDE : 0U) |
+    (plon2 ? GEOD_LONGITUDE : 0U) |
+    (pazi2 ? GEOD_AZIMUTH : 0U);
+  int i;
+  /* The reduced latitude of the common origin depends only on lat1;
+   * compute it once here instead of inside every line setup. */
+  phi = lat1 * degree;
+  /* Ensure cbet1 = +epsilon at poles */
+  sbet1 = g->f1 * sin(phi);
+  cbet1 = fabs(lat1) == 90 ? tiny : cos(phi);
+  norm2(&sbet1, &cbet1);
+  for (i = 0; i < n; ++i) {
+    struct geod_geodesicline l;
+    geod_lineinit_int(&l, g, lat1, lon1, sbet1, cbet1, azi1[i], caps);
+    geod_position(&l, s12[i],
+                  plat2 ? plat2 + i : 0,
+                  plon2 ? plon2 + i : 0,
+                  pazi2 ? pazi2 + i : 0);
+  }
+}
+
+void geod_inverse_batch(const struct geod_geodesic* g, int n,
+                        const double lat1[], const double lon1[],
+                        const double lat2[], const double lon2[],
+                        double ps12[], double pazi1[], double pazi2[],
+                        unsigned flags) {
+  int i;
+  real errtol = (flags & GEOD_BATCH_COARSE) ? COARSE_TOL : 0;
+  for (i = 0; i < n; ++i)
+    geod_geninverse_int(g, lat1[i], lon1[i], lat2[i], lon2[i],
+                        ps12 ? ps12 + i : 0,
+                        pazi1 ? pazi1 + i : 0,
+                        pazi2 ? pazi2 + i : 0,
+                        0, 0, 0, 0, errtol);
+}
+
+/* Serial core of geod_inverse_matrix() over the row range [rbeg, rend).
+ * Rows and columns are walked in GEOD_MATRIX_BLOCK sized tiles so the
+ * per point ingredients (invpoint_init) are computed once per row point
+ * and once per row block for the column points - instead of once per
+ * pair - and so both tiles stay cache resident while the block^2 pairs
+ * are solved.  When the two point sets alias (symmetric) only the upper
+ * triangle is solved: the diagonal is zero and each result is mirrored
+ * across it, which also keeps the row ranges of concurrent workers
+ * writing to disjoint cells. */
+#define GEOD_MATRIX_BLOCK 32
+
+static void inverse_matrix_rows(const struct geod_geodesic* g,
+                                int rbeg, int rend,
+                                const double lats1[], const double lons1[],
+                                int m,
+                                const double lats2[], const double lons2[],
+                                double s12[], int symmetric, real errtol) {
+  struct geod_invpoint rowp[GEOD_MATRIX_BLOCK], colp[GEOD_MATRIX_BLOCK];
+  int ib, jb, i, j;
+  for (ib = rbeg; ib < rend; ib += GEOD_MATRIX_BLOCK) {
+    int ni = rend - ib < GEOD_MATRIX_BLOCK ? rend - ib : GEOD_MATRIX_BLOCK;
+    for (i = 0; i < ni; ++i)
+      invpoint_init(g, rowp + i, lats1[ib + i], lons1[ib + i]);
+    /* column tiles stay aligned to multiples of the block size so the
+     * symmetric case can skip whole tiles below the diagonal */
+    jb = symmetric ? (ib / GEOD_MATRIX_BLOCK) * GEOD_MATRIX_BLOCK : 0;
+    for (; jb < m; jb += GEOD_MATRIX_BLOCK) {
+      int nj = m - jb < GEOD_MATRIX_BLOCK ? m - jb : GEOD_MATRIX_BLOCK;
+      for (j = 0; j < nj; ++j)
+        invpoint_init(g, colp + j, lats2[jb + j], lons2[jb + j]);
+      for (i = 0; i < ni; ++i) {
+        double* row = s12 + (long)(ib + i) * m;
+        for (j = 0; j < nj; ++j) {
+          real s;
+          if (symmetric) {
+            if (jb + j < ib + i)
+              continue;
+            if (jb + j == ib + i) {
+              row[jb + j] = 0;
+              continue;
+            }
+          }
+          geod_geninverse_pre(g, rowp + i, colp + j, &s,
+                              0, 0, 0, 0, 0, 0, errtol);
+          row[jb + j] = s;
+          if (symmetric)
+            s12[(long)(jb + j) * m + (ib + i)] = s;
+        }
+      }
+    }
+  }
+}
+
+#define GEOD_MATRIX_MAX_THREADS 64
+/* below this many pairs the thread launch cost outweighs the win */
+#define GEOD_MATRIX_MIN_PAIRS 4096
+
+#ifdef MUTEX_pthread
+
+#include <pthread.h>
+
+struct geod_matrix_chunk {
+  const struct geod_geodesic* g;
+  int rbeg, rend;
+  const double *lats1, *lons1;
+  int m;
+  const double *lats2, *lons2;
+  double* s12;
+  int symmetric;
+  real errtol;
+};
+
+static void* geod_matrix_worker(void* arg) {
+  struct geod_matrix_chunk* c = (struct geod_matrix_chunk*)arg;
+  inverse_matrix_rows(c->g, c->rbeg, c->rend, c->lats1, c->lons1,
+                      c->m, c->lats2, c->lons2, c->s12,
+                      c->symmetric, c->errtol);
+  return 0;
+}
+
+#endif /* MUTEX_pthread */
+
+/* Row boundary of chunk k of nthr such that each chunk holds about the
+ * same number of solved pairs.  For the symmetric case only the pairs
+ * above the diagonal are solved, so row r carries n - r of them and the
+ * even-work boundaries sit at n * (1 - sqrt(1 - k/nthr)). */
+static int matrix_chunk_row(int n, int k, int nthr, int symmetric) {
+  if (k <= 0) return 0;
+  if (k >= nthr) return n;
+  if (symmetric) {
+    int r = (int)(n * (1 - sqrt(1 - (double)k / nthr)) + 0.5);
+    return r < 0 ? 0 : (r > n ? n : r);
+  }
+  return (int)((double)n * k / nthr + 0.5);
+}
+
+void geod_inverse_matrix(const struct geod_geodesic* g,
+                         int n, const double lats1[], const double lons1[],
+                         int m, const double lats2[], const double lons2[],
+                         double s12[], int nthreads, unsigned flags) {
+  int symmetric = lats1 == lats2 && lons1 == lons2 && n == m;
+  real errtol = (flags & GEOD_BATCH_COARSE) ? COARSE_TOL : 0;
+#ifdef MUTEX_pthread
+  if (nthreads > GEOD_MATRIX_MAX_THREADS)
+    nthreads = GEOD_MATRIX_MAX_THREADS;
+  if (nthreads > 1 && (double)n * m >= GEOD_MATRIX_MIN_PAIRS) {
+    struct geod_matrix_chunk chunk[GEOD_MATRIX_MAX_THREADS];
+    pthread_t thread[GEOD_MATRIX_MAX_THREADS];
+    int k;
+    for (k = 0; k < nthreads; ++k) {
+      chunk[k].g = g;
+      chunk[k].rbeg = matrix_chunk_row(n, k, nthreads, symmetric);
+      chunk[k].rend = matrix_chunk_row(n, k + 1, nthreads, symmetric);
+      chunk[k].lats1 = lats1;
+      chunk[k].lons1 = lons1;
+      chunk[k].m = m;
+      chunk[k].lats2 = lats2;
+      chunk[k].lons2 = lons2;
+      chunk[k].s12 = s12;
+      chunk[k].symmetric = symmetric;
+      chunk[k].errtol = errtol;
+    }
+    for (k = 1; k < nthreads; ++k) {
+      if (pthread_create(thread + k, 0, geod_matrix_worker, chunk + k) != 0) {
+        /* could not launch - run this chunk here instead */
+        thread[k] = pthread_self();
+        geod_matrix_worker(chunk + k);
+      }
+    }
+    geod_matrix_worker(chunk + 0);
+    for (k = 1; k < nthreads; ++k) {
+      if (!pthread_equal(thread[k], pthread_self()))
+        pthread_join(thread[k], 0);
+    }
+    return;
+  }
+#else
+  (void)nthreads;
+#endif /* MUTEX_pthread */
+  inverse_matrix_rows(g, 0, n, lats1, lons1, m, lats2, lons2, s12,
+                      symmetric, errtol);
+}
+
 real SinCosSeries(boolx sinp, real sinx, real cosx, const real c[], int n) {
   /* Evaluate
    * y = sinp ? sum(c[i] * sin( 2*i    * x), i, 1, n) :
@@ -1876,4 +2188,56 @@ void geod_polygonarea(const struct geod_geodesic* g,
   geod_polygon_compute(g, &p, FALSE, TRUE, pA, pP);
 }
 
+void geod_polygon_area_batch(const struct geod_geodesic* g, int npoly,
+                             const int counts[],
+                             const double lats[], const double lons[],
+                             double pA[], double pP[]) {
+  int k;
+  long base = 0;
+  for (k = 0; k < npoly; ++k) {
+    int n = counts[k], i;
+    struct geod_invpoint v0, prev, cur;
+    real P[2], A[2], t[2], s12, S12, area0;
+    int crossings = 0;
+    if (n < 2) {
+      if (pP) pP[k] = 0;
+      if (pA) pA[k] = 0;
+      base += n;
+      continue;
+    }
+    accini(P);
+    accini(A);
+    /* Each interior vertex feeds two edges, so the per vertex trig is
+     * computed once here instead of once per edge by the solver. */
+    invpoint_init(g, &v0, lats[base], lons[base]);
+    prev = v0;
+    for (i = 1; i < n; ++i) {
+      invpoint_init(g, &cur, lats[base + i], lons[base + i]);
+      geod_geninverse_pre(g, &prev, &cur, &s12, 0, 0, 0, 0, 0, &S12, 0);
+      accadd(P, s12);
+      accadd(A, S12);
+      crossings += transit(prev.lon, cur.lon);
+      prev = cur;
+    }
+    /* closing edge back to the first vertex */
+    geod_geninverse_pre(g, &prev, &v0, &s12, 0, 0, 0, 0, 0, &S12, 0);
+    if (pP) pP[k] = accsum(P, s12);
+    acccopy(A, t);
+    accadd(t, S12);
+    crossings += transit(prev.lon, v0.lon);
+    area0 = 4 * pi * g->c2;
+    if (crossings & 1)
+      accadd(t, (t[0] < 0 ? 1 : -1) * area0/2);
+    /* clockwise sense -> counter-clockwise, area in (-area0/2, area0/2]:
+     * the geod_polygonarea() conventions (reverse = FALSE, sign = TRUE) */
+    accneg(t);
+    if (t[0] > area0/2)
+      accadd(t, -area0);
+    else if (t[0] <= -area0/2)
+      accadd(t, +area0);
+    if (pA) pA[k] = 0 + t[0];
+    base += n;
+  }
+}
+
 /** @endcond */
@@ -347,6 +347,153 @@ extern "C" {
                     double lat1, double lon1, double lat2, double lon2,
                     double* ps12, double* pazi1, double* pazi2);
 
+  /**
+   * Solve the direct geodesic problem for an array of points.
+   *
+   * @param[in] g a pointer to the geod_geodesic object specifying the
+   *   ellipsoid.
+   * @param[in] n number of entries in the input and output arrays.
+   * @param[in] lat1 array of latitudes of point 1 (degrees).
+   * @param[in] lon1 array of longitudes of point 1 (degrees).
+   * @param[in] azi1 array of azimuths at point 1 (degrees).
+   * @param[in] s12 array of distances between point 1 and point 2 (meters).
+   * @param[out] plat2 array for the latitudes of point 2 (degrees).
+   * @param[out] plon2 array for the longitudes of point 2 (degrees).
+   * @param[out] pazi2 array for the (forward) azimuths at point 2 (degrees).
+   * @param[in] flags reserved, pass 0 (the direct solution is already
+   *   non-iterative, so there is no coarse variant).
+   *
+   * Equivalent to calling geod_direct() on each entry in turn; any of the
+   * output arrays may be replaced by 0.  This entry point (a PROJ.4
+   * extension, not part of the original geodesic library) exists for
+   * workloads that solve many problems on one ellipsoid.
+   **********************************************************************/
+  void geod_direct_batch(const struct geod_geodesic* g, int n,
+                         const double lat1[], const double lon1[],
+                         const double azi1[], const double s12[],
+                         double plat2[], double plon2[], double pazi2[],
+                         unsigned flags);
+
+  /**
+   * Sample positions along one geodesic line.
+   *
+   * @param[in] g a pointer to the geod_geodesic object specifying the
+   *   ellipsoid.
+   * @param[in] lat1 latitude of point 1 (degrees).
+   * @param[in] lon1 longitude of point 1 (degrees).
+   * @param[in] azi1 azimuth at point 1 (degrees).
+   * @param[in] n number of sample points.
+   * @param[in] s12 array of distances from point 1 (meters); need not be
+   *   sorted and may be negative.
+   * @param[out] plat2 array for the latitudes of the samples (degrees).
+   * @param[out] plon2 array for the longitudes of the samples (degrees).
+   * @param[out] pazi2 array for the (forward) azimuths at the samples
+   *   (degrees).
+   *
+   * The expensive part of the direct problem - solving for the geodesic
+   * through point 1 with the given azimuth - is done once; each sample then
+   * costs only a geod_position() evaluation.  Any of the output arrays may
+   * be replaced by 0.  This entry point (a PROJ.4 extension, not part of
+   * the original geodesic library) exists for densifying paths with very
+   * many points.
+   **********************************************************************/
+  void geod_sample_line(const struct geod_geodesic* g,
+                        double lat1, double lon1, double azi1, int n,
+                        const double s12[],
+                        double plat2[], double plon2[], double pazi2[]);
+
+  /**
+   * Solve the direct geodesic problem for many azimuths and distances
+   * from one fixed origin.
+   *
+   * @param[in] g a pointer to the geod_geodesic object specifying the
+   *   ellipsoid.
+   * @param[in] lat1 latitude of the common point 1 (degrees).
+   * @param[in] lon1 longitude of the common point 1 (degrees).
+   * @param[in] n number of entries in the input and output arrays.
+   * @param[in] azi1 array of azimuths at point 1 (degrees).
+   * @param[in] s12 array of distances from point 1 (meters); may be
+   *   negative.
+   * @param[out] plat2 array for the latitudes of point 2 (degrees).
+   * @param[out] plon2 array for the longitudes of point 2 (degrees).
+   * @param[out] pazi2 array for the (forward) azimuths at point 2
+   *   (degrees).
+   *
+   * Equivalent to calling geod_direct() on each entry in turn, but the
+   * part of the line setup that depends only on the origin's latitude is
+   * computed once for the whole array.  Unlike geod_sample_line(), the
+   * azimuth may differ from entry to entry, which is the access pattern
+   * of an azimuthal projection inverse.  Any of the output arrays may be
+   * replaced by 0.  This entry point (a PROJ.4 extension, not part of
+   * the original geodesic library) exists for projections and range
+   * rings centered on one point.
+   **********************************************************************/
+  void geod_direct_from(const struct geod_geodesic* g,
+                        double lat1, double lon1, int n,
+                        const double azi1[], const double s12[],
+                        double plat2[], double plon2[], double pazi2[]);
+
+  /**
+   * Solve the inverse geodesic problem for an array of point pairs.
+   *
+   * @param[in] g a pointer to the geod_geodesic object specifying the
+   *   ellipsoid.
+   * @param[in] n number of entries in the input and output arrays.
+   * @param[in] lat1 array of latitudes of point 1 (degrees).
+   * @param[in] lon1 array of longitudes of point 1 (degrees).
+   * @param[in] lat2 array of latitudes of point 2 (degrees).
+   * @param[in] lon2 array of longitudes of point 2 (degrees).
+   * @param[out] ps12 array for the distances (meters).
+   * @param[out] pazi1 array for the azimuths at point 1 (degrees).
+   * @param[out] pazi2 array for the (forward) azimuths at point 2 (degrees).
+   * @param[in] flags 0, or GEOD_BATCH_COARSE to loosen the Newton
+   *   convergence test to about 1 mm on the Earth, typically saving the
+   *   final iteration of each solution.
+   *
+   * Equivalent (with \e flags = 0) to calling geod_inverse() on each entry
+   * in turn; any of the output arrays may be replaced by 0.  This entry
+   * point (a PROJ.4 extension, not part of the original geodesic library)
+   * exists for distance-matrix and nearest-neighbor workloads that solve
+   * hundreds of millions of problems on one ellipsoid.
+   **********************************************************************/
+  void geod_inverse_batch(const struct geod_geodesic* g, int n,
+                          const double lat1[], const double lon1[],
+                          const double lat2[], const double lon2[],
+                          double ps12[], double pazi1[], double pazi2[],
+                          unsigned flags);
+
+  /**
+   * Compute the geodesic distance matrix between two sets of points.
+   *
+   * @param[in] g a pointer to the geod_geodesic object specifying the
+   *   ellipsoid.
+   * @param[in] n number of points in the first set.
+   * @param[in] lats1 array of latitudes of the first set (degrees).
+   * @param[in] lons1 array of longitudes of the first set (degrees).
+   * @param[in] m number of points in the second set.
+   * @param[in] lats2 array of latitudes of the second set (degrees).
+   * @param[in] lons2 array of longitudes of the second set (degrees).
+   * @param[out] s12 row-major \e n x \e m array for the distances (meters);
+   *   entry [i*m + j] is the distance from point \e i of the first set to
+   *   point \e j of the second.
+   * @param[in] nthreads number of threads to split the rows over; values
+   *   below 2 (or builds without thread support) solve serially.
+   * @param[in] flags 0, or GEOD_BATCH_COARSE as for geod_inverse_batch().
+   *
+   * Equivalent (with \e flags = 0) to calling geod_inverse() on each of
+   * the n*m pairs, but the per point trigonometry is computed once per
+   * point rather than once per pair, the pairs are walked in cache sized
+   * tiles, and when the two sets are identical (same \e lats1/\e lons1
+   * pointers and \e n == \e m) only the upper triangle is solved with the
+   * rest mirrored.  This entry point (a PROJ.4 extension, not part of the
+   * original geodesic library) exists for all-pairs distance workloads
+   * such as clustering and facility location.
+   **********************************************************************/
+  void geod_inverse_matrix(const struct geod_geodesic* g,
+                           int n, const double lats1[], const double lons1[],
+                           int m, const double lats2[], const double lons2[],
+                           double s12[], int nthreads, unsigned flags);
+
   /**
    * Compute the position along a geod_geodesicline.
    *
@@ -768,6 +915,36 @@ extern "C" {
                         double lats[], double lons[], int n,
                         double* pA, double* pP);
 
+  /**
+   * Compute the areas and perimeters of many geodesic polygons.
+   *
+   * @param[in] g a pointer to the geod_geodesic object specifying the
+   *   ellipsoid.
+   * @param[in] npoly the number of polygons.
+   * @param[in] counts array of \e npoly vertex counts.
+   * @param[in] lats latitudes of the vertices of all the polygons, packed
+   *   back to back (degrees).
+   * @param[in] lons longitudes of the vertices, packed likewise (degrees).
+   * @param[out] pA array for the \e npoly areas (meters<sup>2</sup>).
+   * @param[out] pP array for the \e npoly perimeters (meters).
+   *
+   * Polygon \e k occupies the counts[k] consecutive entries of \e lats and
+   * \e lons following those of polygon \e k - 1.  The results follow the
+   * geod_polygonarea() conventions (signed area, counter-clockwise
+   * positive); polygons with fewer than 2 vertices get area and perimeter
+   * 0.  Either output array may be replaced by 0.  Compared with calling
+   * geod_polygonarea() per polygon, the per vertex trigonometry is
+   * computed once per vertex rather than once per adjoining edge and the
+   * per vertex call overhead is gone.  This entry point (a PROJ.4
+   * extension, not part of the original geodesic library) exists for
+   * streaming area jobs over very many small polygons, e.g. cadastral
+   * parcels.
+   **********************************************************************/
+  void geod_polygon_area_batch(const struct geod_geodesic* g, int npoly,
+                               const int counts[],
+                               const double lats[], const double lons[],
+                               double pA[], double pP[]);
+
   /**
    * mask values for the \e caps argument to geod_lineinit().
    **********************************************************************/
@@ -793,8 +970,9 @@ extern "C" {
     GEOD_ARCMODE      = 1U<<0,  /**< Position given in terms of arc distance */
     GEOD_LONG_UNROLL  = 1U<<15, /**< Unroll the longitude */
     /**< @cond SKIP */
-    GEOD_LONG_NOWRAP  = GEOD_LONG_UNROLL /* For backward compatibility only */
+    GEOD_LONG_NOWRAP  = GEOD_LONG_UNROLL, /* For backward compatibility only */
     /**< @endcond */
+    GEOD_BATCH_COARSE = 1U<<1   /**< Batch solvers: accept ~1 mm error */
   };
 
 #if defined(__cplusplus)
@@ -0,0 +1,549 @@
+/******************************************************************************
+ *
+ * Project:  PROJ.4
+ * Purpose:  Microbenchmarks for the math helper layer.  Where projbench
+ *           times the end-to-end transformation pipeline, helperbench
+ *           times the building blocks that dominate its profiles
+ *           (pj_tsfn, pj_phi2, pj_mlfn/pj_inv_mlfn, pj_qsfn, pj_authlat,
+ *           adjlon, nad_intr, geod_inverse) over realistic inputs -
+ *           latitudes weighted towards populated bands, eccentricities
+ *           of the common ellipsoids - and emits JSON ns/op per helper
+ *           so a regression in one of them is visible before it
+ *           multiplies through every projection that calls it.
+ *
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#define PJ_LIB__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "projects.h"
+#include "geodesic.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+static long point_count = 200000;
+static int repetitions = 5;
+
+/* results fold into this so the optimizer cannot discard the loops */
+static volatile double bench_sink = 0.0;
+
+/************************************************************************/
+/*      Common ellipsoids.  The iterative helpers converge at rates     */
+/*      that depend on eccentricity, so each helper is timed over all   */
+/*      of these and the reported ns/op is the average.                 */
+/************************************************************************/
+
+typedef struct {
+    const char *name;
+    double a;
+    double es;
+} BenchEllps;
+
+static const BenchEllps ellps_list[] = {
+    { "WGS84",  6378137.0,   0.0066943799901413165 },
+    { "clrk66", 6378206.4,   0.006768657997291094 },
+    { "bessel", 6377397.155, 0.006674372230614139 },
+    { "intl",   6378388.0,   0.006722670022333322 },
+};
+
+#define ELLPS_COUNT ((int) (sizeof(ellps_list) / sizeof(ellps_list[0])))
+
+/************************************************************************/
+/*                              bench_now()                             */
+/************************************************************************/
+
+static double bench_now( void )
+
+{
+#ifdef _WIN32
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+/************************************************************************/
+/*                            bench_fill()                              */
+/*                                                                      */
+/*      Deterministic pseudo random latitudes/longitudes (radians).     */
+/*      Latitudes are drawn from weighted bands roughly matching        */
+/*      where coordinates actually come from: most work is northern     */
+/*      mid-latitudes, very little is polar.                            */
+/************************************************************************/
+
+static unsigned long bench_seed = 123456789;
+
+static double bench_rand( void )
+
+{
+    bench_seed = bench_seed * 1103515245 + 12345;
+    return (bench_seed % 100000) / 99999.0;
+}
+
+static void bench_fill( double *phi, double *lam, long n )
+
+{
+    static const struct { double min_lat, max_lat; int weight; }
+    bands[] = {
+        {  20.0,  60.0, 55 },   /* northern mid-latitudes */
+        {   0.0,  20.0, 20 },   /* tropics north */
+        { -40.0,   0.0, 15 },   /* tropics/subtropics south */
+        {  60.0,  72.0,  7 },   /* high north */
+        { -60.0, -40.0,  3 },   /* high south */
+    };
+    long i;
+
+    for( i = 0; i < n; i++ )
+    {
+        int pick = (int) (bench_rand() * 100.0), b = 0, acc = 0;
+
+        while( b < 4 && pick >= (acc += bands[b].weight) )
+            b++;
+        phi[i] = (bands[b].min_lat
+                  + bench_rand() * (bands[b].max_lat - bands[b].min_lat))
+            * DEG_TO_RAD;
+        lam[i] = (bench_rand() * 360.0 - 180.0) * DEG_TO_RAD;
+    }
+}
+
+/************************************************************************/
+/*                            bench_report()                            */
+/*                                                                      */
+/*      One JSON entry.  total_sec is the best-of-repetitions time      */
+/*      for ops evaluations.                                            */
+/************************************************************************/
+
+static int bench_first = 1;
+
+static void bench_report( const char *name, double total_sec, long ops )
+
+{
+    printf( "%s\n    \"%s\": %.2f", bench_first ? "" : ",", name,
+            total_sec * 1e9 / ops );
+    bench_first = 0;
+}
+
+/************************************************************************/
+/*                            bench_tsfn()                              */
+/************************************************************************/
+
+static void bench_tsfn( const double *phi )
+
+{
+    double best = -1.0;
+    int rep, e;
+    long i;
+
+    for( rep = -1; rep < repetitions; rep++ )
+    {
+        double start = bench_now(), sum = 0.0;
+
+        for( e = 0; e < ELLPS_COUNT; e++ )
+        {
+            double ecc = sqrt( ellps_list[e].es );
+
+            for( i = 0; i < point_count; i++ )
+                sum += pj_tsfn( phi[i], sin(phi[i]), ecc );
+        }
+        bench_sink += sum;
+        if( rep >= 0 && (best < 0.0 || bench_now() - start < best) )
+            best = bench_now() - start;
+    }
+    bench_report( "pj_tsfn", best, point_count * ELLPS_COUNT );
+}
+
+/************************************************************************/
+/*                            bench_phi2()                              */
+/************************************************************************/
+
+static void bench_phi2( const double *phi, double *ts )
+
+{
+    projCtx ctx = pj_get_default_ctx();
+    double best = -1.0;
+    int rep, e;
+    long i;
+
+    for( rep = -1; rep < repetitions; rep++ )
+    {
+        double start, sum = 0.0;
+
+        start = 0.0;
+        for( e = 0; e < ELLPS_COUNT; e++ )
+        {
+            double ecc = sqrt( ellps_list[e].es ), now;
+
+            for( i = 0; i < point_count; i++ )
+                ts[i] = pj_tsfn( phi[i], sin(phi[i]), ecc );
+
+            now = bench_now();
+            for( i = 0; i < point_count; i++ )
+                sum += pj_phi2( ctx, ts[i], ecc );
+            start += bench_now() - now;
+        }
+        bench_sink += sum;
+        if( rep >= 0 && (best < 0.0 || start < best) )
+            best = start;
+    }
+    bench_report( "pj_phi2", best, point_count * ELLPS_COUNT );
+}
+
+/************************************************************************/
+/*                            bench_mlfn()                              */
+/************************************************************************/
+
+static void bench_mlfn( const double *phi )
+
+{
+    double best = -1.0;
+    int rep, e;
+    long i;
+
+    for( rep = -1; rep < repetitions; rep++ )
+    {
+        double start = bench_now(), sum = 0.0;
+
+        for( e = 0; e < ELLPS_COUNT; e++ )
+        {
+            double *en = pj_enfn_shared( ellps_list[e].es );
+
+            for( i = 0; i < point_count; i++ )
+                sum += pj_mlfn( phi[i], sin(phi[i]), cos(phi[i]), en );
+        }
+        bench_sink += sum;
+        if( rep >= 0 && (best < 0.0 || bench_now() - start < best) )
+            best = bench_now() - start;
+    }
+    bench_report( "pj_mlfn", best, point_count * ELLPS_COUNT );
+}
+
+/************************************************************************/
+/*                          bench_inv_mlfn()                            */
+/************************************************************************/
+
+static void bench_inv_mlfn( const double *phi, double *ml )
+
+{
+    projCtx ctx = pj_get_default_ctx();
+    double best = -1.0;
+    int rep, e;
+    long i;
+
+    for( rep = -1; rep < repetitions; rep++ )
+    {
+        double start = 0.0, sum = 0.0;
+
+        for( e = 0; e < ELLPS_COUNT; e++ )
+        {
+            double *en = pj_enfn_shared( ellps_list[e].es ), now;
+
+            for( i = 0; i < point_count; i++ )
+                ml[i] = pj_mlfn( phi[i], sin(phi[i]), cos(phi[i]), en );
+
+            now = bench_now();
+            for( i = 0; i < point_count; i++ )
+                sum += pj_inv_mlfn( ctx, ml[i], ellps_list[e].es, en );
+            start += bench_now() - now;
+        }
+        bench_sink += sum;
+        if( rep >= 0 && (best < 0.0 || start < best) )
+            best = start;
+    }
+    bench_report( "pj_inv_mlfn", best, point_count * ELLPS_COUNT );
+}
+
+/************************************************************************/
+/*                            bench_qsfn()                              */
+/************************************************************************/
+
+static void bench_qsfn( const double *phi )
+
+{
+    double best = -1.0;
+    int rep, e;
+    long i;
+
+    for( rep = -1; rep < repetitions; rep++ )
+    {
+        double start = bench_now(), sum = 0.0;
+
+        for( e = 0; e < ELLPS_COUNT; e++ )
+        {
+            double ecc = sqrt( ellps_list[e].es );
+            double one_es = 1.0 - ellps_list[e].es;
+
+            for( i = 0; i < point_count; i++ )
+                sum += pj_qsfn( sin(phi[i]), ecc, one_es );
+        }
+        bench_sink += sum;
+        if( rep >= 0 && (best < 0.0 || bench_now() - start < best) )
+            best = bench_now() - start;
+    }
+    bench_report( "pj_qsfn", best, point_count * ELLPS_COUNT );
+}
+
+/************************************************************************/
+/*                           bench_authlat()                            */
+/************************************************************************/
+
+static void bench_authlat( const double *phi )
+
+{
+    double best = -1.0;
+    int rep, e;
+    long i;
+
+    for( rep = -1; rep < repetitions; rep++ )
+    {
+        double start = bench_now(), sum = 0.0;
+
+        for( e = 0; e < ELLPS_COUNT; e++ )
+        {
+            double *apa = pj_authset_shared( ellps_list[e].es );
+
+            for( i = 0; i < point_count; i++ )
+                sum += pj_authlat( phi[i], apa );
+        }
+        bench_sink += sum;
+        if( rep >= 0 && (best < 0.0 || bench_now() - start < best) )
+            best = bench_now() - start;
+    }
+    bench_report( "pj_authlat", best, point_count * ELLPS_COUNT );
+}
+
+/************************************************************************/
+/*                           bench_adjlon()                             */
+/*                                                                      */
+/*      Mostly in-range longitudes with a sprinkling of wrapped ones,   */
+/*      matching what central meridian subtraction produces.            */
+/************************************************************************/
+
+static void bench_adjlon( const double *lam, double *work )
+
+{
+    double best = -1.0;
+    int rep;
+    long i;
+
+    for( i = 0; i < point_count; i++ )
+        work[i] = i % 8 == 0 ? lam[i] + TWOPI : lam[i];
+
+    for( rep = -1; rep < repetitions; rep++ )
+    {
+        double start = bench_now(), sum = 0.0;
+
+        for( i = 0; i < point_count; i++ )
+            sum += adjlon( work[i] );
+        bench_sink += sum;
+        if( rep >= 0 && (best < 0.0 || bench_now() - start < best) )
+            best = bench_now() - start;
+    }
+    bench_report( "adjlon", best, point_count );
+}
+
+/************************************************************************/
+/*                           bench_nad_intr()                           */
+/*                                                                      */
+/*      Bilinear interpolation over a synthetic conus-sized grid        */
+/*      (one degree cells, arcsecond scale shifts), with query points   */
+/*      scattered over its interior like a batch datum shift would.     */
+/************************************************************************/
+
+static void bench_nad_intr( double *work_x, double *work_y )
+
+{
+    struct CTABLE ct;
+    double best = -1.0;
+    int rep;
+    long i, cells;
+
+    memset( &ct, 0, sizeof(ct) );
+    strcpy( ct.id, "helperbench synthetic" );
+    ct.ll.lam = -125.0 * DEG_TO_RAD;
+    ct.ll.phi = 24.0 * DEG_TO_RAD;
+    ct.del.lam = DEG_TO_RAD;
+    ct.del.phi = DEG_TO_RAD;
+    ct.lim.lam = 58;
+    ct.lim.phi = 26;
+
+    cells = (long) ct.lim.lam * ct.lim.phi;
+    ct.cvs = (FLP *) pj_malloc( sizeof(FLP) * cells );
+    if( ct.cvs == NULL )
+    {
+        fprintf( stderr, "helperbench: out of memory for grid\n" );
+        exit( 1 );
+    }
+    for( i = 0; i < cells; i++ )
+    {
+        ct.cvs[i].lam = (float) ((bench_rand() - .5) * 2.0e-5);
+        ct.cvs[i].phi = (float) ((bench_rand() - .5) * 2.0e-5);
+    }
+
+    /* grid relative query coordinates, strictly interior */
+    for( i = 0; i < point_count; i++ )
+    {
+        work_x[i] = bench_rand() * (ct.lim.lam - 1.001) * ct.del.lam;
+        work_y[i] = bench_rand() * (ct.lim.phi - 1.001) * ct.del.phi;
+    }
+
+    for( rep = -1; rep < repetitions; rep++ )
+    {
+        double start = bench_now(), sum = 0.0;
+
+        for( i = 0; i < point_count; i++ )
+        {
+            LP t, shift;
+
+            t.lam = work_x[i];
+            t.phi = work_y[i];
+            shift = nad_intr( t, &ct );
+            sum += shift.lam + shift.phi;
+        }
+        bench_sink += sum;
+        if( rep >= 0 && (best < 0.0 || bench_now() - start < best) )
+            best = bench_now() - start;
+    }
+    bench_report( "nad_intr", best, point_count );
+
+    pj_dalloc( ct.cvs );
+}
+
+/************************************************************************/
+/*                        bench_geod_inverse()                          */
+/************************************************************************/
+
+static void bench_geod_inverse( const double *phi, const double *lam )
+
+{
+    struct geod_geodesic g;
+    double best = -1.0;
+    int rep;
+    long i, pairs = point_count / 2;
+
+    geod_init( &g, ellps_list[0].a,
+               1.0 - sqrt( 1.0 - ellps_list[0].es ) );
+
+    for( rep = -1; rep < repetitions; rep++ )
+    {
+        double start = bench_now(), sum = 0.0;
+
+        for( i = 0; i < pairs; i++ )
+        {
+            double s12, azi1, azi2;
+
+            geod_inverse( &g,
+                          phi[2*i] * RAD_TO_DEG, lam[2*i] * RAD_TO_DEG,
+                          phi[2*i+1] * RAD_TO_DEG, lam[2*i+1] * RAD_TO_DEG,
+                          &s12, &azi1, &azi2 );
+            sum += s12;
+        }
+        bench_sink += sum;
+        if( rep >= 0 && (best < 0.0 || bench_now() - start < best) )
+            best = bench_now() - start;
+    }
+    bench_report( "geod_inverse", best, pairs );
+}
+
+/************************************************************************/
+/*                               usage()                                */
+/************************************************************************/
+
+static void usage( void )
+
+{
+    fprintf( stderr,
+             "usage: helperbench [-n points] [-r repetitions]\n"
+             "\n"
+             "Times the low level math helpers over realistic inputs and\n"
+             "emits JSON: per helper best-of-repetitions ns/op, averaged\n"
+             "over the common ellipsoids for the eccentricity dependent\n"
+             "ones.\n" );
+    exit( 1 );
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char **argv )
+
+{
+    double *phi, *lam, *work_a, *work_b;
+    int i;
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( strcmp( argv[i], "-n" ) == 0 && i + 1 < argc )
+            point_count = atol( argv[++i] );
+        else if( strcmp( argv[i], "-r" ) == 0 && i + 1 < argc )
+            repetitions = atoi( argv[++i] );
+        else
+            usage();
+    }
+    if( point_count < 2 || repetitions < 1 )
+        usage();
+
+    phi = (double *) malloc( sizeof(double) * point_count * 4 );
+    if( phi == NULL )
+    {
+        fprintf( stderr, "helperbench: out of memory for %ld points\n",
+                 point_count );
+        exit( 1 );
+    }
+    lam = phi + point_count;
+    work_a = lam + point_count;
+    work_b = work_a + point_count;
+
+    bench_fill( phi, lam, point_count );
+
+    printf( "{\n  \"points\": %ld,\n  \"repetitions\": %d,\n"
+            "  \"unit\": \"ns/op\",\n  \"ns_per_op\": {",
+            point_count, repetitions );
+
+    bench_tsfn( phi );
+    bench_phi2( phi, work_a );
+    bench_mlfn( phi );
+    bench_inv_mlfn( phi, work_a );
+    bench_qsfn( phi );
+    bench_authlat( phi );
+    bench_adjlon( lam, work_a );
+    bench_nad_intr( work_a, work_b );
+    bench_geod_inverse( phi, lam );
+
+    printf( "\n  }\n}\n" );
+
+    free( phi );
+    return 0;
+}
@@ -432,6 +432,90 @@ JNIEXPORT void JNICALL Java_org_proj4_PJ_transform
     }
 }
 
+/*!
+ * \brief
+ * Transforms in-place the coordinates in the given array, reporting per-point
+ * failures in a bitmap instead of throwing. The whole array crosses the JNI
+ * boundary once: it is pinned with GetPrimitiveArrayCritical and handed to a
+ * single pj_transform() call. Points that could not be transformed (marked
+ * HUGE_VAL by Proj4) have their bit set in the returned bitmap; only errors
+ * that invalidate the whole operation are thrown as PJException.
+ *
+ * \param env         - The JNI environment.
+ * \param object      - The Java object wrapping the PJ structure (not allowed to be NULL).
+ * \param target      - The target CRS.
+ * \param dimension   - The dimension of each coordinate value. Must be equals or greater than 2.
+ * \param coordinates - The coordinates to transform, as a sequence of (x,y,<z>,...) tuples.
+ * \param offset      - Offset of the first coordinate in the given array.
+ * \param numPts      - Number of points to transform.
+ * \return A bitmap of ceil(numPts/64) longs where bit i (in java.util.BitSet
+ *         layout: word i/64, bit i%64) is set if point i failed, or NULL on error.
+ */
+JNIEXPORT jlongArray JNICALL Java_org_proj4_PJ_transformBatch
+  (JNIEnv *env, jobject object, jobject target, jint dimension, jdoubleArray coordinates, jint offset, jint numPts)
+{
+    if (!target || !coordinates) {
+        jclass c = (*env)->FindClass(env, "java/lang/NullPointerException");
+        if (c) (*env)->ThrowNew(env, c, "The target CRS and the coordinates array can not be null.");
+        return NULL;
+    }
+    if (dimension < 2 || dimension > PJ_MAX_DIMENSION) { /* Arbitrary upper value for catching potential misuse. */
+        jclass c = (*env)->FindClass(env, "java/lang/IllegalArgumentException");
+        if (c) (*env)->ThrowNew(env, c, "Illegal dimension. Must be in the [2-100] range.");
+        return NULL;
+    }
+    if ((offset < 0) || (numPts < 0) || (offset + dimension*numPts) > (*env)->GetArrayLength(env, coordinates)) {
+        jclass c = (*env)->FindClass(env, "java/lang/ArrayIndexOutOfBoundsException");
+        if (c) (*env)->ThrowNew(env, c, "Illegal offset or illegal number of points.");
+        return NULL;
+    }
+    PJ *src_pj = getPJ(env, object);
+    PJ *dst_pj = getPJ(env, target);
+    if (src_pj && dst_pj) {
+        jint numWords = (numPts + 63) / 64;
+        jlong *bitmap = (jlong*) pj_malloc((numWords ? numWords : 1) * sizeof(jlong));
+        if (!bitmap) {
+            jclass c = (*env)->FindClass(env, "java/lang/OutOfMemoryError");
+            if (c) (*env)->ThrowNew(env, c, "Can not allocate the error bitmap.");
+            return NULL;
+        }
+        memset(bitmap, 0, (numWords ? numWords : 1) * sizeof(jlong));
+        /* Same "critical" contract as Java_org_proj4_PJ_transform: no JNI
+           calls and no blocking while the array is pinned, so the bitmap is
+           filled into a plain C buffer and boxed only after release. */
+        double *data = (*env)->GetPrimitiveArrayCritical(env, coordinates, NULL);
+        if (data) {
+            double *x = data + offset;
+            double *y = x + 1;
+            double *z = (dimension >= 3) ? y+1 : NULL;
+            jint i;
+            convertAngularOrdinates(src_pj, x, numPts, dimension, M_PI/180);
+            int err = pj_transform(src_pj, dst_pj, numPts, dimension, x, y, z);
+            convertAngularOrdinates(dst_pj, x, numPts, dimension, 180/M_PI);
+            for (i=0; i<numPts; i++) {
+                if (x[dimension*i] == HUGE_VAL) {
+                    bitmap[i >> 6] |= (jlong) 1 << (i & 63);
+                }
+            }
+            (*env)->ReleasePrimitiveArrayCritical(env, coordinates, data, 0);
+            if (err && (err > 0 || pj_transient_error[-err] == 0)) {
+                jclass c = (*env)->FindClass(env, "org/proj4/PJException");
+                if (c) (*env)->ThrowNew(env, c, pj_strerrno(err));
+                pj_dalloc(bitmap);
+                return NULL;
+            }
+            jlongArray array = (*env)->NewLongArray(env, numWords);
+            if (array) {
+                (*env)->SetLongArrayRegion(env, array, 0, numWords, bitmap);
+            }
+            pj_dalloc(bitmap);
+            return array;
+        }
+        pj_dalloc(bitmap);
+    }
+    return NULL;
+}
+
 /*!
  * \brief
  * Returns a description of the last error that occurred, or NULL if none.
@@ -34,6 +34,46 @@ if(USE_THREAD AND NOT Threads_FOUND)
   message(FATAL_ERROR "No thread library found and thread/mutex support is required by USE_THREAD option")
 endif(USE_THREAD AND NOT Threads_FOUND)
 
+option(EMBED_INIT_FILES "Compile init files into the library so +init lookups need no filesystem access" OFF)
+set(EMBED_INIT_FILES_LIST epsg CACHE STRING "Init files from nad/ embedded when EMBED_INIT_FILES is on")
+if(EMBED_INIT_FILES)
+    set(EMBED_INIT_DECLS "/* Generated by lib_proj.cmake from EMBED_INIT_FILES_LIST - do not edit */\n")
+    set(EMBED_INIT_TABLE "#define PJ_EMBED_FILE_LIST { \\\n")
+    foreach(EMBED_FILE ${EMBED_INIT_FILES_LIST})
+        string(REGEX REPLACE "[^A-Za-z0-9]" "_" EMBED_IDENT ${EMBED_FILE})
+        file(READ ${PROJ4_SOURCE_DIR}/nad/${EMBED_FILE} EMBED_HEX HEX)
+        string(REGEX REPLACE "(..)" "0x\\1," EMBED_BYTES ${EMBED_HEX})
+        string(REGEX REPLACE "(0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,0x..,)" "\\1\n" EMBED_BYTES ${EMBED_BYTES})
+        set(EMBED_INIT_DECLS "${EMBED_INIT_DECLS}static const unsigned char pj_embed_${EMBED_IDENT}[] = {\n${EMBED_BYTES}\n};\n")
+        set(EMBED_INIT_TABLE "${EMBED_INIT_TABLE}    { \"${EMBED_FILE}\", (const char *) pj_embed_${EMBED_IDENT}, sizeof(pj_embed_${EMBED_IDENT}) }, \\\n")
+    endforeach(EMBED_FILE)
+    set(EMBED_INIT_TABLE "${EMBED_INIT_TABLE}}\n")
+    file(WRITE ${CMAKE_CURRENT_BINARY_DIR}/pj_embedded_init.h
+         "${EMBED_INIT_DECLS}${EMBED_INIT_TABLE}")
+    add_definitions(-DPROJ_EMBED_INIT)
+    include_directories(${CMAKE_CURRENT_BINARY_DIR})
+endif(EMBED_INIT_FILES)
+
+# Dispatch-optimized build profile.  Every per-point transform goes
+# through the indirect calls (*P->fwd)/(*P->inv), which keeps tiny
+# kernels (eqc, spherical merc) out of line behind an unpredictable
+# branch when several projections are live.  PROJ_ENABLE_LTO compiles
+# and links with -flto so kernels can inline across translation units;
+# PROJ_SPECULATIVE_DISPATCH additionally enables the guarded direct
+# calls to the hottest kernels in pj_fwd.c/pj_inv.c (see projects.h),
+# which LTO then inlines into the dispatch itself.  Both default off;
+# enable both for mixed-projection point servers.
+option(PROJ_ENABLE_LTO "Build with link-time optimization (-flto)" OFF)
+if(PROJ_ENABLE_LTO AND CMAKE_C_COMPILER_ID MATCHES "GNU|Clang")
+    set(CMAKE_C_FLAGS "${CMAKE_C_FLAGS} -flto")
+    set(CMAKE_SHARED_LINKER_FLAGS "${CMAKE_SHARED_LINKER_FLAGS} -flto")
+    set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} -flto")
+endif()
+option(PROJ_SPECULATIVE_DISPATCH "Speculative direct dispatch of the hottest projection kernels" OFF)
+if(PROJ_SPECULATIVE_DISPATCH)
+    add_definitions(-DPROJ_SPECULATIVE_DISPATCH)
+endif(PROJ_SPECULATIVE_DISPATCH)
+
 
 ##############################################
 ### librairie source list and include_list ###
@@ -53,6 +93,7 @@ SET(SRC_LIBPROJ_PJ
         PJ_cass.c
         PJ_cc.c
         PJ_cea.c
+        PJ_cheby.c
         PJ_chamb.c
         PJ_collg.c
         PJ_crast.c
@@ -156,12 +197,15 @@ SET(SRC_LIBPROJ_CORE
         pj_apply_gridshift.c
         pj_apply_vgridshift.c
         pj_auth.c
+        pj_caps.c
+        pj_cheby_io.c
         pj_ctx.c
         pj_fileapi.c
         pj_datum_set.c
         pj_datums.c
         pj_deriv.c
         pj_ell_set.c
+        pj_ellcache.c
         pj_ellps.c
         pj_errno.c
         pj_factors.c
@@ -171,30 +215,47 @@ SET(SRC_LIBPROJ_CORE
         pj_geocent.c
         pj_gridcatalog.c
         pj_gridinfo.c
+        pj_handles.c
         pj_gridlist.c
         PJ_healpix.c
         pj_init.c
         pj_initcache.c
+        pj_kernelreg.c
+        pj_defcache.c
+        pj_initembed.c
+        pj_initindex.c
+        pj_registry.c
         pj_inv.c
         pj_latlong.c
+        pj_layout.c
         pj_list.c
         pj_list.h
         pj_log.c
         pj_malloc.c
         pj_mlfn.c
         pj_msfn.c
+        pj_mt_transform.c
         pj_mutex.c
         pj_open_lib.c
         pj_param.c
         pj_phi2.c
+        pj_pipeline.c
+        pj_plancache.c
+        pj_pool.c
         pj_pr_list.c
         pj_qsfn.c
+        pj_reclaim.c
         pj_release.c
+        pj_snapshot.c
         pj_strerrno.c
+        pj_tile.c
         pj_transform.c
+        pj_transform_plan.c
+        pj_tpool.c
         pj_tsfn.c
         pj_units.c
         pj_utils.c
+        pj_vmath.c
         pj_zpoly1.c
         proj_mdist.c
         proj_rouss.c
@@ -205,6 +266,7 @@ SET(SRC_LIBPROJ_CORE
 
 set(HEADERS_LIBPROJ
         projects.h
+        pj_vmath.h
         proj_api.h
         geodesic.h
 )
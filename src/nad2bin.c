@@ -46,10 +46,266 @@ static void swap_words( void *data_in, int word_size, int word_count )
 static void Usage()
 {
     fprintf(stderr,
-            "usage: nad2bin [-f ctable/ctable2/ntv2] binary_output < ascii_source\n" );
+            "usage: nad2bin [-f ctable/ctable2/ctable3/ctable3q/ntv2]\n"
+            "               [-c source_grid] [-s] binary_output < ascii_source\n"
+            "\n"
+            "-c converts an existing binary grid (any format PROJ.4 can\n"
+            "read) instead of reading an ascii table from stdin.\n"
+            "ctable3 is written in host byte order at a 64 byte aligned\n"
+            "offset so it loads with a single read or mmap; ctable3q is\n"
+            "the same with int16 quantized shift values (half the size,\n"
+            "worst case error half a quantization step).\n"
+            "-s streams the ascii table a row at a time instead of\n"
+            "holding the whole grid in memory; only -f ctable3 supports\n"
+            "it (ctable3q needs the global maxima for its scales).\n" );
     exit(1);
 }
 
+/************************************************************************/
+/*                           write_ctable3()                            */
+/************************************************************************/
+
+static void write_ctable3( FILE *fp, struct CTABLE *ct, int quantized )
+{
+    char header[256];
+    long a_size = (long) ct->lim.lam * ct->lim.phi;
+    long data_size;
+    double scale_lam = 1.0, scale_phi = 1.0;
+    unsigned char *data;
+    unsigned int sum;
+    long i;
+
+    assert( MAX_TAB_ID == 80 );
+    assert( sizeof(int) == 4 ); /* for ct.lim.lam/phi */
+    assert( sizeof(short) == 2 );
+
+    if( quantized )
+    {
+        double max_lam = 0.0, max_phi = 0.0;
+        short *q;
+
+        for( i = 0; i < a_size; i++ )
+        {
+            if( fabs(ct->cvs[i].lam) > max_lam )
+                max_lam = fabs(ct->cvs[i].lam);
+            if( fabs(ct->cvs[i].phi) > max_phi )
+                max_phi = fabs(ct->cvs[i].phi);
+        }
+        if( max_lam > 0.0 )
+            scale_lam = max_lam / 32767.0;
+        if( max_phi > 0.0 )
+            scale_phi = max_phi / 32767.0;
+
+        data_size = a_size * 2 * sizeof(short);
+        q = (short *) malloc( data_size );
+        if( q == NULL )
+        {
+            perror("mem. alloc");
+            exit(2);
+        }
+        for( i = 0; i < a_size; i++ )
+        {
+            q[i+i]   = (short) floor(ct->cvs[i].lam / scale_lam + 0.5);
+            q[i+i+1] = (short) floor(ct->cvs[i].phi / scale_phi + 0.5);
+        }
+        data = (unsigned char *) q;
+    }
+    else
+    {
+        data = (unsigned char *) ct->cvs;
+        data_size = a_size * sizeof(FLP);
+    }
+
+    sum = nad_ctable3_checksum( data, data_size );
+
+    memset( header, 0, sizeof(header) );
+    memcpy( header +   0, "CTABLE V3.0     ", 16 );
+    memcpy( header +  16, ct->id, 80 );
+    memcpy( header +  96, &ct->ll.lam, 8 );
+    memcpy( header + 104, &ct->ll.phi, 8 );
+    memcpy( header + 112, &ct->del.lam, 8 );
+    memcpy( header + 120, &ct->del.phi, 8 );
+    memcpy( header + 128, &ct->lim.lam, 4 );
+    memcpy( header + 132, &ct->lim.phi, 4 );
+    header[136] = IS_LSB ? 1 : 0;
+    header[137] = quantized ? 1 : 0;
+    memcpy( header + 144, &scale_lam, 8 );
+    memcpy( header + 152, &scale_phi, 8 );
+    memcpy( header + 160, &sum, 4 );
+
+    if( fwrite( header, sizeof(header), 1, fp ) != 1
+        || fwrite( data, data_size, 1, fp ) != 1 )
+    {
+        perror( "fwrite" );
+        exit( 2 );
+    }
+
+    if( quantized )
+        free( data );
+}
+
+/************************************************************************/
+/*                             read_long()                              */
+/*                                                                      */
+/*      Hand rolled integer scanner over buffered stdio.  The .lla      */
+/*      body is nothing but whitespace separated (optionally signed)    */
+/*      integers and row prefixes like "12:", and scanf() spends most   */
+/*      of the conversion time interpreting its format string; this     */
+/*      is where the minutes go on 100M node grids.                     */
+/************************************************************************/
+
+static long read_long( FILE *fp, int *ok )
+
+{
+    int c;
+    long v = 0;
+    int neg = 0;
+
+    do {
+        c = getc(fp);
+    } while( c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == ':' );
+
+    if( c == '-' )
+    {
+        neg = 1;
+        c = getc(fp);
+    }
+    if( c < '0' || c > '9' )
+    {
+        *ok = 0;
+        return 0;
+    }
+    do {
+        v = v * 10 + (c - '0');
+        c = getc(fp);
+    } while( c >= '0' && c <= '9' );
+
+    *ok = 1;
+    return neg ? -v : v;
+}
+
+/************************************************************************/
+/*                          stream_ctable3()                            */
+/*                                                                      */
+/*      One pass ascii to ctable3 conversion holding a single row in    */
+/*      memory.  The header goes out first with a zero checksum and     */
+/*      the real value is patched in at the end, since the rolling      */
+/*      checksum can be accumulated row by row as the data is           */
+/*      written.                                                        */
+/************************************************************************/
+
+static void stream_ctable3( FILE *fp )
+
+{
+    struct CTABLE ct;
+    char header[256];
+    FLP *row_buf;
+    unsigned int sum = 0;
+    long row_size;
+    int i, j, ok;
+    long lam, laml, phi, phil, ichk;
+
+    /* the id field is copied out whole, so the bytes past the
+       terminating NUL must not be stack garbage */
+    memset( &ct, 0, sizeof(ct) );
+
+    if ( NULL == fgets(ct.id, MAX_TAB_ID, stdin) ) {
+        perror("fgets");
+        exit(1);
+    }
+    if ( EOF == scanf("%d %d %*d %lf %lf %lf %lf", &ct.lim.lam, &ct.lim.phi,
+          &ct.ll.lam, &ct.del.lam, &ct.ll.phi, &ct.del.phi) ) {
+        perror("scanf");
+        exit(1);
+    }
+    ct.ll.lam *= DEG_TO_RAD;
+    ct.ll.phi *= DEG_TO_RAD;
+    ct.del.lam *= DEG_TO_RAD;
+    ct.del.phi *= DEG_TO_RAD;
+
+    row_size = (long) ct.lim.lam * sizeof(FLP);
+    if (!(row_buf = (FLP *) malloc(row_size))) {
+        perror("mem. alloc");
+        exit(1);
+    }
+
+    assert( MAX_TAB_ID == 80 );
+    assert( sizeof(int) == 4 ); /* for ct.lim.lam/phi */
+
+    memset( header, 0, sizeof(header) );
+    memcpy( header +   0, "CTABLE V3.0     ", 16 );
+    memcpy( header +  16, ct.id, 80 );
+    memcpy( header +  96, &ct.ll.lam, 8 );
+    memcpy( header + 104, &ct.ll.phi, 8 );
+    memcpy( header + 112, &ct.del.lam, 8 );
+    memcpy( header + 120, &ct.del.phi, 8 );
+    memcpy( header + 128, &ct.lim.lam, 4 );
+    memcpy( header + 132, &ct.lim.phi, 4 );
+    header[136] = IS_LSB ? 1 : 0;
+    /* header[137] = 0: not quantized.  The unit scales are only read
+       back for quantized grids but write_ctable3() stores them, so
+       match it byte for byte */
+    {
+        double scale = 1.0;
+        memcpy( header + 144, &scale, 8 );
+        memcpy( header + 152, &scale, 8 );
+    }
+    /* checksum at 160 patched after the data pass */
+
+    if( fwrite( header, sizeof(header), 1, fp ) != 1 ) {
+        perror( "fwrite" );
+        exit( 2 );
+    }
+
+    for (i = 0; i < ct.lim.phi; ++i) {
+        const unsigned char *bytes;
+        long b;
+
+        ichk = read_long( stdin, &ok );
+        laml = read_long( stdin, &ok );
+        phil = read_long( stdin, &ok );
+        if (!ok) {
+            perror("scan on row");
+            exit(1);
+        }
+        if (ichk != i) {
+            fprintf(stderr,"format check on row\n");
+            exit(1);
+        }
+        row_buf[0].lam = laml * U_SEC_TO_RAD;
+        row_buf[0].phi = phil * U_SEC_TO_RAD;
+        for (j = 1; j < ct.lim.lam; ++j) {
+            lam = read_long( stdin, &ok );
+            phi = read_long( stdin, &ok );
+            if (!ok) {
+                perror("scan on column");
+                exit(1);
+            }
+            row_buf[j].lam = (laml += lam) * U_SEC_TO_RAD;
+            row_buf[j].phi = (phil += phi) * U_SEC_TO_RAD;
+        }
+
+        /* same polynomial as nad_ctable3_checksum(), seeded with the
+           running sum so it can be accumulated per row */
+        bytes = (const unsigned char *) row_buf;
+        for( b = 0; b < row_size; b++ )
+            sum = sum * 31 + bytes[b];
+
+        if( fwrite( row_buf, row_size, 1, fp ) != 1 ) {
+            perror( "fwrite" );
+            exit( 2 );
+        }
+    }
+
+    if( fseek( fp, 160, SEEK_SET ) != 0
+        || fwrite( &sum, 4, 1, fp ) != 1 ) {
+        perror( "checksum patch" );
+        exit( 2 );
+    }
+
+    free( row_buf );
+}
+
 /************************************************************************/
 /*                                main()                                */
 /************************************************************************/
@@ -62,6 +318,8 @@ int main(int argc, char **argv) {
     FILE *fp;
 
     const char *output_file = NULL;
+    const char *convert_src = NULL;
+    int stream_mode = 0;
 
     const char *format   = "ctable2";
     const char *GS_TYPE  = "SECONDS";
@@ -77,10 +335,18 @@ int main(int argc, char **argv) {
 /* ==================================================================== */
     for( i = 1; i < argc; i++ )
     {
-        if( strcmp(argv[i],"-f") == 0 && i < argc-1 ) 
+        if( strcmp(argv[i],"-f") == 0 && i < argc-1 )
         {
             format = argv[++i];
         }
+        else if( strcmp(argv[i],"-c") == 0 && i < argc-1 )
+        {
+            convert_src = argv[++i];
+        }
+        else if( strcmp(argv[i],"-s") == 0 )
+        {
+            stream_mode = 1;
+        }
         else if( output_file == NULL )
         {
             output_file = argv[i];
@@ -94,10 +360,69 @@ int main(int argc, char **argv) {
 
     fprintf( stdout, "Output Binary File Format: %s\n", format );
 
+/* ==================================================================== */
+/*      Streaming mode: one pass over stdin holding a single row.       */
+/* ==================================================================== */
+    if( stream_mode )
+    {
+        if( convert_src != NULL || strcmp(format,"ctable3") != 0 )
+            Usage();
+
+        if (!(fp = fopen(output_file, "wb"))) {
+            perror(output_file);
+            exit(2);
+        }
+
+        stream_ctable3( fp );
+
+        fclose( fp );
+        exit(0); /* normal completion */
+    }
+
+/* ==================================================================== */
+/*      Converter mode: load an existing binary grid through the        */
+/*      normal library machinery instead of reading ascii.              */
+/* ==================================================================== */
+    if( convert_src != NULL )
+    {
+        projCtx ctx = pj_get_default_ctx();
+        PJ_GRIDINFO *gi;
+
+        /* the writers below expect a row-major float cvs array, so
+           never let PJ_TILED_GRIDS or PJ_PACKED_GRIDS rearrange what
+           we load here */
+        pj_gridinfo_set_tiled( 0 );
+        pj_gridinfo_set_packed( 0 );
+
+        gi = pj_gridinfo_init( ctx, convert_src );
+
+        if( gi == NULL || gi->ct == NULL
+            || strcmp(gi->format,"missing") == 0
+            || !pj_gridinfo_load( ctx, gi ) )
+        {
+            fprintf( stderr, "failed to load source grid %s\n",
+                     convert_src );
+            exit(1);
+        }
+        if( gi->child != NULL || gi->next != NULL )
+            fprintf( stderr,
+                     "warning: %s contains subgrids - "
+                     "only the top grid is converted.\n", convert_src );
+
+        ct = *(gi->ct);
+        tsize = ct.lim.lam * ct.lim.phi * sizeof(FLP);
+    }
+    else
+    {
+
 /* ==================================================================== */
 /*      Read the ASCII Table                                            */
 /* ==================================================================== */
 
+    /* the id field is copied out whole, so the bytes past the
+       terminating NUL must not be stack garbage */
+    memset( &ct, 0, sizeof(ct) );
+
     if ( NULL == fgets(ct.id, MAX_TAB_ID, stdin) ) {
         perror("fgets");
         exit(1);
@@ -118,8 +443,13 @@ int main(int argc, char **argv) {
     ct.del.phi *= DEG_TO_RAD;
     /* load table */
     for (p = ct.cvs, i = 0; i < ct.lim.phi; ++i) {
-        if ( EOF == scanf("%d:%ld %ld", &ichk, &laml, &phil) ) {
-            perror("scanf on row");
+        int ok;
+
+        ichk = (int) read_long( stdin, &ok );
+        laml = read_long( stdin, &ok );
+        phil = read_long( stdin, &ok );
+        if (!ok) {
+            perror("scan on row");
             exit(1);
         }
         if (ichk != i) {
@@ -130,8 +460,10 @@ int main(int argc, char **argv) {
         t.phi = phil * U_SEC_TO_RAD;
         *p++ = t;
         for (j = 1; j < ct.lim.lam; ++j) {
-            if ( EOF == scanf("%ld %ld", &lam, &phi) ) {
-                perror("scanf on column");
+            lam = read_long( stdin, &ok );
+            phi = read_long( stdin, &ok );
+            if (!ok) {
+                perror("scan on column");
                 exit(1);
             }
             t.lam = (laml += lam) * U_SEC_TO_RAD;
@@ -139,10 +471,8 @@ int main(int argc, char **argv) {
             *p++ = t;
         }
     }
-    if (feof(stdin)) {
-        fprintf(stderr, "premature EOF\n");
-        exit(1);
-    }
+
+    } /* end of ascii reading */
 
 /* ==================================================================== */
 /*      Write out the old ctable format - this is machine and byte      */
@@ -154,7 +484,7 @@ int main(int argc, char **argv) {
             perror(output_file);
             exit(2);
 	}
-	if (fwrite(&ct, sizeof(ct), 1, fp) != 1 ||
+	if (fwrite(&ct, CTABLE_V1_HDR_SIZE, 1, fp) != 1 ||
             fwrite(ct.cvs, tsize, 1, fp) != 1) {
             fprintf(stderr, "output failure\n");
             exit(2);
@@ -212,6 +542,23 @@ int main(int argc, char **argv) {
 	exit(0); /* normal completion */
     }
 
+/* ==================================================================== */
+/*      Write out the ctable3 format - host byte order, aligned,        */
+/*      checksummed, optionally int16 quantized.                        */
+/* ==================================================================== */
+    if( strcmp(format,"ctable3") == 0 || strcmp(format,"ctable3q") == 0 )
+    {
+	if (!(fp = fopen(output_file, "wb"))) {
+            perror(output_file);
+            exit(2);
+	}
+
+        write_ctable3( fp, &ct, strcmp(format,"ctable3q") == 0 );
+
+        fclose( fp );
+	exit(0); /* normal completion */
+    }
+
 /* ==================================================================== */
 /*      Write out the NTv2 format grid shift file.                      */
 /* ==================================================================== */
@@ -2,8 +2,43 @@
 #include <projects.h>
 #define MAX_TRY 9
 #define TOL 1e-12
+
+/* containment test identical to nad_intr()'s index checks, including
+** the edge tolerances, but without touching the cvs array */
+	static int
+nad_contains(LP t, struct CTABLE *ct) {
+	LP frct;
+	ILP indx;
+	int in;
+
+	indx.lam = floor(t.lam /= ct->del.lam);
+	indx.phi = floor(t.phi /= ct->del.phi);
+	frct.lam = t.lam - indx.lam;
+	frct.phi = t.phi - indx.phi;
+	if (indx.lam < 0) {
+		if (!(indx.lam == -1 && frct.lam > 0.99999999999))
+			return 0;
+	} else if ((in = indx.lam + 1) >= ct->lim.lam) {
+		if (!(in == ct->lim.lam && frct.lam < 1e-11))
+			return 0;
+	}
+	if (indx.phi < 0) {
+		if (!(indx.phi == -1 && frct.phi > 0.99999999999))
+			return 0;
+	} else if ((in = indx.phi + 1) >= ct->lim.phi) {
+		if (!(in == ct->lim.phi && frct.phi < 1e-11))
+			return 0;
+	}
+	return 1;
+}
+
+/* As nad_cvt(), but the bilinear corner loads go through a caller held
+** stencil cache, so runs of nearby points (and the Newton iterations of
+** one inverse solution) reload the cell corners only when the cell
+** actually changes.  Results are identical to nad_cvt(). */
 	LP
-nad_cvt(LP in, int inverse, struct CTABLE *ct) {
+nad_cvt_stencil(LP in, int inverse, struct CTABLE *ct,
+	struct nad_stencil *sten) {
 	LP t, tb;
 
 	if (in.lam == HUGE_VAL)
@@ -13,7 +48,43 @@ nad_cvt(LP in, int inverse, struct CTABLE *ct) {
 	tb.lam -= ct->ll.lam;
 	tb.phi -= ct->ll.phi;
 	tb.lam = adjlon(tb.lam - PI) + PI;
-	t = nad_intr(tb, ct);
+	if (ct->null_shift) {
+		/* every shift in the table is exactly zero: both
+		** directions are the identity for contained points, so
+		** skip the interpolation (and the inverse iteration).
+		** Out-of-table points still report HUGE_VAL so the caller
+		** falls through to other grids, as with a real lookup. */
+		if (!nad_contains(tb, ct)) {
+			in.lam = in.phi = HUGE_VAL;
+			return in;
+		}
+		if (inverse) {
+			in.lam = adjlon(tb.lam + ct->ll.lam);
+			in.phi = tb.phi + ct->ll.phi;
+		}
+		return in;
+	}
+	if (ct->const_shift) {
+		/* every shift in the table equals const_sh: both
+		** directions are a closed-form offset for contained
+		** points.  The inverse is exact - with a constant shift
+		** field the Newton iteration's fixed point is reached in
+		** one step - so no iteration either. */
+		if (!nad_contains(tb, ct)) {
+			in.lam = in.phi = HUGE_VAL;
+			return in;
+		}
+		if (inverse) {
+			in.lam = adjlon(tb.lam + ct->const_sh.lam
+				+ ct->ll.lam);
+			in.phi = tb.phi - ct->const_sh.phi + ct->ll.phi;
+		} else {
+			in.lam -= ct->const_sh.lam;
+			in.phi += ct->const_sh.phi;
+		}
+		return in;
+	}
+	t = nad_intr_stencil(tb, ct, sten);
 	if (inverse) {
 		LP del, dif;
 		int i = MAX_TRY;
@@ -23,7 +94,10 @@ nad_cvt(LP in, int inverse, struct CTABLE *ct) {
 		t.phi = tb.phi - t.phi;
 
 		do {
-			del = nad_intr(t, ct);
+			LP dl, dp;
+			double j00, j01, j10, j11, det;
+
+			del = nad_intr_grad_stencil(t, ct, &dl, &dp, sten);
 
                         /* This case used to return failure, but I have
                            changed it to return the first order approximation
@@ -44,8 +118,25 @@ nad_cvt(LP in, int inverse, struct CTABLE *ct) {
                             break;
                         }
 
-			t.lam -= dif.lam = t.lam - del.lam - tb.lam;
-			t.phi -= dif.phi = t.phi + del.phi - tb.phi;
+		/* Newton step: the fixed point update below has linear
+		** convergence; solving against the Jacobian of the
+		** residual (I plus/minus the bilinear gradient of the
+		** shift) typically converges in 2-3 iterations. */
+			dif.lam = t.lam - del.lam - tb.lam;
+			dif.phi = t.phi + del.phi - tb.phi;
+			j00 = 1. - dl.lam;
+			j01 = -dp.lam;
+			j10 = dl.phi;
+			j11 = 1. + dp.phi;
+			det = j00 * j11 - j01 * j10;
+			if (fabs(det) > 1e-10) {
+				double f_lam = dif.lam, f_phi = dif.phi;
+
+				dif.lam = (j11 * f_lam - j01 * f_phi) / det;
+				dif.phi = (j00 * f_phi - j10 * f_lam) / det;
+			}
+			t.lam -= dif.lam;
+			t.phi -= dif.phi;
 		} while (i-- && fabs(dif.lam) > TOL && fabs(dif.phi) > TOL);
 		if (i < 0) {
                     if( getenv( "PROJ_DEBUG" ) != NULL )
@@ -66,3 +157,33 @@ nad_cvt(LP in, int inverse, struct CTABLE *ct) {
 	}
 	return in;
 }
+
+	LP
+nad_cvt(LP in, int inverse, struct CTABLE *ct) {
+	struct nad_stencil sten;
+
+	nad_stencil_clear(&sten);
+	return nad_cvt_stencil(in, inverse, ct, &sten);
+}
+
+/* convert a batch of points against one table, in place.  Points that
+** fall outside the table (or fail to converge) come back as HUGE_VAL
+** pairs, matching nad_cvt().  The stencil carries across points, so
+** runs sharing a cell load its corners only once. */
+	void
+nad_cvt_batch(int inverse, struct CTABLE *ct, long point_count,
+	double *lam, double *phi) {
+	struct nad_stencil sten;
+	long i;
+
+	nad_stencil_clear(&sten);
+	for (i = 0; i < point_count; ++i) {
+		LP in, out;
+
+		in.lam = lam[i];
+		in.phi = phi[i];
+		out = nad_cvt_stencil(in, inverse, ct, &sten);
+		lam[i] = out.lam;
+		phi[i] = out.phi;
+	}
+}
@@ -87,11 +87,12 @@ int nad_ctable_load( projCtx ctx, struct CTABLE *ct, PAFile fid )
 {
     int  a_size;
 
-    pj_ctx_fseek( ctx, fid, sizeof(struct CTABLE), SEEK_SET );
+    pj_ctx_fseek( ctx, fid, CTABLE_V1_HDR_SIZE, SEEK_SET );
 
     /* read all the actual shift values */
     a_size = ct->lim.lam * ct->lim.phi;
     ct->cvs = (FLP *) pj_malloc(sizeof(FLP) * a_size);
+    pj_numa_spread_touch( ct->cvs, sizeof(FLP) * a_size );
     if( ct->cvs == NULL 
         || pj_ctx_fread(ctx, ct->cvs, sizeof(FLP), a_size, fid) != a_size )
     {
@@ -119,9 +120,11 @@ struct CTABLE *nad_ctable_init( projCtx ctx, PAFile fid )
     int		id_end;
 
     /* read the table header */
+    /* only the struct prefix up to the cvs pointer lives in the file;
+       the fields after it are in-memory only */
     ct = (struct CTABLE *) pj_malloc(sizeof(struct CTABLE));
     if( ct == NULL 
-        || pj_ctx_fread( ctx, ct, sizeof(struct CTABLE), 1, fid ) != 1 )
+        || pj_ctx_fread( ctx, ct, CTABLE_V1_HDR_SIZE, 1, fid ) != 1 )
     {
         pj_ctx_set_errno( ctx, -38 );
         return NULL;
@@ -145,6 +148,13 @@ struct CTABLE *nad_ctable_init( projCtx ctx, PAFile fid )
     }
 
     ct->cvs = NULL;
+    ct->tiled = 0;
+    ct->tiles_lam = 0;
+    ct->packed = 0;
+    ct->qbase = NULL;
+    ct->qstep = NULL;
+    ct->null_shift = 0;
+    ct->const_shift = 0;
 
     return ct;
 }
@@ -165,6 +175,7 @@ int nad_ctable2_load( projCtx ctx, struct CTABLE *ct, PAFile fid )
     /* read all the actual shift values */
     a_size = ct->lim.lam * ct->lim.phi;
     ct->cvs = (FLP *) pj_malloc(sizeof(FLP) * a_size);
+    pj_numa_spread_touch( ct->cvs, sizeof(FLP) * a_size );
     if( ct->cvs == NULL 
         || pj_ctx_fread(ctx, ct->cvs, sizeof(FLP), a_size, fid) != a_size )
     {
@@ -254,10 +265,221 @@ struct CTABLE *nad_ctable2_init( projCtx ctx, PAFile fid )
     }
 
     ct->cvs = NULL;
+    ct->tiled = 0;
+    ct->tiles_lam = 0;
+    ct->packed = 0;
+    ct->qbase = NULL;
+    ct->qstep = NULL;
+    ct->null_shift = 0;
+    ct->const_shift = 0;
 
     return ct;
 }
 
+/************************************************************************/
+/*                        CTABLE V3 format                              */
+/*                                                                      */
+/*      Header layout (256 bytes, data at the 64 byte aligned offset    */
+/*      256, written by nad2bin -f ctable3/ctable3q):                   */
+/*                                                                      */
+/*        0   "CTABLE V3.0     "                                        */
+/*        16  id (80 bytes)                                             */
+/*        96  ll.lam, ll.phi, del.lam, del.phi (doubles)                */
+/*        128 lim.lam, lim.phi (32 bit ints)                            */
+/*        136 byte order tag: 1 = LSB, 0 = MSB                          */
+/*        137 encoding: 0 = native FLP float pairs, 1 = int16           */
+/*            quantized pairs                                           */
+/*        144 scale.lam, scale.phi (doubles, radians per unit for       */
+/*            the quantized encoding)                                   */
+/*        160 32 bit additive checksum of the data section              */
+/*                                                                      */
+/*      Numeric header fields and data are in the byte order named      */
+/*      by the tag, so a file written on a like-ordered host loads      */
+/*      (or maps) with zero transformation.                             */
+/************************************************************************/
+
+#define CTABLE3_HEADER_SIZE  256
+#define CTABLE3_DATA_OFFSET  256
+
+unsigned int nad_ctable3_checksum( const unsigned char *data, long size )
+
+{
+    unsigned int sum = 0;
+    long i;
+
+    for( i = 0; i < size; i++ )
+        sum = sum * 31 + data[i];
+
+    return sum;
+}
+
+/************************************************************************/
+/*                          nad_ctable3_init()                          */
+/*                                                                      */
+/*      Read the header portion of a "ctable3" format grid.             */
+/************************************************************************/
+
+struct CTABLE *nad_ctable3_init( projCtx ctx, PAFile fid )
+{
+    struct CTABLE *ct;
+    int		id_end;
+    char        header[CTABLE3_HEADER_SIZE];
+
+    if( pj_ctx_fread( ctx, header, sizeof(header), 1, fid ) != 1 )
+    {
+        pj_ctx_set_errno( ctx, -38 );
+        return NULL;
+    }
+
+    if( strncmp(header,"CTABLE V3",9) != 0 )
+    {
+        pj_log( ctx, PJ_LOG_ERROR, "ctable3 - wrong header!" );
+        pj_ctx_set_errno( ctx, -38 );
+        return NULL;
+    }
+
+    if( (header[136] != 0) != IS_LSB )
+    {
+        swap_words( header +  96, 8, 4 );
+        swap_words( header + 128, 4, 2 );
+    }
+
+    ct = (struct CTABLE *) pj_malloc(sizeof(struct CTABLE));
+    if( ct == NULL )
+    {
+        pj_ctx_set_errno( ctx, -38 );
+        return NULL;
+    }
+
+    memcpy( ct->id,       header +  16, 80 );
+    memcpy( &ct->ll.lam,  header +  96, 8 );
+    memcpy( &ct->ll.phi,  header + 104, 8 );
+    memcpy( &ct->del.lam, header + 112, 8 );
+    memcpy( &ct->del.phi, header + 120, 8 );
+    memcpy( &ct->lim.lam, header + 128, 4 );
+    memcpy( &ct->lim.phi, header + 132, 4 );
+
+    /* do some minimal validation to ensure the structure isn't corrupt */
+    if( ct->lim.lam < 1 || ct->lim.lam > 100000
+        || ct->lim.phi < 1 || ct->lim.phi > 100000
+        || (header[137] != 0 && header[137] != 1) )
+    {
+        pj_dalloc( ct );
+        pj_ctx_set_errno( ctx, -38 );
+        return NULL;
+    }
+
+    /* trim white space and newlines off id */
+    for( id_end = strlen(ct->id)-1; id_end > 0; id_end-- )
+    {
+        if( ct->id[id_end] == '\n' || ct->id[id_end] == ' ' )
+            ct->id[id_end] = '\0';
+        else
+            break;
+    }
+
+    ct->cvs = NULL;
+    ct->tiled = 0;
+    ct->tiles_lam = 0;
+    ct->packed = 0;
+    ct->qbase = NULL;
+    ct->qstep = NULL;
+    ct->null_shift = 0;
+    ct->const_shift = 0;
+
+    return ct;
+}
+
+/************************************************************************/
+/*                          nad_ctable3_load()                          */
+/*                                                                      */
+/*      Load the data portion of a ctable3 formatted grid, applying     */
+/*      byte swapping and dequantization as the header requires and     */
+/*      verifying the checksum.  The zero transformation fast path      */
+/*      (native byte order, float encoding) is the mmap in              */
+/*      pj_gridinfo_load(); this is the portable fallback.              */
+/************************************************************************/
+
+int nad_ctable3_load( projCtx ctx, struct CTABLE *ct, PAFile fid )
+
+{
+    char header[CTABLE3_HEADER_SIZE];
+    unsigned char *raw;
+    int  a_size, swap, quantized;
+    long data_size;
+    unsigned int file_sum;
+
+    pj_ctx_fseek( ctx, fid, 0, SEEK_SET );
+    if( pj_ctx_fread( ctx, header, sizeof(header), 1, fid ) != 1 )
+    {
+        pj_ctx_set_errno( ctx, -38 );
+        return 0;
+    }
+
+    swap = (header[136] != 0) != IS_LSB;
+    quantized = header[137] != 0;
+
+    a_size = ct->lim.lam * ct->lim.phi;
+    data_size = quantized ? (long) a_size * 2 * sizeof(short)
+        : (long) a_size * sizeof(FLP);
+
+    raw = (unsigned char *) pj_malloc( data_size );
+    ct->cvs = quantized ? (FLP *) pj_malloc(sizeof(FLP) * a_size)
+        : (FLP *) raw;
+    pj_numa_spread_touch( ct->cvs, sizeof(FLP) * a_size );
+    if( raw == NULL || ct->cvs == NULL
+        || pj_ctx_fread( ctx, raw, 1, data_size, fid ) != (size_t) data_size )
+    {
+        if( quantized )
+            pj_dalloc( ct->cvs );
+        pj_dalloc( raw );
+        ct->cvs = NULL;
+        pj_log( ctx, PJ_LOG_ERROR, "ctable3 loading failed on fread()" );
+        pj_ctx_set_errno( ctx, -38 );
+        return 0;
+    }
+
+    memcpy( &file_sum, header + 160, 4 );
+    if( swap )
+        swap_words( &file_sum, 4, 1 );
+    if( file_sum != nad_ctable3_checksum( raw, data_size ) )
+    {
+        if( quantized )
+            pj_dalloc( ct->cvs );
+        pj_dalloc( raw );
+        ct->cvs = NULL;
+        pj_log( ctx, PJ_LOG_ERROR, "ctable3 checksum mismatch" );
+        pj_ctx_set_errno( ctx, -38 );
+        return 0;
+    }
+
+    if( quantized )
+    {
+        double scale_lam, scale_phi;
+        short *q = (short *) raw;
+        int i;
+
+        memcpy( &scale_lam, header + 144, 8 );
+        memcpy( &scale_phi, header + 152, 8 );
+        if( swap )
+        {
+            swap_words( &scale_lam, 8, 1 );
+            swap_words( &scale_phi, 8, 1 );
+            swap_words( raw, 2, a_size * 2 );
+        }
+        for( i = 0; i < a_size; i++ )
+        {
+            ct->cvs[i].lam = (float) (q[i+i] * scale_lam);
+            ct->cvs[i].phi = (float) (q[i+i+1] * scale_phi);
+        }
+        pj_dalloc( raw );
+    }
+    else if( swap )
+        swap_words( ct->cvs, 4, a_size * 2 );
+
+    return 1;
+}
+
 /************************************************************************/
 /*                              nad_init()                              */
 /*                                                                      */
@@ -6,7 +6,7 @@ nad_intr(LP t, struct CTABLE *ct) {
 	LP val, frct;
 	ILP indx;
 	double m00, m10, m01, m11;
-	FLP *f00, *f10, *f01, *f11;
+	FLP *f00, *f10, *f01, *f11, dec[4];
 	long index;
 	int in;
 
@@ -41,14 +41,136 @@ nad_intr(LP t, struct CTABLE *ct) {
 		} else
 			return val;
 	}
-	index = indx.phi * ct->lim.lam + indx.lam;
-	f00 = ct->cvs + index++;
-	f10 = ct->cvs + index;
-	index += ct->lim.lam;
-	f11 = ct->cvs + index--;
-	f01 = ct->cvs + index;
+	if (ct->packed) {
+		const QLP *q = (const QLP *) ct->cvs
+			+ ((long) indx.phi * ct->lim.lam + indx.lam);
+		FLP b = ct->qbase[indx.phi], st = ct->qstep[indx.phi];
+
+		dec[0].lam = b.lam + st.lam * q[0].lam;
+		dec[0].phi = b.phi + st.phi * q[0].phi;
+		dec[1].lam = b.lam + st.lam * q[1].lam;
+		dec[1].phi = b.phi + st.phi * q[1].phi;
+		b = ct->qbase[indx.phi + 1];
+		st = ct->qstep[indx.phi + 1];
+		q += ct->lim.lam;
+		dec[2].lam = b.lam + st.lam * q[0].lam;
+		dec[2].phi = b.phi + st.phi * q[0].phi;
+		dec[3].lam = b.lam + st.lam * q[1].lam;
+		dec[3].phi = b.phi + st.phi * q[1].phi;
+		f00 = dec; f10 = dec + 1; f01 = dec + 2; f11 = dec + 3;
+	} else if (ct->tiled) {
+		f00 = ct->cvs + CT_TILED_INDEX(ct, indx.phi, indx.lam);
+		f10 = ct->cvs + CT_TILED_INDEX(ct, indx.phi, indx.lam + 1);
+		f01 = ct->cvs + CT_TILED_INDEX(ct, indx.phi + 1, indx.lam);
+		f11 = ct->cvs + CT_TILED_INDEX(ct, indx.phi + 1, indx.lam + 1);
+	} else {
+		index = indx.phi * ct->lim.lam + indx.lam;
+		f00 = ct->cvs + index++;
+		f10 = ct->cvs + index;
+		index += ct->lim.lam;
+		f11 = ct->cvs + index--;
+		f01 = ct->cvs + index;
+	}
+	m11 = m10 = frct.lam;
+	m00 = m01 = 1. - frct.lam;
+	m11 *= frct.phi;
+	m01 *= frct.phi;
+	frct.phi = 1. - frct.phi;
+	m00 *= frct.phi;
+	m10 *= frct.phi;
+	val.lam = m00 * f00->lam + m10 * f10->lam +
+			  m01 * f01->lam + m11 * f11->lam;
+	val.phi = m00 * f00->phi + m10 * f10->phi +
+			  m01 * f01->phi + m11 * f11->phi;
+	return val;
+}
+
+/* As nad_intr(), but also return the partial derivatives of the
+** interpolated shift with respect to the (unnormalized) input
+** coordinates: dlam holds d(val)/d(t.lam), dphi holds d(val)/d(t.phi).
+** Used by the Newton based inverse in nad_cvt(). */
+	LP
+nad_intr_grad(LP t, struct CTABLE *ct, LP *dlam, LP *dphi) {
+	LP val, frct;
+	ILP indx;
+	double m00, m10, m01, m11;
+	FLP *f00, *f10, *f01, *f11, dec[4];
+	long index;
+	int in;
+
+	dlam->lam = dlam->phi = dphi->lam = dphi->phi = 0.;
+	indx.lam = floor(t.lam /= ct->del.lam);
+	indx.phi = floor(t.phi /= ct->del.phi);
+	frct.lam = t.lam - indx.lam;
+	frct.phi = t.phi - indx.phi;
+	val.lam = val.phi = HUGE_VAL;
+	if (indx.lam < 0) {
+		if (indx.lam == -1 && frct.lam > 0.99999999999) {
+			++indx.lam;
+			frct.lam = 0.;
+		} else
+			return val;
+	} else if ((in = indx.lam + 1) >= ct->lim.lam) {
+		if (in == ct->lim.lam && frct.lam < 1e-11) {
+			--indx.lam;
+			frct.lam = 1.;
+		} else
+			return val;
+	}
+	if (indx.phi < 0) {
+		if (indx.phi == -1 && frct.phi > 0.99999999999) {
+			++indx.phi;
+			frct.phi = 0.;
+		} else
+			return val;
+	} else if ((in = indx.phi + 1) >= ct->lim.phi) {
+		if (in == ct->lim.phi && frct.phi < 1e-11) {
+			--indx.phi;
+			frct.phi = 1.;
+		} else
+			return val;
+	}
+	if (ct->packed) {
+		const QLP *q = (const QLP *) ct->cvs
+			+ ((long) indx.phi * ct->lim.lam + indx.lam);
+		FLP b = ct->qbase[indx.phi], st = ct->qstep[indx.phi];
+
+		dec[0].lam = b.lam + st.lam * q[0].lam;
+		dec[0].phi = b.phi + st.phi * q[0].phi;
+		dec[1].lam = b.lam + st.lam * q[1].lam;
+		dec[1].phi = b.phi + st.phi * q[1].phi;
+		b = ct->qbase[indx.phi + 1];
+		st = ct->qstep[indx.phi + 1];
+		q += ct->lim.lam;
+		dec[2].lam = b.lam + st.lam * q[0].lam;
+		dec[2].phi = b.phi + st.phi * q[0].phi;
+		dec[3].lam = b.lam + st.lam * q[1].lam;
+		dec[3].phi = b.phi + st.phi * q[1].phi;
+		f00 = dec; f10 = dec + 1; f01 = dec + 2; f11 = dec + 3;
+	} else if (ct->tiled) {
+		f00 = ct->cvs + CT_TILED_INDEX(ct, indx.phi, indx.lam);
+		f10 = ct->cvs + CT_TILED_INDEX(ct, indx.phi, indx.lam + 1);
+		f01 = ct->cvs + CT_TILED_INDEX(ct, indx.phi + 1, indx.lam);
+		f11 = ct->cvs + CT_TILED_INDEX(ct, indx.phi + 1, indx.lam + 1);
+	} else {
+		index = indx.phi * ct->lim.lam + indx.lam;
+		f00 = ct->cvs + index++;
+		f10 = ct->cvs + index;
+		index += ct->lim.lam;
+		f11 = ct->cvs + index--;
+		f01 = ct->cvs + index;
+	}
 	m11 = m10 = frct.lam;
 	m00 = m01 = 1. - frct.lam;
+	/* derivatives of the bilinear patch, scaled back to input units */
+	dlam->lam = ((1. - frct.phi) * (f10->lam - f00->lam) +
+			  frct.phi * (f11->lam - f01->lam)) / ct->del.lam;
+	dlam->phi = ((1. - frct.phi) * (f10->phi - f00->phi) +
+			  frct.phi * (f11->phi - f01->phi)) / ct->del.lam;
+	dphi->lam = (m00 * (f01->lam - f00->lam) +
+			  frct.lam * (f11->lam - f10->lam)) / ct->del.phi;
+	dphi->phi = (m00 * (f01->phi - f00->phi) +
+			  frct.lam * (f11->phi - f10->phi)) / ct->del.phi;
 	m11 *= frct.phi;
 	m01 *= frct.phi;
 	frct.phi = 1. - frct.phi;
@@ -60,3 +182,287 @@ nad_intr(LP t, struct CTABLE *ct) {
 			  m01 * f01->phi + m11 * f11->phi;
 	return val;
 }
+
+	void
+nad_stencil_clear(struct nad_stencil *sten) {
+	sten->ct = NULL;
+}
+
+/* Load the four bilinear corner values for cell indx of ct into sten,
+** reusing the previous load when both the table and the cell match.
+** Consecutive points from raster style traversals usually land in the
+** same cell, so the table reads (and, for packed tables, the
+** dequantization) amortize over the whole run. */
+	static void
+nad_stencil_load(struct CTABLE *ct, ILP indx, struct nad_stencil *sten) {
+	long index;
+
+	if (sten->ct == ct && sten->indx.lam == indx.lam
+			&& sten->indx.phi == indx.phi)
+		return;
+	if (ct->packed) {
+		const QLP *q = (const QLP *) ct->cvs
+			+ ((long) indx.phi * ct->lim.lam + indx.lam);
+		FLP b = ct->qbase[indx.phi], st = ct->qstep[indx.phi];
+
+		sten->f00.lam = b.lam + st.lam * q[0].lam;
+		sten->f00.phi = b.phi + st.phi * q[0].phi;
+		sten->f10.lam = b.lam + st.lam * q[1].lam;
+		sten->f10.phi = b.phi + st.phi * q[1].phi;
+		b = ct->qbase[indx.phi + 1];
+		st = ct->qstep[indx.phi + 1];
+		q += ct->lim.lam;
+		sten->f01.lam = b.lam + st.lam * q[0].lam;
+		sten->f01.phi = b.phi + st.phi * q[0].phi;
+		sten->f11.lam = b.lam + st.lam * q[1].lam;
+		sten->f11.phi = b.phi + st.phi * q[1].phi;
+	} else if (ct->tiled) {
+		sten->f00 = ct->cvs[CT_TILED_INDEX(ct, indx.phi, indx.lam)];
+		sten->f10 = ct->cvs[CT_TILED_INDEX(ct, indx.phi, indx.lam + 1)];
+		sten->f01 = ct->cvs[CT_TILED_INDEX(ct, indx.phi + 1, indx.lam)];
+		sten->f11 = ct->cvs[CT_TILED_INDEX(ct, indx.phi + 1, indx.lam + 1)];
+	} else {
+		index = indx.phi * ct->lim.lam + indx.lam;
+		sten->f00 = ct->cvs[index++];
+		sten->f10 = ct->cvs[index];
+		index += ct->lim.lam;
+		sten->f11 = ct->cvs[index--];
+		sten->f01 = ct->cvs[index];
+	}
+	sten->ct = ct;
+	sten->indx = indx;
+}
+
+/* As nad_intr(), but the corner loads go through a caller held stencil
+** cache.  Results are identical to nad_intr(). */
+	LP
+nad_intr_stencil(LP t, struct CTABLE *ct, struct nad_stencil *sten) {
+	LP val, frct;
+	ILP indx;
+	double m00, m10, m01, m11;
+	int in;
+
+	indx.lam = floor(t.lam /= ct->del.lam);
+	indx.phi = floor(t.phi /= ct->del.phi);
+	frct.lam = t.lam - indx.lam;
+	frct.phi = t.phi - indx.phi;
+	val.lam = val.phi = HUGE_VAL;
+	if (indx.lam < 0) {
+		if (indx.lam == -1 && frct.lam > 0.99999999999) {
+			++indx.lam;
+			frct.lam = 0.;
+		} else
+			return val;
+	} else if ((in = indx.lam + 1) >= ct->lim.lam) {
+		if (in == ct->lim.lam && frct.lam < 1e-11) {
+			--indx.lam;
+			frct.lam = 1.;
+		} else
+			return val;
+	}
+	if (indx.phi < 0) {
+		if (indx.phi == -1 && frct.phi > 0.99999999999) {
+			++indx.phi;
+			frct.phi = 0.;
+		} else
+			return val;
+	} else if ((in = indx.phi + 1) >= ct->lim.phi) {
+		if (in == ct->lim.phi && frct.phi < 1e-11) {
+			--indx.phi;
+			frct.phi = 1.;
+		} else
+			return val;
+	}
+	nad_stencil_load(ct, indx, sten);
+	m11 = m10 = frct.lam;
+	m00 = m01 = 1. - frct.lam;
+	m11 *= frct.phi;
+	m01 *= frct.phi;
+	frct.phi = 1. - frct.phi;
+	m00 *= frct.phi;
+	m10 *= frct.phi;
+	val.lam = m00 * sten->f00.lam + m10 * sten->f10.lam +
+			  m01 * sten->f01.lam + m11 * sten->f11.lam;
+	val.phi = m00 * sten->f00.phi + m10 * sten->f10.phi +
+			  m01 * sten->f01.phi + m11 * sten->f11.phi;
+	return val;
+}
+
+/* As nad_intr_grad(), but with the stencil cache of nad_intr_stencil();
+** the Newton iterations of nad_cvt() rarely leave the cell, so the
+** corner loads collapse to one per solved point. */
+	LP
+nad_intr_grad_stencil(LP t, struct CTABLE *ct, LP *dlam, LP *dphi,
+		struct nad_stencil *sten) {
+	LP val, frct;
+	ILP indx;
+	double m00, m10, m01, m11;
+	int in;
+
+	dlam->lam = dlam->phi = dphi->lam = dphi->phi = 0.;
+	indx.lam = floor(t.lam /= ct->del.lam);
+	indx.phi = floor(t.phi /= ct->del.phi);
+	frct.lam = t.lam - indx.lam;
+	frct.phi = t.phi - indx.phi;
+	val.lam = val.phi = HUGE_VAL;
+	if (indx.lam < 0) {
+		if (indx.lam == -1 && frct.lam > 0.99999999999) {
+			++indx.lam;
+			frct.lam = 0.;
+		} else
+			return val;
+	} else if ((in = indx.lam + 1) >= ct->lim.lam) {
+		if (in == ct->lim.lam && frct.lam < 1e-11) {
+			--indx.lam;
+			frct.lam = 1.;
+		} else
+			return val;
+	}
+	if (indx.phi < 0) {
+		if (indx.phi == -1 && frct.phi > 0.99999999999) {
+			++indx.phi;
+			frct.phi = 0.;
+		} else
+			return val;
+	} else if ((in = indx.phi + 1) >= ct->lim.phi) {
+		if (in == ct->lim.phi && frct.phi < 1e-11) {
+			--indx.phi;
+			frct.phi = 1.;
+		} else
+			return val;
+	}
+	nad_stencil_load(ct, indx, sten);
+	m11 = m10 = frct.lam;
+	m00 = m01 = 1. - frct.lam;
+	/* derivatives of the bilinear patch, scaled back to input units */
+	dlam->lam = ((1. - frct.phi) * (sten->f10.lam - sten->f00.lam) +
+			  frct.phi * (sten->f11.lam - sten->f01.lam)) / ct->del.lam;
+	dlam->phi = ((1. - frct.phi) * (sten->f10.phi - sten->f00.phi) +
+			  frct.phi * (sten->f11.phi - sten->f01.phi)) / ct->del.lam;
+	dphi->lam = (m00 * (sten->f01.lam - sten->f00.lam) +
+			  frct.lam * (sten->f11.lam - sten->f10.lam)) / ct->del.phi;
+	dphi->phi = (m00 * (sten->f01.phi - sten->f00.phi) +
+			  frct.lam * (sten->f11.phi - sten->f10.phi)) / ct->del.phi;
+	m11 *= frct.phi;
+	m01 *= frct.phi;
+	frct.phi = 1. - frct.phi;
+	m00 *= frct.phi;
+	m10 *= frct.phi;
+	val.lam = m00 * sten->f00.lam + m10 * sten->f10.lam +
+			  m01 * sten->f01.lam + m11 * sten->f11.lam;
+	val.phi = m00 * sten->f00.phi + m10 * sten->f10.phi +
+			  m01 * sten->f01.phi + m11 * sten->f11.phi;
+	return val;
+}
+
+/* Rearrange a row-major cvs array into CT_TILE x CT_TILE tiles so the
+** four corners of a bilinear stencil usually land in one small memory
+** region; with row-major order every lookup touches two rows a full
+** row stride apart, which thrashes the TLB on large grids fed
+** spatially scattered points.  Edge tiles are zero padded.  Returns 0
+** (leaving the table row-major) if the tiled copy cannot be
+** allocated.  Must not be used on tables whose cvs points into a
+** read-only file mapping. */
+	int
+nad_ctable_tile(struct CTABLE *ct) {
+	int tiles_lam = (ct->lim.lam + CT_TILE_MASK) >> CT_TILE_SHIFT;
+	int tiles_phi = (ct->lim.phi + CT_TILE_MASK) >> CT_TILE_SHIFT;
+	long size = (long) tiles_lam * tiles_phi * CT_TILE * CT_TILE;
+	FLP *tiled;
+	int r, c;
+
+	if (ct->tiled || ct->packed || ct->cvs == NULL)
+		return ct->tiled;
+	if (!(tiled = (FLP *) pj_malloc(size * sizeof(FLP))))
+		return 0;
+	memset(tiled, 0, size * sizeof(FLP));
+	ct->tiles_lam = tiles_lam;
+	for (r = 0; r < ct->lim.phi; ++r)
+		for (c = 0; c < ct->lim.lam; ++c)
+			tiled[CT_TILED_INDEX(ct, r, c)] =
+				ct->cvs[(long) r * ct->lim.lam + c];
+	pj_dalloc(ct->cvs);
+	ct->cvs = tiled;
+	ct->tiled = 1;
+	return 1;
+}
+
+/* Quantize a row-major cvs array to 16 bit values against per row
+** offset/step pairs, halving resident size (4 bytes per node plus two
+** FLP pairs per row).  The encoding is lossy: the error is bounded by
+** half a step, i.e. the row's shift range / 131070, well below the
+** stated accuracy of typical datum grids; stencils dequantize on the
+** fly in nad_intr().  Returns 0 (leaving the table unchanged) if the
+** packed copy cannot be allocated.  Must not be used on tables whose
+** cvs points into a read-only file mapping, nor combined with
+** nad_ctable_tile(). */
+	int
+nad_ctable_pack(struct CTABLE *ct) {
+	long a_size = (long) ct->lim.lam * ct->lim.phi;
+	long bytes = a_size * sizeof(QLP) + 2 * ct->lim.phi * sizeof(FLP);
+	QLP *q;
+	FLP *base, *step;
+	int r, c;
+
+	if (ct->packed || ct->tiled || ct->cvs == NULL)
+		return ct->packed;
+	if (!(q = (QLP *) pj_malloc(bytes)))
+		return 0;
+	base = (FLP *) (q + a_size);
+	step = base + ct->lim.phi;
+	for (r = 0; r < ct->lim.phi; ++r) {
+		const FLP *row = ct->cvs + (long) r * ct->lim.lam;
+		QLP *qrow = q + (long) r * ct->lim.lam;
+		float lo_lam = row[0].lam, hi_lam = row[0].lam;
+		float lo_phi = row[0].phi, hi_phi = row[0].phi;
+		double inv_lam, inv_phi, t;
+
+		for (c = 1; c < ct->lim.lam; ++c) {
+			if (row[c].lam < lo_lam) lo_lam = row[c].lam;
+			if (row[c].lam > hi_lam) hi_lam = row[c].lam;
+			if (row[c].phi < lo_phi) lo_phi = row[c].phi;
+			if (row[c].phi > hi_phi) hi_phi = row[c].phi;
+		}
+		base[r].lam = lo_lam;
+		base[r].phi = lo_phi;
+		step[r].lam = (float) ((hi_lam - lo_lam) / 65535.);
+		step[r].phi = (float) ((hi_phi - lo_phi) / 65535.);
+		inv_lam = step[r].lam > 0.f ? 1. / step[r].lam : 0.;
+		inv_phi = step[r].phi > 0.f ? 1. / step[r].phi : 0.;
+		for (c = 0; c < ct->lim.lam; ++c) {
+			/* the step is rounded to float, so clamp against
+			** overshoot at the row maximum */
+			t = floor((row[c].lam - lo_lam) * inv_lam + .5);
+			qrow[c].lam = (unsigned short) (t > 65535. ? 65535. : t);
+			t = floor((row[c].phi - lo_phi) * inv_phi + .5);
+			qrow[c].phi = (unsigned short) (t > 65535. ? 65535. : t);
+		}
+	}
+	pj_dalloc(ct->cvs);
+	ct->cvs = (FLP *) q;
+	ct->qbase = base;
+	ct->qstep = step;
+	ct->packed = 1;
+	return 1;
+}
+
+/* interpolate a batch of points against one table; in/out arrays may
+** alias.  Points outside the table yield HUGE_VAL pairs.  The stencil
+** carries across points, so runs sharing a cell load it only once. */
+	void
+nad_intr_batch(struct CTABLE *ct, long point_count,
+	const double *lam, const double *phi, double *out_lam, double *out_phi) {
+	struct nad_stencil sten;
+	long i;
+
+	nad_stencil_clear(&sten);
+	for (i = 0; i < point_count; ++i) {
+		LP t, val;
+
+		t.lam = lam[i];
+		t.phi = phi[i];
+		val = nad_intr_stencil(t, ct, &sten);
+		out_lam[i] = val.lam;
+		out_phi[i] = val.phi;
+	}
+}
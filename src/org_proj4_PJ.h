@@ -105,6 +105,14 @@ JNIEXPORT jdouble JNICALL Java_org_proj4_PJ_getLinearUnitToMetre
 JNIEXPORT void JNICALL Java_org_proj4_PJ_transform
   (JNIEnv *, jobject, jobject, jint, jdoubleArray, jint, jint);
 
+/*
+ * Class:     org_proj4_PJ
+ * Method:    transformBatch
+ * Signature: (Lorg/proj4/PJ;I[DII)[J
+ */
+JNIEXPORT jlongArray JNICALL Java_org_proj4_PJ_transformBatch
+  (JNIEnv *, jobject, jobject, jint, jdoubleArray, jint, jint);
+
 /*
  * Class:     org_proj4_PJ
  * Method:    getLastError
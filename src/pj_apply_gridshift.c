@@ -35,6 +35,7 @@
 #include <projects.h>
 #include <string.h>
 #include <math.h>
+#include <errno.h>
 
 /************************************************************************/
 /*                         pj_apply_gridshift()                         */
@@ -57,7 +58,7 @@ int pj_apply_gridshift( projCtx ctx, const char *nadgrids, int inverse,
     gridlist = pj_gridlist_from_nadgrids( ctx, nadgrids, &grid_count );
 
     if( gridlist == NULL || grid_count == 0 )
-        return ctx->last_errno;
+        return pj_ctx_get_errno( ctx );
 
     ret = pj_apply_gridshift_3( ctx, gridlist, grid_count, inverse, 
                                 point_count, point_offset, x, y, z );
@@ -80,26 +81,59 @@ int pj_apply_gridshift( projCtx ctx, const char *nadgrids, int inverse,
 /*      now.                                                            */
 /************************************************************************/
 
-int pj_apply_gridshift_2( PJ *defn, int inverse, 
-                          long point_count, int point_offset,
-                          double *x, double *y, double *z )
+/************************************************************************/
+/*                        pj_gridshift_resolve()                        */
+/*                                                                      */
+/*      Make sure the gridlist cached on the coordinate system          */
+/*      definition is populated and current, loading it if needed.      */
+/*      Factored out of pj_apply_gridshift_2() so callers that fan      */
+/*      the points out over several threads can resolve the list        */
+/*      up front, from a single thread.                                 */
+/************************************************************************/
+
+int pj_gridshift_resolve( PJ *defn )
 
 {
-    if( defn->catalog_name != NULL )
-        return pj_gc_apply_gridshift( defn, inverse, point_count, point_offset,
-                                      x, y, z );
-                                      
+    /* drop a cached grid list that predates a pj_deallocate_grids() --
+       the grids it points at are gone */
+    if( defn->gridlist != NULL
+        && defn->gridlist_generation != pj_gridlist_generation() )
+    {
+        pj_dalloc( defn->gridlist );
+        defn->gridlist = NULL;
+        defn->gridlist_count = 0;
+    }
+
     if( defn->gridlist == NULL )
     {
-        defn->gridlist = 
+        defn->gridlist_generation = pj_gridlist_generation();
+        defn->gridlist =
             pj_gridlist_from_nadgrids( pj_get_ctx( defn ),
-                                       pj_param(defn->ctx, defn->params,"snadgrids").s,
+                                       defn->nadgrids,
                                        &(defn->gridlist_count) );
 
         if( defn->gridlist == NULL || defn->gridlist_count == 0 )
-            return defn->ctx->last_errno;
+            return pj_ctx_get_errno( defn->ctx );
     }
-     
+
+    return 0;
+}
+
+int pj_apply_gridshift_2( PJ *defn, int inverse,
+                          long point_count, int point_offset,
+                          double *x, double *y, double *z )
+
+{
+    int err;
+
+    if( defn->catalog_name != NULL )
+        return pj_gc_apply_gridshift( defn, inverse, point_count, point_offset,
+                                      x, y, z );
+
+    err = pj_gridshift_resolve( defn );
+    if( err != 0 )
+        return err;
+
     return pj_apply_gridshift_3( pj_get_ctx( defn ),
                                  defn->gridlist, defn->gridlist_count, inverse, 
                                  point_count, point_offset, x, y, z );
@@ -112,6 +146,161 @@ int pj_apply_gridshift_2( PJ *defn, int inverse,
 /*      This is the real workhorse, given a gridlist.                   */
 /************************************************************************/
 
+/* eps-expanded extent of one grid, precomputed per call so the per
+** point table scan runs over contiguous values instead of chasing
+** CTABLE pointers */
+typedef struct {
+    double min_lam, min_phi;
+    double max_lam, max_phi;
+} PJGridExtent;
+
+/************************************************************************/
+/*                         pj_set_grid_blend()                          */
+/*                                                                      */
+/*      With blending enabled, points that fall within the boundary     */
+/*      band of the grid that shifts them - the outermost               */
+/*      PJ_GRID_BLEND_CELLS cells - and for which a second source       */
+/*      exists (the NTv2 parent of a subgrid, or a lower priority       */
+/*      table that also covers the point) get a distance weighted mix   */
+/*      of the two shifts instead of a hard handover, removing the      */
+/*      discontinuities seen where subgrid or table seams meet.         */
+/*      Which tables can need blending is flagged once per call, so     */
+/*      points away from any band keep the single grid fast path.       */
+/************************************************************************/
+
+#define PJ_GRID_BLEND_CELLS 4.0
+
+static volatile int grid_blend_flag = -1;
+
+void pj_set_grid_blend( int flag )
+
+{
+    grid_blend_flag = flag;
+}
+
+static int pj_use_grid_blend()
+
+{
+    if( grid_blend_flag < 0 )
+        grid_blend_flag = getenv( "PJ_GRID_BLEND" ) != NULL;
+    return grid_blend_flag;
+}
+
+/************************************************************************/
+/*                      pj_gridshift_edge_cells()                       */
+/*                                                                      */
+/*      Distance from a point to the nearest edge of a grid, in grid    */
+/*      cells; negative outside the table proper.                       */
+/************************************************************************/
+
+static double pj_gridshift_edge_cells( struct CTABLE *ct, LP input )
+
+{
+    double dl = (input.lam - ct->ll.lam) / fabs(ct->del.lam);
+    double dp = (input.phi - ct->ll.phi) / fabs(ct->del.phi);
+    double el = (double) (ct->lim.lam - 1) - dl;
+    double ep = (double) (ct->lim.phi - 1) - dp;
+    double d = dl;
+
+    if( dp < d ) d = dp;
+    if( el < d ) d = el;
+    if( ep < d ) d = ep;
+    return d;
+}
+
+static void pj_gridshift_extent( struct CTABLE *ct, PJGridExtent *ext )
+
+{
+    double epsilon = (fabs(ct->del.phi)+fabs(ct->del.lam))/10000.0;
+
+    ext->min_lam = ct->ll.lam - epsilon;
+    ext->min_phi = ct->ll.phi - epsilon;
+    ext->max_lam = ct->ll.lam + (ct->lim.lam-1) * ct->del.lam + epsilon;
+    ext->max_phi = ct->ll.phi + (ct->lim.phi-1) * ct->del.phi + epsilon;
+}
+
+#define PJ_EXTENT_CONTAINS(ext,pt) \
+    ((pt).lam >= (ext).min_lam && (pt).lam <= (ext).max_lam \
+     && (pt).phi >= (ext).min_phi && (pt).phi <= (ext).max_phi)
+
+/************************************************************************/
+/*                        pj_gridshift_ready()                          */
+/*                                                                      */
+/*      Make a grid's payload usable for a blend contribution,          */
+/*      honouring the context load mode; returns 0 when the grid        */
+/*      cannot serve right now, in which case the blend is simply       */
+/*      skipped rather than failed.                                     */
+/************************************************************************/
+
+static int pj_gridshift_ready( projCtx ctx, PJ_GRIDINFO *gi )
+
+{
+    if( gi->ct->cvs != NULL )
+        return 1;
+
+    if( ctx->grid_load_mode != PJ_GRID_LOAD_BLOCK )
+        return pj_gridinfo_load_background( ctx, gi );
+
+    return pj_gridinfo_load( ctx, gi );
+}
+
+/************************************************************************/
+/*                        pj_gridshift_blend()                          */
+/*                                                                      */
+/*      Mix the primary shift of a boundary band point with the         */
+/*      nearest fallback source: the NTv2 parent when the shifting      */
+/*      grid is a subgrid, else the next covering table in priority     */
+/*      order.  The primary's weight fades linearly from one at the     */
+/*      inner edge of the band to zero at the table edge, which is      */
+/*      exactly where a scan without the primary would hand over to     */
+/*      the fallback, so the shift field becomes continuous across      */
+/*      the seam.  With no usable fallback the primary shift stands.    */
+/************************************************************************/
+
+static LP pj_gridshift_blend( projCtx ctx, PJ_GRIDINFO **tables,
+                              int grid_count, PJGridExtent *extents,
+                              int inverse, int leaf_itable,
+                              PJ_GRIDINFO *leaf, PJ_GRIDINFO *parent,
+                              LP input, LP primary )
+
+{
+    LP  alt, output;
+    int itable;
+    double w;
+
+    alt.lam = alt.phi = HUGE_VAL;
+
+    if( parent != NULL && pj_gridshift_ready( ctx, parent ) )
+        alt = nad_cvt( input, inverse, parent->ct );
+
+    for( itable = 0; alt.lam == HUGE_VAL && itable < grid_count; itable++ )
+    {
+        PJ_GRIDINFO *gi = tables[itable];
+
+        if( itable == leaf_itable
+            || !PJ_EXTENT_CONTAINS(extents[itable], input) )
+            continue;
+
+        gi = pj_gridinfo_descend( gi, input, NULL );
+
+        if( gi == leaf || !pj_gridshift_ready( ctx, gi ) )
+            continue;
+
+        alt = nad_cvt( input, inverse, gi->ct );
+    }
+
+    if( alt.lam == HUGE_VAL )
+        return primary;
+
+    w = pj_gridshift_edge_cells( leaf->ct, input ) / PJ_GRID_BLEND_CELLS;
+    if( w < 0.0 ) w = 0.0;
+    if( w > 1.0 ) w = 1.0;
+
+    output.lam = w * primary.lam + (1.0 - w) * alt.lam;
+    output.phi = w * primary.phi + (1.0 - w) * alt.phi;
+    return output;
+}
+
 int pj_apply_gridshift_3( projCtx ctx, PJ_GRIDINFO **tables, int grid_count,
                           int inverse, long point_count, int point_offset,
                           double *x, double *y, double *z )
@@ -119,6 +308,18 @@ int pj_apply_gridshift_3( projCtx ctx, PJ_GRIDINFO **tables, int grid_count,
 {
     int  i;
     static int debug_count = 0;
+    PJGridExtent static_extents[8];
+    PJGridExtent *extents = static_extents;
+    char static_band[8];
+    char *band_flag = static_band;
+    int  blend = pj_use_grid_blend();
+    PJ_GRIDINFO *last_match = NULL; /* leaf grid used for previous point */
+    PJGridExtent last_extent;
+    int last_itable = 0;            /* top level table last_match is under */
+    struct nad_stencil stencil;     /* bilinear corners shared along runs
+                                       of points in one grid cell */
+    double *batch = NULL;           /* phased fast path scratch */
+    char   *done = NULL;            /* lanes the fast path settled */
 
     if( tables == NULL || grid_count == 0 )
     {
@@ -126,7 +327,226 @@ int pj_apply_gridshift_3( projCtx ctx, PJ_GRIDINFO **tables, int grid_count,
         return -38;
     }
 
-    ctx->last_errno = 0;
+    pj_ctx_set_errno( ctx, 0 );
+
+    /* pin the grids (and subgrids) so the cache budget manager cannot
+       evict their payloads while the point loop reads them unlocked */
+    pj_grid_cache_pin( tables, grid_count, 1 );
+
+/* -------------------------------------------------------------------- */
+/*      Precompute the top level extents once per call.                 */
+/* -------------------------------------------------------------------- */
+    if( grid_count > (int) (sizeof(static_extents)/sizeof(PJGridExtent)) )
+    {
+        extents = (PJGridExtent *) pj_malloc(
+            (sizeof(PJGridExtent)+1) * grid_count );
+        if( extents == NULL )
+        {
+            pj_ctx_set_errno( ctx, ENOMEM );
+            pj_grid_cache_pin( tables, grid_count, -1 );
+            return ENOMEM;
+        }
+        band_flag = (char *) (extents + grid_count);
+    }
+
+    for( i = 0; i < grid_count; i++ )
+        pj_gridshift_extent( tables[i]->ct, extents + i );
+
+    /* flag the tables whose boundary bands can have a second source:
+       subgrid seams always can (the parent covers them), table edges
+       only where another table's extent reaches in.  Points shifted
+       by an unflagged table never leave the single grid fast path. */
+    if( blend )
+    {
+        int j;
+
+        for( i = 0; i < grid_count; i++ )
+        {
+            band_flag[i] = tables[i]->child != NULL;
+            for( j = 0; j < grid_count && !band_flag[i]; j++ )
+                band_flag[i] = j != i
+                    && extents[i].min_lam <= extents[j].max_lam
+                    && extents[i].max_lam >= extents[j].min_lam
+                    && extents[i].min_phi <= extents[j].max_phi
+                    && extents[i].max_phi >= extents[j].min_phi;
+        }
+    }
+
+    memset( &last_extent, 0, sizeof(last_extent) );
+    nad_stencil_clear( &stencil );
+
+/* -------------------------------------------------------------------- */
+/*      Phased fast path.  The per point loop below mixes the table     */
+/*      scan, the NTv2 child descent, deferred grid loading and error   */
+/*      logging in with the interpolation itself, which keeps the       */
+/*      compiler from vectorizing any of it.  When several points are   */
+/*      shifted at once we instead classify every point to its leaf     */
+/*      grid first, make sure those grids are loaded, then interpolate  */
+/*      each group of points against its grid in one uninterrupted      */
+/*      nad_cvt_batch() run, and account for misses at the end.  Lanes  */
+/*      the fast path could not settle (a containing grid whose         */
+/*      interpolation failed must fall through to lower priority        */
+/*      tables) are left for the per point loop.  Debugging runs keep   */
+/*      the per point loop so the per grid log messages still appear    */
+/*      in point order.                                                 */
+/* -------------------------------------------------------------------- */
+    if( point_count > 1 && ctx->debug_level < PJ_LOG_DEBUG_MAJOR )
+        batch = (double *) pj_ctx_buffer_get(
+            ctx, (size_t) point_count
+                 * (2 * sizeof(double) + sizeof(PJ_GRIDINFO *) + 1) );
+
+    if( batch != NULL )
+    {
+        double *la = batch, *pa = batch + point_count;
+        PJ_GRIDINFO **leaf = (PJ_GRIDINFO **) (pa + point_count);
+        long ip, misses = 0;
+        int abandoned = 0;
+
+        done = (char *) (leaf + point_count);
+        memset( done, 0, point_count );
+
+/* -------------------------------------------------------------------- */
+/*      Phase 1: classify each point to its leaf grid (extents and      */
+/*      child headers only, no payload access).                         */
+/* -------------------------------------------------------------------- */
+        for( ip = 0; ip < point_count; ip++ )
+        {
+            LP  input;
+            int itable;
+
+            input.phi = y[ip*point_offset];
+            input.lam = x[ip*point_offset];
+            leaf[ip] = NULL;
+
+            for( itable = 0; itable < grid_count; itable++ )
+            {
+                PJ_GRIDINFO *gi = tables[itable];
+
+                if( !PJ_EXTENT_CONTAINS(extents[itable], input) )
+                    continue;
+
+                leaf[ip] = pj_gridinfo_descend( gi, input, NULL );
+                break;
+            }
+
+            if( leaf[ip] == NULL )
+            {
+                /* no table covers the point; the per point scan would
+                   come up empty too, so settle the lane here */
+                done[ip] = 1;
+                misses++;
+#ifdef ERR_GRID_AREA_TRANSIENT_SEVERE
+                y[ip*point_offset] = HUGE_VAL;
+                x[ip*point_offset] = HUGE_VAL;
+#endif
+            }
+            else if( blend && band_flag[itable]
+                     && pj_gridshift_edge_cells( leaf[ip]->ct, input )
+                         < PJ_GRID_BLEND_CELLS )
+            {
+                /* boundary band: leave the lane to the per point
+                   loop, which knows how to blend */
+                leaf[ip] = NULL;
+            }
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Phase 2: make sure every referenced grid is loaded, once per    */
+/*      grid instead of once per covered point.                         */
+/* -------------------------------------------------------------------- */
+        for( ip = 0; ip < point_count; ip++ )
+        {
+            PJ_GRIDINFO *gi = leaf[ip];
+
+            if( gi == NULL || gi->ct->cvs != NULL )
+                continue;
+
+            if( ctx->grid_load_mode != PJ_GRID_LOAD_BLOCK )
+            {
+                if( !pj_gridinfo_load_background( ctx, gi ) )
+                {
+                    if( ctx->grid_load_mode == PJ_GRID_LOAD_FALLBACK )
+                    {
+                        /* the grid is not ready yet and the per point
+                           loop knows how to fall back to the remaining
+                           tables; abandon the fast path for this call */
+                        abandoned = 1;
+                        break;
+                    }
+
+                    pj_ctx_set_errno( ctx, -50 );
+                    pj_ctx_buffer_put( ctx, batch );
+                    if( extents != static_extents )
+                        pj_dalloc( extents );
+                    pj_grid_cache_pin( tables, grid_count, -1 );
+                    return -50;
+                }
+            }
+            else if( !pj_gridinfo_load( ctx, gi ) )
+            {
+                pj_ctx_set_errno( ctx, -38 );
+                pj_ctx_buffer_put( ctx, batch );
+                if( extents != static_extents )
+                    pj_dalloc( extents );
+                pj_grid_cache_pin( tables, grid_count, -1 );
+                return -38;
+            }
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Phase 3: interpolate, one grid group at a time.  The gather /   */
+/*      nad_cvt_batch() / scatter sequence touches only loaded          */
+/*      payloads and HUGE_VAL flags, no loads, no logging.              */
+/* -------------------------------------------------------------------- */
+        if( !abandoned )
+        {
+            for( ip = 0; ip < point_count; ip++ )
+            {
+                PJ_GRIDINFO *gi = leaf[ip];
+                long jp, m = 0;
+
+                if( gi == NULL )
+                    continue;
+
+                for( jp = ip; jp < point_count; jp++ )
+                {
+                    if( leaf[jp] != gi )
+                        continue;
+                    la[m] = x[jp*point_offset];
+                    pa[m] = y[jp*point_offset];
+                    m++;
+                }
+
+                nad_cvt_batch( inverse, gi->ct, m, la, pa );
+
+                m = 0;
+                for( jp = ip; jp < point_count; jp++ )
+                {
+                    if( leaf[jp] != gi )
+                        continue;
+                    if( la[m] != HUGE_VAL )
+                    {
+                        x[jp*point_offset] = la[m];
+                        y[jp*point_offset] = pa[m];
+                        done[jp] = 1;
+                        PJ_STAT_INC( ctx, grid_hits );
+                    }
+                    /* else: inside the extent but the interpolation
+                       failed; the per point loop tries the remaining
+                       tables for this lane */
+                    leaf[jp] = NULL;
+                    m++;
+                }
+            }
+
+/* -------------------------------------------------------------------- */
+/*      Phase 4: deferred miss accounting.                              */
+/* -------------------------------------------------------------------- */
+            PJ_STAT_ADD( ctx, grid_misses, misses );
+        }
+        else
+            done = NULL;    /* the scratch (and batch) is put back below */
+    }
 
     for( i = 0; i < point_count; i++ )
     {
@@ -134,79 +554,121 @@ int pj_apply_gridshift_3( projCtx ctx, PJ_GRIDINFO **tables, int grid_count,
         LP   input, output;
         int  itable;
 
+        if( done != NULL && done[i] )
+            continue;
+
         input.phi = y[io];
         input.lam = x[io];
         output.phi = HUGE_VAL;
         output.lam = HUGE_VAL;
 
+/* -------------------------------------------------------------------- */
+/*      Exploit point locality: if the previous point resolved to a     */
+/*      grid, and no higher priority table covers this point, and the   */
+/*      point is still inside that grid, use it directly and skip the   */
+/*      child descent.  Sibling subgrids do not overlap (per the NTv2   */
+/*      spec) so this gives the same answer as a fresh scan.            */
+/* -------------------------------------------------------------------- */
+        if( last_match != NULL && PJ_EXTENT_CONTAINS(last_extent, input)
+            && !(blend && band_flag[last_itable]
+                 && pj_gridshift_edge_cells( last_match->ct, input )
+                     < PJ_GRID_BLEND_CELLS) )
+        {
+            for( itable = 0; itable < last_itable; itable++ )
+            {
+                if( PJ_EXTENT_CONTAINS(extents[itable], input) )
+                    break;
+            }
+
+            if( itable == last_itable )
+            {
+                output = nad_cvt_stencil( input, inverse, last_match->ct,
+                                          &stencil );
+                if( output.lam != HUGE_VAL )
+                {
+                    PJ_STAT_INC( ctx, grid_hits );
+                    y[io] = output.phi;
+                    x[io] = output.lam;
+                    continue;
+                }
+            }
+        }
+
         /* keep trying till we find a table that works */
         for( itable = 0; itable < grid_count; itable++ )
         {
             PJ_GRIDINFO *gi = tables[itable];
+            PJ_GRIDINFO *parent = NULL;
             struct CTABLE *ct = gi->ct;
-            double epsilon = (fabs(ct->del.phi)+fabs(ct->del.lam))/10000.0;
 
             /* skip tables that don't match our point at all.  */
-            if( ct->ll.phi - epsilon > input.phi 
-                || ct->ll.lam - epsilon > input.lam
-                || (ct->ll.phi + (ct->lim.phi-1) * ct->del.phi + epsilon 
-                    < input.phi)
-                || (ct->ll.lam + (ct->lim.lam-1) * ct->del.lam + epsilon 
-                    < input.lam) )
+            if( !PJ_EXTENT_CONTAINS(extents[itable], input) )
                 continue;
 
             /* If we have child nodes, check to see if any of them apply. */
-            while( gi->child )
-            {
-                PJ_GRIDINFO *child;
+            gi = pj_gridinfo_descend( gi, input, &parent );
+            ct = gi->ct;
 
-                for( child = gi->child; child != NULL; child = child->next )
+            /* load the grid shift info if we don't have it. */
+            if( ct->cvs == NULL )
+            {
+                if( ctx->grid_load_mode != PJ_GRID_LOAD_BLOCK )
                 {
-                    struct CTABLE *ct1 = child->ct;
-                    double epsilon = 
-                        (fabs(ct1->del.phi)+fabs(ct1->del.lam))/10000.0;
-
-                    if( ct1->ll.phi - epsilon > input.phi 
-                        || ct1->ll.lam - epsilon > input.lam
-                        || (ct1->ll.phi+(ct1->lim.phi-1)*ct1->del.phi + epsilon 
-                            < input.phi)
-                        || (ct1->ll.lam+(ct1->lim.lam-1)*ct1->del.lam + epsilon 
-                            < input.lam) )
-                        continue;
-
-                    break;
+                    if( !pj_gridinfo_load_background( ctx, gi ) )
+                    {
+                        if( ctx->grid_load_mode == PJ_GRID_LOAD_FALLBACK )
+                        {
+                            /* shift with the remaining grids for now;
+                               the load just kicked off serves later
+                               calls */
+                            PJ_STAT_INC( ctx, grid_provisional );
+                            continue;
+                        }
+
+                        pj_ctx_set_errno( ctx, -50 );
+                        if( extents != static_extents )
+                            pj_dalloc( extents );
+                        pj_grid_cache_pin( tables, grid_count, -1 );
+                        return -50;
+                    }
+                }
+                else if( !pj_gridinfo_load( ctx, gi ) )
+                {
+                    pj_ctx_set_errno( ctx, -38 );
+                    if( extents != static_extents )
+                        pj_dalloc( extents );
+                    pj_grid_cache_pin( tables, grid_count, -1 );
+                    return -38;
                 }
-
-                /* If we didn't find a child then nothing more to do */
-
-                if( child == NULL ) break;
-
-                /* Otherwise use the child, first checking it's children */
-
-                gi = child;
-                ct = child->ct;
             }
 
-            /* load the grid shift info if we don't have it. */
-            if( ct->cvs == NULL && !pj_gridinfo_load( ctx, gi ) )
-            {
-                pj_ctx_set_errno( ctx, -38 );
-                return -38;
-            }
-            
-            output = nad_cvt( input, inverse, ct );
+            output = nad_cvt_stencil( input, inverse, ct, &stencil );
             if( output.lam != HUGE_VAL )
             {
-                if( debug_count++ < 20 )
+                if( blend && band_flag[itable]
+                    && pj_gridshift_edge_cells( ct, input )
+                        < PJ_GRID_BLEND_CELLS )
+                    output = pj_gridshift_blend( ctx, tables, grid_count,
+                                                 extents, inverse, itable,
+                                                 gi, parent, input, output );
+
+                PJ_STAT_INC( ctx, grid_hits );
+                if( PJ_LOG_ENABLED( ctx, PJ_LOG_DEBUG_MINOR )
+                    && debug_count++ < 20 )
                     pj_log( ctx, PJ_LOG_DEBUG_MINOR,
                             "pj_apply_gridshift(): used %s", ct->id );
+
+                last_match = gi;
+                last_itable = itable;
+                pj_gridshift_extent( ct, &last_extent );
                 break;
             }
         }
 
         if( output.lam == HUGE_VAL )
         {
-            if( ctx->debug_level >= PJ_LOG_DEBUG_MAJOR )
+            PJ_STAT_INC( ctx, grid_misses );
+            if( PJ_LOG_ENABLED( ctx, PJ_LOG_DEBUG_MAJOR ) )
             {
                 pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
                     "pj_apply_gridshift(): failed to find a grid shift table for\n"
@@ -250,6 +712,14 @@ int pj_apply_gridshift_3( projCtx ctx, PJ_GRIDINFO **tables, int grid_count,
         }
     }
 
+    if( batch != NULL )
+        pj_ctx_buffer_put( ctx, batch );
+
+    if( extents != static_extents )
+        pj_dalloc( extents );
+
+    pj_grid_cache_pin( tables, grid_count, -1 );
+
     return 0;
 }
 
@@ -33,6 +33,97 @@
 #include <projects.h>
 #include <string.h>
 #include <math.h>
+#include <errno.h>
+
+/* extent of one grid, precomputed per call so the per point table
+** scan runs over contiguous values instead of chasing CTABLE
+** pointers (same scheme as pj_apply_gridshift_3()) */
+typedef struct {
+    double min_lam, min_phi;
+    double max_lam, max_phi;
+} PJVGridExtent;
+
+static void pj_vgridshift_extent( struct CTABLE *ct, PJVGridExtent *ext )
+
+{
+    ext->min_lam = ct->ll.lam;
+    ext->min_phi = ct->ll.phi;
+    ext->max_lam = ct->ll.lam + (ct->lim.lam-1) * ct->del.lam;
+    ext->max_phi = ct->ll.phi + (ct->lim.phi-1) * ct->del.phi;
+}
+
+#define PJ_VEXTENT_CONTAINS(ext,pt) \
+    ((pt).lam >= (ext).min_lam && (pt).lam <= (ext).max_lam \
+     && (pt).phi >= (ext).min_phi && (pt).phi <= (ext).max_phi)
+
+/************************************************************************/
+/*                       pj_vgridshift_value()                          */
+/*                                                                      */
+/*      Bilinear interpolation of the geoid offset at one location      */
+/*      within the grid.  Returns HUGE_VAL on nodata.                   */
+/************************************************************************/
+
+static double pj_vgridshift_value( struct CTABLE *ct, LP input )
+
+{
+    double grid_x, grid_y, value;
+    int    grid_ix, grid_iy;
+    float  *cvs;
+
+    grid_x = (input.lam - ct->ll.lam) / ct->del.lam;
+    grid_y = (input.phi - ct->ll.phi) / ct->del.phi;
+    grid_ix = (int) floor(grid_x);
+    grid_iy = (int) floor(grid_y);
+    grid_x -= grid_ix;
+    grid_y -= grid_iy;
+
+    /* cvs may hold only a latitude row window of the table (see
+       pj_gridinfo_load_window()); a point outside it reads as a miss
+       so the caller's scan path can widen the window */
+    if( ct->win_rows > 0 )
+    {
+        grid_iy -= ct->win_row0;
+        if( grid_iy < 0 || grid_iy + 1 >= ct->win_rows )
+            return HUGE_VAL;
+    }
+
+    cvs = (float *) ct->cvs;
+    value = cvs[grid_ix + grid_iy * ct->lim.lam]
+        * (1.0-grid_x) * (1.0-grid_y)
+        + cvs[grid_ix + 1 + grid_iy * ct->lim.lam]
+        * (grid_x) * (1.0-grid_y)
+        + cvs[grid_ix + (grid_iy+1) * ct->lim.lam]
+        * (1.0-grid_x) * (grid_y)
+        + cvs[grid_ix + 1 + (grid_iy+1) * ct->lim.lam]
+        * (grid_x) * (grid_y);
+
+    if( value == -88.88880f ) /* nodata? */
+        return HUGE_VAL;
+
+    return value;
+}
+
+/************************************************************************/
+/*                      pj_vgridshift_resident()                        */
+/*                                                                      */
+/*      Is the row band needed to interpolate at this latitude          */
+/*      resident?  True for any fully loaded table; a windowed GTX      */
+/*      payload must additionally cover the point's stencil rows.       */
+/************************************************************************/
+
+static int pj_vgridshift_resident( struct CTABLE *ct, double phi )
+
+{
+    int grid_iy;
+
+    if( ct->cvs == NULL )
+        return 0;
+    if( ct->win_rows == 0 )
+        return 1;
+
+    grid_iy = (int) floor((phi - ct->ll.phi) / ct->del.phi) - ct->win_row0;
+    return grid_iy >= 0 && grid_iy + 1 < ct->win_rows;
+}
 
 /************************************************************************/
 /*                        pj_apply_vgridshift()                         */
@@ -43,7 +134,7 @@
 /*      now.                                                            */
 /************************************************************************/
 
-int pj_apply_vgridshift( PJ *defn, const char *listname,
+int pj_apply_vgridshift( PJ *defn,
                          PJ_GRIDINFO ***gridlist_p, 
                          int *gridlist_count_p,
                          int inverse, 
@@ -54,18 +145,26 @@ int pj_apply_vgridshift( PJ *defn, const char *listname,
     int  i;
     static int debug_count = 0;
     PJ_GRIDINFO **tables;
+    int grid_count;
+    projCtx ctx = pj_get_ctx(defn);
+    PJVGridExtent static_extents[8];
+    PJVGridExtent *extents = static_extents;
+    struct CTABLE *last_ct = NULL;  /* leaf grid used for previous point */
+    PJVGridExtent last_extent;
+    int last_itable = 0;            /* top level table last_ct is under */
+    double phi_min = 0.0, phi_max = 0.0; /* latitude range of the batch, */
+    int have_range = 0;                  /* computed on the first load   */
 
     if( *gridlist_p == NULL )
     {
-        *gridlist_p = 
-            pj_gridlist_from_nadgrids( pj_get_ctx(defn), 
-                                       pj_param(defn->ctx,defn->params,listname).s,
+        *gridlist_p =
+            pj_gridlist_from_nadgrids( ctx, defn->geoidgrids,
                                        gridlist_count_p );
 
         if( *gridlist_p == NULL || *gridlist_count_p == 0 )
             return defn->ctx->last_errno;
     }
-     
+
     if( *gridlist_count_p == 0 )
     {
         pj_ctx_set_errno( defn->ctx, -38);
@@ -73,8 +172,32 @@ int pj_apply_vgridshift( PJ *defn, const char *listname,
     }
 
     tables = *gridlist_p;
+    grid_count = *gridlist_count_p;
     defn->ctx->last_errno = 0;
 
+    /* pin the grids (and subgrids) so the cache budget manager cannot
+       evict their payloads while the point loop reads them unlocked */
+    pj_grid_cache_pin( tables, grid_count, 1 );
+
+/* -------------------------------------------------------------------- */
+/*      Precompute the top level extents once per call.                 */
+/* -------------------------------------------------------------------- */
+    if( grid_count > (int) (sizeof(static_extents)/sizeof(PJVGridExtent)) )
+    {
+        extents = (PJVGridExtent *) pj_malloc(sizeof(PJVGridExtent)*grid_count);
+        if( extents == NULL )
+        {
+            pj_ctx_set_errno( ctx, ENOMEM );
+            pj_grid_cache_pin( tables, grid_count, -1 );
+            return ENOMEM;
+        }
+    }
+
+    for( i = 0; i < grid_count; i++ )
+        pj_vgridshift_extent( tables[i]->ct, extents + i );
+
+    memset( &last_extent, 0, sizeof(last_extent) );
+
     for( i = 0; i < point_count; i++ )
     {
         long io = i * point_offset;
@@ -85,19 +208,33 @@ int pj_apply_vgridshift( PJ *defn, const char *listname,
         input.phi = y[io];
         input.lam = x[io];
 
+/* -------------------------------------------------------------------- */
+/*      Exploit point locality: geoid correction of dense point         */
+/*      clouds nearly always resolves successive points to the same     */
+/*      leaf grid, so retry it before rescanning the table list.        */
+/*      Only valid if no higher priority table covers the point.        */
+/* -------------------------------------------------------------------- */
+        if( last_ct != NULL && PJ_VEXTENT_CONTAINS(last_extent, input) )
+        {
+            for( itable = 0; itable < last_itable; itable++ )
+            {
+                if( PJ_VEXTENT_CONTAINS(extents[itable], input) )
+                    break;
+            }
+
+            if( itable == last_itable )
+                value = pj_vgridshift_value( last_ct, input );
+        }
+
         /* keep trying till we find a table that works */
-        for( itable = 0; itable < *gridlist_count_p; itable++ )
+        if( value == HUGE_VAL )
+          for( itable = 0; itable < grid_count; itable++ )
         {
             PJ_GRIDINFO *gi = tables[itable];
             struct CTABLE *ct = gi->ct;
-            double grid_x, grid_y;
-            int    grid_ix, grid_iy;
-            float  *cvs;
 
             /* skip tables that don't match our point at all.  */
-            if( ct->ll.phi > input.phi || ct->ll.lam > input.lam
-                || ct->ll.phi + (ct->lim.phi-1) * ct->del.phi < input.phi
-                || ct->ll.lam + (ct->lim.lam-1) * ct->del.lam < input.lam )
+            if( !PJ_VEXTENT_CONTAINS(extents[itable], input) )
                 continue;
 
             /* If we have child nodes, check to see if any of them apply. */
@@ -128,45 +265,53 @@ int pj_apply_vgridshift( PJ *defn, const char *listname,
                 ct = child->ct;
             }
 
-            /* load the grid shift info if we don't have it. */
-            if( ct->cvs == NULL && !pj_gridinfo_load( pj_get_ctx(defn), gi ) )
+            /* load the grid shift info if we don't have it; a
+               windowed GTX payload (see pj_gridinfo_load_window())
+               that does not cover this point is widened to the
+               latitude range of the whole batch, so at most one
+               reread per grid is spent per call */
+            if( !pj_vgridshift_resident( ct, input.phi ) )
             {
-                pj_ctx_set_errno( defn->ctx, -38 );
-                return -38;
-            }
+                if( !have_range )
+                {
+                    long j;
 
-            /* Interpolation a location within the grid */
-            grid_x = (input.lam - ct->ll.lam) / ct->del.lam;
-            grid_y = (input.phi - ct->ll.phi) / ct->del.phi;
-            grid_ix = (int) floor(grid_x);
-            grid_iy = (int) floor(grid_y);
-            grid_x -= grid_ix;
-            grid_y -= grid_iy;
-
-            cvs = (float *) ct->cvs;
-            value = cvs[grid_ix + grid_iy * ct->lim.lam] 
-                * (1.0-grid_x) * (1.0-grid_y)
-                + cvs[grid_ix + 1 + grid_iy * ct->lim.lam] 
-                * (grid_x) * (1.0-grid_y)
-                + cvs[grid_ix + (grid_iy+1) * ct->lim.lam] 
-                * (1.0-grid_x) * (grid_y)
-                + cvs[grid_ix + 1 + (grid_iy+1) * ct->lim.lam] 
-                * (grid_x) * (grid_y);
-
-            if( value == -88.88880f ) /* nodata? */
-                value = HUGE_VAL;
-            else
-            {
-                if( inverse )
-                    z[io] -= value;
-                else
-                    z[io] += value;
+                    /* input.phi is finite here (it passed the extent
+                       test), so the range is never empty; HUGE_VAL
+                       and NaN lanes compare false and are skipped */
+                    phi_min = phi_max = input.phi;
+                    for( j = 0; j < point_count; j++ )
+                    {
+                        double v = y[j * point_offset];
+
+                        if( v < phi_min )
+                            phi_min = v;
+                        else if( v > phi_max && v < HUGE_VAL )
+                            phi_max = v;
+                    }
+                    have_range = 1;
+                }
+
+                if( !pj_gridinfo_load_window( ctx, gi, phi_min, phi_max ) )
+                {
+                    pj_ctx_set_errno( defn->ctx, -38 );
+                    if( extents != static_extents )
+                        pj_dalloc( extents );
+                    pj_grid_cache_pin( tables, grid_count, -1 );
+                    return -38;
+                }
             }
-                
+
+            value = pj_vgridshift_value( ct, input );
+
             if( value != HUGE_VAL )
             {
+                last_ct = ct;
+                last_itable = itable;
+                pj_vgridshift_extent( ct, &last_extent );
+
                 if( debug_count++ < 20 )
-                    pj_log( defn->ctx, PJ_LOG_DEBUG_MINOR, 
+                    pj_log( defn->ctx, PJ_LOG_DEBUG_MINOR,
                             "pj_apply_gridshift(): used %s",
                             ct->id );
                 break;
@@ -180,11 +325,11 @@ int pj_apply_vgridshift( PJ *defn, const char *listname,
             pj_log( defn->ctx, PJ_LOG_DEBUG_MAJOR,
                     "pj_apply_vgridshift(): failed to find a grid shift table for\n"
                     "                       location (%.7fdW,%.7fdN)",
-                    x[io] * RAD_TO_DEG, 
+                    x[io] * RAD_TO_DEG,
                     y[io] * RAD_TO_DEG );
 
             gridlist[0] = '\0';
-            for( itable = 0; itable < *gridlist_count_p; itable++ )
+            for( itable = 0; itable < grid_count; itable++ )
             {
                 PJ_GRIDINFO *gi = tables[itable];
                 if( strlen(gridlist) + strlen(gi->gridname) > sizeof(gridlist)-100 )
@@ -200,12 +345,25 @@ int pj_apply_vgridshift( PJ *defn, const char *listname,
             }
             pj_log( defn->ctx, PJ_LOG_DEBUG_MAJOR,
                     "%s", gridlist );
-                
+
+            if( extents != static_extents )
+                pj_dalloc( extents );
+            pj_grid_cache_pin( tables, grid_count, -1 );
             pj_ctx_set_errno( defn->ctx, PJD_ERR_GRID_AREA );
             return PJD_ERR_GRID_AREA;
         }
+
+        if( inverse )
+            z[io] -= value;
+        else
+            z[io] += value;
     }
 
+    if( extents != static_extents )
+        pj_dalloc( extents );
+
+    pj_grid_cache_pin( tables, grid_count, -1 );
+
     return 0;
 }
 
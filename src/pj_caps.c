@@ -0,0 +1,67 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Kernel capability descriptor for initialized projections.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2000, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/************************************************************************/
+/*                          pj_kernel_caps()                            */
+/*                                                                      */
+/*      Describe the kernels an initialized projection provides, so     */
+/*      batch layers and benchmarks can pick a code path without        */
+/*      poking at PJconsts internals.  A projection's capabilities      */
+/*      are a property of the instance, not of the pj_list entry:       */
+/*      setup selects between spherical and ellipsoidal variants and    */
+/*      may specialize for common ellipsoids, and a kernel that         */
+/*      provides batch entries registers them (and optionally an        */
+/*      explicit SIMD width) on the PJ in its ENTRY function.           */
+/************************************************************************/
+
+void pj_kernel_caps( PJ *P, struct PJ_KERNEL_CAPS *caps )
+
+{
+    memset( caps, 0, sizeof(*caps) );
+    caps->batch_width = 1;
+
+    if( P == NULL )
+        return;
+
+    caps->has_fwd = P->fwd != NULL;
+    caps->has_inv = P->inv != NULL;
+    caps->has_fwd_batch = P->fwd_batch != NULL;
+    caps->has_inv_batch = P->inv_batch != NULL;
+    if( (caps->has_fwd_batch || caps->has_inv_batch)
+        && P->batch_width > 1 )
+        caps->batch_width = P->batch_width;
+    caps->has_factors = P->spc != NULL;
+    caps->is_spherical = P->es == 0.;
+    caps->spec_ellps = P->spec_ellps;
+}
@@ -0,0 +1,266 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Save and load fitted Chebyshev/power series approximations
+ *           (Tseries) in a binary surrogate file, so an approximation
+ *           fitted once with mk_cheby() (e.g. via proj -T) can be
+ *           evaluated at runtime by +proj=cheby without refitting.
+ *
+ *           File layout (native byte order, like the ctable grid files
+ *           written by nad2bin):
+ *
+ *             char   magic[8]        "PROJCHB1"
+ *             int    inverse         0: lam/phi -> x/y, 1: x/y -> lam/phi
+ *             int    power           0: Chebyshev basis, 1: power basis
+ *             int    mu, mv          maximum cu/cv row index
+ *             double lam0            central meridian of the fitted
+ *                                    projection (radians, metadata)
+ *             double low.u,low.v     fitted domain
+ *             double upp.u,upp.v
+ *             double a.u,a.v,b.u,b.v Tseries argument shift/scaling
+ *             double resid.u,resid.v residual sums reported by mk_cheby()
+ *             then mu+1 rows of (int m, m doubles) for cu
+ *             then mv+1 rows of (int m, m doubles) for cv
+ *
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+#define CHEBY_MAGIC "PROJCHB1"
+#define CHEBY_MAGIC_LEN 8
+#define CHEBY_MAX_DEGREE 10000  /* sanity bound on row counts when loading */
+
+/************************************************************************/
+/*                           pj_cheby_save()                            */
+/*                                                                      */
+/*      Write a fitted series and its fitting metadata to an open       */
+/*      binary file.  Returns 0 on success, -1 on write failure.        */
+/************************************************************************/
+
+int pj_cheby_save( FILE *fid, const Tseries *T, int inverse, double lam0,
+                   projUV low, projUV upp, projUV resid )
+
+{
+    int i, counts[4];
+    double header[11];
+
+    counts[0] = inverse;
+    counts[1] = T->power;
+    counts[2] = T->mu;
+    counts[3] = T->mv;
+
+    header[0] = lam0;
+    header[1] = low.u;
+    header[2] = low.v;
+    header[3] = upp.u;
+    header[4] = upp.v;
+    header[5] = T->a.u;
+    header[6] = T->a.v;
+    header[7] = T->b.u;
+    header[8] = T->b.v;
+    header[9] = resid.u;
+    header[10] = resid.v;
+
+    if( fwrite( CHEBY_MAGIC, CHEBY_MAGIC_LEN, 1, fid ) != 1
+        || fwrite( counts, sizeof(int), 4, fid ) != 4
+        || fwrite( header, sizeof(double), 11, fid ) != 11 )
+        return -1;
+
+    for( i = 0; i <= T->mu; i++ )
+    {
+        if( fwrite( &(T->cu[i].m), sizeof(int), 1, fid ) != 1 )
+            return -1;
+        if( T->cu[i].m != 0
+            && fwrite( T->cu[i].c, sizeof(double), T->cu[i].m, fid )
+               != (size_t) T->cu[i].m )
+            return -1;
+    }
+
+    for( i = 0; i <= T->mv; i++ )
+    {
+        if( fwrite( &(T->cv[i].m), sizeof(int), 1, fid ) != 1 )
+            return -1;
+        if( T->cv[i].m != 0
+            && fwrite( T->cv[i].c, sizeof(double), T->cv[i].m, fid )
+               != (size_t) T->cv[i].m )
+            return -1;
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                           pj_cheby_free()                            */
+/************************************************************************/
+
+void pj_cheby_free( Tseries *T )
+
+{
+    int i;
+
+    if( T == NULL )
+        return;
+
+    for( i = 0; i <= T->mu; i++ )
+        if( T->cu[i].c != NULL )
+            pj_dalloc( T->cu[i].c );
+    for( i = 0; i <= T->mv; i++ )
+        if( T->cv[i].c != NULL )
+            pj_dalloc( T->cv[i].c );
+    pj_dalloc( T->cu );
+    pj_dalloc( T->cv );
+    pj_dalloc( T );
+}
+
+/************************************************************************/
+/*                          pj_cheby_load_rows()                        */
+/************************************************************************/
+
+static int pj_cheby_load_rows( projCtx ctx, PAFile fid,
+                               struct PW_COEF *rows, int count )
+
+{
+    int i;
+
+    for( i = 0; i < count; i++ )
+    {
+        if( pj_ctx_fread( ctx, &(rows[i].m), sizeof(int), 1, fid ) != 1
+            || rows[i].m < 0 || rows[i].m > CHEBY_MAX_DEGREE )
+            return -1;
+
+        if( rows[i].m == 0 )
+            continue;
+
+        rows[i].c = (double *) pj_malloc( sizeof(double) * rows[i].m );
+        if( rows[i].c == NULL
+            || pj_ctx_fread( ctx, rows[i].c, sizeof(double), rows[i].m, fid )
+               != (size_t) rows[i].m )
+            return -1;
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                           pj_cheby_load()                            */
+/*                                                                      */
+/*      Load a surrogate file written by pj_cheby_save().  The name     */
+/*      is resolved against the usual library search path, like the     */
+/*      datum shift grids.  Returns NULL and sets the context errno    */
+/*      on failure.                                                     */
+/************************************************************************/
+
+Tseries *pj_cheby_load( projCtx ctx, const char *name, int *inverse,
+                        double *lam0, projUV *low, projUV *upp,
+                        projUV *resid )
+
+{
+    PAFile fid;
+    Tseries *T = NULL;
+    char magic[CHEBY_MAGIC_LEN];
+    int i, counts[4];
+    double header[11];
+
+    fid = pj_open_lib( ctx, name, "rb" );
+    if( fid == NULL )
+        return NULL;
+
+    if( pj_ctx_fread( ctx, magic, CHEBY_MAGIC_LEN, 1, fid ) != 1
+        || memcmp( magic, CHEBY_MAGIC, CHEBY_MAGIC_LEN ) != 0
+        || pj_ctx_fread( ctx, counts, sizeof(int), 4, fid ) != 4
+        || pj_ctx_fread( ctx, header, sizeof(double), 11, fid ) != 11
+        || counts[2] < 0 || counts[2] > CHEBY_MAX_DEGREE
+        || counts[3] < 0 || counts[3] > CHEBY_MAX_DEGREE )
+        goto error;
+
+    T = (Tseries *) pj_malloc( sizeof(Tseries) );
+    if( T == NULL )
+        goto error;
+
+    T->power = counts[1];
+    T->mu = counts[2];
+    T->mv = counts[3];
+    T->a.u = header[5];
+    T->a.v = header[6];
+    T->b.u = header[7];
+    T->b.v = header[8];
+
+    T->cu = (struct PW_COEF *)
+        pj_malloc( sizeof(struct PW_COEF) * (T->mu + 1) );
+    T->cv = (struct PW_COEF *)
+        pj_malloc( sizeof(struct PW_COEF) * (T->mv + 1) );
+    if( T->cu == NULL || T->cv == NULL )
+        goto error;
+
+    for( i = 0; i <= T->mu; i++ )
+    {
+        T->cu[i].m = 0;
+        T->cu[i].c = NULL;
+    }
+    for( i = 0; i <= T->mv; i++ )
+    {
+        T->cv[i].m = 0;
+        T->cv[i].c = NULL;
+    }
+
+    if( pj_cheby_load_rows( ctx, fid, T->cu, T->mu + 1 ) != 0
+        || pj_cheby_load_rows( ctx, fid, T->cv, T->mv + 1 ) != 0 )
+        goto error;
+
+    pj_ctx_fclose( ctx, fid );
+
+    *inverse = counts[0];
+    *lam0 = header[0];
+    low->u = header[1];
+    low->v = header[2];
+    upp->u = header[3];
+    upp->v = header[4];
+    resid->u = header[9];
+    resid->v = header[10];
+
+    return T;
+
+  error:
+    pj_ctx_fclose( ctx, fid );
+    if( T != NULL )
+    {
+        if( T->cu != NULL && T->cv != NULL )
+            pj_cheby_free( T );
+        else
+        {
+            if( T->cu != NULL )
+                pj_dalloc( T->cu );
+            if( T->cv != NULL )
+                pj_dalloc( T->cv );
+            pj_dalloc( T );
+        }
+    }
+    pj_ctx_set_errno( ctx, -38 );
+    return NULL;
+}
@@ -29,12 +29,52 @@
 
 #include <projects.h>
 #include <string.h>
+#include <stdlib.h>
+
+#ifdef MUTEX_pthread
+#include <pthread.h>
+#endif
 
 PJ_CVSID("$Id$");
 
 static projCtx_t default_context;
 static volatile int       default_context_initialized = 0;
 
+/************************************************************************/
+/*                      pj_init_default_context()                       */
+/*                                                                      */
+/*      One-time setup of the historic static context.  The caller      */
+/*      must hold the PJ_LOCK_CONTEXT write lock.                       */
+/************************************************************************/
+
+static void pj_init_default_context()
+
+{
+    if( default_context_initialized )
+        return;
+
+    default_context.last_errno = 0;
+    default_context.debug_level = PJ_LOG_NONE;
+    default_context.logger = pj_stderr_logger;
+    default_context.app_data = NULL;
+    default_context.fileapi = pj_get_default_fileapi();
+    default_context.transform_threads = 0;
+    default_context.approx_tol = 0.0;
+    default_context.grid_load_mode = PJ_GRID_LOAD_BLOCK;
+    memset( &default_context.stats, 0, sizeof(default_context.stats) );
+    memset( default_context.buffers, 0, sizeof(default_context.buffers) );
+    default_context.handle_table = NULL;
+
+    if( getenv("PROJ_DEBUG") != NULL )
+    {
+        if( atoi(getenv("PROJ_DEBUG")) > 0 )
+            default_context.debug_level = atoi(getenv("PROJ_DEBUG"));
+        else
+            default_context.debug_level = PJ_LOG_DEBUG_MINOR;
+    }
+    default_context_initialized = 1;
+}
+
 /************************************************************************/
 /*                             pj_get_ctx()                             */
 /************************************************************************/
@@ -59,36 +99,92 @@ void pj_set_ctx( projPJ pj, projCtx ctx )
 
 /************************************************************************/
 /*                         pj_get_default_ctx()                         */
+/*                                                                      */
+/*      With pthreads the default context is thread-local: the first    */
+/*      thread to ask keeps the historic static context (so settings    */
+/*      applied before any other thread starts behave as they always    */
+/*      have) and every other thread lazily receives its own copy of    */
+/*      it.  Steady-state access is then a TLS read with no lock,       */
+/*      and legacy entry points that reach for the default context      */
+/*      on every call no longer serialize the process.                  */
 /************************************************************************/
 
+#ifdef MUTEX_pthread
+
+#include <pthread.h>
+
+static pthread_once_t default_ctx_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  default_ctx_key;
+static volatile int   default_context_claimed = 0;
+
+static void pj_default_ctx_destructor( void *arg )
+
+{
+    if( arg != (void *) &default_context )
+        pj_ctx_free( (projCtx) arg );
+}
+
+static void pj_default_ctx_key_create()
+
+{
+    pthread_key_create( &default_ctx_key, pj_default_ctx_destructor );
+}
+
 projCtx pj_get_default_ctx()
 
 {
-    pj_acquire_lock();
+    projCtx ctx;
 
-    if( !default_context_initialized )
+    pthread_once( &default_ctx_once, pj_default_ctx_key_create );
+
+    ctx = (projCtx) pthread_getspecific( default_ctx_key );
+    if( ctx == NULL )
     {
-        default_context.last_errno = 0;
-        default_context.debug_level = PJ_LOG_NONE;
-        default_context.logger = pj_stderr_logger;
-        default_context.app_data = NULL;
-        default_context.fileapi = pj_get_default_fileapi();
+        /* first call on this thread - the cold path takes the lock */
+        pj_acquire_write_lock( PJ_LOCK_CONTEXT );
+
+        pj_init_default_context();
 
-        if( getenv("PROJ_DEBUG") != NULL )
+        if( !default_context_claimed )
+        {
+            default_context_claimed = 1;
+            ctx = &default_context;
+        }
+        else
         {
-            if( atoi(getenv("PROJ_DEBUG")) > 0 )
-                default_context.debug_level = atoi(getenv("PROJ_DEBUG"));
-            else
-                default_context.debug_level = PJ_LOG_DEBUG_MINOR;
+            /* copy the primary context while it cannot change under us;
+               note pj_ctx_alloc() cannot be used here - it would call
+               back into pj_get_default_ctx() */
+            ctx = (projCtx_t *) malloc(sizeof(projCtx_t));
+            memcpy( ctx, &default_context, sizeof(projCtx_t) );
+            ctx->last_errno = 0;
+            memset( &ctx->stats, 0, sizeof(ctx->stats) );
+            memset( ctx->buffers, 0, sizeof(ctx->buffers) );
+            ctx->handle_table = NULL;
         }
-        default_context_initialized = 1;
+
+        pj_release_write_lock( PJ_LOCK_CONTEXT );
+
+        pthread_setspecific( default_ctx_key, ctx );
     }
 
-    pj_release_lock();
+    return ctx;
+}
+
+#else
+
+projCtx pj_get_default_ctx()
+
+{
+    pj_acquire_write_lock( PJ_LOCK_CONTEXT );
+    pj_init_default_context();
+    pj_release_write_lock( PJ_LOCK_CONTEXT );
 
     return &default_context;
 }
 
+#endif
+
 /************************************************************************/
 /*                            pj_ctx_alloc()                            */
 /************************************************************************/
@@ -99,6 +195,39 @@ projCtx pj_ctx_alloc()
     projCtx ctx = (projCtx_t *) malloc(sizeof(projCtx_t));
     memcpy( ctx, pj_get_default_ctx(), sizeof(projCtx_t) );
     ctx->last_errno = 0;
+    memset( &ctx->stats, 0, sizeof(ctx->stats) );
+    /* the pool is per context - never share slots with the default ctx */
+    memset( ctx->buffers, 0, sizeof(ctx->buffers) );
+    ctx->handle_table = NULL;
+
+    return ctx;
+}
+
+/************************************************************************/
+/*                         pj_ctx_create_light()                        */
+/*                                                                      */
+/*      Build a context purely from compile-time defaults: no lock      */
+/*      is taken and nothing is inherited from the default context,     */
+/*      not even the PROJ_DEBUG environment setting - ephemeral per     */
+/*      request contexts are expected to configure themselves.  This    */
+/*      keeps high churn callers (thousands of contexts per second)     */
+/*      off the context lock entirely; the result is freed with         */
+/*      pj_ctx_free() like any other.                                   */
+/************************************************************************/
+
+projCtx pj_ctx_create_light()
+
+{
+    projCtx ctx = (projCtx_t *) malloc(sizeof(projCtx_t));
+
+    if( ctx == NULL )
+        return NULL;
+
+    memset( ctx, 0, sizeof(projCtx_t) );
+    ctx->debug_level = PJ_LOG_NONE;
+    ctx->logger = pj_stderr_logger;
+    ctx->fileapi = pj_get_default_fileapi();
+    ctx->grid_load_mode = PJ_GRID_LOAD_BLOCK;
 
     return ctx;
 }
@@ -110,9 +239,238 @@ projCtx pj_ctx_alloc()
 void pj_ctx_free( projCtx ctx )
 
 {
+    int i;
+
+    for( i = 0; i < PJ_CTX_BUFFERS; i++ )
+        if( ctx->buffers[i].buf != NULL )
+            pj_dalloc( ctx->buffers[i].buf );
+
+    pj_ctx_handles_free( ctx );
+
     free( ctx );
 }
 
+/************************************************************************/
+/*                         pj_ctx_buffer_get()                          */
+/*                                                                      */
+/*      Check out a scratch buffer of at least the requested size       */
+/*      from the small pool kept on the context, growing a slot on      */
+/*      demand.  Like the rest of the context the pool is not locked    */
+/*      - a context is meant to be confined to one thread - which is    */
+/*      exactly what makes it useful: steady-state transform and grid   */
+/*      traffic stops contending on the shared heap allocator.  When    */
+/*      every slot is checked out the call falls back to a plain        */
+/*      allocation, which pj_ctx_buffer_put() recognizes and frees,     */
+/*      so callers never have to care which case they got.              */
+/************************************************************************/
+
+void *pj_ctx_buffer_get( projCtx ctx, size_t size )
+
+{
+    int i, grow = -1;
+
+    for( i = 0; i < PJ_CTX_BUFFERS; i++ )
+    {
+        if( ctx->buffers[i].in_use )
+            continue;
+        if( ctx->buffers[i].size >= size )
+        {
+            ctx->buffers[i].in_use = 1;
+            return ctx->buffers[i].buf;
+        }
+        grow = i;
+    }
+
+    if( grow >= 0 )
+    {
+        void *buf = pj_malloc( size );
+
+        if( buf == NULL )
+            return NULL;
+        if( ctx->buffers[grow].buf != NULL )
+            pj_dalloc( ctx->buffers[grow].buf );
+        ctx->buffers[grow].buf = buf;
+        ctx->buffers[grow].size = size;
+        ctx->buffers[grow].in_use = 1;
+        return buf;
+    }
+
+    return pj_malloc( size );
+}
+
+/************************************************************************/
+/*                         pj_ctx_buffer_put()                          */
+/*                                                                      */
+/*      Return a buffer obtained from pj_ctx_buffer_get().  The         */
+/*      allocation is kept on the context for reuse; overflow           */
+/*      allocations (not matching any slot) are freed.                  */
+/************************************************************************/
+
+void pj_ctx_buffer_put( projCtx ctx, void *buffer )
+
+{
+    int i;
+
+    if( buffer == NULL )
+        return;
+
+    for( i = 0; i < PJ_CTX_BUFFERS; i++ )
+    {
+        if( ctx->buffers[i].buf == buffer )
+        {
+            ctx->buffers[i].in_use = 0;
+            return;
+        }
+    }
+
+    pj_dalloc( buffer );
+}
+
+/************************************************************************/
+/*      Per thread diagnostics scopes.  Threads sharing PJ objects      */
+/*      (the pj_transform_mt() workers, or an application fanning       */
+/*      pj_transform() calls over its own threads against one ctx)      */
+/*      all read and write the same ctx->last_errno and the global      */
+/*      pj_errno, so every bad point one thread hits invalidates the    */
+/*      error fields every other thread is polling per point.           */
+/*                                                                      */
+/*      A thread that brackets its work with pj_diag_push() and         */
+/*      pj_diag_pop() gets a thread local error slot for the            */
+/*      duration: pj_ctx_set_errno()/pj_ctx_get_errno() (and the hot    */
+/*      loops, through pj_diag_errno_addr()) are redirected to it,      */
+/*      leaving the shared fields untouched.  pj_diag_pop() returns     */
+/*      the last error of the scope - 0 when clean - which is how the   */
+/*      per worker errors merge back at the sync point.  Scopes nest,   */
+/*      a nonzero error propagating to the enclosing scope on pop;      */
+/*      pushes and pops must balance on each thread.                    */
+/************************************************************************/
+
+#define PJ_DIAG_MAX_DEPTH 8
+
+typedef struct {
+    int depth;
+    int err[PJ_DIAG_MAX_DEPTH];
+} pjDiagState;
+
+#ifdef MUTEX_pthread
+
+static pthread_key_t  diag_key;
+static pthread_once_t diag_key_once = PTHREAD_ONCE_INIT;
+
+static void pj_diag_make_key( void )
+
+{
+    pthread_key_create( &diag_key, free );
+}
+
+static pjDiagState *pj_diag_state( int create )
+
+{
+    pjDiagState *state;
+
+    pthread_once( &diag_key_once, pj_diag_make_key );
+    state = (pjDiagState *) pthread_getspecific( diag_key );
+    if( state == NULL && create )
+    {
+        state = (pjDiagState *) calloc( 1, sizeof(pjDiagState) );
+        if( state != NULL )
+            pthread_setspecific( diag_key, state );
+    }
+
+    return state;
+}
+
+#else
+
+/* no thread primitives: one process wide state is per thread enough */
+static pjDiagState diag_state_single;
+
+static pjDiagState *pj_diag_state( int create )
+
+{
+    (void) create;
+    return &diag_state_single;
+}
+
+#endif /* MUTEX_pthread */
+
+static int *pj_diag_slot( void )
+
+{
+    pjDiagState *state = pj_diag_state( 0 );
+    int depth;
+
+    if( state == NULL || state->depth == 0 )
+        return NULL;
+
+    /* scopes past the fixed depth share the deepest slot */
+    depth = state->depth < PJ_DIAG_MAX_DEPTH
+        ? state->depth : PJ_DIAG_MAX_DEPTH;
+    return state->err + depth - 1;
+}
+
+/************************************************************************/
+/*                            pj_diag_push()                            */
+/************************************************************************/
+
+void pj_diag_push()
+
+{
+    pjDiagState *state = pj_diag_state( 1 );
+
+    /* allocation failure degrades to the shared error fields */
+    if( state == NULL )
+        return;
+
+    if( state->depth < PJ_DIAG_MAX_DEPTH )
+        state->err[state->depth] = 0;
+    state->depth++;
+}
+
+/************************************************************************/
+/*                            pj_diag_pop()                             */
+/************************************************************************/
+
+int pj_diag_pop()
+
+{
+    pjDiagState *state = pj_diag_state( 0 );
+    int err;
+
+    if( state == NULL || state->depth == 0 )
+        return 0;
+
+    state->depth--;
+    if( state->depth >= PJ_DIAG_MAX_DEPTH )
+        return state->err[PJ_DIAG_MAX_DEPTH-1];
+
+    err = state->err[state->depth];
+    if( err != 0 && state->depth > 0
+        && state->err[state->depth-1] == 0 )
+        state->err[state->depth-1] = err;
+
+    return err;
+}
+
+/************************************************************************/
+/*                         pj_diag_errno_addr()                         */
+/*                                                                      */
+/*      Address of the error field in effect on this thread: the        */
+/*      diagnostics slot when a scope is active, ctx->last_errno        */
+/*      otherwise.  Per point loops hoist this once per call so their   */
+/*      polling stays a plain load, private to the thread whenever a    */
+/*      scope is up.  Stores through the returned address bypass the    */
+/*      global pj_errno mirror, as the per point loops always have.     */
+/************************************************************************/
+
+int *pj_diag_errno_addr( projCtx ctx )
+
+{
+    int *diag = pj_diag_slot();
+
+    return diag != NULL ? diag : &ctx->last_errno;
+}
+
 /************************************************************************/
 /*                          pj_ctx_get_errno()                          */
 /************************************************************************/
@@ -120,18 +478,32 @@ void pj_ctx_free( projCtx ctx )
 int pj_ctx_get_errno( projCtx ctx )
 
 {
+    int *diag = pj_diag_slot();
+
+    if( diag != NULL )
+        return *diag;
     return ctx->last_errno;
 }
 
 /************************************************************************/
 /*                          pj_ctx_set_errno()                          */
 /*                                                                      */
-/*      Also sets the global errno.                                     */
+/*      Also sets the global errno, unless a diagnostics scope is       */
+/*      active on this thread, in which case only its slot is           */
+/*      written.                                                        */
 /************************************************************************/
 
 void pj_ctx_set_errno( projCtx ctx, int new_errno )
 
 {
+    int *diag = pj_diag_slot();
+
+    if( diag != NULL )
+    {
+        *diag = new_errno;
+        return;
+    }
+
     ctx->last_errno = new_errno;
     if( new_errno != 0 )
         pj_errno = new_errno;
@@ -147,6 +519,210 @@ void pj_ctx_set_debug( projCtx ctx, int new_debug )
     ctx->debug_level = new_debug;
 }
 
+/************************************************************************/
+/*                    pj_ctx_set_transform_threads()                    */
+/*                                                                      */
+/*      Number of threads pj_transform() may spread a large point       */
+/*      array over.  Values below 2 (the default) keep the classic      */
+/*      serial behavior.                                                */
+/************************************************************************/
+
+void pj_ctx_set_transform_threads( projCtx ctx, int num_threads )
+
+{
+    ctx->transform_threads = num_threads;
+}
+
+/************************************************************************/
+/*                    pj_ctx_set_approx_tolerance()                     */
+/*                                                                      */
+/*      Error budget for approximate evaluation, in radians of          */
+/*      latitude (multiply by the semimajor axis for the metric         */
+/*      bound).  When positive, the iterative latitude inversions       */
+/*      (pj_phi2, pj_inv_mlfn) stop once within the budget, and PJ      */
+/*      objects created on this context may substitute truncated        */
+/*      series whose known truncation error fits under it.  The         */
+/*      default of zero keeps full precision everywhere; only work      */
+/*      done through a context that opted in is affected, so            */
+/*      accuracy-critical pipelines on other contexts see no change.    */
+/************************************************************************/
+
+void pj_ctx_set_approx_tolerance( projCtx ctx, double tolerance )
+
+{
+    ctx->approx_tol = tolerance > 0.0 ? tolerance : 0.0;
+}
+
+/************************************************************************/
+/*                    pj_ctx_get_approx_tolerance()                     */
+/************************************************************************/
+
+double pj_ctx_get_approx_tolerance( projCtx ctx )
+
+{
+    return ctx->approx_tol;
+}
+
+/************************************************************************/
+/*                     pj_ctx_set_grid_load_mode()                      */
+/*                                                                      */
+/*      Reaction of grid using transforms on this context to a grid     */
+/*      whose payload is not loaded yet.  PJ_GRID_LOAD_BLOCK (the       */
+/*      default) reads the file inline as always.  PJ_GRID_LOAD_RETRY   */
+/*      starts a background load and fails the call with -50 so the     */
+/*      caller can retry shortly.  PJ_GRID_LOAD_FALLBACK starts a       */
+/*      background load and shifts with whatever grids are already      */
+/*      resident, counting the affected points in                       */
+/*      PJ_STATS.grid_provisional so the caller can redo them once      */
+/*      the load completes.                                             */
+/************************************************************************/
+
+void pj_ctx_set_grid_load_mode( projCtx ctx, int mode )
+
+{
+    if( mode >= PJ_GRID_LOAD_BLOCK && mode <= PJ_GRID_LOAD_FALLBACK )
+        ctx->grid_load_mode = mode;
+}
+
+/************************************************************************/
+/*                     pj_ctx_get_grid_load_mode()                      */
+/************************************************************************/
+
+int pj_ctx_get_grid_load_mode( projCtx ctx )
+
+{
+    return ctx->grid_load_mode;
+}
+
+/************************************************************************/
+/*                          pj_ctx_get_stats()                          */
+/*                                                                      */
+/*      Copy out the hot path instrumentation counters accumulated      */
+/*      on this context.  The counters are maintained unless the        */
+/*      library was built with -DPJ_DISABLE_STATS, in which case they   */
+/*      stay zero.                                                      */
+/************************************************************************/
+
+void pj_ctx_get_stats( projCtx ctx, PJ_STATS *stats )
+
+{
+    memcpy( stats, &ctx->stats, sizeof(PJ_STATS) );
+}
+
+/************************************************************************/
+/*                         pj_ctx_clear_stats()                         */
+/************************************************************************/
+
+void pj_ctx_clear_stats( projCtx ctx )
+
+{
+    memset( &ctx->stats, 0, sizeof(PJ_STATS) );
+}
+
+/************************************************************************/
+/*                         pj_ctx_dump_stats()                          */
+/*                                                                      */
+/*      Report the counters through the context logger.  The dump is    */
+/*      an explicit request, so it is issued at PJ_LOG_NONE and thus    */
+/*      never filtered by the debug level.                              */
+/************************************************************************/
+
+void pj_ctx_dump_stats( projCtx ctx )
+
+{
+    pj_log( ctx, PJ_LOG_NONE,
+            "pj_stats: phi2_iterations=%lu inv_mlfn_iterations=%lu",
+            ctx->stats.phi2_iterations, ctx->stats.inv_mlfn_iterations );
+    pj_log( ctx, PJ_LOG_NONE,
+            "pj_stats: grid_hits=%lu grid_misses=%lu gridlist_locks=%lu "
+            "grid_provisional=%lu",
+            ctx->stats.grid_hits, ctx->stats.grid_misses,
+            ctx->stats.gridlist_locks, ctx->stats.grid_provisional );
+    pj_log( ctx, PJ_LOG_NONE,
+            "pj_stats: initcache_hits=%lu initcache_misses=%lu",
+            ctx->stats.initcache_hits, ctx->stats.initcache_misses );
+    if( ctx->stats.roundtrip_points > 0 || ctx->stats.roundtrip_failures > 0 )
+        pj_log( ctx, PJ_LOG_NONE,
+                "pj_stats: roundtrip_points=%lu roundtrip_failures=%lu "
+                "roundtrip_err_mean=%.3e roundtrip_err_max=%.3e",
+                ctx->stats.roundtrip_points, ctx->stats.roundtrip_failures,
+                ctx->stats.roundtrip_points > 0
+                    ? ctx->stats.roundtrip_err_sum
+                        / (double) ctx->stats.roundtrip_points : 0.0,
+                ctx->stats.roundtrip_err_max );
+}
+
+/************************************************************************/
+/*                         pj_ctx_cache_stats()                         */
+/*                                                                      */
+/*      Report the occupancy of the process wide caches: the init       */
+/*      file and assembled definition caches, the interned ellipsoid    */
+/*      coefficients and the resident grid payloads.  The disk plan     */
+/*      cache and per-plan memos are owned elsewhere and not counted.   */
+/************************************************************************/
+
+void pj_ctx_cache_stats( projCtx ctx, PJ_CACHE_STATS *stats )
+
+{
+    (void) ctx;
+
+    memset( stats, 0, sizeof(PJ_CACHE_STATS) );
+
+    stats->initcache_bytes = pj_initcache_stats( &stats->initcache_entries );
+    stats->defcache_bytes = pj_defcache_stats( &stats->defcache_entries );
+    stats->ellcache_bytes = pj_ellcache_stats( &stats->ellcache_entries );
+    stats->grid_bytes = pj_grid_cache_stats( &stats->grid_entries );
+
+    stats->total_bytes = stats->initcache_bytes + stats->defcache_bytes
+        + stats->ellcache_bytes + stats->grid_bytes;
+}
+
+/************************************************************************/
+/*                         pj_ctx_cache_trim()                          */
+/*                                                                      */
+/*      Shed cache memory until the total fits in target_bytes, for     */
+/*      processes running under an external memory limit.  Grid         */
+/*      payloads go first - they are the bulk of any over-budget        */
+/*      total and reload transparently on next use - then definition    */
+/*      cache entries and finally init file entries, which cost a       */
+/*      disk read to rebuild.  A target of zero clears everything       */
+/*      trimmable.  The interned ellipsoid coefficients are             */
+/*      referenced by live PJs and are never dropped.  Returns the      */
+/*      bytes still held, which may exceed the target while grids       */
+/*      are pinned by in-progress shifts.                               */
+/************************************************************************/
+
+long pj_ctx_cache_trim( projCtx ctx, long target_bytes )
+
+{
+    PJ_CACHE_STATS st;
+    long others;
+
+    if( target_bytes < 0 )
+        target_bytes = 0;
+
+    pj_ctx_cache_stats( ctx, &st );
+    if( st.total_bytes <= target_bytes )
+        return st.total_bytes;
+
+    others = st.total_bytes - st.grid_bytes;
+    st.grid_bytes = pj_grid_cache_trim(
+        ctx, target_bytes > others ? target_bytes - others : 0 );
+
+    others = st.grid_bytes + st.initcache_bytes + st.ellcache_bytes;
+    if( others + st.defcache_bytes > target_bytes )
+        st.defcache_bytes = pj_defcache_trim(
+            target_bytes > others ? target_bytes - others : 0 );
+
+    others = st.grid_bytes + st.defcache_bytes + st.ellcache_bytes;
+    if( others + st.initcache_bytes > target_bytes )
+        st.initcache_bytes = pj_initcache_trim(
+            target_bytes > others ? target_bytes - others : 0 );
+
+    return st.grid_bytes + st.defcache_bytes + st.initcache_bytes
+        + st.ellcache_bytes;
+}
+
 /************************************************************************/
 /*                         pj_ctx_set_logger()                          */
 /************************************************************************/
@@ -57,16 +57,15 @@ int pj_datum_set(projCtx ctx, paralist *pl, PJ *projdef)
     if( (name = pj_param(ctx, pl,"sdatum").s) != NULL )
     {
         paralist *curr;
-        const char *s;
         int i;
 
         /* find the end of the list, so we can add to it */
         for (curr = pl; curr && curr->next ; curr = curr->next) {}
-        
+
         /* find the datum definition */
-        for (i = 0; (s = pj_datums[i].id) && strcmp(name, s) ; ++i) {}
+        i = pj_registry_find(pj_datums, sizeof(struct PJ_DATUMS), name);
 
-        if (!s) { pj_ctx_set_errno(ctx, -9); return 1; }
+        if (i < 0) { pj_ctx_set_errno(ctx, -9); return 1; }
 
         if( pj_datums[i].ellipse_id && strlen(pj_datums[i].ellipse_id) > 0 )
         {
@@ -79,6 +78,9 @@ int pj_datum_set(projCtx ctx, paralist *pl, PJ *projdef)
         
         if( pj_datums[i].defn && strlen(pj_datums[i].defn) > 0 )
             curr = curr->next = pj_mkparam(pj_datums[i].defn);
+
+        if( pl->hash ) /* keep the pj_param() lookup index in step */
+            pj_param_index( pl );
     }
 
 /* -------------------------------------------------------------------- */
@@ -86,8 +88,9 @@ int pj_datum_set(projCtx ctx, paralist *pl, PJ *projdef)
 /* -------------------------------------------------------------------- */
     if( (nadgrids = pj_param(ctx, pl,"snadgrids").s) != NULL )
     {
-        /* We don't actually save the value separately.  It will continue
-           to exist int he param list for use in pj_apply_gridshift.c */
+        /* intern the value so pj_compare_datums() and the gridshift
+           code do not have to walk the parameter list per call */
+        projdef->nadgrids = strdup(nadgrids);
 
         projdef->datum_type = PJD_GRIDSHIFT;
     }
@@ -146,9 +149,12 @@ int pj_datum_set(projCtx ctx, paralist *pl, PJ *projdef)
         else 
             projdef->datum_type = PJD_3PARAM;
 
-        /* Note that pj_init() will later switch datum_type to 
+        /* Note that pj_init() will later switch datum_type to
            PJD_WGS84 if shifts are all zero, and ellipsoid is WGS84 or GRS80 */
     }
 
+    /* precompute the matrix form of a parameterized shift */
+    pj_helmert_setup( projdef );
+
     return 0;
 }
@@ -88,3 +88,32 @@ struct PJ_PRIME_MERIDIANS *pj_get_prime_meridians_ref()
     return pj_prime_meridians;
 }
 
+/* the table offsets above, converted from their DMS strings to radians
+   once on first use, so repeated inits do no string parsing; entry
+   numbers match pj_prime_meridians[] (see pj_prime_meridian_rad()) */
+static volatile int pm_rad_ready = 0;
+static double pm_rad[sizeof(pj_prime_meridians)
+                     / sizeof(pj_prime_meridians[0]) - 1];
+
+double pj_prime_meridian_rad( projCtx ctx, int entry )
+
+{
+    if( !pm_rad_ready )
+    {
+        pj_acquire_lock();
+        if( !pm_rad_ready )
+        {
+            int i;
+
+            for( i = 0; pj_prime_meridians[i].id != NULL; i++ )
+                pm_rad[i] = dmstor_ctx( ctx, pj_prime_meridians[i].defn,
+                                        NULL );
+            __sync_synchronize();
+            pm_rad_ready = 1;
+        }
+        pj_release_lock();
+    }
+
+    return pm_rad[entry];
+}
+
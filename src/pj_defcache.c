@@ -0,0 +1,309 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Definition string cache.  Caches the fully assembled parameter
+ *           list (arguments + init file entries + defaults) for a complete
+ *           definition string so repeated pj_init_plus() calls for the same
+ *           definition skip string splitting and init/defaults file access.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2009, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/* bounded open addressing hash table with least-recently-used
+** eviction, organized like the init file cache */
+
+#define CACHE_ENTRY_MAX  64
+#define CACHE_SLOTS     128	/* twice the cap, power of two */
+
+typedef struct {
+    char *key;
+    paralist *list;
+    size_t list_size;		/* arena block size of list, for block copies */
+    unsigned long last_used;
+} pj_cache_entry;
+
+static pj_cache_entry *cache_tab = NULL;
+static int cache_count = 0;
+static unsigned long cache_clock = 0;
+
+/************************************************************************/
+/*                            pj_cache_hash()                           */
+/************************************************************************/
+
+static unsigned pj_cache_hash( const char *key )
+
+{
+    unsigned h = 2166136261u;
+
+    while( *key != '\0' )
+    {
+        h ^= (unsigned char) *key++;
+        h *= 16777619u;
+    }
+    return h & (CACHE_SLOTS-1);
+}
+
+/************************************************************************/
+/*                            pj_cache_find()                           */
+/************************************************************************/
+
+static pj_cache_entry *pj_cache_find( const char *key )
+
+{
+    unsigned i = pj_cache_hash( key );
+
+    while( cache_tab[i].key != NULL
+           && strcmp( cache_tab[i].key, key ) != 0 )
+        i = (i+1) & (CACHE_SLOTS-1);
+
+    return cache_tab + i;
+}
+
+/************************************************************************/
+/*                           pj_cache_evict()                           */
+/************************************************************************/
+
+static void pj_cache_evict()
+
+{
+    pj_cache_entry *old_tab = cache_tab;
+    pj_cache_entry *lru = NULL;
+    int i;
+
+    for( i = 0; i < CACHE_SLOTS; i++ )
+    {
+        if( old_tab[i].key != NULL
+            && (lru == NULL || old_tab[i].last_used < lru->last_used) )
+            lru = old_tab + i;
+    }
+
+    if( lru == NULL )
+        return;
+
+    pj_dalloc( lru->key );
+    pj_free_paralist( lru->list );
+    lru->key = NULL;
+    lru->list = NULL;
+    cache_count--;
+
+    cache_tab = (pj_cache_entry *)
+        pj_malloc( sizeof(pj_cache_entry) * CACHE_SLOTS );
+    memset( cache_tab, 0, sizeof(pj_cache_entry) * CACHE_SLOTS );
+    for( i = 0; i < CACHE_SLOTS; i++ )
+    {
+        if( old_tab[i].key != NULL )
+            *(pj_cache_find( old_tab[i].key )) = old_tab[i];
+    }
+    pj_dalloc( old_tab );
+}
+
+/************************************************************************/
+/*                           pj_cache_bytes()                           */
+/*                                                                      */
+/*      Heap bytes currently held by the cache.  Must be called         */
+/*      locked.                                                         */
+/************************************************************************/
+
+static long pj_cache_bytes()
+
+{
+    long bytes = 0;
+    int i;
+
+    if( cache_tab == NULL )
+        return 0;
+
+    bytes = (long) sizeof(pj_cache_entry) * CACHE_SLOTS;
+    for( i = 0; i < CACHE_SLOTS; i++ )
+    {
+        if( cache_tab[i].key == NULL )
+            continue;
+        bytes += (long) strlen(cache_tab[i].key) + 1
+            + (long) cache_tab[i].list_size;
+    }
+    return bytes;
+}
+
+/************************************************************************/
+/*                           pj_defcache_stats()                        */
+/************************************************************************/
+
+long pj_defcache_stats( int *entries )
+
+{
+    long bytes;
+
+    pj_acquire_read_lock( PJ_LOCK_DEFCACHE );
+    *entries = cache_count;
+    bytes = pj_cache_bytes();
+    pj_release_read_lock( PJ_LOCK_DEFCACHE );
+
+    return bytes;
+}
+
+/************************************************************************/
+/*                           pj_defcache_trim()                         */
+/*                                                                      */
+/*      Evict least recently used entries until the cache fits in       */
+/*      target_bytes; a target of zero (or less) clears it entirely.    */
+/*      Returns the bytes still held.                                   */
+/************************************************************************/
+
+long pj_defcache_trim( long target_bytes )
+
+{
+    long bytes;
+
+    if( target_bytes <= 0 )
+    {
+        pj_clear_defcache();
+        return 0;
+    }
+
+    pj_acquire_write_lock( PJ_LOCK_DEFCACHE );
+    while( (bytes = pj_cache_bytes()) > target_bytes && cache_count > 0 )
+        pj_cache_evict();
+    pj_release_write_lock( PJ_LOCK_DEFCACHE );
+
+    if( bytes > target_bytes )
+    {
+        /* even the emptied table is over target - drop it too */
+        pj_clear_defcache();
+        return 0;
+    }
+
+    return bytes;
+}
+
+/************************************************************************/
+/*                           pj_clear_defcache()                        */
+/*                                                                      */
+/*      Clear out all memory held in the definition cache.              */
+/************************************************************************/
+
+void pj_clear_defcache()
+{
+    if( cache_tab != NULL )
+    {
+        int i;
+
+        pj_acquire_write_lock( PJ_LOCK_DEFCACHE );
+
+        for( i = 0; i < CACHE_SLOTS; i++ )
+        {
+            if( cache_tab[i].key == NULL )
+                continue;
+
+            pj_dalloc( cache_tab[i].key );
+            pj_free_paralist( cache_tab[i].list );
+        }
+
+        pj_dalloc( cache_tab );
+        cache_tab = NULL;
+        cache_count = 0;
+        cache_clock = 0;
+
+        pj_release_write_lock( PJ_LOCK_DEFCACHE );
+    }
+}
+
+/************************************************************************/
+/*                           pj_search_defcache()                       */
+/*                                                                      */
+/*      Search for a matching definition in the cache, returning a      */
+/*      private copy of its assembled parameter list, or NULL.          */
+/************************************************************************/
+
+paralist *pj_search_defcache( const char *definition )
+
+{
+    paralist *result = NULL;
+
+    pj_acquire_read_lock( PJ_LOCK_DEFCACHE );
+
+    if( cache_tab != NULL )
+    {
+        pj_cache_entry *entry = pj_cache_find( definition );
+
+        if( entry->key != NULL )
+        {
+            entry->last_used = ++cache_clock;
+            result = pj_clone_paralist_block( entry->list,
+                                              entry->list_size );
+        }
+    }
+
+    pj_release_read_lock( PJ_LOCK_DEFCACHE );
+
+    return result;
+}
+
+/************************************************************************/
+/*                           pj_insert_defcache()                       */
+/*                                                                      */
+/*      Insert a paralist definition in the definition cache.           */
+/************************************************************************/
+
+void pj_insert_defcache( const char *definition, const paralist *list )
+
+{
+    pj_cache_entry *entry;
+
+    pj_acquire_write_lock( PJ_LOCK_DEFCACHE );
+
+    if( cache_tab == NULL )
+    {
+        cache_tab = (pj_cache_entry *)
+            pj_malloc( sizeof(pj_cache_entry) * CACHE_SLOTS );
+        memset( cache_tab, 0, sizeof(pj_cache_entry) * CACHE_SLOTS );
+    }
+
+    entry = pj_cache_find( definition );
+    if( entry->key != NULL )
+    {
+        /* lost a race with another inserter - keep the existing entry */
+        pj_release_write_lock( PJ_LOCK_DEFCACHE );
+        return;
+    }
+
+    if( cache_count >= CACHE_ENTRY_MAX )
+    {
+        pj_cache_evict();
+        entry = pj_cache_find( definition );
+    }
+
+    entry->key = (char *) pj_malloc(strlen(definition)+1);
+    strcpy( entry->key, definition );
+    entry->list = pj_clone_paralist( list );
+    entry->list_size = pj_paralist_block_size( list );
+    entry->last_used = ++cache_clock;
+    cache_count++;
+
+    pj_release_write_lock( PJ_LOCK_DEFCACHE );
+}
@@ -25,14 +25,14 @@ pj_ell_set(projCtx ctx, paralist *pl, double *a, double *es) {
 
 		/* check if ellps present and temporarily append its values to pl */
         if ((name = pj_param(ctx,pl, "sellps").s) != NULL) {
-			char *s;
-
 			for (start = pl; start && start->next ; start = start->next) ;
 			curr = start;
-			for (i = 0; (s = pj_ellps[i].id) && strcmp(name, s) ; ++i) ;
-			if (!s) { pj_ctx_set_errno( ctx, -9); return 1; }
+			i = pj_registry_find(pj_ellps, sizeof(struct PJ_ELLPS), name);
+			if (i < 0) { pj_ctx_set_errno( ctx, -9); return 1; }
 			curr = curr->next = pj_mkparam(pj_ellps[i].major);
 			curr = curr->next = pj_mkparam(pj_ellps[i].ell);
+			if (pl->hash) /* keep lookup index in step */
+				pj_param_index(pl);
 		}
 		*a = pj_param(ctx,pl, "da").f;
 		if (pj_param(ctx,pl, "tes").i) /* eccentricity squared */
@@ -92,6 +92,8 @@ bomb:
 			pj_dalloc(start->next->next);
 			pj_dalloc(start->next);
 			start->next = 0;
+			if (pl->hash) /* drop freed entries from the index */
+				pj_param_index(pl);
 		}
 		if (ctx->last_errno)
 			return 1;
@@ -103,3 +105,15 @@ bomb:
         	{ pj_ctx_set_errno( ctx, -13); return 1; }
 	return 0;
 }
+
+/* classify an eccentricity as one of the ellipsoids that projections
+** carry compile-time specialized batch kernels for; exact comparison
+** on purpose - anything else gets the generic runtime-es kernels */
+	int
+pj_spec_ellps(double es) {
+	if (es == PJ_ES_WGS84)
+		return PJ_SPEC_ELLPS_WGS84;
+	if (es == PJ_ES_GRS80)
+		return PJ_SPEC_ELLPS_GRS80;
+	return PJ_SPEC_ELLPS_NONE;
+}
@@ -0,0 +1,225 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Interned per-ellipsoid coefficient arrays.  The meridional
+ *           distance (pj_enfn) and authalic latitude (pj_authset) series
+ *           depend only on the eccentricity squared, yet every PJ setup
+ *           allocated and computed its own copy.  This module hands out
+ *           one shared array per distinct es value; applications holding
+ *           thousands of live PJ objects on the same one or two
+ *           ellipsoids get one allocation instead of thousands.
+ *
+ *           Shared arrays are owned by the table and live for the rest
+ *           of the process, like the grid tables - callers must not
+ *           pj_dalloc() them.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+
+PJ_CVSID("$Id$");
+
+typedef struct {
+    double es;
+    double *en;         /* pj_enfn() coefficients, computed on demand */
+    double *apa;        /* pj_authset() coefficients, computed on demand */
+    double *etm;        /* pj_etmcoefs() coefficients, computed on demand */
+} pj_ell_entry;
+
+static pj_ell_entry *ell_tab = NULL;
+static int ell_count = 0;
+static int ell_alloc = 0;
+
+/************************************************************************/
+/*                           pj_ell_entry_get()                         */
+/*                                                                      */
+/*      Find or append the entry for this es value.  The distinct es    */
+/*      population is the set of ellipsoids the application actually    */
+/*      uses, so a linear scan is fine.  Must be called locked.         */
+/************************************************************************/
+
+static pj_ell_entry *pj_ell_entry_get( double es )
+
+{
+    int i;
+
+    for( i = 0; i < ell_count; i++ )
+    {
+        if( ell_tab[i].es == es )
+            return ell_tab + i;
+    }
+
+    if( ell_count >= ell_alloc )
+    {
+        pj_ell_entry *new_tab;
+        int new_alloc = ell_alloc == 0 ? 8 : ell_alloc * 2;
+
+        new_tab = (pj_ell_entry *)
+            pj_malloc( sizeof(pj_ell_entry) * new_alloc );
+        if( new_tab == NULL )
+            return NULL;
+
+        for( i = 0; i < ell_count; i++ )
+            new_tab[i] = ell_tab[i];
+        if( ell_tab != NULL )
+            pj_dalloc( ell_tab );
+
+        ell_tab = new_tab;
+        ell_alloc = new_alloc;
+    }
+
+    ell_tab[ell_count].es = es;
+    ell_tab[ell_count].en = NULL;
+    ell_tab[ell_count].apa = NULL;
+    ell_tab[ell_count].etm = NULL;
+
+    return ell_tab + ell_count++;
+}
+
+/************************************************************************/
+/*                          pj_ellcache_stats()                         */
+/*                                                                      */
+/*      Occupancy of the interned coefficient table.  The arrays are    */
+/*      referenced directly by live PJs, so this cache has no trim;     */
+/*      it is bounded by the number of distinct ellipsoids used and     */
+/*      a few hundred bytes per entry.                                  */
+/************************************************************************/
+
+long pj_ellcache_stats( int *entries )
+
+{
+    long bytes = 0;
+    int i;
+
+    pj_acquire_lock();
+
+    if( ell_tab != NULL )
+        bytes = (long) sizeof(pj_ell_entry) * ell_alloc;
+    for( i = 0; i < ell_count; i++ )
+    {
+        /* array sizes as allocated by pj_enfn(), pj_authset() and
+           pj_etmcoefs() respectively */
+        if( ell_tab[i].en != NULL )
+            bytes += 9 * (long) sizeof(double);
+        if( ell_tab[i].apa != NULL )
+            bytes += 3 * (long) sizeof(double);
+        if( ell_tab[i].etm != NULL )
+            bytes += 25 * (long) sizeof(double);
+    }
+    *entries = ell_count;
+
+    pj_release_lock();
+
+    return bytes;
+}
+
+/************************************************************************/
+/*                           pj_enfn_shared()                           */
+/*                                                                      */
+/*      pj_enfn() against the interned table: every PJ on the same      */
+/*      ellipsoid references the same coefficient array.  Returns       */
+/*      NULL only on allocation failure.  Do not pj_dalloc() the        */
+/*      result.                                                         */
+/************************************************************************/
+
+double *pj_enfn_shared( double es )
+
+{
+    double *result = NULL;
+    pj_ell_entry *entry;
+
+    pj_acquire_lock();
+
+    entry = pj_ell_entry_get( es );
+    if( entry != NULL )
+    {
+        if( entry->en == NULL )
+            entry->en = pj_enfn( es );
+        result = entry->en;
+    }
+
+    pj_release_lock();
+
+    return result;
+}
+
+/************************************************************************/
+/*                          pj_etmcoefs_shared()                        */
+/*                                                                      */
+/*      pj_etmcoefs() against the interned table: the Poder/Engsager    */
+/*      transverse mercator series (etmerc) depends only on es, so      */
+/*      every UTM zone on the same ellipsoid copies the same set.       */
+/*      Returns NULL only on allocation failure.  Do not pj_dalloc()    */
+/*      the result.                                                     */
+/************************************************************************/
+
+double *pj_etmcoefs_shared( double es )
+
+{
+    double *result = NULL;
+    pj_ell_entry *entry;
+
+    pj_acquire_lock();
+
+    entry = pj_ell_entry_get( es );
+    if( entry != NULL )
+    {
+        if( entry->etm == NULL )
+            entry->etm = pj_etmcoefs( es );
+        result = entry->etm;
+    }
+
+    pj_release_lock();
+
+    return result;
+}
+
+/************************************************************************/
+/*                          pj_authset_shared()                         */
+/*                                                                      */
+/*      pj_authset() against the interned table.  Returns NULL only     */
+/*      on allocation failure.  Do not pj_dalloc() the result.          */
+/************************************************************************/
+
+double *pj_authset_shared( double es )
+
+{
+    double *result = NULL;
+    pj_ell_entry *entry;
+
+    pj_acquire_lock();
+
+    entry = pj_ell_entry_get( es );
+    if( entry != NULL )
+    {
+        if( entry->apa == NULL )
+            entry->apa = pj_authset( es );
+        result = entry->apa;
+    }
+
+    pj_release_lock();
+
+    return result;
+}
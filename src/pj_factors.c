@@ -11,6 +11,9 @@ pj_factors(LP lp, PJ *P, double h, struct FACTORS *fac) {
 	struct DERIVS der;
 	double cosphi, t, n, r;
 
+	if (P->setup_state != PJ_SETUP_READY && pj_setup_finalize(P))
+		return 1;
+
 	/* check for forward and latitude or longitude overange */
 	if ((t = fabs(lp.phi)-HALFPI) > EPS || fabs(lp.lam) > 10.) {
                 pj_ctx_set_errno( P->ctx, -14);
@@ -84,3 +87,186 @@ pj_factors(LP lp, PJ *P, double h, struct FACTORS *fac) {
 	}
 	return 0;
 }
+
+/* Batch variant: the four point derivative stencil of every point in
+** a chunk is gathered into one array and pushed through the
+** projection's fwd_batch kernel, so the perturbed projections run on
+** the vector path instead of four scalar calls per point, and the
+** center point trig (sin/cos phi) is computed once and shared by the
+** scale, areal and radius terms.  Points with full analytic
+** derivatives (IS_ANAL_XL_YL and IS_ANAL_XP_YP from the projection's
+** spc hook) skip the stencil entirely.  Each fac entry is zeroed
+** before use.  Returns the number of failed points; their fac->h and
+** fac->k are left as HUGE_VAL and the ctx errno is not touched.
+** Without a fwd_batch kernel each point takes scalar pj_factors().
+*/
+#define FAC_CHUNK 128
+	long
+pj_factors_batch(PJ *P, long point_count, const double *lam,
+	const double *phi, double h, struct FACTORS *fac) {
+	double alam[FAC_CHUNK], aphi[FAC_CHUNK];
+	double plam[4 * FAC_CHUNK], pphi[4 * FAC_CHUNK];
+	double px[4 * FAC_CHUNK], py[4 * FAC_CHUNK];
+	long map[FAC_CHUNK];
+	long base, nbad = 0;
+	double es = P->es, one_es = P->one_es;
+
+	if (h < EPS)
+		h = DEFAULT_H;
+
+	if (P->setup_state != PJ_SETUP_READY && pj_setup_finalize(P)) {
+		long i;
+
+		for (i = 0; i < point_count; ++i) {
+			memset(fac + i, 0, sizeof(struct FACTORS));
+			fac[i].h = fac[i].k = HUGE_VAL;
+		}
+		return point_count;
+	}
+
+	if (P->fwd_batch == NULL) {
+		long i;
+		LP lp;
+
+		for (i = 0; i < point_count; ++i) {
+			lp.lam = lam[i];
+			lp.phi = phi[i];
+			memset(fac + i, 0, sizeof(struct FACTORS));
+			if (pj_factors(lp, P, h, fac + i)) {
+				fac[i].h = fac[i].k = HUGE_VAL;
+				nbad++;
+			}
+		}
+		return nbad;
+	}
+
+	for (base = 0; base < point_count; base += FAC_CHUNK) {
+		long count = point_count - base;
+		long i, j, m;
+
+		if (count > FAC_CHUNK)
+			count = FAC_CHUNK;
+
+		/* per point preamble, analytic values and stencil gather */
+		m = 0;
+		for (i = 0; i < count; ++i) {
+			double lp_lam = lam[base + i], lp_phi = phi[base + i];
+			struct FACTORS *f = fac + base + i;
+			LP lp;
+
+			memset(f, 0, sizeof(struct FACTORS));
+			if (fabs(lp_phi) - HALFPI > EPS ||
+			    fabs(lp_lam) > 10.) {
+				f->h = f->k = HUGE_VAL;
+				nbad++;
+				alam[i] = aphi[i] = HUGE_VAL;
+				continue;
+			}
+			if (fabs(lp_phi) > (HALFPI - h))
+				lp_phi = lp_phi < 0. ? (-HALFPI + h)
+					: (HALFPI - h);
+			else if (P->geoc)
+				lp_phi = atan(P->rone_es * tan(lp_phi));
+			lp_lam -= P->lam0;
+			if (!P->over)
+				lp_lam = adjlon(lp_lam);
+			alam[i] = lp_lam;
+			aphi[i] = lp_phi;
+			if (P->spc) {
+				lp.lam = lp_lam;
+				lp.phi = lp_phi;
+				P->spc(lp, P, f);
+			}
+			if ((f->code & (IS_ANAL_XL_YL + IS_ANAL_XP_YP)) ==
+			    (IS_ANAL_XL_YL + IS_ANAL_XP_YP))
+				continue;
+			map[m] = i;
+			plam[4 * m] = lp_lam + h;
+			pphi[4 * m] = lp_phi + h;
+			plam[4 * m + 1] = lp_lam + h;
+			pphi[4 * m + 1] = lp_phi - h;
+			plam[4 * m + 2] = lp_lam - h;
+			pphi[4 * m + 2] = lp_phi - h;
+			plam[4 * m + 3] = lp_lam - h;
+			pphi[4 * m + 3] = lp_phi + h;
+			m++;
+		}
+
+		if (m > 0)
+			(*P->fwd_batch)(plam, pphi, px, py, 4 * m, P);
+
+		/* scatter the stencils back into the DERIVS slots */
+		for (j = 0; j < m; ++j) {
+			struct FACTORS *f = fac + base + map[j];
+			double x1 = px[4 * j], y1 = py[4 * j];
+			double x2 = px[4 * j + 1], y2 = py[4 * j + 1];
+			double x3 = px[4 * j + 2], y3 = py[4 * j + 2];
+			double x4 = px[4 * j + 3], y4 = py[4 * j + 3];
+			double den = 4. * h;
+			struct DERIVS der;
+
+			if (x1 == HUGE_VAL || x2 == HUGE_VAL ||
+			    x3 == HUGE_VAL || x4 == HUGE_VAL) {
+				f->h = f->k = HUGE_VAL;
+				nbad++;
+				alam[map[j]] = HUGE_VAL;
+				continue;
+			}
+			der.x_l = (x1 + x2 - x3 - x4) / den;
+			der.y_p = (y1 - y2 - y3 + y4) / den;
+			der.x_p = (-x1 + x2 + x3 - x4) / den;
+			der.y_l = (-y1 - y2 + y3 + y4) / den;
+			if (!(f->code & IS_ANAL_XL_YL)) {
+				f->der.x_l = der.x_l;
+				f->der.y_l = der.y_l;
+			}
+			if (!(f->code & IS_ANAL_XP_YP)) {
+				f->der.x_p = der.x_p;
+				f->der.y_p = der.y_p;
+			}
+		}
+
+		/* combine, sharing one sin/cos pair per point */
+		for (i = 0; i < count; ++i) {
+			struct FACTORS *f = fac + base + i;
+			double cosphi, sinphi, t, n, r;
+
+			if (alam[i] == HUGE_VAL)
+				continue;
+			cosphi = cos(aphi[i]);
+			sinphi = sin(aphi[i]);
+			if (!(f->code & IS_ANAL_HK)) {
+				f->h = hypot(f->der.x_p, f->der.y_p);
+				f->k = hypot(f->der.x_l, f->der.y_l) / cosphi;
+				if (es) {
+					t = 1. - es * sinphi * sinphi;
+					n = sqrt(t);
+					f->h *= t * n / one_es;
+					f->k *= n;
+					r = t * t / one_es;
+				} else
+					r = 1.;
+			} else if (es) {
+				r = 1. - es * sinphi * sinphi;
+				r = r * r / one_es;
+			} else
+				r = 1.;
+			if (!(f->code & IS_ANAL_CONV)) {
+				f->conv = - atan2(f->der.y_l, f->der.x_l);
+				if (f->code & IS_ANAL_XL_YL)
+					f->code |= IS_ANAL_CONV;
+			}
+			f->s = (f->der.y_p * f->der.x_l -
+				f->der.x_p * f->der.y_l) * r / cosphi;
+			f->thetap = aasin_quiet(f->s / (f->h * f->k));
+			t = f->k * f->k + f->h * f->h;
+			f->a = sqrt(t + 2. * f->s);
+			t = (t = t - 2. * f->s) <= 0. ? 0. : sqrt(t);
+			f->b = 0.5 * (f->a - t);
+			f->a = 0.5 * (f->a + t);
+			f->omega = 2. * aasin_quiet((f->a - f->b) /
+				(f->a + f->b));
+		}
+	}
+	return nbad;
+}
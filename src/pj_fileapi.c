@@ -124,6 +124,181 @@ static void pj_stdio_fclose(PAFile file)
     free(pafile);
 }
 
+/************************************************************************/
+/*                        Buffered file API                             */
+/*                                                                      */
+/*      Same interface as the stdio implementation, but reads go        */
+/*      through a large read-ahead buffer so the many small header      */
+/*      and row reads done during grid loading become one big read      */
+/*      per buffer span - a large win when each physical read is a      */
+/*      network round trip.  Seeks are lazy: they only move the         */
+/*      logical position, and no physical i/o happens until the next    */
+/*      read misses the buffer.                                         */
+/************************************************************************/
+
+#define PJ_BUFFERED_IO_SIZE 65536
+
+typedef struct {
+    projCtx ctx;
+    FILE *fp;               /* fp first two members match stdio_pafile */
+    unsigned char *buffer;
+    long    buf_offset;     /* file offset of buffer[0] */
+    size_t  buf_filled;     /* valid bytes in buffer */
+    long    pos;            /* logical read position */
+    long    phys_pos;       /* position the OS file pointer is at */
+} buffered_pafile;
+
+static PAFile pj_buffered_fopen(projCtx ctx, const char *filename,
+                                const char *access)
+{
+    buffered_pafile *pafile;
+    FILE *fp;
+
+    fp = fopen(filename, access);
+    if (fp == NULL)
+        return NULL;
+
+    pafile = (buffered_pafile *) malloc(sizeof(buffered_pafile));
+    pafile->buffer = (unsigned char *) malloc(PJ_BUFFERED_IO_SIZE);
+    if (pafile->buffer == NULL)
+    {
+        free(pafile);
+        fclose(fp);
+        return NULL;
+    }
+    pafile->ctx = ctx;
+    pafile->fp = fp;
+    pafile->buf_offset = 0;
+    pafile->buf_filled = 0;
+    pafile->pos = 0;
+    pafile->phys_pos = 0;
+    return (PAFile) pafile;
+}
+
+static size_t pj_buffered_fread(void *buffer, size_t size, size_t nmemb,
+                                PAFile file)
+{
+    buffered_pafile *pafile = (buffered_pafile *) file;
+    unsigned char *out = (unsigned char *) buffer;
+    size_t want = size * nmemb, got = 0;
+
+    while( got < want )
+    {
+        if( pafile->pos >= pafile->buf_offset
+            && pafile->pos < pafile->buf_offset + (long) pafile->buf_filled )
+        {
+            size_t avail = pafile->buf_offset + pafile->buf_filled
+                - pafile->pos;
+            size_t chunk = want - got < avail ? want - got : avail;
+
+            memcpy( out + got,
+                    pafile->buffer + (pafile->pos - pafile->buf_offset),
+                    chunk );
+            pafile->pos += chunk;
+            got += chunk;
+            continue;
+        }
+
+        if( pafile->phys_pos != pafile->pos )
+        {
+            if( fseek( pafile->fp, pafile->pos, SEEK_SET ) != 0 )
+                break;
+            pafile->phys_pos = pafile->pos;
+        }
+
+        if( want - got >= PJ_BUFFERED_IO_SIZE )
+        {
+            /* large request: read straight into the caller's buffer
+               instead of staging through ours */
+            size_t chunk = fread( out + got, 1, want - got, pafile->fp );
+
+            pafile->phys_pos += chunk;
+            pafile->pos += chunk;
+            got += chunk;
+            break;
+        }
+
+        pafile->buf_offset = pafile->pos;
+        pafile->buf_filled =
+            fread( pafile->buffer, 1, PJ_BUFFERED_IO_SIZE, pafile->fp );
+        pafile->phys_pos += pafile->buf_filled;
+        if( pafile->buf_filled == 0 )
+            break;
+    }
+
+    return size == 0 ? 0 : got / size;
+}
+
+static int pj_buffered_fseek(PAFile file, long offset, int whence)
+{
+    buffered_pafile *pafile = (buffered_pafile *) file;
+
+    if( whence == SEEK_SET )
+        pafile->pos = offset;
+    else if( whence == SEEK_CUR )
+        pafile->pos += offset;
+    else
+    {
+        if( fseek( pafile->fp, offset, whence ) != 0 )
+            return -1;
+        pafile->pos = pafile->phys_pos = ftell( pafile->fp );
+    }
+    return 0;
+}
+
+static long pj_buffered_ftell(PAFile file)
+{
+    return ((buffered_pafile *) file)->pos;
+}
+
+static void pj_buffered_fclose(PAFile file)
+{
+    buffered_pafile *pafile = (buffered_pafile *) file;
+
+    fclose(pafile->fp);
+    free(pafile->buffer);
+    free(pafile);
+}
+
+static projFileAPI buffered_fileapi = {
+    pj_buffered_fopen,
+    pj_buffered_fread,
+    pj_buffered_fseek,
+    pj_buffered_ftell,
+    pj_buffered_fclose
+};
+
+/************************************************************************/
+/*                      pj_get_buffered_fileapi()                       */
+/*                                                                      */
+/*      Read-ahead buffered variant of the default file api, for        */
+/*      use with pj_ctx_set_fileapi().                                  */
+/************************************************************************/
+
+projFileAPI *pj_get_buffered_fileapi()
+{
+    return &buffered_fileapi;
+}
+
+/************************************************************************/
+/*                           pj_ctx_get_fd()                            */
+/*                                                                      */
+/*      Return the underlying file descriptor of an open PAFile, or     */
+/*      -1 when the context does not use the default stdio file api     */
+/*      (in which case there may be no descriptor at all).              */
+/************************************************************************/
+
+int pj_ctx_get_fd( projCtx ctx, PAFile file )
+{
+#if !defined(_WIN32_WCE)
+    /* stdio_pafile and buffered_pafile lay out ctx/fp identically */
+    if( (ctx->fileapi == &default_fileapi
+         || ctx->fileapi == &buffered_fileapi) && file != NULL )
+        return fileno( ((stdio_pafile *) file)->fp );
+#endif
+    return -1;
+}
+
 /************************************************************************/
 /*                            pj_ctx_fopen()                            */
 /*                                                                      */
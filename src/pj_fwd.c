@@ -8,14 +8,27 @@ pj_fwd(LP lp, PJ *P) {
 	XY xy;
 	double t;
 
+	if (P->setup_state != PJ_SETUP_READY && pj_setup_finalize(P)) {
+		xy.x = xy.y = HUGE_VAL;
+		return xy;
+	}
+
 	/* check for forward and latitude or longitude overange */
 	if ((t = fabs(lp.phi)-HALFPI) > EPS || fabs(lp.lam) > 10.) {
 		xy.x = xy.y = HUGE_VAL;
 		pj_ctx_set_errno( P->ctx, -14);
 	} else { /* proceed with projection */
-                P->ctx->last_errno = 0;
-                pj_errno = 0;
-                errno = 0;
+		/* the thread's diagnostics slot when one is active, else the
+		** shared ctx field; the globals are only zeroed alongside the
+		** latter, so diagnostics scopes never touch shared state */
+		int *err_addr = pj_diag_errno_addr(P->ctx);
+
+		if (*err_addr != 0)
+			*err_addr = 0;
+		if (err_addr == &P->ctx->last_errno) {
+			pj_errno = 0;
+			errno = 0;
+		}
 
 		if (fabs(t) <= EPS)
 			lp.phi = lp.phi < 0. ? -HALFPI : HALFPI;
@@ -24,8 +37,8 @@ pj_fwd(LP lp, PJ *P) {
 		lp.lam -= P->lam0;	/* compute del lp.lam */
 		if (!P->over)
 			lp.lam = adjlon(lp.lam); /* adjust del longitude */
-		xy = (*P->fwd)(lp, P); /* project */
-		if ( P->ctx->last_errno )
+		xy = PJ_FWD_SPECULATE(lp, P); /* project */
+		if ( *err_addr )
 			xy.x = xy.y = HUGE_VAL;
 		/* adjust for major axis and easting/northings */
 		else {
@@ -35,3 +48,273 @@ pj_fwd(LP lp, PJ *P) {
 	}
 	return xy;
 }
+
+# define PJ_DOMAIN_CHUNK 16384
+
+	static int /* run the batch kernel over the in-domain points of a
+	** mixed validity array by gathering them into contiguous scratch
+	** chunks; returns 0 when no scratch is available and the caller
+	** must fall back to the scalar loop */
+pj_fwd_batch_compact(PJ *P, long point_count, double *x, double *y) {
+	double *gx, *gy;
+	long done;
+
+	gx = (double *) pj_ctx_buffer_get(P->ctx,
+		sizeof(double) * 2 * PJ_DOMAIN_CHUNK);
+	if (gx == NULL)
+		return 0;
+	gy = gx + PJ_DOMAIN_CHUNK;
+
+	for (done = 0; done < point_count; ) {
+		long chunk = point_count - done;
+		long i, ngood = 0;
+
+		if (chunk > PJ_DOMAIN_CHUNK)
+			chunk = PJ_DOMAIN_CHUNK;
+
+		for (i = 0; i < chunk; ++i) {
+			if (x[done + i] == HUGE_VAL)
+				continue;
+			gx[ngood] = x[done + i];
+			gy[ngood] = y[done + i];
+			++ngood;
+		}
+
+		if (ngood == chunk)
+			(*P->fwd_batch)(x + done, y + done,
+				x + done, y + done, chunk, P);
+		else if (ngood > 0) {
+			(*P->fwd_batch)(gx, gy, gx, gy, ngood, P);
+			for (i = 0, ngood = 0; i < chunk; ++i) {
+				if (x[done + i] == HUGE_VAL)
+					continue;
+				x[done + i] = gx[ngood];
+				y[done + i] = gy[ngood];
+				++ngood;
+			}
+		}
+		done += chunk;
+	}
+
+	pj_ctx_buffer_put(P->ctx, gx);
+	return 1;
+}
+
+	static long /* worker shared by the errno and quiet batch entries,
+	** returns the number of invalid output points */
+pj_fwd_batch_work(PJ *P, long point_count, const double *lam,
+	const double *phi, double *x, double *y) {
+	long i, nbad = 0;
+	double t;
+	int has_bad_points = 0;
+	double ax, bx, by;
+
+	if (P->setup_state != PJ_SETUP_READY && pj_setup_finalize(P)) {
+		for (i = 0; i < point_count; ++i)
+			x[i] = y[i] = HUGE_VAL;
+		return point_count;
+	}
+
+	ax = P->fr_meter * P->a;
+	bx = P->fr_meter * P->x0;
+	by = P->fr_meter * P->y0;
+
+	/* affine-class projections (eqc, the latlong stub): the kernel is
+	** a pure scale and shift, so the range classify, longitude wrap,
+	** kernel and false origin scaling fold into this one pass and the
+	** projection becomes memory bound instead of scaffold bound.  The
+	** arithmetic is kept staged exactly as in the separate passes
+	** below so the results match them bit for bit; the wrap replicates
+	** adjlon_batch_del() and is rarely triggered, so the branch
+	** predicts */
+	if (P->kernel_affine && !P->geoc && P->fwd_domain == NULL &&
+			pj_use_batch_kernels()) {
+		double xs = P->aff_xs, xo = P->aff_xo;
+		double ys = P->aff_ys, yo = P->aff_yo;
+		double lam0 = P->lam0;
+		int over = P->over;
+
+		for (i = 0; i < point_count; ++i) {
+			double lp_lam = lam[i];
+			double lp_phi = phi[i];
+			int bad;
+
+			t = fabs(lp_phi) - HALFPI;
+			bad = (t > EPS) | (fabs(lp_lam) > 10.);
+			lp_phi = fabs(t) <= EPS
+				? (lp_phi < 0. ? -HALFPI : HALFPI)
+				: lp_phi;
+			lp_lam -= lam0; /* compute del lp.lam */
+			/* 3.14159265359 is adjlon()'s widened SPI window */
+			if (!over && !(lp_lam >= -3.14159265359 &&
+					lp_lam <= 3.14159265359))
+				lp_lam -= TWOPI * floor((lp_lam + PI) / TWOPI);
+			x[i] = bad ? HUGE_VAL
+				: ax * (xs * lp_lam + xo) + bx;
+			y[i] = bad ? HUGE_VAL
+				: ax * (ys * lp_phi + yo) + by;
+			nbad += !((x[i] < HUGE_VAL) & (y[i] < HUGE_VAL));
+		}
+		return nbad;
+	}
+
+	/* normalize input angles into the output arrays so the projection
+	** kernel can run on them in place.  The geocentric latitude
+	** conversion is folded into this same pass, with the P->geoc test
+	** hoisted out of the loop so the common geodetic path stays branch
+	** free and the geocentric variant streams the tan/atan pair along
+	** with the rest of the normalization */
+	if (P->geoc) {
+		double rone_es = P->rone_es;
+
+		for (i = 0; i < point_count; ++i) {
+			double lp_lam = lam[i];
+			double lp_phi = phi[i];
+
+			if ((t = fabs(lp_phi)-HALFPI) > EPS ||
+					fabs(lp_lam) > 10.) {
+				x[i] = y[i] = HUGE_VAL;
+				has_bad_points = 1;
+				continue;
+			}
+			if (fabs(t) <= EPS)
+				lp_phi = lp_phi < 0. ? -HALFPI : HALFPI;
+			else
+				lp_phi = atan(rone_es * tan(lp_phi));
+			x[i] = lp_lam - P->lam0; /* compute del lp.lam */
+			y[i] = lp_phi;
+		}
+	} else {
+		/* the overrange classify is phrased as a flag feeding a
+		** pair of blends rather than an early-out branch, so dirty
+		** arrays (9999 sentinels, HUGE_VAL lanes from an upstream
+		** datum stage) cost no mispredictions and the loop stays
+		** vectorizable.  NaN compares false in every test below
+		** and flows through to the kernel untouched, as before */
+		for (i = 0; i < point_count; ++i) {
+			double lp_lam = lam[i];
+			double lp_phi = phi[i];
+			int bad;
+
+			t = fabs(lp_phi) - HALFPI;
+			bad = (t > EPS) | (fabs(lp_lam) > 10.);
+			has_bad_points |= bad;
+			lp_phi = fabs(t) <= EPS
+				? (lp_phi < 0. ? -HALFPI : HALFPI)
+				: lp_phi;
+			x[i] = bad ? HUGE_VAL
+				: lp_lam - P->lam0; /* compute del lp.lam */
+			y[i] = bad ? HUGE_VAL : lp_phi;
+		}
+	}
+
+	if (!P->over)
+		adjlon_batch_del(x, point_count); /* adjust del longitude */
+
+	/* bounds pre-pass: projections with a registered domain predicate
+	** get their off-domain points marked in band here, before any
+	** kernel math is spent on them.  The predicates are phrased so
+	** NaN compares false and flows through untouched, as elsewhere */
+	if (P->fwd_domain != NULL) {
+		for (i = 0; i < point_count; ++i) {
+			LP lp;
+
+			if (x[i] == HUGE_VAL)
+				continue;
+			lp.lam = x[i];
+			lp.phi = y[i];
+			if (!(*P->fwd_domain)(lp, P)) {
+				x[i] = y[i] = HUGE_VAL;
+				has_bad_points = 1;
+			}
+		}
+	}
+
+	if (P->fwd_batch != NULL && !has_bad_points &&
+			pj_use_batch_kernels()) {
+		/* batch kernels are store-free: per-point failures are
+		** flagged with HUGE_VAL and collected below, with the
+		** ctx only published to once per call */
+		(*P->fwd_batch)(x, y, x, y, point_count, P);
+	} else if (P->fwd_batch != NULL && pj_use_batch_kernels() &&
+			pj_fwd_batch_compact(P, point_count, x, y)) {
+		/* mixed validity array: the in-domain points were gathered
+		** into contiguous runs and streamed through the kernel */
+	} else {
+		int *err_addr = pj_diag_errno_addr(P->ctx);
+
+		for (i = 0; i < point_count; ++i) {
+			LP lp;
+			XY xy;
+
+			if (x[i] == HUGE_VAL)
+				continue;
+			lp.lam = x[i];
+			lp.phi = y[i];
+			xy = PJ_FWD_SPECULATE(lp, P); /* project */
+			if (*err_addr) {
+				xy.x = xy.y = HUGE_VAL;
+				has_bad_points = 1;
+				*err_addr = 0;
+			}
+			x[i] = xy.x;
+			y[i] = xy.y;
+		}
+	}
+
+	/* adjust for major axis and easting/northings, counting failed
+	** points; the comparison is phrased so NaN inputs flow through
+	** untouched but still count as invalid.  As in the classify
+	** pass, the validity flag selects between the scaled and the
+	** untouched value instead of branching per point */
+	for (i = 0; i < point_count; ++i) {
+		int good = (x[i] < HUGE_VAL) & (y[i] < HUGE_VAL);
+
+		x[i] = good ? ax * x[i] + bx : x[i];
+		y[i] = good ? ax * y[i] + by : y[i];
+		nbad += !good;
+	}
+
+	return nbad;
+}
+
+	int /* forward projection of a contiguous lam/phi array */
+pj_fwd_batch(PJ *P, long point_count, const double *lam, const double *phi,
+	double *x, double *y) {
+	/* errno bookkeeping is done once per batch, not once per point;
+	** the stores are conditional so parallel batches sharing one ctx
+	** do not keep invalidating each other's cache line */
+	int *err_addr = pj_diag_errno_addr(P->ctx);
+
+	if (*err_addr != 0)
+		*err_addr = 0;
+	if (err_addr == &P->ctx->last_errno) {
+		if (pj_errno != 0)
+			pj_errno = 0;
+		errno = 0;
+	}
+
+	if (pj_fwd_batch_work(P, point_count, lam, phi, x, y)) {
+		pj_ctx_set_errno( P->ctx, -14 );
+		return -14;
+	}
+	return 0;
+}
+
+	long /* quiet forward batch: invalid points are only marked in
+	** band (HUGE_VAL, with NaN passed through) and counted; the ctx
+	** error state is left as found, so concurrent batches never
+	** serialize on it */
+pj_fwd_batch_quiet(PJ *P, long point_count, const double *lam,
+	const double *phi, double *x, double *y) {
+	int *err_addr = pj_diag_errno_addr(P->ctx);
+	int saved_errno = *err_addr;
+	long nbad;
+
+	if (saved_errno != 0)
+		*err_addr = 0;
+	nbad = pj_fwd_batch_work(P, point_count, lam, phi, x, y);
+	if (*err_addr != saved_errno)
+		*err_addr = saved_errno;
+	return nbad;
+}
@@ -33,8 +33,11 @@ LIBPROJ_ID[] = "$Id$";
 struct GAUSS {
 	double C;
 	double K;
+	double lnK;	/* log(K), for the closed form inverse */
 	double e;
 	double ratexp;
+	double apa[4];	/* inverse conformal latitude series */
+	int has_apa;	/* series usable for this eccentricity */
 };
 #define EN ((struct GAUSS *)en)
 #define DEL_TOL 1e-14
@@ -61,6 +64,8 @@ pj_gauss_ini(double e, double phi0, double *chi, double *rc) {
 	EN->K = tan(.5 * *chi + FORTPI) / (
 		pow(tan(.5 * phi0 + FORTPI), EN->C) *
 		srat(EN->e * sphi, EN->ratexp)  );
+	EN->lnK = log(EN->K);
+	EN->has_apa = pj_phi2_pre(es, EN->apa);
 	return ((void *)en);
 }
 	LP
@@ -72,6 +77,25 @@ pj_gauss(projCtx ctx, LP elp, const void *en) {
 		srat(EN->e * sin(elp.phi), EN->ratexp) ) - HALFPI;
 	slp.lam = EN->C * (elp.lam);
 	return(slp);
+}
+/*
+** Closed form inverse: the Gauss mapping is linear in isometric
+** latitude, so it can be undone exactly with a log and an exp, after
+** which the inverse conformal latitude series recovers the geodetic
+** latitude.  One polishing pass of the original fixed point brings
+** the series result down to the iteration's 1e-14 tolerance.  Kept
+** iterative for eccentricities beyond the series' validity.
+*/
+	static double
+inv_gauss_phi(double sphi, const void *en) {
+	double q = (log(tan(.5 * sphi + FORTPI)) - EN->lnK) / EN->C;
+	double chi = HALFPI - 2. * atan(exp(-q));
+	double t = chi + chi;
+	double phi = chi + EN->apa[0] * sin(t) + EN->apa[1] * sin(t+t) +
+		EN->apa[2] * sin(t+t+t) + EN->apa[3] * sin(t+t+t+t);
+
+	return(2. * atan(exp(q) * srat(EN->e * sin(phi), -.5 * EN->e))
+		- HALFPI);
 }
 	LP
 pj_inv_gauss(projCtx ctx, LP slp, const void *en) {
@@ -80,15 +104,43 @@ pj_inv_gauss(projCtx ctx, LP slp, const void *en) {
 	int i;
 
 	elp.lam = slp.lam / EN->C;
+	if (EN->has_apa) {
+		elp.phi = inv_gauss_phi(slp.phi, en);
+		return (elp);
+	}
 	num = pow(tan(.5 * slp.phi + FORTPI)/EN->K, 1./EN->C);
 	for (i = MAX_ITER; i; --i) {
 		elp.phi = 2. * atan(num * srat(EN->e * sin(slp.phi), -.5 * EN->e))
 			- HALFPI;
 		if (fabs(elp.phi - slp.phi) < DEL_TOL) break;
 			slp.phi = elp.phi;
-	}	
+	}
 	/* convergence failed */
 	if (!i)
 		pj_ctx_set_errno( ctx, -17 );
 	return (elp);
 }
+
+	LP /* store-free variant for batch kernels: never touches the ctx,
+	** flagging non-convergence with HUGE_VAL instead */
+pj_inv_gauss_batch(LP slp, const void *en) {
+	LP elp;
+	double num;
+	int i;
+
+	elp.lam = slp.lam / EN->C;
+	if (EN->has_apa) {
+		elp.phi = inv_gauss_phi(slp.phi, en);
+		return (elp);
+	}
+	num = pow(tan(.5 * slp.phi + FORTPI)/EN->K, 1./EN->C);
+	for (i = MAX_ITER; i; --i) {
+		elp.phi = 2. * atan(num * srat(EN->e * sin(slp.phi), -.5 * EN->e))
+			- HALFPI;
+		if (fabs(elp.phi - slp.phi) < DEL_TOL) break;
+			slp.phi = elp.phi;
+	}
+	if (!i)
+		elp.phi = HUGE_VAL;
+	return (elp);
+}
@@ -87,16 +87,68 @@ PJ_GridCatalog *pj_gc_readcatalog( projCtx ctx, const char *catalog_name )
     return catalog;
 }
 
+/************************************************************************/
+/*                         pj_gc_entrycompare()                         */
+/************************************************************************/
+
+static int pj_gc_entrycompare( const void *a_raw, const void *b_raw )
+
+{
+    const PJ_GridCatalogEntry *a = (const PJ_GridCatalogEntry *) a_raw;
+    const PJ_GridCatalogEntry *b = (const PJ_GridCatalogEntry *) b_raw;
+
+    if( a->date < b->date )
+        return -1;
+    if( a->date > b->date )
+        return 1;
+
+    return b->priority - a->priority;
+}
+
 /************************************************************************/
 /*                         pj_gc_sortcatalog()                          */
 /*                                                                      */
 /*      Sort all the entries in ascending date and within a date in     */
-/*      descending priority order.                                      */
+/*      descending priority order, then compile the date index so      */
+/*      lookups can binary search for a bracketing date instead of     */
+/*      scanning the whole catalog.                                     */
 /************************************************************************/
 
 static void pj_gc_sortcatalog( projCtx ctx, PJ_GridCatalog *catalog )
 
 {
+    int i;
+
+    qsort( catalog->entries, catalog->entry_count,
+           sizeof(PJ_GridCatalogEntry), pj_gc_entrycompare );
+
+    catalog->date_count = 0;
+    catalog->dates = (double *)
+        malloc( (catalog->entry_count+1) * sizeof(double) );
+    catalog->date_start = (int *)
+        malloc( (catalog->entry_count+2) * sizeof(int) );
+    if( catalog->dates == NULL || catalog->date_start == NULL )
+    {
+        /* without the index pj_gc_findgrid() just scans linearly */
+        free( catalog->dates );
+        free( catalog->date_start );
+        catalog->dates = NULL;
+        catalog->date_start = NULL;
+        return;
+    }
+
+    for( i = 0; i < catalog->entry_count; i++ )
+    {
+        if( catalog->date_count == 0
+            || catalog->entries[i].date
+               != catalog->dates[catalog->date_count-1] )
+        {
+            catalog->dates[catalog->date_count] = catalog->entries[i].date;
+            catalog->date_start[catalog->date_count] = i;
+            catalog->date_count++;
+        }
+    }
+    catalog->date_start[catalog->date_count] = catalog->entry_count;
 }
 
 /************************************************************************/
@@ -57,6 +57,8 @@ void pj_gc_unloadall( projCtx ctx )
             free( catalog->entries[i].definition );
         }
         free( catalog->entries );
+        free( catalog->dates );
+        free( catalog->date_start );
         free( catalog );
     }
 }
@@ -105,8 +107,10 @@ int pj_gc_apply_gridshift( PJ *defn, int inverse,
 
 {
     int i;
+    int dates_changed = 1;
+    double mix_ratio = 1.0;
 
-    if( defn->catalog == NULL ) 
+    if( defn->catalog == NULL )
     {
         defn->catalog = pj_gc_findcatalog( defn->ctx, defn->catalog_name );
         if( defn->catalog == NULL )
@@ -115,11 +119,160 @@ int pj_gc_apply_gridshift( PJ *defn, int inverse,
 
     defn->ctx->last_errno = 0;
 
+/* -------------------------------------------------------------------- */
+/*      Fast path: when every point falls in the regions of one         */
+/*      before/after grid pair, resolve that pair and the date mix      */
+/*      once, run both interpolations through the batched nad_cvt       */
+/*      path (which reuses stencil corners across points), and blend    */
+/*      in one fused pass.  Batches spanning a region boundary, and     */
+/*      debug runs that want the per point diagnostics, take the        */
+/*      scalar loop below.                                              */
+/* -------------------------------------------------------------------- */
+    if( point_count > 1
+        && defn->ctx->debug_level < PJ_LOG_DEBUG_MAJOR )
+    {
+        LP input;
+        PJ_GRIDINFO *gi_after, *gi_before = NULL;
+        int in_regions;
+
+        input.lam = x[0];
+        input.phi = y[0];
+
+        if( defn->last_after_grid == NULL
+            || input.lam < defn->last_after_region.ll_long
+            || input.lam > defn->last_after_region.ur_long
+            || input.phi < defn->last_after_region.ll_lat
+            || input.phi > defn->last_after_region.ur_lat )
+            defn->last_after_grid =
+                pj_gc_findgrid( defn->ctx, defn->catalog,
+                                1, input, defn->datum_date,
+                                &(defn->last_after_region),
+                                &(defn->last_after_date));
+        gi_after = defn->last_after_grid;
+
+        if( defn->datum_date != 0.0 && gi_after != NULL )
+        {
+            if( defn->last_before_grid == NULL
+                || input.lam < defn->last_before_region.ll_long
+                || input.lam > defn->last_before_region.ur_long
+                || input.phi < defn->last_before_region.ll_lat
+                || input.phi > defn->last_before_region.ur_lat )
+                defn->last_before_grid =
+                    pj_gc_findgrid( defn->ctx, defn->catalog,
+                                    0, input, defn->datum_date,
+                                    &(defn->last_before_region),
+                                    &(defn->last_before_date));
+            gi_before = defn->last_before_grid;
+        }
+
+        in_regions = gi_after != NULL
+            && (defn->datum_date == 0.0 || gi_before != NULL);
+        for( i = 1; in_regions && i < point_count; i++ )
+        {
+            long io = i * point_offset;
+
+            if( x[io] < defn->last_after_region.ll_long
+                || x[io] > defn->last_after_region.ur_long
+                || y[io] < defn->last_after_region.ll_lat
+                || y[io] > defn->last_after_region.ur_lat )
+                in_regions = 0;
+            else if( gi_before != NULL
+                && (x[io] < defn->last_before_region.ll_long
+                    || x[io] > defn->last_before_region.ur_long
+                    || y[io] < defn->last_before_region.ll_lat
+                    || y[io] > defn->last_before_region.ur_lat) )
+                in_regions = 0;
+        }
+
+        if( in_regions )
+        {
+            double *buf = (double *) pj_ctx_buffer_get(
+                defn->ctx, sizeof(double) * 4 * point_count );
+
+            if( gi_after->ct->cvs == NULL
+                && !pj_gridinfo_load( defn->ctx, gi_after ) )
+            {
+                if( buf != NULL )
+                    pj_ctx_buffer_put( defn->ctx, buf );
+                pj_ctx_set_errno( defn->ctx, -38 );
+                return -38;
+            }
+            if( gi_before != NULL && gi_before->ct->cvs == NULL
+                && !pj_gridinfo_load( defn->ctx, gi_before ) )
+            {
+                if( buf != NULL )
+                    pj_ctx_buffer_put( defn->ctx, buf );
+                pj_ctx_set_errno( defn->ctx, -38 );
+                return -38;
+            }
+
+            if( buf != NULL )
+            {
+                double *la = buf, *pa = buf + point_count;
+                double *lb = buf + 2*point_count, *pb = buf + 3*point_count;
+
+                for( i = 0; i < point_count; i++ )
+                {
+                    la[i] = x[i*point_offset];
+                    pa[i] = y[i*point_offset];
+                }
+                nad_cvt_batch( inverse, gi_after->ct, point_count, la, pa );
+
+                if( gi_before != NULL )
+                {
+                    for( i = 0; i < point_count; i++ )
+                    {
+                        lb[i] = x[i*point_offset];
+                        pb[i] = y[i*point_offset];
+                    }
+                    nad_cvt_batch( inverse, gi_before->ct,
+                                   point_count, lb, pb );
+
+                    if( defn->last_after_date == defn->last_before_date )
+                        mix_ratio = 1.0;
+                    else
+                        mix_ratio =
+                            (defn->datum_date - defn->last_before_date)
+                            / (defn->last_after_date
+                               - defn->last_before_date);
+
+                    for( i = 0; i < point_count; i++ )
+                    {
+                        long io = i * point_offset;
+
+                        /* a failed interpolation leaves the point as
+                           it came in, matching the scalar loop */
+                        if( la[i] == HUGE_VAL || lb[i] == HUGE_VAL )
+                            continue;
+                        y[io] = mix_ratio * pa[i]
+                            + (1.0-mix_ratio) * pb[i];
+                        x[io] = mix_ratio * la[i]
+                            + (1.0-mix_ratio) * lb[i];
+                    }
+                }
+                else
+                {
+                    for( i = 0; i < point_count; i++ )
+                    {
+                        long io = i * point_offset;
+
+                        if( la[i] == HUGE_VAL )
+                            continue;
+                        y[io] = pa[i];
+                        x[io] = la[i];
+                    }
+                }
+
+                pj_ctx_buffer_put( defn->ctx, buf );
+                return 0;
+            }
+        }
+    }
+
     for( i = 0; i < point_count; i++ )
     {
         long io = i * point_offset;
         LP   input, output_after, output_before;
-        double mix_ratio;
         PJ_GRIDINFO *gi;
 
         input.phi = y[io];
@@ -130,14 +283,20 @@ int pj_gc_apply_gridshift( PJ *defn, int inverse,
             || input.lam < defn->last_after_region.ll_long
             || input.lam > defn->last_after_region.ur_long
             || input.phi < defn->last_after_region.ll_lat
-            || input.phi > defn->last_after_region.ll_lat ) {
-            defn->last_after_grid = 
-                pj_gc_findgrid( defn->ctx, defn->catalog, 
-                                1, input, defn->datum_date, 
-                                &(defn->last_after_region), 
+            || input.phi > defn->last_after_region.ur_lat ) {
+            defn->last_after_grid =
+                pj_gc_findgrid( defn->ctx, defn->catalog,
+                                1, input, defn->datum_date,
+                                &(defn->last_after_region),
                                 &(defn->last_after_date));
+            dates_changed = 1;
         }
         gi = defn->last_after_grid;
+        if( gi == NULL )
+        {
+            pj_ctx_set_errno( defn->ctx, -38 );
+            return -38;
+        }
         assert( gi->child == NULL );
 
         /* load the grid shift info if we don't have it. */
@@ -173,15 +332,21 @@ int pj_gc_apply_gridshift( PJ *defn, int inverse,
             || input.lam < defn->last_before_region.ll_long
             || input.lam > defn->last_before_region.ur_long
             || input.phi < defn->last_before_region.ll_lat
-            || input.phi > defn->last_before_region.ll_lat ) {
-            defn->last_before_grid = 
-                pj_gc_findgrid( defn->ctx, defn->catalog, 
-                                0, input, defn->datum_date, 
-                                &(defn->last_before_region), 
+            || input.phi > defn->last_before_region.ur_lat ) {
+            defn->last_before_grid =
+                pj_gc_findgrid( defn->ctx, defn->catalog,
+                                0, input, defn->datum_date,
+                                &(defn->last_before_region),
                                 &(defn->last_before_date));
+            dates_changed = 1;
         }
 
         gi = defn->last_before_grid;
+        if( gi == NULL )
+        {
+            pj_ctx_set_errno( defn->ctx, -38 );
+            return -38;
+        }
         assert( gi->child == NULL );
 
         /* load the grid shift info if we don't have it. */
@@ -205,10 +370,20 @@ int pj_gc_apply_gridshift( PJ *defn, int inverse,
             continue;
         }
 
-        mix_ratio = (defn->datum_date - defn->last_before_date) 
-            / (defn->last_after_date - defn->last_before_date);
+        /* the bracketing dates only move when one of the cached grids
+           does, so the interval resolution is hoisted out of the
+           per-point work */
+        if( dates_changed )
+        {
+            if( defn->last_after_date == defn->last_before_date )
+                mix_ratio = 1.0;
+            else
+                mix_ratio = (defn->datum_date - defn->last_before_date)
+                    / (defn->last_after_date - defn->last_before_date);
+            dates_changed = 0;
+        }
 
-        y[io] = mix_ratio * output_after.phi 
+        y[io] = mix_ratio * output_after.phi
             + (1.0-mix_ratio) * output_before.phi;
         x[io] = mix_ratio * output_after.lam 
             + (1.0-mix_ratio) * output_before.lam;
@@ -217,39 +392,101 @@ int pj_gc_apply_gridshift( PJ *defn, int inverse,
     return 0;
 }
 
+/************************************************************************/
+/*                          pj_gc_entrymatch()                          */
+/************************************************************************/
+
+static int pj_gc_entrymatch( PJ_GridCatalogEntry *entry, LP location )
+
+{
+    if( location.lam < entry->region.ll_long
+        || location.lam > entry->region.ur_long
+        || location.phi < entry->region.ll_lat
+        || location.phi > entry->region.ur_lat )
+        return 0;
+
+    if( entry->available == -1 )
+        return 0;
+
+    return 1;
+}
+
 /************************************************************************/
 /*                           pj_c_findgrid()                            */
+/*                                                                      */
+/*      Find the best (highest priority) entry covering the location    */
+/*      at the nearest date at-or-after (after=1) or at-or-before       */
+/*      (after=0) the requested date.                                   */
 /************************************************************************/
 
 PJ_GRIDINFO *pj_gc_findgrid( projCtx ctx, PJ_GridCatalog *catalog, int after,
                              LP location, double date,
                              PJ_Region *optimal_region,
-                             double *grid_date ) 
+                             double *grid_date )
 {
     int iEntry;
     PJ_GridCatalogEntry *entry = NULL;
 
-    for( iEntry = 0; iEntry < catalog->entry_count; iEntry++ ) 
+    if( catalog->dates != NULL )
     {
-        entry = catalog->entries + iEntry;
+        /* binary search the compiled date index for the first date
+           at-or-after the request, then walk the date blocks outward
+           in the bracketing direction.  Within a block the entries are
+           already in descending priority order. */
+        int lo = 0, hi = catalog->date_count, di;
 
-        if( (after && entry->date < date) 
-            || (!after && entry->date > date) )
-            continue;
+        while( lo < hi )
+        {
+            int mid = (lo + hi) / 2;
+            if( catalog->dates[mid] < date )
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
 
-        if( location.lam < entry->region.ll_long
-            || location.lam > entry->region.ur_long
-            || location.phi < entry->region.ll_lat
-            || location.phi > entry->region.ur_lat )
-            continue;
+        if( !after && (lo == catalog->date_count
+                       || catalog->dates[lo] != date) )
+            lo--;
 
-        if( entry->available == -1 )
-            continue;
+        for( di = lo;
+             entry == NULL
+                 && (after ? di < catalog->date_count : di >= 0);
+             di += after ? 1 : -1 )
+        {
+            for( iEntry = catalog->date_start[di];
+                 iEntry < catalog->date_start[di+1]; iEntry++ )
+            {
+                if( pj_gc_entrymatch( catalog->entries + iEntry, location ) )
+                {
+                    entry = catalog->entries + iEntry;
+                    break;
+                }
+            }
+        }
+    }
+    else
+    {
+        /* no index - scan the sorted entries directly, downward for a
+           "before" request so we still pick the nearest date */
+        int step = after ? 1 : -1;
+
+        for( iEntry = after ? 0 : catalog->entry_count-1;
+             iEntry >= 0 && iEntry < catalog->entry_count;
+             iEntry += step )
+        {
+            if( (after && catalog->entries[iEntry].date < date)
+                || (!after && catalog->entries[iEntry].date > date) )
+                continue;
 
-        break;
+            if( pj_gc_entrymatch( catalog->entries + iEntry, location ) )
+            {
+                entry = catalog->entries + iEntry;
+                break;
+            }
+        }
     }
 
-    if( iEntry == catalog->entry_count )
+    if( entry == NULL )
     {
         if( grid_date )
             *grid_date = 0.0;
@@ -262,9 +499,7 @@ PJ_GRIDINFO *pj_gc_findgrid( projCtx ctx, PJ_GridCatalog *catalog, int after,
         *grid_date = entry->date;
 
     if( optimal_region )
-    {
-        
-    }
+        *optimal_region = entry->region;
 
     if( entry->gridinfo == NULL )
     {
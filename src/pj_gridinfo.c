@@ -45,6 +45,15 @@
 # include <assert.h>
 #endif /* _WIN32_WCE */
 
+#if !defined(_WIN32) && !defined(_WIN32_WCE)
+#  define HAVE_GRID_MMAP
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <sys/file.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
 /************************************************************************/
 /*                             swap_words()                             */
 /*                                                                      */
@@ -76,6 +85,309 @@ static void swap_words( unsigned char *data, int word_size, int word_count )
     }
 }
 
+/************************************************************************/
+/*                          pj_gridinfo_map()                           */
+/*                                                                      */
+/*      Try to establish ct->cvs as a read-only mapping of the grid     */
+/*      data directly from the file, so that large grids are shared    */
+/*      through the page cache across processes instead of copied      */
+/*      into every heap.  Only applies to formats whose on-disk data   */
+/*      layout already matches the in-memory layout for this host.     */
+/*      Returns 0 (without setting an error) when mapping is not       */
+/*      possible; the caller then uses the normal read path.           */
+/************************************************************************/
+
+static int pj_gridinfo_map( projCtx ctx, PJ_GRIDINFO *gi, PAFile fid,
+                            long data_offset, size_t data_size )
+
+{
+#ifdef HAVE_GRID_MMAP
+    int         fd;
+    struct stat sb;
+    void        *base;
+
+    if( getenv( "PROJ_GRID_NO_MMAP" ) != NULL )
+        return 0;
+
+    fd = pj_ctx_get_fd( ctx, fid );
+    if( fd < 0 )
+        return 0;
+
+    if( fstat( fd, &sb ) != 0
+        || (size_t) sb.st_size < (size_t) data_offset + data_size )
+        return 0;
+
+    base = mmap( NULL, (size_t) data_offset + data_size, PROT_READ,
+                 MAP_SHARED, fd, 0 );
+    if( base == MAP_FAILED )
+        return 0;
+
+    gi->map_base = base;
+    gi->map_size = (size_t) data_offset + data_size;
+    gi->ct->cvs = (FLP *) ((unsigned char *) base + data_offset);
+
+    pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+            "using mmap for grid %s", gi->ct->id );
+
+    return 1;
+#else
+    (void) ctx; (void) gi; (void) fid; (void) data_offset; (void) data_size;
+    return 0;
+#endif
+}
+
+/************************************************************************/
+/*                       Shared memory grid arena                       */
+/*                                                                      */
+/*      Fork heavy deployments run tens of workers per machine and      */
+/*      each keeps its own heap copy of every converted grid payload    */
+/*      (the mmap path only helps formats whose disk layout matches     */
+/*      memory).  When PJ_GRID_SHM names a POSIX shared memory          */
+/*      segment, the first process to load a grid copies the shift      */
+/*      values into the segment and later loaders - in any process -    */
+/*      find them there by grid name, file offset and dimensions,       */
+/*      skipping both the file conversion and the per process copy.     */
+/*      The segment is created on first use (PJ_GRID_SHM_MAX bytes,     */
+/*      default 64MB), cross process access is serialized with          */
+/*      flock() on the segment, and entries are never evicted.          */
+/************************************************************************/
+
+#ifdef HAVE_GRID_MMAP
+
+#define PJ_SHM_MAGIC        "PJGRDSHM"
+#define PJ_SHM_MAX_ENTRIES  256
+#define PJ_SHM_DEFAULT_SIZE (64L * 1024 * 1024)
+
+typedef struct {
+    char magic[8];
+    long arena_size;
+    long used;
+    int  entry_count;
+} PJshmHeader;
+
+typedef struct {
+    char gridname[120];
+    int  grid_offset;
+    int  lim_lam;
+    int  lim_phi;
+    int  ready;
+    long data_offset;        /* from the arena base, 8 byte aligned */
+} PJshmEntry;
+
+static void *shm_arena = NULL;
+static int   shm_arena_fd = -1;
+static int   shm_arena_checked = 0;
+
+static void *pj_gridinfo_shm_arena( projCtx ctx )
+
+{
+    const char  *name;
+    long         size = PJ_SHM_DEFAULT_SIZE;
+    struct stat  sb;
+    PJshmHeader *hdr;
+    int          fresh;
+
+    if( shm_arena_checked )
+        return shm_arena;
+    shm_arena_checked = 1;
+
+    name = getenv( "PJ_GRID_SHM" );
+    if( name == NULL )
+        return NULL;
+
+    shm_arena_fd = shm_open( name, O_RDWR | O_CREAT, 0600 );
+    if( shm_arena_fd < 0 )
+        return NULL;
+
+    if( flock( shm_arena_fd, LOCK_EX ) != 0
+        || fstat( shm_arena_fd, &sb ) != 0 )
+    {
+        close( shm_arena_fd );
+        shm_arena_fd = -1;
+        return NULL;
+    }
+
+    fresh = sb.st_size == 0;
+    if( fresh )
+    {
+        if( getenv( "PJ_GRID_SHM_MAX" ) != NULL
+            && atol( getenv( "PJ_GRID_SHM_MAX" ) ) > 0 )
+            size = atol( getenv( "PJ_GRID_SHM_MAX" ) );
+        if( ftruncate( shm_arena_fd, size ) != 0 )
+        {
+            flock( shm_arena_fd, LOCK_UN );
+            close( shm_arena_fd );
+            shm_arena_fd = -1;
+            return NULL;
+        }
+    }
+    else
+        size = (long) sb.st_size;
+
+    shm_arena = mmap( NULL, (size_t) size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, shm_arena_fd, 0 );
+    if( shm_arena == MAP_FAILED )
+    {
+        shm_arena = NULL;
+        flock( shm_arena_fd, LOCK_UN );
+        close( shm_arena_fd );
+        shm_arena_fd = -1;
+        return NULL;
+    }
+
+    hdr = (PJshmHeader *) shm_arena;
+    if( fresh )
+    {
+        memset( shm_arena, 0,
+                sizeof(PJshmHeader) + PJ_SHM_MAX_ENTRIES * sizeof(PJshmEntry) );
+        hdr->arena_size = size;
+        hdr->used = (long) sizeof(PJshmHeader)
+            + PJ_SHM_MAX_ENTRIES * sizeof(PJshmEntry);
+        hdr->used = (hdr->used + 7) & ~7L;
+        memcpy( hdr->magic, PJ_SHM_MAGIC, 8 );
+    }
+    else if( memcmp( hdr->magic, PJ_SHM_MAGIC, 8 ) != 0 )
+    {
+        pj_log( ctx, PJ_LOG_ERROR,
+                "PJ_GRID_SHM segment %s is not a grid arena - ignored",
+                name );
+        munmap( shm_arena, (size_t) size );
+        shm_arena = NULL;
+        flock( shm_arena_fd, LOCK_UN );
+        close( shm_arena_fd );
+        shm_arena_fd = -1;
+        return NULL;
+    }
+
+    flock( shm_arena_fd, LOCK_UN );
+    return shm_arena;
+}
+
+static PJshmEntry *pj_gridinfo_shm_find( PJ_GRIDINFO *gi )
+
+{
+    PJshmHeader *hdr = (PJshmHeader *) shm_arena;
+    PJshmEntry  *entries = (PJshmEntry *) (hdr + 1);
+    int          i;
+
+    for( i = 0; i < hdr->entry_count; i++ )
+    {
+        PJshmEntry *entry = entries + i;
+
+        if( entry->ready
+            && strcmp( entry->gridname, gi->gridname ) == 0
+            && entry->grid_offset == gi->grid_offset
+            && entry->lim_lam == gi->ct->lim.lam
+            && entry->lim_phi == gi->ct->lim.phi )
+            return entry;
+    }
+    return NULL;
+}
+
+#endif /* def HAVE_GRID_MMAP */
+
+/************************************************************************/
+/*                       pj_gridinfo_shm_lookup()                       */
+/*                                                                      */
+/*      Return the shared copy of this grid's shift values if some      */
+/*      process has already published one, else NULL.                   */
+/************************************************************************/
+
+static FLP *pj_gridinfo_shm_lookup( projCtx ctx, PJ_GRIDINFO *gi )
+
+{
+#ifdef HAVE_GRID_MMAP
+    PJshmEntry *entry;
+    FLP        *data = NULL;
+
+    if( pj_gridinfo_shm_arena( ctx ) == NULL )
+        return NULL;
+
+    if( flock( shm_arena_fd, LOCK_SH ) != 0 )
+        return NULL;
+
+    entry = pj_gridinfo_shm_find( gi );
+    if( entry != NULL )
+        data = (FLP *) ((char *) shm_arena + entry->data_offset);
+    flock( shm_arena_fd, LOCK_UN );
+
+    if( data != NULL )
+        pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+                "grid %s attached from shared arena", gi->ct->id );
+    return data;
+#else
+    return NULL;
+#endif
+}
+
+/************************************************************************/
+/*                      pj_gridinfo_shm_publish()                       */
+/*                                                                      */
+/*      Copy a freshly loaded heap payload into the arena so other      */
+/*      processes can attach it; returns the shared copy, or NULL       */
+/*      when the arena is disabled or full.  If another process         */
+/*      published the same grid since our lookup, its copy is used.     */
+/************************************************************************/
+
+static FLP *pj_gridinfo_shm_publish( projCtx ctx, PJ_GRIDINFO *gi )
+
+{
+#ifdef HAVE_GRID_MMAP
+    PJshmHeader *hdr;
+    PJshmEntry  *entry;
+    FLP         *data = NULL;
+
+    if( pj_gridinfo_shm_arena( ctx ) == NULL )
+        return NULL;
+
+    if( strlen( gi->gridname )
+        >= sizeof(((PJshmEntry *) NULL)->gridname) )
+        return NULL;
+
+    if( flock( shm_arena_fd, LOCK_EX ) != 0 )
+        return NULL;
+
+    hdr = (PJshmHeader *) shm_arena;
+    entry = pj_gridinfo_shm_find( gi );
+    if( entry != NULL )
+    {
+        /* another process published it since our lookup */
+        data = (FLP *) ((char *) shm_arena + entry->data_offset);
+    }
+    else
+    {
+        /* gtx vertical grids store one float per node, the other
+           formats FLP pairs */
+        long bytes = (long) gi->ct->lim.lam * gi->ct->lim.phi
+            * (strcmp( gi->format, "gtx" ) == 0
+               ? sizeof(float) : sizeof(FLP));
+        long reserve = (bytes + 7) & ~7L;
+
+        if( hdr->entry_count < PJ_SHM_MAX_ENTRIES
+            && hdr->used + reserve <= hdr->arena_size )
+        {
+            entry = (PJshmEntry *) (hdr + 1) + hdr->entry_count;
+            memcpy( (char *) shm_arena + hdr->used, gi->ct->cvs, bytes );
+            strcpy( entry->gridname, gi->gridname );
+            entry->grid_offset = gi->grid_offset;
+            entry->lim_lam = gi->ct->lim.lam;
+            entry->lim_phi = gi->ct->lim.phi;
+            entry->data_offset = hdr->used;
+            entry->ready = 1;
+            hdr->used += reserve;
+            hdr->entry_count++;
+            data = (FLP *) ((char *) shm_arena + entry->data_offset);
+            pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+                    "grid %s published to shared arena", gi->ct->id );
+        }
+    }
+    flock( shm_arena_fd, LOCK_UN );
+    return data;
+#else
+    return NULL;
+#endif
+}
+
 /************************************************************************/
 /*                          pj_gridinfo_free()                          */
 /************************************************************************/
@@ -97,6 +409,32 @@ void pj_gridinfo_free( projCtx ctx, PJ_GRIDINFO *gi )
         }
     }
 
+    if( gi->tree != NULL )
+    {
+        pj_dalloc( gi->tree );
+        gi->tree = NULL;
+    }
+
+#ifdef HAVE_GRID_MMAP
+    if( gi->map_base != NULL )
+    {
+        /* the shift values belong to the mapping, not the heap */
+        if( gi->ct != NULL )
+            gi->ct->cvs = NULL;
+        munmap( gi->map_base, gi->map_size );
+        gi->map_base = NULL;
+    }
+#endif
+
+    if( gi->cvs_shm && gi->ct != NULL )
+    {
+        /* the shift values live in the shared arena, not our heap */
+        gi->ct->cvs = NULL;
+        gi->cvs_shm = 0;
+    }
+
+    pj_grid_cache_note_freed( gi );
+
     if( gi->ct != NULL )
         nad_free( gi->ct );
 
@@ -108,14 +446,14 @@ void pj_gridinfo_free( projCtx ctx, PJ_GRIDINFO *gi )
 }
 
 /************************************************************************/
-/*                          pj_gridinfo_load()                          */
+/*                       pj_gridinfo_load_data()                        */
 /*                                                                      */
-/*      This function is intended to implement delayed loading of       */
-/*      the data contents of a grid file.  The header and related       */
-/*      stuff are loaded by pj_gridinfo_init().                         */
+/*      Format specific reading of the data contents of a grid          */
+/*      file.  The caller (pj_gridinfo_load()) holds the                */
+/*      PJ_LOCK_GRIDS write lock for the duration of the call.          */
 /************************************************************************/
 
-int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
+static int pj_gridinfo_load_data( projCtx ctx, PJ_GRIDINFO *gi )
 
 {
     struct CTABLE ct_tmp;
@@ -123,10 +461,8 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
     if( gi == NULL || gi->ct == NULL )
         return 0;
 
-    pj_acquire_lock();
     if( gi->ct->cvs != NULL )
     {
-        pj_release_lock();
         return 1;
     }
 
@@ -145,16 +481,23 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
         if( fid == NULL )
         {
             pj_ctx_set_errno( ctx, -38 );
-            pj_release_lock();
             return 0;
         }
 
+        /* the ctable data portion is raw native FLPs: map it directly
+           when we can */
+        if( pj_gridinfo_map( ctx, gi, fid, CTABLE_V1_HDR_SIZE,
+                             sizeof(FLP) * gi->ct->lim.lam * gi->ct->lim.phi ))
+        {
+            pj_ctx_fclose( ctx, fid );
+            return 1;
+        }
+
         result = nad_ctable_load( ctx, &ct_tmp, fid );
 
         pj_ctx_fclose( ctx, fid );
 
         gi->ct->cvs = ct_tmp.cvs;
-        pj_release_lock();
 
         return result;
     }
@@ -172,17 +515,64 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
         if( fid == NULL )
         {
             pj_ctx_set_errno( ctx, -38 );
-            pj_release_lock();
             return 0;
         }
 
+        /* ctable2 data is little endian FLPs at a fixed offset, so LSB
+           hosts can map it zero-copy; others must read and swap */
+        if( IS_LSB
+            && pj_gridinfo_map( ctx, gi, fid, 160,
+                             sizeof(FLP) * gi->ct->lim.lam * gi->ct->lim.phi ))
+        {
+            pj_ctx_fclose( ctx, fid );
+            return 1;
+        }
+
         result = nad_ctable2_load( ctx, &ct_tmp, fid );
 
         pj_ctx_fclose( ctx, fid );
 
         gi->ct->cvs = ct_tmp.cvs;
 
-        pj_release_lock();
+        return result;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      CTable3 format.                                                 */
+/* -------------------------------------------------------------------- */
+    else if( strcmp(gi->format,"ctable3") == 0 )
+    {
+        PAFile fid;
+        int result;
+        char header[138];
+
+        fid = pj_open_lib( ctx, gi->filename, "rb" );
+
+        if( fid == NULL )
+        {
+            pj_ctx_set_errno( ctx, -38 );
+            return 0;
+        }
+
+        /* native byte order float encoding is laid out exactly like the
+           in-memory array at an aligned offset: map it zero-copy.  The
+           checksum is only verified on the read path below. */
+        if( pj_ctx_fread( ctx, header, sizeof(header), 1, fid ) == 1
+            && (header[136] != 0) == IS_LSB
+            && header[137] == 0
+            && pj_gridinfo_map( ctx, gi, fid, 256,
+                             sizeof(FLP) * gi->ct->lim.lam * gi->ct->lim.phi ))
+        {
+            pj_ctx_fclose( ctx, fid );
+            return 1;
+        }
+
+        result = nad_ctable3_load( ctx, &ct_tmp, fid );
+
+        pj_ctx_fclose( ctx, fid );
+
+        gi->ct->cvs = ct_tmp.cvs;
+
         return result;
     }
 
@@ -204,18 +594,19 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
         if( fid == NULL )
         {
             pj_ctx_set_errno( ctx, -38 );
-            pj_release_lock();
             return 0;
         }
 
         pj_ctx_fseek( ctx, fid, gi->grid_offset, SEEK_SET );
 
-        row_buf = (double *) pj_malloc(gi->ct->lim.lam * sizeof(double) * 2);
+        row_buf = (double *) pj_ctx_buffer_get(
+            ctx, gi->ct->lim.lam * sizeof(double) * 2);
         ct_tmp.cvs = (FLP *) pj_malloc(gi->ct->lim.lam*gi->ct->lim.phi*sizeof(FLP));
+        pj_numa_spread_touch( ct_tmp.cvs,
+                              gi->ct->lim.lam*gi->ct->lim.phi*sizeof(FLP) );
         if( row_buf == NULL || ct_tmp.cvs == NULL )
         {
             pj_ctx_set_errno( ctx, -38 );
-            pj_release_lock();
             return 0;
         }
 
@@ -229,7 +620,7 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
                               sizeof(double), gi->ct->lim.lam * 2, fid )
                 != 2 * gi->ct->lim.lam )
             {
-                pj_dalloc( row_buf );
+                pj_ctx_buffer_put( ctx, row_buf );
                 pj_dalloc( ct_tmp.cvs );
                 pj_ctx_set_errno( ctx, -38 );
                 return 0;
@@ -251,12 +642,11 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
             }
         }
 
-        pj_dalloc( row_buf );
+        pj_ctx_buffer_put( ctx, row_buf );
 
         pj_ctx_fclose( ctx, fid );
 
         gi->ct->cvs = ct_tmp.cvs;
-        pj_release_lock();
 
         return 1;
     }
@@ -282,18 +672,19 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
         if( fid == NULL )
         {
             pj_ctx_set_errno( ctx, -38 );
-            pj_release_lock();
             return 0;
         }
 
         pj_ctx_fseek( ctx, fid, gi->grid_offset, SEEK_SET );
 
-        row_buf = (float *) pj_malloc(gi->ct->lim.lam * sizeof(float) * 4);
+        row_buf = (float *) pj_ctx_buffer_get(
+            ctx, gi->ct->lim.lam * sizeof(float) * 4);
         ct_tmp.cvs = (FLP *) pj_malloc(gi->ct->lim.lam*gi->ct->lim.phi*sizeof(FLP));
+        pj_numa_spread_touch( ct_tmp.cvs,
+                              gi->ct->lim.lam*gi->ct->lim.phi*sizeof(FLP) );
         if( row_buf == NULL || ct_tmp.cvs == NULL )
         {
             pj_ctx_set_errno( ctx, -38 );
-            pj_release_lock();
             return 0;
         }
 
@@ -307,10 +698,9 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
                               gi->ct->lim.lam*4, fid )
                 != 4 * gi->ct->lim.lam )
             {
-                pj_dalloc( row_buf );
+                pj_ctx_buffer_put( ctx, row_buf );
                 pj_dalloc( ct_tmp.cvs );
                 pj_ctx_set_errno( ctx, -38 );
-                pj_release_lock();
                 return 0;
             }
 
@@ -332,13 +722,12 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
             }
         }
 
-        pj_dalloc( row_buf );
+        pj_ctx_buffer_put( ctx, row_buf );
 
         pj_ctx_fclose( ctx, fid );
 
         gi->ct->cvs = ct_tmp.cvs;
 
-        pj_release_lock();
         return 1;
     }
 
@@ -355,17 +744,16 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
         if( fid == NULL )
         {
             pj_ctx_set_errno( ctx, -38 );
-            pj_release_lock();
             return 0;
         }
 
         pj_ctx_fseek( ctx, fid, gi->grid_offset, SEEK_SET );
 
         ct_tmp.cvs = (FLP *) pj_malloc(words*sizeof(float));
+        pj_numa_spread_touch( ct_tmp.cvs, words*sizeof(float) );
         if( ct_tmp.cvs == NULL )
         {
             pj_ctx_set_errno( ctx, -38 );
-            pj_release_lock();
             return 0;
         }
 
@@ -373,7 +761,6 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
             != words )
         {
             pj_dalloc( ct_tmp.cvs );
-            pj_release_lock();
             return 0;
         }
 
@@ -382,17 +769,416 @@ int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
 
         pj_ctx_fclose( ctx, fid );
         gi->ct->cvs = ct_tmp.cvs;
-        pj_release_lock();
         return 1;
     }
 
     else
     {
-        pj_release_lock();
         return 0;
     }
 }
 
+/************************************************************************/
+/*                          pj_gridinfo_load()                          */
+/*                                                                      */
+/*      This function is intended to implement delayed loading of       */
+/*      the data contents of a grid file.  The header and related       */
+/*      stuff are loaded by pj_gridinfo_init().  Freshly loaded heap    */
+/*      payloads are accounted against the grid cache byte budget       */
+/*      (see pj_gridlist.c), which may evict other idle grids.          */
+/************************************************************************/
+
+/* largest file mapping worth scanning for the all-zero test below */
+#define PJ_NULL_SCAN_MAX (1024 * 1024)
+
+static int tiled_grids_flag = -1;
+
+void pj_gridinfo_set_tiled( int flag )
+
+{
+    tiled_grids_flag = flag;
+}
+
+static int pj_gridinfo_use_tiles()
+
+{
+    if( tiled_grids_flag < 0 )
+        tiled_grids_flag = getenv( "PJ_TILED_GRIDS" ) != NULL;
+    return tiled_grids_flag;
+}
+
+static int packed_grids_flag = -1;
+
+void pj_gridinfo_set_packed( int flag )
+
+{
+    packed_grids_flag = flag;
+}
+
+static int pj_gridinfo_use_packed()
+
+{
+    if( packed_grids_flag < 0 )
+        packed_grids_flag = getenv( "PJ_PACKED_GRIDS" ) != NULL;
+    return packed_grids_flag;
+}
+
+static int gtx_window_flag = -1;
+
+void pj_gridinfo_set_gtx_window( int flag )
+
+{
+    gtx_window_flag = flag;
+}
+
+static int pj_gridinfo_use_gtx_window()
+
+{
+    if( gtx_window_flag < 0 )
+        gtx_window_flag = getenv( "PJ_GTX_WINDOW" ) != NULL;
+    return gtx_window_flag;
+}
+
+int pj_gridinfo_load( projCtx ctx, PJ_GRIDINFO *gi )
+
+{
+    int result;
+
+    if( gi == NULL || gi->ct == NULL )
+        return 0;
+
+    pj_acquire_write_lock( PJ_LOCK_GRIDS );
+
+    if( gi->ct->cvs != NULL )
+    {
+        pj_grid_cache_touch( gi );
+        pj_release_write_lock( PJ_LOCK_GRIDS );
+        return 1;
+    }
+
+    /* the shared arena may already hold this grid's converted payload */
+    {
+        FLP *shared = pj_gridinfo_shm_lookup( ctx, gi );
+
+        if( shared != NULL )
+        {
+            gi->ct->cvs = shared;
+            gi->cvs_shm = 1;
+            result = 1;
+        }
+        else
+            result = pj_gridinfo_load_data( ctx, gi );
+    }
+
+    if( result && gi->ct->cvs != NULL )
+    {
+        /* the cvs may have been freed by an earlier cache eviction,
+           in which case the fresh copy is row-major again */
+        gi->ct->tiled = 0;
+        gi->ct->tiles_lam = 0;
+        gi->ct->packed = 0;
+        gi->ct->qbase = NULL;
+        gi->ct->qstep = NULL;
+        gi->ct->null_shift = 0;
+        gi->ct->const_shift = 0;
+        gi->ct->win_row0 = 0;
+        gi->ct->win_rows = 0;
+
+        /* degenerate grid detection: a table whose every shift is
+           exactly zero lets nad_cvt() return contained points
+           untouched, and one whose shifts are all equal (constant
+           offset datums published as tiny grids) lets it apply the
+           offset closed form; either way no interpolation ever runs.
+           Scanning a file mapping would fault the whole file in and
+           defeat its laziness, so only small mappings are inspected. */
+        if( strcmp( gi->format, "gtx" ) != 0
+            && ( gi->map_base == NULL
+                 || gi->map_size <= PJ_NULL_SCAN_MAX ) )
+        {
+            /* well below any real shift, well above float jitter at
+               arcsecond magnitudes */
+            const double tol = 1e-12;
+            long n = (long) gi->ct->lim.lam * gi->ct->lim.phi;
+            const FLP *f = gi->ct->cvs;
+            double min_lam = f->lam, max_lam = f->lam;
+            double min_phi = f->phi, max_phi = f->phi;
+
+            while( --n > 0 )
+            {
+                f++;
+                if( f->lam < min_lam ) min_lam = f->lam;
+                else if( f->lam > max_lam ) max_lam = f->lam;
+                if( f->phi < min_phi ) min_phi = f->phi;
+                else if( f->phi > max_phi ) max_phi = f->phi;
+                if( max_lam - min_lam > tol || max_phi - min_phi > tol )
+                    break;
+            }
+
+            if( n <= 0 )
+            {
+                if( min_lam == 0.0 && max_lam == 0.0
+                    && min_phi == 0.0 && max_phi == 0.0 )
+                {
+                    gi->ct->null_shift = 1;
+                    pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+                            "grid %s has no shift anywhere, "
+                            "interpolation will be skipped", gi->ct->id );
+                }
+                else
+                {
+                    gi->ct->const_shift = 1;
+                    gi->ct->const_sh.lam = .5 * (min_lam + max_lam);
+                    gi->ct->const_sh.phi = .5 * (min_phi + max_phi);
+                    pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+                            "grid %s carries a constant shift, "
+                            "interpolation will be skipped", gi->ct->id );
+                }
+            }
+        }
+
+        if( gi->map_base == NULL && !gi->cvs_shm )
+        {
+            FLP *shared = pj_gridinfo_shm_publish( ctx, gi );
+
+            if( shared != NULL )
+            {
+                pj_dalloc( gi->ct->cvs );
+                gi->ct->cvs = shared;
+                gi->cvs_shm = 1;
+            }
+        }
+
+        /* in-memory layout changes only apply to heap payloads of
+           horizontal FLP tables; gtx payloads are bare floats */
+        if( gi->map_base == NULL && !gi->cvs_shm
+            && strcmp( gi->format, "gtx" ) != 0 )
+        {
+            if( pj_gridinfo_use_tiles() )
+                nad_ctable_tile( gi->ct );
+            else if( pj_gridinfo_use_packed() )
+                nad_ctable_pack( gi->ct );
+        }
+
+        pj_grid_cache_note_loaded( ctx, gi );
+    }
+
+    pj_release_write_lock( PJ_LOCK_GRIDS );
+
+    return result;
+}
+
+/************************************************************************/
+/*                      pj_gridinfo_load_window()                       */
+/*                                                                      */
+/*      Load only the latitude rows of a GTX vertical grid that a       */
+/*      batch of points can touch, plus one guard row on each side      */
+/*      for the bilinear stencil.  Worldwide high resolution geoid      */
+/*      models reach hundreds of megabytes, most of which is never      */
+/*      read when the workload sits in one zone; the window keeps       */
+/*      the resident payload proportional to the latitude band          */
+/*      actually in use.  Opt-in via PJ_GTX_WINDOW in the               */
+/*      environment or pj_gridinfo_set_gtx_window(); otherwise, and     */
+/*      for every other format, this defers to pj_gridinfo_load().      */
+/*      A resident window that does not cover the request is            */
+/*      widened to the union; once a window would span half the         */
+/*      table the whole file is loaded instead.                         */
+/************************************************************************/
+
+int pj_gridinfo_load_window( projCtx ctx, PJ_GRIDINFO *gi,
+                             double phi_min, double phi_max )
+
+{
+    struct CTABLE *ct;
+    int row0, row1, rows;
+    long words;
+    float *cvs;
+    PAFile fid;
+
+    if( gi == NULL || gi->ct == NULL )
+        return 0;
+
+    if( strcmp( gi->format, "gtx" ) != 0
+        || !pj_gridinfo_use_gtx_window()
+        || phi_min > phi_max )
+        return pj_gridinfo_load( ctx, gi );
+
+    ct = gi->ct;
+
+    /* one guard row on each side so the bilinear stencil of a point
+       in the first/last requested row stays inside the window */
+    row0 = (int) floor( (phi_min - ct->ll.phi) / ct->del.phi ) - 1;
+    row1 = (int) floor( (phi_max - ct->ll.phi) / ct->del.phi ) + 2;
+
+    pj_acquire_write_lock( PJ_LOCK_GRIDS );
+
+    if( ct->cvs != NULL && ct->win_rows > 0 )
+    {
+        /* widen the request to the union with the resident window so
+           points that were covered a moment ago stay covered */
+        if( ct->win_row0 < row0 )
+            row0 = ct->win_row0;
+        if( ct->win_row0 + ct->win_rows > row1 )
+            row1 = ct->win_row0 + ct->win_rows;
+    }
+
+    if( row0 < 0 )
+        row0 = 0;
+    if( row1 > ct->lim.phi )
+        row1 = ct->lim.phi;
+    rows = row1 - row0;
+
+    if( ct->cvs != NULL
+        && ( ct->win_rows == 0
+             || (row0 >= ct->win_row0
+                 && row1 <= ct->win_row0 + ct->win_rows) ) )
+    {
+        /* the whole table, or a window already covering the request,
+           is resident */
+        pj_grid_cache_touch( gi );
+        pj_release_write_lock( PJ_LOCK_GRIDS );
+        return 1;
+    }
+
+    if( rows <= 0 || rows * 2 >= ct->lim.phi )
+    {
+        /* windowing is no longer worth the reread; drop any stale
+           window and let pj_gridinfo_load() (which takes the lock
+           itself) pull in the full table */
+        if( ct->cvs != NULL && ct->win_rows > 0 )
+        {
+            pj_dalloc( ct->cvs );
+            ct->cvs = NULL;
+            pj_grid_cache_note_freed( gi );
+            ct->win_row0 = 0;
+            ct->win_rows = 0;
+        }
+        pj_release_write_lock( PJ_LOCK_GRIDS );
+        return pj_gridinfo_load( ctx, gi );
+    }
+
+    fid = pj_open_lib( ctx, gi->filename, "rb" );
+    if( fid == NULL )
+    {
+        pj_release_write_lock( PJ_LOCK_GRIDS );
+        pj_ctx_set_errno( ctx, -38 );
+        return 0;
+    }
+
+    words = (long) rows * ct->lim.lam;
+    cvs = (float *) pj_malloc( words * sizeof(float) );
+    if( cvs == NULL )
+    {
+        pj_ctx_fclose( ctx, fid );
+        pj_release_write_lock( PJ_LOCK_GRIDS );
+        pj_ctx_set_errno( ctx, -38 );
+        return 0;
+    }
+    pj_numa_spread_touch( cvs, words * sizeof(float) );
+
+    pj_ctx_fseek( ctx, fid,
+                  gi->grid_offset
+                  + (long) row0 * ct->lim.lam * sizeof(float),
+                  SEEK_SET );
+
+    if( pj_ctx_fread( ctx, cvs, sizeof(float), words, fid ) != words )
+    {
+        pj_dalloc( cvs );
+        pj_ctx_fclose( ctx, fid );
+        pj_release_write_lock( PJ_LOCK_GRIDS );
+        return 0;
+    }
+
+    if( IS_LSB )
+        swap_words( (unsigned char *) cvs, 4, words );
+
+    pj_ctx_fclose( ctx, fid );
+
+    if( ct->cvs != NULL )
+    {
+        pj_dalloc( ct->cvs );
+        pj_grid_cache_note_freed( gi );
+    }
+
+    ct->cvs = (FLP *) cvs;
+    ct->win_row0 = row0;
+    ct->win_rows = rows;
+
+    pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+            "loaded rows %d..%d of gtx grid %s",
+            row0, row1 - 1, ct->id );
+
+    pj_grid_cache_note_loaded( ctx, gi );
+
+    pj_release_write_lock( PJ_LOCK_GRIDS );
+
+    return 1;
+}
+
+/************************************************************************/
+/*                    pj_gridinfo_load_background()                     */
+/*                                                                      */
+/*      Kick off loading of the grid payload on the shared worker       */
+/*      pool and return without waiting for it.  Returns 1 if the       */
+/*      payload is already resident (nothing to do), else 0 with the    */
+/*      load either in flight or, on repeated calls, already being      */
+/*      read by an earlier caller's worker.  With no pool available     */
+/*      the load simply happens inline.                                 */
+/************************************************************************/
+
+static void pj_gridinfo_load_worker( void *arg )
+
+{
+    PJ_GRIDINFO *gi = (PJ_GRIDINFO *) arg;
+    /* the requesting context is not thread safe, so the worker reads
+       through a private one carrying the default file api and logger */
+    projCtx ctx = pj_ctx_alloc();
+
+    pj_gridinfo_load( ctx, gi );
+
+    pj_acquire_write_lock( PJ_LOCK_GRIDS );
+    gi->loading = 0;
+    pj_release_write_lock( PJ_LOCK_GRIDS );
+
+    pj_ctx_free( ctx );
+}
+
+int pj_gridinfo_load_background( projCtx ctx, PJ_GRIDINFO *gi )
+
+{
+    if( gi == NULL || gi->ct == NULL )
+        return 0;
+
+    pj_acquire_write_lock( PJ_LOCK_GRIDS );
+
+    if( gi->ct->cvs != NULL )
+    {
+        pj_grid_cache_touch( gi );
+        pj_release_write_lock( PJ_LOCK_GRIDS );
+        return 1;
+    }
+
+    if( gi->loading )
+    {
+        /* an earlier call's worker is already reading this grid */
+        pj_release_write_lock( PJ_LOCK_GRIDS );
+        return 0;
+    }
+
+    gi->loading = 1;
+    pj_release_write_lock( PJ_LOCK_GRIDS );
+
+    if( pj_tpool_submit( pj_gridinfo_load_worker, gi ) != 0 )
+    {
+        /* no worker to delegate to: load inline as in blocking mode */
+        pj_acquire_write_lock( PJ_LOCK_GRIDS );
+        gi->loading = 0;
+        pj_release_write_lock( PJ_LOCK_GRIDS );
+        return pj_gridinfo_load( ctx, gi );
+    }
+
+    return 0;
+}
+
 /************************************************************************/
 /*                       pj_gridinfo_init_ntv2()                        */
 /*                                                                      */
@@ -507,6 +1293,7 @@ static int pj_gridinfo_init_ntv2( projCtx ctx, PAFile fid, PJ_GRIDINFO *gilist )
 /*      Initialize a corresponding "ct" structure.                      */
 /* -------------------------------------------------------------------- */
         ct = (struct CTABLE *) pj_malloc(sizeof(struct CTABLE));
+        memset( ct, 0, sizeof(struct CTABLE) );
         strncpy( ct->id, (const char *) header + 8, 8 );
         ct->id[8] = '\0';
 
@@ -620,6 +1407,180 @@ static int pj_gridinfo_init_ntv2( projCtx ctx, PAFile fid, PJ_GRIDINFO *gilist )
     return 1;
 }
 
+/************************************************************************/
+/*                       pj_gridinfo_tree_count()                       */
+/************************************************************************/
+
+static int pj_gridinfo_tree_count( PJ_GRIDINFO *gi )
+
+{
+    int count = 1;
+    PJ_GRIDINFO *child;
+
+    for( child = gi->child; child != NULL; child = child->next )
+        count += pj_gridinfo_tree_count( child );
+
+    return count;
+}
+
+/************************************************************************/
+/*                       pj_gridinfo_tree_fill()                        */
+/*                                                                      */
+/*      Fill the entry for one node and place its direct children in    */
+/*      consecutive entries before recursing, so each sibling run the   */
+/*      descent scans is contiguous.  Returns the next free entry.      */
+/************************************************************************/
+
+static int pj_gridinfo_tree_fill( PJ_GRIDTREE *tree, int self, int at )
+
+{
+    PJ_GRIDINFO *gi = tree->node[self];
+    struct CTABLE *ct = gi->ct;
+    double epsilon = (fabs(ct->del.phi)+fabs(ct->del.lam))/10000.0;
+    PJ_GRIDINFO *child;
+    int kid;
+
+    tree->min_lam[self] = ct->ll.lam - epsilon;
+    tree->min_phi[self] = ct->ll.phi - epsilon;
+    tree->max_lam[self] = ct->ll.lam+(ct->lim.lam-1)*ct->del.lam + epsilon;
+    tree->max_phi[self] = ct->ll.phi+(ct->lim.phi-1)*ct->del.phi + epsilon;
+    tree->first_child[self] = ( gi->child != NULL ) ? at : -1;
+
+    kid = at;
+    for( child = gi->child; child != NULL; child = child->next, kid++ )
+    {
+        tree->node[kid] = child;
+        tree->next_sibling[kid] = ( child->next != NULL ) ? kid+1 : -1;
+    }
+
+    at = kid;
+    for( kid = tree->first_child[self]; kid >= 0;
+         kid = tree->next_sibling[kid] )
+        at = pj_gridinfo_tree_fill( tree, kid, at );
+
+    return at;
+}
+
+/************************************************************************/
+/*                       pj_gridinfo_tree_build()                       */
+/*                                                                      */
+/*      Flatten the subgrid tree of a top level grid into parallel      */
+/*      arrays (see PJ_GRIDTREE in projects.h).  Called once per top    */
+/*      level grid after pj_gridinfo_init_ntv2() has parsed all the     */
+/*      subgrid headers; the bounds are fixed from then on.  On         */
+/*      malloc failure the grid simply keeps the pointer chasing        */
+/*      descent.                                                        */
+/************************************************************************/
+
+static void pj_gridinfo_tree_build( PJ_GRIDINFO *gi )
+
+{
+    PJ_GRIDTREE *tree;
+    int count = pj_gridinfo_tree_count( gi );
+    size_t bytes = sizeof(PJ_GRIDTREE)
+        + (size_t) count * (4 * sizeof(double) + sizeof(PJ_GRIDINFO *)
+                            + 2 * sizeof(int));
+
+    tree = (PJ_GRIDTREE *) pj_malloc( bytes );
+    if( tree == NULL )
+        return;
+
+    tree->count = count;
+    tree->min_lam = (double *) (tree + 1);
+    tree->max_lam = tree->min_lam + count;
+    tree->min_phi = tree->max_lam + count;
+    tree->max_phi = tree->min_phi + count;
+    tree->node = (PJ_GRIDINFO **) (tree->max_phi + count);
+    tree->first_child = (int *) (tree->node + count);
+    tree->next_sibling = tree->first_child + count;
+
+    tree->node[0] = gi;
+    tree->next_sibling[0] = -1;
+    pj_gridinfo_tree_fill( tree, 0, 1 );
+
+    gi->tree = tree;
+}
+
+/************************************************************************/
+/*                        pj_gridinfo_descend()                         */
+/*                                                                      */
+/*      Resolve the most specific subgrid containing the point,         */
+/*      assuming the caller already checked the top level extent.       */
+/*      Uses the flattened tree when one was built: an indexed walk     */
+/*      over contiguous bounds arrays whose cost no longer grows with   */
+/*      nesting depth the way the linked list chase does on deeply      */
+/*      nested files.  If parent is non-NULL it receives the direct     */
+/*      parent of the returned subgrid, or NULL when no descent         */
+/*      happened.                                                       */
+/************************************************************************/
+
+PJ_GRIDINFO *pj_gridinfo_descend( PJ_GRIDINFO *gi, LP input,
+                                  PJ_GRIDINFO **parent )
+
+{
+    const PJ_GRIDTREE *tree = gi->tree;
+
+    if( parent != NULL )
+        *parent = NULL;
+
+    if( tree != NULL )
+    {
+        int cur = 0, up = -1;
+        int kid = tree->first_child[0];
+
+        while( kid >= 0 )
+        {
+            if( input.phi >= tree->min_phi[kid]
+                && input.phi <= tree->max_phi[kid]
+                && input.lam >= tree->min_lam[kid]
+                && input.lam <= tree->max_lam[kid] )
+            {
+                up = cur;
+                cur = kid;
+                kid = tree->first_child[kid];
+            }
+            else
+                kid = tree->next_sibling[kid];
+        }
+
+        if( parent != NULL && up >= 0 )
+            *parent = tree->node[up];
+
+        return tree->node[cur];
+    }
+
+    /* pointer chase for grids without a flattened tree */
+    while( gi->child != NULL )
+    {
+        PJ_GRIDINFO *child;
+
+        for( child = gi->child; child != NULL; child = child->next )
+        {
+            struct CTABLE *ct1 = child->ct;
+            double epsilon =
+                (fabs(ct1->del.phi)+fabs(ct1->del.lam))/10000.0;
+
+            if( ct1->ll.phi - epsilon > input.phi
+                || ct1->ll.lam - epsilon > input.lam
+                || (ct1->ll.phi+(ct1->lim.phi-1)*ct1->del.phi + epsilon
+                    < input.phi)
+                || (ct1->ll.lam+(ct1->lim.lam-1)*ct1->del.lam + epsilon
+                    < input.lam) )
+                continue;
+
+            break;
+        }
+
+        if( child == NULL ) break;
+
+        if( parent != NULL )
+            *parent = gi;
+        gi = child;
+    }
+
+    return gi;
+}
+
 /************************************************************************/
 /*                       pj_gridinfo_init_ntv1()                        */
 /*                                                                      */
@@ -678,6 +1639,7 @@ static int pj_gridinfo_init_ntv1( projCtx ctx, PAFile fid, PJ_GRIDINFO *gi )
 /*      Fill in CTABLE structure.                                       */
 /* -------------------------------------------------------------------- */
     ct = (struct CTABLE *) pj_malloc(sizeof(struct CTABLE));
+    memset( ct, 0, sizeof(struct CTABLE) );
     strcpy( ct->id, "NTv1 Grid Shift File" );
 
     ct->ll.lam = - *((double *) (header+72));
@@ -770,6 +1732,7 @@ static int pj_gridinfo_init_gtx( projCtx ctx, PAFile fid, PJ_GRIDINFO *gi )
 /*      Fill in CTABLE structure.                                       */
 /* -------------------------------------------------------------------- */
     ct = (struct CTABLE *) pj_malloc(sizeof(struct CTABLE));
+    memset( ct, 0, sizeof(struct CTABLE) );
     strcpy( ct->id, "GTX Vertical Grid Shift File" );
 
     ct->ll.lam = xorigin;
@@ -791,11 +1754,12 @@ static int pj_gridinfo_init_gtx( projCtx ctx, PAFile fid, PJ_GRIDINFO *gi )
                 "This GTX spans the dateline!  This will cause problems." );
     }
 
-    pj_log( ctx, PJ_LOG_DEBUG_MINOR,
-            "GTX %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)",
-            ct->lim.lam, ct->lim.phi,
-            ct->ll.lam, ct->ll.phi,
-            ct->ll.lam + (columns-1)*xstep, ct->ll.phi + (rows-1)*ystep);
+    if( PJ_LOG_ENABLED( ctx, PJ_LOG_DEBUG_MINOR ) )
+        pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+                "GTX %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)",
+                ct->lim.lam, ct->lim.phi,
+                ct->ll.lam, ct->ll.phi,
+                ct->ll.lam + (columns-1)*xstep, ct->ll.phi + (rows-1)*ystep);
 
     ct->ll.lam *= DEG_TO_RAD;
     ct->ll.phi *= DEG_TO_RAD;
@@ -819,6 +1783,38 @@ static int pj_gridinfo_init_gtx( projCtx ctx, PAFile fid, PJ_GRIDINFO *gi )
 /*      applications.                                                   */
 /************************************************************************/
 
+/************************************************************************/
+/*                         pj_gridinfo_ident()                          */
+/*                                                                      */
+/*      Record the resolved file identity (device and inode) of a       */
+/*      freshly opened grid, so pj_gridlist_merge_gridfile() can        */
+/*      recognize the same physical file reached through different      */
+/*      spellings ("conus" vs "./conus" vs a symlink) and alias it      */
+/*      instead of loading a second copy of the payload.                */
+/************************************************************************/
+
+static void pj_gridinfo_ident( projCtx ctx, PAFile fp, PJ_GRIDINFO *gi )
+
+{
+#ifdef HAVE_GRID_MMAP
+    int         fd = pj_ctx_get_fd( ctx, fp );
+    struct stat sb;
+
+    if( fd >= 0 && fstat( fd, &sb ) == 0 )
+    {
+        gi->ident_dev = (unsigned long) sb.st_dev;
+        gi->ident_ino = (unsigned long) sb.st_ino;
+        gi->has_ident = 1;
+    }
+#else
+    /* without posix file identity duplicate spellings simply keep
+       loading separate copies, as they always have */
+    (void) ctx;
+    (void) fp;
+    (void) gi;
+#endif
+}
+
 PJ_GRIDINFO *pj_gridinfo_init( projCtx ctx, const char *gridname )
 
 {
@@ -854,6 +1850,7 @@ PJ_GRIDINFO *pj_gridinfo_init( projCtx ctx, const char *gridname )
     }
 
     gilist->filename = strdup(fname);
+    pj_gridinfo_ident( ctx, fp, gilist );
 
 /* -------------------------------------------------------------------- */
 /*      Load a header, to determine the file type.                      */
@@ -880,7 +1877,16 @@ PJ_GRIDINFO *pj_gridinfo_init( projCtx ctx, const char *gridname )
     else if( strncmp(header + 0, "NUM_OREC", 8) == 0
              && strncmp(header + 48, "GS_TYPE", 7) == 0 )
     {
-        pj_gridinfo_init_ntv2( ctx, fp, gilist );
+        if( pj_gridinfo_init_ntv2( ctx, fp, gilist ) )
+        {
+            PJ_GRIDINFO *gi;
+
+            /* flatten each subgrid tree (a multi parent file chains
+               extra top level grids on gilist->next) */
+            for( gi = gilist; gi != NULL; gi = gi->next )
+                if( gi->child != NULL )
+                    pj_gridinfo_tree_build( gi );
+        }
     }
 
     else if( strlen(gridname) > 4
@@ -890,6 +1896,28 @@ PJ_GRIDINFO *pj_gridinfo_init( projCtx ctx, const char *gridname )
         pj_gridinfo_init_gtx( ctx, fp, gilist );
     }
 
+    else if( strncmp(header + 0,"CTABLE V3",9) == 0 )
+    {
+        struct CTABLE *ct;
+
+        pj_ctx_fseek( ctx, fp, 0, SEEK_SET );
+        ct = nad_ctable3_init( ctx, fp );
+        if( ct != NULL )
+        {
+            gilist->format = "ctable3";
+            gilist->ct = ct;
+
+            if( PJ_LOG_ENABLED( ctx, PJ_LOG_DEBUG_MAJOR ) )
+                pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
+                        "Ctable3 %s %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)\n",
+                        ct->id,
+                        ct->lim.lam, ct->lim.phi,
+                        ct->ll.lam * RAD_TO_DEG, ct->ll.phi * RAD_TO_DEG,
+                        (ct->ll.lam + (ct->lim.lam-1)*ct->del.lam) * RAD_TO_DEG,
+                        (ct->ll.phi + (ct->lim.phi-1)*ct->del.phi) * RAD_TO_DEG );
+        }
+    }
+
     else if( strncmp(header + 0,"CTABLE V2",9) == 0 )
     {
         struct CTABLE *ct = nad_ctable2_init( ctx, fp );
@@ -897,13 +1925,14 @@ PJ_GRIDINFO *pj_gridinfo_init( projCtx ctx, const char *gridname )
         gilist->format = "ctable2";
         gilist->ct = ct;
 
-        pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
-                "Ctable2 %s %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)\n",
-                ct->id,
-                ct->lim.lam, ct->lim.phi,
-                ct->ll.lam * RAD_TO_DEG, ct->ll.phi * RAD_TO_DEG,
-                (ct->ll.lam + (ct->lim.lam-1)*ct->del.lam) * RAD_TO_DEG,
-                (ct->ll.phi + (ct->lim.phi-1)*ct->del.phi) * RAD_TO_DEG );
+        if( PJ_LOG_ENABLED( ctx, PJ_LOG_DEBUG_MAJOR ) )
+            pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
+                    "Ctable2 %s %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)\n",
+                    ct->id,
+                    ct->lim.lam, ct->lim.phi,
+                    ct->ll.lam * RAD_TO_DEG, ct->ll.phi * RAD_TO_DEG,
+                    (ct->ll.lam + (ct->lim.lam-1)*ct->del.lam) * RAD_TO_DEG,
+                    (ct->ll.phi + (ct->lim.phi-1)*ct->del.phi) * RAD_TO_DEG );
     }
 
     else
@@ -918,13 +1947,14 @@ PJ_GRIDINFO *pj_gridinfo_init( projCtx ctx, const char *gridname )
             gilist->format = "ctable";
             gilist->ct = ct;
 
-            pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
-                    "Ctable %s %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)\n",
-                    ct->id,
-                    ct->lim.lam, ct->lim.phi,
-                    ct->ll.lam * RAD_TO_DEG, ct->ll.phi * RAD_TO_DEG,
-                    (ct->ll.lam + (ct->lim.lam-1)*ct->del.lam) * RAD_TO_DEG,
-                    (ct->ll.phi + (ct->lim.phi-1)*ct->del.phi) * RAD_TO_DEG );
+            if( PJ_LOG_ENABLED( ctx, PJ_LOG_DEBUG_MAJOR ) )
+                pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
+                        "Ctable %s %dx%d: LL=(%.9g,%.9g) UR=(%.9g,%.9g)\n",
+                        ct->id,
+                        ct->lim.lam, ct->lim.phi,
+                        ct->ll.lam * RAD_TO_DEG, ct->ll.phi * RAD_TO_DEG,
+                        (ct->ll.lam + (ct->lim.lam-1)*ct->del.lam) * RAD_TO_DEG,
+                        (ct->ll.phi + (ct->lim.phi-1)*ct->del.phi) * RAD_TO_DEG );
         }
     }
 
@@ -33,6 +33,7 @@
 #include <projects.h>
 #include <string.h>
 #include <math.h>
+#include <errno.h>
 
 #ifdef _WIN32_WCE
 /* assert.h includes all Windows API headers and causes 'LP' name clash.
@@ -46,6 +47,371 @@
 
 static PJ_GRIDINFO *grid_list = NULL;
 
+/* bumped every time the loaded grid list is torn down, so that grid
+** lists cached on PJ objects can notice their pointers went stale */
+static int grid_list_generation = 1;
+
+/************************************************************************/
+/*      Between teardowns the loaded grid list is append only, so       */
+/*      steady state lookups can walk it without taking any lock: a     */
+/*      writer (under the PJ_LOCK_GRIDS write lock) fully builds a      */
+/*      node via pj_gridinfo_init() before publishing it with a         */
+/*      release barrier, and a lock-free reader either sees the new     */
+/*      node complete or does not see it at all -- a miss simply        */
+/*      falls back to the write locked path.  The reader side relies    */
+/*      on data dependency ordering, which every platform we target     */
+/*      provides (only DEC Alpha reordered dependent loads).            */
+/*      pj_deallocate_grids() remains outside the bargain: as with      */
+/*      the grid lists cached on PJ handles, tearing the list down      */
+/*      while other threads transform has never been supported.         */
+/************************************************************************/
+
+static void pj_gridlist_publish( PJ_GRIDINFO **target, PJ_GRIDINFO *value )
+
+{
+#if defined(__GNUC__)
+    __sync_synchronize();
+#endif
+    /* MSVC gives volatile stores release semantics */
+    *(PJ_GRIDINFO * volatile *) target = value;
+}
+
+static PJ_GRIDINFO *pj_gridlist_read( PJ_GRIDINFO * const *target )
+
+{
+    return *(PJ_GRIDINFO * volatile const *) target;
+}
+
+/************************************************************************/
+/*      Grid name aliases.  When a name resolves to a physical file     */
+/*      (by device and inode) that is already on the loaded list        */
+/*      under another spelling, we record spelling -> canonical name    */
+/*      here instead of keeping a second copy of the payload.  The      */
+/*      list follows the same publish discipline as the grid list: a    */
+/*      node is completed before it is made visible, so lock-free       */
+/*      readers either see it whole or miss it and retry under the      */
+/*      write lock.                                                     */
+/************************************************************************/
+
+typedef struct pj_grid_alias {
+    char *gridname;         /* the spelling that was looked up */
+    const char *canonical;  /* gridname of the grid owning the payload;
+                               points into that node, which outlives us */
+    struct pj_grid_alias *next;
+} PJGridAlias;
+
+static PJGridAlias *grid_alias_list = NULL;
+
+static const char *pj_gridlist_alias_resolve( const char *gridname )
+
+{
+    PJGridAlias *al;
+
+    for( al = *(PJGridAlias * volatile *) &grid_alias_list;
+         al != NULL;
+         al = *(PJGridAlias * volatile *) &al->next )
+    {
+        if( strcmp( al->gridname, gridname ) == 0 )
+            return al->canonical;
+    }
+
+    return gridname;
+}
+
+/* called with the PJ_LOCK_GRIDS write lock held */
+static void pj_gridlist_alias_add( const char *gridname,
+                                   const char *canonical )
+
+{
+    PJGridAlias *al = (PJGridAlias *) pj_malloc( sizeof(PJGridAlias) );
+
+    if( al == NULL )
+        return;     /* harmless: the next lookup re-resolves */
+
+    al->gridname = strdup( gridname );
+    if( al->gridname == NULL )
+    {
+        pj_dalloc( al );
+        return;
+    }
+    al->canonical = canonical;
+    al->next = grid_alias_list;
+
+#if defined(__GNUC__)
+    __sync_synchronize();
+#endif
+    *(PJGridAlias * volatile *) &grid_alias_list = al;
+}
+
+/************************************************************************/
+/*                      pj_gridlist_generation()                        */
+/************************************************************************/
+
+int pj_gridlist_generation()
+
+{
+    return grid_list_generation;
+}
+
+/************************************************************************/
+/*                        Grid cache byte budget                        */
+/*                                                                      */
+/*      Long running processes that touch many regional grids           */
+/*      accumulate every loaded ct->cvs payload until process exit.     */
+/*      When a byte budget is set (PJ_GRID_CACHE_MAX in the             */
+/*      environment, or pj_set_grid_cache_max()), loading a grid        */
+/*      that pushes the total heap payload past the budget evicts       */
+/*      least recently used payloads first.  Only the shift values      */
+/*      are dropped - headers stay on the list - so the next access     */
+/*      transparently reloads through pj_gridinfo_load().  mmap'ed      */
+/*      payloads live in the shared page cache and are not counted.     */
+/*      All bookkeeping runs under the PJ_LOCK_GRIDS write lock;        */
+/*      grids pinned by an in-progress shift are never evicted.         */
+/************************************************************************/
+
+static long grid_cache_max = -1;        /* -1: environment not read yet */
+static long grid_cache_used = 0;
+static unsigned long grid_cache_clock = 0;
+
+/************************************************************************/
+/*                       pj_set_grid_cache_max()                        */
+/*                                                                      */
+/*      Set the grid payload byte budget.  Zero or negative disables    */
+/*      eviction (the historic behavior).                               */
+/************************************************************************/
+
+void pj_set_grid_cache_max( long bytes )
+
+{
+    grid_cache_max = bytes > 0 ? bytes : 0;
+}
+
+static long pj_grid_cache_get_max( void )
+
+{
+    if( grid_cache_max == -1 )
+    {
+        const char *max = getenv( "PJ_GRID_CACHE_MAX" );
+
+        grid_cache_max = max != NULL && atol(max) > 0 ? atol(max) : 0;
+    }
+    return grid_cache_max;
+}
+
+/************************************************************************/
+/*                        pj_grid_cache_touch()                         */
+/************************************************************************/
+
+void pj_grid_cache_touch( PJ_GRIDINFO *gi )
+
+{
+    gi->last_used = ++grid_cache_clock;
+}
+
+/************************************************************************/
+/*                      pj_grid_cache_find_lru()                        */
+/************************************************************************/
+
+static PJ_GRIDINFO *pj_grid_cache_find_lru( PJ_GRIDINFO *list,
+                                            PJ_GRIDINFO *keep,
+                                            PJ_GRIDINFO *best )
+
+{
+    PJ_GRIDINFO *gi;
+
+    for( gi = list; gi != NULL; gi = gi->next )
+    {
+        if( gi->cvs_size > 0 && gi->use_count == 0 && gi != keep
+            && (best == NULL || gi->last_used < best->last_used) )
+            best = gi;
+        if( gi->child != NULL )
+            best = pj_grid_cache_find_lru( gi->child, keep, best );
+    }
+    return best;
+}
+
+/************************************************************************/
+/*                      pj_grid_cache_evict_one()                       */
+/*                                                                      */
+/*      Drop the least recently used unpinned payload (keep, if         */
+/*      non-NULL, is exempt).  Must be called with the write lock       */
+/*      held.  Returns 0 when nothing evictable is left.                */
+/************************************************************************/
+
+static int pj_grid_cache_evict_one( projCtx ctx, PJ_GRIDINFO *keep )
+
+{
+    PJ_GRIDINFO *victim = pj_grid_cache_find_lru( grid_list, keep, NULL );
+
+    if( victim == NULL )
+        return 0;
+
+    pj_dalloc( victim->ct->cvs );
+    victim->ct->cvs = NULL;
+    victim->ct->win_row0 = 0;
+    victim->ct->win_rows = 0;
+    grid_cache_used -= victim->cvs_size;
+    victim->cvs_size = 0;
+    pj_log( ctx, PJ_LOG_DEBUG_MINOR,
+            "evicted grid %s (%ld bytes cached)",
+            victim->ct->id, grid_cache_used );
+    return 1;
+}
+
+/************************************************************************/
+/*                      pj_grid_cache_note_loaded()                     */
+/*                                                                      */
+/*      Account a freshly loaded heap payload and evict LRU payloads    */
+/*      while over budget.  Called with the write lock held.            */
+/************************************************************************/
+
+void pj_grid_cache_note_loaded( projCtx ctx, PJ_GRIDINFO *gi )
+
+{
+    long budget = pj_grid_cache_get_max();
+
+    if( gi->map_base == NULL && !gi->cvs_shm )
+    {
+        if( gi->ct->tiled )
+            gi->cvs_size = (long) sizeof(FLP) * gi->ct->tiles_lam
+                * ((gi->ct->lim.phi + CT_TILE_MASK) >> CT_TILE_SHIFT)
+                * CT_TILE * CT_TILE;
+        else if( gi->ct->packed )
+            gi->cvs_size = (long) sizeof(QLP)
+                * gi->ct->lim.lam * gi->ct->lim.phi
+                + 2 * (long) sizeof(FLP) * gi->ct->lim.phi;
+        else if( strcmp( gi->format, "gtx" ) == 0 )
+            gi->cvs_size = (long) sizeof(float) * gi->ct->lim.lam
+                * (gi->ct->win_rows > 0 ? gi->ct->win_rows
+                                        : gi->ct->lim.phi);
+        else
+            gi->cvs_size = (long) sizeof(FLP)
+                * gi->ct->lim.lam * gi->ct->lim.phi;
+        grid_cache_used += gi->cvs_size;
+    }
+    pj_grid_cache_touch( gi );
+
+    while( budget > 0 && grid_cache_used > budget )
+    {
+        if( !pj_grid_cache_evict_one( ctx, gi ) )
+            break;
+    }
+}
+
+/************************************************************************/
+/*                       pj_grid_cache_stats()                          */
+/*                                                                      */
+/*      Count and size of the resident heap payloads (mmap'ed and       */
+/*      shared arena payloads are not counted, as in the budget).       */
+/************************************************************************/
+
+static int pj_grid_cache_count( PJ_GRIDINFO *list )
+
+{
+    PJ_GRIDINFO *gi;
+    int count = 0;
+
+    for( gi = list; gi != NULL; gi = gi->next )
+    {
+        if( gi->cvs_size > 0 )
+            count++;
+        if( gi->child != NULL )
+            count += pj_grid_cache_count( gi->child );
+    }
+    return count;
+}
+
+long pj_grid_cache_stats( int *entries )
+
+{
+    long bytes;
+
+    pj_acquire_read_lock( PJ_LOCK_GRIDS );
+    *entries = pj_grid_cache_count( grid_list );
+    bytes = grid_cache_used;
+    pj_release_read_lock( PJ_LOCK_GRIDS );
+
+    return bytes;
+}
+
+/************************************************************************/
+/*                        pj_grid_cache_trim()                          */
+/*                                                                      */
+/*      Evict least recently used payloads until the resident total     */
+/*      fits in target_bytes, regardless of the configured budget.      */
+/*      Pinned grids are never touched, so the result may stay above    */
+/*      the target while shifts are in progress.  Returns the bytes     */
+/*      still held.                                                     */
+/************************************************************************/
+
+long pj_grid_cache_trim( projCtx ctx, long target_bytes )
+
+{
+    long bytes;
+
+    if( target_bytes < 0 )
+        target_bytes = 0;
+
+    pj_acquire_write_lock( PJ_LOCK_GRIDS );
+    while( grid_cache_used > target_bytes )
+    {
+        if( !pj_grid_cache_evict_one( ctx, NULL ) )
+            break;
+    }
+    bytes = grid_cache_used;
+    pj_release_write_lock( PJ_LOCK_GRIDS );
+
+    return bytes;
+}
+
+/************************************************************************/
+/*                      pj_grid_cache_note_freed()                      */
+/************************************************************************/
+
+void pj_grid_cache_note_freed( PJ_GRIDINFO *gi )
+
+{
+    if( gi->cvs_size > 0 )
+    {
+        grid_cache_used -= gi->cvs_size;
+        gi->cvs_size = 0;
+    }
+}
+
+/************************************************************************/
+/*                        pj_grid_cache_pin()                           */
+/*                                                                      */
+/*      Adjust the pin count of the listed grids and their subgrids     */
+/*      by delta (+1/-1), so payloads in active use by a shift          */
+/*      operation are not evicted by a concurrent load.                 */
+/************************************************************************/
+
+static void pj_grid_cache_pin_tree( PJ_GRIDINFO *gi, int delta )
+
+{
+    for( ; gi != NULL; gi = gi->next )
+    {
+        gi->use_count += delta;
+        if( gi->child != NULL )
+            pj_grid_cache_pin_tree( gi->child, delta );
+    }
+}
+
+void pj_grid_cache_pin( PJ_GRIDINFO **tables, int count, int delta )
+
+{
+    int i;
+
+    pj_acquire_write_lock( PJ_LOCK_GRIDS );
+    for( i = 0; i < count; i++ )
+    {
+        tables[i]->use_count += delta;
+        if( tables[i]->child != NULL )
+            pj_grid_cache_pin_tree( tables[i]->child, delta );
+    }
+    pj_release_write_lock( PJ_LOCK_GRIDS );
+}
+
 /************************************************************************/
 /*                        pj_deallocate_grids()                         */
 /*                                                                      */
@@ -55,6 +421,8 @@ static PJ_GRIDINFO *grid_list = NULL;
 void pj_deallocate_grids()
 
 {
+    pj_acquire_write_lock( PJ_LOCK_GRIDS );
+
     while( grid_list != NULL )
     {
         PJ_GRIDINFO *item = grid_list;
@@ -63,6 +431,19 @@ void pj_deallocate_grids()
 
         pj_gridinfo_free( pj_get_default_ctx(), item );
     }
+
+    while( grid_alias_list != NULL )
+    {
+        PJGridAlias *al = grid_alias_list;
+        grid_alias_list = al->next;
+
+        free( al->gridname );
+        pj_dalloc( al );
+    }
+
+    grid_list_generation++;
+
+    pj_release_write_lock( PJ_LOCK_GRIDS );
 }
 
 /************************************************************************/
@@ -72,22 +453,27 @@ void pj_deallocate_grids()
 /*      last_nadgrids_list.                                             */
 /************************************************************************/
 
-static int pj_gridlist_merge_gridfile( projCtx ctx, 
+static int pj_gridlist_merge_gridfile( projCtx ctx,
                                        const char *gridname,
                                        PJ_GRIDINFO ***p_gridlist,
-                                       int *p_gridcount, 
-                                       int *p_gridmax )
+                                       int *p_gridcount,
+                                       int *p_gridmax,
+                                       int lookup_only )
 
 {
     int got_match=0;
     PJ_GRIDINFO *this_grid, *tail = NULL;
 
+    gridname = pj_gridlist_alias_resolve( gridname );
+
 /* -------------------------------------------------------------------- */
 /*      Try to find in the existing list of loaded grids.  Add all      */
 /*      matching grids as with NTv2 we can get many grids from one      */
 /*      file (one shared gridname).                                     */
 /* -------------------------------------------------------------------- */
-    for( this_grid = grid_list; this_grid != NULL; this_grid = this_grid->next)
+    for( this_grid = pj_gridlist_read( &grid_list );
+         this_grid != NULL;
+         this_grid = pj_gridlist_read( &this_grid->next ) )
     {
         if( strcmp(this_grid->gridname,gridname) == 0 )
         {
@@ -126,6 +512,14 @@ static int pj_gridlist_merge_gridfile( projCtx ctx,
     if( got_match )
         return 1;
 
+/* -------------------------------------------------------------------- */
+/*      A lookup only pass (lock-free) must not load anything -         */
+/*      report the miss so the caller can retry with the write lock     */
+/*      held.                                                           */
+/* -------------------------------------------------------------------- */
+    if( lookup_only )
+        return -1;
+
 /* -------------------------------------------------------------------- */
 /*      Try to load the named grid.                                     */
 /* -------------------------------------------------------------------- */
@@ -137,17 +531,49 @@ static int pj_gridlist_merge_gridfile( projCtx ctx,
         assert( FALSE );
         return 0;
     }
-    
+
+/* -------------------------------------------------------------------- */
+/*      Same physical file already loaded under another spelling?       */
+/*      Alias this name to the loaded grid and drop the duplicate,      */
+/*      so its payload is shared instead of loaded a second time.       */
+/* -------------------------------------------------------------------- */
+    if( this_grid->ct != NULL && this_grid->has_ident )
+    {
+        PJ_GRIDINFO *other;
+
+        for( other = pj_gridlist_read( &grid_list );
+             other != NULL;
+             other = pj_gridlist_read( &other->next ) )
+        {
+            if( other->has_ident && other->ct != NULL
+                && other->ident_dev == this_grid->ident_dev
+                && other->ident_ino == this_grid->ident_ino )
+                break;
+        }
+
+        if( other != NULL )
+        {
+            pj_gridlist_alias_add( gridname, other->gridname );
+            pj_gridinfo_free( ctx, this_grid );
+            return pj_gridlist_merge_gridfile( ctx, other->gridname,
+                                               p_gridlist, p_gridcount,
+                                               p_gridmax, lookup_only );
+        }
+    }
+
+
+    /* the node (and any subgrids) is complete; publish it so that
+       lock-free readers only ever see finished entries */
     if( tail != NULL )
-        tail->next = this_grid;
+        pj_gridlist_publish( &tail->next, this_grid );
     else
-        grid_list = this_grid;
+        pj_gridlist_publish( &grid_list, this_grid );
 
 /* -------------------------------------------------------------------- */
 /*      Recurse to add the grid now that it is loaded.                  */
 /* -------------------------------------------------------------------- */
-    return pj_gridlist_merge_gridfile( ctx, gridname, p_gridlist, 
-                                       p_gridcount, p_gridmax );
+    return pj_gridlist_merge_gridfile( ctx, gridname, p_gridlist,
+                                       p_gridcount, p_gridmax, lookup_only );
 }
 
 /************************************************************************/
@@ -160,8 +586,11 @@ static int pj_gridlist_merge_gridfile( projCtx ctx,
 /*      the cost of building the list of tables each time.              */
 /************************************************************************/
 
-PJ_GRIDINFO **pj_gridlist_from_nadgrids( projCtx ctx, const char *nadgrids, 
-                                         int *grid_count)
+static PJ_GRIDINFO **pj_gridlist_nadgrids_pass( projCtx ctx,
+                                                const char *nadgrids,
+                                                int *grid_count,
+                                                int lookup_only,
+                                                int *p_missed )
 
 {
     const char *s;
@@ -170,8 +599,8 @@ PJ_GRIDINFO **pj_gridlist_from_nadgrids( projCtx ctx, const char *nadgrids,
 
     pj_errno = 0;
     *grid_count = 0;
-
-    pj_acquire_lock();
+    if( p_missed != NULL )
+        *p_missed = 0;
 
 /* -------------------------------------------------------------------- */
 /*      Loop processing names out of nadgrids one at a time.            */
@@ -180,6 +609,7 @@ PJ_GRIDINFO **pj_gridlist_from_nadgrids( projCtx ctx, const char *nadgrids,
     {
         int   end_char;
         int   required = 1;
+        int   result;
         char  name[128];
 
         if( *s == '@' )
@@ -188,17 +618,16 @@ PJ_GRIDINFO **pj_gridlist_from_nadgrids( projCtx ctx, const char *nadgrids,
             s++;
         }
 
-        for( end_char = 0; 
-             s[end_char] != '\0' && s[end_char] != ','; 
+        for( end_char = 0;
+             s[end_char] != '\0' && s[end_char] != ',';
              end_char++ ) {}
 
         if( end_char >= sizeof(name) )
         {
             pj_ctx_set_errno( ctx, -38 );
-            pj_release_lock();
             return NULL;
         }
-        
+
         strncpy( name, s, end_char );
         name[end_char] = '\0';
 
@@ -206,19 +635,172 @@ PJ_GRIDINFO **pj_gridlist_from_nadgrids( projCtx ctx, const char *nadgrids,
         if( *s == ',' )
             s++;
 
-        if( !pj_gridlist_merge_gridfile( ctx, name, &gridlist, grid_count, 
-                                         &grid_max) 
-            && required )
+        result = pj_gridlist_merge_gridfile( ctx, name, &gridlist, grid_count,
+                                             &grid_max, lookup_only );
+        if( result == -1 )
+        {
+            /* not in the loaded list - caller retries with write lock */
+            *p_missed = 1;
+            pj_dalloc( gridlist );
+            *grid_count = 0;
+            return NULL;
+        }
+
+        if( !result && required )
         {
             pj_ctx_set_errno( ctx, -38 );
-            pj_release_lock();
             return NULL;
         }
         else
             pj_errno = 0;
     }
 
-    pj_release_lock();
+    return gridlist;
+}
+
+PJ_GRIDINFO **pj_gridlist_from_nadgrids( projCtx ctx, const char *nadgrids,
+                                         int *grid_count)
+
+{
+    PJ_GRIDINFO **gridlist;
+    int missed = 0;
+
+/* -------------------------------------------------------------------- */
+/*      In steady state every named grid is already loaded, so try a    */
+/*      lock-free lookup only pass first: the list is append only       */
+/*      (see pj_gridlist_publish) so the walk needs no lock at all.     */
+/*      gridlist_locks consequently counts only passes that took the    */
+/*      grid lock, i.e. first loads.                                    */
+/* -------------------------------------------------------------------- */
+    gridlist = pj_gridlist_nadgrids_pass( ctx, nadgrids, grid_count,
+                                          1, &missed );
+
+    if( !missed )
+        return gridlist;
+
+/* -------------------------------------------------------------------- */
+/*      Some grid still needs loading - redo the whole scan with the    */
+/*      write lock held.                                                */
+/* -------------------------------------------------------------------- */
+    PJ_STAT_INC( ctx, gridlist_locks );
+    pj_acquire_write_lock( PJ_LOCK_GRIDS );
+    gridlist = pj_gridlist_nadgrids_pass( ctx, nadgrids, grid_count,
+                                          0, NULL );
+    pj_release_write_lock( PJ_LOCK_GRIDS );
 
     return gridlist;
 }
+
+/************************************************************************/
+/*                      pj_gridlist_preload_tree()                      */
+/*                                                                      */
+/*      Load the data of one grid and, for multi table formats like     */
+/*      NTv2, all of its subgrids.  Returns FALSE on load failure.      */
+/************************************************************************/
+
+static int pj_gridlist_preload_tree( projCtx ctx, PJ_GRIDINFO *gi )
+
+{
+    PJ_GRIDINFO *child;
+
+    if( !pj_gridinfo_load( ctx, gi ) )
+        return 0;
+
+    for( child = gi->child; child != NULL; child = child->next )
+    {
+        if( !pj_gridlist_preload_tree( ctx, child ) )
+            return 0;
+    }
+
+    return 1;
+}
+
+/************************************************************************/
+/*                        pj_ctx_preload_grids()                        */
+/*                                                                      */
+/*      Resolve and load the named grids up front, so the first         */
+/*      pj_transform() touching them does not pay the file i/o in       */
+/*      the middle of a conversion.  The argument uses the nadgrids     */
+/*      syntax (comma separated, @ marks an optional grid).  Grid       */
+/*      loading is serialized on the grid lock, so this may be called   */
+/*      from a warm-up thread while other threads transform.            */
+/*      Returns 0 on success or a (negative) error code.                */
+/************************************************************************/
+
+int pj_ctx_preload_grids( projCtx ctx, const char *grids )
+
+{
+    PJ_GRIDINFO **gridlist;
+    int grid_count = 0, i;
+
+    if( grids == NULL || *grids == '\0' )
+        return 0;
+
+    gridlist = pj_gridlist_from_nadgrids( ctx, grids, &grid_count );
+    if( gridlist == NULL )
+        return ctx->last_errno;
+
+    for( i = 0; i < grid_count; i++ )
+    {
+        if( !pj_gridlist_preload_tree( ctx, gridlist[i] ) )
+        {
+            pj_dalloc( gridlist );
+            pj_ctx_set_errno( ctx, -38 );
+            return -38;
+        }
+    }
+
+    pj_dalloc( gridlist );
+    return 0;
+}
+
+/************************************************************************/
+/*                  pj_ctx_preload_grids_background()                   */
+/*                                                                      */
+/*      As pj_ctx_preload_grids(), but the resolving and loading        */
+/*      happens on the shared worker pool so the caller returns at      */
+/*      once.  Load failures are only reported through the usual lazy   */
+/*      load path when a transform first needs the grid.  Returns 0     */
+/*      when the load was started (or ran inline with no pool           */
+/*      available), or a (negative) error code.                         */
+/************************************************************************/
+
+static void pj_preload_grids_worker( void *arg )
+
+{
+    char *grids = (char *) arg;
+    /* the requesting context is not thread safe, so resolve and load
+       through a private one carrying the default file api and logger */
+    projCtx ctx = pj_ctx_alloc();
+
+    pj_ctx_preload_grids( ctx, grids );
+
+    pj_ctx_free( ctx );
+    pj_dalloc( grids );
+}
+
+int pj_ctx_preload_grids_background( projCtx ctx, const char *grids )
+
+{
+    char *grids_dup;
+
+    if( grids == NULL || *grids == '\0' )
+        return 0;
+
+    grids_dup = (char *) pj_malloc( strlen(grids) + 1 );
+    if( grids_dup == NULL )
+    {
+        pj_ctx_set_errno( ctx, ENOMEM );
+        return ENOMEM;
+    }
+    strcpy( grids_dup, grids );
+
+    if( pj_tpool_submit( pj_preload_grids_worker, grids_dup ) != 0 )
+    {
+        /* no worker to delegate to: load inline as a plain preload */
+        pj_dalloc( grids_dup );
+        return pj_ctx_preload_grids( ctx, grids );
+    }
+
+    return 0;
+}
@@ -0,0 +1,280 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Context-level integer handle registry for FFI bindings.
+ *           Language layers (JNI, Python ctypes and the like) that are
+ *           not comfortable round-tripping raw PJ pointers through the
+ *           foreign type system register objects here and pass small
+ *           integers instead; lookup is O(1) and a generation counter
+ *           per slot turns use-after-free into a NULL result instead
+ *           of a dangling pointer.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** A handle encodes a slot number in its low bits and the slot's
+** generation above it (offset by one so 0 is never a valid handle).
+** Since the registry mints the handles itself no hashing or probing
+** is needed: lookup is an array index plus a generation compare.
+** Releasing a slot bumps its generation, so handles kept past the
+** object's life miss the compare and look up as NULL.  Generations
+** are narrow enough for 32 bit longs and eventually wrap; that only
+** weakens stale detection after ~2000 reuses of one slot.
+**
+** Like the rest of the context the table is not locked - a context
+** is meant to be confined to one thread.
+*/
+
+#define PJ_HANDLE_SLOT_BITS  20
+#define PJ_HANDLE_SLOT_MASK  ((1L << PJ_HANDLE_SLOT_BITS) - 1)
+#define PJ_HANDLE_GEN_MASK   0x7FFL
+
+#define PJ_HANDLE_INIT_SLOTS 64
+
+typedef struct {
+    PJ  *pj;
+    int  gen;
+    int  next_free;      /* free list link, -1 ends it, -2 when in use */
+} pjHandleSlot;
+
+typedef struct {
+    pjHandleSlot *slots;
+    int size;
+    int free_head;
+} pjHandleTable;
+
+/************************************************************************/
+/*                         pj_handle_table()                            */
+/*                                                                      */
+/*      Return the context's table, creating (or growing to at          */
+/*      least min_size) on demand.  NULL on allocation failure.         */
+/************************************************************************/
+
+static pjHandleTable *pj_handle_table( projCtx ctx, int min_size )
+
+{
+    pjHandleTable *table = (pjHandleTable *) ctx->handle_table;
+    pjHandleSlot  *slots;
+    int            i, size;
+
+    if( table == NULL )
+    {
+        table = (pjHandleTable *) pj_malloc( sizeof(pjHandleTable) );
+        if( table == NULL )
+            return NULL;
+        table->slots = NULL;
+        table->size = 0;
+        table->free_head = -1;
+        ctx->handle_table = table;
+    }
+
+    if( min_size <= table->size )
+        return table;
+
+    size = table->size == 0 ? PJ_HANDLE_INIT_SLOTS : table->size * 2;
+    while( size < min_size )
+        size *= 2;
+    if( size > PJ_HANDLE_SLOT_MASK + 1 )
+        return NULL;
+
+    slots = (pjHandleSlot *) pj_malloc( sizeof(pjHandleSlot) * size );
+    if( slots == NULL )
+        return NULL;
+    if( table->size > 0 )
+        memcpy( slots, table->slots, sizeof(pjHandleSlot) * table->size );
+
+    /* thread the new slots onto the free list, low numbers first */
+    for( i = size - 1; i >= table->size; i-- )
+    {
+        slots[i].pj = NULL;
+        slots[i].gen = 0;
+        slots[i].next_free = i == size - 1 ? table->free_head : i + 1;
+    }
+    table->free_head = table->size;
+
+    if( table->slots != NULL )
+        pj_dalloc( table->slots );
+    table->slots = slots;
+    table->size = size;
+
+    return table;
+}
+
+/************************************************************************/
+/*                        pj_handle_to_slot()                           */
+/*                                                                      */
+/*      Decode and validate a handle.  Returns the slot number, or      */
+/*      -1 for a handle that is malformed, stale or never issued.       */
+/************************************************************************/
+
+static int pj_handle_to_slot( projCtx ctx, long handle )
+
+{
+    pjHandleTable *table = (pjHandleTable *) ctx->handle_table;
+    int            slot;
+
+    if( table == NULL || handle <= 0 )
+        return -1;
+
+    handle -= 1;
+    slot = (int) (handle & PJ_HANDLE_SLOT_MASK);
+    if( slot >= table->size || table->slots[slot].next_free != -2 )
+        return -1;
+    if( table->slots[slot].gen !=
+        (int) ((handle >> PJ_HANDLE_SLOT_BITS) & PJ_HANDLE_GEN_MASK) )
+    {
+        if( PJ_LOG_ENABLED(ctx, PJ_LOG_ERROR) )
+            pj_log( ctx, PJ_LOG_ERROR,
+                    "stale object handle %ld (slot reused)", handle + 1 );
+        return -1;
+    }
+
+    return slot;
+}
+
+/************************************************************************/
+/*                      pj_ctx_handle_register()                        */
+/*                                                                      */
+/*      Register an object and return its handle (always positive).     */
+/*      Returns 0 on allocation failure or for a NULL object.           */
+/************************************************************************/
+
+long pj_ctx_handle_register( projCtx ctx, projPJ pj )
+
+{
+    pjHandleTable *table;
+    int            slot;
+
+    if( pj == NULL )
+        return 0;
+
+    table = pj_handle_table( ctx, 1 );
+    if( table == NULL )
+        return 0;
+    if( table->free_head == -1 )
+    {
+        table = pj_handle_table( ctx, table->size + 1 );
+        if( table == NULL )
+            return 0;
+    }
+
+    slot = table->free_head;
+    table->free_head = table->slots[slot].next_free;
+    table->slots[slot].pj = (PJ *) pj;
+    table->slots[slot].next_free = -2;
+
+    return ((long) table->slots[slot].gen << PJ_HANDLE_SLOT_BITS
+            | slot) + 1;
+}
+
+/************************************************************************/
+/*                       pj_ctx_handle_lookup()                         */
+/*                                                                      */
+/*      Return the object behind a handle, or NULL when the handle      */
+/*      is invalid or stale.                                            */
+/************************************************************************/
+
+projPJ pj_ctx_handle_lookup( projCtx ctx, long handle )
+
+{
+    int slot = pj_handle_to_slot( ctx, handle );
+
+    return slot == -1
+        ? NULL : (projPJ) ((pjHandleTable *) ctx->handle_table)
+            ->slots[slot].pj;
+}
+
+/************************************************************************/
+/*                      pj_ctx_handle_release()                         */
+/*                                                                      */
+/*      Unregister a handle, returning the object so the caller can     */
+/*      free it.  The slot's generation is bumped, so copies of the     */
+/*      handle held elsewhere turn stale immediately.                   */
+/************************************************************************/
+
+projPJ pj_ctx_handle_release( projCtx ctx, long handle )
+
+{
+    pjHandleTable *table = (pjHandleTable *) ctx->handle_table;
+    int            slot = pj_handle_to_slot( ctx, handle );
+    PJ            *pj;
+
+    if( slot == -1 )
+        return NULL;
+
+    pj = table->slots[slot].pj;
+    table->slots[slot].pj = NULL;
+    table->slots[slot].gen = (int)
+        (((long) table->slots[slot].gen + 1) & PJ_HANDLE_GEN_MASK);
+    table->slots[slot].next_free = table->free_head;
+    table->free_head = slot;
+
+    return (projPJ) pj;
+}
+
+/************************************************************************/
+/*                      pj_ctx_handle_validate()                        */
+/*                                                                      */
+/*      Batch validation for bindings: returns the index of the         */
+/*      first invalid or stale handle, or -1 when all of them are       */
+/*      live - one array sweep instead of a defensive round trip        */
+/*      per object.                                                     */
+/************************************************************************/
+
+int pj_ctx_handle_validate( projCtx ctx, const long *handles, int count )
+
+{
+    int i;
+
+    for( i = 0; i < count; i++ )
+        if( pj_handle_to_slot( ctx, handles[i] ) == -1 )
+            return i;
+
+    return -1;
+}
+
+/************************************************************************/
+/*                       pj_ctx_handles_free()                          */
+/*                                                                      */
+/*      Tear the table down with its context.  Registered objects       */
+/*      are not freed - the binding owns them.                          */
+/************************************************************************/
+
+void pj_ctx_handles_free( projCtx ctx )
+
+{
+    pjHandleTable *table = (pjHandleTable *) ctx->handle_table;
+
+    if( table == NULL )
+        return;
+    if( table->slots != NULL )
+        pj_dalloc( table->slots );
+    pj_dalloc( table );
+    ctx->handle_table = NULL;
+}
@@ -3,7 +3,7 @@
  *
  * Project:  PROJ.4
  * Purpose:  Initialize projection object from string definition.  Includes
- *           pj_init(), pj_init_plus() and pj_free() function.
+ *           pj_init(), pj_init_plus() and pj_free_now() function.
  * Author:   Gerald Evenden, Frank Warmerdam <warmerdam@pobox.com>
  *
  ******************************************************************************
@@ -36,12 +36,16 @@
 #include <errno.h>
 #include <locale.h>
 #include <ctype.h>
+#include <sys/stat.h>
 
 PJ_CVSID("$Id$");
 
 typedef struct {
     projCtx ctx;
     PAFile fid;
+    const char *mem;        /* when set, read from this blob, not fid */
+    size_t mem_size;
+    size_t mem_off;
     char buffer[8193];
     int buffer_filled;
     int at_eof;
@@ -81,8 +85,19 @@ static const char *fill_buffer(pj_read_state *state, const char *last_char)
 /*      Refill.                                                         */
 /* -------------------------------------------------------------------- */
     char_requested = sizeof(state->buffer) - state->buffer_filled - 1;
-    bytes_read = pj_ctx_fread( state->ctx, state->buffer + state->buffer_filled,
-                               1, char_requested, state->fid );
+    if (state->mem != NULL)
+    {
+        bytes_read = state->mem_size - state->mem_off;
+        if (bytes_read > (size_t) char_requested)
+            bytes_read = char_requested;
+        memcpy( state->buffer + state->buffer_filled,
+                state->mem + state->mem_off, bytes_read );
+        state->mem_off += bytes_read;
+    }
+    else
+        bytes_read = pj_ctx_fread( state->ctx,
+                                   state->buffer + state->buffer_filled,
+                                   1, char_requested, state->fid );
     if (bytes_read < char_requested)
     {
         state->at_eof = 1;
@@ -98,7 +113,7 @@ static const char *fill_buffer(pj_read_state *state, const char *last_char)
 /************************************************************************/
 static paralist *
 get_opt(projCtx ctx, paralist **start, PAFile fid, char *name, paralist *next,
-        int *found_def) {
+        int *found_def, const char *mem, size_t mem_size) {
     pj_read_state *state = (pj_read_state*) calloc(1,sizeof(pj_read_state));
     char sword[302];
     int len;
@@ -107,6 +122,8 @@ get_opt(projCtx ctx, paralist **start, PAFile fid, char *name, paralist *next,
 
     state->fid = fid;
     state->ctx = ctx;
+    state->mem = mem;
+    state->mem_size = mem_size;
     next_char = fill_buffer(state, NULL);
     if(found_def)
         *found_def = 0;
@@ -226,9 +243,9 @@ get_defaults(projCtx ctx, paralist **start, paralist *next, char *name) {
     PAFile fid;
 
     if ( (fid = pj_open_lib(ctx,"proj_def.dat", "rt")) != NULL) {
-        next = get_opt(ctx, start, fid, "general", next, NULL);
+        next = get_opt(ctx, start, fid, "general", next, NULL, NULL, 0);
         pj_ctx_fseek(ctx, fid, 0, SEEK_SET);
-        next = get_opt(ctx, start, fid, name, next, NULL);
+        next = get_opt(ctx, start, fid, name, next, NULL, NULL, 0);
         pj_ctx_fclose(ctx, fid);
     }
     if (errno)
@@ -248,6 +265,7 @@ get_init(projCtx ctx, paralist **start, paralist *next, char *name,
     PAFile fid;
     paralist *init_items = NULL;
     const paralist *orig_next = next;
+    long f_mtime = 0, f_size = -1;
 
     (void)strncpy(fname, name, MAX_PATH_FILENAME + ID_TAG_MAX + 1);
 	
@@ -258,6 +276,7 @@ get_init(projCtx ctx, paralist **start, paralist *next, char *name,
     init_items = pj_search_initcache( name );
     if( init_items != NULL )
     {
+        PJ_STAT_INC( ctx, initcache_hits );
         next->next = init_items;
         while( next->next != NULL )
             next = next->next;
@@ -268,12 +287,92 @@ get_init(projCtx ctx, paralist **start, paralist *next, char *name,
     /*
     ** Otherwise we try to open the file and search for it.
     */
+    PJ_STAT_INC( ctx, initcache_misses );
     if ((opt = strrchr(fname, ':')) != NULL)
         *opt++ = '\0';
     else { pj_ctx_set_errno(ctx,-3); return NULL; }
 
+    /* a registry compiled into the library image (PROJ_EMBED_INIT) is
+       consulted before the filesystem, so +init lookups against the
+       embedded files need no PROJ_LIB and no file I/O at all */
+    {
+        size_t embed_size = 0;
+        const char *embed = pj_init_embedded_find( fname, &embed_size );
+
+        if( embed != NULL )
+        {
+            long offset = 0;
+
+            if( pj_init_embedded_lookup( embed, embed_size, opt, &offset ) )
+            {
+                if( offset < 0 )
+                {
+                    /* definite miss - no section with this code */
+                    if (found_def)
+                        *found_def = 0;
+                    return next;
+                }
+            }
+            else
+                offset = 0;
+
+            next = get_opt(ctx, start, NULL, opt, next, found_def,
+                           embed + offset, embed_size - (size_t) offset);
+            if( next != NULL && next != orig_next )
+                pj_insert_initcache( name, orig_next->next );
+            return next;
+        }
+    }
+
     if ( (fid = pj_open_lib(ctx,fname, "rt")) != NULL)
-        next = get_opt(ctx, start, fid, opt, next, found_def);
+    {
+        long offset = 0;
+
+        /* the persistent cache (PJ_PLAN_CACHE directory) keeps the
+           expanded atoms keyed on the init file's identity, so a cold
+           process skips the section index scan and the parse */
+        {
+            int fd = pj_ctx_get_fd( ctx, fid );
+            struct stat sb;
+
+            if( fd >= 0 && fstat( fd, &sb ) == 0 )
+            {
+                f_mtime = (long) sb.st_mtime;
+                f_size = (long) sb.st_size;
+                init_items = pj_plancache_lookup( ctx, name,
+                                                  f_mtime, f_size );
+                if( init_items != NULL )
+                {
+                    pj_ctx_fclose( ctx, fid );
+                    pj_insert_initcache( name, init_items );
+                    next->next = init_items;
+                    while( next->next != NULL )
+                        next = next->next;
+                    *found_def = 1;
+                    return next;
+                }
+            }
+        }
+
+        /* consult the per file section index so we can seek straight
+           to the <code> section instead of scanning the whole file */
+        if (pj_init_index_lookup(ctx, fid, fname, opt, &offset))
+        {
+            if (offset < 0)
+            {
+                /* definite miss - no section with this code */
+                pj_ctx_fclose(ctx, fid);
+                if (found_def)
+                    *found_def = 0;
+                return next;
+            }
+            pj_ctx_fseek(ctx, fid, offset, SEEK_SET);
+        }
+        else
+            pj_ctx_fseek(ctx, fid, 0, SEEK_SET);
+
+        next = get_opt(ctx, start, fid, opt, next, found_def, NULL, 0);
+    }
     else
         return NULL;
     pj_ctx_fclose(ctx, fid);
@@ -285,7 +384,12 @@ get_init(projCtx ctx, paralist **start, paralist *next, char *name,
     ** init file cache.
     */
     if( next != NULL && next != orig_next )
+    {
         pj_insert_initcache( name, orig_next->next );
+        if( f_size >= 0 )
+            pj_plancache_store( ctx, name, f_mtime, f_size,
+                                orig_next->next );
+    }
 
     return next;
 }
@@ -305,6 +409,9 @@ pj_init_plus( const char *definition )
     return pj_init_plus_ctx( pj_get_default_ctx(), definition );
 }
 
+static paralist *pj_assemble_params( projCtx ctx, int argc, char **argv );
+static PJ *pj_setup( projCtx ctx, paralist *start );
+
 PJ *
 pj_init_plus_ctx( projCtx ctx, const char *definition )
 {
@@ -313,9 +420,18 @@ pj_init_plus_ctx( projCtx ctx, const char *definition )
     char	*defn_copy;
     int		argc = 0, i, blank_count = 0;
     PJ	    *result = NULL;
-    
-    /* make a copy that we can manipulate */
-    defn_copy = (char *) pj_malloc( strlen(definition)+1 );
+    paralist *cached;
+
+    /* check the definition cache first: a hit gives us the fully
+       assembled parameter list without re-splitting the string or
+       touching the init/defaults files again */
+    cached = pj_search_defcache( definition );
+    if( cached != NULL )
+        return pj_setup( ctx, cached );
+
+    /* make a copy that we can manipulate (pooled: cache misses on a
+       busy context should not hit the heap allocator) */
+    defn_copy = (char *) pj_ctx_buffer_get( ctx, strlen(definition)+1 );
     strcpy( defn_copy, definition );
 
     /* split into arguments based on '+' and trim white space */
@@ -363,10 +479,15 @@ pj_init_plus_ctx( projCtx ctx, const char *definition )
     defn_copy[i - blank_count] = '\0';
 
     /* perform actual initialization */
-    result = pj_init_ctx( ctx, argc, argv );
+    cached = pj_assemble_params( ctx, argc, argv );
+    if( cached != NULL )
+    {
+        pj_insert_defcache( definition, cached );
+        result = pj_setup( ctx, cached );
+    }
 
 bum_call:
-    pj_dalloc( defn_copy );
+    pj_ctx_buffer_put( ctx, defn_copy );
 
     return result;
 }
@@ -387,30 +508,163 @@ pj_init(int argc, char **argv) {
 
 PJ *
 pj_init_ctx(projCtx ctx, int argc, char **argv) {
-    char *s, *name;
+    paralist *start;
+
+    start = pj_assemble_params( ctx, argc, argv );
+    if (start == NULL)
+        return NULL;
+
+    return pj_setup( ctx, start );
+}
+
+/************************************************************************/
+/*                           pj_init_batch()                            */
+/*                                                                      */
+/*      Initialize a whole set of definitions at once - the multi       */
+/*      zone sweep case (every UTM or state plane zone touching a       */
+/*      continent).  Duplicate definition strings are initialized       */
+/*      once and the other slots filled with extra references to the    */
+/*      one shared object (pj_free() every slot as usual); unique       */
+/*      ones are parsed and set up in parallel on the worker thread     */
+/*      pool when it has more than one thread.  The shared pieces       */
+/*      below a definition - meridional and authalic series            */
+/*      coefficients, datum table entries, shift grids, init file       */
+/*      parameter lists - are already interned process wide, so the     */
+/*      zones come out sharing those whether or not they run in         */
+/*      parallel.  Failed slots are returned NULL while the rest of     */
+/*      the batch still initializes; the first failure's errno is       */
+/*      set on ctx and returned, 0 when every slot succeeded.           */
+/************************************************************************/
+
+typedef struct {
+    const char *definition;
+    PJ         *result;
+    int         errno_val;
+} pjInitBatchTask;
+
+static void pj_init_batch_worker( void *arg )
+
+{
+    pjInitBatchTask *task = (pjInitBatchTask *) arg;
+    /* thread local on threaded builds, so workers never share the
+       caller's context; the results are re-homed below */
+    projCtx work_ctx = pj_get_default_ctx();
+
+    pj_ctx_set_errno( work_ctx, 0 );
+    task->result = pj_init_plus_ctx( work_ctx, task->definition );
+    task->errno_val = pj_ctx_get_errno( work_ctx );
+}
+
+int pj_init_batch( projCtx ctx, const char **definitions, int n,
+                   projPJ *out )
+
+{
+    pjInitBatchTask *tasks = NULL;
+    void **args;
+    int *share;
+    int i, j, nunique = 0, first_errno = 0;
+
+    if( definitions == NULL || out == NULL || n < 1 )
+        return -1;
+    if( ctx == NULL )
+        ctx = pj_get_default_ctx();
+
+    if( n > 1 && pj_thread_pool_size() > 1 )
+        tasks = (pjInitBatchTask *) pj_malloc(
+            n * (sizeof(pjInitBatchTask) + sizeof(void *) + sizeof(int)) );
+
+    if( tasks == NULL )
+    {
+        /* serial path: no pool, a batch of one, or no scratch memory */
+        for( i = 0; i < n; i++ )
+        {
+            out[i] = NULL;
+            for( j = 0; j < i; j++ )
+            {
+                if( strcmp( definitions[j], definitions[i] ) == 0 )
+                {
+                    out[i] = pj_retain( out[j] );
+                    break;
+                }
+            }
+            if( j < i )
+                continue;
+
+            pj_ctx_set_errno( ctx, 0 );
+            out[i] = pj_init_plus_ctx( ctx, definitions[i] );
+            if( out[i] == NULL && first_errno == 0 )
+                first_errno = pj_ctx_get_errno( ctx );
+        }
+
+        pj_ctx_set_errno( ctx, first_errno );
+        return first_errno;
+    }
+
+    args = (void **) (tasks + n);
+    share = (int *) (args + n);
+
+    for( i = 0; i < n; i++ )
+    {
+        share[i] = -1;
+        for( j = 0; j < i; j++ )
+        {
+            if( share[j] < 0
+                && strcmp( definitions[j], definitions[i] ) == 0 )
+            {
+                share[i] = j;
+                break;
+            }
+        }
+        if( share[i] < 0 )
+        {
+            tasks[i].definition = definitions[i];
+            tasks[i].result = NULL;
+            tasks[i].errno_val = 0;
+            args[nunique++] = tasks + i;
+        }
+    }
+
+    pj_tpool_run( pj_init_batch_worker, args, nunique );
+
+    for( i = 0; i < n; i++ )
+    {
+        if( share[i] >= 0 )
+        {
+            out[i] = pj_retain( out[share[i]] );
+            continue;
+        }
+
+        out[i] = tasks[i].result;
+        if( out[i] != NULL )
+            pj_set_ctx( out[i], ctx );
+        else if( first_errno == 0 )
+            first_errno = tasks[i].errno_val != 0
+                ? tasks[i].errno_val : ENOMEM;
+    }
+
+    pj_dalloc( tasks );
+    pj_ctx_set_errno( ctx, first_errno );
+    return first_errno;
+}
+
+/************************************************************************/
+/*                         pj_assemble_params()                         */
+/*                                                                      */
+/*      Build the complete parameter list for a definition:  the        */
+/*      arguments themselves, plus any +init file entries and the       */
+/*      proj_def.dat defaults.  Returns NULL with the ctx errno set     */
+/*      on failure.  The result is what gets stored in the              */
+/*      definition cache.                                               */
+/************************************************************************/
+
+static paralist *
+pj_assemble_params( projCtx ctx, int argc, char **argv ) {
+    char *name;
     paralist *start = NULL;
-    PJ *(*proj)(PJ *);
     paralist *curr;
     int i;
-    PJ *PIN = 0;
-    char *old_locale;
 
     ctx->last_errno = 0;
-    start = NULL;
-
-    /*
-    ** MS Visual Studio 2012+ may have problems in multithreaded cases
-    ** as discussed in this ticket:
-    ** http://trac.osgeo.org/proj/ticket/226
-    */
-    old_locale = setlocale(LC_NUMERIC, NULL);
-    if (old_locale != NULL) {
-       if (strcmp(old_locale,"C") != 0) {
-	  old_locale = strdup(old_locale);
-	  setlocale(LC_NUMERIC,"C");
-       }else
-	  old_locale = NULL;
-    }
 
     /* put arguments into internal linked list */
     if (argc <= 0) { pj_ctx_set_errno( ctx, -1 ); goto bum_call; }
@@ -423,7 +677,6 @@ pj_init_ctx(projCtx ctx, int argc, char **argv) {
 
     /* check if +init present */
     if (pj_param(ctx, start, "tinit").i) {
-        paralist *last = curr;
         int found_def = 0;
 
         if (!(curr = get_init(ctx,&start, curr,
@@ -436,17 +689,97 @@ pj_init_ctx(projCtx ctx, int argc, char **argv) {
     /* find projection selection */
     if (!(name = pj_param(ctx, start, "sproj").s))
     { pj_ctx_set_errno( ctx, -4 ); goto bum_call; }
-    for (i = 0; (s = pj_list[i].id) && strcmp(name, s) ; ++i) ;
-    if (!s) { pj_ctx_set_errno( ctx, -5 ); goto bum_call; }
+    if (pj_registry_find(pj_list, sizeof(struct PJ_LIST), name) < 0)
+    { pj_ctx_set_errno( ctx, -5 ); goto bum_call; }
 
     /* set defaults, unless inhibited */
     if (!pj_param(ctx, start, "bno_defs").i)
         curr = get_defaults(ctx,&start, curr, name);
+
+    return start;
+
+bum_call:
+    pj_free_paralist(start);
+    return NULL;
+}
+
+/************************************************************************/
+/*                         pj_set_lazy_setup()                          */
+/*                                                                      */
+/*      With lazy setup enabled pj_setup() stops after the generic      */
+/*      parameter and ellipsoid handling and defers the projection      */
+/*      specific initialization (series derivation, table building)     */
+/*      to the first fwd/inv/factors call, so tooling that only wants   */
+/*      to enumerate or inspect definitions does not pay for            */
+/*      coefficient math it never uses.                                 */
+/************************************************************************/
+
+static volatile int lazy_setup_flag = -1;
+
+void pj_set_lazy_setup( int flag )
+
+{
+    lazy_setup_flag = flag;
+}
+
+static int pj_use_lazy_setup()
+
+{
+    if( lazy_setup_flag < 0 )
+        lazy_setup_flag = getenv( "PJ_LAZY_SETUP" ) != NULL;
+    return lazy_setup_flag;
+}
+
+/************************************************************************/
+/*                              pj_setup()                              */
+/*                                                                      */
+/*      Run projection setup over a fully assembled parameter list.     */
+/*      Takes ownership of the list, which ends up attached to the      */
+/*      returned PJ, or freed on failure.                               */
+/************************************************************************/
+
+static PJ *
+pj_setup( projCtx ctx, paralist *start ) {
+    char *s, *name;
+    const char *proj_name;
+    PJ *(*proj)(PJ *);
+    int i;
+    int defer = 0;
+    PJ *PIN = 0;
+    char *old_locale;
+
+    ctx->last_errno = 0;
+
+    /*
+    ** MS Visual Studio 2012+ may have problems in multithreaded cases
+    ** as discussed in this ticket:
+    ** http://trac.osgeo.org/proj/ticket/226
+    */
+    old_locale = setlocale(LC_NUMERIC, NULL);
+    if (old_locale != NULL) {
+       if (strcmp(old_locale,"C") != 0) {
+	  old_locale = strdup(old_locale);
+	  setlocale(LC_NUMERIC,"C");
+       }else
+	  old_locale = NULL;
+    }
+
+    /* index the list for the many lookups below; datum/ellps
+       expansions rebuild it themselves */
+    pj_param_index(start);
+
+    /* find projection selection */
+    if (!(name = pj_param(ctx, start, "sproj").s))
+    { pj_ctx_set_errno( ctx, -4 ); goto bum_call; }
+    i = pj_registry_find(pj_list, sizeof(struct PJ_LIST), name);
+    if (i < 0) { pj_ctx_set_errno( ctx, -5 ); goto bum_call; }
     proj = (PJ *(*)(PJ *)) pj_list[i].proj;
+    proj_name = name;
 
     /* allocate projection structure */
     if (!(PIN = (*proj)(0))) goto bum_call;
     PIN->ctx = ctx;
+    PIN->refcount = 1;
     PIN->params = start;
     PIN->is_latlong = 0;
     PIN->is_geocent = 0;
@@ -457,6 +790,7 @@ pj_init_ctx(projCtx ctx, int argc, char **argv) {
     PIN->gridlist = NULL;
     PIN->gridlist_count = 0;
 
+    PIN->geoidgrids = NULL;
     PIN->vgridlist_geoid = NULL;
     PIN->vgridlist_geoid_count = 0;
 
@@ -475,6 +809,15 @@ pj_init_ctx(projCtx ctx, int argc, char **argv) {
     if (PIN->one_es == 0.) { pj_ctx_set_errno( ctx, -6 ); goto bum_call; }
     PIN->rone_es = 1./PIN->one_es;
 
+    /* precompute the inverse conformal latitude series so pj_phi2_()
+       avoids the iterative pj_phi2() on moderate eccentricities; a ctx
+       approx tolerance widens the es range the series may serve */
+    PIN->has_phi2_apa = pj_phi2_pre_tol(PIN->es, PIN->phi2_apa,
+                                        ctx->approx_tol);
+
+    /* let projections install kernels specialized for common ellipsoids */
+    PIN->spec_ellps = pj_spec_ellps(PIN->es);
+
     /* Now that we have ellipse information check for WGS84 datum */
     if( PIN->datum_type == PJD_3PARAM 
         && PIN->datum_params[0] == 0.0
@@ -492,10 +835,16 @@ pj_init_ctx(projCtx ctx, int argc, char **argv) {
     /* over-ranging flag */
     PIN->over = pj_param(ctx, start, "bover").i;
 
-    /* vertical datum geoid grids */
+    /* vertical datum geoid grids: intern the list here so the shift
+       path never goes back to the parameter list */
     PIN->has_geoid_vgrids = pj_param(ctx, start, "tgeoidgrids").i;
-    if( PIN->has_geoid_vgrids ) /* we need to mark it as used. */
-        pj_param(ctx, start, "sgeoidgrids");
+    if( PIN->has_geoid_vgrids )
+    {
+        const char *geoidgrids = pj_param(ctx, start, "sgeoidgrids").s;
+
+        if( geoidgrids != NULL )
+            PIN->geoidgrids = strdup(geoidgrids);
+    }
 
     /* longitude center for wrapping */
     PIN->is_long_wrap_set = pj_param(ctx, start, "tlon_wrap").i;
@@ -553,9 +902,9 @@ pj_init_ctx(projCtx ctx, int argc, char **argv) {
 
     /* set units */
     s = 0;
-    if ((name = pj_param(ctx, start, "sunits").s) != NULL) { 
-        for (i = 0; (s = pj_units[i].id) && strcmp(name, s) ; ++i) ;
-        if (!s) { pj_ctx_set_errno( ctx, -7 ); goto bum_call; }
+    if ((name = pj_param(ctx, start, "sunits").s) != NULL) {
+        i = pj_registry_find(pj_units, sizeof(struct PJ_UNITS), name);
+        if (i < 0) { pj_ctx_set_errno( ctx, -7 ); goto bum_call; }
         s = pj_units[i].to_meter;
     }
     if (s || (s = pj_param(ctx, start, "sto_meter").s)) {
@@ -568,9 +917,9 @@ pj_init_ctx(projCtx ctx, int argc, char **argv) {
 
     /* set vertical units */
     s = 0;
-    if ((name = pj_param(ctx, start, "svunits").s) != NULL) { 
-        for (i = 0; (s = pj_units[i].id) && strcmp(name, s) ; ++i) ;
-        if (!s) { pj_ctx_set_errno( ctx, -7 ); goto bum_call; }
+    if ((name = pj_param(ctx, start, "svunits").s) != NULL) {
+        i = pj_registry_find(pj_units, sizeof(struct PJ_UNITS), name);
+        if (i < 0) { pj_ctx_set_errno( ctx, -7 ); goto bum_call; }
         s = pj_units[i].to_meter;
     }
     if (s || (s = pj_param(ctx, start, "svto_meter").s)) {
@@ -585,43 +934,65 @@ pj_init_ctx(projCtx ctx, int argc, char **argv) {
 
     /* prime meridian */
     s = 0;
-    if ((name = pj_param(ctx, start, "spm").s) != NULL) { 
-        const char *value = NULL;
+    if ((name = pj_param(ctx, start, "spm").s) != NULL) {
         char *next_str = NULL;
 
-        for (i = 0; pj_prime_meridians[i].id != NULL; ++i )
-        {
-            if( strcmp(name,pj_prime_meridians[i].id) == 0 )
-            {
-                value = pj_prime_meridians[i].defn;
-                break;
-            }
-        }
-            
-        if( value == NULL 
-            && (dmstor_ctx(ctx,name,&next_str) != 0.0  || *name == '0')
-            && *next_str == '\0' )
-            value = name;
-
-        if (!value) { pj_ctx_set_errno( ctx, -46 ); goto bum_call; }
-        PIN->from_greenwich = dmstor_ctx(ctx,value,NULL);
+        i = pj_registry_find(pj_prime_meridians,
+                             sizeof(struct PJ_PRIME_MERIDIANS), name);
+        if (i >= 0)
+            /* table offsets are converted to radians once, on first
+               use; repeated inits skip the DMS parse entirely */
+            PIN->from_greenwich = pj_prime_meridian_rad(ctx, i);
+        else if( (dmstor_ctx(ctx,name,&next_str) != 0.0  || *name == '0')
+                 && *next_str == '\0' )
+            PIN->from_greenwich = dmstor_ctx(ctx,name,NULL);
+        else { pj_ctx_set_errno( ctx, -46 ); goto bum_call; }
     }
     else
         PIN->from_greenwich = 0.0;
 
-    /* projection specific initialization */
-    if (!(PIN = (*proj)(PIN)) || ctx->last_errno) {
+    /* projection specific initialization, deferred to first use when
+       lazy setup is enabled.  The latlong/geocent pseudo projections
+       always run eagerly: their setup is trivial and it sets the
+       is_latlong/is_geocent flags the transform path steers by. */
+    if (pj_use_lazy_setup() && !ctx->last_errno) {
+        if (strcmp(proj_name, "latlong") && strcmp(proj_name, "longlat")
+            && strcmp(proj_name, "latlon") && strcmp(proj_name, "lonlat")
+            && strcmp(proj_name, "geocent")) {
+            PIN->setup_state = PJ_SETUP_PENDING;
+            PIN->setup_fn = proj;
+            defer = 1;
+        }
+    }
+    if (!defer && (!(PIN = (*proj)(PIN)) || ctx->last_errno)) {
       bum_call: /* cleanup error return */
         if (PIN)
             pj_free(PIN);
         else
-            for ( ; start; start = curr) {
-                curr = start->next;
-                pj_dalloc(start);
-            }
+            pj_free_paralist(start);
         PIN = 0;
     }
 
+    /* externally registered batch kernels override the built in ones
+       the ENTRY code just attached */
+    if (!defer && PIN != NULL)
+        pj_kernel_apply_overrides(PIN);
+
+    /* intern the canonical (sorted) definition so pj_transform() and
+       pj_is_same_definition() can cheaply recognize equivalent CRSes
+       regardless of the order the parameters were given in */
+    if (PIN != NULL) {
+        PIN->defn_canonical = pj_get_def_canonical(PIN);
+        if (PIN->defn_canonical != NULL) {
+            unsigned long hash = 5381;
+            const char *c;
+
+            for (c = PIN->defn_canonical; *c != '\0'; c++)
+                hash = hash * 33 + (unsigned char) *c;
+            PIN->defn_hash = hash;
+        }
+    }
+
     if (old_locale != NULL) {
        setlocale(LC_NUMERIC,old_locale);
        free( (char*)old_locale );
@@ -631,25 +1002,109 @@ pj_init_ctx(projCtx ctx, int argc, char **argv) {
 }
 
 /************************************************************************/
-/*                              pj_free()                               */
+/*                         pj_setup_finalize()                          */
 /*                                                                      */
-/*      This is the application callable entry point for destroying     */
-/*      a projection definition.  It does work generic to all           */
-/*      projection types, and then calls the projection specific        */
-/*      free function (P->pfree()) to do local work.  This maps to      */
-/*      the FREEUP code in the individual projection source files.      */
+/*      Run the projection specific setup a lazy pj_setup() deferred.   */
+/*      Returns 0 once the object is fully initialized, nonzero on a    */
+/*      setup failure (with the context errno set).  The E_ERROR        */
+/*      macros in the setup functions free the object outright on a     */
+/*      parameter error; since the caller still holds it, the           */
+/*      envelope is kept alive with a pj_dalloc() guard and left        */
+/*      behind as a failed object that keeps reporting the error.       */
+/*      The global lock makes the first use race free; once READY       */
+/*      the fast path is a single flag test.                            */
+/************************************************************************/
+
+static void pj_setup_failed_pfree( PJ *P )
+
+{
+    /* the setup's own freeup already released the projection local
+       allocations; only the guarded envelope remains */
+    pj_dalloc( P );
+}
+
+int pj_setup_finalize( PJ *P )
+
+{
+    PJ *r;
+    int saved_errno, guard_hit;
+
+    if (P->setup_state == PJ_SETUP_READY)
+        return 0;
+
+    pj_acquire_lock();
+
+    if (P->setup_state == PJ_SETUP_FAILED) {
+        pj_release_lock();
+        pj_ctx_set_errno( P->ctx, P->setup_errno );
+        return 1;
+    }
+    if (P->setup_state == PJ_SETUP_READY) {
+        pj_release_lock();
+        return 0;
+    }
+
+    saved_errno = P->ctx->last_errno;
+    P->ctx->last_errno = 0;
+
+    pj_dalloc_guard( P );
+    r = (*P->setup_fn)( P );
+    guard_hit = pj_dalloc_unguard();
+
+    if (r == NULL || P->ctx->last_errno) {
+        /* E_ERROR_0 paths free without an errno; they are
+           allocation failures */
+        if (P->ctx->last_errno == 0)
+            pj_ctx_set_errno( P->ctx, ENOMEM );
+        P->setup_errno = P->ctx->last_errno;
+        P->fwd = 0;
+        P->inv = 0;
+        P->fwd_batch = 0;
+        P->inv_batch = 0;
+        P->fwd_domain = 0;
+        P->inv_domain = 0;
+        P->spc = 0;
+        if (guard_hit)
+            P->pfree = pj_setup_failed_pfree;
+        P->setup_state = PJ_SETUP_FAILED;
+        pj_release_lock();
+        return 1;
+    }
+
+    P->ctx->last_errno = saved_errno;
+    pj_kernel_apply_overrides( P );
+#if defined(__GNUC__)
+    __sync_synchronize();
+#endif
+    P->setup_state = PJ_SETUP_READY;
+    pj_release_lock();
+    return 0;
+}
+
+/************************************************************************/
+/*                            pj_free_now()                             */
+/*                                                                      */
+/*      Immediate destruction of a projection definition.  It does      */
+/*      work generic to all projection types, and then calls the        */
+/*      projection specific free function (P->pfree()) to do local      */
+/*      work; this maps to the FREEUP code in the individual            */
+/*      projection source files.  Applications call pj_free() (in      */
+/*      pj_reclaim.c), which drops a reference and routes the last      */
+/*      drop here - possibly deferred until concurrent transform        */
+/*      threads have quiesced.                                          */
 /************************************************************************/
 
 void
-pj_free(PJ *P) {
+pj_free_now(PJ *P) {
     if (P) {
-        paralist *t = P->params, *n;
+        /* drop any pj_pool bookkeeping attached to the object */
+        pj_pool_note_free(P);
 
         /* free parameter list elements */
-        for (t = P->params; t; t = n) {
-            n = t->next;
-            pj_dalloc(t);
-        }
+        pj_free_paralist(P->params);
+
+        if( P->defn_canonical != NULL )
+            pj_dalloc( P->defn_canonical );
 
         /* free array of grid pointers if we have one */
         if( P->gridlist != NULL )
@@ -658,8 +1113,16 @@ pj_free(PJ *P) {
         if( P->vgridlist_geoid != NULL )
             pj_dalloc( P->vgridlist_geoid );
 
-        if( P->catalog != NULL )
-            pj_dalloc( P->catalog );
+        if( P->geoidgrids != NULL )
+            free( P->geoidgrids );
+
+        /* P->catalog is owned by the global catalog list - the PJ only
+           borrows a reference, so just drop our name for it */
+        if( P->catalog_name != NULL )
+            free( P->catalog_name );
+
+        if( P->nadgrids != NULL )
+            free( P->nadgrids );
 
         /* free projection parameters */
         P->pfree(P);
@@ -29,44 +29,294 @@
 
 #include <projects.h>
 #include <string.h>
+#include <stddef.h>
 
 PJ_CVSID("$Id: pj_transform.c 1504 2009-01-06 02:11:57Z warmerdam $");
 
+/*
+** The cache is a bounded open addressing hash table rather than the
+** old linear key array: lookups hash straight to their slot, and the
+** entry count is capped with least-recently-used eviction so the table
+** stays small no matter how many init keys a long lived process
+** touches.
+*/
+
+#define CACHE_ENTRY_MAX  64
+#define CACHE_SLOTS     128	/* twice the cap, power of two */
+
+typedef struct {
+    char *key;
+    paralist *list;
+    size_t list_size;		/* arena block size of list, for block copies */
+    unsigned long last_used;
+} pj_cache_entry;
+
+static pj_cache_entry *cache_tab = NULL;
 static int cache_count = 0;
-static int cache_alloc = 0;
-static char **cache_key = NULL;
-static paralist **cache_paralist = NULL;
+static unsigned long cache_clock = 0;
+
+/************************************************************************/
+/*                            pj_cache_hash()                           */
+/************************************************************************/
+
+static unsigned pj_cache_hash( const char *key )
+
+{
+    unsigned h = 2166136261u;
+
+    while( *key != '\0' )
+    {
+        h ^= (unsigned char) *key++;
+        h *= 16777619u;
+    }
+    return h & (CACHE_SLOTS-1);
+}
+
+/************************************************************************/
+/*                            pj_cache_find()                           */
+/*                                                                      */
+/*      Probe for the slot holding key, or the empty slot where it      */
+/*      would go.                                                       */
+/************************************************************************/
+
+static pj_cache_entry *pj_cache_find( const char *key )
+
+{
+    unsigned i = pj_cache_hash( key );
+
+    while( cache_tab[i].key != NULL
+           && strcmp( cache_tab[i].key, key ) != 0 )
+        i = (i+1) & (CACHE_SLOTS-1);
+
+    return cache_tab + i;
+}
+
+/************************************************************************/
+/*                           pj_cache_evict()                           */
+/*                                                                      */
+/*      Drop the least recently used entry and rehash the remainder     */
+/*      so probe chains stay intact.                                    */
+/************************************************************************/
+
+static void pj_cache_evict()
+
+{
+    pj_cache_entry *old_tab = cache_tab;
+    pj_cache_entry *lru = NULL;
+    int i;
+
+    for( i = 0; i < CACHE_SLOTS; i++ )
+    {
+        if( old_tab[i].key != NULL
+            && (lru == NULL || old_tab[i].last_used < lru->last_used) )
+            lru = old_tab + i;
+    }
+
+    if( lru == NULL )
+        return;
+
+    pj_dalloc( lru->key );
+    pj_free_paralist( lru->list );
+    lru->key = NULL;
+    lru->list = NULL;
+    cache_count--;
+
+    cache_tab = (pj_cache_entry *)
+        pj_malloc( sizeof(pj_cache_entry) * CACHE_SLOTS );
+    memset( cache_tab, 0, sizeof(pj_cache_entry) * CACHE_SLOTS );
+    for( i = 0; i < CACHE_SLOTS; i++ )
+    {
+        if( old_tab[i].key != NULL )
+            *(pj_cache_find( old_tab[i].key )) = old_tab[i];
+    }
+    pj_dalloc( old_tab );
+}
 
 /************************************************************************/
 /*                            pj_clone_paralist()                       */
 /*                                                                      */
-/*     Allocate a copy of a parameter list.                             */
+/*     Allocate a copy of a parameter list.  The copy lives in a        */
+/*     single arena block - one allocation for all nodes - which        */
+/*     pj_free_paralist() releases as one piece.                        */
 /************************************************************************/
 
+#define PARALIST_NODE_SIZE(param_len) \
+    ((offsetof(paralist,param) + (param_len) + 1 + 7) & ~((size_t) 7))
+
 paralist *pj_clone_paralist( const paralist *list)
 {
+  const paralist *l;
   paralist *list_copy = NULL, *next_copy = NULL;
+  size_t total = 0;
+  char *block;
 
-  for( ; list != NULL; list = list->next )
+  for( l = list; l != NULL; l = l->next )
+      total += PARALIST_NODE_SIZE(strlen(l->param));
+
+  if( total == 0 )
+      return NULL;
+
+  block = (char *) pj_malloc( total );
+  if( block == NULL )
+      return NULL;
+
+  for( l = list; l != NULL; l = l->next )
     {
-      paralist *newitem = (paralist *)
-	pj_malloc(sizeof(paralist) + strlen(list->param));
+      paralist *newitem = (paralist *) block;
 
       newitem->used = 0;
       newitem->next = 0;
-      strcpy( newitem->param, list->param );
-      
+      newitem->hash = 0;
+      newitem->arena = (list_copy == NULL) ? 2 : 1;
+      strcpy( newitem->param, l->param );
+
       if( list_copy == NULL )
 	list_copy = newitem;
       else
 	next_copy->next = newitem;
 
       next_copy = newitem;
+      block += PARALIST_NODE_SIZE(strlen(l->param));
     }
 
   return list_copy;
 }
 
+/************************************************************************/
+/*                        pj_paralist_block_size()                      */
+/*                                                                      */
+/*      Total arena size a pj_clone_paralist() copy of this list        */
+/*      occupies.                                                       */
+/************************************************************************/
+
+size_t pj_paralist_block_size( const paralist *list )
+{
+    size_t total = 0;
+
+    for( ; list != NULL; list = list->next )
+        total += PARALIST_NODE_SIZE(strlen(list->param));
+
+    return total;
+}
+
+/************************************************************************/
+/*                        pj_clone_paralist_block()                     */
+/*                                                                      */
+/*      Clone a list that is known to live in a single pristine arena   */
+/*      block of the given size with the chain in memory order - i.e.   */
+/*      a list built by pj_clone_paralist() and never attached to a     */
+/*      PJ, which is exactly what the definition caches hold.  The      */
+/*      copy is one memcpy plus a pointer rebase instead of a per       */
+/*      node walk re-copying every parameter string.                    */
+/************************************************************************/
+
+paralist *pj_clone_paralist_block( const paralist *list, size_t size )
+{
+    char *block;
+    ptrdiff_t delta;
+    paralist *copy, *node;
+
+    if( list == NULL || size == 0 )
+        return NULL;
+
+    block = (char *) pj_malloc( size );
+    if( block == NULL )
+        return NULL;
+
+    memcpy( block, list, size );
+    delta = block - (const char *) list;
+
+    copy = (paralist *) block;
+    for( node = copy; node != NULL; node = node->next )
+    {
+        if( node->next != NULL )
+            node->next = (paralist *) ((char *) node->next + delta);
+        /* hash is only ever set on lists attached to a PJ, and used
+           flags are still clear, so the memcpy carried them over
+           correctly */
+    }
+
+    return copy;
+}
+
+/************************************************************************/
+/*                           pj_cache_bytes()                           */
+/*                                                                      */
+/*      Heap bytes currently held by the cache.  Must be called         */
+/*      locked.                                                         */
+/************************************************************************/
+
+static long pj_cache_bytes()
+
+{
+    long bytes = 0;
+    int i;
+
+    if( cache_tab == NULL )
+        return 0;
+
+    bytes = (long) sizeof(pj_cache_entry) * CACHE_SLOTS;
+    for( i = 0; i < CACHE_SLOTS; i++ )
+    {
+        if( cache_tab[i].key == NULL )
+            continue;
+        bytes += (long) strlen(cache_tab[i].key) + 1
+            + (long) cache_tab[i].list_size;
+    }
+    return bytes;
+}
+
+/************************************************************************/
+/*                          pj_initcache_stats()                        */
+/************************************************************************/
+
+long pj_initcache_stats( int *entries )
+
+{
+    long bytes;
+
+    pj_acquire_read_lock( PJ_LOCK_INITCACHE );
+    *entries = cache_count;
+    bytes = pj_cache_bytes();
+    pj_release_read_lock( PJ_LOCK_INITCACHE );
+
+    return bytes;
+}
+
+/************************************************************************/
+/*                          pj_initcache_trim()                         */
+/*                                                                      */
+/*      Evict least recently used entries until the cache fits in       */
+/*      target_bytes; a target of zero (or less) clears it entirely.    */
+/*      Returns the bytes still held.                                   */
+/************************************************************************/
+
+long pj_initcache_trim( long target_bytes )
+
+{
+    long bytes;
+
+    if( target_bytes <= 0 )
+    {
+        pj_clear_initcache();
+        return 0;
+    }
+
+    pj_acquire_write_lock( PJ_LOCK_INITCACHE );
+    while( (bytes = pj_cache_bytes()) > target_bytes && cache_count > 0 )
+        pj_cache_evict();
+    pj_release_write_lock( PJ_LOCK_INITCACHE );
+
+    if( bytes > target_bytes )
+    {
+        /* even the emptied table is over target - drop it too */
+        pj_clear_initcache();
+        return 0;
+    }
+
+    return bytes;
+}
+
 /************************************************************************/
 /*                            pj_clear_initcache()                      */
 /*                                                                      */
@@ -75,33 +325,27 @@ paralist *pj_clone_paralist( const paralist *list)
 
 void pj_clear_initcache()
 {
-    if( cache_alloc > 0 )
+    if( cache_tab != NULL )
     {
         int i;
 
-        pj_acquire_lock();
+        pj_acquire_write_lock( PJ_LOCK_INITCACHE );
 
-        for( i = 0; i < cache_count; i++ )
+        for( i = 0; i < CACHE_SLOTS; i++ )
         {
-            paralist *n, *t = cache_paralist[i];
-		
-            pj_dalloc( cache_key[i] );
-
-            /* free parameter list elements */
-            for (; t != NULL; t = n) {
-                n = t->next;
-                pj_dalloc(t);
-            }
+            if( cache_tab[i].key == NULL )
+                continue;
+
+            pj_dalloc( cache_tab[i].key );
+            pj_free_paralist( cache_tab[i].list );
         }
 
-        pj_dalloc( cache_key );
-        pj_dalloc( cache_paralist );
+        pj_dalloc( cache_tab );
+        cache_tab = NULL;
         cache_count = 0;
-        cache_alloc= 0;
-        cache_key = NULL;
-        cache_paralist = NULL;
+        cache_clock = 0;
 
-        pj_release_lock();
+        pj_release_write_lock( PJ_LOCK_INITCACHE );
     }
 }
 
@@ -114,20 +358,25 @@ void pj_clear_initcache()
 paralist *pj_search_initcache( const char *filekey )
 
 {
-    int i;
     paralist *result = NULL;
 
-    pj_acquire_lock();
+    pj_acquire_read_lock( PJ_LOCK_INITCACHE );
 
-    for( i = 0; result == NULL && i < cache_count; i++)
+    if( cache_tab != NULL )
     {
-        if( strcmp(filekey,cache_key[i]) == 0 )
-	{
-            result = pj_clone_paralist( cache_paralist[i] );
-	}
+        pj_cache_entry *entry = pj_cache_find( filekey );
+
+        if( entry->key != NULL )
+        {
+            /* approximate LRU stamp - a stale value under concurrent
+               readers only blurs the eviction order */
+            entry->last_used = ++cache_clock;
+            result = pj_clone_paralist_block( entry->list,
+                                              entry->list_size );
+        }
     }
 
-    pj_release_lock();
+    pj_release_read_lock( PJ_LOCK_INITCACHE );
 
     return result;
 }
@@ -141,41 +390,40 @@ paralist *pj_search_initcache( const char *filekey )
 void pj_insert_initcache( const char *filekey, const paralist *list )
 
 {
-    pj_acquire_lock();
+    pj_cache_entry *entry;
 
-    /* 
-    ** Grow list if required.
-    */
-    if( cache_count == cache_alloc )
+    pj_acquire_write_lock( PJ_LOCK_INITCACHE );
+
+    if( cache_tab == NULL )
+    {
+        cache_tab = (pj_cache_entry *)
+            pj_malloc( sizeof(pj_cache_entry) * CACHE_SLOTS );
+        memset( cache_tab, 0, sizeof(pj_cache_entry) * CACHE_SLOTS );
+    }
+
+    entry = pj_cache_find( filekey );
+    if( entry->key != NULL )
+    {
+        /* lost a race with another inserter - keep the existing entry */
+        pj_release_write_lock( PJ_LOCK_INITCACHE );
+        return;
+    }
+
+    if( cache_count >= CACHE_ENTRY_MAX )
     {
-        char **cache_key_new;
-        paralist **cache_paralist_new;
-
-        cache_alloc = cache_alloc * 2 + 15;
-
-        cache_key_new = (char **) pj_malloc(sizeof(char*) * cache_alloc);
-        memcpy( cache_key_new, cache_key, sizeof(char*) * cache_count);
-        pj_dalloc( cache_key );
-        cache_key = cache_key_new;
-
-        cache_paralist_new = (paralist **) 
-            pj_malloc(sizeof(paralist*) * cache_alloc);
-        memcpy( cache_paralist_new, cache_paralist, 
-                sizeof(paralist*) * cache_count );
-        pj_dalloc( cache_paralist );
-        cache_paralist = cache_paralist_new;
+        pj_cache_evict();
+        entry = pj_cache_find( filekey );
     }
 
     /*
     ** Duplicate the filekey and paralist, and insert in cache.
     */
-    cache_key[cache_count] = (char *) pj_malloc(strlen(filekey)+1);
-    strcpy( cache_key[cache_count], filekey );
-
-    cache_paralist[cache_count] = pj_clone_paralist( list );
-
+    entry->key = (char *) pj_malloc(strlen(filekey)+1);
+    strcpy( entry->key, filekey );
+    entry->list = pj_clone_paralist( list );
+    entry->list_size = pj_paralist_block_size( list );
+    entry->last_used = ++cache_clock;
     cache_count++;
 
-    pj_release_lock();
+    pj_release_write_lock( PJ_LOCK_INITCACHE );
 }
-
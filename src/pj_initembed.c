@@ -0,0 +1,330 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Init files compiled into the library image.  When built with
+ *           PROJ_EMBED_INIT the generated pj_embedded_init.h carries the
+ *           raw bytes of selected init files (epsg, ...) as read only
+ *           data, and get_init() consults them before touching the
+ *           filesystem, so +init lookups need no PROJ_LIB at all.  A
+ *           section offset index per embedded file is built lazily on
+ *           first use, exactly like the on-disk index in pj_initindex.c.
+ *           Without the define the table is empty and every lookup
+ *           falls through to the regular file search.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2009, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+#include <stdlib.h>
+
+PJ_CVSID("$Id$");
+
+#define TAG_MAX 100
+
+typedef struct {
+    const char *name;
+    const char *data;
+    size_t size;
+} pj_embedded_file;
+
+#ifdef PROJ_EMBED_INIT
+#include "pj_embedded_init.h"
+static const pj_embedded_file embedded_files[] = PJ_EMBED_FILE_LIST;
+#define EMBEDDED_FILE_COUNT \
+    ((int) (sizeof(embedded_files) / sizeof(embedded_files[0])))
+#else
+static const pj_embedded_file *embedded_files = NULL;
+#define EMBEDDED_FILE_COUNT 0
+#endif
+
+typedef struct {
+    char *code;
+    long offset;	/* blob offset of the '<' of the section tag */
+} pj_embed_entry;
+
+typedef struct {
+    const char *data;	/* identifies the blob the index covers */
+    pj_embed_entry *entries;
+    int count;
+} pj_embed_index;
+
+static pj_embed_index *index_list = NULL;
+static int index_count = 0;
+static int index_alloc = 0;
+
+/************************************************************************/
+/*                       pj_init_embedded_find()                        */
+/*                                                                      */
+/*      Return the embedded copy of the named init file, or NULL        */
+/*      when the file is not compiled in.                               */
+/************************************************************************/
+
+const char *pj_init_embedded_find( const char *fname, size_t *size )
+
+{
+    int i;
+
+    for( i = 0; i < EMBEDDED_FILE_COUNT; i++ )
+    {
+        if( strcmp( embedded_files[i].name, fname ) == 0 )
+        {
+            if( size != NULL )
+                *size = embedded_files[i].size;
+            return embedded_files[i].data;
+        }
+    }
+    return NULL;
+}
+
+/************************************************************************/
+/*                        pj_embed_entry_cmp()                          */
+/************************************************************************/
+
+static int pj_embed_entry_cmp( const void *a, const void *b )
+
+{
+    const pj_embed_entry *ea = (const pj_embed_entry *) a;
+    const pj_embed_entry *eb = (const pj_embed_entry *) b;
+    int result = strcmp( ea->code, eb->code );
+
+    /* duplicate codes keep blob order so the first section wins,
+       matching a sequential scan */
+    if( result == 0 )
+        result = ea->offset < eb->offset ? -1 : 1;
+    return result;
+}
+
+/************************************************************************/
+/*                       pj_embed_index_build()                         */
+/*                                                                      */
+/*      One pass over the blob recording the offset of every <code>     */
+/*      section tag, skipping comments the way get_opt() does.          */
+/************************************************************************/
+
+static pj_embed_index *pj_embed_index_build( const char *data, size_t size )
+
+{
+    pj_embed_index *idx;
+    pj_embed_entry *entries = NULL;
+    int count = 0, alloc = 0;
+    char tag[TAG_MAX+1];
+    int tag_len = 0;
+    int state = 0;	/* 0=normal, 1=comment, 2=in tag */
+    long tag_offset = 0;
+    size_t i;
+
+    for( i = 0; i < size; i++ )
+    {
+        char c = data[i];
+
+        if( state == 1 )
+        {
+            if( c == '\n' )
+                state = 0;
+        }
+        else if( state == 2 )
+        {
+            if( c == '>' )
+            {
+                state = 0;
+                if( tag_len > 0 )
+                {
+                    if( count == alloc )
+                    {
+                        pj_embed_entry *new_entries;
+
+                        alloc = alloc * 2 + 100;
+                        new_entries = (pj_embed_entry *)
+                            pj_malloc( sizeof(pj_embed_entry) * alloc );
+                        if( new_entries == NULL )
+                            goto error;
+                        memcpy( new_entries, entries,
+                                sizeof(pj_embed_entry) * count );
+                        pj_dalloc( entries );
+                        entries = new_entries;
+                    }
+                    tag[tag_len] = '\0';
+                    entries[count].code =
+                        (char *) pj_malloc( tag_len + 1 );
+                    if( entries[count].code == NULL )
+                        goto error;
+                    strcpy( entries[count].code, tag );
+                    entries[count].offset = tag_offset;
+                    count++;
+                }
+            }
+            else if( tag_len < TAG_MAX )
+                tag[tag_len++] = c;
+            else
+                state = 0;	/* oversize, not a section tag */
+        }
+        else if( c == '#' )
+            state = 1;
+        else if( c == '<' )
+        {
+            state = 2;
+            tag_len = 0;
+            tag_offset = (long) i;
+        }
+    }
+
+    if( count > 0 )
+        qsort( entries, count, sizeof(pj_embed_entry), pj_embed_entry_cmp );
+
+    idx = (pj_embed_index *) pj_malloc( sizeof(pj_embed_index) );
+    if( idx == NULL )
+        goto error;
+    idx->data = data;
+    idx->entries = entries;
+    idx->count = count;
+    return idx;
+
+error:
+    while( count > 0 )
+        pj_dalloc( entries[--count].code );
+    pj_dalloc( entries );
+    return NULL;
+}
+
+/************************************************************************/
+/*                        pj_embed_index_find()                         */
+/************************************************************************/
+
+static pj_embed_index *pj_embed_index_find( const char *data )
+
+{
+    int i;
+
+    for( i = 0; i < index_count; i++ )
+    {
+        if( index_list[i].data == data )
+            return index_list + i;
+    }
+    return NULL;
+}
+
+/************************************************************************/
+/*                       pj_embed_index_search()                        */
+/*                                                                      */
+/*      Binary search, stepping back to the first of any duplicate      */
+/*      codes so the earliest section in the blob wins.  Must be        */
+/*      called with the index locked.                                   */
+/************************************************************************/
+
+static long pj_embed_index_search( const pj_embed_index *idx,
+                                   const char *code )
+
+{
+    int lo = 0, hi = idx->count - 1;
+
+    while( lo <= hi )
+    {
+        int mid = (lo + hi) / 2;
+        int result = strcmp( idx->entries[mid].code, code );
+
+        if( result < 0 )
+            lo = mid + 1;
+        else if( result > 0 )
+            hi = mid - 1;
+        else
+        {
+            while( mid > 0
+                   && strcmp( idx->entries[mid-1].code, code ) == 0 )
+                mid--;
+            return idx->entries[mid].offset;
+        }
+    }
+    return -1;
+}
+
+/************************************************************************/
+/*                      pj_init_embedded_lookup()                       */
+/*                                                                      */
+/*      Find the blob offset of the <code> section in the given         */
+/*      embedded init file, building and caching the per blob index     */
+/*      on first use.  Returns TRUE when an index is available, with    */
+/*      *offset set to the section position, or -1 if the code does     */
+/*      not appear in the blob at all.  Returns FALSE when no index     */
+/*      could be built, in which case the caller should fall back       */
+/*      to a full scan.                                                 */
+/************************************************************************/
+
+int pj_init_embedded_lookup( const char *data, size_t size,
+                             const char *code, long *offset )
+
+{
+    pj_embed_index *idx;
+    pj_embed_index *fresh;
+
+    pj_acquire_read_lock( PJ_LOCK_INITCACHE );
+    idx = pj_embed_index_find( data );
+    if( idx != NULL )
+    {
+        *offset = pj_embed_index_search( idx, code );
+        pj_release_read_lock( PJ_LOCK_INITCACHE );
+        return 1;
+    }
+    pj_release_read_lock( PJ_LOCK_INITCACHE );
+
+    fresh = pj_embed_index_build( data, size );
+    if( fresh == NULL )
+        return 0;
+
+    pj_acquire_write_lock( PJ_LOCK_INITCACHE );
+    idx = pj_embed_index_find( data );
+    if( idx != NULL )
+    {
+        /* lost a race with another builder - keep theirs */
+        int i;
+
+        for( i = 0; i < fresh->count; i++ )
+            pj_dalloc( fresh->entries[i].code );
+        pj_dalloc( fresh->entries );
+        pj_dalloc( fresh );
+    }
+    else
+    {
+        if( index_count == index_alloc )
+        {
+            pj_embed_index *new_list;
+
+            index_alloc = index_alloc * 2 + 4;
+            new_list = (pj_embed_index *)
+                pj_malloc( sizeof(pj_embed_index) * index_alloc );
+            memcpy( new_list, index_list,
+                    sizeof(pj_embed_index) * index_count );
+            pj_dalloc( index_list );
+            index_list = new_list;
+        }
+        index_list[index_count] = *fresh;
+        pj_dalloc( fresh );
+        idx = index_list + index_count;
+        index_count++;
+    }
+    *offset = pj_embed_index_search( idx, code );
+    pj_release_write_lock( PJ_LOCK_INITCACHE );
+
+    return 1;
+}
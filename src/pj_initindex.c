@@ -0,0 +1,306 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Section offset index for init files (epsg, esri, IGNF, ...).
+ *           get_init() used to scan the whole file character by character
+ *           for every code looked up; the index is built with a single
+ *           scan per file the first time the file is consulted and then
+ *           lets lookups seek straight to their <code> section.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2009, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+#include <stdlib.h>
+
+PJ_CVSID("$Id$");
+
+#define TAG_MAX 100
+
+typedef struct {
+    char *code;
+    long offset;	/* file offset of the '<' of the section tag */
+} pj_init_entry;
+
+typedef struct {
+    char *fname;
+    pj_init_entry *entries;
+    int count;
+} pj_init_index;
+
+static pj_init_index *index_list = NULL;
+static int index_count = 0;
+static int index_alloc = 0;
+
+/************************************************************************/
+/*                         pj_init_entry_cmp()                          */
+/************************************************************************/
+
+static int pj_init_entry_cmp( const void *a, const void *b )
+
+{
+    const pj_init_entry *ea = (const pj_init_entry *) a;
+    const pj_init_entry *eb = (const pj_init_entry *) b;
+    int result = strcmp( ea->code, eb->code );
+
+    /* duplicate codes keep file order so the first section wins,
+       matching a sequential scan */
+    if( result == 0 )
+        result = ea->offset < eb->offset ? -1 : 1;
+    return result;
+}
+
+/************************************************************************/
+/*                        pj_init_index_build()                         */
+/*                                                                      */
+/*      Scan the open file once, recording the offset of every          */
+/*      <code> section tag.  Comments are skipped the same way          */
+/*      get_opt() skips them.                                           */
+/************************************************************************/
+
+static pj_init_index *pj_init_index_build( projCtx ctx, PAFile fid,
+                                           const char *fname )
+
+{
+    pj_init_index *idx;
+    pj_init_entry *entries = NULL;
+    int count = 0, alloc = 0;
+    char buffer[8192];
+    char tag[TAG_MAX+1];
+    int tag_len = 0;
+    long base_offset = 0;
+    size_t bytes_read;
+    int state = 0;	/* 0=normal, 1=comment, 2=in tag */
+    long tag_offset = 0;
+
+    pj_ctx_fseek( ctx, fid, 0, SEEK_SET );
+
+    while( (bytes_read = pj_ctx_fread( ctx, buffer, 1, sizeof(buffer),
+                                       fid )) > 0 )
+    {
+        size_t i;
+
+        for( i = 0; i < bytes_read; i++ )
+        {
+            char c = buffer[i];
+
+            if( state == 1 )
+            {
+                if( c == '\n' )
+                    state = 0;
+            }
+            else if( state == 2 )
+            {
+                if( c == '>' )
+                {
+                    state = 0;
+                    if( tag_len > 0 )
+                    {
+                        if( count == alloc )
+                        {
+                            pj_init_entry *new_entries;
+
+                            alloc = alloc * 2 + 100;
+                            new_entries = (pj_init_entry *)
+                                pj_malloc( sizeof(pj_init_entry) * alloc );
+                            if( new_entries == NULL )
+                                goto error;
+                            memcpy( new_entries, entries,
+                                    sizeof(pj_init_entry) * count );
+                            pj_dalloc( entries );
+                            entries = new_entries;
+                        }
+                        tag[tag_len] = '\0';
+                        entries[count].code =
+                            (char *) pj_malloc( tag_len + 1 );
+                        if( entries[count].code == NULL )
+                            goto error;
+                        strcpy( entries[count].code, tag );
+                        entries[count].offset = tag_offset;
+                        count++;
+                    }
+                }
+                else if( tag_len < TAG_MAX )
+                    tag[tag_len++] = c;
+                else
+                    state = 0;	/* oversize, not a section tag */
+            }
+            else if( c == '#' )
+                state = 1;
+            else if( c == '<' )
+            {
+                state = 2;
+                tag_len = 0;
+                tag_offset = base_offset + (long) i;
+            }
+        }
+
+        base_offset += (long) bytes_read;
+    }
+
+    if( count > 0 )
+        qsort( entries, count, sizeof(pj_init_entry), pj_init_entry_cmp );
+
+    idx = (pj_init_index *) pj_malloc( sizeof(pj_init_index) );
+    if( idx == NULL )
+        goto error;
+    idx->fname = (char *) pj_malloc( strlen(fname) + 1 );
+    if( idx->fname == NULL )
+    {
+        pj_dalloc( idx );
+        goto error;
+    }
+    strcpy( idx->fname, fname );
+    idx->entries = entries;
+    idx->count = count;
+    return idx;
+
+error:
+    while( count > 0 )
+        pj_dalloc( entries[--count].code );
+    pj_dalloc( entries );
+    return NULL;
+}
+
+/************************************************************************/
+/*                        pj_init_index_find()                          */
+/************************************************************************/
+
+static pj_init_index *pj_init_index_find( const char *fname )
+
+{
+    int i;
+
+    for( i = 0; i < index_count; i++ )
+    {
+        if( strcmp( index_list[i].fname, fname ) == 0 )
+            return index_list + i;
+    }
+    return NULL;
+}
+
+/************************************************************************/
+/*                       pj_init_index_search()                         */
+/*                                                                      */
+/*      Binary search, stepping back to the first of any duplicate      */
+/*      codes so the earliest section in the file wins.  Must be        */
+/*      called with the index locked.                                   */
+/************************************************************************/
+
+static long pj_init_index_search( const pj_init_index *idx,
+                                  const char *code )
+
+{
+    int lo = 0, hi = idx->count - 1;
+
+    while( lo <= hi )
+    {
+        int mid = (lo + hi) / 2;
+        int result = strcmp( idx->entries[mid].code, code );
+
+        if( result < 0 )
+            lo = mid + 1;
+        else if( result > 0 )
+            hi = mid - 1;
+        else
+        {
+            while( mid > 0
+                   && strcmp( idx->entries[mid-1].code, code ) == 0 )
+                mid--;
+            return idx->entries[mid].offset;
+        }
+    }
+    return -1;
+}
+
+/************************************************************************/
+/*                       pj_init_index_lookup()                         */
+/*                                                                      */
+/*      Find the file offset of the <code> section in the given init    */
+/*      file, building and caching the per file index on first use.     */
+/*      Returns TRUE when an index is available, with *offset set to    */
+/*      the section position, or -1 if the code does not appear in      */
+/*      the file at all.  Returns FALSE when no index could be built,   */
+/*      in which case the caller should fall back to a full scan.       */
+/************************************************************************/
+
+int pj_init_index_lookup( projCtx ctx, PAFile fid, const char *fname,
+                          const char *code, long *offset )
+
+{
+    pj_init_index *idx;
+    pj_init_index *fresh;
+
+    pj_acquire_read_lock( PJ_LOCK_INITCACHE );
+    idx = pj_init_index_find( fname );
+    if( idx != NULL )
+    {
+        *offset = pj_init_index_search( idx, code );
+        pj_release_read_lock( PJ_LOCK_INITCACHE );
+        return 1;
+    }
+    pj_release_read_lock( PJ_LOCK_INITCACHE );
+
+    fresh = pj_init_index_build( ctx, fid, fname );
+    if( fresh == NULL )
+        return 0;
+
+    pj_acquire_write_lock( PJ_LOCK_INITCACHE );
+    idx = pj_init_index_find( fname );
+    if( idx != NULL )
+    {
+        /* lost a race with another builder - keep theirs */
+        int i;
+
+        for( i = 0; i < fresh->count; i++ )
+            pj_dalloc( fresh->entries[i].code );
+        pj_dalloc( fresh->entries );
+        pj_dalloc( fresh->fname );
+        pj_dalloc( fresh );
+    }
+    else
+    {
+        if( index_count == index_alloc )
+        {
+            pj_init_index *new_list;
+
+            index_alloc = index_alloc * 2 + 4;
+            new_list = (pj_init_index *)
+                pj_malloc( sizeof(pj_init_index) * index_alloc );
+            memcpy( new_list, index_list,
+                    sizeof(pj_init_index) * index_count );
+            pj_dalloc( index_list );
+            index_list = new_list;
+        }
+        index_list[index_count] = *fresh;
+        pj_dalloc( fresh );
+        idx = index_list + index_count;
+        index_count++;
+    }
+    *offset = pj_init_index_search( idx, code );
+    pj_release_write_lock( PJ_LOCK_INITCACHE );
+
+    return 1;
+}
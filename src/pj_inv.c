@@ -6,6 +6,12 @@
 	LP /* inverse projection entry */
 pj_inv(XY xy, PJ *P) {
 	LP lp;
+	int *err_addr;
+
+	if (P->setup_state != PJ_SETUP_READY && pj_setup_finalize(P)) {
+		lp.lam = lp.phi = HUGE_VAL;
+		return lp;
+	}
 
 	/* can't do as much preliminary checking as with forward */
 	if (xy.x == HUGE_VAL || xy.y == HUGE_VAL) {
@@ -14,13 +20,19 @@ pj_inv(XY xy, PJ *P) {
                 return lp;
 	}
 
-	errno = pj_errno = 0;
-        P->ctx->last_errno = 0;
+	/* the thread's diagnostics slot when one is active, else the
+	** shared ctx field; the globals are only zeroed alongside the
+	** latter, so diagnostics scopes never touch shared state */
+	err_addr = pj_diag_errno_addr(P->ctx);
+	if (*err_addr != 0)
+		*err_addr = 0;
+	if (err_addr == &P->ctx->last_errno)
+		errno = pj_errno = 0;
 
 	xy.x = (xy.x * P->to_meter - P->x0) * P->ra; /* descale and de-offset */
 	xy.y = (xy.y * P->to_meter - P->y0) * P->ra;
-	lp = (*P->inv)(xy, P); /* inverse project */
-	if (P->ctx->last_errno )
+	lp = PJ_INV_SPECULATE(xy, P); /* inverse project */
+	if (*err_addr )
 		lp.lam = lp.phi = HUGE_VAL;
 	else {
 		lp.lam += P->lam0; /* reduce from del lp.lam */
@@ -31,3 +43,242 @@ pj_inv(XY xy, PJ *P) {
 	}
 	return lp;
 }
+
+# define PJ_DOMAIN_CHUNK 16384
+
+	static int /* run the batch kernel over the in-domain points of a
+	** mixed validity array by gathering them into contiguous scratch
+	** chunks; returns 0 when no scratch is available and the caller
+	** must fall back to the scalar loop */
+pj_inv_batch_compact(PJ *P, long point_count, double *lam, double *phi) {
+	double *gx, *gy;
+	long done;
+
+	gx = (double *) pj_ctx_buffer_get(P->ctx,
+		sizeof(double) * 2 * PJ_DOMAIN_CHUNK);
+	if (gx == NULL)
+		return 0;
+	gy = gx + PJ_DOMAIN_CHUNK;
+
+	for (done = 0; done < point_count; ) {
+		long chunk = point_count - done;
+		long i, ngood = 0;
+
+		if (chunk > PJ_DOMAIN_CHUNK)
+			chunk = PJ_DOMAIN_CHUNK;
+
+		for (i = 0; i < chunk; ++i) {
+			if (lam[done + i] == HUGE_VAL)
+				continue;
+			gx[ngood] = lam[done + i];
+			gy[ngood] = phi[done + i];
+			++ngood;
+		}
+
+		if (ngood == chunk)
+			(*P->inv_batch)(lam + done, phi + done,
+				lam + done, phi + done, chunk, P);
+		else if (ngood > 0) {
+			(*P->inv_batch)(gx, gy, gx, gy, ngood, P);
+			for (i = 0, ngood = 0; i < chunk; ++i) {
+				if (lam[done + i] == HUGE_VAL)
+					continue;
+				lam[done + i] = gx[ngood];
+				phi[done + i] = gy[ngood];
+				++ngood;
+			}
+		}
+		done += chunk;
+	}
+
+	pj_ctx_buffer_put(P->ctx, gx);
+	return 1;
+}
+
+	static long /* worker shared by the errno and quiet batch entries,
+	** returns the number of invalid output points */
+pj_inv_batch_work(PJ *P, long point_count, const double *x, const double *y,
+	double *lam, double *phi) {
+	long i, nbad = 0;
+	int has_bad_points = 0;
+	double sx, bx, by;
+
+	if (P->setup_state != PJ_SETUP_READY && pj_setup_finalize(P)) {
+		for (i = 0; i < point_count; ++i)
+			lam[i] = phi[i] = HUGE_VAL;
+		return point_count;
+	}
+
+	sx = P->to_meter * P->ra;
+	bx = P->x0 * P->ra;
+	by = P->y0 * P->ra;
+
+	/* affine-class projections (eqc, the latlong stub): the kernel is
+	** a pure scale and shift, so the descale, kernel and longitude
+	** reduction fold into this one pass and the projection becomes
+	** memory bound instead of scaffold bound.  The arithmetic is kept
+	** staged exactly as in the separate passes below so the results
+	** match them bit for bit; adjlon() early-outs for the usual in
+	** range longitudes */
+	if (P->kernel_affine && !P->geoc && P->inv_domain == NULL &&
+			pj_use_batch_kernels()) {
+		double xs = P->aff_xs, xo = P->aff_xo;
+		double ys = P->aff_ys, yo = P->aff_yo;
+		double lam0 = P->lam0;
+		int over = P->over;
+
+		for (i = 0; i < point_count; ++i) {
+			int bad = (x[i] == HUGE_VAL) | (y[i] == HUGE_VAL);
+			double lamv, phiv;
+
+			lamv = ((sx * x[i] - bx) - xo) / xs + lam0;
+			if (!over)
+				lamv = adjlon(lamv);
+			phiv = ((sx * y[i] - by) - yo) / ys;
+			lam[i] = bad ? HUGE_VAL : lamv;
+			phi[i] = bad ? HUGE_VAL : phiv;
+			nbad += !((lam[i] < HUGE_VAL) & (phi[i] < HUGE_VAL));
+		}
+		return nbad;
+	}
+
+	/* descale and de-offset into the output arrays so the projection
+	** kernel can run on them in place.  The validity flag feeds a
+	** pair of blends rather than a per point branch, so arrays with
+	** scattered HUGE_VAL lanes (a datum stage's failed points, dirty
+	** sentinels) classify without mispredictions; NaN is not equal
+	** to HUGE_VAL and flows through untouched, as elsewhere */
+	for (i = 0; i < point_count; ++i) {
+		int bad = (x[i] == HUGE_VAL) | (y[i] == HUGE_VAL);
+
+		has_bad_points |= bad;
+		lam[i] = bad ? HUGE_VAL : sx * x[i] - bx;
+		phi[i] = bad ? HUGE_VAL : sx * y[i] - by;
+	}
+
+	/* bounds pre-pass: projections with a registered domain predicate
+	** get their off-domain points (off-earth pixels of a full disk
+	** image and the like) marked in band here, before any kernel math
+	** is spent on them.  The predicates are phrased so NaN compares
+	** false and flows through untouched, as elsewhere */
+	if (P->inv_domain != NULL) {
+		for (i = 0; i < point_count; ++i) {
+			XY xy;
+
+			if (lam[i] == HUGE_VAL)
+				continue;
+			xy.x = lam[i];
+			xy.y = phi[i];
+			if (!(*P->inv_domain)(xy, P)) {
+				lam[i] = phi[i] = HUGE_VAL;
+				has_bad_points = 1;
+			}
+		}
+	}
+
+	if (P->inv_batch != NULL && !has_bad_points &&
+			pj_use_batch_kernels()) {
+		/* batch kernels are store-free: per-point failures are
+		** flagged with HUGE_VAL and collected below, with the
+		** ctx only published to once per call */
+		(*P->inv_batch)(lam, phi, lam, phi, point_count, P);
+	} else if (P->inv_batch != NULL && pj_use_batch_kernels() &&
+			pj_inv_batch_compact(P, point_count, lam, phi)) {
+		/* mixed validity array: the in-domain points were gathered
+		** into contiguous runs and streamed through the kernel */
+	} else {
+		int *err_addr = pj_diag_errno_addr(P->ctx);
+
+		for (i = 0; i < point_count; ++i) {
+			XY xy;
+			LP lp;
+
+			if (lam[i] == HUGE_VAL)
+				continue;
+			xy.x = lam[i];
+			xy.y = phi[i];
+			lp = PJ_INV_SPECULATE(xy, P); /* inverse project */
+			if (*err_addr) {
+				lp.lam = lp.phi = HUGE_VAL;
+				has_bad_points = 1;
+				*err_addr = 0;
+			}
+			lam[i] = lp.lam;
+			phi[i] = lp.phi;
+		}
+	}
+
+	/* reduce from del lp.lam and restore geocentric latitude in one
+	** pass, counting failed points; the P->geoc test is hoisted out of
+	** the loop so the common geodetic path stays branch free, and the
+	** failure test is phrased so NaN inputs flow through untouched but
+	** still count as invalid */
+	if (P->geoc) {
+		double one_es = P->one_es;
+
+		for (i = 0; i < point_count; ++i) {
+			if (!(lam[i] < HUGE_VAL && phi[i] < HUGE_VAL)) {
+				++nbad;
+				continue;
+			}
+			lam[i] += P->lam0;
+			if (!P->over)
+				lam[i] = adjlon(lam[i]);
+			if (fabs(fabs(phi[i])-HALFPI) > EPS)
+				phi[i] = atan(one_es * tan(phi[i]));
+		}
+	} else {
+		for (i = 0; i < point_count; ++i) {
+			if (!(lam[i] < HUGE_VAL && phi[i] < HUGE_VAL)) {
+				++nbad;
+				continue;
+			}
+			lam[i] += P->lam0;
+			if (!P->over)
+				lam[i] = adjlon(lam[i]);
+		}
+	}
+
+	return nbad;
+}
+
+	int /* inverse projection of contiguous x/y arrays */
+pj_inv_batch(PJ *P, long point_count, const double *x, const double *y,
+	double *lam, double *phi) {
+	/* errno bookkeeping is done once per batch, not once per point;
+	** the stores are conditional so parallel batches sharing one ctx
+	** do not keep invalidating each other's cache line */
+	int *err_addr = pj_diag_errno_addr(P->ctx);
+
+	if (*err_addr != 0)
+		*err_addr = 0;
+	if (err_addr == &P->ctx->last_errno) {
+		if (pj_errno != 0)
+			pj_errno = 0;
+		errno = 0;
+	}
+
+	if (pj_inv_batch_work(P, point_count, x, y, lam, phi)) {
+		pj_ctx_set_errno( P->ctx, -15 );
+		return -15;
+	}
+	return 0;
+}
+
+	long /* quiet inverse batch: invalid points are only marked in
+	** band (HUGE_VAL, with NaN passed through) and counted; the ctx
+	** error state is left as found, so concurrent batches never
+	** serialize on it */
+pj_inv_batch_quiet(PJ *P, long point_count, const double *x, const double *y,
+	double *lam, double *phi) {
+	int *err_addr = pj_diag_errno_addr(P->ctx);
+	int saved_errno = *err_addr;
+	long nbad;
+
+	if (saved_errno != 0)
+		*err_addr = 0;
+	nbad = pj_inv_batch_work(P, point_count, x, y, lam, phi);
+	if (*err_addr != saved_errno)
+		*err_addr = saved_errno;
+	return nbad;
+}
@@ -0,0 +1,182 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Registry for externally supplied batch kernels, so hand
+ *           vectorized implementations maintained outside the library
+ *           slot into the same dispatch as the built in batch kernels
+ *           and inherit the planning, gather and error masking
+ *           infrastructure around them.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+#include <errno.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** Registered kernels are keyed by projection id and installed onto a
+** PJ at the end of its setup, after the built in ENTRY code has
+** attached its own batch kernels - so an override wins, and a PJ
+** initialized before the registration is untouched.  The kernels see
+** exactly what the built in batch kernels see: the forward gets
+** normalized lam/phi (lam0 subtracted, wrapped, range checked) and
+** produces raw kernel x/y before the false origin scaling, the
+** inverse the reverse, and failed points are carried as HUGE_VAL in
+** both directions.  The registry is tiny and consulted once per
+** init, so it just lives behind the recursive core lock.
+*/
+
+typedef struct pjKernelReg {
+    struct pjKernelReg *next;
+    char *name;
+    int   width;
+    int   flags;
+    projBatchKernelFn fwd_batch;
+    projBatchKernelFn inv_batch;
+} pjKernelReg;
+
+static pjKernelReg *kernelreg_head = NULL;
+
+/************************************************************************/
+/*                         pj_register_kernel()                         */
+/*                                                                      */
+/*      Register (or with both kernels NULL remove) external batch      */
+/*      kernels for one projection id.  Registering again replaces      */
+/*      the previous entry; only PJs initialized afterwards pick the    */
+/*      kernels up.  A NULL kernel for one direction leaves the built   */
+/*      in kernel (if any) in place for that direction.  width > 1      */
+/*      advertises an explicit SIMD width through pj_kernel_caps().     */
+/*      flags gate installation by setup variant, since spherical and   */
+/*      ellipsoidal paths are different math.  Returns 0, -1 for a      */
+/*      malformed call, or ENOMEM.                                      */
+/************************************************************************/
+
+int pj_register_kernel( const char *proj_name, int width,
+                        projBatchKernelFn fwd_batch,
+                        projBatchKernelFn inv_batch, int flags )
+
+{
+    pjKernelReg *entry, **link;
+
+    if( proj_name == NULL || proj_name[0] == '\0' || width < 0 )
+        return -1;
+
+    pj_acquire_lock();
+
+    for( link = &kernelreg_head; (entry = *link) != NULL;
+         link = &entry->next )
+    {
+        if( strcmp( entry->name, proj_name ) == 0 )
+            break;
+    }
+
+    if( fwd_batch == NULL && inv_batch == NULL )
+    {
+        if( entry != NULL )
+        {
+            *link = entry->next;
+            pj_dalloc( entry->name );
+            pj_dalloc( entry );
+        }
+        pj_release_lock();
+        return 0;
+    }
+
+    if( entry == NULL )
+    {
+        entry = (pjKernelReg *) pj_malloc( sizeof(pjKernelReg) );
+        if( entry != NULL )
+            entry->name = (char *) pj_malloc( strlen(proj_name) + 1 );
+        if( entry == NULL || entry->name == NULL )
+        {
+            pj_dalloc( entry );
+            pj_release_lock();
+            return ENOMEM;
+        }
+        strcpy( entry->name, proj_name );
+        entry->next = kernelreg_head;
+        kernelreg_head = entry;
+    }
+
+    entry->width = width;
+    entry->flags = flags;
+    entry->fwd_batch = fwd_batch;
+    entry->inv_batch = inv_batch;
+
+    pj_release_lock();
+    return 0;
+}
+
+/************************************************************************/
+/*                     pj_kernel_apply_overrides()                      */
+/*                                                                      */
+/*      Install any registered kernels onto a freshly set up PJ.        */
+/*      Called at the end of setup - after the ENTRY code attached      */
+/*      the built in batch kernels - for both the eager and the         */
+/*      deferred setup paths.                                           */
+/************************************************************************/
+
+void pj_kernel_apply_overrides( PJ *P )
+
+{
+    const char *name;
+    pjKernelReg *entry;
+
+    if( kernelreg_head == NULL || P->params == NULL )
+        return;
+
+    name = pj_param( P->ctx, P->params, "sproj" ).s;
+    if( name == NULL )
+        return;
+
+    pj_acquire_lock();
+
+    for( entry = kernelreg_head; entry != NULL; entry = entry->next )
+    {
+        if( strcmp( entry->name, name ) != 0 )
+            continue;
+
+        if( ((entry->flags & PJ_KERNEL_SPHERICAL_ONLY) && P->es != 0.)
+            || ((entry->flags & PJ_KERNEL_ELLIPSOIDAL_ONLY)
+                && P->es == 0.) )
+            break;
+
+        if( entry->fwd_batch != NULL )
+            P->fwd_batch = entry->fwd_batch;
+        if( entry->inv_batch != NULL )
+            P->inv_batch = entry->inv_batch;
+        if( entry->width > 1 )
+            P->batch_width = entry->width;
+
+        /* the fused affine fast path would bypass the batch kernel
+           entirely; an explicit override must actually run */
+        P->kernel_affine = 0;
+        break;
+    }
+
+    pj_release_lock();
+}
@@ -56,6 +56,10 @@ ENTRY0(latlong)
         P->x0 = 0.0;
         P->y0 = 0.0;
 	P->inv = inverse; P->fwd = forward;
+	/* pure scale: lets the batch layer fuse its scaffold passes
+	** around the kernel into one */
+	P->kernel_affine = 1;
+	P->aff_xs = P->aff_ys = 1. / P->a;
 ENDENTRY(P)
 
 ENTRY0(longlat)
@@ -63,6 +67,10 @@ ENTRY0(longlat)
         P->x0 = 0.0;
         P->y0 = 0.0;
 	P->inv = inverse; P->fwd = forward;
+	/* pure scale: lets the batch layer fuse its scaffold passes
+	** around the kernel into one */
+	P->kernel_affine = 1;
+	P->aff_xs = P->aff_ys = 1. / P->a;
 ENDENTRY(P)
 
 ENTRY0(latlon)
@@ -70,6 +78,10 @@ ENTRY0(latlon)
         P->x0 = 0.0;
         P->y0 = 0.0;
 	P->inv = inverse; P->fwd = forward;
+	/* pure scale: lets the batch layer fuse its scaffold passes
+	** around the kernel into one */
+	P->kernel_affine = 1;
+	P->aff_xs = P->aff_ys = 1. / P->a;
 ENDENTRY(P)
 
 ENTRY0(lonlat)
@@ -77,4 +89,8 @@ ENTRY0(lonlat)
         P->x0 = 0.0;
         P->y0 = 0.0;
 	P->inv = inverse; P->fwd = forward;
+	/* pure scale: lets the batch layer fuse its scaffold passes
+	** around the kernel into one */
+	P->kernel_affine = 1;
+	P->aff_xs = P->aff_ys = 1. / P->a;
 ENDENTRY(P)
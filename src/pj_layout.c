@@ -0,0 +1,174 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Layout conversion between interleaved coordinate records
+ *           (shapefile style xy / xyz doubles, possibly with trailing
+ *           attribute fields) and the separate per axis arrays the
+ *           batch transform pipeline runs fastest on.  Every consumer
+ *           hand rolls this conversion around the library's edges;
+ *           these entries keep it one tuned pass per direction.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** A stride 2 or 3 record split is not a square transpose: the fused
+** pass below reads the record stream once, sequentially, and writes
+** two or three sequential output streams, which is already the
+** minimum memory traffic the conversion admits.  Cache blocking and
+** staging buffers were tried and buy nothing at these strides - the
+** per record fields share the input cache line - so the tuning here
+** is simply dedicated branch free loops for the xy and xyz layouts
+** (the vectorizable shapes) with a strided fallback for records
+** carrying attribute fields.  The arrays must not overlap.
+*/
+
+/************************************************************************/
+/*                          pj_deinterleave()                           */
+/*                                                                      */
+/*      Split interleaved records of point_offset doubles into          */
+/*      separate x/y (and, when z is not NULL, z) arrays, reading       */
+/*      the first two or three fields of each record.  point_offset     */
+/*      is the record stride in doubles, as in pj_transform();          */
+/*      0 means densely packed records.  Returns 0, or -1 for a         */
+/*      malformed call (missing array, stride too small for the         */
+/*      axes requested).                                                */
+/************************************************************************/
+
+int pj_deinterleave( long point_count, int point_offset, const double *in,
+                     double *x, double *y, double *z )
+
+{
+    long i;
+
+    if( point_offset == 0 )
+        point_offset = z != NULL ? 3 : 2;
+
+    if( in == NULL || x == NULL || y == NULL
+        || point_offset < (z != NULL ? 3 : 2) )
+        return -1;
+
+    if( z == NULL && point_offset == 2 )
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            x[i] = in[2*i];
+            y[i] = in[2*i+1];
+        }
+    }
+    else if( z != NULL && point_offset == 3 )
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            x[i] = in[3*i];
+            y[i] = in[3*i+1];
+            z[i] = in[3*i+2];
+        }
+    }
+    else if( z == NULL )
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            x[i] = in[(size_t) point_offset * i];
+            y[i] = in[(size_t) point_offset * i + 1];
+        }
+    }
+    else
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            x[i] = in[(size_t) point_offset * i];
+            y[i] = in[(size_t) point_offset * i + 1];
+            z[i] = in[(size_t) point_offset * i + 2];
+        }
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                           pj_interleave()                            */
+/*                                                                      */
+/*      The reverse: gather separate x/y (and optional z) arrays        */
+/*      into interleaved records of point_offset doubles, writing       */
+/*      the first two or three fields of each record and leaving        */
+/*      any trailing attribute fields untouched.  Same conventions      */
+/*      and error handling as pj_deinterleave().                        */
+/************************************************************************/
+
+int pj_interleave( long point_count, int point_offset,
+                   const double *x, const double *y, const double *z,
+                   double *out )
+
+{
+    long i;
+
+    if( point_offset == 0 )
+        point_offset = z != NULL ? 3 : 2;
+
+    if( out == NULL || x == NULL || y == NULL
+        || point_offset < (z != NULL ? 3 : 2) )
+        return -1;
+
+    if( z == NULL && point_offset == 2 )
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            out[2*i] = x[i];
+            out[2*i+1] = y[i];
+        }
+    }
+    else if( z != NULL && point_offset == 3 )
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            out[3*i] = x[i];
+            out[3*i+1] = y[i];
+            out[3*i+2] = z[i];
+        }
+    }
+    else if( z == NULL )
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            out[(size_t) point_offset * i] = x[i];
+            out[(size_t) point_offset * i + 1] = y[i];
+        }
+    }
+    else
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            out[(size_t) point_offset * i] = x[i];
+            out[(size_t) point_offset * i + 1] = y[i];
+            out[(size_t) point_offset * i + 2] = z[i];
+        }
+    }
+
+    return 0;
+}
@@ -21,6 +21,7 @@ PROJ_HEAD(cass, "Cassini")
 PROJ_HEAD(cc, "Central Cylindrical")
 PROJ_HEAD(cea, "Equal Area Cylindrical")
 PROJ_HEAD(chamb, "Chamberlin Trimetric")
+PROJ_HEAD(cheby, "Chebyshev series surrogate")
 PROJ_HEAD(collg, "Collignon")
 PROJ_HEAD(crast, "Craster Parabolic (Putnins P4)")
 PROJ_HEAD(denoy, "Denoyer Semi-Elliptical")
@@ -43,20 +43,84 @@ void pj_stderr_logger( void *app_data, int level, const char *msg )
     fprintf( stderr, "%s\n", msg );
 }
 
+/************************************************************************/
+/*                           pj_ring_logger()                           */
+/*                                                                      */
+/*      Logger sink that appends messages to a fixed size in-memory     */
+/*      ring, overwriting the oldest bytes, so debug levels can stay    */
+/*      enabled in production without per event i/o; after an           */
+/*      incident pj_ring_logger_drain() recovers the tail of the        */
+/*      history.  The ring is process wide (contexts on any thread      */
+/*      may share it), so access is serialized on the global lock.      */
+/************************************************************************/
+
+#define PJ_LOG_RING_SIZE 16384
+
+static char log_ring[PJ_LOG_RING_SIZE];
+static unsigned long log_ring_head = 0;   /* total bytes ever written */
+
+void pj_ring_logger( void *app_data, int level, const char *msg )
+
+{
+    (void) app_data;
+    (void) level;
+
+    pj_acquire_lock();
+    for( ; *msg != '\0'; msg++ )
+        log_ring[log_ring_head++ % PJ_LOG_RING_SIZE] = *msg;
+    log_ring[log_ring_head++ % PJ_LOG_RING_SIZE] = '\n';
+    pj_release_lock();
+}
+
+/************************************************************************/
+/*                        pj_ring_logger_drain()                        */
+/*                                                                      */
+/*      Copy the buffered log history (oldest surviving byte first,     */
+/*      truncated to what fits in buf including a terminating NUL)      */
+/*      and reset the ring.  Returns the number of bytes copied.        */
+/************************************************************************/
+
+long pj_ring_logger_drain( char *buf, long buf_size )
+
+{
+    unsigned long avail, start;
+    long count, i;
+
+    if( buf == NULL || buf_size < 1 )
+        return 0;
+
+    pj_acquire_lock();
+    avail = log_ring_head < PJ_LOG_RING_SIZE
+        ? log_ring_head : PJ_LOG_RING_SIZE;
+    count = (long) avail < buf_size - 1 ? (long) avail : buf_size - 1;
+    start = log_ring_head - (unsigned long) count;
+    for( i = 0; i < count; i++ )
+        buf[i] = log_ring[(start + i) % PJ_LOG_RING_SIZE];
+    buf[count] = '\0';
+    log_ring_head = 0;
+    pj_release_lock();
+
+    return count;
+}
+
 /************************************************************************/
 /*                               pj_log()                               */
 /************************************************************************/
 
+#define PJ_LOG_BUF_SIZE 100000
+
 void pj_log( projCtx ctx, int level, const char *fmt, ... )
 
 {
     va_list args;
     char *msg_buf;
 
-    if( level > ctx->debug_level )
+    if( !PJ_LOG_ENABLED( ctx, level ) )
         return;
 
-    msg_buf = (char *) malloc(100000);
+    /* the context buffer pool spares a heap round trip per message,
+       which matters once debug levels stay enabled in production */
+    msg_buf = (char *) pj_ctx_buffer_get( ctx, PJ_LOG_BUF_SIZE );
     if( msg_buf == NULL )
         return;
 
@@ -68,6 +132,6 @@ void pj_log( projCtx ctx, int level, const char *fmt, ... )
     va_end( args );
 
     ctx->logger( ctx->app_data, level, msg_buf );
-    
-    free( msg_buf );
+
+    pj_ctx_buffer_put( ctx, msg_buf );
 }
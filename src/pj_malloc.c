@@ -20,8 +20,35 @@ pj_malloc(size_t size) {
         if ( res && !old_errno )
                 errno = 0;        	 
         return res;
+}
+/* pj_setup_finalize() runs deferred projection setup on an object the
+** caller still holds, but the E_ERROR macros in the setup functions
+** free that object outright on a parameter error.  The guard lets the
+** finalizer keep the envelope alive across such a failure: releasing
+** the guarded pointer is suppressed and only remembered as a hit.
+** Guards are taken under pj_acquire_lock(), and the guarded object is
+** confined to the finalizing thread, so the comparison below can only
+** match there. */
+static void *pj_dalloc_keep = NULL;
+static int pj_dalloc_keep_hit = 0;
+
+	void
+pj_dalloc_guard(void *ptr) {
+	pj_dalloc_keep = ptr;
+	pj_dalloc_keep_hit = 0;
+}
+	int
+pj_dalloc_unguard(void) {
+	int hit = pj_dalloc_keep_hit;
+	pj_dalloc_keep = NULL;
+	pj_dalloc_keep_hit = 0;
+	return hit;
 }
 	void
 pj_dalloc(void *ptr) {
+	if (ptr != NULL && ptr == pj_dalloc_keep) {
+		pj_dalloc_keep_hit = 1;
+		return;
+	}
 	free(ptr);
 }
@@ -16,12 +16,24 @@
 #define C66 .36458333333333333333
 #define C68 .00569661458333333333
 #define C88 .3076171875
+/* rectifying to geodetic latitude series in the third flattening n,
+** terms through n^4 (Snyder eq. 3-26).  Truncation error is O(n^5),
+** below EPS for es up to MAX_SERIES_ES, which covers the terrestrial
+** ellipsoids (WGS84 es ~ .00669, clrk66 ~ .00677).
+*/
+#define R21 1.5
+#define R23 .84375	/* 27/32 */
+#define R42 1.3125	/* 21/16 */
+#define R44 1.71875	/* 55/32 */
+#define R63 1.57291666666666666666	/* 151/96 */
+#define R84 2.142578125	/* 1097/512 */
 #define EPS 1e-11
 #define MAX_ITER 10
-#define EN_SIZE 5
+#define MAX_SERIES_ES .007
+#define EN_SIZE 9
 	double *
 pj_enfn(double es) {
-	double t, *en;
+	double t, n, *en;
 
 	if ((en = (double *)pj_malloc(EN_SIZE * sizeof(double))) != NULL) {
 		en[0] = C00 - es * (C02 + es * (C04 + es * (C06 + es * C08)));
@@ -29,6 +41,13 @@ pj_enfn(double es) {
 		en[2] = (t = es * es) * (C44 - es * (C46 + es * C48));
 		en[3] = (t *= es) * (C66 - es * C68);
 		en[4] = t * es * C88;
+		n = es / (1. + sqrt(1. - es));
+		n /= 1. + sqrt(1. - es);
+		en[5] = n * (R21 - n * n * R23);
+		t = n * n;
+		en[6] = t * (R42 - t * R44);
+		en[7] = t * n * R63;
+		en[8] = t * t * R84;
 	} /* else return NULL if unable to allocate memory */
 	return en;
 }
@@ -41,11 +60,26 @@ pj_mlfn(double phi, double sphi, double cphi, double *en) {
 }
 	double
 pj_inv_mlfn(projCtx ctx, double arg, double es, double *en) {
-	double s, t, phi, k = 1./(1.-es);
+	double s, t, mu, phi, k = 1./(1.-es);
 	int i;
 
-	phi = arg;
-	for (i = MAX_ITER; i ; --i) { /* rarely goes over 2 iterations */
+	/* closed form seed: rectifying latitude, then the inverse series */
+	mu = arg / en[0];
+	phi = mu + en[5] * sin(mu + mu) + en[6] * sin(4. * mu)
+		+ en[7] * sin(6. * mu) + en[8] * sin(8. * mu);
+	if (es <= MAX_SERIES_ES) /* series alone already below EPS */
+		return phi;
+	if (ctx->approx_tol > 0.) {
+		/* seed truncation error scales as n^5, i.e. roughly
+		** (es/MAX_SERIES_ES)^5 * EPS; inside the ctx error budget
+		** the seed alone is the documented approximation */
+		double r = es / MAX_SERIES_ES;
+
+		if (EPS * r * r * r * r * r <= ctx->approx_tol)
+			return phi;
+	}
+	for (i = MAX_ITER; i ; --i) { /* seeded, so one pass normally does */
+		PJ_STAT_INC(ctx, inv_mlfn_iterations);
 		s = sin(phi);
 		t = 1. - es * s * s;
 		phi -= t = (pj_mlfn(phi, s, cos(phi), en) - arg) * (t * sqrt(t)) * k;
@@ -54,4 +88,28 @@ pj_inv_mlfn(projCtx ctx, double arg, double es, double *en) {
 	}
 	pj_ctx_set_errno( ctx, -17 );
 	return phi;
+}
+	double /* store-free variant for batch kernels: never touches the
+	** ctx, flagging non-convergence with HUGE_VAL instead.  For the
+	** terrestrial ellipsoids (es <= MAX_SERIES_ES) the inverse series
+	** alone serves, so the common path is branch free and iteration
+	** free; unlike pj_inv_mlfn() no ctx error budget is consulted for
+	** larger es, so results are never less accurate than the scalar's */
+pj_inv_mlfn_batch(double arg, double es, double *en) {
+	double s, t, mu, phi, k = 1./(1.-es);
+	int i;
+
+	mu = arg / en[0];
+	phi = mu + en[5] * sin(mu + mu) + en[6] * sin(4. * mu)
+		+ en[7] * sin(6. * mu) + en[8] * sin(8. * mu);
+	if (es <= MAX_SERIES_ES)
+		return phi;
+	for (i = MAX_ITER; i ; --i) {
+		s = sin(phi);
+		t = 1. - es * s * s;
+		phi -= t = (pj_mlfn(phi, s, cos(phi), en) - arg) * (t * sqrt(t)) * k;
+		if (fabs(t) < EPS)
+			return phi;
+	}
+	return HUGE_VAL;
 }
@@ -5,3 +5,13 @@
 pj_msfn(double sinphi, double cosphi, double es) {
 	return (cosphi / sqrt (1. - es * sinphi * sinphi));
 }
+
+	void /* batch form over contiguous arrays, bit identical to
+	** pj_msfn() per point */
+pj_msfn_batch(long n, const double *sinphi, const double *cosphi, double es,
+	double *out) {
+	long i;
+
+	for (i = 0; i < n; ++i)
+		out[i] = cosphi[i] / sqrt (1. - es * sinphi[i] * sinphi[i]);
+}
@@ -0,0 +1,167 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Multi-threaded pj_transform() driver.  When the context has
+ *           pj_ctx_set_transform_threads() set above 1, large point arrays
+ *           are split into contiguous chunks and each chunk runs the full
+ *           serial pipeline (pj_transform_range) on its own thread.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+
+PJ_CVSID("$Id$");
+
+/* below this many points the dispatch cost outweighs the win */
+#define PJ_MT_MIN_POINTS   4096
+#define PJ_MT_MAX_THREADS  64
+
+typedef struct {
+    PJ       *srcdefn;
+    PJ       *dstdefn;
+    long      point_count;
+    int       point_offset;
+    double   *x;
+    double   *y;
+    double   *z;
+    int       err;
+} pj_mt_chunk;
+
+/************************************************************************/
+/*                            pj_mt_worker()                            */
+/************************************************************************/
+
+static void pj_mt_worker( void *arg )
+
+{
+    pj_mt_chunk *chunk = (pj_mt_chunk *) arg;
+
+    /* diagnostics scope: errors this chunk hits land in a thread
+       local slot instead of the shared ctx->last_errno / pj_errno,
+       so a worker flagging bad points never invalidates the error
+       fields the other workers poll per point.  The chunk return
+       code carries the error back to the join. */
+    pj_diag_push();
+    chunk->err = pj_transform_range( chunk->srcdefn, chunk->dstdefn,
+                                     chunk->point_count, chunk->point_offset,
+                                     chunk->x, chunk->y, chunk->z );
+    (void) pj_diag_pop();
+}
+
+/************************************************************************/
+/*                          pj_transform_mt()                           */
+/*                                                                      */
+/*      Every pipeline stage is data parallel per point, so once the    */
+/*      grid lists are resolved the chunks are independent: the only    */
+/*      state the workers share are the (read only from here on) PJ     */
+/*      definitions and the grid tables behind the PJ_LOCK_GRIDS        */
+/*      lock; the ctx error fields are kept out of the workers          */
+/*      entirely by the per thread diagnostics scopes (pj_ctx.c) and    */
+/*      aggregated through the per chunk return codes.  The chunks      */
+/*      run on the shared worker pool (pj_tpool.c), with this thread    */
+/*      taking its share.                                               */
+/************************************************************************/
+
+int pj_transform_mt( PJ *srcdefn, PJ *dstdefn,
+                     long point_count, int point_offset,
+                     double *x, double *y, double *z )
+
+{
+    pj_mt_chunk chunk[PJ_MT_MAX_THREADS];
+    void       *args[PJ_MT_MAX_THREADS];
+    int         num_threads = srcdefn->ctx->transform_threads;
+    int         i, err = 0;
+
+    if( num_threads > PJ_MT_MAX_THREADS )
+        num_threads = PJ_MT_MAX_THREADS;
+    if( num_threads > point_count / (PJ_MT_MIN_POINTS/2) )
+        num_threads = (int) (point_count / (PJ_MT_MIN_POINTS/2));
+
+    /* catalog based datum shifts mutate per PJ state point by point -
+       leave those on the serial path, along with small batches */
+    if( num_threads < 2
+        || point_count < PJ_MT_MIN_POINTS
+        || srcdefn->catalog_name != NULL
+        || dstdefn->catalog_name != NULL )
+        return pj_transform_range( srcdefn, dstdefn, point_count,
+                                   point_offset, x, y, z );
+
+    if( point_offset == 0 )
+        point_offset = 1;
+
+    /* the workers only ever write their diagnostics slots, so clear
+       the shared error state once from here, as the serial path does */
+    pj_ctx_set_errno( srcdefn->ctx, 0 );
+    pj_ctx_set_errno( dstdefn->ctx, 0 );
+
+    /* resolve the grid lists from this thread so the workers never
+       race to populate the lazily built per PJ cache */
+    if( srcdefn->datum_type == PJD_GRIDSHIFT )
+    {
+        err = pj_gridshift_resolve( srcdefn );
+        if( err != 0 )
+            return err;
+    }
+    if( dstdefn->datum_type == PJD_GRIDSHIFT )
+    {
+        err = pj_gridshift_resolve( dstdefn );
+        if( err != 0 )
+            return err;
+    }
+
+    for( i = 0; i < num_threads; i++ )
+    {
+        long start = point_count * i / num_threads;
+        long end = point_count * (i+1) / num_threads;
+
+        chunk[i].srcdefn = srcdefn;
+        chunk[i].dstdefn = dstdefn;
+        chunk[i].point_count = end - start;
+        chunk[i].point_offset = point_offset;
+        chunk[i].x = x + (size_t) point_offset * start;
+        chunk[i].y = y + (size_t) point_offset * start;
+        chunk[i].z = (z != NULL) ? z + (size_t) point_offset * start : NULL;
+        chunk[i].err = 0;
+        args[i] = chunk + i;
+    }
+
+    pj_tpool_run( pj_mt_worker, args, num_threads );
+
+    /* first failing chunk wins, matching the serial first error
+       semantics as closely as the split allows */
+    for( i = 0; i < num_threads; i++ )
+    {
+        if( chunk[i].err != 0 )
+        {
+            err = chunk[i].err;
+            break;
+        }
+    }
+
+    if( err != 0 )
+        pj_ctx_set_errno( srcdefn->ctx, err );
+
+    return err;
+}
@@ -47,6 +47,15 @@ PJ_CVSID("$Id: pj_transform.c 1504 2009-01-06 02:11:57Z warmerdam $");
 #  define MUTEX_stub
 #endif
 
+/*
+** Besides the single legacy recursive lock below, a small set of per
+** subsystem reader/writer locks (PJ_LOCK_*) lets read-mostly users
+** (init/definition cache hits, loaded grid list lookups) proceed in
+** parallel instead of funneling through one mutex.  Where the platform
+** has no reader/writer primitive the read and write operations fall
+** back to exclusive locking.
+*/
+
 /************************************************************************/
 /* ==================================================================== */
 /*                      stub mutex implementation                       */
@@ -82,6 +91,26 @@ void pj_cleanup_lock()
 {
 }
 
+/************************************************************************/
+/*                   per subsystem locks (stubbed)                      */
+/************************************************************************/
+
+void pj_acquire_read_lock( int lock_id )
+{
+}
+
+void pj_acquire_write_lock( int lock_id )
+{
+}
+
+void pj_release_read_lock( int lock_id )
+{
+}
+
+void pj_release_write_lock( int lock_id )
+{
+}
+
 #endif // def MUTEX_stub
 
 /************************************************************************/
@@ -150,6 +179,37 @@ void pj_cleanup_lock()
 {
 }
 
+/************************************************************************/
+/*                        per subsystem locks                           */
+/************************************************************************/
+
+static pthread_rwlock_t pj_rw_lock[PJ_LOCK_COUNT] = {
+    PTHREAD_RWLOCK_INITIALIZER,
+    PTHREAD_RWLOCK_INITIALIZER,
+    PTHREAD_RWLOCK_INITIALIZER,
+    PTHREAD_RWLOCK_INITIALIZER
+};
+
+void pj_acquire_read_lock( int lock_id )
+{
+    pthread_rwlock_rdlock( pj_rw_lock + lock_id );
+}
+
+void pj_acquire_write_lock( int lock_id )
+{
+    pthread_rwlock_wrlock( pj_rw_lock + lock_id );
+}
+
+void pj_release_read_lock( int lock_id )
+{
+    pthread_rwlock_unlock( pj_rw_lock + lock_id );
+}
+
+void pj_release_write_lock( int lock_id )
+{
+    pthread_rwlock_unlock( pj_rw_lock + lock_id );
+}
+
 #endif // def MUTEX_pthread
 
 /************************************************************************/
@@ -215,4 +275,44 @@ void pj_cleanup_lock()
     }
 }
 
+/************************************************************************/
+/*                        per subsystem locks                           */
+/*                                                                      */
+/*      No reader/writer primitive is assumed to be available here,     */
+/*      so both read and write operations take an exclusive per         */
+/*      subsystem mutex.                                                */
+/************************************************************************/
+
+static HANDLE subsystem_lock[PJ_LOCK_COUNT] = { NULL };
+static void pj_init_subsystem_lock( int lock_id )
+
+{
+    if( subsystem_lock[lock_id] == NULL )
+        subsystem_lock[lock_id] = CreateMutex( NULL, FALSE, NULL );
+}
+
+void pj_acquire_read_lock( int lock_id )
+{
+    pj_init_subsystem_lock( lock_id );
+    WaitForSingleObject( subsystem_lock[lock_id], INFINITE );
+}
+
+void pj_acquire_write_lock( int lock_id )
+{
+    pj_init_subsystem_lock( lock_id );
+    WaitForSingleObject( subsystem_lock[lock_id], INFINITE );
+}
+
+void pj_release_read_lock( int lock_id )
+{
+    if( subsystem_lock[lock_id] != NULL )
+        ReleaseMutex( subsystem_lock[lock_id] );
+}
+
+void pj_release_write_lock( int lock_id )
+{
+    if( subsystem_lock[lock_id] != NULL )
+        ReleaseMutex( subsystem_lock[lock_id] );
+}
+
 #endif // def MUTEX_win32
@@ -48,6 +48,101 @@ PROJ_LIB;
 0;
 #endif
 
+/************************************************************************/
+/*      Resolved-path cache.  Resolving a bare resource name means      */
+/*      walking PROJ_LIB and the searchpath with one fopen() attempt    */
+/*      per directory, and optional grids (@name in +nadgrids) repeat   */
+/*      that walk - all misses - on every lookup.  Remember the         */
+/*      resolved absolute path per name, or that the name resolved      */
+/*      nowhere, so repeated opens cost one hash probe.  The cache is   */
+/*      flushed whenever the set of places to look can change           */
+/*      (pj_set_searchpath / pj_set_finder).  Guarded by the global     */
+/*      pj_acquire_lock() mutex.                                        */
+/************************************************************************/
+
+#define PATH_CACHE_BUCKETS 64
+
+typedef struct path_cache_entry {
+    struct path_cache_entry *next;
+    char *name;
+    char *path;         /* NULL marks a definitive miss */
+} path_cache_entry;
+
+static path_cache_entry *path_cache[PATH_CACHE_BUCKETS];
+
+static unsigned int pj_path_cache_hash( const char *name )
+
+{
+    unsigned int hash = 0;
+
+    while( *name != '\0' )
+        hash = hash * 31 + (unsigned char) *(name++);
+
+    return hash % PATH_CACHE_BUCKETS;
+}
+
+static path_cache_entry *pj_path_cache_find( const char *name )
+
+{
+    path_cache_entry *entry = path_cache[pj_path_cache_hash(name)];
+
+    while( entry != NULL && strcmp(entry->name, name) != 0 )
+        entry = entry->next;
+
+    return entry;
+}
+
+static void pj_path_cache_insert( const char *name, const char *path )
+
+{
+    unsigned int bucket = pj_path_cache_hash( name );
+    path_cache_entry *entry;
+
+    entry = pj_path_cache_find( name );
+    if( entry != NULL )
+    {
+        /* refresh a stale entry in place */
+        free( entry->path );
+        entry->path = path != NULL ? strdup( path ) : NULL;
+        return;
+    }
+
+    entry = (path_cache_entry *) pj_malloc( sizeof(path_cache_entry) );
+    if( entry == NULL )
+        return;
+
+    entry->name = strdup( name );
+    entry->path = path != NULL ? strdup( path ) : NULL;
+    if( entry->name == NULL || (path != NULL && entry->path == NULL) )
+    {
+        free( entry->name );
+        free( entry->path );
+        pj_dalloc( entry );
+        return;
+    }
+
+    entry->next = path_cache[bucket];
+    path_cache[bucket] = entry;
+}
+
+static void pj_path_cache_flush()
+
+{
+    int i;
+
+    for( i = 0; i < PATH_CACHE_BUCKETS; i++ )
+    {
+        while( path_cache[i] != NULL )
+        {
+            path_cache_entry *entry = path_cache[i];
+            path_cache[i] = entry->next;
+            free( entry->name );
+            free( entry->path );
+            pj_dalloc( entry );
+        }
+    }
+}
+
 /************************************************************************/
 /*                           pj_set_finder()                            */
 /************************************************************************/
@@ -55,6 +150,10 @@ PROJ_LIB;
 void pj_set_finder( const char *(*new_finder)(const char *) )
 
 {
+    pj_acquire_lock();
+    pj_path_cache_flush();
+    pj_release_lock();
+
     pj_finder = new_finder;
 }
 
@@ -70,6 +169,10 @@ void pj_set_searchpath ( int count, const char **path )
 {
     int i;
 
+    pj_acquire_lock();
+    pj_path_cache_flush();
+    pj_release_lock();
+
     if (path_count > 0 && search_path != NULL)
     {
         for (i = 0; i < path_count; i++)
@@ -102,9 +205,10 @@ PAFile
 pj_open_lib(projCtx ctx, const char *name, const char *mode) {
     char fname[MAX_PATH_FILENAME+1];
     const char *sysname;
-    PAFile fid;
+    PAFile fid = NULL;
     int n = 0;
     int i;
+    int cacheable = 0;
 #ifdef WIN32
     static const char dir_chars[] = "/\\";
 #else
@@ -126,24 +230,62 @@ pj_open_lib(projCtx ctx, const char *name, const char *mode) {
 
     /* or fixed path: /name, ./name or ../name */
     else if (strchr(dir_chars,*name)
-             || (*name == '.' && strchr(dir_chars,name[1])) 
+             || (*name == '.' && strchr(dir_chars,name[1]))
              || (!strncmp(name, "..", 2) && strchr(dir_chars,name[2]))
              || (name[1] == ':' && strchr(dir_chars,name[2])) )
         sysname = name;
 
-    /* or try to use application provided file finder */
-    else if( pj_finder != NULL && pj_finder( name ) != NULL )
-        sysname = pj_finder( name );
-
-    /* or is environment PROJ_LIB defined */
-    else if ((sysname = getenv("PROJ_LIB")) || (sysname = proj_lib_name)) {
-        (void)strcpy(fname, sysname);
-        fname[n = strlen(fname)] = DIR_CHAR;
-        fname[++n] = '\0';
-        (void)strcpy(fname+n, name);
-        sysname = fname;
-    } else /* just try it bare bones */
-        sysname = name;
+    /* bare resource names go through the finder/PROJ_LIB/searchpath
+       resolution walk, whose outcome we cache */
+    else
+    {
+        path_cache_entry *entry;
+
+        cacheable = 1;
+
+        pj_acquire_lock();
+        entry = pj_path_cache_find( name );
+        if( entry != NULL && entry->path == NULL )
+        {
+            pj_release_lock();
+            if( ctx->last_errno == 0 )
+                pj_ctx_set_errno( ctx, ENOENT );
+            pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
+                    "pj_open_lib(%s): cached miss\n", name );
+            return NULL;
+        }
+        if( entry != NULL )
+        {
+            (void)strcpy( fname, entry->path );
+            pj_release_lock();
+            if( (fid = pj_ctx_fopen(ctx, fname, mode)) != NULL )
+            {
+                errno = 0;
+                pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
+                        "pj_open_lib(%s): cached path fopen(%s) - succeeded\n",
+                        name, fname );
+                return fid;
+            }
+            /* the file went away - fall through to a fresh walk and
+               refresh the entry with whatever it finds */
+        }
+        else
+            pj_release_lock();
+
+        /* try to use application provided file finder */
+        if( pj_finder != NULL && pj_finder( name ) != NULL )
+            sysname = pj_finder( name );
+
+        /* or is environment PROJ_LIB defined */
+        else if ((sysname = getenv("PROJ_LIB")) || (sysname = proj_lib_name)) {
+            (void)strcpy(fname, sysname);
+            fname[n = strlen(fname)] = DIR_CHAR;
+            fname[++n] = '\0';
+            (void)strcpy(fname+n, name);
+            sysname = fname;
+        } else /* just try it bare bones */
+            sysname = name;
+    }
 
     if ((fid = pj_ctx_fopen(ctx, sysname, mode)) != NULL)
         errno = 0;
@@ -161,10 +303,17 @@ pj_open_lib(projCtx ctx, const char *name, const char *mode) {
             errno = 0;
     }
 
+    if( cacheable )
+    {
+        pj_acquire_lock();
+        pj_path_cache_insert( name, fid != NULL ? sysname : NULL );
+        pj_release_lock();
+    }
+
     if( ctx->last_errno == 0 && errno != 0 )
         pj_ctx_set_errno( ctx, errno );
 
-    pj_log( ctx, PJ_LOG_DEBUG_MAJOR, 
+    pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
             "pj_open_lib(%s): call fopen(%s) - %s\n",
             name, sysname,
             fid == NULL ? "failed" : "succeeded" );
@@ -9,6 +9,8 @@ pj_mkparam(char *str) {
 	if((newitem = (paralist *)pj_malloc(sizeof(paralist) + strlen(str))) != NULL) {
 		newitem->used = 0;
 		newitem->next = 0;
+		newitem->hash = 0;
+		newitem->arena = 0;
 		if (*str == '+')
 			++str;
 		(void)strcpy(newitem->param, str);
@@ -16,6 +18,109 @@ pj_mkparam(char *str) {
 	return newitem;
 }
 
+/************************************************************************/
+/*      Optional lookup index for pj_param().                           */
+/*                                                                      */
+/*      pj_init() performs dozens of pj_param() calls per setup, each   */
+/*      a linear strncmp scan of the list.  pj_param_index() builds a   */
+/*      small open addressing hash over the current list contents and   */
+/*      hangs it off the head node; pj_param() then probes it instead   */
+/*      of walking the list.  The index must be rebuilt after any       */
+/*      entries are appended (see pj_ell_set/pj_datum_set) and freed    */
+/*      along with the list.  Lists without an index behave as before.  */
+/************************************************************************/
+
+struct PL_HASH {
+	int size;		/* power of two */
+	paralist *slot[1];
+};
+
+	static unsigned /* hash the parameter name, up to '=' or NUL */
+pj_param_hashkey(const char *s) {
+	unsigned h = 2166136261u;
+
+	while (*s && *s != '=') {
+		h ^= (unsigned char) *s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+	static int /* do two list entries carry the same parameter name? */
+pj_param_samekey(const char *a, const char *b) {
+	while (*a && *a != '=' && *a == *b) {
+		++a;
+		++b;
+	}
+	return (!*a || *a == '=') && (!*b || *b == '=');
+}
+
+	void /* (re)build lookup index over current list contents */
+pj_param_index(paralist *head) {
+	struct PL_HASH *idx;
+	paralist *pl;
+	int count = 0, size;
+
+	if (!head)
+		return;
+	if (head->hash) {
+		pj_dalloc(head->hash);
+		head->hash = 0;
+	}
+	for (pl = head; pl; pl = pl->next)
+		++count;
+	for (size = 4; size < 2 * count; size *= 2) ;
+	idx = (struct PL_HASH *) pj_malloc(sizeof(struct PL_HASH)
+		+ (size - 1) * sizeof(paralist *));
+	if (!idx)
+		return;	/* no index, pj_param() falls back to the scan */
+	idx->size = size;
+	memset(idx->slot, 0, size * sizeof(paralist *));
+	for (pl = head; pl; pl = pl->next) {
+		unsigned i = pj_param_hashkey(pl->param) & (size - 1);
+
+		/* linear probe; on a duplicate name keep the earlier
+		** entry so lookups match the linear scan order */
+		while (idx->slot[i]) {
+			if (pj_param_samekey(idx->slot[i]->param, pl->param))
+				break;
+			i = (i + 1) & (size - 1);
+		}
+		if (!idx->slot[i])
+			idx->slot[i] = pl;
+	}
+	head->hash = idx;
+}
+
+	void /* release the lookup index, if any */
+pj_param_index_free(paralist *head) {
+	if (head && head->hash) {
+		pj_dalloc(head->hash);
+		head->hash = 0;
+	}
+}
+
+	void /* release a whole parameter list, index and arena blocks included */
+pj_free_paralist(paralist *list) {
+	paralist *n, *block = 0;
+
+	pj_param_index_free(list);
+	for (; list; list = n) {
+		n = list->next;
+		if (!list->arena)
+			pj_dalloc(list);
+		else if (list->arena == 2) {
+			/* nodes of a block are consecutive, so the pending
+			** block is done once the next one starts */
+			if (block)
+				pj_dalloc(block);
+			block = list;
+		}
+	}
+	if (block)
+		pj_dalloc(block);
+}
+
 /************************************************************************/
 /*                              pj_param()                              */
 /*                                                                      */
@@ -44,11 +149,21 @@ pj_param(projCtx ctx, paralist *pl, const char *opt) {
 		ctx = pj_get_default_ctx();
 
 	type = *opt++;
-	/* simple linear lookup */
 	l = strlen(opt);
-	while (pl && !(!strncmp(pl->param, opt, l) &&
-	  (!pl->param[l] || pl->param[l] == '=')))
-		pl = pl->next;
+	if (pl && pl->hash) {
+		/* hashed lookup */
+		struct PL_HASH *idx = pl->hash;
+		unsigned i = pj_param_hashkey(opt) & (idx->size - 1);
+
+		while ((pl = idx->slot[i]) != NULL &&
+		  !(!strncmp(pl->param, opt, l) &&
+		  (!pl->param[l] || pl->param[l] == '=')))
+			i = (i + 1) & (idx->size - 1);
+	} else
+		/* simple linear lookup */
+		while (pl && !(!strncmp(pl->param, opt, l) &&
+		  (!pl->param[l] || pl->param[l] == '=')))
+			pl = pl->next;
 	if (type == 't')
 		value.i = pl != 0;
 	else if (pl) {
@@ -3,13 +3,20 @@
 
 #define HALFPI		1.5707963267948966
 #define TOL 1.0e-10
+#define APPROX_TOL_MAX 1.0e-3	/* never degrade beyond ~6km on earth */
 #define N_ITER 15
 
 	double
 pj_phi2(projCtx ctx, double ts, double e) {
 	double eccnth, Phi, con, dphi;
+	double tol = TOL;
 	int i;
 
+	/* an approx tolerance on the ctx widens the convergence test,
+	** trading iterations for latitude error inside the stated budget */
+	if (ctx->approx_tol > TOL)
+		tol = ctx->approx_tol < APPROX_TOL_MAX ?
+			ctx->approx_tol : APPROX_TOL_MAX;
 	eccnth = .5 * e;
 	Phi = HALFPI - 2. * atan (ts);
 	i = N_ITER;
@@ -18,8 +25,94 @@ pj_phi2(projCtx ctx, double ts, double e) {
 		dphi = HALFPI - 2. * atan (ts * pow((1. - con) /
 		   (1. + con), eccnth)) - Phi;
 		Phi += dphi;
-	} while ( fabs(dphi) > TOL && --i);
+	} while ( fabs(dphi) > tol && --i);
+	/* i is only decremented when another pass follows */
+	PJ_STAT_ADD(ctx, phi2_iterations, N_ITER - i + (i > 0));
 	if (i <= 0)
 		pj_ctx_set_errno( ctx, -18 );
 	return Phi;
 }
+
+/*
+** Closed form evaluation: the conformal to geodetic latitude series
+** (Adams, 1921) replaces the fixed point iteration above with four
+** multiply-adds once the coefficients have been set up per ellipsoid.
+** Truncation error is O(e^10), which stays below the iteration TOL for
+** es up to PJ_PHI2_SERIES_MAX_ES; larger eccentricities must keep
+** using the iterative pj_phi2().
+*/
+#define PJ_PHI2_SERIES_MAX_ES 0.01
+
+	int /* tolerance-aware setup: the truncation error scales as es^5
+	** (TOL at the default threshold), so a caller-supplied error
+	** budget widens the es range the series may serve */
+pj_phi2_pre_tol(double es, double *apa, double tol) {
+	double t, max_es = PJ_PHI2_SERIES_MAX_ES;
+
+	if (tol > TOL) {
+		if (tol > APPROX_TOL_MAX)
+			tol = APPROX_TOL_MAX;
+		max_es = PJ_PHI2_SERIES_MAX_ES * pow(tol / TOL, 0.2);
+		if (max_es > 0.1) /* keep the es^5 error model honest */
+			max_es = 0.1;
+	}
+	if (es <= 0. || es > max_es) {
+		apa[0] = apa[1] = apa[2] = apa[3] = 0.;
+		return 0;
+	}
+	apa[0] = es * .5;
+	t = es * es;
+	apa[0] += t * (5./24.);
+	apa[1] = t * (7./48.);
+	t *= es;
+	apa[0] += t * (1./12.);
+	apa[1] += t * (29./240.);
+	apa[2] = t * (7./120.);
+	t *= es;
+	apa[0] += t * (13./360.);
+	apa[1] += t * (811./11520.);
+	apa[2] += t * (81./1120.);
+	apa[3] = t * (4279./161280.);
+	return 1;
+}
+
+	int /* set up coefficients; returns TRUE when the series applies */
+pj_phi2_pre(double es, double *apa) {
+	return pj_phi2_pre_tol(es, apa, 0.);
+}
+
+	double
+pj_phi2_apa(double ts, const double *apa) {
+	double chi = HALFPI - 2. * atan(ts);
+	double t = chi + chi;
+
+	return (chi + apa[0] * sin(t) + apa[1] * sin(t+t) +
+	   apa[2] * sin(t+t+t) + apa[3] * sin(t+t+t+t));
+}
+
+	double /* store-free variant for batch kernels: never touches the
+	** ctx, flagging non-convergence with HUGE_VAL instead */
+pj_phi2_batch(double ts, PJ *P) {
+	double eccnth, Phi, con, dphi;
+	int i;
+
+	if (P->has_phi2_apa)
+		return pj_phi2_apa(ts, P->phi2_apa);
+	eccnth = .5 * P->e;
+	Phi = HALFPI - 2. * atan (ts);
+	i = N_ITER;
+	do {
+		con = P->e * sin (Phi);
+		dphi = HALFPI - 2. * atan (ts * pow((1. - con) /
+		   (1. + con), eccnth)) - Phi;
+		Phi += dphi;
+	} while ( fabs(dphi) > TOL && --i);
+	return i <= 0 ? HUGE_VAL : Phi;
+}
+
+	double /* series when precomputed on P, iteration otherwise */
+pj_phi2_(double ts, PJ *P) {
+	if (P->has_phi2_apa)
+		return pj_phi2_apa(ts, P->phi2_apa);
+	return pj_phi2(P->ctx, ts, P->e);
+}
@@ -0,0 +1,308 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Streaming transform pipeline.  The caller supplies a source
+ *           and a sink callback; the library runs double buffered chunks
+ *           so the transform of one chunk overlaps the I/O of its
+ *           neighbours, instead of every application reinventing the
+ *           read / transform / write threading.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+#include <errno.h>
+
+PJ_CVSID("$Id$");
+
+/* default chunk: 8192 points x 3 doubles x 2 buffers = 384K, sized to
+** stay resident in a typical L2/L3 while a chunk makes the full
+** read / transform / write round trip */
+#define PJ_PIPELINE_CHUNK 8192
+
+#ifdef MUTEX_pthread
+
+#include <pthread.h>
+
+/* one transform job handed from the I/O thread to the worker */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t  posted_cond;
+    pthread_cond_t  done_cond;
+
+    PJ         *srcdefn;
+    PJ         *dstdefn;
+
+    double     *x, *y, *z;      /* buffer posted for transforming */
+    long        count;
+    int         err;
+
+    int         posted;         /* a job is waiting for the worker */
+    int         done;           /* the last posted job has finished */
+    int         shutdown;
+} pj_pipeline_state;
+
+/************************************************************************/
+/*                         pj_pipeline_worker()                         */
+/************************************************************************/
+
+static void *pj_pipeline_worker( void *arg )
+
+{
+    pj_pipeline_state *state = (pj_pipeline_state *) arg;
+
+    pthread_mutex_lock( &state->mutex );
+    for( ; ; )
+    {
+        while( !state->posted && !state->shutdown )
+            pthread_cond_wait( &state->posted_cond, &state->mutex );
+
+        if( state->shutdown )
+            break;
+
+        state->posted = 0;
+        pthread_mutex_unlock( &state->mutex );
+
+        state->err = pj_transform( state->srcdefn, state->dstdefn,
+                                   state->count, 1,
+                                   state->x, state->y, state->z );
+
+        pthread_mutex_lock( &state->mutex );
+        state->done = 1;
+        pthread_cond_signal( &state->done_cond );
+    }
+    pthread_mutex_unlock( &state->mutex );
+
+    return NULL;
+}
+
+/************************************************************************/
+/*                       pj_transform_pipeline()                        */
+/*                                                                      */
+/*      Pull chunks of up to chunk_size points from the reader,         */
+/*      transform them from srcdefn to dstdefn, and push them to the    */
+/*      writer in order.  Two buffers alternate between the calling     */
+/*      thread (which does all the I/O) and a worker thread (which      */
+/*      does all the transforming), so the transform of chunk N runs    */
+/*      while chunk N-1 is written and chunk N+1 is read.               */
+/*                                                                      */
+/*      The reader returns the number of points produced, 0 at end      */
+/*      of input, or a negative value to abort.  The writer returns     */
+/*      zero on success or a nonzero value to abort.  Both are only     */
+/*      ever called from the thread that called us.                     */
+/************************************************************************/
+
+int pj_transform_pipeline( projPJ srcdefn, projPJ dstdefn, long chunk_size,
+                           projPipelineReader reader,
+                           projPipelineWriter writer,
+                           void *user_data )
+
+{
+    pj_pipeline_state state;
+    pthread_t worker;
+    double *buf;
+    double *bx[2], *by[2], *bz[2];
+    long    bcount[2];
+    int     cur = 0, pending = -1;
+    int     err = 0, eof = 0, have_worker;
+
+    if( chunk_size <= 0 )
+        chunk_size = PJ_PIPELINE_CHUNK;
+
+    buf = (double *) pj_ctx_buffer_get( pj_get_ctx(srcdefn),
+                                        sizeof(double) * 6 * chunk_size );
+    if( buf == NULL )
+    {
+        pj_ctx_set_errno( pj_get_ctx(srcdefn), ENOMEM );
+        return ENOMEM;
+    }
+
+    bx[0] = buf;                  by[0] = bx[0] + chunk_size;
+    bz[0] = by[0] + chunk_size;
+    bx[1] = bz[0] + chunk_size;   by[1] = bx[1] + chunk_size;
+    bz[1] = by[1] + chunk_size;
+
+    memset( &state, 0, sizeof(state) );
+    state.srcdefn = srcdefn;
+    state.dstdefn = dstdefn;
+    pthread_mutex_init( &state.mutex, NULL );
+    pthread_cond_init( &state.posted_cond, NULL );
+    pthread_cond_init( &state.done_cond, NULL );
+
+    have_worker = pthread_create( &worker, NULL,
+                                  pj_pipeline_worker, &state ) == 0;
+
+    while( !eof && err == 0 )
+    {
+        int pending_err = 0;
+
+        /* read the next chunk - overlaps the transform of `pending' */
+        long count = reader( user_data, chunk_size,
+                             bx[cur], by[cur], bz[cur] );
+
+        if( count < 0 )
+        {
+            err = (int) count;
+            break;
+        }
+        if( count == 0 )
+            eof = 1;
+        else
+            bcount[cur] = count;
+
+        /* finish the chunk in flight before reusing the mailbox */
+        if( pending >= 0 )
+        {
+            if( have_worker )
+            {
+                pthread_mutex_lock( &state.mutex );
+                while( !state.done )
+                    pthread_cond_wait( &state.done_cond, &state.mutex );
+                pthread_mutex_unlock( &state.mutex );
+            }
+            pending_err = state.err;
+        }
+
+        if( !eof )
+        {
+            if( have_worker )
+            {
+                pthread_mutex_lock( &state.mutex );
+                state.x = bx[cur];
+                state.y = by[cur];
+                state.z = bz[cur];
+                state.count = count;
+                state.done = 0;
+                state.err = 0;
+                state.posted = 1;
+                pthread_cond_signal( &state.posted_cond );
+                pthread_mutex_unlock( &state.mutex );
+            }
+            else
+            {
+                /* no worker available - transform inline */
+                state.err = pj_transform( srcdefn, dstdefn, count, 1,
+                                          bx[cur], by[cur], bz[cur] );
+                state.done = 1;
+            }
+        }
+
+        /* write the finished chunk - overlaps the transform of `cur' */
+        if( pending >= 0 )
+        {
+            if( pending_err != 0 )
+                err = pending_err;
+            else
+                err = writer( user_data, bcount[pending],
+                              bx[pending], by[pending], bz[pending] );
+        }
+
+        if( !eof )
+        {
+            pending = cur;
+            cur = !cur;
+        }
+        else
+            pending = -1;
+    }
+
+    /* on an abort a chunk may still be in flight - let it finish so
+       the worker is quiescent before we tear the state down */
+    if( pending >= 0 && have_worker )
+    {
+        pthread_mutex_lock( &state.mutex );
+        while( !state.done )
+            pthread_cond_wait( &state.done_cond, &state.mutex );
+        pthread_mutex_unlock( &state.mutex );
+    }
+
+    pthread_mutex_lock( &state.mutex );
+    state.shutdown = 1;
+    pthread_cond_signal( &state.posted_cond );
+    pthread_mutex_unlock( &state.mutex );
+    if( have_worker )
+        pthread_join( worker, NULL );
+
+    pthread_mutex_destroy( &state.mutex );
+    pthread_cond_destroy( &state.posted_cond );
+    pthread_cond_destroy( &state.done_cond );
+    pj_ctx_buffer_put( pj_get_ctx(srcdefn), buf );
+
+    return err;
+}
+
+#else /* !MUTEX_pthread */
+
+/************************************************************************/
+/*                       pj_transform_pipeline()                        */
+/*                                                                      */
+/*      No thread primitives on this platform - run the three stages    */
+/*      back to back on the calling thread.                             */
+/************************************************************************/
+
+int pj_transform_pipeline( projPJ srcdefn, projPJ dstdefn, long chunk_size,
+                           projPipelineReader reader,
+                           projPipelineWriter writer,
+                           void *user_data )
+
+{
+    double *buf;
+    int     err = 0;
+
+    if( chunk_size <= 0 )
+        chunk_size = PJ_PIPELINE_CHUNK;
+
+    buf = (double *) pj_ctx_buffer_get( pj_get_ctx(srcdefn),
+                                        sizeof(double) * 3 * chunk_size );
+    if( buf == NULL )
+    {
+        pj_ctx_set_errno( pj_get_ctx(srcdefn), ENOMEM );
+        return ENOMEM;
+    }
+
+    for( ; ; )
+    {
+        double *x = buf, *y = buf + chunk_size, *z = buf + 2*chunk_size;
+        long count = reader( user_data, chunk_size, x, y, z );
+
+        if( count <= 0 )
+        {
+            err = (int) count;
+            break;
+        }
+
+        err = pj_transform( srcdefn, dstdefn, count, 1, x, y, z );
+        if( err == 0 )
+            err = writer( user_data, count, x, y, z );
+        if( err != 0 )
+            break;
+    }
+
+    pj_ctx_buffer_put( pj_get_ctx(srcdefn), buf );
+
+    return err;
+}
+
+#endif /* MUTEX_pthread */
@@ -0,0 +1,219 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Optional persistent cache of expanded init file definitions.
+ *           The in-memory initcache (pj_initcache.c) only helps within a
+ *           process; deployments that spin up many short lived workers
+ *           pay the init file open/scan/parse again in every one.  When
+ *           PJ_PLAN_CACHE names a directory, each resolved file:code key
+ *           is also written there as a small text file of its expanded
+ *           parameter atoms, validated against the init file's size and
+ *           mtime and the library version, so later processes rebuild
+ *           the parameter list from the cache file without reading the
+ *           init file body at all.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+PJ_CVSID("$Id$");
+
+#define PJ_PLANCACHE_LINE_MAX 512
+
+static const char *plancache_dir = NULL;
+static int plancache_checked = 0;
+
+/************************************************************************/
+/*                          pj_plancache_path()                         */
+/*                                                                      */
+/*      Build the cache file path for a file:code key, or return 0      */
+/*      when no cache directory is configured.  Key characters          */
+/*      outside [A-Za-z0-9.-] become '_' so the key cannot escape       */
+/*      the cache directory.                                            */
+/************************************************************************/
+
+static int pj_plancache_path( const char *name, char *path, size_t size )
+
+{
+    size_t len, i;
+
+    if( !plancache_checked )
+    {
+        plancache_dir = getenv( "PJ_PLAN_CACHE" );
+        if( plancache_dir != NULL && plancache_dir[0] == '\0' )
+            plancache_dir = NULL;
+        plancache_checked = 1;
+    }
+
+    if( plancache_dir == NULL )
+        return 0;
+
+    len = strlen( plancache_dir );
+    if( len + strlen( name ) + 8 >= size )
+        return 0;
+
+    strcpy( path, plancache_dir );
+    path[len++] = DIR_CHAR;
+    for( i = 0; name[i] != '\0'; i++ )
+    {
+        char c = name[i];
+
+        if( (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')
+            || (c >= '0' && c <= '9') || c == '.' || c == '-' )
+            path[len++] = c;
+        else
+            path[len++] = '_';
+    }
+    strcpy( path + len, ".defn" );
+    return 1;
+}
+
+/************************************************************************/
+/*                        pj_plancache_lookup()                         */
+/*                                                                      */
+/*      Return the expanded parameter list for a file:code key, or      */
+/*      NULL on a miss.  A cache file whose recorded library version    */
+/*      or init file size/mtime no longer match is treated as a miss    */
+/*      (the next store overwrites it), as is any malformed content,    */
+/*      so torn writes from concurrent workers only cost a reparse.     */
+/************************************************************************/
+
+paralist *pj_plancache_lookup( projCtx ctx, const char *name,
+                               long mtime, long size )
+
+{
+    char path[MAX_PATH_FILENAME + ID_TAG_MAX + 8];
+    char line[PJ_PLANCACHE_LINE_MAX];
+    FILE *fp;
+    long f_version, f_mtime, f_size;
+    paralist *head = NULL, *tail = NULL;
+
+    (void) ctx;
+
+    if( !pj_plancache_path( name, path, sizeof(path) ) )
+        return NULL;
+
+    fp = fopen( path, "rt" );
+    if( fp == NULL )
+        return NULL;
+
+    if( fgets( line, sizeof(line), fp ) == NULL
+        || sscanf( line, "PJPLANCACHE %ld %ld %ld",
+                   &f_version, &f_mtime, &f_size ) != 3
+        || f_version != (long) PJ_VERSION
+        || f_mtime != mtime
+        || f_size != size )
+    {
+        fclose( fp );
+        return NULL;
+    }
+
+    while( fgets( line, sizeof(line), fp ) != NULL )
+    {
+        paralist *item;
+        size_t len = strlen( line );
+
+        while( len > 0 && (line[len-1] == '\n' || line[len-1] == '\r') )
+            line[--len] = '\0';
+        if( len == 0 )
+            continue;
+
+        item = pj_mkparam( line );
+        if( item == NULL )
+            break;
+        if( tail == NULL )
+            head = item;
+        else
+            tail->next = item;
+        tail = item;
+    }
+
+    /* an empty or truncated file yields nothing useful */
+    if( head == NULL || ferror( fp ) )
+    {
+        fclose( fp );
+        for( tail = head; tail != NULL; )
+        {
+            paralist *victim = tail;
+
+            tail = tail->next;
+            pj_dalloc( victim );
+        }
+        return NULL;
+    }
+
+    fclose( fp );
+    return head;
+}
+
+/************************************************************************/
+/*                         pj_plancache_store()                         */
+/*                                                                      */
+/*      Write the expanded parameter list for a file:code key.  The     */
+/*      file is written to a temporary name and renamed into place so   */
+/*      readers never see a half written entry; workers racing on the   */
+/*      same key write identical bytes, so the race is benign.          */
+/*      Failures are silent: the cache is best effort and the           */
+/*      in-memory path has already succeeded.                           */
+/************************************************************************/
+
+void pj_plancache_store( projCtx ctx, const char *name,
+                         long mtime, long size, const paralist *items )
+
+{
+    char path[MAX_PATH_FILENAME + ID_TAG_MAX + 8];
+    char tmp_path[MAX_PATH_FILENAME + ID_TAG_MAX + 40];
+    FILE *fp;
+    const paralist *item;
+
+    (void) ctx;
+
+    if( items == NULL
+        || !pj_plancache_path( name, path, sizeof(path) ) )
+        return;
+
+    sprintf( tmp_path, "%s.tmp", path );
+    fp = fopen( tmp_path, "wt" );
+    if( fp == NULL )
+        return;
+
+    fprintf( fp, "PJPLANCACHE %ld %ld %ld\n",
+             (long) PJ_VERSION, mtime, size );
+    for( item = items; item != NULL; item = item->next )
+        fprintf( fp, "%s\n", item->param );
+
+    if( fclose( fp ) != 0 )
+    {
+        remove( tmp_path );
+        return;
+    }
+
+    remove( path );
+    if( rename( tmp_path, path ) != 0 )
+        remove( tmp_path );
+}
@@ -0,0 +1,238 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Pool of initialized PJ objects for high churn workloads.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2001, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** Request handler style workloads create and destroy PJ objects at
+** high frequency over a tiny working set of definitions.  A pool
+** keeps released objects alive, keyed by the definition string they
+** were initialized from, so the next acquire of the same definition
+** reuses the object outright: no allocation, no parameter parsing,
+** no projection setup - only the context pointer is retargeted.  The
+** PJ block size depends on the projection type (PROJ_PARMS__), so
+** recycling whole initialized objects is also the only reuse the
+** generic layer can do without per projection knowledge.
+**
+** Like a projCtx, a pool is meant to be used from one thread at a
+** time; give each handler thread its own pool (and context).
+*/
+
+typedef struct projPoolEntry {
+    struct projPoolEntry *next; /* idle chain */
+    PJ            *pj;
+    char          *defn;        /* definition passed to acquire */
+    unsigned long  hash;
+} projPoolEntry;
+
+struct projPoolType {
+    projCtx        ctx;
+    projPoolEntry *idle;
+    int            idle_count;
+    int            max_idle;
+};
+
+#define PJ_POOL_DEFAULT_MAX_IDLE 16
+
+static unsigned long pj_pool_hash( const char *defn )
+
+{
+    unsigned long hash = 5381;
+
+    for( ; *defn != '\0'; defn++ )
+        hash = hash * 33 + (unsigned char) *defn;
+    return hash;
+}
+
+/************************************************************************/
+/*                           pj_pool_create()                           */
+/*                                                                      */
+/*      max_idle caps how many released objects are kept for reuse;     */
+/*      zero or negative selects a default.  A NULL context means       */
+/*      the default context.                                            */
+/************************************************************************/
+
+projPool pj_pool_create( projCtx ctx, int max_idle )
+
+{
+    struct projPoolType *pool;
+
+    pool = (struct projPoolType *) pj_malloc( sizeof(*pool) );
+    if( pool == NULL )
+        return NULL;
+    memset( pool, 0, sizeof(*pool) );
+    pool->ctx = ctx != NULL ? ctx : pj_get_default_ctx();
+    pool->max_idle = max_idle > 0 ? max_idle : PJ_POOL_DEFAULT_MAX_IDLE;
+
+    return (projPool) pool;
+}
+
+/************************************************************************/
+/*                          pj_pool_acquire()                           */
+/*                                                                      */
+/*      Return an initialized PJ for the definition, reusing a          */
+/*      released one when the definition string matches.  On a miss     */
+/*      this is exactly pj_init_plus_ctx(); NULL on failure with the    */
+/*      error in the pool's context.                                    */
+/************************************************************************/
+
+projPJ pj_pool_acquire( projPool pool_arg, const char *definition )
+
+{
+    struct projPoolType *pool = (struct projPoolType *) pool_arg;
+    projPoolEntry *entry, **prev;
+    unsigned long hash;
+    PJ *pj;
+
+    if( pool == NULL || definition == NULL )
+        return NULL;
+
+    hash = pj_pool_hash( definition );
+    for( prev = &pool->idle; (entry = *prev) != NULL;
+         prev = &entry->next )
+    {
+        if( entry->hash == hash && strcmp(entry->defn, definition) == 0 )
+        {
+            *prev = entry->next;
+            entry->next = NULL;
+            pool->idle_count--;
+            entry->pj->ctx = pool->ctx;
+            return (projPJ) entry->pj;
+        }
+    }
+
+    pj = (PJ *) pj_init_plus_ctx( pool->ctx, definition );
+    if( pj == NULL )
+        return NULL;
+
+    entry = (projPoolEntry *) pj_malloc( sizeof(*entry) );
+    if( entry != NULL )
+    {
+        entry->defn = (char *) pj_malloc( strlen(definition) + 1 );
+        if( entry->defn == NULL )
+        {
+            pj_dalloc( entry );
+            entry = NULL;
+        }
+    }
+    if( entry == NULL )
+    {
+        /* no pool bookkeeping - hand out a plain, unpooled object */
+        return (projPJ) pj;
+    }
+
+    strcpy( entry->defn, definition );
+    entry->next = NULL;
+    entry->pj = pj;
+    entry->hash = hash;
+    pj->pool_handle = entry;
+
+    return (projPJ) pj;
+}
+
+/************************************************************************/
+/*                          pj_pool_release()                           */
+/*                                                                      */
+/*      Give an acquired object back for reuse.  Objects that are       */
+/*      not pool managed (or when the idle cap is reached) are          */
+/*      simply freed.                                                   */
+/************************************************************************/
+
+void pj_pool_release( projPool pool_arg, projPJ pj_arg )
+
+{
+    struct projPoolType *pool = (struct projPoolType *) pool_arg;
+    PJ *pj = (PJ *) pj_arg;
+    projPoolEntry *entry;
+
+    if( pj == NULL )
+        return;
+
+    entry = (projPoolEntry *) pj->pool_handle;
+    if( pool == NULL || entry == NULL
+        || pool->idle_count >= pool->max_idle )
+    {
+        pj_free( pj );   /* drops the entry via pj_pool_note_free() */
+        return;
+    }
+
+    entry->next = pool->idle;
+    pool->idle = entry;
+    pool->idle_count++;
+}
+
+/************************************************************************/
+/*                          pj_pool_destroy()                           */
+/*                                                                      */
+/*      Free the pool and every idle object in it.  Objects still       */
+/*      acquired are unaffected (pj_free() them normally), but must     */
+/*      not be released into the destroyed pool.                       */
+/************************************************************************/
+
+void pj_pool_destroy( projPool pool_arg )
+
+{
+    struct projPoolType *pool = (struct projPoolType *) pool_arg;
+
+    if( pool == NULL )
+        return;
+
+    while( pool->idle != NULL )
+    {
+        projPoolEntry *entry = pool->idle;
+
+        pool->idle = entry->next;
+        pj_free( entry->pj );   /* frees the entry too */
+    }
+
+    pj_dalloc( pool );
+}
+
+/************************************************************************/
+/*                         pj_pool_note_free()                          */
+/*                                                                      */
+/*      Called from pj_free() so directly freed pooled objects do       */
+/*      not leak their pool bookkeeping.                                */
+/************************************************************************/
+
+void pj_pool_note_free( PJ *pj )
+
+{
+    projPoolEntry *entry = (projPoolEntry *) pj->pool_handle;
+
+    if( entry != NULL )
+    {
+        pj_dalloc( entry->defn );
+        pj_dalloc( entry );
+        pj->pool_handle = NULL;
+    }
+}
@@ -56,36 +56,162 @@ char *pj_get_def( PJ *P, int options )
 
 {
     paralist *t;
-    int l;
-    char *definition;
-    int  def_max = 10;
+    char *definition, *end;
+    size_t len = 1;
 
-    definition = (char *) pj_malloc(def_max);
-    definition[0] = '\0';
+    /* size the result in one pass so a single allocation suffices */
+    for (t = P->params; t; t = t->next)
+        if (t->used)
+            len += strlen(t->param) + 2;        /* " +" and the text */
+
+    definition = (char *) pj_malloc(len);
+    if (definition == NULL)
+        return NULL;
 
+    end = definition;
     for (t = P->params; t; t = t->next)
     {
         /* skip unused parameters ... mostly appended defaults and stuff */
         if (!t->used)
             continue;
 
-        /* grow the resulting string if needed */
-        l = strlen(t->param) + 1;
-        if( strlen(definition) + l + 5 > def_max )
-        {
-            char *def2;
+        /* append this parameter */
+        *end++ = ' ';
+        *end++ = '+';
+        strcpy( end, t->param );
+        end += strlen(t->param);
+    }
+    *end = '\0';
+
+    return definition;
+}
 
-            def_max = def_max * 2 + l + 5;
-            def2 = (char *) pj_malloc(def_max);
-            strcpy( def2, definition );
-            pj_dalloc( definition );
-            definition = def2;
+/************************************************************************/
+/*                           pj_get_def_buf()                           */
+/*                                                                      */
+/*      pj_get_def() into a caller supplied buffer: no allocation,      */
+/*      so audit/logging layers that serialize every object stop        */
+/*      generating allocator traffic.  Returns the length the full      */
+/*      definition needs (excluding the terminating NUL), like          */
+/*      snprintf(), so a return >= buflen means the output was          */
+/*      truncated; the buffer is always NUL terminated when             */
+/*      buflen > 0.                                                     */
+/************************************************************************/
+
+size_t pj_get_def_buf( PJ *P, int options, char *buf, size_t buflen )
+
+{
+    paralist *t;
+    size_t len = 0;     /* length the full definition needs */
+    size_t out = 0;     /* bytes actually written */
+
+    (void) options;
+    for (t = P->params; t; t = t->next)
+    {
+        size_t plen, avail, n;
+
+        if (!t->used)
+            continue;
+        plen = strlen(t->param);
+        if (buflen > 0)
+        {
+            avail = buflen - 1 - out;
+            if (avail > 0)
+                buf[out++] = ' ', avail--;
+            if (avail > 0)
+                buf[out++] = '+', avail--;
+            n = avail < plen ? avail : plen;
+            memcpy( buf + out, t->param, n );
+            out += n;
         }
+        len += plen + 2;
+    }
+    if (buflen > 0)
+        buf[out] = '\0';
+    return len;
+}
 
-        /* append this parameter */
-        strcat( definition, " +" );
-        strcat( definition, t->param );
+/************************************************************************/
+/*                         pj_get_def_interned()                        */
+/*                                                                      */
+/*      Return the canonical (sorted, fully expanded) definition        */
+/*      interned on the object at init time, or NULL when none was      */
+/*      recorded.  The string is owned by the PJ and lives until        */
+/*      pj_free(); extraction is a pointer read, serialization a        */
+/*      memcpy.  Note the canonical form covers the whole assembled     */
+/*      parameter list, not just the used entries - see                 */
+/*      pj_get_def_canonical() below.                                   */
+/************************************************************************/
+
+const char *pj_get_def_interned( PJ *P )
+
+{
+    return P != NULL ? P->defn_canonical : NULL;
+}
+
+/************************************************************************/
+/*                        pj_get_def_canonical()                        */
+/*                                                                      */
+/*      Like pj_get_def(), but the parameters are emitted in sorted     */
+/*      order, so two definitions built from the same atoms listed in   */
+/*      different orders yield the same string.  The whole assembled    */
+/*      list is included - not just the used entries - because the      */
+/*      used flags depend on whether the assembly came fresh or from    */
+/*      the definition cache, while the list itself is deterministic    */
+/*      for a given input.  pj_init_ctx() interns the result (and its   */
+/*      hash) on the PJ, which is what makes pj_is_same_definition()    */
+/*      and the pj_transform() identical CRS short circuit cheap.       */
+/************************************************************************/
+
+static int pj_def_atom_cmp( const void *a, const void *b )
+{
+    return strcmp( *(const char **) a, *(const char **) b );
+}
+
+char *pj_get_def_canonical( PJ *P )
+
+{
+    paralist *t;
+    const char **atoms;
+    char *definition, *end;
+    size_t len = 1;
+    int count = 0, i;
+
+    for (t = P->params; t; t = t->next)
+    {
+        len += strlen(t->param) + 2;
+        count++;
+    }
+
+    atoms = (const char **) pj_malloc(
+        (count > 0 ? count : 1) * sizeof(const char *));
+    if (atoms == NULL)
+        return NULL;
+
+    count = 0;
+    for (t = P->params; t; t = t->next)
+        atoms[count++] = t->param;
+
+    qsort( atoms, count, sizeof(const char *), pj_def_atom_cmp );
+
+    definition = (char *) pj_malloc(len);
+    if (definition == NULL)
+    {
+        pj_dalloc( (void *) atoms );
+        return NULL;
     }
 
+    end = definition;
+    for (i = 0; i < count; i++)
+    {
+        *end++ = ' ';
+        *end++ = '+';
+        strcpy( end, atoms[i] );
+        end += strlen(atoms[i]);
+    }
+    *end = '\0';
+
+    pj_dalloc( (void *) atoms );
+
     return definition;
 }
@@ -14,3 +14,24 @@ pj_qsfn(double sinphi, double e, double one_es) {
 	} else
 		return (sinphi + sinphi);
 }
+
+	void /* batch form over a contiguous array; the eccentricity test
+	** is hoisted out of the loop and the results are bit identical
+	** to pj_qsfn() per point */
+pj_qsfn_batch(long n, const double *sinphi, double e, double one_es,
+	double *out) {
+	long i;
+
+	if (e >= EPSILON) {
+		double half_re = .5 / e;
+
+		for (i = 0; i < n; ++i) {
+			double con = e * sinphi[i];
+
+			out[i] = one_es * (sinphi[i] / (1. - con * con) -
+			   half_re * log ((1. - con) / (1. + con)));
+		}
+	} else
+		for (i = 0; i < n; ++i)
+			out[i] = sinphi[i] + sinphi[i];
+}
@@ -0,0 +1,392 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Reference counted PJ lifetime with epoch based deferred
+ *           reclamation, so pipelined applications can pj_free() a
+ *           definition while other threads are still finishing batches
+ *           on it without wrapping every batch in their own lock.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** Two cooperating mechanisms:
+**
+**   Reference counting: pj_retain() adds a reference, pj_free() drops
+**   one, and only the last drop retires the object.  The count is a
+**   single atomic, so sharing one immutable PJ between threads costs
+**   nothing per batch - only per handoff.
+**
+**   Epoch reclamation: a thread that runs transforms over a PJ that
+**   some other thread may concurrently drop the last reference to
+**   brackets the work in pj_reclaim_enter()/pj_reclaim_exit().  Enter
+**   publishes the current global epoch in a per thread slot (a plain
+**   store and a barrier - no lock, no atomic read-modify-write, which
+**   is the whole point versus wrapper locks around PJ lifetime);
+**   retiring an object advances the epoch and parks the object on a
+**   limbo list stamped with the new value.  An object is only really
+**   destroyed once every published slot has moved past its stamp, so
+**   a reader that held the pointer across the retire can finish its
+**   batch on intact memory, and the retiring thread never waits for
+**   it.  Threads that never enter a section cost nothing and leave
+**   reclamation immediate.
+**
+** The slot table is fixed at the thread pool's own ceiling; threads
+** beyond it fall back to a shared "anonymous reader" count that
+** simply pins the limbo list while nonzero - safe, just coarser.
+** Like the thread pool this is pthread only; single threaded builds
+** reclaim immediately.
+*/
+
+/************************************************************************/
+/*                       reference count helpers                        */
+/************************************************************************/
+
+static int pj_refcount_add( PJ *P, int delta )
+
+{
+#if defined(__GNUC__)
+    return __sync_add_and_fetch( &P->refcount, delta );
+#else
+    int v;
+
+    pj_acquire_lock();
+    v = (P->refcount += delta);
+    pj_release_lock();
+    return v;
+#endif
+}
+
+/************************************************************************/
+/*                             pj_retain()                              */
+/*                                                                      */
+/*      Add a reference to a projection definition and return it, so    */
+/*      handoffs read naturally: consumer_pj = pj_retain(pj).  Each     */
+/*      reference is dropped with its own pj_free().                    */
+/************************************************************************/
+
+projPJ pj_retain( projPJ pj )
+
+{
+    if( pj != NULL )
+        pj_refcount_add( (PJ *) pj, 1 );
+    return pj;
+}
+
+/************************************************************************/
+/*                              pj_free()                               */
+/*                                                                      */
+/*      Drop one reference; the last drop retires the object, which     */
+/*      destroys it immediately unless a pj_reclaim_enter() section     */
+/*      elsewhere defers the teardown.  Objects that never met          */
+/*      pj_retain() carry the single reference pj_init gave them, so    */
+/*      for existing callers this is plain destruction as before.       */
+/************************************************************************/
+
+void pj_free( PJ *P )
+
+{
+    if( P == NULL )
+        return;
+
+    if( pj_refcount_add( P, -1 ) > 0 )
+        return;
+
+    pj_reclaim_retire( P );
+}
+
+#ifdef MUTEX_pthread
+
+#include <pthread.h>
+
+#define RECLAIM_SLOTS 64
+
+static pthread_mutex_t reclaim_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static volatile unsigned long reclaim_epoch = 1;
+static volatile unsigned long reclaim_slot[RECLAIM_SLOTS];
+static volatile char reclaim_slot_taken[RECLAIM_SLOTS];
+static volatile int reclaim_anon = 0;  /* readers beyond the slot table */
+
+static PJ *limbo_head = NULL;
+
+static pthread_key_t  reclaim_key;
+static pthread_once_t reclaim_key_once = PTHREAD_ONCE_INIT;
+
+/************************************************************************/
+/*                        reclaim_release_slot()                        */
+/*                                                                      */
+/*      Thread exit destructor: hand the slot back.  The thread is      */
+/*      outside any enter/exit section by definition here, so the       */
+/*      published epoch is already zero.                                */
+/************************************************************************/
+
+static void reclaim_release_slot( void *arg )
+
+{
+    volatile unsigned long *slot = (volatile unsigned long *) arg;
+
+    pthread_mutex_lock( &reclaim_mutex );
+    reclaim_slot_taken[slot - reclaim_slot] = 0;
+    pthread_mutex_unlock( &reclaim_mutex );
+}
+
+static void reclaim_make_key( void )
+
+{
+    pthread_key_create( &reclaim_key, reclaim_release_slot );
+}
+
+/************************************************************************/
+/*                          reclaim_my_slot()                           */
+/*                                                                      */
+/*      The calling thread's epoch slot, claimed on first use, or       */
+/*      NULL when the table is full.                                    */
+/************************************************************************/
+
+static volatile unsigned long *reclaim_my_slot( void )
+
+{
+    volatile unsigned long *slot;
+    int i;
+
+    pthread_once( &reclaim_key_once, reclaim_make_key );
+
+    slot = (volatile unsigned long *) pthread_getspecific( reclaim_key );
+    if( slot != NULL )
+        return slot;
+
+    pthread_mutex_lock( &reclaim_mutex );
+    for( i = 0; i < RECLAIM_SLOTS; i++ )
+    {
+        if( !reclaim_slot_taken[i] )
+        {
+            reclaim_slot_taken[i] = 1;
+            reclaim_slot[i] = 0;
+            slot = reclaim_slot + i;
+            break;
+        }
+    }
+    pthread_mutex_unlock( &reclaim_mutex );
+
+    if( slot != NULL )
+        pthread_setspecific( reclaim_key, (void *) slot );
+
+    return slot;
+}
+
+/************************************************************************/
+/*                          pj_reclaim_enter()                          */
+/*                                                                      */
+/*      Open a read side section: until the matching exit, no PJ        */
+/*      whose last reference is dropped by any thread will have its     */
+/*      memory released.  Nestable per thread only in the trivial       */
+/*      sense that re-entering just refreshes the published epoch;      */
+/*      one exit ends the section.                                      */
+/************************************************************************/
+
+void pj_reclaim_enter( void )
+
+{
+    volatile unsigned long *slot = reclaim_my_slot();
+
+    if( slot == NULL )
+    {
+#if defined(__GNUC__)
+        __sync_add_and_fetch( &reclaim_anon, 1 );
+#else
+        pthread_mutex_lock( &reclaim_mutex );
+        reclaim_anon++;
+        pthread_mutex_unlock( &reclaim_mutex );
+#endif
+        return;
+    }
+
+    /* publish and validate: the plain slot store can still be in
+    ** flight when a retiring thread scans the table, in which case
+    ** the sweep sees the slot empty and frees the object this
+    ** section was meant to protect.  So after the barrier re-read
+    ** the global epoch and republish until the published value is
+    ** current: once they agree, either the retirer saw our slot, or
+    ** we saw its advanced epoch and have published a value past the
+    ** one it is sweeping. */
+    for( ;; )
+    {
+        unsigned long e = reclaim_epoch;
+
+        *slot = e;
+#if defined(__GNUC__)
+        __sync_synchronize();
+#endif
+        if( reclaim_epoch == e )
+            break;
+    }
+}
+
+/************************************************************************/
+/*                          pj_reclaim_exit()                           */
+/************************************************************************/
+
+void pj_reclaim_exit( void )
+
+{
+    volatile unsigned long *slot;
+
+    pthread_once( &reclaim_key_once, reclaim_make_key );
+
+    slot = (volatile unsigned long *) pthread_getspecific( reclaim_key );
+    if( slot == NULL )
+    {
+        /* this thread entered anonymously (table was full) */
+#if defined(__GNUC__)
+        __sync_add_and_fetch( &reclaim_anon, -1 );
+#else
+        pthread_mutex_lock( &reclaim_mutex );
+        reclaim_anon--;
+        pthread_mutex_unlock( &reclaim_mutex );
+#endif
+        return;
+    }
+
+#if defined(__GNUC__)
+    __sync_synchronize();
+#endif
+    *slot = 0;
+}
+
+/************************************************************************/
+/*                        reclaim_sweep_locked()                        */
+/*                                                                      */
+/*      Destroy every limbo object whose retirement epoch is behind     */
+/*      all published reader epochs.  Returns the count still held.     */
+/************************************************************************/
+
+static int reclaim_sweep_locked( void )
+
+{
+    unsigned long min_epoch = (unsigned long) -1;
+    PJ *p, *next, *keep = NULL;
+    int i, pending = 0;
+
+    if( reclaim_anon > 0 )
+        min_epoch = 0;
+    else
+    {
+        for( i = 0; i < RECLAIM_SLOTS; i++ )
+        {
+            unsigned long e = reclaim_slot[i];
+
+            if( e != 0 && e < min_epoch )
+                min_epoch = e;
+        }
+    }
+
+    for( p = limbo_head; p != NULL; p = next )
+    {
+        next = p->reclaim_next;
+        if( p->retire_epoch < min_epoch )
+        {
+            p->reclaim_next = NULL;
+            pj_free_now( p );
+        }
+        else
+        {
+            p->reclaim_next = keep;
+            keep = p;
+            pending++;
+        }
+    }
+    limbo_head = keep;
+
+    return pending;
+}
+
+/************************************************************************/
+/*                         pj_reclaim_retire()                          */
+/*                                                                      */
+/*      Last reference gone: advance the epoch, park the object on      */
+/*      the limbo list stamped with the new value, and sweep.  With     */
+/*      no reader sections open the sweep frees it right here, so       */
+/*      callers that never use enter/exit keep eager destruction.       */
+/************************************************************************/
+
+void pj_reclaim_retire( PJ *P )
+
+{
+    pthread_mutex_lock( &reclaim_mutex );
+
+    P->retire_epoch = ++reclaim_epoch;
+#if defined(__GNUC__)
+    __sync_synchronize();
+#endif
+    P->reclaim_next = limbo_head;
+    limbo_head = P;
+
+    reclaim_sweep_locked();
+    pthread_mutex_unlock( &reclaim_mutex );
+}
+
+/************************************************************************/
+/*                          pj_reclaim_sweep()                          */
+/*                                                                      */
+/*      Free whatever deferred teardowns have become safe and return    */
+/*      the count still pending, for shutdown paths and leak checks.    */
+/************************************************************************/
+
+int pj_reclaim_sweep( void )
+
+{
+    int pending;
+
+    pthread_mutex_lock( &reclaim_mutex );
+    pending = reclaim_sweep_locked();
+    pthread_mutex_unlock( &reclaim_mutex );
+
+    return pending;
+}
+
+#else /* !MUTEX_pthread */
+
+/* without threads there are no concurrent readers to defer for */
+
+void pj_reclaim_enter( void ) {}
+void pj_reclaim_exit( void ) {}
+
+void pj_reclaim_retire( PJ *P )
+
+{
+    pj_free_now( P );
+}
+
+int pj_reclaim_sweep( void )
+
+{
+    return 0;
+}
+
+#endif /* MUTEX_pthread */
@@ -0,0 +1,166 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Sorted-index lookups over the static registries (projection
+ *           list, ellipsoids, datums, prime meridians, units).  The
+ *           registries themselves stay in their public declaration order;
+ *           a per table index of entry numbers sorted by id is built on
+ *           first use so lookups binary search instead of scanning.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2009, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+#include <stdlib.h>
+
+PJ_CVSID("$Id$");
+
+#define REGISTRY_MAX 8
+
+typedef struct {
+    const void *table;
+    size_t entry_size;
+    int count;
+    int *order;		/* entry numbers sorted by id */
+} pj_registry_index;
+
+static pj_registry_index registry[REGISTRY_MAX];
+static int registry_count = 0;
+
+/* every registry struct has the id as its first member */
+#define ENTRY_ID(tab,size,i) \
+    (*(const char * const *)((const char *)(tab) + (i)*(size)))
+
+static const void *sort_table;
+static size_t sort_entry_size;
+
+static int pj_registry_cmp( const void *a, const void *b )
+
+{
+    int ia = *(const int *) a, ib = *(const int *) b;
+    int result = strcmp( ENTRY_ID(sort_table,sort_entry_size,ia),
+                         ENTRY_ID(sort_table,sort_entry_size,ib) );
+
+    /* duplicate ids keep declaration order so the first entry wins,
+       as the old linear scan did */
+    if( result == 0 )
+        result = ia - ib;
+    return result;
+}
+
+/************************************************************************/
+/*                          pj_registry_find()                          */
+/*                                                                      */
+/*      Return the entry number of id in the NULL-id terminated         */
+/*      table, or -1 when absent.                                       */
+/************************************************************************/
+
+int pj_registry_find( const void *table, size_t entry_size, const char *id )
+
+{
+    pj_registry_index *idx = NULL;
+    int i, lo, hi;
+
+    for( i = 0; i < registry_count; i++ )
+    {
+        if( registry[i].table == table )
+        {
+            idx = registry + i;
+            break;
+        }
+    }
+
+    if( idx == NULL )
+    {
+        pj_acquire_lock();
+
+        for( i = 0; i < registry_count; i++ )
+        {
+            if( registry[i].table == table )
+                idx = registry + i;
+        }
+
+        if( idx == NULL && registry_count < REGISTRY_MAX )
+        {
+            int count;
+            int *order;
+
+            for( count = 0; ENTRY_ID(table,entry_size,count) != NULL;
+                 count++ ) {}
+
+            order = (int *) pj_malloc( sizeof(int) * (count > 0 ? count : 1) );
+            if( order != NULL )
+            {
+                for( i = 0; i < count; i++ )
+                    order[i] = i;
+                sort_table = table;
+                sort_entry_size = entry_size;
+                qsort( order, count, sizeof(int), pj_registry_cmp );
+
+                idx = registry + registry_count;
+                idx->entry_size = entry_size;
+                idx->count = count;
+                idx->order = order;
+                idx->table = table;	/* published last */
+                registry_count++;
+            }
+        }
+
+        pj_release_lock();
+
+        if( idx == NULL )
+        {
+            /* out of slots or memory - fall back to a linear scan */
+            for( i = 0; ENTRY_ID(table,entry_size,i) != NULL; i++ )
+            {
+                if( strcmp( ENTRY_ID(table,entry_size,i), id ) == 0 )
+                    return i;
+            }
+            return -1;
+        }
+    }
+
+    lo = 0;
+    hi = idx->count - 1;
+    while( lo <= hi )
+    {
+        int mid = (lo + hi) / 2;
+        int result = strcmp( ENTRY_ID(table,entry_size,idx->order[mid]), id );
+
+        if( result < 0 )
+            lo = mid + 1;
+        else if( result > 0 )
+            hi = mid - 1;
+        else
+        {
+            while( mid > 0
+                   && strcmp( ENTRY_ID(table,entry_size,
+                                       idx->order[mid-1]), id ) == 0 )
+                mid--;
+            return idx->order[mid];
+        }
+    }
+    return -1;
+}
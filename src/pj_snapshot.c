@@ -0,0 +1,382 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Transform result snapshots: run a transformation plan once
+ *           over a fixed coordinate mesh and replay the stored results
+ *           onto later datasets sharing the identical mesh, so a time
+ *           series of rasters with unchanging geometry pays for the
+ *           projection math once instead of once per dataset.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+#include <stdio.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** A snapshot is pure data: the exact results of one pj_transform_exec()
+** run, plus enough of a fingerprint of the input mesh to detect that a
+** later dataset's geometry differs.  The fingerprint is an FNV-1a hash
+** of the raw coordinate words together with the point count and the
+** exact first and last input coordinates, so accidental reuse against
+** a shifted or resampled mesh is caught; a deliberately constructed
+** collision is not defended against.  Because only raw words are
+** compared, the mesh must match bit for bit - which is exactly the
+** identical-geometry case the feature targets.
+*/
+
+struct projTransformSnapshotType {
+    long    point_count;
+    int     has_z;
+    unsigned int hash;        /* FNV-1a of the raw input words */
+    double  first_x, first_y, first_z;  /* exact endpoint guards */
+    double  last_x, last_y, last_z;
+    double  *out_x;           /* one allocation, packed */
+    double  *out_y;
+    double  *out_z;           /* NULL when has_z is false */
+};
+
+#define SNAP_MAGIC      "PJSNAP01"
+#define SNAP_MAGIC_LEN  8
+
+/************************************************************************/
+/*                            snap_hash()                               */
+/*                                                                      */
+/*      FNV-1a over the raw words of one strided coordinate array,      */
+/*      continuing from a running hash value.                           */
+/************************************************************************/
+
+static unsigned int snap_hash( unsigned int h, const double *v,
+                               long point_count, int point_offset )
+
+{
+    long i;
+    unsigned int w[2];
+
+    /* word rather than byte granularity: the fingerprint pass is most
+       of the replay cost, and 32 bit mixing steps keep it well above
+       the memcpy it gates */
+    for( i = 0; i < point_count; i++ )
+    {
+        memcpy( w, v + (size_t) point_offset * i, sizeof(double) );
+        h = (h ^ w[0]) * 16777619u;
+        h = (h ^ w[1]) * 16777619u;
+    }
+
+    return h;
+}
+
+#define SNAP_HASH_SEED 2166136261u
+
+/************************************************************************/
+/*                     pj_transform_snapshot_free()                     */
+/************************************************************************/
+
+void pj_transform_snapshot_free( projTransformSnapshot snap )
+
+{
+    if( snap != NULL )
+    {
+        pj_dalloc( snap->out_x );
+        pj_dalloc( snap );
+    }
+}
+
+/************************************************************************/
+/*                    pj_transform_snapshot_create()                    */
+/*                                                                      */
+/*      Run the plan once over the given coordinate mesh and capture    */
+/*      the results.  The caller's arrays are only read; the exec       */
+/*      runs on a private copy.  point_offset follows the               */
+/*      pj_transform() convention (0 or 1 for packed arrays).           */
+/*      Returns NULL when the mesh is malformed, memory runs out or     */
+/*      the plan fails hard on the mesh (per point failures become      */
+/*      HUGE_VAL lanes in the snapshot and replay as such).             */
+/************************************************************************/
+
+projTransformSnapshot pj_transform_snapshot_create(
+    projTransformPlan plan,
+    long point_count, int point_offset,
+    const double *x, const double *y, const double *z )
+
+{
+    struct projTransformSnapshotType *snap;
+    long i, last;
+    int  ncomp;
+
+    if( plan == NULL || point_count <= 0 || x == NULL || y == NULL )
+        return NULL;
+    if( point_offset == 0 )
+        point_offset = 1;
+
+    snap = (struct projTransformSnapshotType *)
+        pj_malloc( sizeof(*snap) );
+    if( snap == NULL )
+        return NULL;
+    memset( snap, 0, sizeof(*snap) );
+
+    snap->point_count = point_count;
+    snap->has_z = z != NULL;
+    ncomp = snap->has_z ? 3 : 2;
+
+    snap->out_x = (double *)
+        pj_malloc( sizeof(double) * ncomp * point_count );
+    if( snap->out_x == NULL )
+    {
+        pj_dalloc( snap );
+        return NULL;
+    }
+    snap->out_y = snap->out_x + point_count;
+    snap->out_z = snap->has_z ? snap->out_y + point_count : NULL;
+
+/* -------------------------------------------------------------------- */
+/*      Fingerprint the mesh and gather it packed into the result       */
+/*      arrays, then transform those in place.                          */
+/* -------------------------------------------------------------------- */
+    snap->hash = snap_hash( SNAP_HASH_SEED, x, point_count, point_offset );
+    snap->hash = snap_hash( snap->hash, y, point_count, point_offset );
+    if( snap->has_z )
+        snap->hash = snap_hash( snap->hash, z,
+                                point_count, point_offset );
+
+    last = (size_t) point_offset * (point_count - 1);
+    snap->first_x = x[0];
+    snap->first_y = y[0];
+    snap->last_x = x[last];
+    snap->last_y = y[last];
+    if( snap->has_z )
+    {
+        snap->first_z = z[0];
+        snap->last_z = z[last];
+    }
+
+    for( i = 0; i < point_count; i++ )
+    {
+        snap->out_x[i] = x[(size_t) point_offset * i];
+        snap->out_y[i] = y[(size_t) point_offset * i];
+    }
+    if( snap->has_z )
+        for( i = 0; i < point_count; i++ )
+            snap->out_z[i] = z[(size_t) point_offset * i];
+
+    if( pj_transform_exec( plan, point_count, 1,
+                           snap->out_x, snap->out_y, snap->out_z ) != 0 )
+    {
+        pj_transform_snapshot_free( snap );
+        return NULL;
+    }
+
+    return snap;
+}
+
+/************************************************************************/
+/*                    pj_transform_snapshot_apply()                     */
+/*                                                                      */
+/*      Replay the captured results onto a dataset whose coordinate     */
+/*      arrays hold the identical input mesh: the arrays are            */
+/*      fingerprinted and then simply overwritten with the stored       */
+/*      outputs, no projection math at all.  Returns 0 when applied,    */
+/*      1 when the mesh differs from the snapshot (the caller should    */
+/*      transform exactly and take a new snapshot; the arrays are       */
+/*      untouched), -1 for a malformed call.                            */
+/************************************************************************/
+
+int pj_transform_snapshot_apply( projTransformSnapshot snap,
+                                 long point_count, int point_offset,
+                                 double *x, double *y, double *z )
+
+{
+    unsigned int h;
+    long i, last;
+
+    if( snap == NULL || x == NULL || y == NULL )
+        return -1;
+    if( point_offset == 0 )
+        point_offset = 1;
+
+    if( point_count != snap->point_count
+        || (z != NULL) != snap->has_z )
+        return 1;
+
+    /* endpoint guards first: they reject a shifted mesh for the cost
+       of two loads, before the full fingerprint pass is paid */
+    last = (size_t) point_offset * (point_count - 1);
+    if( memcmp( &x[0], &snap->first_x, sizeof(double) ) != 0
+        || memcmp( &y[0], &snap->first_y, sizeof(double) ) != 0
+        || memcmp( &x[last], &snap->last_x, sizeof(double) ) != 0
+        || memcmp( &y[last], &snap->last_y, sizeof(double) ) != 0 )
+        return 1;
+    if( snap->has_z
+        && (memcmp( &z[0], &snap->first_z, sizeof(double) ) != 0
+            || memcmp( &z[last], &snap->last_z, sizeof(double) ) != 0) )
+        return 1;
+
+    h = snap_hash( SNAP_HASH_SEED, x, point_count, point_offset );
+    h = snap_hash( h, y, point_count, point_offset );
+    if( snap->has_z )
+        h = snap_hash( h, z, point_count, point_offset );
+    if( h != snap->hash )
+        return 1;
+
+    if( point_offset == 1 )
+    {
+        memcpy( x, snap->out_x, sizeof(double) * point_count );
+        memcpy( y, snap->out_y, sizeof(double) * point_count );
+        if( snap->has_z )
+            memcpy( z, snap->out_z, sizeof(double) * point_count );
+    }
+    else
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            x[(size_t) point_offset * i] = snap->out_x[i];
+            y[(size_t) point_offset * i] = snap->out_y[i];
+        }
+        if( snap->has_z )
+            for( i = 0; i < point_count; i++ )
+                z[(size_t) point_offset * i] = snap->out_z[i];
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                     pj_transform_snapshot_save()                     */
+/*                                                                      */
+/*      Serialize a snapshot to a file so later jobs over the same      */
+/*      geometry skip the projection math entirely.  The format is      */
+/*      raw native doubles behind a magic string - a cache artifact     */
+/*      for the machine that wrote it, not an interchange format.       */
+/*      Returns 0, or -1 on any I/O failure (the file is removed so     */
+/*      a truncated cache is never picked up).                          */
+/************************************************************************/
+
+int pj_transform_snapshot_save( projTransformSnapshot snap,
+                                const char *filename )
+
+{
+    FILE *fp;
+    long  ncomp;
+
+    if( snap == NULL || filename == NULL )
+        return -1;
+
+    fp = fopen( filename, "wb" );
+    if( fp == NULL )
+        return -1;
+
+    ncomp = snap->has_z ? 3 : 2;
+    if( fwrite( SNAP_MAGIC, SNAP_MAGIC_LEN, 1, fp ) != 1
+        || fwrite( &snap->point_count, sizeof(long), 1, fp ) != 1
+        || fwrite( &snap->has_z, sizeof(int), 1, fp ) != 1
+        || fwrite( &snap->hash, sizeof(unsigned int), 1, fp ) != 1
+        || fwrite( &snap->first_x, sizeof(double), 6, fp ) != 6
+        || fwrite( snap->out_x, sizeof(double),
+                   ncomp * snap->point_count, fp )
+            != (size_t) (ncomp * snap->point_count) )
+    {
+        fclose( fp );
+        remove( filename );
+        return -1;
+    }
+
+    if( fclose( fp ) != 0 )
+    {
+        remove( filename );
+        return -1;
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                     pj_transform_snapshot_load()                     */
+/*                                                                      */
+/*      Reload a snapshot written by pj_transform_snapshot_save() on    */
+/*      this machine.  Returns NULL when the file is missing, is not    */
+/*      a snapshot, or is truncated.                                    */
+/************************************************************************/
+
+projTransformSnapshot pj_transform_snapshot_load( const char *filename )
+
+{
+    struct projTransformSnapshotType *snap;
+    char magic[SNAP_MAGIC_LEN];
+    FILE *fp;
+    long  ncomp;
+
+    if( filename == NULL )
+        return NULL;
+
+    fp = fopen( filename, "rb" );
+    if( fp == NULL )
+        return NULL;
+
+    snap = (struct projTransformSnapshotType *)
+        pj_malloc( sizeof(*snap) );
+    if( snap == NULL )
+    {
+        fclose( fp );
+        return NULL;
+    }
+    memset( snap, 0, sizeof(*snap) );
+
+    if( fread( magic, SNAP_MAGIC_LEN, 1, fp ) != 1
+        || memcmp( magic, SNAP_MAGIC, SNAP_MAGIC_LEN ) != 0
+        || fread( &snap->point_count, sizeof(long), 1, fp ) != 1
+        || fread( &snap->has_z, sizeof(int), 1, fp ) != 1
+        || fread( &snap->hash, sizeof(unsigned int), 1, fp ) != 1
+        || fread( &snap->first_x, sizeof(double), 6, fp ) != 6
+        || snap->point_count <= 0
+        || (snap->has_z != 0 && snap->has_z != 1) )
+    {
+        fclose( fp );
+        pj_dalloc( snap );
+        return NULL;
+    }
+
+    ncomp = snap->has_z ? 3 : 2;
+    snap->out_x = (double *)
+        pj_malloc( sizeof(double) * ncomp * snap->point_count );
+    if( snap->out_x == NULL
+        || fread( snap->out_x, sizeof(double),
+                  ncomp * snap->point_count, fp )
+            != (size_t) (ncomp * snap->point_count)
+        || fgetc( fp ) != EOF )
+    {
+        fclose( fp );
+        pj_transform_snapshot_free( snap );
+        return NULL;
+    }
+    fclose( fp );
+
+    snap->out_y = snap->out_x + snap->point_count;
+    snap->out_z = snap->has_z
+        ? snap->out_y + snap->point_count : NULL;
+
+    return snap;
+}
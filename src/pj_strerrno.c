@@ -55,6 +55,7 @@ pj_err_list[] = {
 	"illegal axis orientation combination",		/* -47 */
 	"point not within available datum shift grids", /* -48 */
 	"invalid sweep axis, choose x or y",            /* -49 */
+	"datum shift grid still loading, retry",        /* -50 */
 };
 	char *
 pj_strerrno(int err) 
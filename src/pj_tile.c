@@ -0,0 +1,142 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Closed form web mercator (spherical mercator / EPSG:3857)
+ *           tile index helpers.  Tile services resolve millions of
+ *           (zoom, x, y) indices to geographic bounds for metadata
+ *           alone; running each corner through pj_transform() spends
+ *           far more on setup and dispatch than on the exp/atan the
+ *           conversion actually needs.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+
+PJ_CVSID("$Id$");
+
+#define PJ_TILE_MAX_ZOOM 30
+
+/************************************************************************/
+/*                            tile_lat()                                */
+/*                                                                      */
+/*      Latitude (degrees) of a tile row edge: the inverse spherical    */
+/*      mercator of y = PI * (1 - 2 * row / 2^zoom), matching the       */
+/*      PJ_merc.c math with the earth radius cancelled out.             */
+/************************************************************************/
+
+static double tile_lat( double row, double inv_n )
+
+{
+    return atan( sinh( PI * (1.0 - 2.0 * row * inv_n) ) ) * RAD_TO_DEG;
+}
+
+/************************************************************************/
+/*                    pj_webmercator_tile_bounds()                      */
+/*                                                                      */
+/*      Geographic (EPSG:4326, decimal degree) bounds of one XYZ        */
+/*      scheme web mercator tile, written as west, south, east,         */
+/*      north.  Row 0 is the northernmost, as served by every slippy    */
+/*      map tile service.  Returns 0, or -1 when zoom or the indices    */
+/*      are out of range, leaving bounds untouched.                     */
+/************************************************************************/
+
+int pj_webmercator_tile_bounds( int zoom, long tile_x, long tile_y,
+                                double *bounds )
+
+{
+    double inv_n;
+
+    if( bounds == NULL
+        || zoom < 0 || zoom > PJ_TILE_MAX_ZOOM
+        || tile_x < 0 || tile_x >= (1L << zoom)
+        || tile_y < 0 || tile_y >= (1L << zoom) )
+        return -1;
+
+    inv_n = 1.0 / (double) (1L << zoom);
+
+    bounds[0] = tile_x * inv_n * 360.0 - 180.0;
+    bounds[1] = tile_lat( (double) (tile_y + 1), inv_n );
+    bounds[2] = (tile_x + 1) * inv_n * 360.0 - 180.0;
+    bounds[3] = tile_lat( (double) tile_y, inv_n );
+
+    return 0;
+}
+
+/************************************************************************/
+/*                 pj_webmercator_tile_bounds_batch()                   */
+/*                                                                      */
+/*      As pj_webmercator_tile_bounds() over index arrays, writing      */
+/*      four doubles per tile.  Metadata sweeps walk a tile matrix      */
+/*      row by row, so the latitude pair - the only transcendental      */
+/*      work - is reused across runs of equal tile_y and most tiles     */
+/*      cost four multiplies.  A tile with out of range indices gets    */
+/*      HUGE_VAL bounds and is counted; the count is returned, or -1    */
+/*      for a malformed call (no bounds array, zoom out of range).      */
+/************************************************************************/
+
+long pj_webmercator_tile_bounds_batch( int zoom, long count,
+                                       const long *tile_x,
+                                       const long *tile_y,
+                                       double *bounds )
+
+{
+    double inv_n;
+    long n, i, nbad = 0;
+    long last_y = -1;
+    double last_south = 0.0, last_north = 0.0;
+
+    if( bounds == NULL || zoom < 0 || zoom > PJ_TILE_MAX_ZOOM )
+        return -1;
+
+    n = 1L << zoom;
+    inv_n = 1.0 / (double) n;
+
+    for( i = 0; i < count; i++ )
+    {
+        double *b = bounds + 4 * i;
+
+        if( tile_x[i] < 0 || tile_x[i] >= n
+            || tile_y[i] < 0 || tile_y[i] >= n )
+        {
+            b[0] = b[1] = b[2] = b[3] = HUGE_VAL;
+            nbad++;
+            continue;
+        }
+
+        if( tile_y[i] != last_y )
+        {
+            last_y = tile_y[i];
+            last_south = tile_lat( (double) (last_y + 1), inv_n );
+            last_north = tile_lat( (double) last_y, inv_n );
+        }
+
+        b[0] = tile_x[i] * inv_n * 360.0 - 180.0;
+        b[1] = last_south;
+        b[2] = (tile_x[i] + 1) * inv_n * 360.0 - 180.0;
+        b[3] = last_north;
+    }
+
+    return nbad;
+}
@@ -0,0 +1,489 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Shared worker thread pool.  Parallel features (chunked
+ *           pj_transform(), background grid loading) route their work
+ *           through one lazily started, process lifetime pool instead
+ *           of spawning threads per call.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <stdlib.h>
+
+PJ_CVSID("$Id$");
+
+/*
+** One process wide pool, sized from PJ_NUM_THREADS (else the online
+** processor count) and started on first use.  Two entry points:
+**
+**   pj_tpool_run()    - run a batch of tasks and wait for all of them.
+**                       The calling thread is a full participant: it
+**                       executes queued tasks (its own batch's or any
+**                       other caller's) while it waits, so the pool
+**                       spawns size-1 worker threads and concurrency
+**                       including callers never exceeds the size.
+**   pj_tpool_submit() - queue one fire and forget task (background
+**                       grid loads).  Never blocks; the caller must
+**                       fall back to inline work when it fails.
+**
+** Nested parallelism degrades gracefully instead of oversubscribing:
+** a pj_tpool_run() from inside a pool worker runs its batch inline on
+** that worker (the pool is already saturated by definition), and
+** helping callers shrink the thread demand of overlapping batches.
+*/
+
+#ifdef MUTEX_pthread
+
+#include <pthread.h>
+#include <unistd.h>
+
+#define PJ_TPOOL_MAX_THREADS 64
+
+typedef struct pjTpoolTask {
+    struct pjTpoolTask *next;
+    void (*func)(void *);
+    void  *arg;
+    int   *pending;  /* batch countdown, NULL for fire and forget */
+} pjTpoolTask;
+
+static pthread_mutex_t tpool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  tpool_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  tpool_done_cond = PTHREAD_COND_INITIALIZER;
+static pjTpoolTask    *tpool_head = NULL;
+static pjTpoolTask    *tpool_tail = NULL;
+static int             tpool_size = -1;  /* -1 until first decided */
+static int             tpool_workers = 0;
+
+static pthread_key_t   tpool_worker_key;
+static pthread_once_t  tpool_key_once = PTHREAD_ONCE_INIT;
+
+static void pj_tpool_make_key( void )
+
+{
+    pthread_key_create( &tpool_worker_key, NULL );
+}
+
+/************************************************************************/
+/*                       pj_tpool_decide_size()                         */
+/************************************************************************/
+
+static int pj_tpool_decide_size( void )
+
+{
+    const char *override = getenv( "PJ_NUM_THREADS" );
+    int size = 0;
+
+    if( override != NULL )
+        size = atoi( override );
+#ifdef _SC_NPROCESSORS_ONLN
+    if( size <= 0 )
+        size = (int) sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+    if( size <= 0 )
+        size = 4;
+    if( size > PJ_TPOOL_MAX_THREADS )
+        size = PJ_TPOOL_MAX_THREADS;
+
+    return size;
+}
+
+/************************************************************************/
+/*                     pj_tpool_complete_locked()                       */
+/*                                                                      */
+/*      Post-run bookkeeping for one task, under the pool mutex.        */
+/************************************************************************/
+
+static void pj_tpool_complete_locked( pjTpoolTask *task )
+
+{
+    if( task->pending != NULL )
+    {
+        if( --(*task->pending) == 0 )
+            pthread_cond_broadcast( &tpool_done_cond );
+    }
+    else
+        pj_dalloc( task );
+}
+
+/************************************************************************/
+/*                          pj_tpool_worker()                           */
+/************************************************************************/
+
+static void *pj_tpool_worker( void *arg )
+
+{
+    (void) arg;
+
+    pthread_once( &tpool_key_once, pj_tpool_make_key );
+    pthread_setspecific( tpool_worker_key, (void *) &tpool_worker_key );
+
+    pthread_mutex_lock( &tpool_mutex );
+    for( ; ; )
+    {
+        pjTpoolTask *task;
+
+        while( tpool_head == NULL )
+            pthread_cond_wait( &tpool_work_cond, &tpool_mutex );
+
+        task = tpool_head;
+        tpool_head = task->next;
+        if( tpool_head == NULL )
+            tpool_tail = NULL;
+
+        pthread_mutex_unlock( &tpool_mutex );
+        task->func( task->arg );
+        pthread_mutex_lock( &tpool_mutex );
+
+        pj_tpool_complete_locked( task );
+    }
+
+    /* not reached - workers live for the process */
+    return NULL;
+}
+
+/************************************************************************/
+/*                       pj_tpool_start_locked()                        */
+/*                                                                      */
+/*      Make sure size-1 workers are running.  Returns the number       */
+/*      of live workers (0 means callers must work inline).             */
+/************************************************************************/
+
+static int pj_tpool_start_locked( void )
+
+{
+    if( tpool_size < 0 )
+        tpool_size = pj_tpool_decide_size();
+
+    while( tpool_workers < tpool_size - 1 )
+    {
+        pthread_t thread;
+        pthread_attr_t attr;
+        int failed;
+
+        pthread_attr_init( &attr );
+        pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+        failed = pthread_create( &thread, &attr, pj_tpool_worker, NULL );
+        pthread_attr_destroy( &attr );
+
+        if( failed )
+            break;
+        tpool_workers++;
+    }
+
+    return tpool_workers;
+}
+
+/************************************************************************/
+/*                        pj_tpool_on_worker()                          */
+/************************************************************************/
+
+static int pj_tpool_on_worker( void )
+
+{
+    pthread_once( &tpool_key_once, pj_tpool_make_key );
+    return pthread_getspecific( tpool_worker_key ) != NULL;
+}
+
+/************************************************************************/
+/*                           pj_tpool_run()                             */
+/*                                                                      */
+/*      Run count tasks (func over each args[i]) and return when all    */
+/*      of them have finished.  Always succeeds: with no pool (size     */
+/*      1, thread creation failure, or called from a pool worker)       */
+/*      the batch simply runs inline on the calling thread.             */
+/************************************************************************/
+
+void pj_tpool_run( void (*func)(void *), void **args, int count )
+
+{
+    pjTpoolTask *tasks;
+    int          pending, i;
+
+    if( count <= 0 )
+        return;
+
+    if( count == 1 || pj_tpool_on_worker() )
+    {
+        for( i = 0; i < count; i++ )
+            func( args[i] );
+        return;
+    }
+
+    tasks = (pjTpoolTask *) pj_malloc( sizeof(pjTpoolTask) * count );
+
+    pthread_mutex_lock( &tpool_mutex );
+    if( tasks == NULL || pj_tpool_start_locked() == 0 )
+    {
+        pthread_mutex_unlock( &tpool_mutex );
+        if( tasks != NULL )
+            pj_dalloc( tasks );
+        for( i = 0; i < count; i++ )
+            func( args[i] );
+        return;
+    }
+
+    pending = count;
+    for( i = 0; i < count; i++ )
+    {
+        tasks[i].next = NULL;
+        tasks[i].func = func;
+        tasks[i].arg = args[i];
+        tasks[i].pending = &pending;
+        if( tpool_tail != NULL )
+            tpool_tail->next = &tasks[i];
+        else
+            tpool_head = &tasks[i];
+        tpool_tail = &tasks[i];
+    }
+    pthread_cond_broadcast( &tpool_work_cond );
+
+    /* help: drain queued tasks (ours or any other batch's) while our
+       countdown is positive, sleeping only when the queue is empty */
+    while( pending > 0 )
+    {
+        pjTpoolTask *task = tpool_head;
+
+        if( task != NULL )
+        {
+            tpool_head = task->next;
+            if( tpool_head == NULL )
+                tpool_tail = NULL;
+
+            pthread_mutex_unlock( &tpool_mutex );
+            task->func( task->arg );
+            pthread_mutex_lock( &tpool_mutex );
+
+            pj_tpool_complete_locked( task );
+        }
+        else
+            pthread_cond_wait( &tpool_done_cond, &tpool_mutex );
+    }
+    pthread_mutex_unlock( &tpool_mutex );
+
+    pj_dalloc( tasks );
+}
+
+/************************************************************************/
+/*                          pj_tpool_submit()                           */
+/*                                                                      */
+/*      Queue one fire and forget task.  Returns 0 when queued, -1      */
+/*      when no pool is available - the caller then does the work       */
+/*      itself (inline, or however it handled it before).  Never        */
+/*      blocks.                                                         */
+/************************************************************************/
+
+int pj_tpool_submit( void (*func)(void *), void *arg )
+
+{
+    pjTpoolTask *task = (pjTpoolTask *) pj_malloc( sizeof(pjTpoolTask) );
+
+    if( task == NULL )
+        return -1;
+
+    pthread_mutex_lock( &tpool_mutex );
+    if( pj_tpool_start_locked() == 0 )
+    {
+        pthread_mutex_unlock( &tpool_mutex );
+        pj_dalloc( task );
+        return -1;
+    }
+
+    task->next = NULL;
+    task->func = func;
+    task->arg = arg;
+    task->pending = NULL;
+    if( tpool_tail != NULL )
+        tpool_tail->next = task;
+    else
+        tpool_head = task;
+    tpool_tail = task;
+
+    pthread_cond_signal( &tpool_work_cond );
+    pthread_mutex_unlock( &tpool_mutex );
+
+    return 0;
+}
+
+/************************************************************************/
+/*                        pj_thread_pool_size()                         */
+/************************************************************************/
+
+int pj_thread_pool_size( void )
+
+{
+    int size;
+
+    pthread_mutex_lock( &tpool_mutex );
+    if( tpool_size < 0 )
+        tpool_size = pj_tpool_decide_size();
+    size = tpool_size;
+    pthread_mutex_unlock( &tpool_mutex );
+
+    return size;
+}
+
+/************************************************************************/
+/*                      pj_thread_pool_set_size()                       */
+/*                                                                      */
+/*      Override PJ_NUM_THREADS/processor count sizing.  Growing        */
+/*      takes effect on the next parallel call; started workers are     */
+/*      never torn down, so shrinking below the number already          */
+/*      running only limits future growth.  size <= 0 re-enables        */
+/*      automatic sizing.                                               */
+/************************************************************************/
+
+void pj_thread_pool_set_size( int size )
+
+{
+    if( size > PJ_TPOOL_MAX_THREADS )
+        size = PJ_TPOOL_MAX_THREADS;
+
+    pthread_mutex_lock( &tpool_mutex );
+    tpool_size = size > 0 ? size : pj_tpool_decide_size();
+    pthread_mutex_unlock( &tpool_mutex );
+}
+
+#else /* !MUTEX_pthread */
+
+/************************************************************************/
+/*      No thread primitives on this platform: batches run inline,      */
+/*      fire and forget submissions report failure so callers do the    */
+/*      work themselves.                                                */
+/************************************************************************/
+
+void pj_tpool_run( void (*func)(void *), void **args, int count )
+
+{
+    int i;
+
+    for( i = 0; i < count; i++ )
+        func( args[i] );
+}
+
+int pj_tpool_submit( void (*func)(void *), void *arg )
+
+{
+    (void) func;
+    (void) arg;
+    return -1;
+}
+
+int pj_thread_pool_size( void )
+
+{
+    return 1;
+}
+
+void pj_thread_pool_set_size( int size )
+
+{
+    (void) size;
+}
+
+#endif /* MUTEX_pthread */
+
+/************************************************************************/
+/*                       pj_numa_spread_touch()                         */
+/*                                                                      */
+/*      Optional NUMA placement for big shared allocations (grid        */
+/*      cvs arrays): freshly malloced pages take their home node        */
+/*      from whoever touches them first, so faulting the block in       */
+/*      from every pool worker spreads the pages over the nodes the     */
+/*      workers run on instead of leaving them all local to the         */
+/*      loading thread.  Enabled by setting PJ_NUMA_SPREAD in the       */
+/*      environment; a no-op for small blocks, a size-1 pool, or a      */
+/*      NULL pointer.  Safe to call under the grids write lock: the     */
+/*      touch tasks take no locks, and if every worker is blocked       */
+/*      the help-first queue has the caller run them itself.            */
+/************************************************************************/
+
+#define PJ_NUMA_SPREAD_MIN   (1024 * 1024)
+#define PJ_NUMA_PAGE         4096
+
+typedef struct {
+    char   *base;
+    size_t  size;
+} pjTouchSpan;
+
+static void pj_numa_touch_worker( void *arg )
+
+{
+    pjTouchSpan *span = (pjTouchSpan *) arg;
+    size_t off;
+
+    for( off = 0; off < span->size; off += PJ_NUMA_PAGE )
+        span->base[off] = 0;
+}
+
+void pj_numa_spread_touch( void *mem, size_t size )
+
+{
+    static int enabled = -1;
+    pjTouchSpan *spans;
+    void **args;
+    size_t chunk;
+    int i, count;
+
+    if( enabled < 0 )
+        enabled = getenv( "PJ_NUMA_SPREAD" ) != NULL;
+
+    count = pj_thread_pool_size();
+    if( !enabled || mem == NULL || size < PJ_NUMA_SPREAD_MIN
+        || count < 2 )
+        return;
+
+    spans = (pjTouchSpan *) pj_malloc( sizeof(pjTouchSpan) * count );
+    args = (void **) pj_malloc( sizeof(void *) * count );
+    if( spans == NULL || args == NULL )
+    {
+        pj_dalloc( spans );
+        pj_dalloc( args );
+        return;
+    }
+
+    /* page aligned chunks, the last one taking the remainder */
+    chunk = ((size / count) / PJ_NUMA_PAGE) * PJ_NUMA_PAGE;
+    if( chunk == 0 )
+        chunk = PJ_NUMA_PAGE;
+    for( i = 0; i < count; i++ )
+    {
+        size_t start = chunk * i;
+
+        if( start >= size )
+        {
+            count = i;
+            break;
+        }
+        spans[i].base = (char *) mem + start;
+        spans[i].size = i == count - 1 ? size - start : chunk;
+        args[i] = spans + i;
+    }
+
+    pj_tpool_run( pj_numa_touch_worker, args, count );
+
+    pj_dalloc( spans );
+    pj_dalloc( args );
+}
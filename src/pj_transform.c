@@ -32,14 +32,11 @@
 #include <projects.h>
 #include <string.h>
 #include <math.h>
+#include <errno.h>
 #include "geocent.h"
 
 PJ_CVSID("$Id$");
 
-static int pj_adjust_axis( projCtx ctx, const char *axis, int denormalize_flag,
-                           long point_count, int point_offset, 
-                           double *x, double *y, double *z );
-
 #ifndef SRS_WGS84_SEMIMAJOR
 #define SRS_WGS84_SEMIMAJOR 6378137.0
 #endif
@@ -58,7 +55,7 @@ static int pj_adjust_axis( projCtx ctx, const char *axis, int denormalize_flag,
 
 /* 
 ** This table is intended to indicate for any given error code in 
-** the range 0 to -44, whether that error will occur for all locations (ie.
+** the range 0 to -50, whether that error will occur for all locations (ie.
 ** it is a problem with the coordinate system as a whole) in which case the
 ** value would be 0, or if the problem is with the point being transformed
 ** in which case the value is 1. 
@@ -67,57 +64,282 @@ static int pj_adjust_axis( projCtx ctx, const char *axis, int denormalize_flag,
 ** list or something, but while experimenting with it this should be fine. 
 */
 
-static const int transient_error[50] = {
+const int pj_transient_error[51] = {
     /*             0  1  2  3  4  5  6  7  8  9   */
-    /* 0 to 9 */   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-    /* 10 to 19 */ 0, 0, 0, 0, 1, 1, 0, 1, 1, 1,  
-    /* 20 to 29 */ 1, 0, 0, 0, 0, 0, 0, 1, 0, 0, 
-    /* 30 to 39 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-    /* 40 to 49 */ 0, 0, 0, 0, 0, 0, 0, 0, 1, 0 };
+    /* 0 to 9 */   0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* 10 to 19 */ 0, 0, 0, 0, 1, 1, 0, 1, 1, 1,
+    /* 20 to 29 */ 1, 0, 0, 0, 0, 0, 0, 1, 0, 0,
+    /* 30 to 39 */ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    /* 40 to 49 */ 0, 0, 0, 0, 0, 0, 0, 0, 1, 0,
+    /* 50       */ 0 };
 
 /************************************************************************/
 /*                            pj_transform()                            */
-/*                                                                      */
-/*      Currently this function doesn't recognise if two projections    */
-/*      are identical (to short circuit reprojection) because it is     */
-/*      difficult to compare PJ structures (since there are some        */
-/*      projection specific components).                                */
 /************************************************************************/
 
 int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
                   double *x, double *y, double *z )
 
+{
+/* -------------------------------------------------------------------- */
+/*      Short circuit if source and destination are the same CRS,       */
+/*      recognized via the canonicalized definitions cached at init     */
+/*      time.  Skipped when the destination requests longitude          */
+/*      wrapping, which the full pipeline would still apply.            */
+/* -------------------------------------------------------------------- */
+    if( !dstdefn->is_long_wrap_set
+        && (srcdefn == dstdefn
+            || (srcdefn->defn_hash != 0
+                && srcdefn->defn_hash == dstdefn->defn_hash
+                && srcdefn->defn_canonical != NULL
+                && dstdefn->defn_canonical != NULL
+                && strcmp( srcdefn->defn_canonical,
+                           dstdefn->defn_canonical ) == 0)) )
+    {
+        pj_ctx_set_errno( srcdefn->ctx, 0 );
+        pj_ctx_set_errno( dstdefn->ctx, 0 );
+        return 0;
+    }
+
+    /* deferred setup must complete before the stages below inspect
+       the fwd/inv capabilities */
+    if( srcdefn->setup_state != PJ_SETUP_READY && pj_setup_finalize(srcdefn) )
+        return pj_ctx_get_errno( srcdefn->ctx );
+    if( dstdefn->setup_state != PJ_SETUP_READY && pj_setup_finalize(dstdefn) )
+        return pj_ctx_get_errno( dstdefn->ctx );
+
+    if( srcdefn->ctx->transform_threads > 1 )
+        return pj_transform_mt( srcdefn, dstdefn, point_count, point_offset,
+                                x, y, z );
+
+    return pj_transform_range( srcdefn, dstdefn, point_count, point_offset,
+                               x, y, z );
+}
+
+/* chunk size for the gather and float32 front ends below: big enough
+** to amortize per-call pipeline overhead, small enough that the three
+** scratch arrays stay cache resident */
+#define PJ_GATHER_CHUNK 16384
+
+/************************************************************************/
+/*                          pj_transform_f()                            */
+/*                                                                      */
+/*      float32 front end for callers whose data lives in float         */
+/*      vertex buffers.  Widening to float64 for the whole array up     */
+/*      front would double the caller's memory traffic; instead the     */
+/*      conversion happens per cache resident chunk around the          */
+/*      regular double pipeline, so floats are read and written once    */
+/*      and the doubles never leave cache.  A float kernel path was     */
+/*      considered and rejected: several projections iterate to         */
+/*      float-level tolerances internally, and keeping the math in      */
+/*      double costs nothing once the chunk is cached.  Results are     */
+/*      the double pipeline's rounded once to float; failed points      */
+/*      carry over as the float infinity.                               */
+/************************************************************************/
+
+int pj_transform_f( PJ *srcdefn, PJ *dstdefn, long point_count,
+                    int point_offset, float *x, float *y, float *z )
+
+{
+    double   *buf, *bx, *by, *bz;
+    long      i, done = 0;
+    int       err;
+
+    if( point_offset == 0 )
+        point_offset = 1;
+
+    buf = (double *) pj_ctx_buffer_get(
+        srcdefn->ctx, sizeof(double) * 3 * PJ_GATHER_CHUNK );
+    if( buf == NULL )
+    {
+        pj_ctx_set_errno( srcdefn->ctx, ENOMEM );
+        return ENOMEM;
+    }
+    bx = buf;
+    by = buf + PJ_GATHER_CHUNK;
+    bz = z != NULL ? buf + 2 * PJ_GATHER_CHUNK : NULL;
+
+    err = 0;
+    while( done < point_count && err == 0 )
+    {
+        long chunk = point_count - done;
+        float *sx = x + point_offset * done;
+        float *sy = y + point_offset * done;
+        float *sz = z != NULL ? z + point_offset * done : NULL;
+
+        if( chunk > PJ_GATHER_CHUNK )
+            chunk = PJ_GATHER_CHUNK;
+        /* never leave a trailing chunk of one point: a one point
+           call fails hard on transient errors, which a larger call
+           would only flag with HUGE_VAL */
+        if( point_count - done - chunk == 1 )
+            chunk--;
+
+        for( i = 0; i < chunk; i++ )
+        {
+            bx[i] = sx[point_offset*i];
+            by[i] = sy[point_offset*i];
+        }
+        if( z != NULL )
+            for( i = 0; i < chunk; i++ )
+                bz[i] = sz[point_offset*i];
+
+        err = pj_transform( srcdefn, dstdefn, chunk, 1, bx, by, bz );
+
+        for( i = 0; i < chunk; i++ )
+        {
+            sx[point_offset*i] = (float) bx[i];
+            sy[point_offset*i] = (float) by[i];
+        }
+        if( z != NULL )
+            for( i = 0; i < chunk; i++ )
+                sz[point_offset*i] = (float) bz[i];
+
+        done += chunk;
+    }
+
+    pj_ctx_buffer_put( srcdefn->ctx, buf );
+    return err;
+}
+
+/************************************************************************/
+/*                         pj_transform_range()                         */
+/*                                                                      */
+/*      The serial transformation pipeline.  pj_transform() runs it     */
+/*      over the whole array; pj_transform_mt() runs it over one        */
+/*      chunk per worker thread.                                        */
+/************************************************************************/
+
+int pj_transform_range( PJ *srcdefn, PJ *dstdefn,
+                        long point_count, int point_offset,
+                        double *x, double *y, double *z )
+
 {
     long      i;
     int       err;
 
-    srcdefn->ctx->last_errno = 0;
-    dstdefn->ctx->last_errno = 0;
+    pj_ctx_set_errno( srcdefn->ctx, 0 );
+    pj_ctx_set_errno( dstdefn->ctx, 0 );
 
     if( point_offset == 0 )
         point_offset = 1;
 
 /* -------------------------------------------------------------------- */
-/*      Transform unusual input coordinate axis orientation to          */
-/*      standard form if needed.                                        */
+/*      Fast path for affine-only pairs: latlong to latlong on the      */
+/*      same datum reduces to a constant longitude offset (prime        */
+/*      meridians) and a constant z scale (vertical units), so run      */
+/*      one fused pass instead of the separate per point loops below.   */
 /* -------------------------------------------------------------------- */
-    if( strcmp(srcdefn->axis,"enu") != 0 )
+    if( srcdefn->is_latlong && dstdefn->is_latlong
+        && !srcdefn->has_geoid_vgrids && !dstdefn->has_geoid_vgrids
+        && !dstdefn->is_long_wrap_set
+        && strcmp(srcdefn->axis,"enu") == 0
+        && strcmp(dstdefn->axis,"enu") == 0
+        && (srcdefn->datum_type == PJD_UNKNOWN
+            || dstdefn->datum_type == PJD_UNKNOWN
+            || pj_compare_datums( srcdefn, dstdefn )) )
     {
-        int err;
+        double xoff = srcdefn->from_greenwich - dstdefn->from_greenwich;
+        double zscale = srcdefn->vto_meter * dstdefn->vfr_meter;
 
-        err = pj_adjust_axis( srcdefn->ctx, srcdefn->axis, 
-                              0, point_count, point_offset, x, y, z );
-        if( err != 0 )
+        if( xoff != 0.0 )
+        {
+            for( i = 0; i < point_count; i++ )
+            {
+                if( x[point_offset*i] != HUGE_VAL )
+                    x[point_offset*i] += xoff;
+            }
+        }
+        if( zscale != 1.0 && z != NULL )
+        {
+            for( i = 0; i < point_count; i++ )
+                z[point_offset*i] *= zscale;
+        }
+        return 0;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Strided input (interleaved xyz buffers and the like) makes      */
+/*      every loop below a gather; instead copy chunks into             */
+/*      contiguous working arrays from the context buffer pool, run     */
+/*      the whole pipeline contiguous (batch kernels, fused edge        */
+/*      passes), and scatter the results back.  If the pool cannot      */
+/*      provide the scratch we simply stay on the strided loops.        */
+/* -------------------------------------------------------------------- */
+    if( point_offset != 1 && point_count > 1 )
+    {
+        double *buf = (double *) pj_ctx_buffer_get(
+            srcdefn->ctx, sizeof(double) * 3 * PJ_GATHER_CHUNK );
+
+        if( buf != NULL )
+        {
+            long done = 0;
+
+            err = 0;
+            while( done < point_count && err == 0 )
+            {
+                long chunk = point_count - done;
+                double *bx = buf, *by = buf + PJ_GATHER_CHUNK;
+                double *bz = z != NULL ? buf + 2 * PJ_GATHER_CHUNK : NULL;
+                double *sx = x + point_offset * done;
+                double *sy = y + point_offset * done;
+                double *sz = z != NULL ? z + point_offset * done : NULL;
+
+                if( chunk > PJ_GATHER_CHUNK )
+                    chunk = PJ_GATHER_CHUNK;
+                /* never leave a trailing chunk of one point: a one
+                   point call fails hard on transient errors, which a
+                   larger strided call would only flag with HUGE_VAL */
+                if( point_count - done - chunk == 1 )
+                    chunk--;
+
+                for( i = 0; i < chunk; i++ )
+                {
+                    bx[i] = sx[point_offset*i];
+                    by[i] = sy[point_offset*i];
+                }
+                if( z != NULL )
+                    for( i = 0; i < chunk; i++ )
+                        bz[i] = sz[point_offset*i];
+
+                err = pj_transform_range( srcdefn, dstdefn, chunk, 1,
+                                          bx, by, bz );
+
+                for( i = 0; i < chunk; i++ )
+                {
+                    sx[point_offset*i] = bx[i];
+                    sy[point_offset*i] = by[i];
+                }
+                if( z != NULL )
+                    for( i = 0; i < chunk; i++ )
+                        sz[point_offset*i] = bz[i];
+
+                done += chunk;
+            }
+
+            pj_ctx_buffer_put( srcdefn->ctx, buf );
             return err;
+        }
     }
 
 /* -------------------------------------------------------------------- */
-/*      Transform Z to meters if it isn't already.                      */
+/*      Fused source edge pass: axis normalization, vertical units      */
+/*      and (for geocentric input) horizontal units in one sweep        */
+/*      over the arrays instead of one strided loop each.               */
 /* -------------------------------------------------------------------- */
-    if( srcdefn->vto_meter != 1.0 && z != NULL )
     {
-        for( i = 0; i < point_count; i++ )
-            z[point_offset*i] *= srcdefn->vto_meter;
+        double xy_scale = srcdefn->is_geocent && z != NULL
+            ? srcdefn->to_meter : 1.0;
+
+        if( strcmp(srcdefn->axis,"enu") != 0
+            || xy_scale != 1.0 || srcdefn->vto_meter != 1.0 )
+        {
+            err = pj_affine_edge( srcdefn->ctx, srcdefn->axis, 0,
+                                  xy_scale, 0.0, srcdefn->vto_meter,
+                                  point_count, point_offset, x, y, z );
+            if( err != 0 )
+                return err;
+        }
     }
 
 /* -------------------------------------------------------------------- */
@@ -131,18 +353,7 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
             return PJD_ERR_GEOCENTRIC;
         }
 
-        if( srcdefn->to_meter != 1.0 )
-        {
-            for( i = 0; i < point_count; i++ )
-            {
-                if( x[point_offset*i] != HUGE_VAL )
-                {
-                    x[point_offset*i] *= srcdefn->to_meter;
-                    y[point_offset*i] *= srcdefn->to_meter;
-                }
-            }
-        }
-
+        /* to_meter already applied by the fused source edge pass */
         err = pj_geocentric_to_geodetic( srcdefn->a_orig, srcdefn->es_orig,
                                          point_count, point_offset, 
                                          x, y, z );
@@ -159,40 +370,57 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
         if( srcdefn->inv == NULL )
         {
             pj_ctx_set_errno( pj_get_ctx(srcdefn), -17 );
-            pj_log( pj_get_ctx(srcdefn), PJ_LOG_ERROR, 
+            pj_log( pj_get_ctx(srcdefn), PJ_LOG_ERROR,
                     "pj_transform(): source projection not invertable" );
             return -17;
         }
 
-        for( i = 0; i < point_count; i++ )
+        /* contiguous arrays over a projection with a batch kernel run
+           as one fused pass (unit descale, kernel, lam0/adjlon) instead
+           of per point pj_inv() scaffolding.  Failed points come back
+           as HUGE_VAL with the transient -15, which is what the per
+           point loop below degrades them to for multi point calls. */
+        if( point_offset == 1 && point_count > 1
+            && srcdefn->inv_batch != NULL && pj_use_batch_kernels() )
+        {
+            pj_inv_batch( srcdefn, point_count, x, y, x, y );
+        }
+        else
         {
-            XY         projected_loc;
-            LP	       geodetic_loc;
+            /* private to the thread under a diagnostics scope, so the
+               per point polling never bounces between workers */
+            int *err_addr = pj_diag_errno_addr( srcdefn->ctx );
 
-            projected_loc.u = x[point_offset*i];
-            projected_loc.v = y[point_offset*i];
+            for( i = 0; i < point_count; i++ )
+            {
+                XY         projected_loc;
+                LP	   geodetic_loc;
 
-            if( projected_loc.u == HUGE_VAL )
-                continue;
+                projected_loc.u = x[point_offset*i];
+                projected_loc.v = y[point_offset*i];
 
-            geodetic_loc = pj_inv( projected_loc, srcdefn );
-            if( srcdefn->ctx->last_errno != 0 )
-            {
-                if( (srcdefn->ctx->last_errno != 33 /*EDOM*/ 
-                     && srcdefn->ctx->last_errno != 34 /*ERANGE*/ )
-                    && (srcdefn->ctx->last_errno > 0 
-                        || srcdefn->ctx->last_errno < -44 || point_count == 1
-                        || transient_error[-srcdefn->ctx->last_errno] == 0 ) )
-                    return srcdefn->ctx->last_errno;
-                else
+                if( projected_loc.u == HUGE_VAL )
+                    continue;
+
+                geodetic_loc = pj_inv( projected_loc, srcdefn );
+                if( *err_addr != 0 )
                 {
-                    geodetic_loc.u = HUGE_VAL;
-                    geodetic_loc.v = HUGE_VAL;
+                    if( (*err_addr != 33 /*EDOM*/
+                         && *err_addr != 34 /*ERANGE*/ )
+                        && (*err_addr > 0
+                            || *err_addr < -44 || point_count == 1
+                            || pj_transient_error[-*err_addr] == 0 ) )
+                        return *err_addr;
+                    else
+                    {
+                        geodetic_loc.u = HUGE_VAL;
+                        geodetic_loc.v = HUGE_VAL;
+                    }
                 }
-            }
 
-            x[point_offset*i] = geodetic_loc.u;
-            y[point_offset*i] = geodetic_loc.v;
+                x[point_offset*i] = geodetic_loc.u;
+                y[point_offset*i] = geodetic_loc.v;
+            }
         }
     }
 /* -------------------------------------------------------------------- */
@@ -214,7 +442,7 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
 /* -------------------------------------------------------------------- */
     if( srcdefn->has_geoid_vgrids )
     {
-        if( pj_apply_vgridshift( srcdefn, "sgeoidgrids", 
+        if( pj_apply_vgridshift( srcdefn, 
                                  &(srcdefn->vgridlist_geoid), 
                                  &(srcdefn->vgridlist_geoid_count),
                                  0, point_count, point_offset, x, y, z ) != 0 )
@@ -224,13 +452,13 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
 /* -------------------------------------------------------------------- */
 /*      Convert datums if needed, and possible.                         */
 /* -------------------------------------------------------------------- */
-    if( pj_datum_transform( srcdefn, dstdefn, point_count, point_offset, 
+    if( pj_datum_transform( srcdefn, dstdefn, point_count, point_offset,
                             x, y, z ) != 0 )
     {
-        if( srcdefn->ctx->last_errno != 0 )
-            return srcdefn->ctx->last_errno;
+        if( pj_ctx_get_errno( srcdefn->ctx ) != 0 )
+            return pj_ctx_get_errno( srcdefn->ctx );
         else
-            return dstdefn->ctx->last_errno;
+            return pj_ctx_get_errno( dstdefn->ctx );
     }
 
 /* -------------------------------------------------------------------- */
@@ -239,11 +467,11 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
 /* -------------------------------------------------------------------- */
     if( dstdefn->has_geoid_vgrids )
     {
-        if( pj_apply_vgridshift( dstdefn, "sgeoidgrids", 
+        if( pj_apply_vgridshift( dstdefn, 
                                  &(dstdefn->vgridlist_geoid), 
                                  &(dstdefn->vgridlist_geoid_count),
                                  1, point_count, point_offset, x, y, z ) != 0 )
-            return dstdefn->ctx->last_errno;
+            return pj_ctx_get_errno( dstdefn->ctx );
     }
         
 /* -------------------------------------------------------------------- */
@@ -273,18 +501,7 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
 
         pj_geodetic_to_geocentric( dstdefn->a_orig, dstdefn->es_orig,
                                    point_count, point_offset, x, y, z );
-
-        if( dstdefn->fr_meter != 1.0 )
-        {
-            for( i = 0; i < point_count; i++ )
-            {
-                if( x[point_offset*i] != HUGE_VAL )
-                {
-                    x[point_offset*i] *= dstdefn->fr_meter;
-                    y[point_offset*i] *= dstdefn->fr_meter;
-                }
-            }
-        }
+        /* fr_meter is applied by the fused destination edge pass */
     }
 
 /* -------------------------------------------------------------------- */
@@ -293,35 +510,52 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
 /* -------------------------------------------------------------------- */
     else if( !dstdefn->is_latlong )
     {
-        for( i = 0; i < point_count; i++ )
+        /* as on the source side: a contiguous call against a batch
+           kernel (the latlong to web mercator case above all) fuses
+           the overrange checks, lam0/adjlon, projection and false
+           origin scaling into one pass over the arrays, bypassing the
+           per point pj_fwd() scaffolding. */
+        if( point_offset == 1 && point_count > 1
+            && dstdefn->fwd_batch != NULL && pj_use_batch_kernels() )
         {
-            XY         projected_loc;
-            LP	       geodetic_loc;
+            pj_fwd_batch( dstdefn, point_count, x, y, x, y );
+        }
+        else
+        {
+            /* private to the thread under a diagnostics scope, as on
+               the source side */
+            int *err_addr = pj_diag_errno_addr( dstdefn->ctx );
 
-            geodetic_loc.u = x[point_offset*i];
-            geodetic_loc.v = y[point_offset*i];
+            for( i = 0; i < point_count; i++ )
+            {
+                XY         projected_loc;
+                LP	   geodetic_loc;
 
-            if( geodetic_loc.u == HUGE_VAL )
-                continue;
+                geodetic_loc.u = x[point_offset*i];
+                geodetic_loc.v = y[point_offset*i];
 
-            projected_loc = pj_fwd( geodetic_loc, dstdefn );
-            if( dstdefn->ctx->last_errno != 0 )
-            {
-                if( (dstdefn->ctx->last_errno != 33 /*EDOM*/ 
-                     && dstdefn->ctx->last_errno != 34 /*ERANGE*/ )
-                    && (dstdefn->ctx->last_errno > 0 
-                        || dstdefn->ctx->last_errno < -44 || point_count == 1
-                        || transient_error[-dstdefn->ctx->last_errno] == 0 ) )
-                    return dstdefn->ctx->last_errno;
-                else
+                if( geodetic_loc.u == HUGE_VAL )
+                    continue;
+
+                projected_loc = pj_fwd( geodetic_loc, dstdefn );
+                if( *err_addr != 0 )
                 {
-                    projected_loc.u = HUGE_VAL;
-                    projected_loc.v = HUGE_VAL;
+                    if( (*err_addr != 33 /*EDOM*/
+                         && *err_addr != 34 /*ERANGE*/ )
+                        && (*err_addr > 0
+                            || *err_addr < -44 || point_count == 1
+                            || pj_transient_error[-*err_addr] == 0 ) )
+                        return *err_addr;
+                    else
+                    {
+                        projected_loc.u = HUGE_VAL;
+                        projected_loc.v = HUGE_VAL;
+                    }
                 }
-            }
 
-            x[point_offset*i] = projected_loc.u;
-            y[point_offset*i] = projected_loc.v;
+                x[point_offset*i] = projected_loc.u;
+                y[point_offset*i] = projected_loc.v;
+            }
         }
     }
 
@@ -331,39 +565,30 @@ int pj_transform( PJ *srcdefn, PJ *dstdefn, long point_count, int point_offset,
 /* -------------------------------------------------------------------- */
     else if( dstdefn->is_latlong && dstdefn->is_long_wrap_set )
     {
-        for( i = 0; i < point_count; i++ )
-        {
-            if( x[point_offset*i] == HUGE_VAL )
-                continue;
-
-            while( x[point_offset*i] < dstdefn->long_wrap_center - PI )
-                x[point_offset*i] += TWOPI;
-            while( x[point_offset*i] > dstdefn->long_wrap_center + PI )
-                x[point_offset*i] -= TWOPI;
-        }
+        adjlon_batch( x, point_count, point_offset,
+                      dstdefn->long_wrap_center );
     }
 
 /* -------------------------------------------------------------------- */
-/*      Transform Z from meters if needed.                              */
+/*      Fused destination edge pass: horizontal units (geocentric       */
+/*      output), vertical units and axis denormalization in one         */
+/*      sweep over the arrays.                                          */
 /* -------------------------------------------------------------------- */
-    if( dstdefn->vto_meter != 1.0 && z != NULL )
     {
-        for( i = 0; i < point_count; i++ )
-            z[point_offset*i] *= dstdefn->vfr_meter;
-    }
+        double xy_scale = dstdefn->is_geocent && z != NULL
+            ? dstdefn->fr_meter : 1.0;
+        double z_scale = dstdefn->vto_meter != 1.0
+            ? dstdefn->vfr_meter : 1.0;
 
-/* -------------------------------------------------------------------- */
-/*      Transform normalized axes into unusual output coordinate axis   */
-/*      orientation if needed.                                          */
-/* -------------------------------------------------------------------- */
-    if( strcmp(dstdefn->axis,"enu") != 0 )
-    {
-        int err;
-
-        err = pj_adjust_axis( dstdefn->ctx, dstdefn->axis, 
-                              1, point_count, point_offset, x, y, z );
-        if( err != 0 )
-            return err;
+        if( strcmp(dstdefn->axis,"enu") != 0
+            || xy_scale != 1.0 || z_scale != 1.0 )
+        {
+            err = pj_affine_edge( dstdefn->ctx, dstdefn->axis, 1,
+                                  xy_scale, 0.0, z_scale,
+                                  point_count, point_offset, x, y, z );
+            if( err != 0 )
+                return err;
+        }
     }
 
     return 0;
@@ -379,9 +604,7 @@ int pj_geodetic_to_geocentric( double a, double es,
 
 {
     double b;
-    int    i;
     GeocentricInfo gi;
-    int ret_errno = 0;
 
     if( es == 0.0 )
         b = a;
@@ -393,23 +616,14 @@ int pj_geodetic_to_geocentric( double a, double es,
         return PJD_ERR_GEOCENTRIC;
     }
 
-    for( i = 0; i < point_count; i++ )
-    {
-        long io = i * point_offset;
-
-        if( x[io] == HUGE_VAL  )
-            continue;
+    /* the batch conversion marks failed points HUGE_VAL itself
+       and keeps processing the rest */
+    if( pj_Convert_Geodetic_To_Geocentric_Batch( &gi, point_count,
+                                                 point_offset,
+                                                 x, y, z ) != 0 )
+        return -14;
 
-        if( pj_Convert_Geodetic_To_Geocentric( &gi, y[io], x[io], z[io], 
-                                               x+io, y+io, z+io ) != 0 )
-        {
-            ret_errno = -14;
-            x[io] = y[io] = HUGE_VAL;
-            /* but keep processing points! */
-        }
-    }
-
-    return ret_errno;
+    return 0;
 }
 
 /************************************************************************/
@@ -422,7 +636,6 @@ int pj_geocentric_to_geodetic( double a, double es,
 
 {
     double b;
-    int    i;
     GeocentricInfo gi;
 
     if( es == 0.0 )
@@ -435,16 +648,8 @@ int pj_geocentric_to_geodetic( double a, double es,
         return PJD_ERR_GEOCENTRIC;
     }
 
-    for( i = 0; i < point_count; i++ )
-    {
-        long io = i * point_offset;
-
-        if( x[io] == HUGE_VAL )
-            continue;
-
-        pj_Convert_Geocentric_To_Geodetic( &gi, x[io], y[io], z[io], 
-                                           y+io, x+io, z+io );
-    }
+    pj_Convert_Geocentric_To_Geodetic_Batch( &gi, point_count, point_offset,
+                                             x, y, z );
 
     return 0;
 }
@@ -456,7 +661,7 @@ int pj_geocentric_to_geodetic( double a, double es,
 /*      FALSE.                                                          */
 /************************************************************************/
 
-int pj_compare_datums( PJ *srcdefn, PJ *dstdefn )
+static int pj_compare_datums_raw( PJ *srcdefn, PJ *dstdefn )
 
 {
     if( srcdefn->datum_type != dstdefn->datum_type )
@@ -488,105 +693,165 @@ int pj_compare_datums( PJ *srcdefn, PJ *dstdefn )
     }
     else if( srcdefn->datum_type == PJD_GRIDSHIFT )
     {
-        return strcmp( pj_param(srcdefn->ctx, srcdefn->params,"snadgrids").s,
-                       pj_param(dstdefn->ctx, dstdefn->params,"snadgrids").s ) == 0;
+        if( srcdefn->nadgrids != NULL && dstdefn->nadgrids != NULL )
+            return strcmp( srcdefn->nadgrids, dstdefn->nadgrids ) == 0;
+
+        /* catalog based gridshifts carry no nadgrids value */
+        if( srcdefn->catalog_name != NULL && dstdefn->catalog_name != NULL )
+            return strcmp( srcdefn->catalog_name,
+                           dstdefn->catalog_name ) == 0
+                && srcdefn->datum_date == dstdefn->datum_date;
+
+        return 0;
     }
     else
         return 1;
 }
 
+int pj_compare_datums( PJ *srcdefn, PJ *dstdefn )
+
+{
+    /* transformations tend to be applied between the same PJ pair over
+       and over, so the answer for the last peer is memoized; the peer's
+       definition hash guards against its address having been recycled
+       for a different definition (PJs are immutable once initialized) */
+    if( srcdefn->datum_cmp_peer == dstdefn
+        && srcdefn->datum_cmp_peer_hash == dstdefn->defn_hash )
+        return srcdefn->datum_cmp_same;
+
+    srcdefn->datum_cmp_same = pj_compare_datums_raw( srcdefn, dstdefn );
+    srcdefn->datum_cmp_peer = dstdefn;
+    srcdefn->datum_cmp_peer_hash = dstdefn->defn_hash;
+
+    return srcdefn->datum_cmp_same;
+}
+
 /************************************************************************/
-/*                       pj_geocentic_to_wgs84()                        */
+/*                          pj_helmert_setup()                          */
+/*                                                                      */
+/*      Precompute the matrix forms of the 3/7 parameter datum shift    */
+/*      to and from WGS84 (row major 3x3 in [0..8], translation in      */
+/*      [9..11]).  Called from pj_datum_set() once the parameters are   */
+/*      final, so the per point loops below reduce to one affine        */
+/*      apply with no branches on datum_type.                           */
 /************************************************************************/
 
-int pj_geocentric_to_wgs84( PJ *defn, 
-                            long point_count, int point_offset,
-                            double *x, double *y, double *z )
+void pj_helmert_setup( PJ *defn )
 
 {
-    int       i;
+    double *fwd = defn->helmert_to_wgs84;
+    double *inv = defn->helmert_from_wgs84;
+    int i;
 
-    if( defn->datum_type == PJD_3PARAM )
-    {
-        for( i = 0; i < point_count; i++ )
-        {
-            long io = i * point_offset;
-            
-            if( x[io] == HUGE_VAL )
-                continue;
-
-            x[io] = x[io] + Dx_BF;
-            y[io] = y[io] + Dy_BF;
-            z[io] = z[io] + Dz_BF;
-        }
-    }
-    else if( defn->datum_type == PJD_7PARAM )
-    {
-        for( i = 0; i < point_count; i++ )
-        {
-            long io = i * point_offset;
-            double x_out, y_out, z_out;
-
-            if( x[io] == HUGE_VAL )
-                continue;
+    if( defn->datum_type != PJD_3PARAM && defn->datum_type != PJD_7PARAM )
+        return;
 
-            x_out = M_BF*(       x[io] - Rz_BF*y[io] + Ry_BF*z[io]) + Dx_BF;
-            y_out = M_BF*( Rz_BF*x[io] +       y[io] - Rx_BF*z[io]) + Dy_BF;
-            z_out = M_BF*(-Ry_BF*x[io] + Rx_BF*y[io] +       z[io]) + Dz_BF;
+    for( i = 0; i < 12; i++ )
+        fwd[i] = inv[i] = 0.0;
+    fwd[0] = fwd[4] = fwd[8] = 1.0;
+    inv[0] = inv[4] = inv[8] = 1.0;
 
-            x[io] = x_out;
-            y[io] = y_out;
-            z[io] = z_out;
-        }
+    if( defn->datum_type == PJD_7PARAM )
+    {
+        fwd[0] =  M_BF;       fwd[1] = -M_BF*Rz_BF; fwd[2] =  M_BF*Ry_BF;
+        fwd[3] =  M_BF*Rz_BF; fwd[4] =  M_BF;       fwd[5] = -M_BF*Rx_BF;
+        fwd[6] = -M_BF*Ry_BF; fwd[7] =  M_BF*Rx_BF; fwd[8] =  M_BF;
+
+        /* the inverse as historically applied: transposed small angle
+           rotation of the descaled, untranslated point */
+        inv[0] =  1.0/M_BF;   inv[1] =  Rz_BF/M_BF; inv[2] = -Ry_BF/M_BF;
+        inv[3] = -Rz_BF/M_BF; inv[4] =  1.0/M_BF;   inv[5] =  Rx_BF/M_BF;
+        inv[6] =  Ry_BF/M_BF; inv[7] = -Rx_BF/M_BF; inv[8] =  1.0/M_BF;
     }
 
-    return 0;
+    fwd[9]  = Dx_BF;
+    fwd[10] = Dy_BF;
+    fwd[11] = Dz_BF;
+    inv[9]  = -(inv[0]*Dx_BF + inv[1]*Dy_BF + inv[2]*Dz_BF);
+    inv[10] = -(inv[3]*Dx_BF + inv[4]*Dy_BF + inv[5]*Dz_BF);
+    inv[11] = -(inv[6]*Dx_BF + inv[7]*Dy_BF + inv[8]*Dz_BF);
 }
 
 /************************************************************************/
-/*                      pj_geocentic_from_wgs84()                       */
+/*                          pj_helmert_apply()                          */
 /************************************************************************/
 
-int pj_geocentric_from_wgs84( PJ *defn, 
+static void pj_helmert_apply( const double *h,
                               long point_count, int point_offset,
                               double *x, double *y, double *z )
 
 {
-    int       i;
+    long i;
 
-    if( defn->datum_type == PJD_3PARAM )
+    for( i = 0; i < point_count; i++ )
     {
-        for( i = 0; i < point_count; i++ )
-        {
-            long io = i * point_offset;
-
-            if( x[io] == HUGE_VAL )
-                continue;
-            
-            x[io] = x[io] - Dx_BF;
-            y[io] = y[io] - Dy_BF;
-            z[io] = z[io] - Dz_BF;
-        }
+        long io = i * point_offset;
+        double X = x[io], Y = y[io], Z = z[io];
+
+        if( X == HUGE_VAL )
+            continue;
+
+        x[io] = h[0]*X + h[1]*Y + h[2]*Z + h[9];
+        y[io] = h[3]*X + h[4]*Y + h[5]*Z + h[10];
+        z[io] = h[6]*X + h[7]*Y + h[8]*Z + h[11];
     }
-    else if( defn->datum_type == PJD_7PARAM )
-    {
-        for( i = 0; i < point_count; i++ )
-        {
-            long io = i * point_offset;
-            double x_tmp, y_tmp, z_tmp;
+}
 
-            if( x[io] == HUGE_VAL )
-                continue;
+/************************************************************************/
+/*                         pj_helmert_compose()                         */
+/*                                                                      */
+/*      Combine two affine shifts into one: out applies `first',        */
+/*      then `second'.                                                  */
+/************************************************************************/
 
-            x_tmp = (x[io] - Dx_BF) / M_BF;
-            y_tmp = (y[io] - Dy_BF) / M_BF;
-            z_tmp = (z[io] - Dz_BF) / M_BF;
+static void pj_helmert_compose( const double *first, const double *second,
+                                double *out )
 
-            x[io] =        x_tmp + Rz_BF*y_tmp - Ry_BF*z_tmp;
-            y[io] = -Rz_BF*x_tmp +       y_tmp + Rx_BF*z_tmp;
-            z[io] =  Ry_BF*x_tmp - Rx_BF*y_tmp +       z_tmp;
-        }
+{
+    int r, c;
+
+    for( r = 0; r < 3; r++ )
+    {
+        for( c = 0; c < 3; c++ )
+            out[3*r+c] = second[3*r]*first[c]
+                + second[3*r+1]*first[3+c]
+                + second[3*r+2]*first[6+c];
+
+        out[9+r] = second[3*r]*first[9]
+            + second[3*r+1]*first[10]
+            + second[3*r+2]*first[11]
+            + second[9+r];
     }
+}
+
+/************************************************************************/
+/*                       pj_geocentic_to_wgs84()                        */
+/************************************************************************/
+
+int pj_geocentric_to_wgs84( PJ *defn,
+                            long point_count, int point_offset,
+                            double *x, double *y, double *z )
+
+{
+    if( defn->datum_type == PJD_3PARAM || defn->datum_type == PJD_7PARAM )
+        pj_helmert_apply( defn->helmert_to_wgs84,
+                          point_count, point_offset, x, y, z );
+
+    return 0;
+}
+
+/************************************************************************/
+/*                      pj_geocentic_from_wgs84()                       */
+/************************************************************************/
+
+int pj_geocentric_from_wgs84( PJ *defn,
+                              long point_count, int point_offset,
+                              double *x, double *y, double *z )
+
+{
+    if( defn->datum_type == PJD_3PARAM || defn->datum_type == PJD_7PARAM )
+        pj_helmert_apply( defn->helmert_from_wgs84,
+                          point_count, point_offset, x, y, z );
 
     return 0;
 }
@@ -635,12 +900,12 @@ int pj_datum_transform( PJ *srcdefn, PJ *dstdefn,
     if( z == NULL )
     {
         int	bytes = sizeof(double) * point_count * point_offset;
-        z = (double *) pj_malloc(bytes);
+        z = (double *) pj_ctx_buffer_get( srcdefn->ctx, bytes );
         memset( z, 0, bytes );
         z_is_temp = TRUE;
     }
 
-#define CHECK_RETURN(defn) {if( defn->ctx->last_errno != 0 && (defn->ctx->last_errno > 0 || transient_error[-defn->ctx->last_errno] == 0) ) { if( z_is_temp ) pj_dalloc(z); return defn->ctx->last_errno; }}
+#define CHECK_RETURN(defn) {int diag_err = pj_ctx_get_errno(defn->ctx); if( diag_err != 0 && (diag_err > 0 || pj_transient_error[-diag_err] == 0) ) { if( z_is_temp ) pj_ctx_buffer_put(srcdefn->ctx, z); return diag_err; }}
 
 /* -------------------------------------------------------------------- */
 /*	If this datum requires grid shifts, then apply it to geodetic   */
@@ -673,34 +938,50 @@ int pj_datum_transform( PJ *srcdefn, PJ *dstdefn,
 /* -------------------------------------------------------------------- */
 /*      Convert to geocentric coordinates.                              */
 /* -------------------------------------------------------------------- */
-        srcdefn->ctx->last_errno = 
+        pj_ctx_set_errno( srcdefn->ctx,
             pj_geodetic_to_geocentric( src_a, src_es,
-                                       point_count, point_offset, x, y, z );
+                                       point_count, point_offset, x, y, z ) );
         CHECK_RETURN(srcdefn);
 
 /* -------------------------------------------------------------------- */
-/*      Convert between datums.                                         */
+/*      Convert between datums.  When both sides are parameterized      */
+/*      shifts, fold the to-WGS84 and from-WGS84 applications into      */
+/*      one combined matrix so the arrays are swept once, not twice.    */
 /* -------------------------------------------------------------------- */
-        if( srcdefn->datum_type == PJD_3PARAM 
-            || srcdefn->datum_type == PJD_7PARAM )
+        if( (srcdefn->datum_type == PJD_3PARAM
+             || srcdefn->datum_type == PJD_7PARAM)
+            && (dstdefn->datum_type == PJD_3PARAM
+                || dstdefn->datum_type == PJD_7PARAM) )
         {
-            pj_geocentric_to_wgs84( srcdefn, point_count, point_offset,x,y,z);
-            CHECK_RETURN(srcdefn);
-        }
+            double fused[12];
 
-        if( dstdefn->datum_type == PJD_3PARAM 
-            || dstdefn->datum_type == PJD_7PARAM )
+            pj_helmert_compose( srcdefn->helmert_to_wgs84,
+                                dstdefn->helmert_from_wgs84, fused );
+            pj_helmert_apply( fused, point_count, point_offset, x, y, z );
+        }
+        else
         {
-            pj_geocentric_from_wgs84( dstdefn, point_count,point_offset,x,y,z);
-            CHECK_RETURN(dstdefn);
+            if( srcdefn->datum_type == PJD_3PARAM
+                || srcdefn->datum_type == PJD_7PARAM )
+            {
+                pj_geocentric_to_wgs84( srcdefn, point_count, point_offset,x,y,z);
+                CHECK_RETURN(srcdefn);
+            }
+
+            if( dstdefn->datum_type == PJD_3PARAM
+                || dstdefn->datum_type == PJD_7PARAM )
+            {
+                pj_geocentric_from_wgs84( dstdefn, point_count,point_offset,x,y,z);
+                CHECK_RETURN(dstdefn);
+            }
         }
 
 /* -------------------------------------------------------------------- */
 /*      Convert back to geodetic coordinates.                           */
 /* -------------------------------------------------------------------- */
-        dstdefn->ctx->last_errno = 
+        pj_ctx_set_errno( dstdefn->ctx,
             pj_geocentric_to_geodetic( dst_a, dst_es,
-                                       point_count, point_offset, x, y, z );
+                                       point_count, point_offset, x, y, z ) );
         CHECK_RETURN(dstdefn);
     }
 
@@ -714,7 +995,7 @@ int pj_datum_transform( PJ *srcdefn, PJ *dstdefn,
     }
 
     if( z_is_temp )
-        pj_dalloc( z );
+        pj_ctx_buffer_put( srcdefn->ctx, z );
 
     return 0;
 }
@@ -725,10 +1006,10 @@ int pj_datum_transform( PJ *srcdefn, PJ *dstdefn,
 /*      Normalize or de-normalized the x/y/z axes.  The normal form     */
 /*      is "enu" (easting, northing, up).                               */
 /************************************************************************/
-static int pj_adjust_axis( projCtx ctx, 
-                           const char *axis, int denormalize_flag,
-                           long point_count, int point_offset, 
-                           double *x, double *y, double *z )
+int pj_adjust_axis( projCtx ctx,
+                    const char *axis, int denormalize_flag,
+                    long point_count, int point_offset,
+                    double *x, double *y, double *z )
 
 {
     double x_in, y_in, z_in = 0.0;
@@ -824,3 +1105,166 @@ static int pj_adjust_axis( projCtx ctx,
     return 0;
 }
 
+
+/************************************************************************/
+/*                           pj_affine_edge()                           */
+/*                                                                      */
+/*      Fused scalar pre/post-processing at the pipeline edges: axis    */
+/*      normalization, horizontal unit scale, constant x offset and     */
+/*      vertical unit scale applied in one pass over the arrays         */
+/*      instead of one strided loop each.  The affine step runs after   */
+/*      the axis remap when normalizing and before it when              */
+/*      denormalizing, matching the order of the separate passes it     */
+/*      replaces.  The axis argument may be NULL (or "enu") when only   */
+/*      the scales apply; the contiguous (point_offset == 1) case       */
+/*      gets simple loops the compiler can vectorize.                   */
+/************************************************************************/
+
+int pj_affine_edge( projCtx ctx, const char *axis, int denormalize_flag,
+                    double xy_scale, double x_off, double z_scale,
+                    long point_count, int point_offset,
+                    double *x, double *y, double *z )
+
+{
+    long i;
+    int err;
+
+    if( axis != NULL && strcmp(axis,"enu") == 0 )
+        axis = NULL;
+
+    if( z == NULL )
+        z_scale = 1.0;
+
+/* -------------------------------------------------------------------- */
+/*      Pure affine case.  The scale-only and offset-only variants      */
+/*      are kept separate so results stay bit for bit identical to      */
+/*      the loops they replace (x * 1.0 + off would flip the sign of    */
+/*      a negative zero).                                               */
+/* -------------------------------------------------------------------- */
+    if( axis == NULL )
+    {
+        if( point_offset == 1 )
+        {
+            if( xy_scale != 1.0 && x_off != 0.0 )
+            {
+                for( i = 0; i < point_count; i++ )
+                {
+                    if( x[i] != HUGE_VAL )
+                    {
+                        x[i] = x[i] * xy_scale + x_off;
+                        y[i] *= xy_scale;
+                    }
+                }
+            }
+            else if( xy_scale != 1.0 )
+            {
+                for( i = 0; i < point_count; i++ )
+                {
+                    if( x[i] != HUGE_VAL )
+                    {
+                        x[i] *= xy_scale;
+                        y[i] *= xy_scale;
+                    }
+                }
+            }
+            else if( x_off != 0.0 )
+            {
+                for( i = 0; i < point_count; i++ )
+                {
+                    if( x[i] != HUGE_VAL )
+                        x[i] += x_off;
+                }
+            }
+
+            if( z_scale != 1.0 )
+            {
+                for( i = 0; i < point_count; i++ )
+                    z[i] *= z_scale;
+            }
+        }
+        else
+        {
+            if( xy_scale != 1.0 && x_off != 0.0 )
+            {
+                for( i = 0; i < point_count; i++ )
+                {
+                    if( x[point_offset*i] != HUGE_VAL )
+                    {
+                        x[point_offset*i] = x[point_offset*i] * xy_scale
+                            + x_off;
+                        y[point_offset*i] *= xy_scale;
+                    }
+                }
+            }
+            else if( xy_scale != 1.0 )
+            {
+                for( i = 0; i < point_count; i++ )
+                {
+                    if( x[point_offset*i] != HUGE_VAL )
+                    {
+                        x[point_offset*i] *= xy_scale;
+                        y[point_offset*i] *= xy_scale;
+                    }
+                }
+            }
+            else if( x_off != 0.0 )
+            {
+                for( i = 0; i < point_count; i++ )
+                {
+                    if( x[point_offset*i] != HUGE_VAL )
+                        x[point_offset*i] += x_off;
+                }
+            }
+
+            if( z_scale != 1.0 )
+            {
+                for( i = 0; i < point_count; i++ )
+                    z[point_offset*i] *= z_scale;
+            }
+        }
+
+        return 0;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Unusual axes: remap and scale in one pass.  When                */
+/*      denormalizing, the affine step applies in enu space before      */
+/*      the remap.                                                      */
+/* -------------------------------------------------------------------- */
+    if( !denormalize_flag )
+    {
+        err = pj_adjust_axis( ctx, axis, 0,
+                              point_count, point_offset, x, y, z );
+        if( err != 0 )
+            return err;
+    }
+
+    if( xy_scale != 1.0 || x_off != 0.0 || z_scale != 1.0 )
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            if( x[point_offset*i] != HUGE_VAL )
+            {
+                if( xy_scale != 1.0 )
+                {
+                    x[point_offset*i] *= xy_scale;
+                    y[point_offset*i] *= xy_scale;
+                }
+                if( x_off != 0.0 )
+                    x[point_offset*i] += x_off;
+            }
+            if( z_scale != 1.0 )
+                z[point_offset*i] *= z_scale;
+        }
+    }
+
+    if( denormalize_flag )
+    {
+        err = pj_adjust_axis( ctx, axis, 1,
+                              point_count, point_offset, x, y, z );
+        if( err != 0 )
+            return err;
+    }
+
+    return 0;
+}
@@ -0,0 +1,2823 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Cached transformation plans for repeated pj_transform() style
+ *           conversions between one src/dst pair of coordinate systems.
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2000, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <projects.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/time.h>
+#include <time.h>
+#endif
+
+PJ_CVSID("$Id$");
+
+#ifndef SRS_WGS84_SEMIMAJOR
+#define SRS_WGS84_SEMIMAJOR 6378137.0
+#endif
+
+#ifndef SRS_WGS84_ESQUARED
+#define SRS_WGS84_ESQUARED 0.0066943799901413165
+#endif
+
+/*
+** pj_transform() rediscovers the same facts about the src/dst pair on
+** every call (datum comparison, latlong/geocent flags, axis strings,
+** unit factors).  A plan records that control flow once as a compact
+** stage list so that per-call work is just running the stages.
+*/
+
+typedef enum {
+    TR_STG_AXIS_NORM,         /* normalize unusual source axes to enu */
+    TR_STG_AXIS_DENORM,       /* denormalize enu into destination axes */
+    TR_STG_Z_SCALE,           /* multiply z by a constant */
+    TR_STG_XY_SCALE,          /* multiply x/y by a constant */
+    TR_STG_GEOC_TO_GEOD,      /* geocentric cartesian -> lat/long */
+    TR_STG_GEOD_TO_GEOC,      /* lat/long -> geocentric cartesian */
+    TR_STG_INV_PROJ,          /* inverse projection to lat/long */
+    TR_STG_FWD_PROJ,          /* forward projection from lat/long */
+    TR_STG_INV_FWD_PROJ,      /* fused inverse then forward projection */
+    TR_STG_PM_OFFSET,         /* add constant prime meridian offset to x */
+    TR_STG_VGRIDSHIFT,        /* geoid to/from ellipsoidal heights */
+    TR_STG_GRIDSHIFT,         /* horizontal datum shift grids */
+    TR_STG_HELMERT_TO_WGS84,  /* 3/7 param shift into WGS84 */
+    TR_STG_HELMERT_FROM_WGS84,/* 3/7 param shift out of WGS84 */
+    TR_STG_LONG_WRAP,         /* rewrap longitudes about a custom center */
+    TR_STG_AFFINE             /* fused axis remap / unit scales / x offset */
+} PJtransformStageType;
+
+typedef struct {
+    PJtransformStageType type;
+    PJ      *defn;            /* src or dst as appropriate, or NULL */
+    PJ      *defn2;           /* forward half of TR_STG_INV_FWD_PROJ */
+    double   value;           /* scale factor or meridian offset */
+    double   a, es;           /* ellipsoid for the geocentric stages */
+    int      inverse;         /* for grid shift stages; for TR_STG_AFFINE
+                                 the axis denormalize flag */
+    double   xy_scale;        /* fused coefficients (TR_STG_AFFINE) */
+    double   x_off;
+    double   z_scale;
+    PJ_GRIDINFO **gridlist;   /* area of use pruned grid list for the
+                                 grid shift stages, NULL when no area
+                                 is declared (see plan_prune_grids()) */
+    int      gridlist_count;
+} PJtransformStage;
+
+/* indexed by PJtransformStageType, for profile reporting */
+static const char * const plan_stage_names[] = {
+    "axis_norm",
+    "axis_denorm",
+    "z_scale",
+    "xy_scale",
+    "geoc_to_geod",
+    "geod_to_geoc",
+    "inv_proj",
+    "fwd_proj",
+    "inv_fwd_proj",
+    "pm_offset",
+    "vgridshift",
+    "gridshift",
+    "helmert_to_wgs84",
+    "helmert_from_wgs84",
+    "long_wrap",
+    "affine"
+};
+
+#define TR_MAX_STAGES 20
+#define TR_BLOCK_POINTS 1024
+
+/*
+** Optional memo cache (see pj_transform_plan_memo()): a fixed size,
+** power of two, open addressed table of input -> output coordinate
+** pairs.  Lookups compare the exact input doubles, so a hit returns
+** bit-identical results; the hash just mixes their raw words.  Vector
+** tile style workloads that transform the same vertices repeatedly
+** skip the whole stage pipeline on a hit.
+*/
+
+typedef struct {
+    double in_x, in_y;
+    double out_x, out_y;
+    int    used;
+} PJtransformMemoEntry;
+
+struct PJtransformMemoType {
+    unsigned int  mask;       /* table size - 1 */
+    PJtransformMemoEntry *table;
+    unsigned long lookups;
+    unsigned long hits;
+    /* per block gather/scatter scratch for the miss pipeline run */
+    double *miss_x, *miss_y;
+    double *save_x, *save_y;
+    long   *miss_idx;
+};
+
+#define TR_MEMO_PROBES 4
+
+/*
+** Optional error bounded approximation (see
+** pj_transform_plan_set_max_error()): a coarse anchor mesh over the
+** input extent is transformed through the exact stage pipeline and
+** bilinear interpolation between the anchors is verified against the
+** exact path at every cell midpoint.  When the worst midpoint error
+** is within the caller's tolerance the remaining points are
+** interpolated instead of transformed.  Overview pyramid builders
+** sweep the same extent once per level, so the validated mesh is
+** cached on the plan and reused as long as it covers the incoming
+** blocks.
+*/
+
+struct PJtransformMeshType {
+    double minx, miny;        /* input extent covered */
+    double maxx, maxy;
+    double stepx, stepy;      /* cell size, always > 0 */
+    int    ncell;             /* cells per axis */
+    double *ax, *ay;          /* (ncell+1)^2 anchor outputs, row major */
+};
+
+#define TR_MESH_MIN_POINTS 256
+
+struct projTransformPlanType {
+    PJ  *srcdefn;
+    PJ  *dstdefn;
+    int  stage_count;
+    int  needs_z;             /* a stage requires a z array */
+    int  is_affine;           /* every stage is a constant scale/offset */
+    double aff_xyscale;       /* fused x/y scale */
+    double aff_xoff;          /* fused x offset (prime meridians) */
+    double aff_zscale;        /* fused z scale */
+    struct PJtransformMemoType *memo; /* optional, NULL when detached */
+    double approx_tol;        /* max allowed output error, 0 = exact */
+    struct PJtransformMeshType *mesh; /* cached validated anchor mesh */
+    int    mesh_failed;       /* tolerance unmet over mesh_bad_* */
+    double mesh_bad_minx, mesh_bad_miny;
+    double mesh_bad_maxx, mesh_bad_maxy;
+    Tseries *cheb;            /* fitted Chebyshev surrogate, or NULL */
+    projUV cheb_low, cheb_upp;/* fitted domain, plan input units */
+    int    cheb_tried;        /* fit attempted for current area/tol */
+    int  has_area;            /* pj_transform_plan_set_area() declared */
+    double area_west, area_south;     /* area of use, radians */
+    double area_east, area_north;
+    int  grid_generation;     /* pj_gridlist_generation() the pruned
+                                 stage lists were built against */
+    int  (*progress_fn)( void *, long ); /* optional checkpoint hook */
+    void *progress_arg;
+    long progress_interval;   /* points between callbacks */
+    int  compact;             /* drop HUGE_VAL lanes between stages */
+    int  validate_rate;       /* round trip every Nth point, 0 = off */
+    struct projTransformPlanType *validate_rplan; /* dst -> src plan */
+    int  profile;             /* per stage timing enabled */
+    unsigned long prof_calls[TR_MAX_STAGES];  /* blocks run per stage */
+    unsigned long prof_points[TR_MAX_STAGES];
+    double prof_secs[TR_MAX_STAGES];
+    int  src_degrees;         /* unit flags the plan was built with, */
+    int  dst_degrees;         /* kept so the reverse plan matches */
+    PJtransformStage stages[TR_MAX_STAGES];
+};
+
+static void plan_try_cheby( struct projTransformPlanType *plan );
+
+/************************************************************************/
+/*                             plan_push()                              */
+/************************************************************************/
+
+static PJtransformStage *plan_push( struct projTransformPlanType *plan,
+                                    PJtransformStageType type )
+
+{
+    PJtransformStage *stage = plan->stages + plan->stage_count++;
+
+    memset( stage, 0, sizeof(PJtransformStage) );
+    stage->type = type;
+    return stage;
+}
+
+/************************************************************************/
+/*                          plan_fuse_affine()                          */
+/*                                                                      */
+/*      Coalesce runs of adjacent scalar stages -- axis remaps, unit    */
+/*      scales, prime meridian offsets -- into single TR_STG_AFFINE    */
+/*      stages so the edges of the pipeline touch each block once       */
+/*      instead of once per scale.  A normalizing axis remap can only   */
+/*      open a run (it must see the raw input) and a denormalizing      */
+/*      one always closes it (it must produce the final output).        */
+/************************************************************************/
+
+static void plan_fuse_affine( struct projTransformPlanType *plan )
+
+{
+    int in = 0, out = 0;
+
+    while( in < plan->stage_count )
+    {
+        PJtransformStage fused;
+        int run = 0;
+
+        memset( &fused, 0, sizeof(fused) );
+        fused.type = TR_STG_AFFINE;
+        fused.xy_scale = 1.0;
+        fused.x_off = 0.0;
+        fused.z_scale = 1.0;
+
+        while( in + run < plan->stage_count )
+        {
+            PJtransformStage *stage = plan->stages + in + run;
+
+            if( stage->type == TR_STG_AXIS_NORM )
+            {
+                if( run > 0 )
+                    break;
+                fused.defn = stage->defn;
+                fused.inverse = 0;
+            }
+            else if( stage->type == TR_STG_AXIS_DENORM )
+            {
+                if( fused.defn != NULL )
+                    break;
+                fused.defn = stage->defn;
+                fused.inverse = 1;
+                run++;
+                break;
+            }
+            else if( stage->type == TR_STG_XY_SCALE )
+            {
+                fused.xy_scale *= stage->value;
+                fused.x_off *= stage->value;
+            }
+            else if( stage->type == TR_STG_PM_OFFSET )
+            {
+                fused.x_off += stage->value;
+            }
+            else if( stage->type == TR_STG_Z_SCALE )
+            {
+                fused.z_scale *= stage->value;
+            }
+            else
+                break;
+
+            run++;
+        }
+
+        if( run >= 2 )
+        {
+            plan->stages[out++] = fused;
+            in += run;
+        }
+        else
+            plan->stages[out++] = plan->stages[in++];
+    }
+
+    plan->stage_count = out;
+}
+
+/************************************************************************/
+/*                       plan_fuse_projections()                        */
+/*                                                                      */
+/*      Chained projection plans on a common datum run an inverse       */
+/*      projection stage directly followed by a forward one.  Fuse      */
+/*      the pair so each block makes one pass with the intermediate     */
+/*      lat/long held in registers between the kernels, instead of a    */
+/*      full store/reload of the arrays between two stage loops.        */
+/*      (Sharing sin/cos of the intermediate latitude between the       */
+/*      kernels was considered but does not apply: inverse kernels      */
+/*      produce phi through atan/asin or iteration, so the trig of      */
+/*      the result is never available for free.)                        */
+/************************************************************************/
+
+static void plan_fuse_projections( struct projTransformPlanType *plan )
+
+{
+    int in, out = 0;
+
+    for( in = 0; in < plan->stage_count; in++ )
+    {
+        if( plan->stages[in].type == TR_STG_INV_PROJ
+            && in + 1 < plan->stage_count
+            && plan->stages[in+1].type == TR_STG_FWD_PROJ )
+        {
+            PJtransformStage *stage = plan->stages + out++;
+
+            *stage = plan->stages[in];
+            stage->type = TR_STG_INV_FWD_PROJ;
+            stage->defn2 = plan->stages[in+1].defn;
+            in++;
+        }
+        else
+            plan->stages[out++] = plan->stages[in];
+    }
+
+    plan->stage_count = out;
+}
+
+/************************************************************************/
+/*                     plan_elide_null_gridshifts()                     */
+/*                                                                      */
+/*      A grid shift stage whose every grid is a verified null shift    */
+/*      table (+nadgrids=@null, the way definitions like web            */
+/*      mercator pin their datum to WGS84) moves no point: contained    */
+/*      points interpolate a zero shift, and points outside the         */
+/*      extent are left alone by design.  Drop such stages at plan      */
+/*      time, so the executed pipeline for e.g. 4326 -> 3857 is just    */
+/*      the projection kernel instead of re-discovering the no-op       */
+/*      per call.  The null_shift flag lives on the loaded payload      */
+/*      (see pj_gridinfo_load()), so only tables small enough to be     */
+/*      plausible null/constant stand-ins are faulted in here; a        */
+/*      real regional grid is never loaded early on this account.       */
+/************************************************************************/
+
+#define PJ_NULL_STAGE_CELLS 256
+
+static int plan_gridshift_is_null( PJ *defn )
+
+{
+    int i;
+
+    if( defn->catalog_name != NULL )
+        return FALSE;
+    if( pj_gridshift_resolve( defn ) != 0
+        || defn->gridlist == NULL || defn->gridlist_count == 0 )
+        return FALSE;
+
+    for( i = 0; i < defn->gridlist_count; i++ )
+    {
+        PJ_GRIDINFO *gi = defn->gridlist[i];
+
+        if( gi->ct == NULL || gi->child != NULL )
+            return FALSE;
+        if( (long) gi->ct->lim.lam * gi->ct->lim.phi
+            > PJ_NULL_STAGE_CELLS )
+            return FALSE;
+        if( gi->ct->cvs == NULL
+            && !pj_gridinfo_load( pj_get_ctx( defn ), gi ) )
+            return FALSE;
+        if( !gi->ct->null_shift )
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void plan_elide_null_gridshifts( struct projTransformPlanType *plan )
+
+{
+    int in, out = 0;
+
+    for( in = 0; in < plan->stage_count; in++ )
+    {
+        if( plan->stages[in].type == TR_STG_GRIDSHIFT
+            && plan_gridshift_is_null( plan->stages[in].defn ) )
+            continue;
+
+        plan->stages[out++] = plan->stages[in];
+    }
+
+    plan->stage_count = out;
+}
+
+/************************************************************************/
+/*                       pj_transform_plan_units()                      */
+/*                                                                      */
+/*      Inspect a src/dst pair once and record the required pipeline    */
+/*      stages.  The plan borrows the PJ handles: it remains valid      */
+/*      only as long as neither of them has been pj_free()ed.           */
+/*                                                                      */
+/*      A caller whose arrays hold decimal degrees can declare that     */
+/*      here (the respective definition must be latlong) and the        */
+/*      DEG_TO_RAD / RAD_TO_DEG factors become ordinary scale stages,   */
+/*      fused into the neighbouring affine run - no separate convert    */
+/*      pass over the arrays in user code or in the library.            */
+/************************************************************************/
+
+projTransformPlan pj_transform_plan_units( projPJ src, projPJ dst,
+                                           int src_degrees,
+                                           int dst_degrees )
+
+{
+    PJ *srcdefn = (PJ *) src;
+    PJ *dstdefn = (PJ *) dst;
+    struct projTransformPlanType *plan;
+    PJtransformStage *stage;
+    double src_a, src_es, dst_a, dst_es;
+    int datums_differ;
+
+    if( srcdefn == NULL || dstdefn == NULL )
+        return NULL;
+
+    /* deferred setup must complete before capabilities are inspected */
+    if( (srcdefn->setup_state != PJ_SETUP_READY
+         && pj_setup_finalize( srcdefn ))
+        || (dstdefn->setup_state != PJ_SETUP_READY
+            && pj_setup_finalize( dstdefn )) )
+        return NULL;
+
+    if( !srcdefn->is_geocent && !srcdefn->is_latlong
+        && srcdefn->inv == NULL )
+    {
+        pj_ctx_set_errno( pj_get_ctx(srcdefn), -17 );
+        pj_log( pj_get_ctx(srcdefn), PJ_LOG_ERROR,
+                "pj_transform_plan(): source projection not invertable" );
+        return NULL;
+    }
+
+    if( (src_degrees && !srcdefn->is_latlong)
+        || (dst_degrees && !dstdefn->is_latlong) )
+    {
+        pj_ctx_set_errno( pj_get_ctx(srcdefn), -7 );
+        pj_log( pj_get_ctx(srcdefn), PJ_LOG_ERROR,
+                "pj_transform_plan_units(): degrees declared for a "
+                "definition that is not latlong" );
+        return NULL;
+    }
+
+    plan = (struct projTransformPlanType *) pj_malloc(sizeof(*plan));
+    if( plan == NULL )
+        return NULL;
+    memset( plan, 0, sizeof(*plan) );
+    plan->srcdefn = srcdefn;
+    plan->dstdefn = dstdefn;
+    plan->src_degrees = src_degrees;
+    plan->dst_degrees = dst_degrees;
+
+/* -------------------------------------------------------------------- */
+/*      Source side normalization, mirroring pj_transform() order.      */
+/* -------------------------------------------------------------------- */
+    if( strcmp(srcdefn->axis,"enu") != 0 )
+    {
+        stage = plan_push( plan, TR_STG_AXIS_NORM );
+        stage->defn = srcdefn;
+    }
+
+    if( src_degrees )
+    {
+        stage = plan_push( plan, TR_STG_XY_SCALE );
+        stage->value = DEG_TO_RAD;
+    }
+
+    if( srcdefn->vto_meter != 1.0 )
+    {
+        stage = plan_push( plan, TR_STG_Z_SCALE );
+        stage->value = srcdefn->vto_meter;
+    }
+
+    if( srcdefn->is_geocent )
+    {
+        plan->needs_z = TRUE;
+        if( srcdefn->to_meter != 1.0 )
+        {
+            stage = plan_push( plan, TR_STG_XY_SCALE );
+            stage->value = srcdefn->to_meter;
+        }
+        stage = plan_push( plan, TR_STG_GEOC_TO_GEOD );
+        stage->a = srcdefn->a_orig;
+        stage->es = srcdefn->es_orig;
+    }
+    else if( !srcdefn->is_latlong )
+    {
+        stage = plan_push( plan, TR_STG_INV_PROJ );
+        stage->defn = srcdefn;
+    }
+
+    if( srcdefn->from_greenwich != 0.0 )
+    {
+        stage = plan_push( plan, TR_STG_PM_OFFSET );
+        stage->value = srcdefn->from_greenwich;
+    }
+
+    if( srcdefn->has_geoid_vgrids )
+    {
+        stage = plan_push( plan, TR_STG_VGRIDSHIFT );
+        stage->defn = srcdefn;
+        stage->inverse = 0;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Datum conversion, decomposed the way pj_datum_transform()       */
+/*      decides it per call.                                            */
+/* -------------------------------------------------------------------- */
+    datums_differ = srcdefn->datum_type != PJD_UNKNOWN
+        && dstdefn->datum_type != PJD_UNKNOWN
+        && !pj_compare_datums( srcdefn, dstdefn );
+
+    if( datums_differ )
+    {
+        src_a = srcdefn->a_orig;
+        src_es = srcdefn->es_orig;
+        dst_a = dstdefn->a_orig;
+        dst_es = dstdefn->es_orig;
+
+        plan->needs_z = TRUE;
+
+        if( srcdefn->datum_type == PJD_GRIDSHIFT )
+        {
+            stage = plan_push( plan, TR_STG_GRIDSHIFT );
+            stage->defn = srcdefn;
+            stage->inverse = 0;
+
+            src_a = SRS_WGS84_SEMIMAJOR;
+            src_es = SRS_WGS84_ESQUARED;
+        }
+
+        if( dstdefn->datum_type == PJD_GRIDSHIFT )
+        {
+            dst_a = SRS_WGS84_SEMIMAJOR;
+            dst_es = SRS_WGS84_ESQUARED;
+        }
+
+        if( src_es != dst_es || src_a != dst_a
+            || srcdefn->datum_type == PJD_3PARAM
+            || srcdefn->datum_type == PJD_7PARAM
+            || dstdefn->datum_type == PJD_3PARAM
+            || dstdefn->datum_type == PJD_7PARAM )
+        {
+            stage = plan_push( plan, TR_STG_GEOD_TO_GEOC );
+            stage->a = src_a;
+            stage->es = src_es;
+
+            if( srcdefn->datum_type == PJD_3PARAM
+                || srcdefn->datum_type == PJD_7PARAM )
+            {
+                stage = plan_push( plan, TR_STG_HELMERT_TO_WGS84 );
+                stage->defn = srcdefn;
+            }
+
+            if( dstdefn->datum_type == PJD_3PARAM
+                || dstdefn->datum_type == PJD_7PARAM )
+            {
+                stage = plan_push( plan, TR_STG_HELMERT_FROM_WGS84 );
+                stage->defn = dstdefn;
+            }
+
+            stage = plan_push( plan, TR_STG_GEOC_TO_GEOD );
+            stage->a = dst_a;
+            stage->es = dst_es;
+        }
+
+        if( dstdefn->datum_type == PJD_GRIDSHIFT )
+        {
+            stage = plan_push( plan, TR_STG_GRIDSHIFT );
+            stage->defn = dstdefn;
+            stage->inverse = 1;
+        }
+
+        /* in a non blocking grid load mode, plan creation is the
+           natural moment to start warming the grids the gridshift
+           stages will need, so pj_transform_exec() finds them
+           resident rather than in flight */
+        if( pj_ctx_get_grid_load_mode( pj_get_ctx(srcdefn) )
+            != PJ_GRID_LOAD_BLOCK )
+        {
+            if( srcdefn->datum_type == PJD_GRIDSHIFT )
+                pj_ctx_preload_grids_background( pj_get_ctx(srcdefn),
+                                                 srcdefn->nadgrids );
+            if( dstdefn->datum_type == PJD_GRIDSHIFT )
+                pj_ctx_preload_grids_background( pj_get_ctx(dstdefn),
+                                                 dstdefn->nadgrids );
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Destination side denormalization.                               */
+/* -------------------------------------------------------------------- */
+    if( dstdefn->has_geoid_vgrids )
+    {
+        stage = plan_push( plan, TR_STG_VGRIDSHIFT );
+        stage->defn = dstdefn;
+        stage->inverse = 1;
+    }
+
+    if( dstdefn->from_greenwich != 0.0 )
+    {
+        stage = plan_push( plan, TR_STG_PM_OFFSET );
+        stage->value = -dstdefn->from_greenwich;
+    }
+
+    if( dstdefn->is_geocent )
+    {
+        plan->needs_z = TRUE;
+        stage = plan_push( plan, TR_STG_GEOD_TO_GEOC );
+        stage->a = dstdefn->a_orig;
+        stage->es = dstdefn->es_orig;
+        if( dstdefn->fr_meter != 1.0 )
+        {
+            stage = plan_push( plan, TR_STG_XY_SCALE );
+            stage->value = dstdefn->fr_meter;
+        }
+    }
+    else if( !dstdefn->is_latlong )
+    {
+        stage = plan_push( plan, TR_STG_FWD_PROJ );
+        stage->defn = dstdefn;
+    }
+    else if( dstdefn->is_long_wrap_set )
+    {
+        stage = plan_push( plan, TR_STG_LONG_WRAP );
+        stage->defn = dstdefn;
+    }
+
+    if( dst_degrees )
+    {
+        stage = plan_push( plan, TR_STG_XY_SCALE );
+        stage->value = RAD_TO_DEG;
+    }
+
+    if( dstdefn->vto_meter != 1.0 )
+    {
+        stage = plan_push( plan, TR_STG_Z_SCALE );
+        stage->value = dstdefn->vfr_meter;
+    }
+
+    if( strcmp(dstdefn->axis,"enu") != 0 )
+    {
+        stage = plan_push( plan, TR_STG_AXIS_DENORM );
+        stage->defn = dstdefn;
+    }
+
+    /* before deciding whether the plan is affine: dropping a null
+       shift stage can turn e.g. a latlong pair differing only by a
+       +nadgrids=@null into a pure affine (or empty) pipeline */
+    plan_elide_null_gridshifts( plan );
+
+/* -------------------------------------------------------------------- */
+/*      If every stage is a constant scale or offset -- the common      */
+/*      latlong to latlong case with different prime meridians or       */
+/*      vertical units -- the whole plan collapses to one affine        */
+/*      pass, so fuse the coefficients now.                             */
+/* -------------------------------------------------------------------- */
+    plan->is_affine = TRUE;
+    plan->aff_xyscale = 1.0;
+    plan->aff_xoff = 0.0;
+    plan->aff_zscale = 1.0;
+
+    {
+        int istage;
+
+        for( istage = 0;
+             plan->is_affine && istage < plan->stage_count;
+             istage++ )
+        {
+            stage = plan->stages + istage;
+            switch( stage->type )
+            {
+              case TR_STG_XY_SCALE:
+                plan->aff_xyscale *= stage->value;
+                plan->aff_xoff *= stage->value;
+                break;
+              case TR_STG_PM_OFFSET:
+                plan->aff_xoff += stage->value;
+                break;
+              case TR_STG_Z_SCALE:
+                plan->aff_zscale *= stage->value;
+                break;
+              default:
+                plan->is_affine = FALSE;
+                break;
+            }
+        }
+    }
+
+    if( !plan->is_affine )
+    {
+        plan_fuse_affine( plan );
+        plan_fuse_projections( plan );
+    }
+
+    return (projTransformPlan) plan;
+}
+
+/************************************************************************/
+/*                          pj_transform_plan()                         */
+/************************************************************************/
+
+projTransformPlan pj_transform_plan( projPJ src, projPJ dst )
+
+{
+    return pj_transform_plan_units( src, dst, 0, 0 );
+}
+
+/************************************************************************/
+/*                       pj_transform_plan_free()                       */
+/************************************************************************/
+
+void pj_transform_plan_free( projTransformPlan plan )
+
+{
+    if( plan != NULL )
+    {
+        struct projTransformPlanType *p =
+            (struct projTransformPlanType *) plan;
+        int is;
+
+        for( is = 0; is < p->stage_count; is++ )
+            if( p->stages[is].gridlist != NULL )
+                pj_dalloc( p->stages[is].gridlist );
+        pj_transform_plan_memo( plan, 0 );
+        if( p->mesh != NULL )
+        {
+            pj_dalloc( p->mesh->ax );
+            pj_dalloc( p->mesh );
+        }
+        if( p->cheb != NULL )
+            pj_cheby_free( p->cheb );
+        if( p->validate_rplan != NULL )
+            pj_transform_plan_free( p->validate_rplan );
+        pj_dalloc( plan );
+    }
+}
+
+/************************************************************************/
+/*                       pj_transform_plan_memo()                       */
+/*                                                                      */
+/*      Attach (or with entries <= 0 detach) a memo cache of the        */
+/*      requested size, rounded up to a power of two.  The cache is     */
+/*      consulted by pj_transform_exec() for 2D calls (z == NULL)       */
+/*      only: with a z array the output depends on three inputs and     */
+/*      the table would need triple keys for little gain.  It assumes   */
+/*      the transformation stays deterministic over the plan's          */
+/*      lifetime, which holds as long as grid search paths are not      */
+/*      reconfigured mid-flight.                                        */
+/************************************************************************/
+
+int pj_transform_plan_memo( projTransformPlan plan_arg, int entries )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+    struct PJtransformMemoType *memo;
+    unsigned int size;
+
+    if( plan == NULL )
+        return -1;
+
+    if( plan->memo != NULL )
+    {
+        pj_dalloc( plan->memo->table );
+        pj_dalloc( plan->memo->miss_x );
+        pj_dalloc( plan->memo );
+        plan->memo = NULL;
+    }
+
+    if( entries <= 0 )
+        return 0;
+
+    for( size = 1; size < (unsigned int) entries; size <<= 1 ) {}
+
+    memo = (struct PJtransformMemoType *) pj_malloc( sizeof(*memo) );
+    if( memo == NULL )
+        return ENOMEM;
+    memset( memo, 0, sizeof(*memo) );
+    memo->mask = size - 1;
+    memo->table = (PJtransformMemoEntry *)
+        pj_malloc( sizeof(PJtransformMemoEntry) * size );
+    /* one allocation for all five gather/scatter arrays */
+    memo->miss_x = (double *)
+        pj_malloc( TR_BLOCK_POINTS * (4 * sizeof(double) + sizeof(long)) );
+    if( memo->table == NULL || memo->miss_x == NULL )
+    {
+        pj_dalloc( memo->table );
+        pj_dalloc( memo->miss_x );
+        pj_dalloc( memo );
+        return ENOMEM;
+    }
+    memset( memo->table, 0, sizeof(PJtransformMemoEntry) * size );
+    memo->miss_y = memo->miss_x + TR_BLOCK_POINTS;
+    memo->save_x = memo->miss_y + TR_BLOCK_POINTS;
+    memo->save_y = memo->save_x + TR_BLOCK_POINTS;
+    memo->miss_idx = (long *) (memo->save_y + TR_BLOCK_POINTS);
+
+    plan->memo = memo;
+    return 0;
+}
+
+/************************************************************************/
+/*                   pj_transform_plan_set_progress()                   */
+/*                                                                      */
+/*      Attach (or with fn NULL detach) a progress callback, called     */
+/*      from pj_transform_exec() at block boundaries roughly every      */
+/*      `interval` points (interval <= 0: every block) with the         */
+/*      number of fully transformed points.  Because the executor       */
+/*      runs the whole stage pipeline block by block, everything        */
+/*      before that cursor already holds final output and a stopped     */
+/*      job resumes by re-running exec on the remaining tail - no       */
+/*      stage index needs to be saved.  A nonzero callback return       */
+/*      stops the run and is passed through as exec's return value.     */
+/************************************************************************/
+
+int pj_transform_plan_set_progress( projTransformPlan plan_arg,
+                                    int (*fn)( void *, long ),
+                                    long interval, void *user_data )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+
+    if( plan == NULL )
+        return -1;
+
+    plan->progress_fn = fn;
+    plan->progress_arg = user_data;
+    plan->progress_interval = interval;
+    return 0;
+}
+
+/************************************************************************/
+/*                    pj_transform_plan_memo_stats()                    */
+/************************************************************************/
+
+void pj_transform_plan_memo_stats( projTransformPlan plan_arg,
+                                   unsigned long *hits,
+                                   unsigned long *lookups )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+
+    if( hits != NULL )
+        *hits = plan != NULL && plan->memo != NULL ? plan->memo->hits : 0;
+    if( lookups != NULL )
+        *lookups = plan != NULL && plan->memo != NULL
+            ? plan->memo->lookups : 0;
+}
+
+/************************************************************************/
+/*                     pj_transform_plan_profile()                      */
+/*                                                                      */
+/*      Enable (nonzero) or disable per stage timing: every stage of    */
+/*      every block run through the pipeline is bracketed with a        */
+/*      monotonic clock read, and the elapsed seconds, block and        */
+/*      point counts are aggregated on the plan per stage slot.  The    */
+/*      two clock reads amortize over a whole block, so at the 1024     */
+/*      point block size the overhead is well under a percent of any    */
+/*      real stage.  Enabling resets the aggregates, so a re-enable     */
+/*      starts a fresh measurement window.  Blocks served whole by      */
+/*      the memo cache, the anchor mesh or the Chebyshev surrogate      */
+/*      never reach the stage pipeline and are not attributed.          */
+/************************************************************************/
+
+int pj_transform_plan_profile( projTransformPlan plan_arg, int enable )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+
+    if( plan == NULL )
+        return -1;
+
+    plan->profile = enable != 0;
+    if( plan->profile )
+    {
+        memset( plan->prof_calls, 0, sizeof(plan->prof_calls) );
+        memset( plan->prof_points, 0, sizeof(plan->prof_points) );
+        memset( plan->prof_secs, 0, sizeof(plan->prof_secs) );
+    }
+    return 0;
+}
+
+/************************************************************************/
+/*                  pj_transform_plan_profile_stats()                   */
+/*                                                                      */
+/*      Report the profile aggregates for one stage slot.  Returns      */
+/*      the number of stages in the plan so callers can iterate, or     */
+/*      -1 for a NULL plan; for a stage index outside [0,count) the     */
+/*      outputs are left untouched, so passing -1 just queries the      */
+/*      stage count.  Any output pointer may be NULL.                   */
+/************************************************************************/
+
+int pj_transform_plan_profile_stats( projTransformPlan plan_arg, int stage,
+                                     const char **name,
+                                     unsigned long *blocks,
+                                     unsigned long *points,
+                                     double *seconds )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+
+    if( plan == NULL )
+        return -1;
+
+    if( stage >= 0 && stage < plan->stage_count )
+    {
+        if( name != NULL )
+            *name = plan_stage_names[plan->stages[stage].type];
+        if( blocks != NULL )
+            *blocks = plan->prof_calls[stage];
+        if( points != NULL )
+            *points = plan->prof_points[stage];
+        if( seconds != NULL )
+            *seconds = plan->prof_secs[stage];
+    }
+    return plan->stage_count;
+}
+
+/************************************************************************/
+/*                   pj_transform_plan_profile_log()                    */
+/*                                                                      */
+/*      Dump the profile aggregates, one debug level pj_log() line      */
+/*      per stage, on the source definition's context.                  */
+/************************************************************************/
+
+void pj_transform_plan_profile_log( projTransformPlan plan_arg )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+    int istage;
+
+    if( plan == NULL )
+        return;
+
+    for( istage = 0; istage < plan->stage_count; istage++ )
+    {
+        double secs = plan->prof_secs[istage];
+
+        pj_log( pj_get_ctx( plan->srcdefn ), PJ_LOG_DEBUG_MAJOR,
+                "plan stage %2d %-18s: %lu blocks, %lu points, "
+                "%.6fs, %.0f points/s",
+                istage, plan_stage_names[plan->stages[istage].type],
+                plan->prof_calls[istage], plan->prof_points[istage],
+                secs, secs > 0.0 ? plan->prof_points[istage] / secs : 0.0 );
+    }
+}
+
+/************************************************************************/
+/*                     pj_transform_plan_validate()                     */
+/*                                                                      */
+/*      Enable (or with sample_rate <= 0 disable) round trip            */
+/*      validation: pj_transform_exec() will run every Nth point back   */
+/*      through a reverse plan and accumulate the horizontal distance   */
+/*      to the original input into the source context's roundtrip_*     */
+/*      stats counters.  The sampling is deterministic (point index     */
+/*      modulo the rate), so repeated runs over the same data           */
+/*      validate the same points.  Errors are in source units -        */
+/*      radians or degrees for a latlong source.  The reverse plan is   */
+/*      built here, so a source definition that cannot be inverted      */
+/*      fails up front rather than mid-run.                             */
+/************************************************************************/
+
+int pj_transform_plan_validate( projTransformPlan plan_arg, int sample_rate )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+
+    if( plan == NULL )
+        return -1;
+
+    if( sample_rate <= 0 )
+    {
+        if( plan->validate_rplan != NULL )
+        {
+            pj_transform_plan_free( plan->validate_rplan );
+            plan->validate_rplan = NULL;
+        }
+        plan->validate_rate = 0;
+        return 0;
+    }
+
+    if( plan->validate_rplan == NULL )
+    {
+        plan->validate_rplan = (struct projTransformPlanType *)
+            pj_transform_plan_units( plan->dstdefn, plan->srcdefn,
+                                     plan->dst_degrees,
+                                     plan->src_degrees );
+        if( plan->validate_rplan == NULL )
+            return -1;
+    }
+
+    plan->validate_rate = sample_rate;
+    return 0;
+}
+
+/************************************************************************/
+/*                     pj_transform_plan_compact()                      */
+/*                                                                      */
+/*      Enable (nonzero) or disable lane compaction: after a stage      */
+/*      that marks failed points HUGE_VAL (grid shifts, projections),   */
+/*      a mostly-invalid block hands only the surviving points to the   */
+/*      remaining stages, densely packed, and scatters the results      */
+/*      back at the end.  Intended for sparse-valid workloads such as   */
+/*      ocean points masked out by @optional land-only grids.  Failed   */
+/*      lanes are treated as wholly dead once dropped: their z values   */
+/*      are not run through any later vertical stage.                   */
+/************************************************************************/
+
+int pj_transform_plan_compact( projTransformPlan plan_arg, int enable )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+
+    if( plan == NULL )
+        return -1;
+
+    plan->compact = enable != 0;
+    return 0;
+}
+
+/************************************************************************/
+/*                  pj_transform_plan_set_max_error()                   */
+/*                                                                      */
+/*      Allow pj_transform_exec() to approximate: blocks whose exact    */
+/*      results can be reproduced to within max_error (output units)    */
+/*      by bilinear interpolation of a transformed anchor mesh are      */
+/*      interpolated instead of run through the stage pipeline.  The    */
+/*      mesh is transformed through the exact path and the error is     */
+/*      measured against exact results at every cell midpoint,          */
+/*      refining the mesh until the tolerance holds; extents where it   */
+/*      never does fall back to the exact pipeline.  Intended for       */
+/*      overview pyramid levels whose accuracy needs are bounded by     */
+/*      the coarse pixel size.  With an area of use also declared, a    */
+/*      Chebyshev surrogate of the whole pipeline is additionally       */
+/*      fitted over the area (see plan_try_cheby()) and preferred       */
+/*      over the mesh.  2D only (z arrays always run exact), and        */
+/*      pj_transform_point() stays exact.  A max_error of 0             */
+/*      restores fully exact operation.  Returns 0, or -1 for a         */
+/*      malformed tolerance.                                            */
+/************************************************************************/
+
+int pj_transform_plan_set_max_error( projTransformPlan plan_arg,
+                                     double max_error )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+
+    if( plan == NULL || !(max_error >= 0.0) )
+        return -1;
+
+    plan->approx_tol = max_error;
+
+    /* a tolerance change invalidates the cached mesh and surrogate
+       verdicts both ways: a finer one may need refinement, a coarser
+       one may admit extents that previously failed */
+    if( plan->mesh != NULL )
+    {
+        pj_dalloc( plan->mesh->ax );
+        pj_dalloc( plan->mesh );
+        plan->mesh = NULL;
+    }
+    plan->mesh_failed = 0;
+    if( plan->cheb != NULL )
+    {
+        pj_cheby_free( plan->cheb );
+        plan->cheb = NULL;
+    }
+    plan->cheb_tried = 0;
+
+    if( max_error > 0.0 )
+        plan_try_cheby( plan );
+
+    return 0;
+}
+
+/************************************************************************/
+/*                        plan_area_overlaps()                          */
+/*                                                                      */
+/*      Does a grid's extent intersect the plan's declared area of      */
+/*      use?  The extent comes from the already loaded header, with     */
+/*      the same epsilon expansion the per point scan applies; an       */
+/*      area spanning the dateline (west > east) is treated as two      */
+/*      longitude intervals.                                            */
+/************************************************************************/
+
+static int plan_area_overlaps( struct projTransformPlanType *plan,
+                               PJ_GRIDINFO *gi )
+
+{
+    struct CTABLE *ct = gi->ct;
+    double epsilon, min_lam, max_lam, min_phi, max_phi;
+
+    if( ct == NULL )
+        return 1;   /* header not available: keep, the scan will sort it */
+
+    /* without PJ_LIB__ the CTABLE LP members read as u (lam), v (phi) */
+    epsilon = (fabs(ct->del.v)+fabs(ct->del.u))/10000.0;
+    min_lam = ct->ll.u - epsilon;
+    max_lam = ct->ll.u + (ct->lim.lam-1) * ct->del.u + epsilon;
+    min_phi = ct->ll.v - epsilon;
+    max_phi = ct->ll.v + (ct->lim.phi-1) * ct->del.v + epsilon;
+
+    if( max_phi < plan->area_south || min_phi > plan->area_north )
+        return 0;
+
+    if( plan->area_west <= plan->area_east )
+        return max_lam >= plan->area_west && min_lam <= plan->area_east;
+
+    return max_lam >= plan->area_west || min_lam <= plan->area_east;
+}
+
+/************************************************************************/
+/*                          plan_prune_grids()                          */
+/*                                                                      */
+/*      Rebuild the per stage grid lists for the declared area of       */
+/*      use: each grid shift stage gets a copy of its definition's      */
+/*      list holding only the grids whose extent intersects the         */
+/*      area.  NTv2 children travel with their parent, whose extent     */
+/*      contains theirs.  Stages that resolve through a grid catalog    */
+/*      are left on the generic path.                                   */
+/************************************************************************/
+
+static void plan_prune_grids( struct projTransformPlanType *plan )
+
+{
+    int is;
+
+    plan->grid_generation = pj_gridlist_generation();
+
+    for( is = 0; is < plan->stage_count; is++ )
+    {
+        PJtransformStage *stage = plan->stages + is;
+        PJ_GRIDINFO **full, **kept;
+        int full_count, kept_count, i;
+
+        if( stage->type != TR_STG_GRIDSHIFT
+            && stage->type != TR_STG_VGRIDSHIFT )
+            continue;
+
+        if( stage->gridlist != NULL )
+        {
+            pj_dalloc( stage->gridlist );
+            stage->gridlist = NULL;
+            stage->gridlist_count = 0;
+        }
+
+        if( stage->type == TR_STG_GRIDSHIFT )
+        {
+            if( stage->defn->catalog_name != NULL )
+                continue;
+            if( pj_gridshift_resolve( stage->defn ) != 0 )
+                continue;
+            full = stage->defn->gridlist;
+            full_count = stage->defn->gridlist_count;
+        }
+        else
+        {
+            if( stage->defn->vgridlist_geoid == NULL )
+                stage->defn->vgridlist_geoid =
+                    pj_gridlist_from_nadgrids(
+                        pj_get_ctx( stage->defn ),
+                        stage->defn->geoidgrids,
+                        &(stage->defn->vgridlist_geoid_count) );
+            full = stage->defn->vgridlist_geoid;
+            full_count = stage->defn->vgridlist_geoid_count;
+        }
+
+        if( full == NULL || full_count == 0 )
+            continue;
+
+        kept = (PJ_GRIDINFO **)
+            pj_malloc( sizeof(PJ_GRIDINFO *) * full_count );
+        if( kept == NULL )
+            continue;
+
+        kept_count = 0;
+        for( i = 0; i < full_count; i++ )
+            if( plan_area_overlaps( plan, full[i] ) )
+                kept[kept_count++] = full[i];
+
+        stage->gridlist = kept;
+        stage->gridlist_count = kept_count;
+
+        if( kept_count < full_count )
+            pj_log( pj_get_ctx( stage->defn ), PJ_LOG_DEBUG_MAJOR,
+                    "plan_prune_grids(): %d of %d grids intersect "
+                    "the area of use", kept_count, full_count );
+    }
+}
+
+/************************************************************************/
+/*                    pj_transform_plan_set_area()                      */
+/*                                                                      */
+/*      Declare the area of use (radians, south < north; west may      */
+/*      exceed east for an area spanning the dateline) the plan will    */
+/*      be fed.  Grid resolution then drops non intersecting grids      */
+/*      up front instead of rejecting them per point, and in a non      */
+/*      blocking grid load mode only the surviving grids are warmed.    */
+/*      Points outside the area still transform, but see the full       */
+/*      per point scan cost.  Returns 0, or -1 for a malformed area.    */
+/************************************************************************/
+
+int pj_transform_plan_set_area( projTransformPlan plan_arg,
+                                double west_long, double south_lat,
+                                double east_long, double north_lat )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+    int is;
+
+    if( plan == NULL || !(south_lat <= north_lat) )
+        return -1;
+
+    plan->has_area = 1;
+    plan->area_west = west_long;
+    plan->area_south = south_lat;
+    plan->area_east = east_long;
+    plan->area_north = north_lat;
+
+    plan_prune_grids( plan );
+
+/* -------------------------------------------------------------------- */
+/*      Re-warm just the surviving grids: the plan creation preload     */
+/*      covered the whole named list, but data blocks are fetched       */
+/*      lazily, so narrowing what gets touched still pays.              */
+/* -------------------------------------------------------------------- */
+    if( pj_ctx_get_grid_load_mode( pj_get_ctx(plan->srcdefn) )
+        != PJ_GRID_LOAD_BLOCK )
+    {
+        for( is = 0; is < plan->stage_count; is++ )
+        {
+            PJtransformStage *stage = plan->stages + is;
+            char names[1024];
+            int i;
+
+            if( stage->gridlist == NULL || stage->gridlist_count == 0 )
+                continue;
+
+            names[0] = '\0';
+            for( i = 0; i < stage->gridlist_count; i++ )
+            {
+                const char *gridname = stage->gridlist[i]->gridname;
+
+                if( strlen(names) + strlen(gridname) + 2 > sizeof(names) )
+                    break;
+                if( i > 0 )
+                    strcat( names, "," );
+                strcat( names, gridname );
+            }
+            pj_ctx_preload_grids_background(
+                pj_get_ctx( stage->defn ), names );
+        }
+    }
+
+    /* a new area means a new surrogate domain */
+    if( plan->cheb != NULL )
+    {
+        pj_cheby_free( plan->cheb );
+        plan->cheb = NULL;
+    }
+    plan->cheb_tried = 0;
+    plan_try_cheby( plan );
+
+    return 0;
+}
+
+/************************************************************************/
+/*                             memo_hash()                              */
+/************************************************************************/
+
+static unsigned int memo_hash( double x, double y )
+
+{
+    unsigned int w[4], h;
+
+    memcpy( w, &x, sizeof(double) );
+    memcpy( w + 2, &y, sizeof(double) );
+    h = w[0] ^ (w[1] * 31u) ^ (w[2] * 961u) ^ (w[3] * 29791u);
+    return h ^ (h >> 15);
+}
+
+/************************************************************************/
+/*                         plan_profile_now()                           */
+/*                                                                      */
+/*      Monotonic seconds for the per stage profile.  Two reads per     */
+/*      stage per block; at the 1024 point block size even the          */
+/*      cheapest stage dwarfs the clock read.                           */
+/************************************************************************/
+
+static double plan_profile_now( void )
+
+{
+#ifdef _WIN32
+    return GetTickCount() / 1000.0;
+#elif defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    struct timeval tv;
+
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+/************************************************************************/
+/*                          plan_run_stages()                           */
+/*                                                                      */
+/*      Run every stage over one span of points.  single_point          */
+/*      reflects the caller's overall point count and keeps the         */
+/*      transient-error behaviour of pj_transform(): only a true        */
+/*      one point request fails hard on transient projection errors.    */
+/************************************************************************/
+
+static int plan_compact_tail( struct projTransformPlanType *plan,
+                              int first_stage,
+                              long point_count, int point_offset,
+                              double *x, double *y, double *z );
+
+static int plan_run_stages( struct projTransformPlanType *plan,
+                            int first_stage,
+                            long point_count, int point_offset,
+                            double *x, double *y, double *z,
+                            int single_point )
+
+{
+    long i;
+    int  istage, err;
+    int  check_compact;
+    double prof_start = 0.0;
+
+    /* first_stage < 0 (from plan_compact_tail()'s in-place fallback)
+       encodes "run from -first_stage - 1 without re-checking", so an
+       allocation failure in the helper cannot recurse into it */
+    check_compact = plan->compact && !single_point && first_stage >= 0;
+    if( first_stage < 0 )
+        first_stage = -first_stage - 1;
+
+    for( istage = first_stage; istage < plan->stage_count; istage++ )
+    {
+        PJtransformStage *stage = plan->stages + istage;
+        PJ *defn = stage->defn;
+
+        /* lane compaction: at entry (arrays masked by the caller) and
+           after any stage that can mark lanes HUGE_VAL, a mostly dead
+           block hands only the survivors to the remaining stages */
+        if( check_compact
+            && point_count > 1 && point_count <= TR_BLOCK_POINTS
+            && (istage == first_stage
+                ? istage == 0
+                : (plan->stages[istage-1].type == TR_STG_GRIDSHIFT
+                   || plan->stages[istage-1].type == TR_STG_FWD_PROJ
+                   || plan->stages[istage-1].type == TR_STG_INV_PROJ
+                   || plan->stages[istage-1].type
+                       == TR_STG_INV_FWD_PROJ)) )
+        {
+            long nvalid = 0;
+
+            for( i = 0; i < point_count; i++ )
+            {
+                if( x[point_offset*i] != HUGE_VAL )
+                    nvalid++;
+            }
+            if( 2 * nvalid <= point_count )
+                return plan_compact_tail( plan, istage, point_count,
+                                          point_offset, x, y, z );
+        }
+
+        if( plan->profile )
+            prof_start = plan_profile_now();
+
+        switch( stage->type )
+        {
+          case TR_STG_AXIS_NORM:
+          case TR_STG_AXIS_DENORM:
+            err = pj_adjust_axis( defn->ctx, defn->axis,
+                                  stage->type == TR_STG_AXIS_DENORM,
+                                  point_count, point_offset, x, y, z );
+            if( err != 0 )
+                return err;
+            break;
+
+          case TR_STG_Z_SCALE:
+            if( z != NULL )
+            {
+                for( i = 0; i < point_count; i++ )
+                    z[point_offset*i] *= stage->value;
+            }
+            break;
+
+          case TR_STG_XY_SCALE:
+            for( i = 0; i < point_count; i++ )
+            {
+                if( x[point_offset*i] != HUGE_VAL )
+                {
+                    x[point_offset*i] *= stage->value;
+                    y[point_offset*i] *= stage->value;
+                }
+            }
+            break;
+
+          case TR_STG_AFFINE:
+            err = pj_affine_edge( defn != NULL
+                                      ? defn->ctx : plan->srcdefn->ctx,
+                                  defn != NULL ? defn->axis : NULL,
+                                  stage->inverse,
+                                  stage->xy_scale, stage->x_off,
+                                  stage->z_scale,
+                                  point_count, point_offset, x, y, z );
+            if( err != 0 )
+                return err;
+            break;
+
+          case TR_STG_GEOC_TO_GEOD:
+            err = pj_geocentric_to_geodetic( stage->a, stage->es,
+                                             point_count, point_offset,
+                                             x, y, z );
+            if( err != 0 )
+                return err;
+            break;
+
+          case TR_STG_GEOD_TO_GEOC:
+            err = pj_geodetic_to_geocentric( stage->a, stage->es,
+                                             point_count, point_offset,
+                                             x, y, z );
+            if( err != 0 && err != -14 )
+                return err;
+            break;
+
+          case TR_STG_INV_PROJ:
+            if( point_offset == 1 && !single_point
+                && defn->inv_batch != NULL && pj_use_batch_kernels() )
+            {
+                /* contiguous arrays over a projection with a batch
+                   kernel: one fused pass instead of per point pj_inv()
+                   scaffolding.  Failed points come back as HUGE_VAL
+                   with the transient -15, matching what the loop below
+                   degrades them to for multi point calls. */
+                pj_inv_batch( defn, point_count, x, y, x, y );
+                break;
+            }
+            for( i = 0; i < point_count; i++ )
+            {
+                XY projected_loc;
+                LP geodetic_loc;
+
+                projected_loc.u = x[point_offset*i];
+                projected_loc.v = y[point_offset*i];
+
+                if( projected_loc.u == HUGE_VAL )
+                    continue;
+
+                geodetic_loc = pj_inv( projected_loc, defn );
+                if( defn->ctx->last_errno != 0 )
+                {
+                    if( (defn->ctx->last_errno != 33 /*EDOM*/
+                         && defn->ctx->last_errno != 34 /*ERANGE*/ )
+                        && (defn->ctx->last_errno > 0
+                            || defn->ctx->last_errno < -44 || single_point
+                            || pj_transient_error[-defn->ctx->last_errno] == 0 ) )
+                        return defn->ctx->last_errno;
+                    else
+                    {
+                        geodetic_loc.u = HUGE_VAL;
+                        geodetic_loc.v = HUGE_VAL;
+                    }
+                }
+
+                x[point_offset*i] = geodetic_loc.u;
+                y[point_offset*i] = geodetic_loc.v;
+            }
+            break;
+
+          case TR_STG_FWD_PROJ:
+            if( point_offset == 1 && !single_point
+                && defn->fwd_batch != NULL && pj_use_batch_kernels() )
+            {
+                /* the latlong to web mercator plan lands here: bounds
+                   checks, lam0/adjlon, the spherical kernel and the
+                   false origin scaling run as one fused pass over the
+                   arrays, bypassing the pj_fwd() scaffolding. */
+                pj_fwd_batch( defn, point_count, x, y, x, y );
+                break;
+            }
+            for( i = 0; i < point_count; i++ )
+            {
+                XY projected_loc;
+                LP geodetic_loc;
+
+                geodetic_loc.u = x[point_offset*i];
+                geodetic_loc.v = y[point_offset*i];
+
+                if( geodetic_loc.u == HUGE_VAL )
+                    continue;
+
+                projected_loc = pj_fwd( geodetic_loc, defn );
+                if( defn->ctx->last_errno != 0 )
+                {
+                    if( (defn->ctx->last_errno != 33 /*EDOM*/
+                         && defn->ctx->last_errno != 34 /*ERANGE*/ )
+                        && (defn->ctx->last_errno > 0
+                            || defn->ctx->last_errno < -44 || single_point
+                            || pj_transient_error[-defn->ctx->last_errno] == 0 ) )
+                        return defn->ctx->last_errno;
+                    else
+                    {
+                        projected_loc.u = HUGE_VAL;
+                        projected_loc.v = HUGE_VAL;
+                    }
+                }
+
+                x[point_offset*i] = projected_loc.u;
+                y[point_offset*i] = projected_loc.v;
+            }
+            break;
+
+          case TR_STG_INV_FWD_PROJ:
+            /* fused inverse + forward pass: the intermediate lat/long
+               never round-trips through the arrays.  The per point
+               logic is the two stages above run back to back. */
+            for( i = 0; i < point_count; i++ )
+            {
+                XY projected_loc;
+                LP geodetic_loc;
+
+                projected_loc.u = x[point_offset*i];
+                projected_loc.v = y[point_offset*i];
+
+                if( projected_loc.u == HUGE_VAL )
+                    continue;
+
+                geodetic_loc = pj_inv( projected_loc, defn );
+                if( defn->ctx->last_errno != 0 )
+                {
+                    if( (defn->ctx->last_errno != 33 /*EDOM*/
+                         && defn->ctx->last_errno != 34 /*ERANGE*/ )
+                        && (defn->ctx->last_errno > 0
+                            || defn->ctx->last_errno < -44 || single_point
+                            || pj_transient_error[-defn->ctx->last_errno] == 0 ) )
+                        return defn->ctx->last_errno;
+                    else
+                    {
+                        geodetic_loc.u = HUGE_VAL;
+                        geodetic_loc.v = HUGE_VAL;
+                    }
+                }
+
+                if( geodetic_loc.u == HUGE_VAL )
+                {
+                    x[point_offset*i] = geodetic_loc.u;
+                    y[point_offset*i] = geodetic_loc.v;
+                    continue;
+                }
+
+                projected_loc = pj_fwd( geodetic_loc, stage->defn2 );
+                if( stage->defn2->ctx->last_errno != 0 )
+                {
+                    if( (stage->defn2->ctx->last_errno != 33 /*EDOM*/
+                         && stage->defn2->ctx->last_errno != 34 /*ERANGE*/ )
+                        && (stage->defn2->ctx->last_errno > 0
+                            || stage->defn2->ctx->last_errno < -44
+                            || single_point
+                            || pj_transient_error[
+                                   -stage->defn2->ctx->last_errno] == 0 ) )
+                        return stage->defn2->ctx->last_errno;
+                    else
+                    {
+                        projected_loc.u = HUGE_VAL;
+                        projected_loc.v = HUGE_VAL;
+                    }
+                }
+
+                x[point_offset*i] = projected_loc.u;
+                y[point_offset*i] = projected_loc.v;
+            }
+            break;
+
+          case TR_STG_PM_OFFSET:
+            for( i = 0; i < point_count; i++ )
+            {
+                if( x[point_offset*i] != HUGE_VAL )
+                    x[point_offset*i] += stage->value;
+            }
+            break;
+
+          case TR_STG_VGRIDSHIFT:
+            if( stage->gridlist != NULL
+                ? pj_apply_vgridshift( defn,
+                                       &(stage->gridlist),
+                                       &(stage->gridlist_count),
+                                       stage->inverse,
+                                       point_count, point_offset,
+                                       x, y, z ) != 0
+                : pj_apply_vgridshift( defn,
+                                       &(defn->vgridlist_geoid),
+                                       &(defn->vgridlist_geoid_count),
+                                       stage->inverse,
+                                       point_count, point_offset,
+                                       x, y, z ) != 0 )
+                return pj_ctx_get_errno(defn->ctx);
+            break;
+
+          case TR_STG_GRIDSHIFT:
+            if( stage->gridlist != NULL )
+                pj_apply_gridshift_3( pj_get_ctx( defn ),
+                                      stage->gridlist,
+                                      stage->gridlist_count,
+                                      stage->inverse,
+                                      point_count, point_offset, x, y, z );
+            else
+                pj_apply_gridshift_2( defn, stage->inverse,
+                                      point_count, point_offset, x, y, z );
+            if( defn->ctx->last_errno != 0
+                && (defn->ctx->last_errno > 0
+                    || pj_transient_error[-defn->ctx->last_errno] == 0) )
+                return defn->ctx->last_errno;
+            break;
+
+          case TR_STG_HELMERT_TO_WGS84:
+            pj_geocentric_to_wgs84( defn, point_count, point_offset, x, y, z );
+            break;
+
+          case TR_STG_HELMERT_FROM_WGS84:
+            pj_geocentric_from_wgs84( defn, point_count, point_offset, x, y, z );
+            break;
+
+          case TR_STG_LONG_WRAP:
+            for( i = 0; i < point_count; i++ )
+            {
+                if( x[point_offset*i] == HUGE_VAL )
+                    continue;
+
+                while( x[point_offset*i] < defn->long_wrap_center - PI )
+                    x[point_offset*i] += TWOPI;
+                while( x[point_offset*i] > defn->long_wrap_center + PI )
+                    x[point_offset*i] -= TWOPI;
+            }
+            break;
+        }
+
+        /* stages that bail out with a hard error above are not
+           attributed; the run is over anyway */
+        if( plan->profile )
+        {
+            plan->prof_secs[istage] += plan_profile_now() - prof_start;
+            plan->prof_calls[istage]++;
+            plan->prof_points[istage] += point_count;
+        }
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                         plan_compact_tail()                          */
+/*                                                                      */
+/*      Run the remaining stages over only the valid lanes of a         */
+/*      mostly-HUGE_VAL block: gather the survivors into contiguous     */
+/*      scratch arrays, run the tail of the pipeline densely, and       */
+/*      scatter the results back.  The caller has already established   */
+/*      that at least half the lanes are dead - the copies only pay     */
+/*      for themselves on sparse blocks.  Dead lanes keep the values    */
+/*      they failed with; in particular their z is not run through      */
+/*      any later vertical stage.                                       */
+/************************************************************************/
+
+static int plan_compact_tail( struct projTransformPlanType *plan,
+                              int first_stage,
+                              long point_count, int point_offset,
+                              double *x, double *y, double *z )
+
+{
+    double *buf, *cx, *cy, *cz;
+    long *idx;
+    long i, nvalid = 0;
+    int err;
+
+    for( i = 0; i < point_count; i++ )
+    {
+        if( x[point_offset*i] != HUGE_VAL )
+            nvalid++;
+    }
+
+    if( nvalid == 0 )
+        return 0;
+
+    buf = (double *) pj_ctx_buffer_get(
+        plan->srcdefn->ctx,
+        TR_BLOCK_POINTS * (3 * sizeof(double) + sizeof(long)) );
+    if( buf == NULL )
+        return plan_run_stages( plan, -first_stage - 1, point_count,
+                                point_offset, x, y, z, 0 );
+
+    cx = buf;
+    cy = buf + TR_BLOCK_POINTS;
+    cz = buf + 2 * TR_BLOCK_POINTS;
+    idx = (long *) (cz + TR_BLOCK_POINTS);
+
+    nvalid = 0;
+    for( i = 0; i < point_count; i++ )
+    {
+        if( x[point_offset*i] == HUGE_VAL )
+            continue;
+        cx[nvalid] = x[point_offset*i];
+        cy[nvalid] = y[point_offset*i];
+        if( z != NULL )
+            cz[nvalid] = z[point_offset*i];
+        idx[nvalid++] = i;
+    }
+
+    err = plan_run_stages( plan, first_stage, nvalid, 1,
+                           cx, cy, z != NULL ? cz : NULL, 0 );
+
+    for( i = 0; i < nvalid; i++ )
+    {
+        x[point_offset*idx[i]] = cx[i];
+        y[point_offset*idx[i]] = cy[i];
+        if( z != NULL )
+            z[point_offset*idx[i]] = cz[i];
+    }
+
+    pj_ctx_buffer_put( plan->srcdefn->ctx, buf );
+    return err;
+}
+
+/************************************************************************/
+/*                        plan_run_block_memo()                         */
+/*                                                                      */
+/*      As plan_run_stages() over one block, but consulting the memo    */
+/*      cache first: hits are written straight from the table, misses   */
+/*      are gathered into compact scratch arrays, run through the       */
+/*      pipeline once, scattered back and inserted.  Failed points      */
+/*      (HUGE_VAL results) are cached too - the same input would fail   */
+/*      the same way again.                                             */
+/************************************************************************/
+
+static int plan_run_block_memo( struct projTransformPlanType *plan,
+                                long point_count, int point_offset,
+                                double *x, double *y, double *block_z,
+                                int single_point )
+
+{
+    struct PJtransformMemoType *memo = plan->memo;
+    long i, nmiss = 0;
+    int  err;
+
+    for( i = 0; i < point_count; i++ )
+    {
+        double xi = x[point_offset*i];
+        double yi = y[point_offset*i];
+        PJtransformMemoEntry *e = NULL;
+        unsigned int h;
+        int probe;
+
+        if( xi == HUGE_VAL )
+            continue;
+
+        memo->lookups++;
+        h = memo_hash( xi, yi );
+        for( probe = 0; probe < TR_MEMO_PROBES; probe++ )
+        {
+            PJtransformMemoEntry *cand =
+                memo->table + ((h + probe) & memo->mask);
+
+            if( !cand->used )
+                break;
+            if( cand->in_x == xi && cand->in_y == yi )
+            {
+                e = cand;
+                break;
+            }
+        }
+
+        if( e != NULL )
+        {
+            memo->hits++;
+            x[point_offset*i] = e->out_x;
+            y[point_offset*i] = e->out_y;
+        }
+        else
+        {
+            memo->save_x[nmiss] = xi;
+            memo->save_y[nmiss] = yi;
+            memo->miss_x[nmiss] = xi;
+            memo->miss_y[nmiss] = yi;
+            memo->miss_idx[nmiss] = i;
+            nmiss++;
+        }
+    }
+
+    if( nmiss == 0 )
+        return 0;
+
+    err = plan_run_stages( plan, 0, nmiss, 1,
+                           memo->miss_x, memo->miss_y, block_z,
+                           single_point );
+    if( err != 0 )
+        return err;
+
+    for( i = 0; i < nmiss; i++ )
+    {
+        unsigned int h = memo_hash( memo->save_x[i], memo->save_y[i] );
+        PJtransformMemoEntry *e = memo->table + (h & memo->mask);
+        int probe;
+
+        x[point_offset*memo->miss_idx[i]] = memo->miss_x[i];
+        y[point_offset*memo->miss_idx[i]] = memo->miss_y[i];
+
+        /* first free probe slot, else overwrite the home slot */
+        for( probe = 0; probe < TR_MEMO_PROBES; probe++ )
+        {
+            PJtransformMemoEntry *cand =
+                memo->table + ((h + probe) & memo->mask);
+
+            if( !cand->used )
+            {
+                e = cand;
+                break;
+            }
+        }
+        e->used = 1;
+        e->in_x = memo->save_x[i];
+        e->in_y = memo->save_y[i];
+        e->out_x = memo->miss_x[i];
+        e->out_y = memo->miss_y[i];
+    }
+
+    return 0;
+}
+
+/************************************************************************/
+/*                        plan_mesh_interpolate()                       */
+/*                                                                      */
+/*      Bilinear interpolation of a block from the validated anchor     */
+/*      mesh.  Every finite input lies inside the mesh extent (the      */
+/*      caller checked), so the cell lookup only clamps the exact       */
+/*      upper edge; HUGE_VAL lanes pass through untouched.              */
+/************************************************************************/
+
+static void plan_mesh_interpolate( struct PJtransformMeshType *mesh,
+                                   long point_count, int point_offset,
+                                   double *x, double *y )
+
+{
+    int row = mesh->ncell + 1;
+    long i;
+
+    for( i = 0; i < point_count; i++ )
+    {
+        double px = x[point_offset*i];
+        double py = y[point_offset*i];
+        double fx, fy, wx, wy;
+        const double *ax, *ay;
+        int ix, iy;
+
+        if( px == HUGE_VAL )
+            continue;
+
+        fx = (px - mesh->minx) / mesh->stepx;
+        fy = (py - mesh->miny) / mesh->stepy;
+        ix = (int) fx;
+        iy = (int) fy;
+        if( ix >= mesh->ncell ) ix = mesh->ncell - 1;
+        if( iy >= mesh->ncell ) iy = mesh->ncell - 1;
+        if( ix < 0 ) ix = 0;
+        if( iy < 0 ) iy = 0;
+        wx = fx - ix;
+        wy = fy - iy;
+
+        ax = mesh->ax + iy * row + ix;
+        ay = mesh->ay + iy * row + ix;
+        x[point_offset*i] =
+            (1.0-wy) * ((1.0-wx) * ax[0] + wx * ax[1])
+            +    wy  * ((1.0-wx) * ax[row] + wx * ax[row+1]);
+        y[point_offset*i] =
+            (1.0-wy) * ((1.0-wx) * ay[0] + wx * ay[1])
+            +    wy  * ((1.0-wx) * ay[row] + wx * ay[row+1]);
+    }
+}
+
+/************************************************************************/
+/*                          plan_mesh_build()                           */
+/*                                                                      */
+/*      Build and validate an anchor mesh over the given input          */
+/*      extent.  Anchors are transformed through the exact stage        */
+/*      pipeline, then the exact result at every cell midpoint is       */
+/*      compared against its interpolation from the four surrounding    */
+/*      anchors; the mesh is refined until the worst midpoint error     */
+/*      is within the tolerance.  An anchor or midpoint the exact       */
+/*      path cannot transform fails the build (the extent straddles     */
+/*      the domain edge), as does a tolerance still unmet at the        */
+/*      finest refinement; failed extents are remembered so exec        */
+/*      does not retry them every block.  The exact runs must not       */
+/*      disturb the caller's error state.                               */
+/************************************************************************/
+
+static int plan_mesh_build( struct projTransformPlanType *plan,
+                            double minx, double miny,
+                            double maxx, double maxy )
+
+{
+    projCtx ctx = plan->srcdefn->ctx;
+    int src_errno = ctx->last_errno;
+    int dst_errno = plan->dstdefn->ctx->last_errno;
+    /* 31 is the ceiling: 32x32 anchors fill the scratch block */
+    static const int sizes[] = { 4, 8, 16, 31 };
+    double *buf, *ax, *ay, *mx, *my;
+    double stepx = 0.0, stepy = 0.0;
+    int si, nc = 0, row, ok = 0, hard_fail = 0;
+
+    /* a degenerate axis (single row or column of input) still needs a
+       positive cell size for the interpolation weights */
+    if( !(maxx - minx > 0.0) )
+        maxx = minx + (fabs(minx) + 1.0) * 1e-9;
+    if( !(maxy - miny > 0.0) )
+        maxy = miny + (fabs(miny) + 1.0) * 1e-9;
+
+    buf = (double *) pj_ctx_buffer_get(
+        ctx, sizeof(double) * 4 * TR_BLOCK_POINTS );
+    if( buf == NULL )
+        return -1;
+    ax = buf;
+    ay = buf + TR_BLOCK_POINTS;
+    mx = buf + 2 * TR_BLOCK_POINTS;
+    my = buf + 3 * TR_BLOCK_POINTS;
+
+    for( si = 0; si < (int) (sizeof(sizes)/sizeof(int))
+             && !ok && !hard_fail; si++ )
+    {
+        double maxerr = 0.0;
+        long m, k;
+        int ix, iy;
+
+        nc = sizes[si];
+        row = nc + 1;
+        stepx = (maxx - minx) / nc;
+        stepy = (maxy - miny) / nc;
+
+        for( iy = 0; iy < row; iy++ )
+            for( ix = 0; ix < row; ix++ )
+            {
+                ax[iy*row + ix] = minx + ix * stepx;
+                ay[iy*row + ix] = miny + iy * stepy;
+            }
+        m = (long) row * row;
+        if( plan_run_stages( plan, 0, m, 1, ax, ay, NULL, 0 ) != 0 )
+        {
+            hard_fail = 1;
+            break;
+        }
+        for( k = 0; k < m; k++ )
+            if( ax[k] == HUGE_VAL )
+                hard_fail = 1;
+        if( hard_fail )
+            break;
+
+        for( iy = 0; iy < nc; iy++ )
+            for( ix = 0; ix < nc; ix++ )
+            {
+                mx[iy*nc + ix] = minx + (ix + 0.5) * stepx;
+                my[iy*nc + ix] = miny + (iy + 0.5) * stepy;
+            }
+        m = (long) nc * nc;
+        if( plan_run_stages( plan, 0, m, 1, mx, my, NULL, 0 ) != 0 )
+        {
+            hard_fail = 1;
+            break;
+        }
+
+        for( iy = 0; iy < nc && !hard_fail; iy++ )
+            for( ix = 0; ix < nc; ix++ )
+            {
+                const double *cx = ax + iy*row + ix;
+                const double *cy = ay + iy*row + ix;
+                double e;
+
+                if( mx[iy*nc + ix] == HUGE_VAL )
+                {
+                    hard_fail = 1;
+                    break;
+                }
+                e = hypot(
+                    0.25 * (cx[0] + cx[1] + cx[row] + cx[row+1])
+                        - mx[iy*nc + ix],
+                    0.25 * (cy[0] + cy[1] + cy[row] + cy[row+1])
+                        - my[iy*nc + ix] );
+                if( !(e <= maxerr) )
+                    maxerr = e;
+            }
+
+        if( !hard_fail && maxerr <= plan->approx_tol )
+        {
+            pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
+                    "plan_mesh_build(): %dx%d mesh within %g "
+                    "(worst midpoint error %g)",
+                    nc, nc, plan->approx_tol, maxerr );
+            ok = 1;
+        }
+    }
+
+    ctx->last_errno = src_errno;
+    plan->dstdefn->ctx->last_errno = dst_errno;
+
+    if( !ok )
+    {
+        pj_ctx_buffer_put( ctx, buf );
+        plan->mesh_failed = 1;
+        plan->mesh_bad_minx = minx;
+        plan->mesh_bad_miny = miny;
+        plan->mesh_bad_maxx = maxx;
+        plan->mesh_bad_maxy = maxy;
+        return -1;
+    }
+
+    if( plan->mesh == NULL || plan->mesh->ncell != nc )
+    {
+        struct PJtransformMeshType *mesh;
+        double *anchors = (double *)
+            pj_malloc( sizeof(double) * 2 * row * row );
+
+        mesh = (struct PJtransformMeshType *) pj_malloc( sizeof(*mesh) );
+        if( mesh == NULL || anchors == NULL )
+        {
+            pj_dalloc( mesh );
+            pj_dalloc( anchors );
+            pj_ctx_buffer_put( ctx, buf );
+            return -1;
+        }
+        if( plan->mesh != NULL )
+        {
+            pj_dalloc( plan->mesh->ax );
+            pj_dalloc( plan->mesh );
+        }
+        mesh->ax = anchors;
+        mesh->ay = anchors + row * row;
+        plan->mesh = mesh;
+    }
+
+    plan->mesh->minx = minx;
+    plan->mesh->miny = miny;
+    plan->mesh->maxx = maxx;
+    plan->mesh->maxy = maxy;
+    plan->mesh->stepx = stepx;
+    plan->mesh->stepy = stepy;
+    plan->mesh->ncell = nc;
+    memcpy( plan->mesh->ax, ax, sizeof(double) * row * row );
+    memcpy( plan->mesh->ay, ay, sizeof(double) * row * row );
+    plan->mesh_failed = 0;
+
+    pj_ctx_buffer_put( ctx, buf );
+    return 0;
+}
+
+/************************************************************************/
+/*                        plan_run_block_mesh()                         */
+/*                                                                      */
+/*      Try to satisfy one block by mesh interpolation.  Returns 1      */
+/*      when the block now holds final output, 0 to send it down the    */
+/*      exact path.  A cached mesh covering the block is used as is;    */
+/*      otherwise a mesh over the union of the block extent and any     */
+/*      previous mesh extent is built and validated, so successive      */
+/*      blocks of a raster sweep converge on one mesh for the full      */
+/*      extent instead of one per block.                                */
+/************************************************************************/
+
+static int plan_run_block_mesh( struct projTransformPlanType *plan,
+                                long point_count, int point_offset,
+                                double *x, double *y )
+
+{
+    double minx = HUGE_VAL, miny = HUGE_VAL;
+    double maxx = -HUGE_VAL, maxy = -HUGE_VAL;
+    long i, nvalid = 0;
+
+    for( i = 0; i < point_count; i++ )
+    {
+        double px = x[point_offset*i];
+        double py = y[point_offset*i];
+
+        if( px == HUGE_VAL )
+            continue;
+        if( !(px > -HUGE_VAL && px < HUGE_VAL)
+            || !(py > -HUGE_VAL && py < HUGE_VAL) )
+            return 0;   /* non finite junk: let the exact path define it */
+        if( px < minx ) minx = px;
+        if( px > maxx ) maxx = px;
+        if( py < miny ) miny = py;
+        if( py > maxy ) maxy = py;
+        nvalid++;
+    }
+
+    if( nvalid == 0 )
+        return 1;   /* nothing to transform, lanes stay HUGE_VAL */
+
+    if( plan->cheb != NULL && point_offset == 1
+        && minx >= plan->cheb_low.u && maxx <= plan->cheb_upp.u
+        && miny >= plan->cheb_low.v && maxy <= plan->cheb_upp.v )
+    {
+        biveval_batch( plan->cheb, point_count, x, y, x, y );
+        return 1;
+    }
+
+    if( plan->mesh != NULL
+        && minx >= plan->mesh->minx && maxx <= plan->mesh->maxx
+        && miny >= plan->mesh->miny && maxy <= plan->mesh->maxy )
+    {
+        plan_mesh_interpolate( plan->mesh, point_count, point_offset,
+                               x, y );
+        return 1;
+    }
+
+    /* building costs hundreds of exact points: not for small tails */
+    if( point_count < TR_MESH_MIN_POINTS )
+        return 0;
+
+    if( plan->mesh_failed
+        && minx >= plan->mesh_bad_minx && maxx <= plan->mesh_bad_maxx
+        && miny >= plan->mesh_bad_miny && maxy <= plan->mesh_bad_maxy )
+        return 0;
+
+    if( plan->mesh != NULL )
+    {
+        if( plan->mesh->minx < minx ) minx = plan->mesh->minx;
+        if( plan->mesh->maxx > maxx ) maxx = plan->mesh->maxx;
+        if( plan->mesh->miny < miny ) miny = plan->mesh->miny;
+        if( plan->mesh->maxy > maxy ) maxy = plan->mesh->maxy;
+    }
+
+    if( plan_mesh_build( plan, minx, miny, maxx, maxy ) != 0 )
+        return 0;
+
+    plan_mesh_interpolate( plan->mesh, point_count, point_offset, x, y );
+    return 1;
+}
+
+/************************************************************************/
+/*                          plan_try_cheby()                            */
+/*                                                                      */
+/*      With both an area of use and an error budget declared, try      */
+/*      to fit a bivariate Chebyshev surrogate of the whole pipeline    */
+/*      over the area with mk_cheby(), so fixed extent workloads        */
+/*      (tile matrices) evaluate a few polynomial terms per point       */
+/*      regardless of kernel complexity.  The fit is accepted only      */
+/*      if the surrogate reproduces the exact path to within the        */
+/*      budget over a dense validation lattice; otherwise the plan      */
+/*      falls back to the anchor mesh and exact paths.  mk_cheby()      */
+/*      takes a bare function pointer, so the plan being fitted is      */
+/*      parked in a file scope pointer under the legacy recursive       */
+/*      lock (the grid subsystem uses the separate rwlocks, so the      */
+/*      exact runs inside the fit cannot deadlock).  Geographic         */
+/*      (latlong) sources only: the declared area is in geographic      */
+/*      coordinates and cannot describe a projected input domain.       */
+/************************************************************************/
+
+static struct projTransformPlanType *cheb_fit_plan = NULL;
+
+static projUV plan_cheby_func( projUV in )
+
+{
+    double x = in.u, y = in.v;
+    projUV out;
+
+    if( plan_run_stages( cheb_fit_plan, 0, 1, 1, &x, &y, NULL, 0 ) != 0
+        || x == HUGE_VAL )
+        out.u = out.v = HUGE_VAL;
+    else
+    {
+        out.u = x;
+        out.v = y;
+    }
+    return out;
+}
+
+#define TR_CHEB_VALIDATE 31   /* validation lattice points per axis */
+
+static void plan_try_cheby( struct projTransformPlanType *plan )
+
+{
+    projCtx ctx;
+    int src_errno, dst_errno;
+    /* a few fit attempts bound the setup cost; 24x24 evaluates under
+       a thousand exact points in bchgen(), and starting small matters
+       for speed as much as fit time - evaluation cost grows with the
+       square of the order */
+    static const int sizes[] = { 6, 12, 24 };
+    double scale;
+    projUV low, upp, resid;
+    Tseries *T = NULL;
+    double *buf, *px, *py, *ex, *ey;
+    int si;
+
+    if( plan->cheb_tried || plan->approx_tol <= 0.0 || !plan->has_area
+        || plan->needs_z || !plan->srcdefn->is_latlong )
+        return;
+    plan->cheb_tried = 1;
+
+    /* an area spanning the dateline folds over in the input domain */
+    if( plan->area_west >= plan->area_east
+        || plan->area_south >= plan->area_north )
+        return;
+
+    scale = plan->src_degrees ? RAD_TO_DEG : 1.0;
+    low.u = plan->area_west * scale;
+    upp.u = plan->area_east * scale;
+    low.v = plan->area_south * scale;
+    upp.v = plan->area_north * scale;
+
+    ctx = plan->srcdefn->ctx;
+    src_errno = ctx->last_errno;
+    dst_errno = plan->dstdefn->ctx->last_errno;
+
+    buf = (double *) pj_ctx_buffer_get(
+        ctx, sizeof(double) * 4 * TR_BLOCK_POINTS );
+    if( buf == NULL )
+        return;
+    px = buf;
+    py = buf + TR_BLOCK_POINTS;
+    ex = buf + 2 * TR_BLOCK_POINTS;
+    ey = buf + 3 * TR_BLOCK_POINTS;
+
+    pj_acquire_lock();
+    cheb_fit_plan = plan;
+
+    for( si = 0; si < (int) (sizeof(sizes)/sizeof(int)) && T == NULL;
+         si++ )
+    {
+        double maxerr = 0.0;
+        long m, k;
+        int ix, iy;
+
+        /* trim coefficients an order below the budget; the lattice
+           check below still judges the trimmed series as a whole */
+        T = mk_cheby( low, upp, plan->approx_tol / 10.0, &resid,
+                      plan_cheby_func, sizes[si], sizes[si], 0 );
+        if( T == NULL )
+            continue;
+
+/* -------------------------------------------------------------------- */
+/*      Validate against the exact path on a uniform lattice: the fit   */
+/*      nodes are Chebyshev points, so a uniform lattice probes        */
+/*      between them where the error peaks.                             */
+/* -------------------------------------------------------------------- */
+        m = 0;
+        for( iy = 0; iy < TR_CHEB_VALIDATE; iy++ )
+            for( ix = 0; ix < TR_CHEB_VALIDATE; ix++ )
+            {
+                px[m] = low.u + (upp.u - low.u) * ix
+                    / (TR_CHEB_VALIDATE - 1);
+                py[m] = low.v + (upp.v - low.v) * iy
+                    / (TR_CHEB_VALIDATE - 1);
+                ex[m] = px[m];
+                ey[m] = py[m];
+                m++;
+            }
+
+        if( plan_run_stages( plan, 0, m, 1, ex, ey, NULL, 0 ) != 0 )
+        {
+            pj_cheby_free( T );
+            T = NULL;
+            break;      /* the exact path fails inside the area */
+        }
+
+        for( k = 0; k < m; k++ )
+        {
+            projUV in, out;
+            double e;
+
+            if( ex[k] == HUGE_VAL )
+            {
+                maxerr = HUGE_VAL;
+                break;
+            }
+            in.u = px[k];
+            in.v = py[k];
+            out = biveval( in, T );
+            e = hypot( out.u - ex[k], out.v - ey[k] );
+            if( !(e <= maxerr) )
+                maxerr = e;
+        }
+
+        if( maxerr > plan->approx_tol )
+        {
+            pj_cheby_free( T );
+            T = NULL;
+        }
+        else
+            pj_log( ctx, PJ_LOG_DEBUG_MAJOR,
+                    "plan_try_cheby(): %dx%d surrogate within %g "
+                    "(worst lattice error %g)",
+                    sizes[si], sizes[si], plan->approx_tol, maxerr );
+    }
+
+    cheb_fit_plan = NULL;
+    pj_release_lock();
+
+    ctx->last_errno = src_errno;
+    plan->dstdefn->ctx->last_errno = dst_errno;
+    pj_ctx_buffer_put( ctx, buf );
+
+    if( T != NULL )
+    {
+        if( plan->cheb != NULL )
+            pj_cheby_free( plan->cheb );
+        plan->cheb = T;
+        plan->cheb_low = low;
+        plan->cheb_upp = upp;
+    }
+}
+
+/************************************************************************/
+/*                        plan_validate_save()                          */
+/*                                                                      */
+/*      Copy the sampled lanes of a block aside before the stages       */
+/*      overwrite them in place.  The scratch buffer holds six          */
+/*      TR_BLOCK_POINTS double arrays (saved x/y/z, round trip x/y/z)   */
+/*      followed by the sampled lane indices.                           */
+/************************************************************************/
+
+static long plan_validate_save( struct projTransformPlanType *plan,
+                                long block_start, long block_count,
+                                int point_offset,
+                                const double *x, const double *y,
+                                const double *z, double *vbuf )
+
+{
+    double *sx = vbuf;
+    double *sy = vbuf + TR_BLOCK_POINTS;
+    double *sz = vbuf + 2 * TR_BLOCK_POINTS;
+    long *idx = (long *) (vbuf + 6 * TR_BLOCK_POINTS);
+    int rate = plan->validate_rate;
+    long i, n = 0;
+
+    for( i = (rate - (int) (block_start % rate)) % rate;
+         i < block_count; i += rate )
+    {
+        if( x[point_offset*i] == HUGE_VAL )
+            continue;
+
+        sx[n] = x[point_offset*i];
+        sy[n] = y[point_offset*i];
+        sz[n] = z != NULL ? z[point_offset*i] : 0.0;
+        idx[n] = i;
+        n++;
+    }
+
+    return n;
+}
+
+/************************************************************************/
+/*                         plan_validate_run()                          */
+/*                                                                      */
+/*      Round trip the sampled outputs of a completed block through     */
+/*      the reverse plan and fold the horizontal distance back to the   */
+/*      saved inputs into the context counters.  Lanes whose forward    */
+/*      transform failed are skipped (that failure is already visible   */
+/*      to the caller); reverse failures count as roundtrip_failures.   */
+/*      The reverse run must not disturb the caller's error state, so   */
+/*      last_errno is restored afterwards.                              */
+/************************************************************************/
+
+static void plan_validate_run( struct projTransformPlanType *plan,
+                               long n, int point_offset,
+                               const double *x, const double *y,
+                               const double *z, double *vbuf )
+
+{
+    double *sx = vbuf;
+    double *sy = vbuf + TR_BLOCK_POINTS;
+    double *rx = vbuf + 3 * TR_BLOCK_POINTS;
+    double *ry = vbuf + 4 * TR_BLOCK_POINTS;
+    double *rz = vbuf + 5 * TR_BLOCK_POINTS;
+    long *idx = (long *) (vbuf + 6 * TR_BLOCK_POINTS);
+    projCtx ctx = plan->srcdefn->ctx;
+    int src_errno = ctx->last_errno;
+    int dst_errno = plan->dstdefn->ctx->last_errno;
+    long k, m = 0;
+
+    for( k = 0; k < n; k++ )
+    {
+        long i = idx[k];
+
+        if( x[point_offset*i] == HUGE_VAL )
+            continue;
+
+        rx[m] = x[point_offset*i];
+        ry[m] = y[point_offset*i];
+        rz[m] = z != NULL ? z[point_offset*i] : 0.0;
+        /* compact the saved inputs to match (k >= m, so in order) */
+        sx[m] = sx[k];
+        sy[m] = sy[k];
+        m++;
+    }
+
+    if( m > 0 )
+    {
+        if( pj_transform_exec( plan->validate_rplan, m, 1, rx, ry,
+                               z != NULL ? rz : NULL ) == 0 )
+        {
+            for( k = 0; k < m; k++ )
+            {
+                double e;
+
+                if( rx[k] == HUGE_VAL || ry[k] == HUGE_VAL )
+                {
+                    PJ_STAT_INC( ctx, roundtrip_failures );
+                    continue;
+                }
+
+                e = hypot( rx[k] - sx[k], ry[k] - sy[k] );
+                if( !(e >= 0.0) )   /* NaN from a misbehaving stage */
+                {
+                    PJ_STAT_INC( ctx, roundtrip_failures );
+                    continue;
+                }
+
+                PJ_STAT_INC( ctx, roundtrip_points );
+                PJ_STAT_ADD( ctx, roundtrip_err_sum, e );
+#ifndef PJ_DISABLE_STATS
+                if( e > ctx->stats.roundtrip_err_max )
+                    ctx->stats.roundtrip_err_max = e;
+#endif
+            }
+        }
+        else
+            PJ_STAT_ADD( ctx, roundtrip_failures, (unsigned long) m );
+    }
+
+    ctx->last_errno = src_errno;
+    plan->dstdefn->ctx->last_errno = dst_errno;
+}
+
+/************************************************************************/
+/*                         pj_transform_exec()                          */
+/*                                                                      */
+/*      Run the recorded stages over the point arrays.  Semantics       */
+/*      match pj_transform() for the same src/dst pair.  Rather than    */
+/*      streaming the whole arrays through memory once per stage, the   */
+/*      pipeline is run to completion over one cache sized block of     */
+/*      points at a time, so a multi stage 3D conversion still reads    */
+/*      and writes each coordinate about once; every stage is point     */
+/*      local so the result is unchanged.                               */
+/************************************************************************/
+
+int pj_transform_exec( projTransformPlan plan_arg,
+                       long point_count, int point_offset,
+                       double *x, double *y, double *z )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+    long i, block_start;
+    long progress_next;
+    int  err;
+    double *gather_buf = NULL;
+    double *validate_buf = NULL;
+
+    if( plan == NULL )
+        return -1;
+
+    plan->srcdefn->ctx->last_errno = 0;
+    plan->dstdefn->ctx->last_errno = 0;
+
+    /* the pruned stage grid lists die with the grids they point at */
+    if( plan->has_area
+        && plan->grid_generation != pj_gridlist_generation() )
+        plan_prune_grids( plan );
+
+    if( point_offset == 0 )
+        point_offset = 1;
+
+/* -------------------------------------------------------------------- */
+/*      Affine-only plans run as a single fused pass instead of one     */
+/*      loop per stage.  Such plans never need a temporary z array.     */
+/* -------------------------------------------------------------------- */
+    if( plan->is_affine && plan->progress_fn == NULL
+        && plan->validate_rate <= 0 )
+    {
+        double s = plan->aff_xyscale;
+        double xoff = plan->aff_xoff;
+
+        if( s != 1.0 || xoff != 0.0 )
+        {
+            for( i = 0; i < point_count; i++ )
+            {
+                if( x[point_offset*i] != HUGE_VAL )
+                {
+                    x[point_offset*i] = s * x[point_offset*i] + xoff;
+                    y[point_offset*i] *= s;
+                }
+            }
+        }
+        if( z != NULL && plan->aff_zscale != 1.0 )
+        {
+            for( i = 0; i < point_count; i++ )
+                z[point_offset*i] *= plan->aff_zscale;
+        }
+        return 0;
+    }
+
+    if( z == NULL && plan->needs_z )
+    {
+        if( plan->srcdefn->is_geocent || plan->dstdefn->is_geocent )
+        {
+            pj_ctx_set_errno( plan->srcdefn->ctx, PJD_ERR_GEOCENTRIC );
+            return PJD_ERR_GEOCENTRIC;
+        }
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Strided callers (interleaved xyz buffers) would turn every      */
+/*      stage loop into a gather; copy each block into contiguous       */
+/*      working arrays instead and scatter the results back, so the     */
+/*      stages always see unit stride.  The same scratch doubles as     */
+/*      the temporary z for plans that need one.                        */
+/* -------------------------------------------------------------------- */
+    if( (point_offset != 1 && point_count > 1)
+        || (z == NULL && plan->needs_z) )
+    {
+        gather_buf = (double *) pj_ctx_buffer_get(
+            plan->srcdefn->ctx, sizeof(double) * 3 * TR_BLOCK_POINTS );
+        if( gather_buf == NULL )
+        {
+            if( z == NULL && plan->needs_z )
+                return ENOMEM;
+            /* pure gather optimization: stay on the strided loops */
+        }
+    }
+
+    if( plan->validate_rate > 0 && plan->validate_rplan != NULL )
+    {
+        validate_buf = (double *) pj_ctx_buffer_get(
+            plan->srcdefn->ctx,
+            TR_BLOCK_POINTS * (6 * sizeof(double) + sizeof(long)) );
+        /* on allocation failure skip validation; the transform
+           itself is unaffected */
+    }
+
+    progress_next = plan->progress_interval > 0
+        ? plan->progress_interval : 0;
+
+    for( block_start = 0; block_start < point_count;
+         block_start += TR_BLOCK_POINTS )
+    {
+        long block_count = point_count - block_start;
+        double *block_x = x + point_offset * block_start;
+        double *block_y = y + point_offset * block_start;
+        double *block_z = z != NULL ? z + point_offset * block_start : NULL;
+        int block_offset = point_offset;
+        long validate_count = 0;
+
+        if( block_count > TR_BLOCK_POINTS )
+            block_count = TR_BLOCK_POINTS;
+
+        if( validate_buf != NULL )
+            validate_count = plan_validate_save( plan, block_start,
+                                                 block_count, point_offset,
+                                                 block_x, block_y, block_z,
+                                                 validate_buf );
+
+        if( plan->approx_tol > 0.0 && z == NULL && !plan->needs_z
+            && plan_run_block_mesh( plan, block_count, block_offset,
+                                    block_x, block_y ) )
+            err = 0;
+        else if( gather_buf != NULL )
+        {
+            double *gx = gather_buf;
+            double *gy = gather_buf + TR_BLOCK_POINTS;
+            double *gz = gather_buf + 2 * TR_BLOCK_POINTS;
+
+            for( i = 0; i < block_count; i++ )
+            {
+                gx[i] = block_x[point_offset*i];
+                gy[i] = block_y[point_offset*i];
+            }
+            if( block_z != NULL )
+            {
+                for( i = 0; i < block_count; i++ )
+                    gz[i] = block_z[point_offset*i];
+            }
+            else if( plan->needs_z )
+                memset( gz, 0, sizeof(double) * block_count );
+
+            if( plan->memo != NULL && z == NULL )
+                err = plan_run_block_memo( plan, block_count, 1,
+                                           gx, gy,
+                                           plan->needs_z ? gz : NULL,
+                                           point_count == 1 );
+            else
+                err = plan_run_stages( plan, 0, block_count, 1,
+                                       gx, gy,
+                                       block_z != NULL || plan->needs_z
+                                           ? gz : NULL,
+                                       point_count == 1 );
+
+            for( i = 0; i < block_count; i++ )
+            {
+                block_x[point_offset*i] = gx[i];
+                block_y[point_offset*i] = gy[i];
+            }
+            if( block_z != NULL )
+                for( i = 0; i < block_count; i++ )
+                    block_z[point_offset*i] = gz[i];
+        }
+        else if( plan->memo != NULL && z == NULL )
+            err = plan_run_block_memo( plan, block_count, block_offset,
+                                       block_x, block_y, block_z,
+                                       point_count == 1 );
+        else
+            err = plan_run_stages( plan, 0, block_count, block_offset,
+                                   block_x, block_y, block_z,
+                                   point_count == 1 );
+
+        if( err != 0 )
+        {
+            if( gather_buf != NULL )
+                pj_ctx_buffer_put( plan->srcdefn->ctx, gather_buf );
+            if( validate_buf != NULL )
+                pj_ctx_buffer_put( plan->srcdefn->ctx, validate_buf );
+            return err;
+        }
+
+        if( validate_count > 0 )
+            plan_validate_run( plan, validate_count, point_offset,
+                               block_x, block_y, block_z, validate_buf );
+
+        if( plan->progress_fn != NULL )
+        {
+            long done = block_start + block_count;
+
+            if( done >= progress_next || done == point_count )
+            {
+                int stop = plan->progress_fn( plan->progress_arg, done );
+
+                if( stop != 0 )
+                {
+                    /* every point before `done` holds final output;
+                       the caller resumes on the remaining tail */
+                    if( gather_buf != NULL )
+                        pj_ctx_buffer_put( plan->srcdefn->ctx,
+                                           gather_buf );
+                    if( validate_buf != NULL )
+                        pj_ctx_buffer_put( plan->srcdefn->ctx,
+                                           validate_buf );
+                    return stop;
+                }
+                progress_next = done + plan->progress_interval;
+            }
+        }
+    }
+
+    if( gather_buf != NULL )
+        pj_ctx_buffer_put( plan->srcdefn->ctx, gather_buf );
+    if( validate_buf != NULL )
+        pj_ctx_buffer_put( plan->srcdefn->ctx, validate_buf );
+    return 0;
+}
+
+/************************************************************************/
+/*                         pj_transform_point()                         */
+/*                                                                      */
+/*      Single point specialization of pj_transform_exec() for          */
+/*      latency bound callers (interactive picking): everything runs    */
+/*      on scalars, no buffer pool round trips, and the dominant        */
+/*      shape - a fused affine straight into a forward projection -     */
+/*      is inlined around one pj_fwd() call.  Results are identical     */
+/*      to exec over the same plan with one point; the round trip       */
+/*      validation sampling, a bulk monitoring feature, does not        */
+/*      apply here.                                                     */
+/************************************************************************/
+
+int pj_transform_point( projTransformPlan plan_arg,
+                        double *x, double *y, double *z )
+
+{
+    struct projTransformPlanType *plan =
+        (struct projTransformPlanType *) plan_arg;
+    double zz;
+    int istage;
+
+    if( plan == NULL )
+        return -1;
+
+    plan->srcdefn->ctx->last_errno = 0;
+    plan->dstdefn->ctx->last_errno = 0;
+
+    /* the pruned stage grid lists die with the grids they point at */
+    if( plan->has_area
+        && plan->grid_generation != pj_gridlist_generation() )
+        plan_prune_grids( plan );
+
+    if( plan->is_affine )
+    {
+        if( *x != HUGE_VAL )
+        {
+            double s = plan->aff_xyscale;
+            double xoff = plan->aff_xoff;
+
+            if( s != 1.0 || xoff != 0.0 )
+            {
+                *x = s * *x + xoff;
+                *y *= s;
+            }
+        }
+        if( z != NULL && plan->aff_zscale != 1.0 )
+            *z *= plan->aff_zscale;
+        return 0;
+    }
+
+    if( plan->memo != NULL && z == NULL )
+        return plan_run_block_memo( plan, 1, 1, x, y, NULL, 1 );
+
+/* -------------------------------------------------------------------- */
+/*      Inline the unit conversion + forward projection pair without    */
+/*      entering the stage loop.  The affine arithmetic mirrors         */
+/*      pj_affine_edge() case for case so the results stay bit for      */
+/*      bit identical.                                                  */
+/* -------------------------------------------------------------------- */
+    istage = 0;
+    if( plan->stage_count == 2
+        && ((plan->stages[0].type == TR_STG_AFFINE
+             && plan->stages[0].defn == NULL)
+            || plan->stages[0].type == TR_STG_XY_SCALE) )
+        istage = 1;
+
+    if( plan->stage_count - istage == 1
+        && plan->stages[istage].type == TR_STG_FWD_PROJ
+        && *x != HUGE_VAL )
+    {
+        PJ *defn = plan->stages[istage].defn;
+        LP  geodetic_loc;
+        XY  projected_loc;
+
+        geodetic_loc.u = *x;
+        geodetic_loc.v = *y;
+
+        if( istage == 1 && plan->stages[0].type == TR_STG_XY_SCALE )
+        {
+            geodetic_loc.u *= plan->stages[0].value;
+            geodetic_loc.v *= plan->stages[0].value;
+        }
+        else if( istage == 1 )
+        {
+            double s = plan->stages[0].xy_scale;
+            double xoff = plan->stages[0].x_off;
+
+            if( s != 1.0 && xoff != 0.0 )
+            {
+                geodetic_loc.u = geodetic_loc.u * s + xoff;
+                geodetic_loc.v *= s;
+            }
+            else if( s != 1.0 )
+            {
+                geodetic_loc.u *= s;
+                geodetic_loc.v *= s;
+            }
+            else if( xoff != 0.0 )
+                geodetic_loc.u += xoff;
+
+            if( z != NULL && plan->stages[0].z_scale != 1.0 )
+                *z *= plan->stages[0].z_scale;
+        }
+
+        projected_loc = pj_fwd( geodetic_loc, defn );
+        if( defn->ctx->last_errno != 0 )
+        {
+            if( defn->ctx->last_errno != 33 /*EDOM*/
+                && defn->ctx->last_errno != 34 /*ERANGE*/ )
+                return defn->ctx->last_errno;
+            projected_loc.u = HUGE_VAL;
+            projected_loc.v = HUGE_VAL;
+        }
+
+        *x = projected_loc.u;
+        *y = projected_loc.v;
+        return 0;
+    }
+
+    if( z == NULL && plan->needs_z )
+    {
+        if( plan->srcdefn->is_geocent || plan->dstdefn->is_geocent )
+        {
+            pj_ctx_set_errno( plan->srcdefn->ctx, PJD_ERR_GEOCENTRIC );
+            return PJD_ERR_GEOCENTRIC;
+        }
+
+        /* a scalar temporary replaces the pooled gather buffer */
+        zz = 0.0;
+        z = &zz;
+    }
+
+    return plan_run_stages( plan, 0, 1, 1, x, y, z, 1 );
+}
@@ -8,3 +8,21 @@ pj_tsfn(double phi, double sinphi, double e) {
 	return (tan (.5 * (HALFPI - phi)) /
 	   pow((1. - sinphi) / (1. + sinphi), .5 * e));
 }
+
+	void /* batch form over contiguous arrays; the pow is evaluated in
+	** exp/log form (one vectorizable call chain instead of a scalar
+	** pow), so results match pj_tsfn() to rounding rather than bit
+	** for bit - a kernel comparing against setup constants should
+	** derive both through the same form */
+pj_tsfn_batch(long n, const double *phi, const double *sinphi, double e,
+	double *out) {
+	double he = .5 * e;
+	long i;
+
+	for (i = 0; i < n; ++i) {
+		double con = e * sinphi[i];
+
+		out[i] = tan (.5 * (HALFPI - phi[i])) *
+		   exp(he * log((1. + con) / (1. - con)));
+	}
+}
@@ -59,6 +59,103 @@ int pj_is_geocent( PJ *pj )
     return pj != NULL && pj->is_geocent;
 }
 
+/************************************************************************/
+/*                       pj_is_same_definition()                        */
+/*                                                                      */
+/*      Returns TRUE if the two objects were assembled from the same    */
+/*      parameters, regardless of the order they were given in.  The    */
+/*      comparison runs on the canonical sorted definition              */
+/*      interned at init time, so the usual cost is one hash compare;   */
+/*      the string compare only confirms a hash match.  Objects that    */
+/*      carry no interned definition compare unequal.                   */
+/************************************************************************/
+
+int pj_is_same_definition( projPJ srcdefn, projPJ dstdefn )
+
+{
+    PJ *src = (PJ *) srcdefn;
+    PJ *dst = (PJ *) dstdefn;
+
+    if( src == dst )
+        return src != NULL;
+    if( src == NULL || dst == NULL )
+        return FALSE;
+    if( src->defn_hash == 0 || src->defn_hash != dst->defn_hash )
+        return FALSE;
+    return src->defn_canonical != NULL && dst->defn_canonical != NULL
+        && strcmp( src->defn_canonical, dst->defn_canonical ) == 0;
+}
+
+/************************************************************************/
+/*                        pj_use_batch_kernels()                        */
+/*                                                                      */
+/*      Several projections carry two implementations per direction:    */
+/*      the scalar per point kernel and a fused batch kernel over       */
+/*      contiguous arrays.  The batch kernels are the default; the      */
+/*      PJ_KERNEL environment variable (checked once) forces the        */
+/*      scalar path with PJ_KERNEL=scalar, mainly for isolating ulp     */
+/*      level differences between the two when debugging.  Any other    */
+/*      value keeps the default.  pj_set_batch_kernels() overrides      */
+/*      both programmatically.                                          */
+/************************************************************************/
+
+static int batch_kernels_flag = -1;
+
+void pj_set_batch_kernels( int flag )
+
+{
+    batch_kernels_flag = flag;
+}
+
+int pj_use_batch_kernels()
+
+{
+    if( pj_use_deterministic() )
+        return 0;
+    if( batch_kernels_flag < 0 )
+    {
+        const char *mode = getenv( "PJ_KERNEL" );
+
+        batch_kernels_flag = mode == NULL || strcmp(mode, "scalar") != 0;
+    }
+    return batch_kernels_flag;
+}
+
+/************************************************************************/
+/*                        pj_use_deterministic()                        */
+/*                                                                      */
+/*      Deterministic mode pins every computation to the canonical      */
+/*      scalar kernels, so identical jobs produce bit identical         */
+/*      output regardless of which optional fused/batch paths a build   */
+/*      or platform would otherwise pick.  Enabled with                 */
+/*      pj_set_deterministic() or the PJ_DETERMINISTIC environment      */
+/*      variable (checked once).  For cross platform identity the      */
+/*      library must also be built without floating point expression    */
+/*      contraction - see the PROJ_FP_CONTRACT_OFF cmake option; the    */
+/*      remaining ulp level platform differences come from the C        */
+/*      library's transcendentals.                                      */
+/************************************************************************/
+
+static int deterministic_flag = -1;
+
+void pj_set_deterministic( int flag )
+
+{
+    deterministic_flag = flag;
+}
+
+int pj_use_deterministic()
+
+{
+    if( deterministic_flag < 0 )
+    {
+        const char *mode = getenv( "PJ_DETERMINISTIC" );
+
+        deterministic_flag = mode != NULL && atoi(mode) != 0;
+    }
+    return deterministic_flag;
+}
+
 /************************************************************************/
 /*                        pj_latlong_from_proj()                        */
 /*                                                                      */
@@ -0,0 +1,83 @@
+/* array-at-a-time wrappers over libm - see pj_vmath.h for the contract */
+#include <math.h>
+#include "pj_vmath.h"
+
+void pj_vsin( long n, const double *a, double *out )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+        out[i] = sin(a[i]);
+}
+
+void pj_vcos( long n, const double *a, double *out )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+        out[i] = cos(a[i]);
+}
+
+void pj_vsincos( long n, const double *a, double *s, double *c )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+    {
+        s[i] = sin(a[i]);
+        c[i] = cos(a[i]);
+    }
+}
+
+void pj_vtan( long n, const double *a, double *out )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+        out[i] = tan(a[i]);
+}
+
+void pj_vatan( long n, const double *a, double *out )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+        out[i] = atan(a[i]);
+}
+
+void pj_vatan2( long n, const double *y, const double *x, double *out )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+        out[i] = atan2(y[i], x[i]);
+}
+
+void pj_vlog( long n, const double *a, double *out )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+        out[i] = log(a[i]);
+}
+
+void pj_vexp( long n, const double *a, double *out )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+        out[i] = exp(a[i]);
+}
+
+void pj_vsqrt( long n, const double *a, double *out )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+        out[i] = sqrt(a[i]);
+}
+
+void pj_vhypot( long n, const double *x, const double *y, double *out )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+        out[i] = hypot(x[i], y[i]);
+}
+
+void pj_vpow( long n, const double *a, double expn, double *out )
+{
+    long i;
+    for( i = 0; i < n; i++ )
+        out[i] = pow(a[i], expn);
+}
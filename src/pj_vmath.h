@@ -0,0 +1,69 @@
+#ifndef PJ_VMATH_H
+#define PJ_VMATH_H
+
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  PROJ.4
+ * Purpose:  Array-at-a-time math helpers for batch projection kernels.
+ *
+ *           Each routine evaluates one libm function over a contiguous
+ *           double array.  The loops carry no branches or cross-iteration
+ *           dependencies, so a vectorizing compiler (or one wired to a
+ *           vector libm such as glibc's libmvec) can lower them to SIMD
+ *           as the target allows; everywhere else they simply batch the
+ *           scalar calls.  Results are always the platform libm's - full
+ *           precision, bit identical to calling the function point by
+ *           point.
+ *
+ *           Batch kernels (see PJ_merc.c, PJ_lcc.c for the dispatch) can
+ *           be written as a few passes over staging arrays using these
+ *           primitives instead of one fused loop when the fused form
+ *           defeats the vectorizer.
+ *
+ ******************************************************************************
+ * Copyright (c) 2012, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pj_vsin( long n, const double *a, double *out );
+void pj_vcos( long n, const double *a, double *out );
+void pj_vsincos( long n, const double *a, double *s, double *c );
+void pj_vtan( long n, const double *a, double *out );
+void pj_vatan( long n, const double *a, double *out );
+void pj_vatan2( long n, const double *y, const double *x, double *out );
+void pj_vlog( long n, const double *a, double *out );
+void pj_vexp( long n, const double *a, double *out );
+void pj_vsqrt( long n, const double *a, double *out );
+void pj_vhypot( long n, const double *x, const double *y, double *out );
+
+/* pow over an array with one common exponent - the shape every conic
+** and cylindrical kernel needs (pow(tsfn, n), pow(rho/c, 1/n), ..) */
+void pj_vpow( long n, const double *a, double expn, double *out );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PJ_VMATH_H */
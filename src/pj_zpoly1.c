@@ -44,3 +44,59 @@ pj_zpolyd1(COMPLEX z, COMPLEX *C, int n, COMPLEX *der) {
 	*der = b;
 	return a;
 }
+/* batch variants: structure-of-arrays real/imag lanes, so evaluating
+** a whole batch is a pair of fused multiply-add recurrences per
+** point with the coefficient walk in registers.  In place safe. */
+	void
+pj_zpoly1_batch(const double *zr, const double *zi, double *ar,
+	double *ai, long np, const COMPLEX *C, int n) {
+	long j;
+
+	for (j = 0; j < np; ++j) {
+		double xr = zr[j], xi = zi[j];
+		const COMPLEX *c = C + n;
+		double vr = c->r, vi = c->i, t;
+		int i;
+
+		for (i = n; i > 0; --i) {
+			--c;
+			vr = c->r + xr * (t = vr) - xi * vi;
+			vi = c->i + xr * vi + xi * t;
+		}
+		ar[j] = xr * (t = vr) - xi * vi;
+		ai[j] = xr * vi + xi * t;
+	}
+}
+	void
+pj_zpolyd1_batch(const double *zr, const double *zi, double *ar,
+	double *ai, double *dr, double *di, long np, const COMPLEX *C,
+	int n) {
+	long j;
+
+	for (j = 0; j < np; ++j) {
+		double xr = zr[j], xi = zi[j];
+		const COMPLEX *c = C + n;
+		double vr = c->r, vi = c->i, br = 0., bi = 0., t;
+		int i, first = 1;
+
+		for (i = n; i > 0; --i) {
+			if (first) {
+				first = 0;
+				br = vr;
+				bi = vi;
+			} else {
+				br = vr + xr * (t = br) - xi * bi;
+				bi = vi + xr * bi + xi * t;
+			}
+			--c;
+			vr = c->r + xr * (t = vr) - xi * vi;
+			vi = c->i + xr * vi + xi * t;
+		}
+		br = vr + xr * (t = br) - xi * bi;
+		bi = vi + xr * bi + xi * t;
+		ar[j] = xr * (t = vr) - xi * vi;
+		ai[j] = xr * vi + xi * t;
+		dr[j] = br;
+		di[j] = bi;
+	}
+}
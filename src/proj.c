@@ -17,6 +17,13 @@
 #endif
 /* ! TK 1999-02-13 */
 
+#if !defined(_WIN32) && !defined(WIN32)
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
 #define MAX_LINE 1000
 #define MAX_PARGS 100
 #define PJ_INVERS(P) (P->inv ? 1 : 0)
@@ -36,13 +43,14 @@ prescale = 0,	/* != 0 apply cartesian scale factor */
 dofactors = 0,	/* determine scale factors */
 facs_bad = 0,	/* return condition from pj_factors */
 very_verby = 0, /* very verbose mode */
+njobs = 0,	/* > 1 processes mmap'ed file input in parallel line ranges */
 postscale = 0;
 	static char
 *cheby_str,		/* string controlling Chebychev evaluation */
 *oform = (char *)0,	/* output format for x-y or decimal degrees */
 *oterr = "*\t*",	/* output line for unprojectable input */
 *usage =
-"%s\nusage: %s [ -beEfiIlormsStTvVwW [args] ] [ +opts[=arg] ] [ files ]\n";
+"%s\nusage: %s [ -beEfiIjlormsStTvVwW [args] ] [ +opts[=arg] ] [ files ]\n";
 	static struct FACTORS
 facs;
 	static double
@@ -55,12 +63,58 @@ int_proj(projUV data) {
 	if (postscale && data.u != HUGE_VAL)
 		{ data.u *= fscale; data.v *= fscale; }
 	return(data);
+}
+#define BIN_CHUNK 65536
+	static void	/* block processing of packed binary pairs */
+process_bin(FILE *fid) {
+	static double *buf = (double *)0;
+	double *in_u, *in_v, *out_u, *out_v;
+	long n, i;
+
+	if (!buf && !(buf = (double *)pj_malloc(sizeof(double) * BIN_CHUNK * 6)))
+		emess(2,"binary buffer allocation failed");
+	in_u = buf + BIN_CHUNK * 2;
+	in_v = in_u + BIN_CHUNK;
+	out_u = in_v + BIN_CHUNK;
+	out_v = out_u + BIN_CHUNK;
+	while ((n = (long)fread(buf, 2 * sizeof(double), BIN_CHUNK, fid)) > 0) {
+		for (i = 0; i < n; ++i) { /* deinterleave the pairs */
+			in_u[i] = buf[i + i];
+			in_v[i] = buf[i + i + 1];
+		}
+		if (prescale)
+			for (i = 0; i < n; ++i) {
+				in_u[i] *= fscale;
+				in_v[i] *= fscale;
+			}
+		if (inverse)
+			(void)pj_inv_batch(Proj, n, in_u, in_v, out_u, out_v);
+		else
+			(void)pj_fwd_batch(Proj, n, in_u, in_v, out_u, out_v);
+		if (postscale)
+			for (i = 0; i < n; ++i)
+				if (out_u[i] != HUGE_VAL) {
+					out_u[i] *= fscale;
+					out_v[i] *= fscale;
+				}
+		for (i = 0; i < n; ++i) {
+			buf[i + i] = out_u[i];
+			buf[i + i + 1] = out_v[i];
+		}
+		if (fwrite(buf, 2 * sizeof(double), n, stdout) != (size_t)n)
+			emess(2,"binary output write failure");
+	}
 }
 	static void	/* file processing function */
 process(FILE *fid) {
 	char line[MAX_LINE+3], *s, pline[40];
 	projUV data;
 
+	if (bin_in && bin_out) { /* both ends binary: process in blocks,
+		** same packed native doubles as the per point path */
+		process_bin(fid);
+		return;
+	}
 	for (;;) {
 		++emess_dat.File_line;
 		if (bin_in) {	/* binary input */
@@ -116,13 +170,13 @@ process(FILE *fid) {
 			(void)fputs(oterr, stdout);
 		else if (inverse && !oform) {	/*ascii DMS output */
 			if (reverseout) {
-				(void)fputs(rtodms(pline, data.v, 'N', 'S'), stdout);
+				(void)fputs(rtodms_fast(pline, data.v, 'N', 'S'), stdout);
 				putchar('\t');
-				(void)fputs(rtodms(pline, data.u, 'E', 'W'), stdout);
+				(void)fputs(rtodms_fast(pline, data.u, 'E', 'W'), stdout);
 			} else {
-				(void)fputs(rtodms(pline, data.u, 'E', 'W'), stdout);
+				(void)fputs(rtodms_fast(pline, data.u, 'E', 'W'), stdout);
 				putchar('\t');
-				(void)fputs(rtodms(pline, data.v, 'N', 'S'), stdout);
+				(void)fputs(rtodms_fast(pline, data.v, 'N', 'S'), stdout);
 			}
 		} else {	/* x-y or decimal degree ascii output */
 			if (inverse) {
@@ -148,6 +202,206 @@ process(FILE *fid) {
                 }
 		(void)fputs(bin_in ? "\n" : s, stdout);
 	}
+}
+	struct range {	/* one slice of mmap'ed input lines and its output */
+	const char *beg, *end;	/* [beg,end), end on a line boundary */
+	char *out;
+	size_t out_len, out_cap;
+};
+	static void	/* append len bytes to a range's output buffer */
+range_append(struct range *r, const char *s, size_t len) {
+	if (r->out_len + len > r->out_cap) {
+		size_t cap = r->out_cap ? r->out_cap * 2 : 4096;
+		char *nb;
+
+		while (cap < r->out_len + len)
+			cap *= 2;
+		if (!(nb = (char *)pj_malloc(cap)))
+			emess(2,"range output allocation failed");
+		if (r->out) {
+			memcpy(nb, r->out, r->out_len);
+			pj_dalloc(r->out);
+		}
+		r->out = nb;
+		r->out_cap = cap;
+	}
+	memcpy(r->out + r->out_len, s, len);
+	r->out_len += len;
+}
+	static void	/* parse, project and format one line range; runs
+	** on the worker pool, so all output goes to the range buffer and
+	** projection errors come back in band through the quiet batch
+	** entries instead of the shared ctx */
+process_range(void *arg) {
+	struct range *r = (struct range *)arg;
+	const char *p = r->beg;
+	char line[MAX_LINE+3], pline[40], obuf[256], *s;
+	projUV data;
+
+	while (p < r->end) {
+		const char *nl = memchr(p, '\n', r->end - p);
+		size_t len = nl ? (size_t)(nl - p) + 1 : (size_t)(r->end - p);
+
+		/* mirror the fgets() path: overlong lines are truncated
+		** and the remainder dropped, the final line gets its
+		** missing newline */
+		if (len > MAX_LINE - 1) {
+			memcpy(line, p, MAX_LINE - 1);
+			line[MAX_LINE - 1] = '\n';
+			line[MAX_LINE] = '\0';
+		} else {
+			memcpy(line, p, len);
+			if (!len || line[len - 1] != '\n')
+				line[len++] = '\n';
+			line[len] = '\0';
+		}
+		p = nl ? nl + 1 : r->end;
+		if (*line == tag) {
+			range_append(r, line, strlen(line));
+			continue;
+		}
+		s = line;
+		if (reversein) {
+			data.v = (*informat)(s, &s);
+			data.u = (*informat)(s, &s);
+		} else {
+			data.u = (*informat)(s, &s);
+			data.v = (*informat)(s, &s);
+		}
+		if (data.v == HUGE_VAL)
+			data.u = HUGE_VAL;
+		if (!*s && (s > line)) --s; /* assumed we gobbled \n */
+		if (echoin) {
+			int t;
+			t = *s;
+			*s = '\0';
+			range_append(r, line, strlen(line));
+			*s = (char)t;
+			range_append(r, "\t", 1);
+		}
+		if (data.u != HUGE_VAL) {
+			projUV out;
+
+			if (prescale) { data.u *= fscale; data.v *= fscale; }
+			if (inverse)
+				(void)pj_inv_batch_quiet(Proj, 1,
+					&data.u, &data.v, &out.u, &out.v);
+			else
+				(void)pj_fwd_batch_quiet(Proj, 1,
+					&data.u, &data.v, &out.u, &out.v);
+			data = out;
+			if (postscale && data.u != HUGE_VAL)
+				{ data.u *= fscale; data.v *= fscale; }
+		}
+		if (data.u == HUGE_VAL) /* error output */
+			range_append(r, oterr, strlen(oterr));
+		else if (inverse && !oform) {	/*ascii DMS output */
+			char *t;
+
+			if (reverseout) {
+				t = rtodms_fast(pline, data.v, 'N', 'S');
+				range_append(r, t, strlen(t));
+				range_append(r, "\t", 1);
+				t = rtodms_fast(pline, data.u, 'E', 'W');
+				range_append(r, t, strlen(t));
+			} else {
+				t = rtodms_fast(pline, data.u, 'E', 'W');
+				range_append(r, t, strlen(t));
+				range_append(r, "\t", 1);
+				t = rtodms_fast(pline, data.v, 'N', 'S');
+				range_append(r, t, strlen(t));
+			}
+		} else {	/* x-y or decimal degree ascii output */
+			if (inverse) {
+				data.v *= RAD_TO_DEG;
+				data.u *= RAD_TO_DEG;
+			}
+			if (reverseout) {
+				(void)sprintf(obuf, oform, data.v);
+				range_append(r, obuf, strlen(obuf));
+				range_append(r, "\t", 1);
+				(void)sprintf(obuf, oform, data.u);
+				range_append(r, obuf, strlen(obuf));
+			} else {
+				(void)sprintf(obuf, oform, data.u);
+				range_append(r, obuf, strlen(obuf));
+				range_append(r, "\t", 1);
+				(void)sprintf(obuf, oform, data.v);
+				range_append(r, obuf, strlen(obuf));
+			}
+		}
+		range_append(r, s, strlen(s));
+	}
+}
+#define RANGE_MIN_BYTES 65536
+	static int	/* mmap a plain file input and process its line
+	** ranges on the worker pool, writing results in input order;
+	** returns 0 when the input cannot be mapped and the caller must
+	** fall back to the line-at-a-time path */
+process_mmapped(FILE *fid) {
+#if defined(_WIN32) || defined(WIN32)
+	(void)fid;
+	return 0;
+#else
+	struct stat sb;
+	const char *base, *p, *file_end;
+	struct range *ranges;
+	void **args;
+	long target;
+	int nr, k;
+
+	if (fstat(fileno(fid), &sb) != 0 || !S_ISREG(sb.st_mode)
+		|| sb.st_size <= 0)
+		return 0;
+	base = (const char *)mmap(NULL, (size_t)sb.st_size, PROT_READ,
+		MAP_PRIVATE, fileno(fid), 0);
+	if (base == (const char *)MAP_FAILED)
+		return 0;
+	file_end = base + sb.st_size;
+
+	/* tiny inputs are not worth the fan out */
+	nr = njobs;
+	while (nr > 1 && sb.st_size / nr < RANGE_MIN_BYTES)
+		--nr;
+
+	if (!(ranges = (struct range *)pj_malloc(sizeof(struct range) * nr
+			+ sizeof(void *) * nr))) {
+		(void)munmap((void *)base, (size_t)sb.st_size);
+		return 0;
+	}
+	args = (void **)(ranges + nr);
+
+	target = (long)(sb.st_size / nr);
+	p = base;
+	for (k = 0; k < nr; ++k) {
+		const char *q;
+
+		ranges[k].beg = p;
+		if (k == nr - 1 || p + target >= file_end)
+			q = file_end;
+		else {
+			q = memchr(p + target, '\n', file_end - (p + target));
+			q = q ? q + 1 : file_end;
+		}
+		ranges[k].end = q;
+		ranges[k].out = NULL;
+		ranges[k].out_len = ranges[k].out_cap = 0;
+		args[k] = ranges + k;
+		p = q;
+	}
+
+	pj_tpool_run(process_range, args, nr);
+
+	for (k = 0; k < nr; ++k) {
+		if (ranges[k].out_len)
+			(void)fwrite(ranges[k].out, 1, ranges[k].out_len, stdout);
+		if (ranges[k].out)
+			pj_dalloc(ranges[k].out);
+	}
+	pj_dalloc(ranges);
+	(void)munmap((void *)base, (size_t)sb.st_size);
+	return 1;
+#endif
 }
 	static void	/* file processing function --- verbosely */
 vprocess(FILE *fid) {
@@ -217,10 +471,10 @@ vprocess(FILE *fid) {
 		if (*s != '\n')
 			(void)fputs(s, stdout);
 		(void)fputs("Longitude: ", stdout);
-		(void)fputs(rtodms(pline, dat_ll.u, 'E', 'W'), stdout);
+		(void)fputs(rtodms_fast(pline, dat_ll.u, 'E', 'W'), stdout);
 		(void)printf(" [ %.11g ]\n", dat_ll.u * RAD_TO_DEG);
 		(void)fputs("Latitude:  ", stdout);
-		(void)fputs(rtodms(pline, dat_ll.v, 'N', 'S'), stdout);
+		(void)fputs(rtodms_fast(pline, dat_ll.v, 'N', 'S'), stdout);
 		(void)printf(" [ %.11g ]\n", dat_ll.v * RAD_TO_DEG);
 		(void)fputs("Easting (x):   ", stdout);
 		(void)printf(oform, dat_xy.u); putchar('\n');
@@ -237,7 +491,7 @@ vprocess(FILE *fid) {
 		(void)printf("Meridian/Parallel angle: %.5f\n",
 			facs.thetap * RAD_TO_DEG);
 		(void)printf("Convergence%c: ",facs.code & IS_ANAL_CONV ? '*' : ' ');
-		(void)fputs(rtodms(pline, facs.conv, 0, 0), stdout);
+		(void)fputs(rtodms_fast(pline, facs.conv, 0, 0), stdout);
 		(void)printf(" [ %.8f ]\n", facs.conv * RAD_TO_DEG);
 		(void)printf("Max-min (Tissot axis a-b) scale error: %.5f %.5f\n\n",
 			facs.a, facs.b);
@@ -279,6 +533,10 @@ int main(int argc, char **argv) {
               case 'I': /* alt. method to spec inverse */
                 inverse = 1;
                 continue;
+              case 'j': /* parallel processing of mmap'ed file input */
+                if (--argc <= 0) goto noargument;
+                njobs = atoi(*++argv);
+                continue;
               case 'E': /* echo ascii input to ascii output */
                 echoin = 1;
                 continue;
@@ -459,7 +717,7 @@ int main(int argc, char **argv) {
     if (inverse)
         informat = strtod;
     else {
-        informat = dmstor;
+        informat = dmstor_fast;
         if (!oform)
             oform = "%.2f";
     }
@@ -490,6 +748,9 @@ int main(int argc, char **argv) {
         emess_dat.File_line = 0;
         if (very_verby)
             vprocess(fid);
+        else if (njobs > 1 && !bin_in && !bin_out && !dofactors
+                 && process_mmapped(fid))
+            ; /* mmap'ed parallel path handled the whole file */
         else
             process(fid);
         (void)fclose(fid);
@@ -56,6 +56,33 @@ extern int pj_errno;	/* global error return code */
     #define projXY projUV
     #define projLP projUV
     typedef void *projCtx;
+    /* hot path instrumentation counters, see pj_ctx_get_stats() */
+    typedef struct {
+        unsigned long phi2_iterations;
+        unsigned long inv_mlfn_iterations;
+        unsigned long grid_hits;
+        unsigned long grid_misses;
+        unsigned long gridlist_locks;
+        unsigned long initcache_hits;
+        unsigned long initcache_misses;
+        unsigned long grid_provisional;
+        unsigned long roundtrip_points;
+        unsigned long roundtrip_failures;
+        double roundtrip_err_sum;
+        double roundtrip_err_max;
+    } PJ_STATS;
+    /* cache occupancy report, see pj_ctx_cache_stats() */
+    typedef struct {
+        int  initcache_entries;
+        long initcache_bytes;
+        int  defcache_entries;
+        long defcache_bytes;
+        int  ellcache_entries;
+        long ellcache_bytes;
+        int  grid_entries;
+        long grid_bytes;
+        long total_bytes;
+    } PJ_CACHE_STATS;
 #else
     typedef PJ *projPJ;
     typedef projCtx_t *projCtx;
@@ -78,8 +105,157 @@ typedef struct projFileAPI_t {
 projXY pj_fwd(projLP, projPJ);
 projLP pj_inv(projXY, projPJ);
 
+int pj_fwd_batch( projPJ, long point_count,
+                  const double *lam, const double *phi,
+                  double *x, double *y );
+int pj_inv_batch( projPJ, long point_count,
+                  const double *x, const double *y,
+                  double *lam, double *phi );
+/* quiet variants: invalid points are marked in band (HUGE_VAL, NaN
+** inputs passed through) and the count of them is returned, with no
+** error state published */
+long pj_fwd_batch_quiet( projPJ, long point_count,
+                         const double *lam, const double *phi,
+                         double *x, double *y );
+long pj_inv_batch_quiet( projPJ, long point_count,
+                         const double *x, const double *y,
+                         double *lam, double *phi );
+
+/* externally maintained batch kernels (hand vectorized SIMD builds
+** and the like) registered per projection id slot into the same
+** dispatch as the built in batch kernels, inheriting the batch
+** scaffolding, planning and error masking around them.  The forward
+** kernel receives normalized lam/phi (lam0 subtracted, wrapped,
+** range checked) and writes raw kernel x/y before the false origin
+** scaling; the inverse the reverse; failed points travel as HUGE_VAL
+** in both directions.  Overrides are installed at the end of setup,
+** so only PJs initialized after the registration pick them up; a
+** NULL kernel leaves the built in one for that direction, both NULL
+** removes the entry, and width > 1 is advertised as the explicit
+** SIMD width.  The flags gate installation by setup variant, since
+** spherical and ellipsoidal paths are different math */
+typedef void (*projBatchKernelFn)( const double *in_x, const double *in_y,
+                                   double *out_x, double *out_y,
+                                   long point_count, projPJ defn );
+#define PJ_KERNEL_SPHERICAL_ONLY   1
+#define PJ_KERNEL_ELLIPSOIDAL_ONLY 2
+int pj_register_kernel( const char *proj_name, int width,
+                        projBatchKernelFn fwd_batch,
+                        projBatchKernelFn inv_batch, int flags );
+
 int pj_transform( projPJ src, projPJ dst, long point_count, int point_offset,
                   double *x, double *y, double *z );
+/* float32 variant for vertex-buffer style data: widened to double in
+** cache-resident chunks internally, so accuracy is the double pipeline's
+** rounded once to float (meter level or better at map scales) */
+int pj_transform_f( projPJ src, projPJ dst, long point_count,
+                    int point_offset, float *x, float *y, float *z );
+/* layout conversion between interleaved coordinate records (xy / xyz
+** doubles, point_offset is the record stride with 0 meaning packed,
+** trailing attribute fields are preserved) and the separate per axis
+** arrays the batch pipeline runs fastest on; z may be NULL for two
+** axis records.  Return 0, or -1 for a malformed call */
+int pj_deinterleave( long point_count, int point_offset, const double *in,
+                     double *x, double *y, double *z );
+int pj_interleave( long point_count, int point_offset,
+                   const double *x, const double *y, const double *z,
+                   double *out );
+
+/* cached transformation plan for a fixed src/dst pair */
+typedef struct projTransformPlanType *projTransformPlan;
+projTransformPlan pj_transform_plan( projPJ src, projPJ dst );
+/* as pj_transform_plan(), but x/y arrays carry decimal degrees on the
+** declared (latlong) side; the conversion rides an existing fused
+** scale stage instead of a separate pass */
+projTransformPlan pj_transform_plan_units( projPJ src, projPJ dst,
+                                           int src_degrees,
+                                           int dst_degrees );
+int pj_transform_exec( projTransformPlan plan,
+                       long point_count, int point_offset,
+                       double *x, double *y, double *z );
+/* single point specialization of pj_transform_exec() for latency
+** bound callers: same stages and results, no block machinery */
+int pj_transform_point( projTransformPlan plan,
+                        double *x, double *y, double *z );
+void pj_transform_plan_free( projTransformPlan plan );
+/* optional memo cache for workloads that transform repeated 2D
+   coordinates; entries rounds up to a power of two, 0 detaches */
+int pj_transform_plan_memo( projTransformPlan plan, int entries );
+/* declare the area of use (radians) so grid resolution can prune
+** non-intersecting shift grids up front; west > east spans the
+** dateline */
+int pj_transform_plan_set_area( projTransformPlan plan,
+                                double west_long, double south_lat,
+                                double east_long, double north_lat );
+void pj_transform_plan_memo_stats( projTransformPlan plan,
+                                   unsigned long *hits,
+                                   unsigned long *lookups );
+/* round trip (fwd then inv) a deterministic 1-in-sample_rate subset of
+** each pj_transform_exec() call and accumulate the horizontal error
+** into the context's roundtrip_* counters, for continuous accuracy
+** monitoring at a fraction of the full double-transform cost;
+** sample_rate <= 0 detaches */
+int pj_transform_plan_validate( projTransformPlan plan, int sample_rate );
+/* opt in to lane compaction: blocks left mostly HUGE_VAL by a grid
+** shift or projection stage run the remaining stages over only the
+** surviving points; dead lanes keep the values they failed with */
+int pj_transform_plan_compact( projTransformPlan plan, int enable );
+/* allow approximation: 2D exec blocks reproducible to within
+** max_error output units by bilinear interpolation of an exactly
+** transformed anchor mesh (validated at every cell midpoint) are
+** interpolated instead of run through the stages - sized for
+** overview pyramid levels whose accuracy need is the coarse pixel.
+** With an area of use also declared (geographic source side), a
+** Chebyshev surrogate of the pipeline is fitted over the area at
+** setup time and batch traffic inside it runs through the fitted
+** polynomial.  max_error 0 restores exact operation */
+int pj_transform_plan_set_max_error( projTransformPlan plan,
+                                     double max_error );
+/* optional progress callback, invoked from pj_transform_exec() at
+** block boundaries roughly every `interval` points with the count of
+** fully transformed points; points before that cursor hold final
+** output, so after checkpointing the job resumes by re-running exec
+** on the remaining tail of the arrays.  A nonzero return (use a
+** positive value, negative ones collide with the error codes) stops
+** the run and becomes exec's return value; fn NULL detaches */
+typedef int (*projTransformProgressFn)( void *user_data,
+                                        long points_done );
+int pj_transform_plan_set_progress( projTransformPlan plan,
+                                    projTransformProgressFn fn,
+                                    long interval, void *user_data );
+/* opt in per stage timing: each stage of each exec block is bracketed
+** with a monotonic clock read and the elapsed seconds, block and
+** point counts aggregate on the plan.  Read one stage slot at a time
+** with profile_stats() - it returns the plan's stage count, so
+** stage -1 just queries that - or dump one debug level pj_log() line
+** per stage with profile_log().  Enabling resets the aggregates */
+int pj_transform_plan_profile( projTransformPlan plan, int enable );
+int pj_transform_plan_profile_stats( projTransformPlan plan, int stage,
+                                     const char **stage_name,
+                                     unsigned long *blocks,
+                                     unsigned long *points,
+                                     double *seconds );
+void pj_transform_plan_profile_log( projTransformPlan plan );
+
+/* transform result snapshots: run a plan once over a fixed coordinate
+** mesh and replay the stored results onto later datasets carrying the
+** bit-identical mesh (daily rasters with unchanging geometry), no
+** projection math at all.  apply() fingerprints the incoming arrays
+** and returns 0 when replayed, 1 when the mesh differs (transform
+** exactly and take a new snapshot), -1 for a malformed call.
+** save()/load() persist a snapshot as a machine-local cache file */
+typedef struct projTransformSnapshotType *projTransformSnapshot;
+projTransformSnapshot pj_transform_snapshot_create(
+    projTransformPlan plan, long point_count, int point_offset,
+    const double *x, const double *y, const double *z );
+int pj_transform_snapshot_apply( projTransformSnapshot snap,
+                                 long point_count, int point_offset,
+                                 double *x, double *y, double *z );
+int pj_transform_snapshot_save( projTransformSnapshot snap,
+                                const char *filename );
+projTransformSnapshot pj_transform_snapshot_load( const char *filename );
+void pj_transform_snapshot_free( projTransformSnapshot snap );
+
 int pj_datum_transform( projPJ src, projPJ dst, long point_count, int point_offset,
                         double *x, double *y, double *z );
 int pj_geocentric_to_geodetic( double a, double es,
@@ -89,23 +265,55 @@ int pj_geodetic_to_geocentric( double a, double es,
                                long point_count, int point_offset,
                                double *x, double *y, double *z );
 int pj_compare_datums( projPJ srcdefn, projPJ dstdefn );
+/* order-insensitive definition equality via the canonical form interned
+** at init; a hash compare rejects mismatches without string building */
+int pj_is_same_definition( projPJ srcdefn, projPJ dstdefn );
 int pj_apply_gridshift( projCtx, const char *, int, 
                         long point_count, int point_offset,
                         double *x, double *y, double *z );
 void pj_deallocate_grids(void);
 void pj_clear_initcache(void);
+void pj_clear_defcache(void);
 int pj_is_latlong(projPJ);
 int pj_is_geocent(projPJ);
 void pj_get_spheroid_defn(projPJ defn, double *major_axis, double *eccentricity_squared);
 void pj_pr_list(projPJ);
 void pj_free(projPJ);
+/* shared PJ lifetime: pj_retain() adds a reference and returns its
+** argument; pj_free() drops one and only the last drop destroys, so
+** threads sharing one immutable definition each hold and release
+** their own reference with no external locking.  A thread running
+** batches over a definition that another thread may concurrently
+** drop the last reference to brackets the work with
+** pj_reclaim_enter()/pj_reclaim_exit(): the final drop then defers
+** the actual teardown until every such open section has closed -
+** destruction never blocks the transform threads and they never
+** touch freed memory.  pj_reclaim_sweep() releases whatever deferred
+** teardowns have become safe and returns the count still pending */
+projPJ pj_retain(projPJ);
+void pj_reclaim_enter(void);
+void pj_reclaim_exit(void);
+int pj_reclaim_sweep(void);
 void pj_set_finder( const char *(*)(const char *) );
 void pj_set_searchpath ( int count, const char **path );
 projPJ pj_init(int, char **);
 projPJ pj_init_plus(const char *);
 projPJ pj_init_ctx( projCtx, int, char ** );
 projPJ pj_init_plus_ctx( projCtx, const char * );
+/* initialize a whole set of definitions at once (multi zone sweeps):
+** duplicate strings come back as extra references to one shared
+** object (pj_free() every slot as usual) and unique ones are set up
+** in parallel on the worker thread pool when it has the threads.
+** Failed slots are NULL; returns 0, or the first failure's errno */
+int pj_init_batch( projCtx, const char **definitions, int n,
+                   projPJ *out );
 char *pj_get_def(projPJ, int);
+/* pj_get_def() into a caller buffer; returns the needed length
+** (excluding NUL) like snprintf, so >= buflen means truncated */
+size_t pj_get_def_buf(projPJ, int options, char *buf, size_t buflen);
+/* canonical (sorted, fully expanded) definition interned at init,
+** owned by the object; NULL when none was recorded */
+const char *pj_get_def_interned(projPJ);
 projPJ pj_latlong_from_proj( projPJ );
 void *pj_malloc(size_t);
 void pj_dalloc(void *);
@@ -114,27 +322,146 @@ int *pj_get_errno_ref(void);
 const char *pj_get_release(void);
 void pj_acquire_lock(void);
 void pj_release_lock(void);
+
+/* per subsystem reader/writer locks - see pj_mutex.c */
+#define PJ_LOCK_CONTEXT   0
+#define PJ_LOCK_INITCACHE 1
+#define PJ_LOCK_DEFCACHE  2
+#define PJ_LOCK_GRIDS     3
+#define PJ_LOCK_COUNT     4
+void pj_acquire_read_lock(int lock_id);
+void pj_acquire_write_lock(int lock_id);
+void pj_release_read_lock(int lock_id);
+void pj_release_write_lock(int lock_id);
 void pj_cleanup_lock(void);
 
 projCtx pj_get_default_ctx(void);
 projCtx pj_get_ctx( projPJ );
 void pj_set_ctx( projPJ, projCtx );
 projCtx pj_ctx_alloc(void);
+/* lock-free variant for ephemeral per request contexts: built from
+** compile-time defaults with nothing inherited from the default
+** context (including PROJ_DEBUG); freed with pj_ctx_free() */
+projCtx pj_ctx_create_light(void);
 void    pj_ctx_free( projCtx );
 int pj_ctx_get_errno( projCtx );
 void pj_ctx_set_errno( projCtx, int );
 void pj_ctx_set_debug( projCtx, int );
+void pj_ctx_set_transform_threads( projCtx, int );
+/* size of the shared worker thread pool behind the parallel features
+** (defaults to PJ_NUM_THREADS, else the processor count); workers are
+** started lazily and never torn down, so shrinking below the number
+** already running only limits future growth */
+int pj_thread_pool_size( void );
+void pj_thread_pool_set_size( int );
+/* reentrant diagnostics scope: a thread that brackets its work with
+** pj_diag_push()/pj_diag_pop() records errors in a thread local slot
+** instead of the shared ctx->last_errno and global pj_errno, so
+** threads sharing PJ objects never serialize on the error fields.
+** pj_diag_pop() returns the last error of the scope (0 when clean).
+** Scopes nest, a nonzero error propagating outward on pop; pushes
+** and pops must balance on each thread */
+void pj_diag_push( void );
+int pj_diag_pop( void );
+/* error budget (radians of latitude) for approximate evaluation on this
+** context; 0 (the default) keeps full precision */
+void pj_ctx_set_approx_tolerance( projCtx, double );
+double pj_ctx_get_approx_tolerance( projCtx );
+int pj_ctx_preload_grids( projCtx, const char * );
+int pj_ctx_preload_grids_background( projCtx, const char * );
+/* reaction of grid using transforms to a grid whose payload is not
+** loaded yet - see pj_ctx_set_grid_load_mode() */
+#define PJ_GRID_LOAD_BLOCK    0  /* read the file inline (default) */
+#define PJ_GRID_LOAD_RETRY    1  /* start a background load, fail -50 */
+#define PJ_GRID_LOAD_FALLBACK 2  /* start a background load, shift with
+                                    the remaining grids for now; counted
+                                    in PJ_STATS.grid_provisional */
+void pj_ctx_set_grid_load_mode( projCtx, int );
+int pj_ctx_get_grid_load_mode( projCtx );
+void pj_set_grid_cache_max( long );
+/* nonzero blends grid shifts across subgrid and table seams: points in
+** the outermost cells of the grid that shifts them get a distance
+** weighted mix with the covering fallback grid, removing the step at
+** the handover; also settable with the PJ_GRID_BLEND environment
+** variable */
+void pj_set_grid_blend( int );
+/* nonzero defers the projection specific setup (series derivation,
+** table building) from pj_init() to the first fwd/inv/factors call,
+** so catalog style tooling can instantiate and inspect definitions
+** cheaply; also settable with the PJ_LAZY_SETUP environment variable */
+void pj_set_lazy_setup( int );
+/* nonzero pins every computation to the canonical scalar kernels so
+** identical jobs produce bit identical output regardless of which
+** optional fused/batch paths a build or platform would pick; also
+** settable with the PJ_DETERMINISTIC environment variable.  Pair
+** with a library built with contraction disabled (the
+** PROJ_FP_CONTRACT_OFF cmake option) for cross platform use */
+void pj_set_deterministic( int );
+
+/* closed form web mercator (EPSG:3857) XYZ tile index to geographic
+** (EPSG:4326, decimal degree) bounds, written west/south/east/north;
+** row 0 is northernmost.  The batch form takes index arrays, writes
+** four doubles per tile, marks out of range tiles with HUGE_VAL
+** bounds and returns their count (-1 for a malformed call) */
+int pj_webmercator_tile_bounds( int zoom, long tile_x, long tile_y,
+                                double *bounds );
+long pj_webmercator_tile_bounds_batch( int zoom, long count,
+                                       const long *tile_x,
+                                       const long *tile_y,
+                                       double *bounds );
+
+/* pool of initialized PJ objects for high churn workloads - see
+   pj_pool.c.  Like a projCtx, use one pool per thread. */
+typedef void *projPool;
+projPool pj_pool_create( projCtx ctx, int max_idle );
+projPJ pj_pool_acquire( projPool pool, const char *definition );
+void pj_pool_release( projPool pool, projPJ pj );
+void pj_pool_destroy( projPool pool );
+
+/* streaming transform pipeline - see pj_pipeline.c */
+typedef long (*projPipelineReader)( void *user_data, long max_count,
+                                    double *x, double *y, double *z );
+typedef int  (*projPipelineWriter)( void *user_data, long count,
+                                    const double *x, const double *y,
+                                    const double *z );
+int pj_transform_pipeline( projPJ srcdefn, projPJ dstdefn, long chunk_size,
+                           projPipelineReader reader,
+                           projPipelineWriter writer,
+                           void *user_data );
+void pj_ctx_get_stats( projCtx, PJ_STATS * );
+void pj_ctx_clear_stats( projCtx );
+void pj_ctx_dump_stats( projCtx );
+/* process wide cache occupancy and coordinated shedding under memory
+** pressure - see pj_ctx_cache_trim() */
+void pj_ctx_cache_stats( projCtx, PJ_CACHE_STATS * );
+long pj_ctx_cache_trim( projCtx, long target_bytes );
 void pj_ctx_set_logger( projCtx, void (*)(void *, int, const char *) );
 void pj_ctx_set_app_data( projCtx, void * );
 void *pj_ctx_get_app_data( projCtx );
 void pj_ctx_set_fileapi( projCtx, projFileAPI *);
 projFileAPI *pj_ctx_get_fileapi( projCtx );
+void *pj_ctx_buffer_get( projCtx, size_t );
+void pj_ctx_buffer_put( projCtx, void * );
+
+/* integer handle registry for FFI/JNI bindings - see pj_handles.c.
+** A handle carries a per slot generation, so one freed and released
+** looks up as NULL instead of a dangling pointer; validate sweeps an
+** array and returns the index of the first bad handle, or -1. */
+long pj_ctx_handle_register( projCtx, projPJ );
+projPJ pj_ctx_handle_lookup( projCtx, long );
+projPJ pj_ctx_handle_release( projCtx, long );
+int pj_ctx_handle_validate( projCtx, const long *, int );
 
 void pj_log( projCtx ctx, int level, const char *fmt, ... );
 void pj_stderr_logger( void *, int, const char * );
+/* in-memory ring sink for keeping debug levels on in production;
+** drain recovers the tail of the history after the fact */
+void pj_ring_logger( void *, int, const char * );
+long pj_ring_logger_drain( char *, long );
 
 /* file api */
 projFileAPI *pj_get_default_fileapi();
+projFileAPI *pj_get_buffered_fileapi();
 
 PAFile pj_ctx_fopen(projCtx ctx, const char *filename, const char *access);
 size_t pj_ctx_fread(projCtx ctx, void *buffer, size_t size, size_t nmemb, PAFile file);
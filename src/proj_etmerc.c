@@ -209,13 +209,95 @@ INVERSE(e_inverse); /* ellipsoid */
     return (lp);
 }
 
-FREEUP; if (P) free(P); }
+/* batch forms for the array entry points: same Clenshaw math as the
+** single point entries, but run over SoA coordinate arrays so the
+** series coefficients stay cached and call overhead is paid once */
+static void e_forward_batch(const double *lam, const double *phi,
+    double *x, double *y, long n, PJ *P) {
+    long i;
 
-ENTRY0(etmerc)
-    double f, n, np, Z;
+    for (i = 0; i < n; ++i) {
+        double sin_Cn, cos_Cn, cos_Ce, sin_Ce, dCn, dCe;
+        double Cn = phi[i], Ce = lam[i];
 
-    if (P->es <= 0) E_ERROR(-34);
-    f = P->es / (1 + sqrt(1 -  P->es)); /* Replaces: f = 1 - sqrt(1-P->es); */
+        Cn  = gatg(P->cbg, PROJ_ETMERC_ORDER, Cn);
+#ifdef _GNU_SOURCE
+        sincos(Cn, &sin_Cn, &cos_Cn);
+        sincos(Ce, &sin_Ce, &cos_Ce);
+#else
+        sin_Cn = sin(Cn);
+        cos_Cn = cos(Cn);
+        sin_Ce = sin(Ce);
+        cos_Ce = cos(Ce);
+#endif
+        Cn     = atan2(sin_Cn, cos_Ce*cos_Cn);
+        Ce     = atan2(sin_Ce*cos_Cn, hypot(sin_Cn, cos_Cn*cos_Ce));
+        Ce  = asinhy(tan(Ce));
+        Cn += clenS(P->gtu, PROJ_ETMERC_ORDER, 2*Cn, 2*Ce, &dCn, &dCe);
+        Ce += dCe;
+        if (fabs(Ce) <= 2.623395162778) {
+            y[i] = P->Qn * Cn + P->Zb;  /* Northing */
+            x[i] = P->Qn * Ce;          /* Easting  */
+        } else
+            x[i] = y[i] = HUGE_VAL;
+    }
+}
+
+static void e_inverse_batch(const double *x, const double *y,
+    double *lam, double *phi, long n, PJ *P) {
+    double rQn = 1./P->Qn;
+    long i;
+
+    for (i = 0; i < n; ++i) {
+        double sin_Cn, cos_Cn, cos_Ce, sin_Ce, dCn, dCe;
+        double Cn = (y[i] - P->Zb)*rQn, Ce = x[i]*rQn;
+
+        if (fabs(Ce) <= 2.623395162778) { /* 150 degrees */
+            Cn += clenS(P->utg, PROJ_ETMERC_ORDER, 2*Cn, 2*Ce, &dCn, &dCe);
+            Ce += dCe;
+            Ce = atan(sinh(Ce));
+#ifdef _GNU_SOURCE
+            sincos(Cn, &sin_Cn, &cos_Cn);
+            sincos(Ce, &sin_Ce, &cos_Ce);
+#else
+            sin_Cn = sin(Cn);
+            cos_Cn = cos(Cn);
+            sin_Ce = sin(Ce);
+            cos_Ce = cos(Ce);
+#endif
+            Ce     = atan2(sin_Ce, cos_Ce*cos_Cn);
+            Cn     = atan2(sin_Cn*cos_Ce, hypot(sin_Ce, cos_Ce*cos_Cn));
+            phi[i] = gatg(P->cgb,  PROJ_ETMERC_ORDER, Cn);
+            lam[i] = Ce;
+        }
+        else
+            lam[i] = phi[i] = HUGE_VAL;
+    }
+}
+
+FREEUP; if (P) pj_dalloc(P); }
+
+/************************************************************************/
+/*                            pj_etmcoefs()                             */
+/*                                                                      */
+/*      Derive the Poder/Engsager series coefficients for one           */
+/*      eccentricity.  They depend only on es - the central meridian    */
+/*      just shifts lam0 and the scale/origin enter through Qn and Zb   */
+/*      below - so the result can be interned per ellipsoid the same    */
+/*      way as the pj_enfn() array (see pj_etmcoefs_shared() in         */
+/*      pj_ellcache.c).  Layout of the returned array: cgb[0..5],       */
+/*      cbg[6..11], utg[12..17], gtu[18..23] and the normalized         */
+/*      meridian quadrant (Qn without the k0 factor) in [24].           */
+/************************************************************************/
+
+    double *
+pj_etmcoefs(double es) {
+    double f, n, np;
+    double *c;
+
+    if (!(c = (double *) pj_malloc(25 * sizeof(double))))
+        return NULL;
+    f = es / (1 + sqrt(1 - es)); /* Replaces: f = 1 - sqrt(1-es); */
     /* third flattening */
     np = n = f/(2 - f);
 
@@ -223,62 +305,80 @@ ENTRY0(etmerc)
     /* cgb := Gaussian -> Geodetic, KW p190 - 191 (61) - (62) */
     /* cbg := Geodetic -> Gaussian, KW p186 - 187 (51) - (52) */
     /* PROJ_ETMERC_ORDER = 6th degree : Engsager and Poder: ICC2007 */
-    P->cgb[0] = n*( 2 + n*(-2/3.0  + n*(-2      + n*(116/45.0 + n*(26/45.0 +
-                n*(-2854/675.0 ))))));
-    P->cbg[0] = n*(-2 + n*( 2/3.0  + n*( 4/3.0  + n*(-82/45.0 + n*(32/45.0 +
-                n*( 4642/4725.0))))));
+    c[0]  = n*( 2 + n*(-2/3.0  + n*(-2      + n*(116/45.0 + n*(26/45.0 +
+            n*(-2854/675.0 ))))));
+    c[6]  = n*(-2 + n*( 2/3.0  + n*( 4/3.0  + n*(-82/45.0 + n*(32/45.0 +
+            n*( 4642/4725.0))))));
     np     *= n;
-    P->cgb[1] = np*(7/3.0 + n*( -8/5.0  + n*(-227/45.0 + n*(2704/315.0 +
-                n*( 2323/945.0)))));
-    P->cbg[1] = np*(5/3.0 + n*(-16/15.0 + n*( -13/9.0  + n*( 904/315.0 +
-                n*(-1522/945.0)))));
+    c[1]  = np*(7/3.0 + n*( -8/5.0  + n*(-227/45.0 + n*(2704/315.0 +
+            n*( 2323/945.0)))));
+    c[7]  = np*(5/3.0 + n*(-16/15.0 + n*( -13/9.0  + n*( 904/315.0 +
+            n*(-1522/945.0)))));
     np     *= n;
     /* n^5 coeff corrected from 1262/105 -> -1262/105 */
-    P->cgb[2] = np*( 56/15.0  + n*(-136/35.0 + n*(-1262/105.0 +
-                n*( 73814/2835.0))));
-    P->cbg[2] = np*(-26/15.0  + n*(  34/21.0 + n*(    8/5.0   +
-                n*(-12686/2835.0))));
+    c[2]  = np*( 56/15.0  + n*(-136/35.0 + n*(-1262/105.0 +
+            n*( 73814/2835.0))));
+    c[8]  = np*(-26/15.0  + n*(  34/21.0 + n*(    8/5.0   +
+            n*(-12686/2835.0))));
     np     *= n;
     /* n^5 coeff corrected from 322/35 -> 332/35 */
-    P->cgb[3] = np*(4279/630.0 + n*(-332/35.0 + n*(-399572/14175.0)));
-    P->cbg[3] = np*(1237/630.0 + n*( -12/5.0  + n*( -24832/14175.0)));
+    c[3]  = np*(4279/630.0 + n*(-332/35.0 + n*(-399572/14175.0)));
+    c[9]  = np*(1237/630.0 + n*( -12/5.0  + n*( -24832/14175.0)));
     np     *= n;
-    P->cgb[4] = np*(4174/315.0 + n*(-144838/6237.0 ));
-    P->cbg[4] = np*(-734/315.0 + n*( 109598/31185.0));
+    c[4]  = np*(4174/315.0 + n*(-144838/6237.0 ));
+    c[10] = np*(-734/315.0 + n*( 109598/31185.0));
     np     *= n;
-    P->cgb[5] = np*(601676/22275.0 );
-    P->cbg[5] = np*(444337/155925.0);
+    c[5]  = np*(601676/22275.0 );
+    c[11] = np*(444337/155925.0);
 
     /* Constants of the projections */
     /* Transverse Mercator (UTM, ITM, etc) */
     np = n*n;
     /* Norm. mer. quad, K&W p.50 (96), p.19 (38b), p.5 (2) */
-    P->Qn = P->k0/(1 + n) * (1 + np*(1/4.0 + np*(1/64.0 + np/256.0)));
+    c[24] = 1./(1 + n) * (1 + np*(1/4.0 + np*(1/64.0 + np/256.0)));
     /* coef of trig series */
     /* utg := ell. N, E -> sph. N, E,  KW p194 (65) */
     /* gtu := sph. N, E -> ell. N, E,  KW p196 (69) */
-    P->utg[0] = n*(-0.5  + n*( 2/3.0 + n*(-37/96.0 + n*( 1/360.0 +
-                n*(  81/512.0 + n*(-96199/604800.0))))));
-    P->gtu[0] = n*( 0.5  + n*(-2/3.0 + n*(  5/16.0 + n*(41/180.0 +
-                n*(-127/288.0 + n*(  7891/37800.0 ))))));
-    P->utg[1] = np*(-1/48.0 + n*(-1/15.0 + n*(437/1440.0 + n*(-46/105.0 +
-                n*( 1118711/3870720.0)))));
-    P->gtu[1] = np*(13/48.0 + n*(-3/5.0  + n*(557/1440.0 + n*(281/630.0 +
-                n*(-1983433/1935360.0)))));
+    c[12] = n*(-0.5  + n*( 2/3.0 + n*(-37/96.0 + n*( 1/360.0 +
+            n*(  81/512.0 + n*(-96199/604800.0))))));
+    c[18] = n*( 0.5  + n*(-2/3.0 + n*(  5/16.0 + n*(41/180.0 +
+            n*(-127/288.0 + n*(  7891/37800.0 ))))));
+    c[13] = np*(-1/48.0 + n*(-1/15.0 + n*(437/1440.0 + n*(-46/105.0 +
+            n*( 1118711/3870720.0)))));
+    c[19] = np*(13/48.0 + n*(-3/5.0  + n*(557/1440.0 + n*(281/630.0 +
+            n*(-1983433/1935360.0)))));
     np      *= n;
-    P->utg[2] = np*(-17/480.0 + n*(  37/840.0 + n*(  209/4480.0  +
-                n*( -5569/90720.0 ))));
-    P->gtu[2] = np*( 61/240.0 + n*(-103/140.0 + n*(15061/26880.0 +
-                n*(167603/181440.0))));
+    c[14] = np*(-17/480.0 + n*(  37/840.0 + n*(  209/4480.0  +
+            n*( -5569/90720.0 ))));
+    c[20] = np*( 61/240.0 + n*(-103/140.0 + n*(15061/26880.0 +
+            n*(167603/181440.0))));
     np      *= n;
-    P->utg[3] = np*(-4397/161280.0 + n*(  11/504.0 + n*( 830251/7257600.0)));
-    P->gtu[3] = np*(49561/161280.0 + n*(-179/168.0 + n*(6601661/7257600.0)));
+    c[15] = np*(-4397/161280.0 + n*(  11/504.0 + n*( 830251/7257600.0)));
+    c[21] = np*(49561/161280.0 + n*(-179/168.0 + n*(6601661/7257600.0)));
     np     *= n;
-    P->utg[4] = np*(-4583/161280.0 + n*(  108847/3991680.0));
-    P->gtu[4] = np*(34729/80640.0  + n*(-3418889/1995840.0));
+    c[16] = np*(-4583/161280.0 + n*(  108847/3991680.0));
+    c[22] = np*(34729/80640.0  + n*(-3418889/1995840.0));
     np     *= n;
-    P->utg[5] = np*(-20648693/638668800.0);
-    P->gtu[5] = np*(212378941/319334400.0);
+    c[17] = np*(-20648693/638668800.0);
+    c[23] = np*(212378941/319334400.0);
+    return c;
+}
+
+ENTRY0(etmerc)
+    double Z;
+    const double *c;
+
+    if (P->es <= 0) E_ERROR(-34);
+    /* the series derivation depends only on es, so setup is reduced to
+    ** copying the interned coefficient set; a fleet initializing sixty
+    ** UTM zones per thread derives the series exactly once */
+    if (!(c = pj_etmcoefs_shared(P->es)))
+        E_ERROR_0;
+    memcpy(P->cgb, c,      6 * sizeof(double));
+    memcpy(P->cbg, c + 6,  6 * sizeof(double));
+    memcpy(P->utg, c + 12, 6 * sizeof(double));
+    memcpy(P->gtu, c + 18, 6 * sizeof(double));
+    P->Qn = P->k0 * c[24];
     /* Gaussian latitude value of the origin latitude */
     Z = gatg(P->cbg, PROJ_ETMERC_ORDER, P->phi0);
     /* Origin northing minus true northing at the origin latitude */
@@ -286,4 +386,6 @@ ENTRY0(etmerc)
     P->Zb  = - P->Qn*(Z + clens(P->gtu, PROJ_ETMERC_ORDER, 2*Z));
     P->inv = e_inverse;
     P->fwd = e_forward;
+    P->inv_batch = e_inverse_batch;
+    P->fwd_batch = e_forward_batch;
 ENDENTRY(P)
@@ -69,8 +69,8 @@ INVERSE(e_inverse); /* ellipsoid */
 FREEUP;
 	if (P) {
 		if (P->en)
-			free(P->en);
-		free(P);
+			pj_dalloc(P->en);
+		pj_dalloc(P);
 	}
 }
 ENTRY1(rouss, en)
@@ -0,0 +1,378 @@
+/******************************************************************************
+ *
+ * Project:  PROJ.4
+ * Purpose:  Throughput benchmark for the transformation pipeline.  Where
+ *           multistresstest checks correctness under threads, projbench
+ *           measures points/sec per projection family and per stage
+ *           (forward, inverse, 7 parameter datum shift, grid shift),
+ *           single threaded and through the chunked multi-threaded
+ *           pj_transform() path, with warmup and repetitions, and emits
+ *           machine readable CSV so runs can be diffed between releases.
+ *
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "proj_api.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+typedef struct {
+    const char *family;     /* reported in the CSV */
+    const char *src_def;
+    const char *dst_def;
+    double min_lat, max_lat;    /* input domain (degrees) */
+    double min_lon, max_lon;
+} BenchItem;
+
+static const BenchItem bench_list[] = {
+    { "merc",
+      "+proj=latlong +ellps=WGS84",
+      "+proj=merc +ellps=WGS84",
+      -75, 75, -150, 150 },
+    { "etmerc",
+      "+proj=latlong +ellps=WGS84",
+      "+proj=etmerc +lat_0=0 +lon_0=9 +k=0.9996 +ellps=WGS84",
+      -75, 75, -20, 38 },
+    { "lcc",
+      "+proj=latlong +ellps=WGS84",
+      "+proj=lcc +lat_1=33 +lat_2=45 +lat_0=39 +lon_0=-96 +ellps=WGS84",
+      10, 75, -150, -40 },
+    { "aea",
+      "+proj=latlong +ellps=WGS84",
+      "+proj=aea +lat_1=29.5 +lat_2=45.5 +lat_0=23 +lon_0=-96 +ellps=WGS84",
+      10, 75, -150, -40 },
+    { "stere",
+      "+proj=latlong +ellps=WGS84",
+      "+proj=stere +lat_0=90 +lat_ts=70 +lon_0=-45 +ellps=WGS84",
+      30, 85, -170, 170 },
+    { "robin",
+      "+proj=latlong +ellps=WGS84",
+      "+proj=robin +ellps=WGS84",
+      -75, 75, -170, 170 },
+    { "healpix",
+      "+proj=latlong +ellps=WGS84",
+      "+proj=healpix +ellps=WGS84",
+      -75, 75, -170, 170 },
+    { "datum7param",
+      "+proj=latlong +datum=WGS84",
+      "+proj=latlong +datum=potsdam",
+      -75, 75, -170, 170 },
+    { "gridshift",
+      "+proj=latlong +datum=NAD27",
+      "+proj=latlong +datum=WGS84",
+      28, 48, -120, -75 },
+};
+
+#define BENCH_COUNT ((int) (sizeof(bench_list) / sizeof(bench_list[0])))
+
+static long point_count = 1000000;
+static int repetitions = 3;
+static int mt_threads = 4;
+static int profile_stages = 0;
+
+/************************************************************************/
+/*                              bench_now()                             */
+/************************************************************************/
+
+static double bench_now( void )
+
+{
+#ifdef _WIN32
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+/************************************************************************/
+/*                            bench_fill()                              */
+/*                                                                      */
+/*      Deterministic pseudo random points so runs are comparable.      */
+/************************************************************************/
+
+static void bench_fill( const BenchItem *item, double *x, double *y )
+
+{
+    unsigned long seed = 123456789;
+    long i;
+
+    for( i = 0; i < point_count; i++ )
+    {
+        seed = seed * 1103515245 + 12345;
+        x[i] = (item->min_lon
+                + (seed % 100000) * (item->max_lon - item->min_lon) / 99999.0)
+            * DEG_TO_RAD;
+        seed = seed * 1103515245 + 12345;
+        y[i] = (item->min_lat
+                + (seed % 100000) * (item->max_lat - item->min_lat) / 99999.0)
+            * DEG_TO_RAD;
+    }
+}
+
+/************************************************************************/
+/*                            bench_stage()                             */
+/*                                                                      */
+/*      Run one direction through pj_transform() with one warmup and    */
+/*      the configured repetitions, reporting the best time.            */
+/************************************************************************/
+
+static void bench_stage( const BenchItem *item, const char *stage,
+                         projPJ src, projPJ dst, int threads,
+                         const double *ref_x, const double *ref_y,
+                         double *x, double *y )
+
+{
+    double best = -1.0;
+    int rep, err = 0;
+    long i;
+
+    pj_ctx_set_transform_threads( pj_get_default_ctx(), threads );
+
+    for( rep = -1; rep < repetitions; rep++ ) /* rep -1 is the warmup */
+    {
+        double start, elapsed;
+
+        memcpy( x, ref_x, sizeof(double) * point_count );
+        memcpy( y, ref_y, sizeof(double) * point_count );
+
+        start = bench_now();
+        err = pj_transform( src, dst, point_count, 1, x, y, NULL );
+        elapsed = bench_now() - start;
+
+        if( err != 0 )
+            break;
+        if( rep >= 0 && (best < 0.0 || elapsed < best) )
+            best = elapsed;
+    }
+
+    pj_ctx_set_transform_threads( pj_get_default_ctx(), 0 );
+
+    if( err != 0 )
+    {
+        printf( "%s,%s,%d,%ld,%d,error,%s\n",
+                item->family, stage, threads, point_count, repetitions,
+                pj_strerrno( err ) );
+        return;
+    }
+
+    for( i = 0; i < point_count; i++ )
+        if( x[i] == HUGE_VAL )
+            break;
+    if( i < point_count )
+    {
+        printf( "%s,%s,%d,%ld,%d,error,point %ld outside domain\n",
+                item->family, stage, threads, point_count, repetitions, i );
+        return;
+    }
+
+    printf( "%s,%s,%d,%ld,%d,%.6f,%.0f\n",
+            item->family, stage, threads, point_count, repetitions,
+            best, point_count / best );
+}
+
+/************************************************************************/
+/*                           bench_profile()                            */
+/*                                                                      */
+/*      Rerun one direction through a profiled transformation plan      */
+/*      and emit one CSV row per pipeline stage, so a throughput        */
+/*      regression can be attributed to the kernel, the datum shift     */
+/*      or the grid interpolation without an external profiler.  The    */
+/*      stage column reads direction:stage_name and the points/time     */
+/*      columns are that stage's share of one single threaded pass.     */
+/************************************************************************/
+
+static void bench_profile( const BenchItem *item, const char *direction,
+                           projPJ src, projPJ dst,
+                           const double *ref_x, const double *ref_y,
+                           double *x, double *y )
+
+{
+    projTransformPlan plan = pj_transform_plan( src, dst );
+    int nstages, istage;
+
+    if( plan == NULL )
+        return;
+
+    /* warmup pass, then a profiled pass over fresh input */
+    memcpy( x, ref_x, sizeof(double) * point_count );
+    memcpy( y, ref_y, sizeof(double) * point_count );
+    if( pj_transform_exec( plan, point_count, 1, x, y, NULL ) != 0 )
+    {
+        pj_transform_plan_free( plan );
+        return;
+    }
+
+    pj_transform_plan_profile( plan, 1 );
+    memcpy( x, ref_x, sizeof(double) * point_count );
+    memcpy( y, ref_y, sizeof(double) * point_count );
+    if( pj_transform_exec( plan, point_count, 1, x, y, NULL ) != 0 )
+    {
+        pj_transform_plan_free( plan );
+        return;
+    }
+
+    nstages = pj_transform_plan_profile_stats( plan, -1,
+                                               NULL, NULL, NULL, NULL );
+    for( istage = 0; istage < nstages; istage++ )
+    {
+        const char *name = "?";
+        unsigned long blocks = 0, points = 0;
+        double seconds = 0.0;
+
+        pj_transform_plan_profile_stats( plan, istage, &name,
+                                         &blocks, &points, &seconds );
+        printf( "%s,%s:%s,1,%lu,1,%.6f,%.0f\n",
+                item->family, direction, name, points, seconds,
+                seconds > 0.0 ? points / seconds : 0.0 );
+    }
+
+    pj_transform_plan_free( plan );
+}
+
+/************************************************************************/
+/*                            bench_item()                              */
+/************************************************************************/
+
+static int bench_item( const BenchItem *item )
+
+{
+    projPJ src, dst;
+    double *ref_x, *ref_y, *x, *y;
+
+    src = pj_init_plus( item->src_def );
+    dst = src == NULL ? NULL : pj_init_plus( item->dst_def );
+    if( src == NULL || dst == NULL )
+    {
+        printf( "%s,init,0,%ld,%d,error,%s\n",
+                item->family, point_count, repetitions,
+                pj_strerrno( pj_errno ) );
+        if( src != NULL )
+            pj_free( src );
+        return 1;
+    }
+
+    ref_x = (double *) malloc( sizeof(double) * point_count * 4 );
+    if( ref_x == NULL )
+    {
+        fprintf( stderr, "projbench: out of memory for %ld points\n",
+                 point_count );
+        exit( 1 );
+    }
+    ref_y = ref_x + point_count;
+    x = ref_y + point_count;
+    y = x + point_count;
+
+    /* forward: latlong input domain */
+    bench_fill( item, ref_x, ref_y );
+    bench_stage( item, "fwd", src, dst, 1, ref_x, ref_y, x, y );
+    if( mt_threads > 1 )
+        bench_stage( item, "fwd", src, dst, mt_threads, ref_x, ref_y, x, y );
+    if( profile_stages )
+        bench_profile( item, "fwd", src, dst, ref_x, ref_y, x, y );
+
+    /* inverse: start from the forward results so every point is valid */
+    memcpy( x, ref_x, sizeof(double) * point_count );
+    memcpy( y, ref_y, sizeof(double) * point_count );
+    if( pj_transform( src, dst, point_count, 1, x, y, NULL ) == 0 )
+    {
+        memcpy( ref_x, x, sizeof(double) * point_count );
+        memcpy( ref_y, y, sizeof(double) * point_count );
+        bench_stage( item, "inv", dst, src, 1, ref_x, ref_y, x, y );
+        if( mt_threads > 1 )
+            bench_stage( item, "inv", dst, src, mt_threads,
+                         ref_x, ref_y, x, y );
+        if( profile_stages )
+            bench_profile( item, "inv", dst, src, ref_x, ref_y, x, y );
+    }
+
+    free( ref_x );
+    pj_free( src );
+    pj_free( dst );
+    return 0;
+}
+
+/************************************************************************/
+/*                               usage()                                */
+/************************************************************************/
+
+static void usage( void )
+
+{
+    fprintf( stderr,
+             "usage: projbench [-n points] [-r repetitions] [-j threads] [-p]\n"
+             "\n"
+             "Measures pj_transform() throughput per projection family and\n"
+             "stage.  Output is CSV:\n"
+             "  family,stage,threads,points,repetitions,best_sec,points_per_sec\n"
+             "-j gives the thread count for the multi-threaded rows (0 or 1\n"
+             "disables them); the datum and grid shift rows time the full\n"
+             "latlong to latlong pipeline.  -p adds one row per pipeline\n"
+             "stage (direction:stage_name) from a profiled transformation\n"
+             "plan, attributing the time within a single threaded pass.\n" );
+    exit( 1 );
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char **argv )
+
+{
+    int i, failures = 0;
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( strcmp( argv[i], "-n" ) == 0 && i + 1 < argc )
+            point_count = atol( argv[++i] );
+        else if( strcmp( argv[i], "-r" ) == 0 && i + 1 < argc )
+            repetitions = atoi( argv[++i] );
+        else if( strcmp( argv[i], "-j" ) == 0 && i + 1 < argc )
+            mt_threads = atoi( argv[++i] );
+        else if( strcmp( argv[i], "-p" ) == 0 )
+            profile_stages = 1;
+        else
+            usage();
+    }
+    if( point_count < 1 || repetitions < 1 )
+        usage();
+
+    printf( "family,stage,threads,points,repetitions,best_sec,points_per_sec\n" );
+
+    for( i = 0; i < BENCH_COUNT; i++ )
+        failures += bench_item( bench_list + i );
+
+    return failures == 0 ? 0 : 1;
+}
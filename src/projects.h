@@ -42,6 +42,7 @@
 
 /* standard inclusions */
 #include <math.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -123,6 +124,52 @@ extern double hypot(double, double);
 
 struct projFileAPI_t;
 
+/* hot path instrumentation counters, accumulated per context (also
+** defined in proj_api.h for standalone users of the public api) */
+typedef struct {
+    unsigned long phi2_iterations;     /* pj_phi2() iteration passes */
+    unsigned long inv_mlfn_iterations; /* pj_inv_mlfn() Newton passes */
+    unsigned long grid_hits;           /* points resolved by a shift grid */
+    unsigned long grid_misses;         /* points outside every candidate grid */
+    unsigned long gridlist_locks;      /* pj_gridlist_from_nadgrids() lock trips */
+    unsigned long initcache_hits;      /* init file defn found in cache */
+    unsigned long initcache_misses;    /* init file defn read from disk */
+    unsigned long grid_provisional;    /* points shifted while a needed
+                                          grid was still loading (see
+                                          PJ_GRID_LOAD_FALLBACK) */
+    unsigned long roundtrip_points;    /* points round tripped by plan
+                                          validation sampling (see
+                                          pj_transform_plan_validate()) */
+    unsigned long roundtrip_failures;  /* sampled round trips without a
+                                          finite result */
+    double roundtrip_err_sum;          /* summed horizontal round trip
+                                          error, source units; the mean
+                                          is err_sum / points */
+    double roundtrip_err_max;          /* largest round trip error seen */
+} PJ_STATS;
+
+/* process wide cache occupancy report, see pj_ctx_cache_stats() (also
+** defined in proj_api.h for standalone users of the public api) */
+typedef struct {
+    int  initcache_entries;   /* init file definition cache */
+    long initcache_bytes;
+    int  defcache_entries;    /* assembled definition cache */
+    long defcache_bytes;
+    int  ellcache_entries;    /* interned per-ellipsoid coefficients */
+    long ellcache_bytes;
+    int  grid_entries;        /* loaded heap grid payloads */
+    long grid_bytes;
+    long total_bytes;
+} PJ_CACHE_STATS;
+
+/* per-context scratch buffer pool, see pj_ctx_buffer_get() */
+#define PJ_CTX_BUFFERS 4
+typedef struct {
+    void    *buf;
+    size_t  size;
+    int     in_use;
+} PJ_CTX_BUFFER;
+
 /* proj thread context */
 typedef struct {
     int	    last_errno;
@@ -130,8 +177,39 @@ typedef struct {
     void    (*logger)(void *, int, const char *);
     void    *app_data;
     struct projFileAPI_t *fileapi;
+    int     transform_threads;  /* >1 enables chunked pj_transform() */
+    double  approx_tol;  /* >0 permits approximations adding up to this
+                            much absolute latitude error (radians) */
+    int     grid_load_mode; /* PJ_GRID_LOAD_* reaction to unloaded grids */
+    PJ_STATS stats;
+    PJ_CTX_BUFFER buffers[PJ_CTX_BUFFERS];
+    void    *handle_table;  /* integer handle registry for bindings,
+                               lazily created - see pj_handles.c */
 } projCtx_t;
 
+/* plain increments: contexts are normally confined to one thread, and a
+** race on a deliberately shared context only blurs the counts */
+#ifdef PJ_DISABLE_STATS
+#define PJ_STAT_INC(ctx, field)
+#define PJ_STAT_ADD(ctx, field, n)
+#else
+#define PJ_STAT_INC(ctx, field)  ((ctx)->stats.field)++
+#define PJ_STAT_ADD(ctx, field, n)  ((ctx)->stats.field) += (n)
+#endif
+
+/* cheap per event log gate: hot paths test this before constructing
+** the arguments for (and paying the call to) pj_log(), so a filtered
+** level costs one well predicted compare.  Building with
+** -DPJ_DISABLE_DEBUG_LOG folds the debug levels to constant false,
+** letting the compiler drop the argument setup entirely; errors and
+** the explicit PJ_LOG_NONE dumps still go through. */
+#ifdef PJ_DISABLE_DEBUG_LOG
+#define PJ_LOG_ENABLED(ctx, level) \
+    ((level) <= PJ_LOG_ERROR && (level) <= (ctx)->debug_level)
+#else
+#define PJ_LOG_ENABLED(ctx, level)  ((level) <= (ctx)->debug_level)
+#endif
+
 /* datum_type values */
 #define PJD_UNKNOWN   0
 #define PJD_3PARAM    1   
@@ -166,6 +244,22 @@ struct PJ_LIST {
 	struct PJconsts	*(*proj)(struct PJconsts*);/* projection entry point */
 	char 	* const *descr;	/* description text */
 };
+/* kernel capability descriptor for one initialized projection; filled
+** by pj_kernel_caps().  The capabilities depend on the parameters the
+** projection was set up with (sphere vs ellipsoid, specialized
+** ellipsoids), so they describe a PJ instance, not a pj_list entry. */
+struct PJ_KERNEL_CAPS {
+	int has_fwd;		/* scalar kernels */
+	int has_inv;
+	int has_fwd_batch;	/* contiguous array kernels */
+	int has_inv_batch;
+	int batch_width;	/* points per inner step of the batch
+				   kernels; 1 means a plain loop left to
+				   the compiler to vectorize */
+	int has_factors;	/* analytic scale factors (P->spc) */
+	int is_spherical;	/* spherical variant selected (es == 0) */
+	int spec_ellps;		/* PJ_SPEC_ELLPS_* specialization */
+};
 struct PJ_ELLPS {
 	char	*id;	/* ellipse keyword name */
 	char	*major;	/* a= value */
@@ -218,43 +312,121 @@ struct FACTORS {
     /* parameter list struct */
 typedef struct ARG_list {
 	struct ARG_list *next;
+	struct PL_HASH *hash;	/* head node only: pj_param() lookup index */
 	char used;
+	char arena;	/* 0: own allocation, 1: inside an arena block,
+			   2: first node of (and handle for) its block */
 	char param[1]; } paralist;
 	/* base projection data structure */
 
 
 typedef struct PJconsts {
+	/* ---- hot header ------------------------------------------------
+	** The fields the per point entries touch, laid out in roughly the
+	** pj_fwd()/pj_inv() access order so projecting a point drags two
+	** or three cachelines of this object into L1 instead of walking
+	** the whole structure.  Everything past the cold marker below is
+	** setup and bookkeeping state, read at init or per call
+	** granularity - keep per point fields out of it.  (A projection's
+	** own PROJ_PARMS__ fields are hot too, but the extension
+	** mechanism pins them to the very end of the struct.) */
+	/* lazy setup: with pj_set_lazy_setup() enabled pj_init() stops
+	** after parameter/ellipsoid handling and the projection specific
+	** setup (series derivation, table building) runs on first use -
+	** see pj_setup_finalize().  READY is the memset default, so
+	** eagerly built objects need no extra step */
+#define PJ_SETUP_READY   0
+#define PJ_SETUP_PENDING 1
+#define PJ_SETUP_FAILED  2
+	volatile int setup_state;
+	int over;   /* over-range flag */
+	int geoc;   /* geocentric latitude flag */
     projCtx_t *ctx;
 	XY  (*fwd)(LP, struct PJconsts *);
 	LP  (*inv)(XY, struct PJconsts *);
+	/* optional batch kernels operating on contiguous coordinate arrays;
+	** NULL when the projection only provides the single point entries.
+	** The batch layer always runs them in place - the output arrays
+	** alias the inputs, fwd as (x, y, x, y, n) and inv as
+	** (lam, phi, lam, phi, n) - so a kernel must latch into locals any
+	** input it still needs after its first store into that lane */
+	void (*fwd_batch)(const double *lam, const double *phi,
+                          double *x, double *y, long n, struct PJconsts *);
+	void (*inv_batch)(const double *x, const double *y,
+                          double *lam, double *phi, long n, struct PJconsts *);
+	/* optional conservative domain predicates on the normalized
+	** coordinates (del-lam/phi, descaled x/y): nonzero when the point
+	** may be inside the projection's valid domain.  They must accept
+	** every projectable point but may accept points the kernel still
+	** rejects, so cheap analytic bounds suffice.  The batch layer uses
+	** them to mark off-domain points (off-earth pixels of a satellite
+	** view and the like) in band before any kernel math is spent */
+	int (*fwd_domain)(LP, struct PJconsts *);
+	int (*inv_domain)(XY, struct PJconsts *);
+	double
+		lam0, phi0, /* central longitude, latitude */
+		x0, y0, /* easting and northing */
+		a,  /* major axis or radius if es==0 */
+		ra, /* 1/A */
+		es, /* e ^ 2 */
+		e,  /* eccentricity */
+		one_es, /* 1 - e^2 */
+		rone_es, /* 1/one_es */
+		to_meter, fr_meter, /* cartesian scaling */
+		k0;	/* general scaling factor */
+
+        double  phi2_apa[4]; /* inverse conformal latitude series */
+        int     has_phi2_apa; /* series usable for this eccentricity */
+        int     spec_ellps;  /* PJ_SPEC_ELLPS_* kernel specialization */
+	int batch_width;    /* points per inner step a kernel declares
+	                       (explicit SIMD/unrolling); 0 or 1 for the
+	                       plain compiler vectorized loops */
+	/* affine kernel description: nonzero when the projection kernels
+	** are a pure scale and shift of the normalized coordinates,
+	**     x = aff_xs * lam + aff_xo,    y = aff_ys * phi + aff_yo
+	** (eqc, the latlong stub).  The batch layer folds the range
+	** classify, longitude wrap, kernel and false origin scaling for
+	** such projections into one fused pass over the arrays - see
+	** pj_fwd_batch_work().  The scales must be nonzero */
+	int kernel_affine;
+	double aff_xs, aff_xo, aff_ys, aff_yo;
+
+	/* ---- cold section ---------------------------------------------- */
 	void (*spc)(LP, struct PJconsts *, struct FACTORS *);
 	void (*pfree)(struct PJconsts *);
 	const char *descr;
+	struct PJconsts *(*setup_fn)(struct PJconsts *);
+	int setup_errno;    /* error a deferred setup failed with */
 	paralist *params;   /* parameter list */
-	int over;   /* over-range flag */
-	int geoc;   /* geocentric latitude flag */
         int is_latlong; /* proj=latlong ... not really a projection at all */
         int is_geocent; /* proj=geocent ... not really a projection at all */
 	double
-		a,  /* major axis or radius if es==0 */
                 a_orig, /* major axis before any +proj related adjustment */
-		es, /* e ^ 2 */
-                es_orig, /* es before any +proj related adjustment */
-		e,  /* eccentricity */
-		ra, /* 1/A */
-		one_es, /* 1 - e^2 */
-		rone_es, /* 1/one_es */
-		lam0, phi0, /* central longitude, latitude */
-		x0, y0, /* easting and northing */
-		k0,	/* general scaling factor */
-		to_meter, fr_meter; /* cartesian scaling */
-    
+                es_orig; /* es before any +proj related adjustment */
+
         int     datum_type; /* PJD_UNKNOWN/3PARAM/7PARAM/GRIDSHIFT/WGS84 */
         double  datum_params[7];
+        char   *nadgrids;   /* +nadgrids value interned by pj_datum_set() */
+        /* pj_compare_datums() memo for the last peer compared; the hash
+           guards against the peer having been freed and its address
+           recycled for a different definition */
+        struct PJconsts *datum_cmp_peer;
+        unsigned long datum_cmp_peer_hash;
+        int     datum_cmp_same;
+        /* matrix forms of the 3/7 parameter shift, precomputed by
+           pj_helmert_setup(): row major 3x3 in [0..8], translation
+           in [9..11] */
+        double  helmert_to_wgs84[12];
+        double  helmert_from_wgs84[12];
         struct _pj_gi **gridlist;
         int     gridlist_count;
+        int     gridlist_generation; /* pj_gridlist_generation() value at
+                                        the time gridlist was resolved */
 
         int     has_geoid_vgrids;
+        char   *geoidgrids; /* +geoidgrids value interned at init, so the
+                               vertical shift path never re-reads the
+                               parameter list after setup */
         struct _pj_gi **vgridlist_geoid;
         int     vgridlist_geoid_count;
         double  vto_meter, vfr_meter;
@@ -264,6 +436,24 @@ typedef struct PJconsts {
         int     is_long_wrap_set;
         char    axis[4];
 
+        char   *defn_canonical;  /* expanded definition with the used
+                                    parameters in sorted order (see
+                                    pj_get_def_canonical()), interned at
+                                    init so pj_transform() and
+                                    pj_is_same_definition() can cheaply
+                                    recognize equivalent CRSes */
+        unsigned long defn_hash; /* hash of defn_canonical, 0 if unset */
+
+        void   *pool_handle;     /* entry in a pj_pool, NULL when the
+                                    object is not pool managed */
+
+        int     refcount;        /* references handed out by pj_retain();
+                                    pj_init sets 1 and pj_free() drops
+                                    one - only the last drop destroys */
+        struct PJconsts *reclaim_next; /* limbo list link while teardown
+                                          is deferred (see pj_reclaim.c) */
+        unsigned long retire_epoch;    /* epoch the object retired at */
+
         /* New Datum Shift Grid Catalogs */
         char   *catalog_name;
         struct _PJ_GridCatalog *catalog;
@@ -344,6 +534,7 @@ extern struct PJ_PRIME_MERIDIANS pj_prime_meridians[];
 #define MAX_TAB_ID 80
 typedef struct { float lam, phi; } FLP;
 typedef struct { int lam, phi; } ILP;
+typedef struct { unsigned short lam, phi; } QLP;
 
 struct CTABLE {
 	char id[MAX_TAB_ID]; /* ascii info */
@@ -351,8 +542,64 @@ struct CTABLE {
 	LP del;     /* size of cells */
 	ILP lim;    /* limits of conversion matrix */
 	FLP *cvs;   /* conversion matrix */
+	/* in-memory only fields - not part of the "ctable" disk format */
+	int tiled;     /* cvs is in tiled order (see nad_ctable_tile) */
+	int tiles_lam; /* tiles per row when tiled */
+	int packed;    /* cvs holds row quantized QLP values (see nad_ctable_pack) */
+	FLP *qbase;    /* per row shift minima, points into the cvs block */
+	FLP *qstep;    /* per row quantization steps, ditto */
+	int null_shift; /* every shift value is exactly zero; nad_cvt
+	                   returns contained points untouched without
+	                   interpolating */
+	int const_shift; /* every shift value equals const_sh to within
+	                    ~1e-12 rad (constant-offset datums published
+	                    as grids); nad_cvt applies the offset closed
+	                    form in both directions, no interpolation */
+	LP const_sh;
+	int win_row0;  /* gtx vertical grids only: cvs holds just the
+	                  latitude row window [win_row0, win_row0 +
+	                  win_rows) of the table, see
+	                  pj_gridinfo_load_window() */
+	int win_rows;  /* 0: cvs holds the whole table */
 };
 
+/* the legacy "ctable" disk format stores the struct above up to and
+   including the cvs pointer as its file header; fields added after
+   cvs are in-memory only and must not shift the file layout */
+#define CTABLE_V1_HDR_SIZE (offsetof(struct CTABLE, cvs) + sizeof(FLP *))
+
+/* optional tiled in-memory layout for CTABLE.cvs: square tiles of
+   CT_TILE x CT_TILE cells stored contiguously, so the four corners of
+   a bilinear stencil usually share one small memory region instead of
+   straddling two full rows */
+#define CT_TILE_SHIFT 3
+#define CT_TILE       (1 << CT_TILE_SHIFT)
+#define CT_TILE_MASK  (CT_TILE - 1)
+#define CT_TILED_INDEX(ct, r, c) \
+    ((((long)((r) >> CT_TILE_SHIFT) * (ct)->tiles_lam \
+       + ((c) >> CT_TILE_SHIFT)) << (2 * CT_TILE_SHIFT)) \
+     + (((r) & CT_TILE_MASK) << CT_TILE_SHIFT) + ((c) & CT_TILE_MASK))
+
+/* Flattened NTv2 subgrid tree, built once per top level grid after the
+   headers have been parsed (the headers never change afterwards, only
+   the cvs payloads load later).  The per point child descent walks
+   first_child/next_sibling indices over these parallel arrays instead
+   of chasing PJ_GRIDINFO pointers, with the epsilon padding of the
+   containment test folded into the stored bounds.  Direct children of
+   a node occupy consecutive entries so the sibling scan streams
+   through adjacent memory.  Everything lives in a single allocation
+   behind the struct; entry 0 is the top level grid itself. */
+typedef struct _pj_gi_tree {
+    int     count;
+    double *min_lam;        /* epsilon padded bounds, one array each */
+    double *max_lam;
+    double *min_phi;
+    double *max_phi;
+    struct _pj_gi **node;
+    int    *first_child;    /* -1 when the node has no children */
+    int    *next_sibling;   /* -1 at the end of a sibling run */
+} PJ_GRIDTREE;
+
 typedef struct _pj_gi {
     char *gridname;   /* identifying name of grid, eg "conus" or ntv2_0.gsb */
     char *filename;   /* full path to filename */
@@ -364,8 +611,32 @@ typedef struct _pj_gi {
 
     struct CTABLE *ct;
 
+    void   *map_base;  /* non-NULL when ct->cvs points into a read-only */
+    size_t  map_size;  /* file mapping shared between processes */
+
+    int     cvs_shm;   /* ct->cvs points into the shared grid arena
+                          (PJ_GRID_SHM); never freed or evicted */
+
+    unsigned long ident_dev; /* resolved file identity (st_dev/st_ino)
+                                captured when the grid was opened */
+    unsigned long ident_ino;
+    int     has_ident; /* identity above is valid; lets the grid list
+                          alias the same physical file reached through
+                          different spellings, see
+                          pj_gridlist_merge_gridfile() */
+
+    long    cvs_size;  /* heap bytes accounted against the grid cache
+                          budget, 0 when unloaded or mmap'ed */
+    unsigned long last_used; /* grid cache LRU clock value */
+    int     use_count; /* pinned by this many active shift operations */
+    int     loading;   /* a background thread is reading the payload
+                          (see pj_gridinfo_load_background()) */
+
     struct _pj_gi *next;
     struct _pj_gi *child;
+
+    PJ_GRIDTREE *tree; /* flattened subgrid tree for the child descent,
+                          only on NTv2 top level grids with children */
 } PJ_GRIDINFO;
 
 typedef struct {
@@ -386,6 +657,15 @@ typedef struct _PJ_GridCatalog {
     int entry_count;
     PJ_GridCatalogEntry *entries;
 
+    /* compiled date index over the sorted entries: the distinct entry
+       dates ascending, and the offset of each date's (priority ordered)
+       block of entries.  date_start has date_count+1 slots so a block
+       is always date_start[i]..date_start[i+1]-1.  NULL if the index
+       could not be built - lookups then fall back to a linear scan. */
+    int     date_count;
+    double *dates;
+    int    *date_start;
+
     struct _PJ_GridCatalog *next;
 } PJ_GridCatalog;
 
@@ -393,36 +673,151 @@ typedef struct _PJ_GridCatalog {
 /* procedure prototypes */
 double dmstor(const char *, char **);
 double dmstor_ctx(projCtx ctx, const char *, char **);
+double dmstor_fast(const char *, char **);
+double dmstor_fast_ctx(projCtx ctx, const char *, char **);
 void set_rtodms(int, int);
 char *rtodms(char *, double, int, int);
+char *rtodms_fast(char *, double, int, int);
 double adjlon(double);
+void adjlon_batch(double *, long, int, double);
+void adjlon_batch_del(double *, long);
 double aacos(projCtx,double), aasin(projCtx,double), asqrt(double), aatan2(double, double);
+double aacos_quiet(double), aasin_quiet(double);
+void aasin_batch(const double *, double *, long);
+void aacos_batch(const double *, double *, long);
 PVALUE pj_param(projCtx ctx, paralist *, const char *);
 paralist *pj_mkparam(char *);
+void pj_param_index(paralist *);
+void pj_param_index_free(paralist *);
+void pj_free_paralist(paralist *);
+/* immediate PJ teardown, bypassing the refcount and the deferred
+** reclamation in pj_free() (pj_reclaim.c calls it once an object's
+** retirement epoch is safely behind every reader) */
+void pj_free_now(PJ *);
+void pj_reclaim_retire(PJ *); /* queue a dead PJ for epoch reclamation */
 int pj_ell_set(projCtx ctx, paralist *, double *, double *);
 int pj_datum_set(projCtx,paralist *, PJ *);
 int pj_prime_meridian_set(paralist *, PJ *);
 int pj_angular_units_set(paralist *, PJ *);
 
 paralist *pj_clone_paralist( const paralist* );
+size_t pj_paralist_block_size( const paralist * );
+paralist *pj_clone_paralist_block( const paralist *, size_t );
+char *pj_get_def_canonical( PJ * );
 paralist*pj_search_initcache( const char *filekey );
 void pj_insert_initcache( const char *filekey, const paralist *list);
+paralist *pj_plancache_lookup( projCtx ctx, const char *name,
+                               long mtime, long size );
+void pj_plancache_store( projCtx ctx, const char *name,
+                         long mtime, long size, const paralist *items );
+paralist*pj_search_defcache( const char *definition );
+void pj_insert_defcache( const char *definition, const paralist *list);
+long pj_initcache_stats( int *entries );
+long pj_initcache_trim( long target_bytes );
+long pj_defcache_stats( int *entries );
+long pj_defcache_trim( long target_bytes );
+long pj_ellcache_stats( int *entries );
+long pj_grid_cache_stats( int *entries );
+long pj_grid_cache_trim( projCtx ctx, long target_bytes );
+int pj_init_index_lookup( projCtx ctx, PAFile fid, const char *fname,
+                          const char *code, long *offset );
+const char *pj_init_embedded_find( const char *fname, size_t *size );
+int pj_init_embedded_lookup( const char *data, size_t size,
+                             const char *code, long *offset );
+int pj_registry_find( const void *table, size_t entry_size, const char *id );
+double pj_prime_meridian_rad( projCtx ctx, int entry );
+int pj_setup_finalize( PJ * );
+void pj_dalloc_guard( void * );
+int pj_dalloc_unguard( void );
 
 double *pj_enfn(double);
+double *pj_enfn_shared(double); /* interned; do not pj_dalloc() */
+double *pj_etmcoefs(double);
+double *pj_etmcoefs_shared(double); /* interned; do not pj_dalloc() */
 double pj_mlfn(double, double, double, double *);
 double pj_inv_mlfn(projCtx, double, double, double *);
+double pj_inv_mlfn_batch(double, double, double *);
 double pj_qsfn(double, double, double);
 double pj_tsfn(double, double, double);
 double pj_msfn(double, double, double);
+/* batch forms of the helper trio: one branch free pass over contiguous
+** sinphi/cosphi arrays, so batch kernels do not stall on per point
+** helper calls.  qsfn/msfn match their scalars bit for bit; tsfn
+** evaluates the pow in exp/log form and matches to rounding */
+void pj_qsfn_batch(long, const double *sinphi, double e, double one_es,
+                   double *out);
+void pj_tsfn_batch(long, const double *phi, const double *sinphi, double e,
+                   double *out);
+void pj_msfn_batch(long, const double *sinphi, const double *cosphi,
+                   double es, double *out);
 double pj_phi2(projCtx, double, double);
+int pj_phi2_pre(double es, double *apa);
+int pj_phi2_pre_tol(double es, double *apa, double tol);
+double pj_phi2_apa(double ts, const double *apa);
+double pj_phi2_(double, PJ *);
+double pj_phi2_batch(double, PJ *);
+/* ellipsoids common enough that projections provide batch kernels with
+** the eccentricity baked in as a compile time constant; the es values
+** are exactly what pj_ell_set() computes from the rf= entries in
+** pj_ellps[] */
+#define PJ_SPEC_ELLPS_NONE  0
+#define PJ_SPEC_ELLPS_WGS84 1
+#define PJ_SPEC_ELLPS_GRS80 2
+#define PJ_ES_WGS84 0.0066943799901413165
+#define PJ_ES_GRS80 0.006694380022900787
+int pj_spec_ellps(double es);
 double pj_qsfn_(double, PJ *);
 double *pj_authset(double);
+double *pj_authset_shared(double); /* interned; do not pj_dalloc() */
 double pj_authlat(double, double *);
+/* batch authalic to geodetic conversion: one sin/cos pair per point
+** with the series multiples derived by identity, matching
+** pj_authlat() to rounding; HUGE_VAL lanes pass through and out may
+** alias beta */
+void pj_authlat_batch(long, const double *beta, const double *APA,
+                      double *out);
 COMPLEX pj_zpoly1(COMPLEX, COMPLEX *, int);
 COMPLEX pj_zpolyd1(COMPLEX, COMPLEX *, int, COMPLEX *);
+void pj_zpoly1_batch(const double *, const double *, double *, double *,
+	long, const COMPLEX *, int);
+void pj_zpolyd1_batch(const double *, const double *, double *, double *,
+	double *, double *, long, const COMPLEX *, int);
 
 int pj_deriv(LP, double, PJ *, struct DERIVS *);
 int pj_factors(LP, PJ *, double, struct FACTORS *);
+long pj_factors_batch(PJ *, long, const double *, const double *,
+	double, struct FACTORS *);
+void pj_kernel_caps(PJ *, struct PJ_KERNEL_CAPS *);
+/* install pj_register_kernel() overrides onto a freshly set up PJ;
+** called at the end of both the eager and deferred setup paths */
+void pj_kernel_apply_overrides(PJ *);
+void pj_pool_note_free(PJ *);
+
+/* error field in effect on the calling thread: the pj_diag_push()
+** slot when a scope is active, ctx->last_errno otherwise.  Hoisted
+** once per call by the per point loops */
+int *pj_diag_errno_addr( projCtx ctx );
+
+/* internal pieces of pj_transform(), shared with the plan based API */
+extern const int pj_transient_error[51];
+int pj_transform_range( PJ *srcdefn, PJ *dstdefn,
+                        long point_count, int point_offset,
+                        double *x, double *y, double *z );
+int pj_transform_mt( PJ *srcdefn, PJ *dstdefn,
+                     long point_count, int point_offset,
+                     double *x, double *y, double *z );
+int pj_adjust_axis( projCtx ctx, const char *axis, int denormalize_flag,
+                    long point_count, int point_offset,
+                    double *x, double *y, double *z );
+int pj_affine_edge( projCtx ctx, const char *axis, int denormalize_flag,
+                    double xy_scale, double x_off, double z_scale,
+                    long point_count, int point_offset,
+                    double *x, double *y, double *z );
+void pj_helmert_setup( PJ *defn );
+int pj_geocentric_to_wgs84( PJ *defn, long point_count, int point_offset,
+                            double *x, double *y, double *z );
+int pj_geocentric_from_wgs84( PJ *defn, long point_count, int point_offset,
+                              double *x, double *y, double *z );
 
 struct PW_COEF {/* row coefficient structure */
     int m;		/* number of c coefficients (=0 for none) */
@@ -430,7 +825,7 @@ struct PW_COEF {/* row coefficient structure */
 };
  
 /* Approximation structures and procedures */
-typedef struct {	/* Chebyshev or Power series structure */
+typedef struct Tseries {	/* Chebyshev or Power series structure */
 	projUV a, b;		/* power series range for evaluation */
 					/* or Chebyshev argument shift/scaling */
 	struct PW_COEF *cu, *cv;
@@ -441,30 +836,100 @@ Tseries *mk_cheby(projUV, projUV, double, projUV *, projUV (*)(projUV), int, int
 projUV bpseval(projUV, Tseries *);
 projUV bcheval(projUV, Tseries *);
 projUV biveval(projUV, Tseries *);
+void biveval_batch(Tseries *, long, const double *, const double *,
+                   double *, double *);
+int pj_cheby_save(FILE *, const Tseries *, int, double, projUV, projUV,
+                  projUV);
+Tseries *pj_cheby_load(projCtx, const char *, int *, double *, projUV *,
+                       projUV *, projUV *);
+void pj_cheby_free(Tseries *);
 void *vector1(int, int);
 void **vector2(int, int, int);
 void freev2(void **v, int nrows);
 int bchgen(projUV, projUV, int, int, projUV **, projUV(*)(projUV));
 int bch2bps(projUV, projUV, projUV **, int, int);
 /* nadcon related protos */
+/* caller held cache of the four bilinear corner values last loaded, so
+** runs of points falling in one grid cell (raster blocks, Newton
+** iterations) skip the repeated table reads; see nad_intr.c */
+struct nad_stencil {
+	struct CTABLE *ct;	/* table the corners came from, NULL = unset */
+	ILP indx;		/* cell the corners belong to */
+	FLP f00, f10, f01, f11;
+};
 LP nad_intr(LP, struct CTABLE *);
+LP nad_intr_grad(LP, struct CTABLE *, LP *, LP *);
+void nad_stencil_clear(struct nad_stencil *);
+LP nad_intr_stencil(LP, struct CTABLE *, struct nad_stencil *);
+LP nad_intr_grad_stencil(LP, struct CTABLE *, LP *, LP *,
+                         struct nad_stencil *);
+void nad_intr_batch(struct CTABLE *, long, const double *, const double *,
+                    double *, double *);
 LP nad_cvt(LP, int, struct CTABLE *);
+LP nad_cvt_stencil(LP, int, struct CTABLE *, struct nad_stencil *);
+void nad_cvt_batch(int, struct CTABLE *, long, double *, double *);
+int nad_ctable_tile(struct CTABLE *);
+int nad_ctable_pack(struct CTABLE *);
+void pj_gridinfo_set_tiled(int);
+void pj_gridinfo_set_packed(int);
+void pj_gridinfo_set_gtx_window(int);
+int pj_use_batch_kernels(void);
+int pj_use_deterministic(void);
+void pj_set_batch_kernels(int);
+#ifdef PROJ_SPECULATIVE_DISPATCH
+/* speculative dispatch: the hottest tiny kernels are exported under
+** fixed names and registered in place of their file statics, so the
+** per point entries in pj_fwd.c/pj_inv.c can compare P->fwd against a
+** link time constant and call the winner directly - a predictable
+** branch an LTO build inlines through - instead of paying an
+** unpredictable indirect call per point when several projections are
+** live.  The miss path is the usual indirect call, so unlisted
+** projections are unaffected */
+XY pj_merc_sfwd_hot(LP, PJ *);
+LP pj_merc_sinv_hot(XY, PJ *);
+XY pj_eqc_fwd_hot(LP, PJ *);
+LP pj_eqc_inv_hot(XY, PJ *);
+#define PJ_FWD_SPECULATE(lp, P) \
+	((P)->fwd == pj_merc_sfwd_hot ? pj_merc_sfwd_hot(lp, P) : \
+	 (P)->fwd == pj_eqc_fwd_hot ? pj_eqc_fwd_hot(lp, P) : \
+	 (*(P)->fwd)(lp, P))
+#define PJ_INV_SPECULATE(xy, P) \
+	((P)->inv == pj_merc_sinv_hot ? pj_merc_sinv_hot(xy, P) : \
+	 (P)->inv == pj_eqc_inv_hot ? pj_eqc_inv_hot(xy, P) : \
+	 (*(P)->inv)(xy, P))
+#else
+#define PJ_FWD_SPECULATE(lp, P) ((*(P)->fwd)(lp, P))
+#define PJ_INV_SPECULATE(xy, P) ((*(P)->inv)(xy, P))
+#endif
+/* shared worker thread pool (pj_tpool.c); run blocks until the batch
+   completes with the caller participating, submit is fire and forget
+   and returns -1 when the caller must do the work inline */
+void pj_tpool_run( void (*func)(void *), void **args, int count );
+int pj_tpool_submit( void (*func)(void *), void *arg );
+void pj_numa_spread_touch( void *mem, size_t size );
+
+void pj_ctx_handles_free( projCtx );
 struct CTABLE *nad_init(projCtx ctx, char *);
+int pj_ctx_get_fd( projCtx ctx, PAFile file );
 struct CTABLE *nad_ctable_init( projCtx ctx, PAFile fid );
 int nad_ctable_load( projCtx ctx, struct CTABLE *, PAFile fid );
 struct CTABLE *nad_ctable2_init( projCtx ctx, PAFile fid );
 int nad_ctable2_load( projCtx ctx, struct CTABLE *, PAFile fid );
+struct CTABLE *nad_ctable3_init( projCtx ctx, PAFile fid );
+int nad_ctable3_load( projCtx ctx, struct CTABLE *, PAFile fid );
+unsigned int nad_ctable3_checksum( const unsigned char *, long );
 void nad_free(struct CTABLE *);
 
 /* higher level handling of datum grid shift files */
 
-int pj_apply_vgridshift( PJ *defn, const char *listname,
+int pj_apply_vgridshift( PJ *defn,
                          PJ_GRIDINFO ***gridlist_p, 
                          int *gridlist_count_p,
                          int inverse, 
                          long point_count, int point_offset,
                          double *x, double *y, double *z );
-int pj_apply_gridshift_2( PJ *defn, int inverse, 
+int pj_gridshift_resolve( PJ *defn );
+int pj_apply_gridshift_2( PJ *defn, int inverse,
                           long point_count, int point_offset,
                           double *x, double *y, double *z );
 int pj_apply_gridshift_3( projCtx ctx, 
@@ -473,11 +938,20 @@ int pj_apply_gridshift_3( projCtx ctx,
                           double *x, double *y, double *z );
 
 PJ_GRIDINFO **pj_gridlist_from_nadgrids( projCtx, const char *, int * );
+int pj_gridlist_generation(void);
 void pj_deallocate_grids();
 
+void pj_grid_cache_touch( PJ_GRIDINFO * );
+void pj_grid_cache_note_loaded( projCtx, PJ_GRIDINFO * );
+void pj_grid_cache_note_freed( PJ_GRIDINFO * );
+void pj_grid_cache_pin( PJ_GRIDINFO **, int, int );
+
 PJ_GRIDINFO *pj_gridinfo_init( projCtx, const char * );
 int pj_gridinfo_load( projCtx, PJ_GRIDINFO * );
+int pj_gridinfo_load_window( projCtx, PJ_GRIDINFO *, double, double );
+int pj_gridinfo_load_background( projCtx, PJ_GRIDINFO * );
 void pj_gridinfo_free( projCtx, PJ_GRIDINFO * );
+PJ_GRIDINFO *pj_gridinfo_descend( PJ_GRIDINFO *, LP, PJ_GRIDINFO ** );
 
 PJ_GridCatalog *pj_gc_findcatalog( projCtx, const char * );
 PJ_GridCatalog *pj_gc_readcatalog( projCtx, const char * );
@@ -503,6 +977,7 @@ double proj_inv_mdist(projCtx ctx, double, const void *);
 void *pj_gauss_ini(double, double, double *,double *);
 LP pj_gauss(projCtx, LP, const void *);
 LP pj_inv_gauss(projCtx, LP, const void *);
+LP pj_inv_gauss_batch(LP, const void *);
 
 extern char const pj_release[];
 
@@ -0,0 +1,536 @@
+/******************************************************************************
+ *
+ * Project:  PROJ.4
+ * Purpose:  Release validation harness over the nad/ test scripts.  The
+ *           scripts (test27, test83, testvarious) drive proj/cs2cs one
+ *           point at a time, which never touches the fused batch
+ *           kernels, the plan executor or the chunked multi-threaded
+ *           pj_transform() path.  projvalidate replays every $EXE
+ *           heredoc block from those scripts through each variant,
+ *           compares the results against the canonical scalar kernels,
+ *           and times each variant on the same transform, so the
+ *           accuracy of the fast paths and their claimed speedups are
+ *           proven together on the full suite before a release.
+ *
+ *           Tolerance: a variant coordinate v is accepted against the
+ *           scalar reference r when |v - r| <= 1e-9 * (1 + |r|), i.e.
+ *           about a nanoradian for geographic output and a centimetre
+ *           at 10^7 m for projected output, which covers the ulp level
+ *           reassociation differences of the fused kernels.  Lanes the
+ *           scalar reference cannot transform (HUGE_VAL) are excluded
+ *           from the comparison.
+ *
+ * Author:   Frank Warmerdam, warmerdam@pobox.com
+ *
+ ******************************************************************************
+ * Copyright (c) 2010, Frank Warmerdam
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "projects.h"
+#include "proj_api.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#define MAX_LINE        2048
+#define MAX_BLOCK_PTS   256
+
+static long point_count = 100000;
+static int  repetitions = 2;
+static int  mt_threads = 4;
+static int  failures = 0;
+static int  blocks_run = 0;
+
+/************************************************************************/
+/*                              val_now()                               */
+/************************************************************************/
+
+static double val_now( void )
+
+{
+#ifdef _WIN32
+    return GetTickCount() / 1000.0;
+#else
+    struct timeval tv;
+    gettimeofday( &tv, NULL );
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+/************************************************************************/
+/*                            val_basename()                            */
+/************************************************************************/
+
+static const char *val_basename( const char *path )
+
+{
+    const char *slash = strrchr( path, '/' );
+#ifdef _WIN32
+    const char *bslash = strrchr( path, '\\' );
+    if( bslash != NULL && (slash == NULL || bslash > slash) )
+        slash = bslash;
+#endif
+    return slash != NULL ? slash + 1 : path;
+}
+
+/************************************************************************/
+/*                            val_variant()                             */
+/*                                                                      */
+/*      Run one variant over the replicated input, timing the best of   */
+/*      the configured repetitions, and compare the final output        */
+/*      against the scalar reference.  When ref_x is NULL this is the   */
+/*      scalar pass itself: its output becomes the reference and the    */
+/*      comparison is skipped.  Returns the best time, or -1 on error.  */
+/************************************************************************/
+
+static double val_variant( const char *block, const char *variant,
+                           projPJ src, projPJ dst, projTransformPlan plan,
+                           int threads, double scalar_best,
+                           const double *in_x, const double *in_y,
+                           const double *in_z,
+                           double *ref_x, double *ref_y, double *ref_z,
+                           double *x, double *y, double *z,
+                           int is_reference )
+
+{
+    double best = -1.0, max_err = 0.0;
+    int rep, err = 0, ok = 1;
+    long i;
+
+    pj_set_batch_kernels( is_reference ? 0 : 1 );
+    pj_ctx_set_transform_threads( pj_get_default_ctx(), threads );
+
+    for( rep = -1; rep < repetitions; rep++ ) /* rep -1 is the warmup */
+    {
+        double start, elapsed;
+
+        memcpy( x, in_x, sizeof(double) * point_count );
+        memcpy( y, in_y, sizeof(double) * point_count );
+        memcpy( z, in_z, sizeof(double) * point_count );
+
+        start = val_now();
+        if( plan != NULL )
+            err = pj_transform_exec( plan, point_count, 1, x, y, z );
+        else
+            err = pj_transform( src, dst, point_count, 1, x, y, z );
+        elapsed = val_now() - start;
+
+        if( err != 0 )
+            break;
+        if( rep >= 0 && (best < 0.0 || elapsed < best) )
+            best = elapsed;
+    }
+
+    pj_ctx_set_transform_threads( pj_get_default_ctx(), 0 );
+    pj_set_batch_kernels( 0 );
+
+    if( err != 0 )
+    {
+        printf( "%s,%s,%ld,error,,,,%s\n",
+                block, variant, point_count, pj_strerrno( err ) );
+        failures++;
+        return -1.0;
+    }
+
+    if( is_reference )
+    {
+        memcpy( ref_x, x, sizeof(double) * point_count );
+        memcpy( ref_y, y, sizeof(double) * point_count );
+        memcpy( ref_z, z, sizeof(double) * point_count );
+    }
+    else
+    {
+        for( i = 0; i < point_count; i++ )
+        {
+            double dx, dy, dz;
+
+            if( ref_x[i] == HUGE_VAL )
+                continue;
+            if( x[i] == HUGE_VAL )
+            {
+                ok = 0;
+                break;
+            }
+            dx = fabs( x[i] - ref_x[i] );
+            dy = fabs( y[i] - ref_y[i] );
+            dz = fabs( z[i] - ref_z[i] );
+            if( dx > max_err ) max_err = dx;
+            if( dy > max_err ) max_err = dy;
+            if( dz > max_err ) max_err = dz;
+            if( dx > 1e-9 * (1.0 + fabs(ref_x[i]))
+                || dy > 1e-9 * (1.0 + fabs(ref_y[i]))
+                || dz > 1e-9 * (1.0 + fabs(ref_z[i])) )
+                ok = 0;
+        }
+        if( !ok )
+            failures++;
+    }
+
+    printf( "%s,%s,%ld,%.6f,%.0f,%.2f,%.3e,%s\n",
+            block, variant, point_count, best,
+            best > 0.0 ? point_count / best : 0.0,
+            scalar_best > 0.0 && best > 0.0 ? scalar_best / best : 1.0,
+            max_err, ok ? "ok" : "FAIL" );
+
+    return best;
+}
+
+/************************************************************************/
+/*                             val_block()                              */
+/*                                                                      */
+/*      Validate one $EXE heredoc block: build the source and           */
+/*      destination definitions, replicate the block's points up to     */
+/*      the configured count, then run the scalar reference followed    */
+/*      by the batch kernels, the transformation plan executor and      */
+/*      the chunked multi-threaded path.                                */
+/************************************************************************/
+
+static void val_block( const char *block, char *src_def, char *dst_def,
+                       int npts, double *pt_x, double *pt_y, double *pt_z )
+
+{
+    projPJ src = NULL, dst = NULL;
+    projTransformPlan plan;
+    double *buf, *in_x, *in_y, *in_z, *ref_x, *ref_y, *ref_z, *x, *y, *z;
+    double scalar_best;
+    long i;
+
+    if( npts == 0 )
+        return;
+
+    if( dst_def != NULL )
+    {
+        src = pj_init_plus( src_def );
+        dst = src == NULL ? NULL : pj_init_plus( dst_def );
+    }
+    else
+    {
+        /* proj style block: forward projection from its own latlong */
+        dst = pj_init_plus( src_def );
+        src = dst == NULL ? NULL : pj_latlong_from_proj( dst );
+    }
+
+    if( src == NULL || dst == NULL )
+    {
+        printf( "%s,init,0,skip,,,,%s\n", block, pj_strerrno( pj_errno ) );
+        if( src != NULL ) pj_free( src );
+        if( dst != NULL ) pj_free( dst );
+        return;
+    }
+
+    buf = (double *) malloc( sizeof(double) * point_count * 9 );
+    if( buf == NULL )
+    {
+        fprintf( stderr, "projvalidate: out of memory for %ld points\n",
+                 point_count );
+        exit( 1 );
+    }
+    in_x = buf;
+    in_y = in_x + point_count;
+    in_z = in_y + point_count;
+    ref_x = in_z + point_count;
+    ref_y = ref_x + point_count;
+    ref_z = ref_y + point_count;
+    x = ref_z + point_count;
+    y = x + point_count;
+    z = y + point_count;
+
+    /* tile the block's points over the full array so the timed runs
+       exercise the same transform at production batch sizes */
+    for( i = 0; i < point_count; i++ )
+    {
+        in_x[i] = pt_x[i % npts];
+        in_y[i] = pt_y[i % npts];
+        in_z[i] = pt_z[i % npts];
+    }
+
+    blocks_run++;
+
+    scalar_best = val_variant( block, "scalar", src, dst, NULL, 0, -1.0,
+                               in_x, in_y, in_z, ref_x, ref_y, ref_z,
+                               x, y, z, 1 );
+    if( scalar_best >= 0.0 )
+    {
+        val_variant( block, "batch", src, dst, NULL, 0, scalar_best,
+                     in_x, in_y, in_z, ref_x, ref_y, ref_z, x, y, z, 0 );
+
+        pj_set_batch_kernels( 1 );
+        plan = pj_transform_plan( src, dst );
+        pj_set_batch_kernels( 0 );
+        if( plan != NULL )
+        {
+            val_variant( block, "plan", src, dst, plan, 0, scalar_best,
+                         in_x, in_y, in_z, ref_x, ref_y, ref_z, x, y, z, 0 );
+            pj_transform_plan_free( plan );
+        }
+        else
+            printf( "%s,plan,%ld,skip,,,,no plan for this pair\n",
+                    block, point_count );
+
+        if( mt_threads > 1 )
+            val_variant( block, "mt", src, dst, NULL, mt_threads,
+                         scalar_best, in_x, in_y, in_z,
+                         ref_x, ref_y, ref_z, x, y, z, 0 );
+    }
+
+    free( buf );
+    pj_free( src );
+    pj_free( dst );
+}
+
+/************************************************************************/
+/*                             val_script()                             */
+/*                                                                      */
+/*      Parse one nad/ test script, extracting each "$EXE ... <<EOF"    */
+/*      invocation with its heredoc points.  Only the +key[=value]      */
+/*      arguments matter (and "+to", splitting source from              */
+/*      destination); formatting flags and redirections are dropped,    */
+/*      and ${INIT_FILE} is resolved against the script's directory     */
+/*      the way the scripts themselves do.  Geographic input is         */
+/*      parsed with dmstor() like proj/cs2cs, projected and             */
+/*      geocentric input with strtod().                                 */
+/************************************************************************/
+
+static int val_script( const char *path )
+
+{
+    FILE *fp = fopen( path, "r" );
+    char line[MAX_LINE];
+    char init_file[MAX_LINE];
+    char dir[MAX_LINE];
+    const char *base = val_basename( path );
+    int lineno = 0;
+
+    if( fp == NULL )
+    {
+        fprintf( stderr, "projvalidate: cannot open %s\n", path );
+        return 1;
+    }
+
+    strcpy( dir, path );
+    if( strlen(dir) >= strlen(base) )
+        dir[strlen(dir) - strlen(base)] = '\0';
+    init_file[0] = '\0';
+
+    while( fgets( line, sizeof(line), fp ) != NULL )
+    {
+        char src_def[MAX_LINE], dst_def[MAX_LINE];
+        char *defp = src_def, *tok;
+        char block[MAX_LINE];
+        int  have_dst = 0, in_heredoc = 0, npts = 0;
+        double pt_x[MAX_BLOCK_PTS], pt_y[MAX_BLOCK_PTS], pt_z[MAX_BLOCK_PTS];
+        char *s = line;
+
+        lineno++;
+
+        while( *s == ' ' || *s == '\t' )
+            s++;
+
+        if( strncmp( s, "INIT_FILE=", 10 ) == 0 )
+        {
+            char *val = s + 10;
+            char *nl = strpbrk( val, "\r\n" );
+
+            if( nl != NULL ) *nl = '\0';
+            if( strncmp( val, "${NAD_DIR}/", 11 ) == 0 )
+                sprintf( init_file, "%s%s", dir, val + 11 );
+            else
+                strcpy( init_file, val );
+            continue;
+        }
+
+        if( strncmp( s, "$EXE", 4 ) != 0 )
+            continue;
+
+        sprintf( block, "%s:%d", base, lineno );
+        src_def[0] = dst_def[0] = '\0';
+        s += 4;
+
+/* -------------------------------------------------------------------- */
+/*      Collect the +arguments across continuation lines.               */
+/* -------------------------------------------------------------------- */
+        for( ; ; )
+        {
+            int continued = 0;
+
+            for( tok = strtok( s, " \t\r\n" ); tok != NULL;
+                 tok = strtok( NULL, " \t\r\n" ) )
+            {
+                if( strcmp( tok, "\\" ) == 0 )
+                {
+                    continued = 1;
+                    break;
+                }
+                if( strncmp( tok, "<<", 2 ) == 0 )
+                {
+                    in_heredoc = 1;
+                    break;
+                }
+                if( tok[0] != '+' )
+                    continue;
+                if( strcmp( tok, "+to" ) == 0 )
+                {
+                    have_dst = 1;
+                    defp = dst_def;
+                    dst_def[0] = '\0';
+                    continue;
+                }
+                /* resolve ${INIT_FILE} the way the scripts do */
+                if( strncmp( tok, "+init=${INIT_FILE}", 18 ) == 0 )
+                    sprintf( defp + strlen(defp), " +init=%s%s",
+                             init_file, tok + 18 );
+                else
+                    sprintf( defp + strlen(defp), " %s", tok );
+            }
+
+            if( !continued || in_heredoc )
+                break;
+            if( fgets( line, sizeof(line), fp ) == NULL )
+                break;
+            lineno++;
+            s = line;
+        }
+
+        if( !in_heredoc )
+            continue;
+
+/* -------------------------------------------------------------------- */
+/*      Read the heredoc points.                                        */
+/* -------------------------------------------------------------------- */
+        {
+            projPJ probe = pj_init_plus( src_def[0] != '\0'
+                                         ? src_def : "+proj=latlong" );
+            int geographic = probe == NULL || pj_is_latlong( probe )
+                || !have_dst;   /* proj style input is always latlong */
+
+            if( probe != NULL )
+                pj_free( probe );
+
+            while( fgets( line, sizeof(line), fp ) != NULL )
+            {
+                char *p = line;
+
+                lineno++;
+                while( *p == ' ' || *p == '\t' )
+                    p++;
+                if( strncmp( p, "EOF", 3 ) == 0 )
+                    break;
+                if( *p == '\0' || *p == '\r' || *p == '\n'
+                    || npts >= MAX_BLOCK_PTS )
+                    continue;
+
+                if( geographic )
+                {
+                    pt_x[npts] = dmstor( p, &p );
+                    pt_y[npts] = dmstor( p, &p );
+                }
+                else
+                {
+                    pt_x[npts] = strtod( p, &p );
+                    pt_y[npts] = strtod( p, &p );
+                }
+                pt_z[npts] = strtod( p, &p );
+                npts++;
+            }
+        }
+
+        val_block( block, src_def, have_dst ? dst_def : NULL,
+                   npts, pt_x, pt_y, pt_z );
+    }
+
+    fclose( fp );
+    return 0;
+}
+
+/************************************************************************/
+/*                               usage()                                */
+/************************************************************************/
+
+static void usage( void )
+
+{
+    fprintf( stderr,
+             "usage: projvalidate [-n points] [-r repetitions] [-j threads]\n"
+             "                    <nad test script> ...\n"
+             "\n"
+             "Replays every $EXE heredoc block of the given nad/ scripts\n"
+             "(test27, test83, testvarious) through the scalar reference,\n"
+             "the fused batch kernels, the transformation plan executor and\n"
+             "the chunked multi-threaded pj_transform() path, tiling each\n"
+             "block's points up to -n.  Output is CSV:\n"
+             "  block,variant,points,best_sec,points_per_sec,speedup,max_err,status\n"
+             "Accuracy is checked against the scalar kernels within\n"
+             "|err| <= 1e-9 * (1 + |ref|); any FAIL row makes the exit\n"
+             "status nonzero.  -j gives the thread count of the mt rows\n"
+             "(0 or 1 disables them).\n" );
+    exit( 1 );
+}
+
+/************************************************************************/
+/*                                main()                                */
+/************************************************************************/
+
+int main( int argc, char **argv )
+
+{
+    int i, nscripts = 0;
+
+    for( i = 1; i < argc; i++ )
+    {
+        if( strcmp( argv[i], "-n" ) == 0 && i + 1 < argc )
+            point_count = atol( argv[++i] );
+        else if( strcmp( argv[i], "-r" ) == 0 && i + 1 < argc )
+            repetitions = atoi( argv[++i] );
+        else if( strcmp( argv[i], "-j" ) == 0 && i + 1 < argc )
+            mt_threads = atoi( argv[++i] );
+        else if( argv[i][0] == '-' )
+            usage();
+        else
+            break;
+    }
+    if( i == argc || point_count < 1 || repetitions < 1 )
+        usage();
+
+    /* the scalar reference must really be scalar */
+    pj_set_batch_kernels( 0 );
+
+    printf( "block,variant,points,best_sec,points_per_sec,speedup,max_err,status\n" );
+
+    for( ; i < argc; i++ )
+    {
+        if( val_script( argv[i] ) != 0 )
+            failures++;
+        nscripts++;
+    }
+
+    fprintf( stderr, "projvalidate: %d scripts, %d blocks, %d failures\n",
+             nscripts, blocks_run, failures );
+
+    return failures == 0 ? 0 : 1;
+}
@@ -14,7 +14,8 @@ CONV = 206264806.24709635515796003417;
 	static char
 format[50] = "%dd%d'%.3f\"%c";
 	static int
-dolong = 0;
+dolong = 0,
+res_digits = 3;
 	void
 set_rtodms(int fract, int con_w) {
 	int i;
@@ -26,6 +27,7 @@ set_rtodms(int fract, int con_w) {
 			RES *= 10.;
 		RES60 = RES * 60.;
 		CONV = 180. * 3600. * RES / PI;
+		res_digits = fract;
 		if (! con_w)
 			(void)sprintf(format,"%%dd%%d'%%.%df\"%%c", fract);
 		else
@@ -70,3 +72,88 @@ rtodms(char *s, double r, int pos, int neg) {
 		(void)sprintf(ss,"%dd%c",deg, sign);
 	return s;
 }
+
+/* emit a non-negative integer, zero padded to at least width digits */
+	static char *
+dms_itoa(char *s, long v, int width) {
+	char t[24];
+	int n = 0;
+
+	do {
+		t[n++] = (char)('0' + (int)(v % 10));
+		v /= 10;
+	} while (v);
+	while (n < width)
+		t[n++] = '0';
+	while (n)
+		*s++ = t[--n];
+	return s;
+}
+
+/*
+** Fast twin of rtodms() for the bulk output paths in proj/cs2cs:
+** produces identical strings without sprintf().  The rounded seconds
+** are kept in RES-scaled integer form so the fraction digits come
+** straight out of the remainder rather than a %f conversion.
+*/
+	char *
+rtodms_fast(char *s, double r, int pos, int neg) {
+	int deg, min, sign;
+	char *ss = s;
+	long sw, sf;
+	double sec;
+
+	if (r < 0) {
+		r = -r;
+		if  (!pos) { *ss++ = '-'; sign = 0; }
+		else sign = neg;
+	} else
+		sign = pos;
+	r = floor(r * CONV + .5);
+	sec = fmod(r, RES60);
+	r = floor(r / RES60);
+	min = fmod(r, 60.);
+	deg = floor(r / 60.);
+	sw = (long)(sec / RES);
+	sf = (long)(sec - (double)sw * RES);
+
+	ss = dms_itoa(ss, deg, 1);
+	*ss++ = 'd';
+	if (dolong) {
+		ss = dms_itoa(ss, min, 2);
+		*ss++ = '\'';
+		ss = dms_itoa(ss, sw, 2);
+		if (res_digits) {
+			*ss++ = '.';
+			ss = dms_itoa(ss, sf, res_digits);
+		}
+		*ss++ = '"';
+	} else if (sw || sf) {
+		char *p;
+
+		ss = dms_itoa(ss, min, 1);
+		*ss++ = '\'';
+		ss = dms_itoa(ss, sw, 1);
+		if (sf) {
+			*ss++ = '.';
+			ss = dms_itoa(ss, sf, res_digits);
+		}
+		/* same trailing zero trim as rtodms(): the %f conversion
+		** there always emits the dot, so whole second zeros are
+		** only exposed to the trim when no fraction is configured */
+		if (sf || !res_digits) {
+			for (p = ss; p[-1] == '0'; --p) ;
+			if (p[-1] == '.')
+				--p;
+			ss = p;
+		}
+		*ss++ = '"';
+	} else if (min) {
+		ss = dms_itoa(ss, min, 1);
+		*ss++ = '\'';
+	}
+	if (sign)
+		*ss++ = (char)sign;
+	*ss = '\0';
+	return s;
+}